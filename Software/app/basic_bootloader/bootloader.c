@@ -20,11 +20,19 @@
  *
  */
 
+#include <stddef.h>
 #include "bootloader.h"
 
 typedef void (*functionPointer)(void);
 static volatile Bootloader_state_t bootloader_state = BOOTLOADER_STATE_APP_JMP;
 
+#if (BOOTLOADER_FUOTA_UPDATE)
+static FUOTA_IMAGE_Decoder_t update_decoder;
+#endif
+#if (BOOTLOADER_FUOTA_UPDATE || BOOTLOADER_AB_SLOTS)
+static uint8_t flash_buffer[MCU_FLASH_ROW_SIZE];
+#endif
+
 /**
  * @brief  Initializes bootloader and flash
  * @return Bootloader_op_result_t (BL_OP_SUCCESS or BL_OP_UNKNOWN_ERROR)
@@ -132,6 +140,507 @@ void Bootloader_HandleInput(void)
 #endif
 }
 
+#if (BOOTLOADER_AB_SLOTS)
+static HAL_StatusTypeDef Bootloader_BackupSource(void *pContext, uint32_t uOffset, uint8_t *pBuffer, uint32_t uLength)
+{
+    return (GNSE_Flash_Read(BOOT_META_BACKUP_ADDRESS + uOffset, uLength, pBuffer) == FLASH_OP_SUCCESS) ? HAL_OK : HAL_ERROR;
+}
+
+/**
+ * @brief Checks the application in the active slot against its record
+ * @param record record of the active slot
+ * @return true if the size and CRC-32 match
+ */
+static bool Bootloader_AppValid(const BOOT_META_Record_t *record)
+{
+    return (record->Size != 0) && (record->Size <= APP_SIZE) &&
+           (UTIL_CRC32_Update(UTIL_CRC32_INIT, (const void *)APP_ADDRESS, record->Size) == record->Crc);
+}
+
+/**
+ * @brief Checks the backup slot in the external flash against its record
+ * @param size size of the backed up application, 0 if there is none
+ * @param crc CRC-32 of the backed up application
+ * @return true if the size and CRC-32 match
+ */
+static bool Bootloader_BackupValid(uint32_t size, uint32_t crc)
+{
+    uint32_t offset;
+    uint32_t length;
+    uint32_t value = UTIL_CRC32_INIT;
+
+    if ((size == 0) || (size > BOOT_META_BACKUP_SIZE) || (size > APP_SIZE))
+    {
+        return false;
+    }
+    for (offset = 0; offset < size; offset += length)
+    {
+        length = size - offset;
+        length = (length > sizeof(flash_buffer)) ? sizeof(flash_buffer) : length;
+        if (GNSE_Flash_Read(BOOT_META_BACKUP_ADDRESS + offset, length, flash_buffer) != FLASH_OP_SUCCESS)
+        {
+            return false;
+        }
+        value = UTIL_CRC32_Update(value, flash_buffer, length);
+    }
+    return value == crc;
+}
+
+/**
+ * @brief Records the application found in the active slot as confirmed, e.g. when flashed with a debugger
+ * @note The recorded size excludes the trailing erased words of the application area
+ * @param record filled with the appended record
+ * @return Bootloader_op_result_t (BL_OP_NO_APP if the active slot is empty)
+ */
+static Bootloader_op_result_t Bootloader_AdoptApp(BOOT_META_Record_t *record)
+{
+    const uint32_t *app = (const uint32_t *)APP_ADDRESS;
+    uint32_t size = APP_SIZE;
+
+    while ((size >= sizeof(uint32_t)) && (app[(size / sizeof(uint32_t)) - 1U] == 0xFFFFFFFFU))
+    {
+        size -= sizeof(uint32_t);
+    }
+    if ((size == 0) || (app[0] == 0xFFFFFFFFU))
+    {
+        return BL_OP_NO_APP;
+    }
+
+    record->Version = 0;
+    record->Size = size;
+    record->Crc = UTIL_CRC32_Update(UTIL_CRC32_INIT, (const void *)APP_ADDRESS, size);
+    record->BackupVersion = 0;
+    record->BackupSize = 0;
+    record->BackupCrc = 0;
+    record->Trials = BOOT_META_TRIALS_NONE;
+    record->Confirmed = BOOT_META_CONFIRMED;
+    return (BOOT_META_Append(record) == BOOT_META_OP_SUCCESS) ? BL_OP_SUCCESS : BL_OP_WRITE_ERROR;
+}
+
+/**
+ * @brief Restores the backup slot to the active slot
+ * @param record record of the active slot, replaced by the record of the restored application
+ * @return Bootloader_op_result_t (BL_OP_NO_APP if the backup slot is empty or corrupt, nothing was erased then)
+ */
+static Bootloader_op_result_t Bootloader_Rollback(BOOT_META_Record_t *record)
+{
+    if (Bootloader_BackupValid(record->BackupSize, record->BackupCrc) == false)
+    {
+        return BL_OP_NO_APP;
+    }
+    if (MCU_FLASH_Erase((void *)APP_ADDRESS, record->BackupSize) != HAL_OK)
+    {
+        return BL_OP_ERASE_ERROR;
+    }
+    if (MCU_FLASH_WriteStream(APP_ADDRESS, record->BackupSize, Bootloader_BackupSource, NULL) != HAL_OK)
+    {
+        return BL_OP_WRITE_ERROR;
+    }
+
+    record->Version = record->BackupVersion;
+    record->Size = record->BackupSize;
+    record->Crc = record->BackupCrc;
+    if (Bootloader_AppValid(record) == false)
+    {
+        return BL_OP_CHKSUM_ERROR;
+    }
+    record->Trials = BOOT_META_TRIALS_NONE;
+    record->Confirmed = BOOT_META_CONFIRMED;
+    return (BOOT_META_Append(record) == BOOT_META_OP_SUCCESS) ? BL_OP_SUCCESS : BL_OP_WRITE_ERROR;
+}
+
+#if (BOOTLOADER_FUOTA_UPDATE)
+/**
+ * @brief Copies the confirmed application to the backup slot before an update replaces it
+ * @note An unconfirmed or corrupt application is not worth keeping, the previous backup is kept instead
+ * @param record filled with the record of the active slot, with the backup fields to carry over
+ * @return Bootloader_op_result_t
+ */
+static Bootloader_op_result_t Bootloader_BackupApp(BOOT_META_Record_t *record)
+{
+    Bootloader_op_result_t ret;
+
+    switch (BOOT_META_Get(record))
+    {
+    case BOOT_META_OP_SUCCESS:
+        break;
+    case BOOT_META_OP_EMPTY:
+        ret = Bootloader_AdoptApp(record);
+        if (ret == BL_OP_NO_APP)
+        {
+            record->BackupVersion = 0;
+            record->BackupSize = 0;
+            record->BackupCrc = 0;
+            return BL_OP_SUCCESS;
+        }
+        if (ret != BL_OP_SUCCESS)
+        {
+            return ret;
+        }
+        break;
+    default:
+        return BL_OP_UNKNOWN_ERROR;
+    }
+
+    if ((record->Confirmed != BOOT_META_CONFIRMED) || (Bootloader_AppValid(record) == false) ||
+        ((record->BackupSize == record->Size) && (record->BackupCrc == record->Crc)))
+    {
+        return BL_OP_SUCCESS;
+    }
+
+    if (record->Size > BOOT_META_BACKUP_SIZE)
+    {
+        return BL_OP_SIZE_ERROR;
+    }
+    if (GNSE_Flash_BlockErase(BOOT_META_BACKUP_ADDRESS,
+                              (record->Size + BOOT_META_BLOCK_SIZE - 1U) / BOOT_META_BLOCK_SIZE) != FLASH_OP_SUCCESS)
+    {
+        return BL_OP_ERASE_ERROR;
+    }
+    if ((GNSE_Flash_Write(BOOT_META_BACKUP_ADDRESS, record->Size, (uint8_t *)APP_ADDRESS) != FLASH_OP_SUCCESS) ||
+        (Bootloader_BackupValid(record->Size, record->Crc) == false))
+    {
+        return BL_OP_WRITE_ERROR;
+    }
+
+    /* The record must describe the new backup before the active slot is erased */
+    record->BackupVersion = record->Version;
+    record->BackupSize = record->Size;
+    record->BackupCrc = record->Crc;
+    return (BOOT_META_Append(record) == BOOT_META_OP_SUCCESS) ? BL_OP_SUCCESS : BL_OP_WRITE_ERROR;
+}
+#endif
+
+/**
+ * @brief Verifies the application in the active slot and selects what to boot
+ * @note Sets the state to BOOTLOADER_STATE_SYS_JMP if there is no application left to boot
+ * @return Bootloader_op_result_t
+ */
+uint8_t Bootloader_CheckApp(void)
+{
+    BOOT_META_Record_t record;
+    BOOT_META_action_t action;
+    Bootloader_op_result_t ret = BL_OP_SUCCESS;
+    bool app_valid = false;
+    uint32_t start = HAL_GetTick();
+    uint32_t verified = 0;
+    uint32_t elapsed;
+
+    if (GNSE_Flash_Init() != FLASH_OP_SUCCESS)
+    {
+        GNSE_Flash_DeInit();
+        return BL_OP_UNKNOWN_ERROR;
+    }
+
+    switch (BOOT_META_Get(&record))
+    {
+    case BOOT_META_OP_SUCCESS:
+        app_valid = Bootloader_AppValid(&record);
+        verified = HAL_GetTick() - start;
+        action = BOOT_META_SelectAction(&record, app_valid);
+        break;
+    case BOOT_META_OP_EMPTY:
+        action = BOOT_META_SelectAction(NULL, false);
+        break;
+    default:
+        /* Without metadata, boot the application as is */
+        GNSE_Flash_DeInit();
+        return BL_OP_UNKNOWN_ERROR;
+    }
+
+    switch (action)
+    {
+    case BOOT_META_BOOT_TRIAL:
+        if (BOOT_META_UseTrial() != BOOT_META_OP_SUCCESS)
+        {
+            ret = BL_OP_WRITE_ERROR;
+        }
+        break;
+    case BOOT_META_ROLLBACK:
+        ret = Bootloader_Rollback(&record);
+        /* A verified application out of trials is still better than no application at all */
+        if ((ret != BL_OP_SUCCESS) && !((ret == BL_OP_NO_APP) && app_valid))
+        {
+            bootloader_state = BOOTLOADER_STATE_SYS_JMP;
+        }
+        break;
+    case BOOT_META_ADOPT:
+        ret = Bootloader_AdoptApp(&record);
+        if (ret == BL_OP_NO_APP)
+        {
+            bootloader_state = BOOTLOADER_STATE_SYS_JMP;
+        }
+        break;
+    default:
+        break;
+    }
+
+    elapsed = HAL_GetTick() - start;
+    if ((elapsed > BOOTLOADER_BOOT_BUDGET_MS) && ((action == BOOT_META_BOOT) || (action == BOOT_META_BOOT_TRIAL)))
+    {
+        /* The application can read the count with BOOT_META_Get() */
+        if (BOOT_META_RecordOverrun() != BOOT_META_OP_SUCCESS)
+        {
+            APP_PPRINTF("\r\n Boot overrun not recorded \r\n");
+        }
+        APP_PPRINTF("\r\n Boot time budget of %d ms exceeded \r\n", BOOTLOADER_BOOT_BUDGET_MS);
+    }
+
+    GNSE_Flash_DeInit();
+
+    APP_PPRINTF("\r\n Boot action %d result %d, verified in %d ms, %d ms of %d ms budget \r\n", action, ret,
+                verified, elapsed, BOOTLOADER_BOOT_BUDGET_MS);
+    return ret;
+}
+#endif
+
+#if (BOOTLOADER_FUOTA_UPDATE)
+static FUOTA_IMAGE_op_result_t Bootloader_FileRead(void *context, uint32_t offset, uint8_t *buffer, uint32_t length)
+{
+    if ((offset > FUOTA_IMAGE_FILE_SIZE_MAX) || (length > (FUOTA_IMAGE_FILE_SIZE_MAX - offset)))
+    {
+        return FUOTA_IMAGE_OP_FAIL;
+    }
+    if (GNSE_Flash_Read(FUOTA_IMAGE_FILE_ADDRESS + offset, length, buffer) != FLASH_OP_SUCCESS)
+    {
+        return FUOTA_IMAGE_OP_FAIL;
+    }
+    return FUOTA_IMAGE_OP_SUCCESS;
+}
+
+static FUOTA_IMAGE_op_result_t Bootloader_AppRead(void *context, uint32_t offset, uint8_t *buffer, uint32_t length)
+{
+    if ((offset > APP_SIZE) || (length > (APP_SIZE - offset)))
+    {
+        return FUOTA_IMAGE_OP_FAIL;
+    }
+    if (MCU_FLASH_Read(buffer, (const void *)(APP_ADDRESS + offset), length) != HAL_OK)
+    {
+        return FUOTA_IMAGE_OP_FAIL;
+    }
+    return FUOTA_IMAGE_OP_SUCCESS;
+}
+
+static HAL_StatusTypeDef Bootloader_DecoderSource(void *pContext, uint32_t uOffset, uint8_t *pBuffer, uint32_t uLength)
+{
+    return (FUOTA_IMAGE_Decode((FUOTA_IMAGE_Decoder_t *)pContext, pBuffer, uLength) == FUOTA_IMAGE_OP_SUCCESS) ? HAL_OK : HAL_ERROR;
+}
+
+static HAL_StatusTypeDef Bootloader_StagingSource(void *pContext, uint32_t uOffset, uint8_t *pBuffer, uint32_t uLength)
+{
+    return (GNSE_Flash_Read(FUOTA_IMAGE_STAGING_ADDRESS + uOffset, uLength, pBuffer) == FLASH_OP_SUCCESS) ? HAL_OK : HAL_ERROR;
+}
+
+/**
+ * @brief Programs a word of the update status record, words only go from erased to set
+ * @param offset offset of the word in FUOTA_IMAGE_Status_t
+ * @return None
+ */
+static void Bootloader_SetUpdateStatus(uint32_t offset)
+{
+    uint32_t value = FUOTA_IMAGE_STATUS_SET;
+    GNSE_Flash_Write(FUOTA_IMAGE_STORE_ADDRESS + offset, sizeof(value), (uint8_t *)&value);
+}
+
+/**
+ * @brief Decodes the whole update file without programming it, to keep the application on corrupt files
+ * @param file_size size of the update file
+ * @return Bootloader_op_result_t
+ */
+static Bootloader_op_result_t Bootloader_VerifyUpdate(uint32_t file_size)
+{
+    uint32_t offset;
+    uint32_t length;
+
+    if (FUOTA_IMAGE_DecoderInit(&update_decoder, file_size, Bootloader_FileRead, Bootloader_AppRead, NULL) != FUOTA_IMAGE_OP_SUCCESS)
+    {
+        return BL_OP_CHKSUM_ERROR;
+    }
+    for (offset = 0; offset < update_decoder.Header.ImageSize; offset += length)
+    {
+        length = update_decoder.Header.ImageSize - offset;
+        length = (length > sizeof(flash_buffer)) ? sizeof(flash_buffer) : length;
+        if (FUOTA_IMAGE_Decode(&update_decoder, flash_buffer, length) != FUOTA_IMAGE_OP_SUCCESS)
+        {
+            return BL_OP_CHKSUM_ERROR;
+        }
+    }
+    return (FUOTA_IMAGE_DecoderFinish(&update_decoder) == FUOTA_IMAGE_OP_SUCCESS) ? BL_OP_SUCCESS : BL_OP_CHKSUM_ERROR;
+}
+
+/**
+ * @brief Applies a delta to the staging area of the external flash
+ * @note The application the delta refers to is overwritten afterwards, so the decoded image is kept
+ *       in the external flash until it was programmed
+ * @param file_size size of the update file
+ * @return Bootloader_op_result_t
+ */
+static Bootloader_op_result_t Bootloader_StageUpdate(uint32_t file_size)
+{
+    uint32_t offset;
+    uint32_t length;
+
+    if (FUOTA_IMAGE_DecoderInit(&update_decoder, file_size, Bootloader_FileRead, Bootloader_AppRead, NULL) != FUOTA_IMAGE_OP_SUCCESS)
+    {
+        return BL_OP_CHKSUM_ERROR;
+    }
+    if ((update_decoder.Header.BaseSize > APP_SIZE) ||
+        (UTIL_CRC32_Update(UTIL_CRC32_INIT, (const void *)APP_ADDRESS, update_decoder.Header.BaseSize) != update_decoder.Header.BaseCrc))
+    {
+        /* The delta was generated for another application */
+        return BL_OP_CHKSUM_ERROR;
+    }
+    if (GNSE_Flash_BlockErase(FUOTA_IMAGE_STAGING_ADDRESS,
+                              (update_decoder.Header.ImageSize + FUOTA_IMAGE_BLOCK_SIZE - 1U) / FUOTA_IMAGE_BLOCK_SIZE) != FLASH_OP_SUCCESS)
+    {
+        return BL_OP_ERASE_ERROR;
+    }
+    for (offset = 0; offset < update_decoder.Header.ImageSize; offset += length)
+    {
+        length = update_decoder.Header.ImageSize - offset;
+        length = (length > sizeof(flash_buffer)) ? sizeof(flash_buffer) : length;
+        if (FUOTA_IMAGE_Decode(&update_decoder, flash_buffer, length) != FUOTA_IMAGE_OP_SUCCESS)
+        {
+            return BL_OP_CHKSUM_ERROR;
+        }
+        if (GNSE_Flash_Write(FUOTA_IMAGE_STAGING_ADDRESS + offset, length, flash_buffer) != FLASH_OP_SUCCESS)
+        {
+            return BL_OP_WRITE_ERROR;
+        }
+    }
+    return (FUOTA_IMAGE_DecoderFinish(&update_decoder) == FUOTA_IMAGE_OP_SUCCESS) ? BL_OP_SUCCESS : BL_OP_CHKSUM_ERROR;
+}
+
+/**
+ * @brief Programs the application from the update file or the staging area
+ * @param status update status record
+ * @param header update file header
+ * @return Bootloader_op_result_t
+ */
+static Bootloader_op_result_t Bootloader_ProgramUpdate(const FUOTA_IMAGE_Status_t *status, const FUOTA_IMAGE_Header_t *header)
+{
+    HAL_StatusTypeDef write_status;
+
+    if (MCU_FLASH_Erase((void *)APP_ADDRESS, header->ImageSize) != HAL_OK)
+    {
+        return BL_OP_ERASE_ERROR;
+    }
+
+    if (header->Type == FUOTA_IMAGE_TYPE_DELTA)
+    {
+        write_status = MCU_FLASH_WriteStream(APP_ADDRESS, header->ImageSize, Bootloader_StagingSource, NULL);
+    }
+    else
+    {
+        /* Decoded straight into the MCU flash, the RAM usage is the decoder window and one flash row */
+        if (FUOTA_IMAGE_DecoderInit(&update_decoder, status->FileSize, Bootloader_FileRead, NULL, NULL) != FUOTA_IMAGE_OP_SUCCESS)
+        {
+            return BL_OP_CHKSUM_ERROR;
+        }
+        write_status = MCU_FLASH_WriteStream(APP_ADDRESS, header->ImageSize, Bootloader_DecoderSource, &update_decoder);
+    }
+    if (write_status != HAL_OK)
+    {
+        return BL_OP_WRITE_ERROR;
+    }
+    if (UTIL_CRC32_Update(UTIL_CRC32_INIT, (const void *)APP_ADDRESS, header->ImageSize) != header->ImageCrc)
+    {
+        return BL_OP_CHKSUM_ERROR;
+    }
+    return BL_OP_SUCCESS;
+}
+
+/**
+ * @brief Applies a pending update file received by FUOTA
+ * @note A corrupt file or a delta for another application leaves the current application untouched and is
+ *       discarded. An interrupted programming is resumed on the next boot. With BOOTLOADER_AB_SLOTS, the
+ *       confirmed application is copied to the backup slot first and the new one is recorded as a trial.
+ * @return Bootloader_op_result_t (BL_OP_NO_UPDATE if there is nothing to apply)
+ */
+uint8_t Bootloader_Update(void)
+{
+    FUOTA_IMAGE_Status_t status;
+    FUOTA_IMAGE_Header_t header;
+#if (BOOTLOADER_AB_SLOTS)
+    BOOT_META_Record_t record;
+#endif
+    Bootloader_op_result_t ret = BL_OP_NO_UPDATE;
+    uint32_t start = HAL_GetTick();
+
+    if (GNSE_Flash_Init() != FLASH_OP_SUCCESS)
+    {
+        GNSE_Flash_DeInit();
+        return BL_OP_UNKNOWN_ERROR;
+    }
+
+    if ((GNSE_Flash_Read(FUOTA_IMAGE_STORE_ADDRESS, sizeof(status), (uint8_t *)&status) == FLASH_OP_SUCCESS) &&
+        (status.Pending == FUOTA_IMAGE_STATUS_SET) && (status.Done != FUOTA_IMAGE_STATUS_SET))
+    {
+        if ((status.FileSize > FUOTA_IMAGE_FILE_SIZE_MAX) ||
+            (FUOTA_IMAGE_ReadHeader(Bootloader_FileRead, NULL, &header) != FUOTA_IMAGE_OP_SUCCESS))
+        {
+            ret = BL_OP_CHKSUM_ERROR;
+        }
+        else if ((header.ImageSize > APP_SIZE) || (header.ImageSize == 0))
+        {
+            ret = BL_OP_SIZE_ERROR;
+        }
+        else if (status.Staged == FUOTA_IMAGE_STATUS_SET)
+        {
+            ret = BL_OP_SUCCESS;
+        }
+        else if (header.Type == FUOTA_IMAGE_TYPE_DELTA)
+        {
+            ret = Bootloader_StageUpdate(status.FileSize);
+            if (ret == BL_OP_SUCCESS)
+            {
+                Bootloader_SetUpdateStatus(offsetof(FUOTA_IMAGE_Status_t, Staged));
+            }
+        }
+        else
+        {
+            ret = Bootloader_VerifyUpdate(status.FileSize);
+        }
+
+#if (BOOTLOADER_AB_SLOTS)
+        if (ret == BL_OP_SUCCESS)
+        {
+            ret = Bootloader_BackupApp(&record);
+        }
+#endif
+        if (ret == BL_OP_SUCCESS)
+        {
+            ret = Bootloader_ProgramUpdate(&status, &header);
+        }
+#if (BOOTLOADER_AB_SLOTS)
+        if (ret == BL_OP_SUCCESS)
+        {
+            /* The new application has BOOT_META_MAX_TRIALS boots to confirm itself */
+            record.Version = header.ImageVersion;
+            record.Size = header.ImageSize;
+            record.Crc = header.ImageCrc;
+            record.Trials = BOOT_META_TRIALS_NONE;
+            record.Confirmed = 0xFFFFFFFFU;
+            if (BOOT_META_Append(&record) != BOOT_META_OP_SUCCESS)
+            {
+                ret = BL_OP_WRITE_ERROR;
+            }
+        }
+#endif
+
+        /* Only flash errors are retried on the next boot, the file itself will not get any better */
+        if ((ret != BL_OP_ERASE_ERROR) && (ret != BL_OP_WRITE_ERROR))
+        {
+            Bootloader_SetUpdateStatus(offsetof(FUOTA_IMAGE_Status_t, Done));
+        }
+        APP_PPRINTF("\r\n FUOTA update result %d in %d ms \r\n", ret, HAL_GetTick() - start);
+    }
+
+    GNSE_Flash_DeInit();
+    return ret;
+}
+#endif
+
 /**
  * @brief Performs the jump to user application address or internal ST bootloader
  * @return None
@@ -4,6 +4,10 @@
 #include "app.h"
 #include "memory_map.h"
 #include "MCU_FLASH.h"
+#include "GNSE_flash.h"
+#include "FUOTA_IMAGE.h"
+#include "BOOT_META.h"
+#include "stm32_crc.h"
 
 #define BOOTLOADER_BTN_PORT BUTTON_SW1_GPIO_PORT
 #define BOOTLOADER_BTN_PIN BUTTON_SW1_PIN
@@ -23,9 +27,30 @@
 /* Clear reset flags */
 #define CLEAR_RESET_FLAGS 1
 
+/* Apply update files received by FUOTA and stored in the external flash, see FUOTA_IMAGE.h */
+#define BOOTLOADER_FUOTA_UPDATE 1
+
+/* Verify the application before booting it and roll back to the backup slot, see BOOT_META.h */
+#define BOOTLOADER_AB_SLOTS 1
+
+#if (BOOTLOADER_AB_SLOTS)
+/* Boot time budget of the slot check when no flash is programmed, in ms. A boot over it is logged and counted in
+   the Overruns word of the application record. Rollbacks and adoptions program the active slot, their time is
+   only logged */
+#define BOOTLOADER_BOOT_BUDGET_MS 250U
+
+/* The CRC peripheral takes a 32-bit word per write, the fastest way to verify a full APPROM within the budget */
+#if (UTIL_CRC32_BACKEND != UTIL_CRC32_BACKEND_HW)
+#error "The active slot must be verified with the CRC peripheral to fit BOOTLOADER_BOOT_BUDGET_MS"
+#endif
+#endif
+
 /* Start address of application space in flash */
 #define APP_ADDRESS (uint32_t)(&(__APPROM_START__))
 
+/* Size of application space in flash */
+#define APP_SIZE (uint32_t)(&(__APPROM_SIZE__))
+
 /** Address of System Memory (ST Bootloader) */
 #define ST_BOOTLOADER_SYSMEM_ADDRESS (uint32_t)0x1FFF0000
 
@@ -41,6 +66,7 @@ typedef enum
     BL_OP_ERASE_ERROR,
     BL_OP_WRITE_ERROR,
     BL_OP_OBP_ERROR,
+    BL_OP_NO_UPDATE,
     BL_OP_UNKNOWN_ERROR
 } Bootloader_op_result_t;
 
@@ -58,6 +84,12 @@ void Bootloader_SetState(Bootloader_state_t);
 Bootloader_state_t Bootloader_GetState(void);
 
 void Bootloader_HandleInput(void);
+#if (BOOTLOADER_FUOTA_UPDATE)
+uint8_t Bootloader_Update(void);
+#endif
+#if (BOOTLOADER_AB_SLOTS)
+uint8_t Bootloader_CheckApp(void);
+#endif
 void Bootloader_Jump(void);
 
 #endif /* BOOTLOADER_H */
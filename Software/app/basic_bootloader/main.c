@@ -40,6 +40,19 @@ int main(void)
   Bootloader_Init();
   Bootloader_HandleInput();
 
+#if (BOOTLOADER_FUOTA_UPDATE)
+  if (Bootloader_GetState() == BOOTLOADER_STATE_APP_JMP)
+  {
+    Bootloader_Update();
+  }
+#endif
+#if (BOOTLOADER_AB_SLOTS)
+  if (Bootloader_GetState() == BOOTLOADER_STATE_APP_JMP)
+  {
+    Bootloader_CheckApp();
+  }
+#endif
+
 #if (GNSE_TINY_TRACER_ENABLE)
   Bootloader_state_t state = Bootloader_GetState();
   switch (state)
@@ -20,6 +20,7 @@
  *
  */
 
+#include <stddef.h>
 #include "app.h"
 #include "Region.h" /* Needed for LORAWAN_DEFAULT_DATA_RATE */
 #include "stm32_timer.h"
@@ -34,6 +35,10 @@
 #include "LmhpRemoteMcastSetup.h"
 #include "LmhpFragmentation.h"
 #include "FragDecoder.h"
+#include "GNSE_flash.h"
+#include "FUOTA_IMAGE.h"
+#include "BOOT_META.h"
+#include "stm32_crc.h"
 
 /**
   * @brief  LoRa endNode send request
@@ -131,7 +136,19 @@ static void OnFragProgress(uint16_t fragCounter, uint16_t fragNb, uint8_t fragSi
   */
 static void OnFragDone(int32_t status, uint32_t size);
 
-static uint32_t Crc32(uint8_t *buffer, uint16_t length);
+/**
+  * @brief CRC32 of the received file, only the part not folded in while writing is read back
+  * @param size file size in bytes
+  * @retval CRC32
+  */
+static uint32_t FileCrc32(uint32_t size);
+
+/**
+  * @brief Hands a received update file over to the bootloader, files without a FUOTA_IMAGE header are ignored
+  * @param size file size in bytes
+  * @retval None
+  */
+static void FileSetPending(uint32_t size);
 
 /**
   * @brief User application buffer
@@ -166,12 +183,14 @@ static LmHandlerParams_t LmHandlerParams =
         .TxDatarate = LORAWAN_DEFAULT_DATA_RATE,
         .PingPeriodicity = LORAWAN_DEFAULT_PING_SLOT_PERIODICITY};
 
-#define UNFRAGMENTED_DATA_SIZE                     ( FRAG_MAX_NB * FRAG_MAX_SIZE )
-
 /*
- * Un-fragmented data storage.
+ * Un-fragmented data is stored in the external flash, see FUOTA_IMAGE.h
  */
-static uint8_t UnfragmentedData[UNFRAGMENTED_DATA_SIZE];
+#define UNFRAGMENTED_DATA_SIZE                     ( FRAG_MAX_NB * FRAG_MAX_SIZE )
+
+#if (UNFRAGMENTED_DATA_SIZE > FUOTA_IMAGE_FILE_SIZE_MAX)
+#error "FRAG_MAX_NB * FRAG_MAX_SIZE exceeds the external flash file area"
+#endif
 
 LmhpFragmentationParams_t FragmentationParams =
 {
@@ -220,6 +239,14 @@ static volatile bool IsFileTransferDone = false;
  */
 static volatile uint32_t FileRxCrc = 0;
 
+/*
+ * Running CRC32 of the fragments written in order, and its value before the last one to drop the padding
+ */
+static uint32_t FileCrc = UTIL_CRC32_INIT;
+static uint32_t FileCrcOffset = 0;
+static uint32_t FileCrcPrevious = UTIL_CRC32_INIT;
+static uint32_t FileCrcPreviousOffset = 0;
+
 /**
   * @brief Timer to handle the application Tx
   */
@@ -233,6 +260,12 @@ void LoRaWAN_Init(void)
   /* Init Info table used by LmHandler*/
   LoraInfo_Init();
 
+  /* External flash holding the received file */
+  if (GNSE_Flash_Init() != FLASH_OP_SUCCESS)
+  {
+    APP_PPRINTF("\r\n Failed to initialize the external flash \r\n");
+  }
+
   /* Init the Lora Stack*/
   LmHandlerInit(&LmHandlerCallbacks);
 
@@ -393,6 +426,11 @@ static void OnJoinRequest(LmHandlerJoinParams_t *joinParams)
       {
         APP_LOG(ADV_TRACER_TS_OFF, ADV_TRACER_VLEVEL_M, "OTAA =====================\r\n");
       }
+      /* Joining proves the application works, keep it instead of rolling back on the next boot */
+      if (BOOT_META_Confirm() == BOOT_META_OP_FAIL)
+      {
+        APP_LOG(ADV_TRACER_TS_OFF, ADV_TRACER_VLEVEL_M, "\r\n###### = FIRMWARE CONFIRMATION FAILED\r\n");
+      }
     }
     else
     {
@@ -460,60 +498,113 @@ static void OnFragDone(int32_t status, uint32_t size)
   APP_PPRINTF("\r\n....... FRAG_DECODER Finished .......\r\n");
   APP_PPRINTF("STATUS      : %d\r\n", status);
 
-  FileRxCrc = Crc32(UnfragmentedData, size);
+  FileRxCrc = FileCrc32(size);
   APP_PPRINTF("Size      : %d\r\n", size);
   APP_PPRINTF("CRC         : %08X\r\n\r\n", FileRxCrc);
+
+  FileSetPending(size);
 }
 
-static uint32_t Crc32(uint8_t *buffer, uint16_t length)
+static uint32_t FileCrc32(uint32_t size)
 {
-  // The CRC calculation follows CCITT - 0x04C11DB7
-  const uint32_t reversedPolynom = 0xEDB88320;
-
-  // CRC initial value
-  uint32_t crc = 0xFFFFFFFF;
+  uint8_t buffer[FRAG_MAX_SIZE];
+  uint32_t crc = FileCrc;
+  uint32_t offset = FileCrcOffset;
 
-  if (buffer == NULL)
+  if (offset > size)
   {
-    return 0;
+    /* The last fragment is padded */
+    crc = FileCrcPrevious;
+    offset = FileCrcPreviousOffset;
+  }
+  if (offset > size)
+  {
+    crc = UTIL_CRC32_INIT;
+    offset = 0;
   }
 
-  for (uint16_t i = 0; i < length; ++i)
+  while (offset < size)
   {
-    crc ^= (uint32_t)buffer[i];
-    for (uint16_t i = 0; i < 8; i++)
+    uint32_t length = ((size - offset) > sizeof(buffer)) ? sizeof(buffer) : (size - offset);
+    if (FragDecoderRead(offset, buffer, length) != 0)
     {
-      crc = (crc >> 1) ^ (reversedPolynom & ~((crc & 0x01) - 1));
+      return 0;
     }
+    crc = UTIL_CRC32_Update(crc, buffer, length);
+    offset += length;
+  }
+  return crc;
+}
+
+static FUOTA_IMAGE_op_result_t FileRead(void *context, uint32_t offset, uint8_t *buffer, uint32_t length)
+{
+  return (FragDecoderRead(offset, buffer, length) == 0) ? FUOTA_IMAGE_OP_SUCCESS : FUOTA_IMAGE_OP_FAIL;
+}
+
+static void FileSetPending(uint32_t size)
+{
+  FUOTA_IMAGE_Header_t header;
+  uint32_t value;
+
+  if (FUOTA_IMAGE_ReadHeader(FileRead, NULL, &header) != FUOTA_IMAGE_OP_SUCCESS)
+  {
+    return;
   }
 
-  return ~crc;
+  /* Pending is written last, the bootloader ignores the record until then */
+  value = size;
+  GNSE_Flash_Write(FUOTA_IMAGE_STORE_ADDRESS + offsetof(FUOTA_IMAGE_Status_t, FileSize), sizeof(value), (uint8_t *)&value);
+  value = FUOTA_IMAGE_STATUS_SET;
+  GNSE_Flash_Write(FUOTA_IMAGE_STORE_ADDRESS + offsetof(FUOTA_IMAGE_Status_t, Pending), sizeof(value), (uint8_t *)&value);
+  APP_PPRINTF("Firmware update of %d bytes stored, it is applied by the bootloader on the next reset\r\n\r\n", header.ImageSize);
 }
 
 static uint8_t FragDecoderErase(uint32_t addr, uint32_t size)
 {
-  if (size >= UNFRAGMENTED_DATA_SIZE)
+  if ((addr > FUOTA_IMAGE_FILE_SIZE_MAX) || (size > (FUOTA_IMAGE_FILE_SIZE_MAX - addr)))
   {
     return (uint8_t) - 1; /* Fail */
   }
 
-  for (uint32_t i = 0; i < size; i++)
+  /* A new file replaces the previous one, the status record is erased along */
+  if (GNSE_Flash_BlockErase(FUOTA_IMAGE_STORE_ADDRESS, FUOTA_IMAGE_STORE_SIZE / FUOTA_IMAGE_BLOCK_SIZE) != FLASH_OP_SUCCESS)
   {
-    UnfragmentedData[addr + i] = 0xFF;
+    return (uint8_t) - 1; /* Fail */
   }
+
+  FileCrc = UTIL_CRC32_INIT;
+  FileCrcOffset = 0;
+  FileCrcPrevious = UTIL_CRC32_INIT;
+  FileCrcPreviousOffset = 0;
   return 0; /* Success */
 }
 
 static uint8_t FragDecoderWrite(uint32_t addr, uint8_t *data, uint32_t size)
 {
-  if (size >= UNFRAGMENTED_DATA_SIZE)
+  if ((addr > FUOTA_IMAGE_FILE_SIZE_MAX) || (size > (FUOTA_IMAGE_FILE_SIZE_MAX - addr)))
+  {
+    return (uint8_t) - 1; /* Fail */
+  }
+
+  if (GNSE_Flash_Write(FUOTA_IMAGE_FILE_ADDRESS + addr, size, data) != FLASH_OP_SUCCESS)
   {
     return (uint8_t) - 1; /* Fail */
   }
 
-  for (uint32_t i = 0; i < size; i++)
+  /* Fragments following the folded part are added to the CRC now, the others are read back once the file is complete */
+  if (addr == FileCrcOffset)
   {
-    UnfragmentedData[addr + i] = data[i];
+    FileCrcPrevious = FileCrc;
+    FileCrcPreviousOffset = FileCrcOffset;
+    FileCrc = UTIL_CRC32_Update(FileCrc, data, size);
+    FileCrcOffset += size;
+  }
+  else if (addr < FileCrcOffset)
+  {
+    FileCrc = UTIL_CRC32_INIT;
+    FileCrcOffset = 0;
+    FileCrcPrevious = UTIL_CRC32_INIT;
+    FileCrcPreviousOffset = 0;
   }
 
   return 0; // Success
@@ -521,14 +612,14 @@ static uint8_t FragDecoderWrite(uint32_t addr, uint8_t *data, uint32_t size)
 
 static uint8_t FragDecoderRead(uint32_t addr, uint8_t *data, uint32_t size)
 {
-  if (size >= UNFRAGMENTED_DATA_SIZE)
+  if ((addr > FUOTA_IMAGE_FILE_SIZE_MAX) || (size > (FUOTA_IMAGE_FILE_SIZE_MAX - addr)))
   {
     return (uint8_t) - 1; /* Fail */
   }
 
-  for (uint32_t i = 0; i < size; i++)
+  if (GNSE_Flash_Read(FUOTA_IMAGE_FILE_ADDRESS + addr, size, data) != FLASH_OP_SUCCESS)
   {
-    data[i] = UnfragmentedData[addr + i];
+    return (uint8_t) - 1; /* Fail */
   }
   return 0; // Success
 }
@@ -36,6 +36,12 @@
  */
 #define DEBUGGER_ON       1
 
+/**
+ * if ON (=1) the radio and MAC events traced since the previous uplink are logged after every uplink,
+ * to be read by tools/evt_trace.py. The trace is recorded in RAM in both cases.
+ */
+#define EVT_TRACE_LOG_ENABLE 0
+
 /* LoRaWAN v1.0.2 software based OTAA activation information */
 #define APPEUI                 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
 #define DEVEUI                 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
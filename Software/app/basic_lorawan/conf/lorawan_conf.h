@@ -46,6 +46,9 @@ extern "C" {
 
 #define KEY_LOG_ENABLED         1
 
+/* Persist the uplink frame counter of ABP sessions, see FCNT_STORE.h */
+#define LORAWAN_FCNT_STORE_ENABLED  1
+
 /* Class B ------------------------------------*/
 #define LORAMAC_CLASSB_ENABLED  0
 
@@ -25,6 +25,7 @@
 #include "stm32_seq.h"
 #include "LmHandler.h"
 #include "lora_info.h"
+#include "stm32_evt_trace.h"
 
 /**
   * @brief LoRa State Machine states
@@ -90,6 +91,13 @@ static void OnRxData(LmHandlerAppData_t *appData, LmHandlerRxParams_t *params);
  */
 static void OnMacProcessNotify(void);
 
+/**
+  * @brief Prints the radio and MAC events traced since the previous call, for tools/evt_trace.py
+  * @param None
+  * @return None
+  */
+static void PrintEventTrace(void);
+
 /**
   * @brief User application buffer
   */
@@ -102,6 +110,11 @@ static LmHandlerAppData_t AppData = {0, 0, AppDataBuffer};
 
 static ActivationType_t ActivationType = LORAWAN_DEFAULT_ACTIVATION_TYPE;
 
+/**
+  * @brief Sequence number of the next event trace record to print
+  */
+static uint32_t EventTraceCursor = 0;
+
 /**
   * @brief LoRaWAN handler Callbacks
   */
@@ -234,6 +247,7 @@ static void OnRxData(LmHandlerAppData_t *appData, LmHandlerRxParams_t *params)
 static void SendTxData(void)
 {
   UTIL_TIMER_Time_t nextTxIn = 0;
+  uint8_t txBufferSize = 0;
 
   UTIL_TIMER_Create(&TxLedTimer, 0xFFFFFFFFU, UTIL_TIMER_ONESHOT, OnTimerLedEvent, NULL);
   UTIL_TIMER_SetPeriod(&TxLedTimer, 200);
@@ -242,6 +256,12 @@ static void SendTxData(void)
 
   UTIL_TIMER_Start(&TxLedTimer);
 
+  /* Write the payload in the MAC frame buffer when it is free, LmHandlerSend() then does not copy it */
+  if ((LmHandlerGetTxBuffer(&AppData.Buffer, &txBufferSize) != LORAMAC_HANDLER_SUCCESS) || (txBufferSize < 3))
+  {
+    AppData.Buffer = AppDataBuffer;
+  }
+
   AppData.Port = LORAWAN_APP_PORT;
   AppData.BufferSize = 3;
   AppData.Buffer[0] = 0xAA;
@@ -288,7 +308,22 @@ static void OnTxData(LmHandlerTxParams_t *params)
     {
       APP_LOG(ADV_TRACER_TS_OFF, ADV_TRACER_VLEVEL_H, "UNCONFIRMED\r\n");
     }
+    PrintEventTrace();
+  }
+}
+
+static void PrintEventTrace(void)
+{
+#if (EVT_TRACE_LOG_ENABLE == 1)
+  UTIL_EVT_TRACE_Record_t record;
+
+  APP_LOG(ADV_TRACER_TS_OFF, ADV_TRACER_VLEVEL_H, "EVT_TRACE %u\r\n", UTIL_EVT_TRACE_Ring.TicksPerSecond);
+  while (UTIL_EVT_TRACE_Read(&EventTraceCursor, &record) == true)
+  {
+    APP_LOG(ADV_TRACER_TS_OFF, ADV_TRACER_VLEVEL_H, "EVT %u %u %u %u %u\r\n", EventTraceCursor - 1, record.Time,
+            record.Id, record.Arg, record.Value);
   }
+#endif /* EVT_TRACE_LOG_ENABLE */
 }
 
 static void OnJoinRequest(LmHandlerJoinParams_t *joinParams)
@@ -24,6 +24,7 @@
 #include "stm32_systime.h"
 #include "GNSE_lpm.h"
 #include "GNSE_rtc.h"
+#include "stm32_evt_trace.h"
 
 #define MAX_TS_SIZE (int)16
 
@@ -52,6 +53,9 @@ void SystemApp_Init(void)
   /*Initialises timer and RTC*/
   UTIL_TIMER_Init();
 
+  /* Trace the radio and MAC events with the RTC ticks of the timer server, which also run in stop mode */
+  UTIL_EVT_TRACE_Init(GNSE_RTC_GetTimerValue, 1U << RTC_N_PREDIV_S);
+
   /* Initialize the Low Power Manager and Debugger */
 #if defined(DEBUGGER_ON) && (DEBUGGER_ON == 1)
   GNSE_LPM_Init(GNSE_LPM_SLEEP_STOP_DEBUG_MODE);
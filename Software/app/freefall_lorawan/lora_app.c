@@ -67,6 +67,17 @@ static LmHandlerAppData_t AppData = {0, 0, AppDataBuffer};
 
 static ActivationType_t ActivationType = LORAWAN_DEFAULT_ACTIVATION_TYPE;
 
+/**
+  * @brief Retransmission policy of the confirmed free fall alarms
+  */
+static const LoRaMacRetransPolicy_t AlarmRetransPolicy =
+    {
+        .Deadline = LORAWAN_ALARM_DEADLINE,
+        .Backoff = LORAMAC_RETRANS_BACKOFF_CONSTANT,
+        .BackoffDelay = LORAWAN_ALARM_BACKOFF_DELAY,
+        .BackoffJitter = LORAWAN_ALARM_BACKOFF_JITTER,
+        .Datarate = LORAMAC_RETRANS_DR_KEEP};
+
 /**
   * @brief LoRaWAN handler Callbacks
   */
@@ -120,7 +131,8 @@ void LoRaWAN_Send_Payload(uint8_t *lora_tx_data, uint8_t lora_tx_size)
     AppData.Buffer[i] = lora_tx_data[i];
   }
 
-  if (LORAMAC_HANDLER_SUCCESS == LmHandlerSend(&AppData, LORAWAN_DEFAULT_CONFIRMED_MSG_STATE, &nextTxIn, false))
+  if (LORAMAC_HANDLER_SUCCESS == LmHandlerSendWithPolicy(&AppData, LORAWAN_DEFAULT_CONFIRMED_MSG_STATE, &AlarmRetransPolicy,
+                                                          &nextTxIn, false))
   {
     APP_LOG(ADV_TRACER_TS_ON, ADV_TRACER_VLEVEL_L, "SEND REQUEST\r\n");
   }
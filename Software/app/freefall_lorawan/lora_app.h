@@ -46,9 +46,18 @@ extern "C" {
 #define LORAWAN_DEFAULT_CLASS                       CLASS_A
 
 /*!
- * LoRaWAN default confirm state
+ * LoRaWAN default confirm state, the free fall alarms are acknowledged by the network
  */
-#define LORAWAN_DEFAULT_CONFIRMED_MSG_STATE         LORAMAC_HANDLER_UNCONFIRMED_MSG
+#define LORAWAN_DEFAULT_CONFIRMED_MSG_STATE         LORAMAC_HANDLER_CONFIRMED_MSG
+
+/*!
+ * Retransmissions of a free fall alarm: every LORAWAN_ALARM_BACKOFF_DELAY ms plus up to
+ * LORAWAN_ALARM_BACKOFF_JITTER percent, on the same data rate, and none after LORAWAN_ALARM_DEADLINE ms
+ * @note Not used when LORAWAN_DEFAULT_CONFIRMED_MSG_STATE is LORAMAC_HANDLER_UNCONFIRMED_MSG
+ */
+#define LORAWAN_ALARM_DEADLINE                      60000
+#define LORAWAN_ALARM_BACKOFF_DELAY                 3000
+#define LORAWAN_ALARM_BACKOFF_JITTER                20
 
 /*!
  * LoRaWAN Adaptive Data Rate
@@ -22,9 +22,20 @@
 #include "sys_app.h"
 #include "freertos_systime.h"
 #include "GNSE_lpm.h"
+#include "stm32_evt_trace.h"
 
 #define MAX_TS_SIZE (int)16
 
+/**
+  * @brief Cycle counter of the core, the timestamp source of the radio and MAC event trace
+  * @param none
+  * @return cycles
+  */
+static uint32_t EvtTraceGetCycles(void)
+{
+  return DWT->CYCCNT;
+}
+
 /**
   * @brief initialises the system (dbg pins, trace, mbmux, systimer, LPM, ...)
   * @param none
@@ -46,6 +57,12 @@ void SystemApp_Init(void)
   GNSE_TRACER_INIT();
   GNSE_app_printAppInfo();
 
+  /* Trace the radio and MAC events with the cycle counter, the idle task does not stop the core clock */
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  UTIL_EVT_TRACE_Init(EvtTraceGetCycles, SystemCoreClock);
+
   /* Here user can init the board peripherals and sensors */
 }
 
@@ -46,6 +46,15 @@
 #define SENSORS_DUTYCYCLE_CONF_MAX_S 8640
 #define SENSORS_DUTYCYCLE_CONF_MIN_S 5
 
+/* Number of samples aggregated in one uplink, 1 to send every sample on its own */
+#define SENSORS_AGGREGATE_SAMPLES 10
+
+/* Time in seconds after which the aggregated samples are sent, even if there are fewer than SENSORS_AGGREGATE_SAMPLES */
+#define SENSORS_AGGREGATE_DEADLINE_S 900
+
+/* Time in seconds aggregated samples wait for the duty-cycle before they are dropped */
+#define SENSORS_SAMPLE_LIFETIME_S 900
+
 /**
   * RX LED definitions
   */
@@ -82,6 +91,7 @@ typedef enum
 {
   CFG_SEQ_Task_LmHandlerProcess,
   CFG_SEQ_Task_LoRaSendOnTxTimerOrButtonEvent,
+  CFG_SEQ_Task_UplinkSchedProcess,
   CFG_SEQ_Task_NBR
 } CFG_SEQ_Task_Id_t;
 
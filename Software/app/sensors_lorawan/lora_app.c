@@ -20,12 +20,15 @@
 #include "app.h"
 #include "Region.h" /* Needed for LORAWAN_DEFAULT_DATA_RATE */
 #include "stm32_timer.h"
+#include "stm32_systime.h"
 #include "sys_app.h"
 #include "lora_app.h"
 #include "stm32_seq.h"
 #include "LmHandler.h"
 #include "lora_info.h"
 #include "sensors.h"
+#include "UPLINK_SCHED.h"
+#include "SENSOR_PAYLOAD.h"
 
 static uint32_t sensors_tx_dutycycle = SENSORS_TX_DUTYCYCLE_DEFAULT_S * 1000;
 
@@ -51,6 +54,20 @@ typedef enum TxEventType_e
   */
 static void SendTxData(void);
 
+/**
+  * @brief  Queues the aggregated sensors samples in the uplink scheduler
+  * @param  none
+  * @return none
+  */
+static void SensorsFlush(void);
+
+/**
+  * @brief  Largest sensors payload at the current datarate
+  * @param  none
+  * @return size in bytes
+  */
+static uint8_t SensorsMaxPayload(void);
+
 /**
   * @brief  TX timer callback function
   * @param  timer context
@@ -94,14 +111,27 @@ static void OnRxData(LmHandlerAppData_t *appData, LmHandlerRxParams_t *params);
 static void OnMacProcessNotify(void);
 
 /**
-  * @brief User application buffer
+  * @brief Will be called each time the uplink scheduler has to run
+  * @return none
+  */
+static void OnUplinkSchedProcessNotify(void);
+
+/**
+  * @brief Sensors samples waiting for SENSORS_AGGREGATE_SAMPLES or SENSORS_AGGREGATE_DEADLINE_S
   */
-static uint8_t AppDataBuffer[LORAWAN_APP_DATA_BUFFER_MAX_SIZE];
+static SENSOR_PAYLOAD_Block_t SensorsBlock;
 
 /**
-  * @brief User application data structure
+  * @brief Sensors samples block queued in the uplink scheduler, blocks waiting together share an uplink
   */
-static LmHandlerAppData_t AppData = {0, 0, AppDataBuffer};
+static const UPLINK_SCHED_Request_t SensorsUplink =
+{
+  .Port = SENSORS_PAYLOAD_APP_PORT,
+  .Priority = 0,
+  .Confirmed = (LORAWAN_DEFAULT_CONFIRMED_MSG_STATE == LORAMAC_HANDLER_CONFIRMED_MSG),
+  .Mergeable = true,
+  .Lifetime = SENSORS_SAMPLE_LIFETIME_S * 1000
+};
 
 static ActivationType_t ActivationType = LORAWAN_DEFAULT_ACTIVATION_TYPE;
 
@@ -150,6 +180,7 @@ void LoRaWAN_Init(void)
 
   UTIL_SEQ_RegTask((1 << CFG_SEQ_Task_LmHandlerProcess), UTIL_SEQ_RFU, LmHandlerProcess);
   UTIL_SEQ_RegTask((1 << CFG_SEQ_Task_LoRaSendOnTxTimerOrButtonEvent), UTIL_SEQ_RFU, SendTxData);
+  UTIL_SEQ_RegTask((1 << CFG_SEQ_Task_UplinkSchedProcess), UTIL_SEQ_RFU, UPLINK_SCHED_Process);
 
   /* Init Info table used by LmHandler*/
   LoraInfo_Init();
@@ -159,6 +190,8 @@ void LoRaWAN_Init(void)
 
   LmHandlerConfigure(&LmHandlerParams);
 
+  UPLINK_SCHED_Init(OnUplinkSchedProcessNotify);
+
   LmHandlerJoin(ActivationType);
 
   if (EventType == TX_ON_TIMER)
@@ -209,25 +242,65 @@ static void OnRxData(LmHandlerAppData_t *appData, LmHandlerRxParams_t *params)
 static void SendTxData(void)
 {
   sensors_t sensor_data;
-  UTIL_TIMER_Time_t nextTxIn = 0;
+  SENSOR_PAYLOAD_Sample_t sample;
+  SENSOR_PAYLOAD_op_result_t status;
 
   sensors_sample(&sensor_data);
-  AppData.Port = SENSORS_PAYLOAD_APP_PORT;
-  AppData.BufferSize = 5;
-  AppData.Buffer[0] = (uint8_t)(sensor_data.battery_voltage / 100);
-  AppData.Buffer[1] = (uint8_t)((sensor_data.temperature / 100) >> 8);
-  AppData.Buffer[2] = (uint8_t)((sensor_data.temperature / 100) & 0xFF);
-  AppData.Buffer[3] = (uint8_t)((sensor_data.humidity / 100) >> 8);
-  AppData.Buffer[4] = (uint8_t)((sensor_data.humidity / 100) & 0xFF);
-
-  if (LORAMAC_HANDLER_SUCCESS == LmHandlerSend(&AppData, LORAWAN_DEFAULT_CONFIRMED_MSG_STATE, &nextTxIn, false))
+  sample.Time = SysTimeGet().Seconds;
+  sample.Battery = (uint8_t)(sensor_data.battery_voltage / 100);
+  sample.Temperature = (int16_t)(sensor_data.temperature / 100);
+  sample.Humidity = (uint16_t)(sensor_data.humidity / 100);
+
+  status = SENSOR_PAYLOAD_Add(&SensorsBlock, &sample, SensorsMaxPayload());
+  if (status != SENSOR_PAYLOAD_OP_SUCCESS)
+  {
+    /* The block is full, or the time went backwards after a time synchronization */
+    SensorsFlush();
+    status = SENSOR_PAYLOAD_Add(&SensorsBlock, &sample, SensorsMaxPayload());
+  }
+  if (status != SENSOR_PAYLOAD_OP_SUCCESS)
+  {
+    APP_LOG(ADV_TRACER_TS_ON, ADV_TRACER_VLEVEL_L, "SAMPLE DROPPED\r\n");
+    return;
+  }
+
+  if ((SensorsBlock.Count >= SENSORS_AGGREGATE_SAMPLES) ||
+      ((sample.Time - SensorsBlock.Samples[0].Time) >= SENSORS_AGGREGATE_DEADLINE_S))
+  {
+    SensorsFlush();
+  }
+}
+
+static void SensorsFlush(void)
+{
+  if (SensorsBlock.Count == 0)
+  {
+    return;
+  }
+
+  if (UPLINK_SCHED_Enqueue(&SensorsUplink, SensorsBlock.Buffer, SensorsBlock.Size) == UPLINK_SCHED_OP_SUCCESS)
+  {
+    APP_LOG(ADV_TRACER_TS_ON, ADV_TRACER_VLEVEL_L, "%d SAMPLES QUEUED IN %d BYTES (%d pending)\r\n", SensorsBlock.Count,
+            SensorsBlock.Size, UPLINK_SCHED_Pending());
+  }
+  else
   {
-    APP_LOG(ADV_TRACER_TS_ON, ADV_TRACER_VLEVEL_L, "SEND REQUEST\r\n");
+    APP_LOG(ADV_TRACER_TS_ON, ADV_TRACER_VLEVEL_L, "%d SAMPLES DROPPED, uplink queue full\r\n", SensorsBlock.Count);
   }
-  else if (nextTxIn > 0)
+  SENSOR_PAYLOAD_Reset(&SensorsBlock);
+}
+
+static uint8_t SensorsMaxPayload(void)
+{
+  LoRaMacTxInfo_t txInfo = {0};
+
+  /* Same limit as the MAC applies to the current datarate, the pending MAC commands are sent first if needed */
+  LoRaMacQueryTxPossible(0, &txInfo);
+  if ((txInfo.CurrentPossiblePayloadSize == 0) || (txInfo.CurrentPossiblePayloadSize > UPLINK_SCHED_PAYLOAD_SIZE))
   {
-    APP_LOG(ADV_TRACER_TS_ON, ADV_TRACER_VLEVEL_L, "Next Tx in  : ~%d second(s)\r\n", (nextTxIn / 1000));
+    return UPLINK_SCHED_PAYLOAD_SIZE;
   }
+  return txInfo.CurrentPossiblePayloadSize;
 }
 
 static void OnTxTimerEvent(void *context)
@@ -264,6 +337,8 @@ static void OnTxData(LmHandlerTxParams_t *params)
 {
   if ((params != NULL) && (params->IsMcpsConfirm != 0))
   {
+    UPLINK_SCHED_OnTxDone(params->TxTimeOnAir);
+
     APP_LOG(ADV_TRACER_TS_OFF, ADV_TRACER_VLEVEL_M, "\r\n###### ========== MCPS-Confirm =============\r\n");
     APP_LOG(ADV_TRACER_TS_OFF, ADV_TRACER_VLEVEL_H, "###### U/L FRAME:%04d | PORT:%d | DR:%d | PWR:%d", params->UplinkCounter,
             params->AppData.Port, params->Datarate, params->TxPower);
@@ -286,6 +361,7 @@ static void OnJoinRequest(LmHandlerJoinParams_t *joinParams)
   {
     if (joinParams->Status == LORAMAC_HANDLER_SUCCESS)
     {
+      UPLINK_SCHED_OnJoined();
       APP_LOG(ADV_TRACER_TS_OFF, ADV_TRACER_VLEVEL_M, "\r\n###### = JOINED = ");
       if (joinParams->Mode == ACTIVATION_TYPE_ABP)
       {
@@ -308,4 +384,9 @@ static void OnMacProcessNotify(void)
   UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_LmHandlerProcess), CFG_SEQ_Prio_0);
 }
 
+static void OnUplinkSchedProcessNotify(void)
+{
+  UTIL_SEQ_SetTask((1 << CFG_SEQ_Task_UplinkSchedProcess), CFG_SEQ_Prio_0);
+}
+
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -38,6 +38,19 @@
 #define ATCA_HAL_ATECC608A_I2C_WAKEUP_DELAY 3500U
 #define ATCA_HAL_ATECC608A_LONG_TIMEOUT        20    /* Long Timeout 1s */
 
+/* Keep the device awake between the commands of a session, see ATECC608ASeHalSessionBegin */
+#ifndef ATCA_HAL_ATECC608A_SESSION_ENABLE
+#define ATCA_HAL_ATECC608A_SESSION_ENABLE 1
+#endif
+/* Longest time a session keeps the device awake, below the 1.3 s watchdog of the ATECC608A */
+#ifndef ATCA_HAL_ATECC608A_SESSION_MAX_MS
+#define ATCA_HAL_ATECC608A_SESSION_MAX_MS 700U
+#endif
+/* Record the count, bytes and time of the commands, see ATECC608ASeHalGetProfile */
+#ifndef ATCA_HAL_ATECC608A_PROFILE_ENABLE
+#define ATCA_HAL_ATECC608A_PROFILE_ENABLE 0
+#endif
+
 /* \brief How long to wait after an initial wake failure for the POST to
  *         complete.
  * If Power-on self test (POST) is enabled, the self test will run on waking
@@ -30,6 +30,119 @@
 #include "stm32wlxx_hal_dma.h"
 #include "stm32wlxx_hal_i2c.h"
 #include "GNSE_bsp.h"
+#include "atecc608a-tnglora-se-hal.h"
+
+/*!
+ * Session state, see ATECC608ASeHalSessionBegin
+ */
+static struct
+{
+    uint8_t Depth;
+    bool Awake;
+    uint32_t WakeTick;
+    ATCAIface Iface;
+} Session;
+
+#if (ATCA_HAL_ATECC608A_PROFILE_ENABLE == 1)
+static ATECC608ASeHalProfile_t Profile;
+static ATECC608ASeHalCommandProfile_t *ProfileCommand;
+static uint32_t ProfileCommandStart;
+static uint32_t ProfileAwakeStart;
+
+/*!
+ * Cycle counter of the core, the time of an I2C transaction is a few milliseconds
+ */
+static uint32_t ProfileGetCycles(void)
+{
+    if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0)
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+}
+
+static uint32_t ProfileElapsedUs(uint32_t start)
+{
+    return (ProfileGetCycles() - start) / (SystemCoreClock / 1000000U);
+}
+
+static ATECC608ASeHalCommandProfile_t *ProfileGetCommand(uint8_t opcode)
+{
+    for (uint8_t i = 0; i < ATECC608A_SE_HAL_PROFILE_COMMANDS; i++)
+    {
+        if ((Profile.Commands[i].Opcode == opcode) || (Profile.Commands[i].Count == 0))
+        {
+            Profile.Commands[i].Opcode = opcode;
+            return &Profile.Commands[i];
+        }
+    }
+    return &Profile.Commands[ATECC608A_SE_HAL_PROFILE_COMMANDS];
+}
+#endif /* ATCA_HAL_ATECC608A_PROFILE_ENABLE */
+
+/*!
+ * Records the end of the awake time of the device
+ */
+static void SessionAsleep(void)
+{
+#if (ATCA_HAL_ATECC608A_PROFILE_ENABLE == 1)
+    if (Session.Awake == true)
+    {
+        Profile.AwakeTimeUs += ProfileElapsedUs(ProfileAwakeStart);
+    }
+#endif /* ATCA_HAL_ATECC608A_PROFILE_ENABLE */
+    Session.Awake = false;
+}
+
+static void SendIdle(ATCAIface iface)
+{
+    uint8_t buffer[1] = {0x2}; // idle word address value
+    HAL_I2C_Master_Transmit(&GNSE_BSP_sensor_i2c1, (uint16_t)iface->mIfaceCFG->atcai2c.slave_address, buffer, (size_t)1, ATCA_HAL_ATECC608A_LONG_TIMEOUT);
+#if (ATCA_HAL_ATECC608A_PROFILE_ENABLE == 1)
+    Profile.Idles++;
+#endif /* ATCA_HAL_ATECC608A_PROFILE_ENABLE */
+    SessionAsleep();
+}
+
+void ATECC608ASeHalSessionBegin(void)
+{
+#if (ATCA_HAL_ATECC608A_SESSION_ENABLE == 1)
+    Session.Depth++;
+#endif /* ATCA_HAL_ATECC608A_SESSION_ENABLE */
+}
+
+void ATECC608ASeHalSessionEnd(void)
+{
+    if (Session.Depth == 0)
+    {
+        return;
+    }
+    Session.Depth--;
+    if ((Session.Depth == 0) && (Session.Awake == true))
+    {
+        SendIdle(Session.Iface);
+    }
+}
+
+const ATECC608ASeHalProfile_t *ATECC608ASeHalGetProfile(void)
+{
+#if (ATCA_HAL_ATECC608A_PROFILE_ENABLE == 1)
+    return &Profile;
+#else
+    return NULL;
+#endif /* ATCA_HAL_ATECC608A_PROFILE_ENABLE */
+}
+
+void ATECC608ASeHalResetProfile(void)
+{
+#if (ATCA_HAL_ATECC608A_PROFILE_ENABLE == 1)
+    memset(&Profile, 0, sizeof(Profile));
+    ProfileCommand = NULL;
+    ProfileAwakeStart = ProfileGetCycles();
+#endif /* ATCA_HAL_ATECC608A_PROFILE_ENABLE */
+}
 
 uint32_t ATECC608ASeHalGetRandomNumber(void)
 {
@@ -132,6 +245,13 @@ ATCA_STATUS hal_i2c_send(ATCAIface iface, uint8_t word_address, uint8_t *txdata,
 {
     txdata[0] = 0x3;
     txlength++;
+#if (ATCA_HAL_ATECC608A_PROFILE_ENABLE == 1)
+    // txdata is the command packet: word address, count, opcode, parameters, data and CRC
+    ProfileCommand = ProfileGetCommand(txdata[2]);
+    ProfileCommand->Count++;
+    ProfileCommand->TxBytes += txlength;
+    ProfileCommandStart = ProfileGetCycles();
+#endif /* ATCA_HAL_ATECC608A_PROFILE_ENABLE */
     if (HAL_I2C_Master_Transmit(&GNSE_BSP_sensor_i2c1, (uint16_t)iface->mIfaceCFG->atcai2c.slave_address, txdata, (size_t)txlength, ATCA_HAL_ATECC608A_LONG_TIMEOUT) == HAL_OK)
     {
         return ATCA_SUCCESS;
@@ -192,6 +312,15 @@ ATCA_STATUS hal_i2c_receive(ATCAIface iface, uint8_t word_address, uint8_t *rxda
 
     *rxlength = lengthPackage[0];
 
+#if (ATCA_HAL_ATECC608A_PROFILE_ENABLE == 1)
+    if (ProfileCommand != NULL)
+    {
+        ProfileCommand->RxBytes += lengthPackage[0];
+        ProfileCommand->TimeUs += ProfileElapsedUs(ProfileCommandStart);
+        ProfileCommand = NULL;
+    }
+#endif /* ATCA_HAL_ATECC608A_PROFILE_ENABLE */
+
     return ATCA_SUCCESS;
 }
 
@@ -210,6 +339,25 @@ void change_i2c_speed(ATCAIface iface, uint32_t speed)
  */
 ATCA_STATUS hal_i2c_wake(ATCAIface iface)
 {
+    if ((Session.Depth > 0) && (Session.Awake == true))
+    {
+        if ((HAL_GetTick() - Session.WakeTick) < ATCA_HAL_ATECC608A_SESSION_MAX_MS)
+        {
+            // Still awake since the previous command of the session
+#if (ATCA_HAL_ATECC608A_PROFILE_ENABLE == 1)
+            Profile.SessionWakes++;
+#endif /* ATCA_HAL_ATECC608A_PROFILE_ENABLE */
+            return ATCA_SUCCESS;
+        }
+        // Go through idle to restart the watchdog of the device
+        SendIdle(iface);
+    }
+
+#if (ATCA_HAL_ATECC608A_PROFILE_ENABLE == 1)
+    uint32_t wakeStart = ProfileGetCycles();
+    Profile.Wakes++;
+#endif /* ATCA_HAL_ATECC608A_PROFILE_ENABLE */
+
     // 2. Send NULL buffer to address 0x0 (NACK)
     uint8_t emptybuff[1] = {0};
     HAL_StatusTypeDef r = HAL_I2C_Master_Transmit(&GNSE_BSP_sensor_i2c1, 0x00, emptybuff, (size_t)0, ATCA_HAL_ATECC608A_LONG_TIMEOUT);
@@ -231,8 +379,21 @@ ATCA_STATUS hal_i2c_wake(ATCAIface iface)
     const uint8_t expected_response[4] = {0x04, 0x11, 0x33, 0x43};
     uint8_t selftest_fail_resp[4] = {0x04, 0x07, 0xC4, 0x40};
 
+#if (ATCA_HAL_ATECC608A_PROFILE_ENABLE == 1)
+    Profile.WakeTimeUs += ProfileElapsedUs(wakeStart);
+#endif /* ATCA_HAL_ATECC608A_PROFILE_ENABLE */
+
     if (memcmp(rx_buffer, expected_response, 4) == 0)
     {
+#if (ATCA_HAL_ATECC608A_PROFILE_ENABLE == 1)
+        if (Session.Awake == false)
+        {
+            ProfileAwakeStart = wakeStart;
+        }
+#endif /* ATCA_HAL_ATECC608A_PROFILE_ENABLE */
+        Session.Awake = true;
+        Session.WakeTick = HAL_GetTick();
+        Session.Iface = iface;
         return ATCA_SUCCESS;
     }
     if (memcmp(rx_buffer, selftest_fail_resp, 4) == 0)
@@ -248,8 +409,12 @@ ATCA_STATUS hal_i2c_wake(ATCAIface iface)
  */
 ATCA_STATUS hal_i2c_idle(ATCAIface iface)
 {
-    uint8_t buffer[1] = {0x2}; // idle word address value
-    HAL_I2C_Master_Transmit(&GNSE_BSP_sensor_i2c1, (uint16_t)iface->mIfaceCFG->atcai2c.slave_address, buffer, (size_t)1, ATCA_HAL_ATECC608A_LONG_TIMEOUT);
+    if (Session.Depth > 0)
+    {
+        // Stay awake for the next command, ATECC608ASeHalSessionEnd puts the device in idle mode
+        return ATCA_SUCCESS;
+    }
+    SendIdle(iface);
     return ATCA_SUCCESS;
 }
 
@@ -261,6 +426,10 @@ ATCA_STATUS hal_i2c_sleep(ATCAIface iface)
 {
     uint8_t buffer[1] = {0x1}; // sleep word address value
     HAL_I2C_Master_Transmit(&GNSE_BSP_sensor_i2c1, (uint16_t)iface->mIfaceCFG->atcai2c.slave_address, buffer, (size_t)1, ATCA_HAL_ATECC608A_LONG_TIMEOUT);
+#if (ATCA_HAL_ATECC608A_PROFILE_ENABLE == 1)
+    Profile.Sleeps++;
+#endif /* ATCA_HAL_ATECC608A_PROFILE_ENABLE */
+    SessionAsleep();
     return ATCA_SUCCESS;
 }
 
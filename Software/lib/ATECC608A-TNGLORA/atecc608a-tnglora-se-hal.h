@@ -51,6 +51,93 @@ extern "C" {
  */
 uint32_t ATECC608ASeHalGetRandomNumber( void );
 
+/*!
+ * Number of command opcodes recorded separately by the profiler
+ */
+#define ATECC608A_SE_HAL_PROFILE_COMMANDS 8
+
+/*!
+ * Profile of the commands of one opcode
+ */
+typedef struct sATECC608ASeHalCommandProfile
+{
+    /*!
+     * Command opcode, 0 for the commands that did not fit in the table
+     */
+    uint8_t Opcode;
+    /*!
+     * Number of commands
+     */
+    uint32_t Count;
+    /*!
+     * Bytes sent, with the word address
+     */
+    uint32_t TxBytes;
+    /*!
+     * Bytes received
+     */
+    uint32_t RxBytes;
+    /*!
+     * Time from the command transmission to the end of the response [us]
+     */
+    uint32_t TimeUs;
+} ATECC608ASeHalCommandProfile_t;
+
+/*!
+ * Profile of the I2C transactions with the ATECC608A
+ */
+typedef struct sATECC608ASeHalProfile
+{
+    /*!
+     * Commands per opcode, in the order of their first use
+     */
+    ATECC608ASeHalCommandProfile_t Commands[ATECC608A_SE_HAL_PROFILE_COMMANDS + 1];
+    /*!
+     * Wake sequences sent to the device, and the wakes skipped in a session
+     */
+    uint32_t Wakes;
+    uint32_t SessionWakes;
+    /*!
+     * Idle and sleep commands sent to the device
+     */
+    uint32_t Idles;
+    uint32_t Sleeps;
+    /*!
+     * Time spent in the wake sequences [us]
+     */
+    uint32_t WakeTimeUs;
+    /*!
+     * Time the device was awake, from the wake sequence to the idle or sleep command [us]
+     */
+    uint32_t AwakeTimeUs;
+} ATECC608ASeHalProfile_t;
+
+/*!
+ * \brief Starts a session, the device stays awake until the matching ATECC608ASeHalSessionEnd
+ *
+ * \remark Sessions can be nested. The device is put in idle mode when the outer session ends, and
+ *         when a session lasts ATCA_HAL_ATECC608A_SESSION_MAX_MS, before the watchdog puts it to sleep.
+ */
+void ATECC608ASeHalSessionBegin( void );
+
+/*!
+ * \brief Ends a session started with ATECC608ASeHalSessionBegin
+ */
+void ATECC608ASeHalSessionEnd( void );
+
+/*!
+ * \brief Get the profile of the I2C transactions since the last reset
+ *
+ * \remark Only recorded when ATCA_HAL_ATECC608A_PROFILE_ENABLE is set
+ * \retval profile Profile of the I2C transactions
+ */
+const ATECC608ASeHalProfile_t* ATECC608ASeHalGetProfile( void );
+
+/*!
+ * \brief Clear the profile of the I2C transactions
+ */
+void ATECC608ASeHalResetProfile( void );
+
 #ifdef __cplusplus
 }
 #endif
@@ -271,6 +271,9 @@ static SecureElementStatus_t ComputeCmac( uint8_t* micBxBuffer, uint8_t* buffer,
         return retval;
     }
 
+    // One AES command per block, without a wake up in between
+    ATECC608ASeHalSessionBegin( );
+
     atca_aes_cmac_ctx_t atcaAesCmacCtx;
     ATCA_STATUS         status =
         atcab_aes_cmac_init( &atcaAesCmacCtx, keyItem->KeySlotNumber, keyItem->KeyBlockIndex );
@@ -285,6 +288,7 @@ static SecureElementStatus_t ComputeCmac( uint8_t* micBxBuffer, uint8_t* buffer,
         atcab_aes_cmac_update( &atcaAesCmacCtx, buffer, size );
 
         atcab_aes_cmac_finish( &atcaAesCmacCtx, Cmac, 16 );
+        ATECC608ASeHalSessionEnd( );
 
         *cmac = ( uint32_t )( ( uint32_t ) Cmac[3] << 24 | ( uint32_t ) Cmac[2] << 16 | ( uint32_t ) Cmac[1] << 8 |
                               ( uint32_t ) Cmac[0] );
@@ -292,6 +296,7 @@ static SecureElementStatus_t ComputeCmac( uint8_t* micBxBuffer, uint8_t* buffer,
     }
     else
     {
+        ATECC608ASeHalSessionEnd( );
         return SECURE_ELEMENT_ERROR;
     }
 }
@@ -420,12 +425,14 @@ SecureElementStatus_t SecureElementAesEncrypt( uint8_t* buffer, uint16_t size, K
     {
         uint8_t block = 0;
 
+        ATECC608ASeHalSessionBegin( );
         while( size != 0 )
         {
             atcab_aes_encrypt( pItem->KeySlotNumber, pItem->KeyBlockIndex, &buffer[block], &encBuffer[block] );
             block = block + 16;
             size  = size - 16;
         }
+        ATECC608ASeHalSessionEnd( );
     }
     return retval;
 }
@@ -486,6 +493,69 @@ SecureElementStatus_t SecureElementDeriveAndStoreKey( Version_t version, uint8_t
     }
 }
 
+SecureElementStatus_t SecureElementDeriveAndStoreKeys( Version_t version, KeyIdentifier_t rootKeyID,
+                                                       SecureElementDerivation_t* derivations, uint8_t nbDerivations )
+{
+    if( derivations == NULL )
+    {
+        return SECURE_ELEMENT_ERROR_NPE;
+    }
+
+    Key_t*      source_key;
+    Key_t*      target_key;
+    ATCA_STATUS status = ATCA_SUCCESS;
+
+    for( uint8_t i = 0; i < nbDerivations; i++ )
+    {
+        // In case of MC_KE_KEY, only McRootKey can be used as root key
+        if( ( derivations[i].TargetKeyID == MC_KE_KEY ) && ( rootKeyID != MC_ROOT_KEY ) )
+        {
+            return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
+        }
+    }
+
+    if( ( rootKeyID == APP_KEY ) || ( rootKeyID == MC_ROOT_KEY ) || ( rootKeyID == MC_KE_KEY ) )
+    {
+        // Allow the stack to move forward as these rootkeys dont exist inside SE.
+        return SECURE_ELEMENT_SUCCESS;
+    }
+
+    if( GetKeyByID( rootKeyID, &source_key ) != SECURE_ELEMENT_SUCCESS )
+    {
+        return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
+    }
+
+    // Check all the target keys before the first KDF command, the commands then follow each other on the bus
+    for( uint8_t i = 0; i < nbDerivations; i++ )
+    {
+        if( GetKeyByID( derivations[i].TargetKeyID, &target_key ) != SECURE_ELEMENT_SUCCESS )
+        {
+            return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
+        }
+    }
+
+    ATECC608ASeHalSessionBegin( );
+    for( uint8_t i = 0; ( i < nbDerivations ) && ( status == ATCA_SUCCESS ); i++ )
+    {
+        GetKeyByID( derivations[i].TargetKeyID, &target_key );
+
+        // Source key slot is the LSB and target key slot is the MSB
+        status = atcab_kdf( KDF_MODE_ALG_AES | KDF_MODE_SOURCE_SLOT | KDF_MODE_TARGET_SLOT,
+                            ( target_key->KeySlotNumber << 8 ) + source_key->KeySlotNumber, source_key->KeyBlockIndex,
+                            derivations[i].Input, NULL, NULL );
+    }
+    ATECC608ASeHalSessionEnd( );
+
+    if( status == ATCA_SUCCESS )
+    {
+        return SECURE_ELEMENT_SUCCESS;
+    }
+    else
+    {
+        return SECURE_ELEMENT_ERROR;
+    }
+}
+
 SecureElementStatus_t SecureElementProcessJoinAccept( JoinReqIdentifier_t joinReqType, uint8_t* joinEui,
                                                       uint16_t devNonce, uint8_t* encJoinAccept,
                                                       uint8_t encJoinAcceptSize, uint8_t* decJoinAccept,
@@ -597,6 +667,16 @@ SecureElementStatus_t SecureElementRandomNumber( uint32_t* randomNum )
     return SECURE_ELEMENT_SUCCESS;
 }
 
+void SecureElementBeginSession( void )
+{
+    ATECC608ASeHalSessionBegin( );
+}
+
+void SecureElementEndSession( void )
+{
+    ATECC608ASeHalSessionEnd( );
+}
+
 SecureElementStatus_t SecureElementSetDevEui( uint8_t* devEui )
 {
     if( devEui == NULL )
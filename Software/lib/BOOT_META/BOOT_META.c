@@ -0,0 +1,283 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file BOOT_META.c
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include <stddef.h>
+#include "BOOT_META.h"
+#include "stm32_crc.h"
+
+_Static_assert(sizeof(BOOT_META_Record_t) == BOOT_META_RECORD_SIZE, "BOOT_META_Record_t does not match BOOT_META_RECORD_SIZE");
+
+/**
+ * Most recent valid record and index of the first free record
+ */
+static BOOT_META_Record_t Latest;
+static bool LatestValid = false;
+static uint32_t LatestIndex = 0;
+static uint32_t NextRecord = 0;
+
+static bool Initialized = false;
+
+static uint32_t BOOT_META_Check(const BOOT_META_Record_t *record)
+{
+  return UTIL_CRC32_Update(UTIL_CRC32_INIT, record, offsetof(BOOT_META_Record_t, Check));
+}
+
+/**
+ * @brief Scans the metadata area for the most recent record
+ * @return BOOT_META_op_result_t
+ */
+BOOT_META_op_result_t BOOT_META_Init(void)
+{
+  BOOT_META_Record_t record;
+
+  LatestValid = false;
+  LatestIndex = 0;
+  NextRecord = BOOT_META_RECORD_COUNT;
+
+  for (uint32_t index = 0; index < BOOT_META_RECORD_COUNT; index++)
+  {
+    if (BOOT_META_Driver.Read(index * BOOT_META_RECORD_SIZE, (uint8_t *)&record, sizeof(record)) != BOOT_META_OP_SUCCESS)
+    {
+      return BOOT_META_OP_FAIL;
+    }
+    if (record.Magic == 0xFFFFFFFFU)
+    {
+      NextRecord = index;
+      break;
+    }
+    /* A record interrupted while written fails its check and is skipped */
+    if ((record.Magic == BOOT_META_MAGIC) && (record.Check == BOOT_META_Check(&record)))
+    {
+      Latest = record;
+      LatestValid = true;
+      LatestIndex = index;
+    }
+  }
+
+  Initialized = true;
+  return BOOT_META_OP_SUCCESS;
+}
+
+/**
+ * @brief Gets the record of the application in the active slot
+ * @param record copy of the most recent record
+ * @return BOOT_META_OP_EMPTY if no application was ever recorded
+ */
+BOOT_META_op_result_t BOOT_META_Get(BOOT_META_Record_t *record)
+{
+  if (record == NULL)
+  {
+    return BOOT_META_OP_FAIL;
+  }
+  if ((Initialized == false) && (BOOT_META_Init() != BOOT_META_OP_SUCCESS))
+  {
+    return BOOT_META_OP_FAIL;
+  }
+  if (LatestValid == false)
+  {
+    return BOOT_META_OP_EMPTY;
+  }
+  *record = Latest;
+  return BOOT_META_OP_SUCCESS;
+}
+
+/**
+ * @brief Records a new application in the active slot
+ * @note Magic and Check are filled in, Trials and Confirmed are written as given, the new record has no overrun
+ * @param record record to append
+ * @return BOOT_META_op_result_t
+ */
+BOOT_META_op_result_t BOOT_META_Append(BOOT_META_Record_t *record)
+{
+  BOOT_META_Record_t readback;
+
+  if (record == NULL)
+  {
+    return BOOT_META_OP_FAIL;
+  }
+  if ((Initialized == false) && (BOOT_META_Init() != BOOT_META_OP_SUCCESS))
+  {
+    return BOOT_META_OP_FAIL;
+  }
+
+  record->Magic = BOOT_META_MAGIC;
+  record->Check = BOOT_META_Check(record);
+  record->Overruns = 0xFFFFFFFFU;
+  for (uint32_t i = 0; i < (sizeof(record->Reserved) / sizeof(record->Reserved[0])); i++)
+  {
+    record->Reserved[i] = 0xFFFFFFFFU;
+  }
+
+  if (NextRecord >= BOOT_META_RECORD_COUNT)
+  {
+    /* Area full, the record is lost if the power fails before it is written again */
+    if (BOOT_META_Driver.Erase() != BOOT_META_OP_SUCCESS)
+    {
+      return BOOT_META_OP_FAIL;
+    }
+    NextRecord = 0;
+  }
+
+  /* A failed write may leave a partially programmed record behind, never reuse it */
+  LatestValid = false;
+  if ((BOOT_META_Driver.Write(NextRecord * BOOT_META_RECORD_SIZE, (const uint8_t *)record, sizeof(*record)) != BOOT_META_OP_SUCCESS) ||
+      (BOOT_META_Driver.Read(NextRecord * BOOT_META_RECORD_SIZE, (uint8_t *)&readback, sizeof(readback)) != BOOT_META_OP_SUCCESS) ||
+      (readback.Magic != BOOT_META_MAGIC) || (readback.Check != BOOT_META_Check(&readback)))
+  {
+    NextRecord++;
+    return BOOT_META_OP_FAIL;
+  }
+
+  Latest = readback;
+  LatestValid = true;
+  LatestIndex = NextRecord++;
+  return BOOT_META_OP_SUCCESS;
+}
+
+/**
+ * @brief Counts the boots of an unconfirmed application, or the boots over the time budget
+ * @param trials Trials or Overruns word of a record
+ * @return number of cleared bits from the LSB
+ */
+uint8_t BOOT_META_TrialCount(uint32_t trials)
+{
+  uint8_t count = 0;
+
+  while ((count < 32U) && ((trials & (1UL << count)) == 0U))
+  {
+    count++;
+  }
+  return count;
+}
+
+/**
+ * @brief Uses one boot of the unconfirmed application in the active slot
+ * @return BOOT_META_op_result_t
+ */
+BOOT_META_op_result_t BOOT_META_UseTrial(void)
+{
+  uint32_t trials;
+
+  if ((Initialized == false) && (BOOT_META_Init() != BOOT_META_OP_SUCCESS))
+  {
+    return BOOT_META_OP_FAIL;
+  }
+  if (LatestValid == false)
+  {
+    return BOOT_META_OP_EMPTY;
+  }
+
+  trials = Latest.Trials << 1;
+  if (BOOT_META_Driver.Write((LatestIndex * BOOT_META_RECORD_SIZE) + offsetof(BOOT_META_Record_t, Trials),
+                             (const uint8_t *)&trials, sizeof(trials)) != BOOT_META_OP_SUCCESS)
+  {
+    return BOOT_META_OP_FAIL;
+  }
+  Latest.Trials = trials;
+  return BOOT_META_OP_SUCCESS;
+}
+
+/**
+ * @brief Confirms the application in the active slot works, to be called by the application
+ * @note Once confirmed, the application is kept and becomes the backup of the next update
+ * @return BOOT_META_OP_EMPTY if the application was not installed by the bootloader
+ */
+BOOT_META_op_result_t BOOT_META_Confirm(void)
+{
+  uint32_t confirmed = BOOT_META_CONFIRMED;
+
+  if ((Initialized == false) && (BOOT_META_Init() != BOOT_META_OP_SUCCESS))
+  {
+    return BOOT_META_OP_FAIL;
+  }
+  if (LatestValid == false)
+  {
+    return BOOT_META_OP_EMPTY;
+  }
+  if (Latest.Confirmed == BOOT_META_CONFIRMED)
+  {
+    return BOOT_META_OP_SUCCESS;
+  }
+
+  if (BOOT_META_Driver.Write((LatestIndex * BOOT_META_RECORD_SIZE) + offsetof(BOOT_META_Record_t, Confirmed),
+                             (const uint8_t *)&confirmed, sizeof(confirmed)) != BOOT_META_OP_SUCCESS)
+  {
+    return BOOT_META_OP_FAIL;
+  }
+  Latest.Confirmed = confirmed;
+  return BOOT_META_OP_SUCCESS;
+}
+
+/**
+ * @brief Counts one more boot of the application in the active slot over the time budget of the bootloader
+ * @note The count stops at 32
+ * @return BOOT_META_op_result_t
+ */
+BOOT_META_op_result_t BOOT_META_RecordOverrun(void)
+{
+  uint32_t overruns;
+
+  if ((Initialized == false) && (BOOT_META_Init() != BOOT_META_OP_SUCCESS))
+  {
+    return BOOT_META_OP_FAIL;
+  }
+  if (LatestValid == false)
+  {
+    return BOOT_META_OP_EMPTY;
+  }
+
+  overruns = Latest.Overruns << 1;
+  if (BOOT_META_Driver.Write((LatestIndex * BOOT_META_RECORD_SIZE) + offsetof(BOOT_META_Record_t, Overruns),
+                             (const uint8_t *)&overruns, sizeof(overruns)) != BOOT_META_OP_SUCCESS)
+  {
+    return BOOT_META_OP_FAIL;
+  }
+  Latest.Overruns = overruns;
+  return BOOT_META_OP_SUCCESS;
+}
+
+/**
+ * @brief Decides what to boot, without any flash access
+ * @param record record of the active slot, NULL if there is none
+ * @param image_valid whether the active slot matches the size and CRC-32 of the record
+ * @return BOOT_META_action_t
+ */
+BOOT_META_action_t BOOT_META_SelectAction(const BOOT_META_Record_t *record, bool image_valid)
+{
+  if (record == NULL)
+  {
+    return BOOT_META_ADOPT;
+  }
+  if (image_valid == false)
+  {
+    return BOOT_META_ROLLBACK;
+  }
+  if (record->Confirmed == BOOT_META_CONFIRMED)
+  {
+    return BOOT_META_BOOT;
+  }
+  if (BOOT_META_TrialCount(record->Trials) >= BOOT_META_MAX_TRIALS)
+  {
+    return BOOT_META_ROLLBACK;
+  }
+  return BOOT_META_BOOT_TRIAL;
+}
@@ -0,0 +1,129 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file BOOT_META.h
+ *
+ * @brief Boot metadata of the application slots
+ *
+ * The applications are linked for the single APPROM area, so the two slots are:
+ * - the active slot, APPROM in the MCU flash, from which the application runs
+ * - the backup slot, in the external flash, holding the last confirmed application
+ *
+ * Every time an application is programmed in the active slot, a record with its version, size and CRC-32
+ * and with the content of the backup slot is appended to the metadata area of the external flash.
+ * A new application has BOOT_META_MAX_TRIALS boots to call BOOT_META_Confirm(), otherwise the bootloader
+ * restores the backup slot, just like when the active slot fails its CRC check.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#ifndef BOOT_META_H
+#define BOOT_META_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Number of boots an unconfirmed application gets before it is rolled back
+ */
+#ifndef BOOT_META_MAX_TRIALS
+#define BOOT_META_MAX_TRIALS 3U
+#endif
+
+/**
+ * External flash layout, right below the FUOTA_IMAGE areas
+ */
+#define BOOT_META_ADDRESS 0x130000U        /* Metadata records, one 64 KByte block */
+#define BOOT_META_AREA_SIZE 0x10000U
+#define BOOT_META_BACKUP_ADDRESS 0x140000U /* Backup slot */
+#define BOOT_META_BACKUP_SIZE 0x40000U
+#define BOOT_META_BLOCK_SIZE 0x10000U
+
+#define BOOT_META_RECORD_SIZE 64U
+#define BOOT_META_RECORD_COUNT (BOOT_META_AREA_SIZE / BOOT_META_RECORD_SIZE)
+
+#define BOOT_META_MAGIC 0x4154454DU /* "META" */
+#define BOOT_META_CONFIRMED 0x55AA55AAU
+#define BOOT_META_TRIALS_NONE 0xFFFFFFFFU
+
+typedef enum
+{
+  BOOT_META_OP_SUCCESS = 0,
+  BOOT_META_OP_FAIL = 1,
+  BOOT_META_OP_EMPTY = 2,
+} BOOT_META_op_result_t;
+
+/**
+ * Slot record, the words up to Check are written once, Trials, Confirmed and Overruns are only ever cleared further
+ */
+typedef struct
+{
+  uint32_t Magic;
+  uint32_t Version;
+  uint32_t Size;
+  uint32_t Crc;
+  uint32_t BackupVersion;
+  uint32_t BackupSize;  /* 0 if the backup slot holds no usable application */
+  uint32_t BackupCrc;
+  uint32_t Check;       /* CRC-32 of the words above */
+  uint32_t Trials;      /* One bit cleared from the LSB per unconfirmed boot */
+  uint32_t Confirmed;   /* BOOT_META_CONFIRMED once the application confirmed it works */
+  uint32_t Overruns;    /* One bit cleared from the LSB per boot over the time budget of the bootloader */
+  uint32_t Reserved[5];
+} BOOT_META_Record_t;
+
+/**
+ * Decision taken by the bootloader for the active slot
+ */
+typedef enum
+{
+  BOOT_META_BOOT = 0,         /* Verified and confirmed application */
+  BOOT_META_BOOT_TRIAL,       /* Verified application waiting for confirmation, one trial is used */
+  BOOT_META_ROLLBACK,         /* Corrupt application or out of trials, restore the backup slot */
+  BOOT_META_ADOPT,            /* No record, e.g. flashed with a debugger, record the application as confirmed */
+} BOOT_META_action_t;
+
+/**
+ * Storage driver of the metadata area, offsets are relative to BOOT_META_ADDRESS
+ */
+typedef struct
+{
+  BOOT_META_op_result_t (*Read)(uint32_t offset, uint8_t *buffer, uint32_t length);
+  BOOT_META_op_result_t (*Write)(uint32_t offset, const uint8_t *buffer, uint32_t length);
+  BOOT_META_op_result_t (*Erase)(void);
+} BOOT_META_Driver_t;
+
+extern const BOOT_META_Driver_t BOOT_META_Driver;
+
+BOOT_META_op_result_t BOOT_META_Init(void);
+BOOT_META_op_result_t BOOT_META_Get(BOOT_META_Record_t *record);
+BOOT_META_op_result_t BOOT_META_Append(BOOT_META_Record_t *record);
+BOOT_META_op_result_t BOOT_META_UseTrial(void);
+BOOT_META_op_result_t BOOT_META_Confirm(void);
+BOOT_META_op_result_t BOOT_META_RecordOverrun(void);
+BOOT_META_action_t BOOT_META_SelectAction(const BOOT_META_Record_t *record, bool image_valid);
+uint8_t BOOT_META_TrialCount(uint32_t trials);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BOOT_META_H */
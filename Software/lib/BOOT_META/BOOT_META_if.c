@@ -0,0 +1,63 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file BOOT_META_if.c
+ *
+ * @brief Boot metadata driver using the external flash
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include "BOOT_META.h"
+#include "GNSE_flash.h"
+
+static BOOT_META_op_result_t BOOT_META_Read(uint32_t offset, uint8_t *buffer, uint32_t length)
+{
+  if (GNSE_Flash_Read(BOOT_META_ADDRESS + offset, length, buffer) != FLASH_OP_SUCCESS)
+  {
+    return BOOT_META_OP_FAIL;
+  }
+  return BOOT_META_OP_SUCCESS;
+}
+
+static BOOT_META_op_result_t BOOT_META_Write(uint32_t offset, const uint8_t *buffer, uint32_t length)
+{
+  if (GNSE_Flash_Write(BOOT_META_ADDRESS + offset, length, (uint8_t *)buffer) != FLASH_OP_SUCCESS)
+  {
+    return BOOT_META_OP_FAIL;
+  }
+  return BOOT_META_OP_SUCCESS;
+}
+
+static BOOT_META_op_result_t BOOT_META_Erase(void)
+{
+  if (GNSE_Flash_BlockErase(BOOT_META_ADDRESS, BOOT_META_AREA_SIZE / BOOT_META_BLOCK_SIZE) != FLASH_OP_SUCCESS)
+  {
+    return BOOT_META_OP_FAIL;
+  }
+  return BOOT_META_OP_SUCCESS;
+}
+
+/**
+  * @brief Boot metadata driver callbacks handler
+  */
+const BOOT_META_Driver_t BOOT_META_Driver =
+{
+  BOOT_META_Read,
+  BOOT_META_Write,
+  BOOT_META_Erase,
+};
@@ -0,0 +1,261 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file FCNT_STORE.c
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "FCNT_STORE.h"
+
+/**
+ * XOR pattern of the backup register check value, a reset backup domain (all zero) is never valid
+ */
+#define FCNT_STORE_BKUP_MAGIC 0xA5C3F00FU
+
+/**
+ * A slot holds the reserved frame counter in the lower word and its complement in the upper word
+ */
+#define FCNT_STORE_SLOT(value) (((uint64_t)(~(value)) << 32) | (uint64_t)(value))
+#define FCNT_STORE_SLOT_VALUE(slot) ((uint32_t)(slot))
+#define FCNT_STORE_SLOT_IS_VALID(slot) ((uint32_t)((slot) >> 32) == (uint32_t)(~(uint32_t)(slot)))
+#define FCNT_STORE_SLOT_EMPTY UINT64_MAX
+
+/**
+ * Upper bound of all frame counters that may have been used, as persisted in flash
+ */
+static uint32_t Reserved = 0;
+
+/**
+ * Page holding the most recent slot and index of its first free slot
+ */
+static uint32_t ActivePage = 0;
+static uint32_t NextSlot = 0;
+
+/**
+ * Last frame counter written to the backup registers
+ */
+static uint32_t LastBkUp = 0;
+
+/**
+ * Lowest frame counter that was never used
+ */
+static uint32_t Next = 0;
+
+/**
+ * Next - 1 was recorded since the initialization, the MAC may record it again when its uplink could not be sent
+ */
+static bool Recorded = false;
+
+static bool Initialized = false;
+
+/**
+ * @brief Appends a slot to the flash pages, switching to the next page when the active one is full
+ * @note The full page is only erased after it stopped being the newest one,
+ *       so at any time the previous reservation is still present in flash
+ * @param value reserved frame counter to persist
+ * @return FCNT_STORE_op_result_t
+ */
+static FCNT_STORE_op_result_t FCNT_STORE_Append(uint32_t value)
+{
+  uint8_t attempts = 2;
+
+  while (attempts-- > 0)
+  {
+    if (NextSlot >= FCNT_STORE_SLOTS_PER_PAGE)
+    {
+      uint32_t page = (ActivePage + 1) % FCNT_STORE_PAGE_COUNT;
+      if (FCNT_STORE_Driver.PageErase(page) != FCNT_STORE_OP_SUCCESS)
+      {
+        return FCNT_STORE_OP_FAIL;
+      }
+      ActivePage = page;
+      NextSlot = 0;
+    }
+    /* A failed write may leave a partially programmed slot behind, never reuse it */
+    if (FCNT_STORE_Driver.SlotWrite(ActivePage, NextSlot++, FCNT_STORE_SLOT(value)) == FCNT_STORE_OP_SUCCESS)
+    {
+      return FCNT_STORE_OP_SUCCESS;
+    }
+  }
+  return FCNT_STORE_OP_FAIL;
+}
+
+/**
+ * @brief Checks that a page is fully erased
+ * @param page page index
+ * @return true if all the slots of the page are empty
+ */
+static bool FCNT_STORE_PageIsBlank(uint32_t page)
+{
+  uint64_t data;
+
+  for (uint32_t slot = 0; slot < FCNT_STORE_SLOTS_PER_PAGE; slot++)
+  {
+    if ((FCNT_STORE_Driver.SlotRead(page, slot, &data) != FCNT_STORE_OP_SUCCESS) || (data != FCNT_STORE_SLOT_EMPTY))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Scans the flash pages for the most recent reservation and the backup registers for the exact frame counter
+ * @note A slot is only valid once fully programmed: an interrupted program only clears bits and an interrupted
+ *       erase only sets bits, neither can turn a slot into a valid one of another value
+ * @return FCNT_STORE_op_result_t
+ */
+FCNT_STORE_op_result_t FCNT_STORE_Init(void)
+{
+  uint64_t data;
+  uint32_t bkup_fcnt;
+  uint32_t bkup_check;
+  bool found = false;
+
+  Reserved = 0;
+  ActivePage = 0;
+  NextSlot = 0;
+  LastBkUp = 0;
+  Next = 0;
+  Recorded = false;
+  Initialized = false;
+
+  for (uint32_t page = 0; page < FCNT_STORE_PAGE_COUNT; page++)
+  {
+    uint32_t slot;
+    for (slot = 0; slot < FCNT_STORE_SLOTS_PER_PAGE; slot++)
+    {
+      if (FCNT_STORE_Driver.SlotRead(page, slot, &data) != FCNT_STORE_OP_SUCCESS)
+      {
+        /* Unreadable slot, treat it as used but invalid */
+        continue;
+      }
+      if (data == FCNT_STORE_SLOT_EMPTY)
+      {
+        break;
+      }
+      if (FCNT_STORE_SLOT_IS_VALID(data) && ((found == false) || (FCNT_STORE_SLOT_VALUE(data) >= Reserved)))
+      {
+        found = true;
+        Reserved = FCNT_STORE_SLOT_VALUE(data);
+        ActivePage = page;
+      }
+    }
+    if (found && (ActivePage == page))
+    {
+      NextSlot = slot;
+    }
+  }
+
+  /* Nothing was ever reserved, the first slot is written in page 0 which may hold anything but erased slots */
+  if ((found == false) && (FCNT_STORE_PageIsBlank(0) == false))
+  {
+    if (FCNT_STORE_Driver.PageErase(0) != FCNT_STORE_OP_SUCCESS)
+    {
+      return FCNT_STORE_OP_FAIL;
+    }
+  }
+
+  /* The backup registers are written before every uplink, they are exact after a warm reset */
+  FCNT_STORE_Driver.BkUpRead(&bkup_fcnt, &bkup_check);
+  if ((bkup_fcnt != 0) && (bkup_check == (bkup_fcnt ^ FCNT_STORE_BKUP_MAGIC)))
+  {
+    LastBkUp = bkup_fcnt;
+    Next = bkup_fcnt;
+  }
+  else
+  {
+    Next = Reserved;
+  }
+
+  Initialized = true;
+  return FCNT_STORE_OP_SUCCESS;
+}
+
+/**
+ * @brief Gets the frame counter to use for the next uplink
+ * @param next_fcnt exact frame counter after a warm reset, reserved upper bound after a cold reset
+ * @return FCNT_STORE_OP_EMPTY if no frame counter was ever persisted
+ */
+FCNT_STORE_op_result_t FCNT_STORE_Restore(uint32_t *next_fcnt)
+{
+  if (next_fcnt == NULL)
+  {
+    return FCNT_STORE_OP_FAIL;
+  }
+  if ((Initialized == false) && (FCNT_STORE_Init() != FCNT_STORE_OP_SUCCESS))
+  {
+    return FCNT_STORE_OP_FAIL;
+  }
+
+  if (Next == 0)
+  {
+    return FCNT_STORE_OP_EMPTY;
+  }
+  *next_fcnt = Next;
+  return FCNT_STORE_OP_SUCCESS;
+}
+
+/**
+ * @brief Records the frame counter of the uplink about to be sent
+ * @note Must be called before the uplink is transmitted, a flash write is only done
+ *       once the frame counter reaches the reserved upper bound. The last frame counter recorded since the
+ *       initialization is accepted again without any write: the MAC keeps it when securing or sending its uplink
+ *       failed, and moves past it once the uplink is sent.
+ * @param fcnt frame counter in use
+ * @return FCNT_STORE_OP_FAIL if the frame counter may have been used before or could not be persisted,
+ *         the uplink must not be sent
+ */
+FCNT_STORE_op_result_t FCNT_STORE_Update(uint32_t fcnt)
+{
+  uint32_t next_fcnt = (fcnt == UINT32_MAX) ? UINT32_MAX : fcnt + 1;
+
+  if ((Initialized == false) && (FCNT_STORE_Init() != FCNT_STORE_OP_SUCCESS))
+  {
+    return FCNT_STORE_OP_FAIL;
+  }
+  if (Recorded && (fcnt + 1U == Next))
+  {
+    return FCNT_STORE_OP_SUCCESS;
+  }
+  if (fcnt < Next)
+  {
+    return FCNT_STORE_OP_FAIL;
+  }
+
+  if (next_fcnt != LastBkUp)
+  {
+    FCNT_STORE_Driver.BkUpWrite(next_fcnt, next_fcnt ^ FCNT_STORE_BKUP_MAGIC);
+    LastBkUp = next_fcnt;
+  }
+
+  if (fcnt >= Reserved)
+  {
+    uint32_t reserve = (fcnt > (UINT32_MAX - FCNT_STORE_RESERVE_SIZE)) ? UINT32_MAX : fcnt + FCNT_STORE_RESERVE_SIZE;
+    if (FCNT_STORE_Append(reserve) != FCNT_STORE_OP_SUCCESS)
+    {
+      return FCNT_STORE_OP_FAIL;
+    }
+    Reserved = reserve;
+  }
+  Next = next_fcnt;
+  Recorded = true;
+  return FCNT_STORE_OP_SUCCESS;
+}
@@ -0,0 +1,94 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file FCNT_STORE.h
+ *
+ * @brief Uplink frame counter persistence
+ *
+ * The uplink frame counter is persisted in two places:
+ * - RTC backup registers, written on every uplink, to resume exactly after a warm reset
+ * - Append-only slots in dedicated MCU flash pages, written once every FCNT_STORE_RESERVE_SIZE uplinks,
+ *   holding an upper bound of all frame counters that may have been used so far
+ *
+ * After a cold reset the frame counter skips forward to the persisted upper bound,
+ * so a frame counter value is never used twice.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#ifndef FCNT_STORE_H
+#define FCNT_STORE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Number of frame counters reserved with each flash write
+ * @note A cold reset skips at most this many frame counters
+ */
+#ifndef FCNT_STORE_RESERVE_SIZE
+#define FCNT_STORE_RESERVE_SIZE 64U
+#endif
+
+/**
+ * Number of flash pages used in turns to store the frame counter slots
+ */
+#define FCNT_STORE_PAGE_COUNT 2U
+
+/**
+ * Size of a frame counter slot in bytes, a slot is programmed as a single double-word
+ */
+#define FCNT_STORE_SLOT_SIZE 8U
+
+/**
+ * Number of frame counter slots in a flash page
+ */
+#define FCNT_STORE_SLOTS_PER_PAGE 256U
+
+typedef enum
+{
+  FCNT_STORE_OP_SUCCESS = 0,
+  FCNT_STORE_OP_FAIL = 1,
+  FCNT_STORE_OP_EMPTY = 2,
+} FCNT_STORE_op_result_t;
+
+/**
+ * Storage driver used by the frame counter store
+ */
+typedef struct
+{
+  FCNT_STORE_op_result_t (*SlotRead)(uint32_t page, uint32_t slot, uint64_t *data);
+  FCNT_STORE_op_result_t (*SlotWrite)(uint32_t page, uint32_t slot, uint64_t data);
+  FCNT_STORE_op_result_t (*PageErase)(uint32_t page);
+  void (*BkUpWrite)(uint32_t fcnt, uint32_t check);
+  void (*BkUpRead)(uint32_t *fcnt, uint32_t *check);
+} FCNT_STORE_Driver_t;
+
+extern const FCNT_STORE_Driver_t FCNT_STORE_Driver;
+
+FCNT_STORE_op_result_t FCNT_STORE_Init(void);
+FCNT_STORE_op_result_t FCNT_STORE_Restore(uint32_t *next_fcnt);
+FCNT_STORE_op_result_t FCNT_STORE_Update(uint32_t fcnt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FCNT_STORE_H */
@@ -0,0 +1,94 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file FCNT_STORE_if.c
+ *
+ * @brief Frame counter store driver using the RTC backup registers and the NVMROM flash pages
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include "FCNT_STORE.h"
+#include "MCU_FLASH.h"
+#include "GNSE_rtc.h"
+
+extern uint32_t __NVMROM_START__;
+
+/**
+ * Start address of the frame counter pages, see NVMROM in the linker scripts
+ */
+#define FCNT_STORE_FLASH_ADDRESS (uint32_t)(&(__NVMROM_START__))
+
+#if ((FCNT_STORE_SLOTS_PER_PAGE * FCNT_STORE_SLOT_SIZE) != FLASH_PAGE_SIZE)
+#error "FCNT_STORE_SLOTS_PER_PAGE does not match the MCU flash page size"
+#endif
+
+static inline uint32_t FCNT_STORE_SlotAddress(uint32_t page, uint32_t slot)
+{
+  return FCNT_STORE_FLASH_ADDRESS + (page * FLASH_PAGE_SIZE) + (slot * FCNT_STORE_SLOT_SIZE);
+}
+
+static FCNT_STORE_op_result_t FCNT_STORE_SlotRead(uint32_t page, uint32_t slot, uint64_t *data)
+{
+  if (MCU_FLASH_Read(data, (const void *)FCNT_STORE_SlotAddress(page, slot), FCNT_STORE_SLOT_SIZE) != HAL_OK)
+  {
+    return FCNT_STORE_OP_FAIL;
+  }
+  return FCNT_STORE_OP_SUCCESS;
+}
+
+static FCNT_STORE_op_result_t FCNT_STORE_SlotWrite(uint32_t page, uint32_t slot, uint64_t data)
+{
+  if (MCU_FLASH_Write(FCNT_STORE_SlotAddress(page, slot), (uint8_t *)&data, FCNT_STORE_SLOT_SIZE) != HAL_OK)
+  {
+    return FCNT_STORE_OP_FAIL;
+  }
+  return FCNT_STORE_OP_SUCCESS;
+}
+
+static FCNT_STORE_op_result_t FCNT_STORE_PageErase(uint32_t page)
+{
+  if (MCU_FLASH_Erase((void *)FCNT_STORE_SlotAddress(page, 0), FLASH_PAGE_SIZE) != HAL_OK)
+  {
+    return FCNT_STORE_OP_FAIL;
+  }
+  return FCNT_STORE_OP_SUCCESS;
+}
+
+static void FCNT_STORE_BkUpWrite(uint32_t fcnt, uint32_t check)
+{
+  GNSE_RTC_BkUp_Write_FCnt(fcnt);
+  GNSE_RTC_BkUp_Write_FCntCheck(check);
+}
+
+static void FCNT_STORE_BkUpRead(uint32_t *fcnt, uint32_t *check)
+{
+  *fcnt = GNSE_RTC_BkUp_Read_FCnt();
+  *check = GNSE_RTC_BkUp_Read_FCntCheck();
+}
+
+/**
+  * @brief Frame counter store driver callbacks handler
+  */
+const FCNT_STORE_Driver_t FCNT_STORE_Driver =
+{
+  FCNT_STORE_SlotRead,
+  FCNT_STORE_SlotWrite,
+  FCNT_STORE_PageErase,
+  FCNT_STORE_BkUpWrite,
+  FCNT_STORE_BkUpRead,
+};
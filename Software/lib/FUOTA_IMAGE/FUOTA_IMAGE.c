@@ -0,0 +1,379 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file FUOTA_IMAGE.c
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "FUOTA_IMAGE.h"
+#include "stm32_crc.h"
+
+#if ((FUOTA_IMAGE_WINDOW_SIZE & (FUOTA_IMAGE_WINDOW_SIZE - 1U)) != 0U)
+#error "FUOTA_IMAGE_WINDOW_SIZE must be a power of two"
+#endif
+
+#define FUOTA_IMAGE_WINDOW_MASK (FUOTA_IMAGE_WINDOW_SIZE - 1U)
+#define FUOTA_IMAGE_TOKEN_LEN_MASK 0x3FU
+#define FUOTA_IMAGE_TOKEN_LEN_EXTENDED 0x3FU
+
+static inline uint32_t FUOTA_IMAGE_Min(uint32_t a, uint32_t b)
+{
+  return (a < b) ? a : b;
+}
+
+static inline uint32_t FUOTA_IMAGE_GetLe32(const uint8_t *data)
+{
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/**
+ * @brief Loads the next chunk of the update file when the input buffer is empty
+ */
+static FUOTA_IMAGE_op_result_t FUOTA_IMAGE_InputFill(FUOTA_IMAGE_Decoder_t *decoder)
+{
+  uint32_t length;
+
+  if (decoder->InputPos < decoder->InputLen)
+  {
+    return FUOTA_IMAGE_OP_SUCCESS;
+  }
+  length = FUOTA_IMAGE_Min(FUOTA_IMAGE_INPUT_SIZE, decoder->FileSize - decoder->FileOffset);
+  if (length == 0)
+  {
+    /* Token stream truncated */
+    return FUOTA_IMAGE_OP_FORMAT_ERROR;
+  }
+  if (decoder->FileRead(decoder->Context, decoder->FileOffset, decoder->Input, length) != FUOTA_IMAGE_OP_SUCCESS)
+  {
+    return FUOTA_IMAGE_OP_FAIL;
+  }
+  decoder->FileOffset += length;
+  decoder->InputLen = (uint16_t)length;
+  decoder->InputPos = 0;
+  return FUOTA_IMAGE_OP_SUCCESS;
+}
+
+/**
+ * @brief Gets the next byte of the token stream
+ */
+static FUOTA_IMAGE_op_result_t FUOTA_IMAGE_InputByte(FUOTA_IMAGE_Decoder_t *decoder, uint8_t *byte)
+{
+  FUOTA_IMAGE_op_result_t status = FUOTA_IMAGE_InputFill(decoder);
+
+  if (status == FUOTA_IMAGE_OP_SUCCESS)
+  {
+    *byte = decoder->Input[decoder->InputPos++];
+  }
+  return status;
+}
+
+/**
+ * @brief Reads an unsigned LEB128 varint of at most 32 bits from the token stream
+ */
+static FUOTA_IMAGE_op_result_t FUOTA_IMAGE_InputVarint(FUOTA_IMAGE_Decoder_t *decoder, uint32_t *value)
+{
+  FUOTA_IMAGE_op_result_t status;
+  uint8_t byte;
+  uint32_t shift = 0;
+
+  *value = 0;
+  do
+  {
+    if (shift > 28U)
+    {
+      return FUOTA_IMAGE_OP_FORMAT_ERROR;
+    }
+    status = FUOTA_IMAGE_InputByte(decoder, &byte);
+    if (status != FUOTA_IMAGE_OP_SUCCESS)
+    {
+      return status;
+    }
+    *value |= (uint32_t)(byte & 0x7FU) << shift;
+    shift += 7U;
+  } while ((byte & 0x80U) != 0U);
+
+  return FUOTA_IMAGE_OP_SUCCESS;
+}
+
+/**
+ * @brief Parses the next token and checks it stays within the image, the window and the base image
+ */
+static FUOTA_IMAGE_op_result_t FUOTA_IMAGE_NextToken(FUOTA_IMAGE_Decoder_t *decoder)
+{
+  FUOTA_IMAGE_op_result_t status;
+  uint8_t token;
+  uint32_t length;
+  uint32_t value;
+
+  status = FUOTA_IMAGE_InputByte(decoder, &token);
+  if (status != FUOTA_IMAGE_OP_SUCCESS)
+  {
+    return status;
+  }
+
+  length = (uint32_t)(token & FUOTA_IMAGE_TOKEN_LEN_MASK) + 1U;
+  if ((token & FUOTA_IMAGE_TOKEN_LEN_MASK) == FUOTA_IMAGE_TOKEN_LEN_EXTENDED)
+  {
+    status = FUOTA_IMAGE_InputVarint(decoder, &value);
+    if (status != FUOTA_IMAGE_OP_SUCCESS)
+    {
+      return status;
+    }
+    length = value + FUOTA_IMAGE_TOKEN_LEN_EXTENDED + 1U;
+  }
+  if ((length > (decoder->Header.ImageSize - decoder->OutOffset)) || (length == 0))
+  {
+    return FUOTA_IMAGE_OP_FORMAT_ERROR;
+  }
+
+  decoder->Op = token >> 6;
+  switch (decoder->Op)
+  {
+  case FUOTA_IMAGE_TOKEN_LITERAL:
+    decoder->Reference = 0;
+    break;
+  case FUOTA_IMAGE_TOKEN_WINDOW:
+    status = FUOTA_IMAGE_InputVarint(decoder, &value);
+    if (status != FUOTA_IMAGE_OP_SUCCESS)
+    {
+      return status;
+    }
+    /* Reference is the distance back from the current output offset */
+    decoder->Reference = value + 1U;
+    if ((decoder->Reference > decoder->OutOffset) || (decoder->Reference > FUOTA_IMAGE_WINDOW_SIZE))
+    {
+      return FUOTA_IMAGE_OP_FORMAT_ERROR;
+    }
+    break;
+  case FUOTA_IMAGE_TOKEN_BASE:
+    if (decoder->Header.Type != FUOTA_IMAGE_TYPE_DELTA)
+    {
+      return FUOTA_IMAGE_OP_FORMAT_ERROR;
+    }
+    status = FUOTA_IMAGE_InputVarint(decoder, &value);
+    if (status != FUOTA_IMAGE_OP_SUCCESS)
+    {
+      return status;
+    }
+    /* Zigzag decoded offset relative to the output, code moved between versions stays close */
+    decoder->Reference = decoder->OutOffset + (uint32_t)((int32_t)(value >> 1) ^ -(int32_t)(value & 1U));
+    if ((decoder->Reference > decoder->Header.BaseSize) || (length > (decoder->Header.BaseSize - decoder->Reference)))
+    {
+      return FUOTA_IMAGE_OP_FORMAT_ERROR;
+    }
+    break;
+  default:
+    return FUOTA_IMAGE_OP_FORMAT_ERROR;
+  }
+  decoder->Remaining = length;
+  return FUOTA_IMAGE_OP_SUCCESS;
+}
+
+/**
+ * @brief Reads and checks the header of an update file
+ * @param file_read callback reading the update file
+ * @param context user context passed to file_read
+ * @param header decoded header
+ * @return FUOTA_IMAGE_op_result_t
+ */
+FUOTA_IMAGE_op_result_t FUOTA_IMAGE_ReadHeader(FUOTA_IMAGE_Read_t file_read, void *context, FUOTA_IMAGE_Header_t *header)
+{
+  uint8_t raw[FUOTA_IMAGE_HEADER_SIZE];
+
+  if ((file_read == NULL) || (header == NULL))
+  {
+    return FUOTA_IMAGE_OP_FAIL;
+  }
+  if (file_read(context, 0, raw, FUOTA_IMAGE_HEADER_SIZE) != FUOTA_IMAGE_OP_SUCCESS)
+  {
+    return FUOTA_IMAGE_OP_FAIL;
+  }
+
+  header->Magic = FUOTA_IMAGE_GetLe32(&raw[0]);
+  header->Type = raw[4];
+  header->Version = raw[5];
+  header->WindowLog2 = raw[6];
+  header->Reserved = raw[7];
+  header->ImageVersion = FUOTA_IMAGE_GetLe32(&raw[8]);
+  header->ImageSize = FUOTA_IMAGE_GetLe32(&raw[12]);
+  header->ImageCrc = FUOTA_IMAGE_GetLe32(&raw[16]);
+  header->BaseSize = FUOTA_IMAGE_GetLe32(&raw[20]);
+  header->BaseCrc = FUOTA_IMAGE_GetLe32(&raw[24]);
+
+  if ((header->Magic != FUOTA_IMAGE_MAGIC) || (header->Version != FUOTA_IMAGE_HEADER_VERSION) ||
+      (header->Type > FUOTA_IMAGE_TYPE_DELTA))
+  {
+    return FUOTA_IMAGE_OP_FORMAT_ERROR;
+  }
+  /* The decoder window has to hold every back-reference the encoder may have used */
+  if ((header->WindowLog2 > 31U) || ((1UL << header->WindowLog2) > FUOTA_IMAGE_WINDOW_SIZE))
+  {
+    return FUOTA_IMAGE_OP_FORMAT_ERROR;
+  }
+  return FUOTA_IMAGE_OP_SUCCESS;
+}
+
+/**
+ * @brief Prepares the decoding of an update file
+ * @param decoder decoder state, about FUOTA_IMAGE_WINDOW_SIZE + FUOTA_IMAGE_INPUT_SIZE bytes
+ * @param file_size size in bytes of the update file, header included
+ * @param file_read callback reading the update file
+ * @param base_read callback reading the application the delta applies to, may be NULL for other types
+ * @param context user context passed to the callbacks
+ * @return FUOTA_IMAGE_op_result_t
+ */
+FUOTA_IMAGE_op_result_t FUOTA_IMAGE_DecoderInit(FUOTA_IMAGE_Decoder_t *decoder, uint32_t file_size, FUOTA_IMAGE_Read_t file_read,
+                                                FUOTA_IMAGE_Read_t base_read, void *context)
+{
+  FUOTA_IMAGE_op_result_t status;
+
+  if ((decoder == NULL) || (file_size < FUOTA_IMAGE_HEADER_SIZE))
+  {
+    return FUOTA_IMAGE_OP_FAIL;
+  }
+  status = FUOTA_IMAGE_ReadHeader(file_read, context, &decoder->Header);
+  if (status != FUOTA_IMAGE_OP_SUCCESS)
+  {
+    return status;
+  }
+  if ((decoder->Header.Type == FUOTA_IMAGE_TYPE_DELTA) && (base_read == NULL))
+  {
+    return FUOTA_IMAGE_OP_FAIL;
+  }
+
+  decoder->FileRead = file_read;
+  decoder->BaseRead = base_read;
+  decoder->Context = context;
+  decoder->FileSize = file_size;
+  decoder->FileOffset = FUOTA_IMAGE_HEADER_SIZE;
+  decoder->OutOffset = 0;
+  decoder->Crc = 0;
+  decoder->InputPos = 0;
+  decoder->InputLen = 0;
+  decoder->Op = FUOTA_IMAGE_TOKEN_LITERAL;
+  decoder->Reference = 0;
+  /* A raw image is a single literal token without token header */
+  decoder->Remaining = (decoder->Header.Type == FUOTA_IMAGE_TYPE_RAW) ? decoder->Header.ImageSize : 0;
+
+  return FUOTA_IMAGE_OP_SUCCESS;
+}
+
+/**
+ * @brief Decodes the next bytes of the application
+ * @note Matches MCU_FLASH_Source_t ordering: successive calls return consecutive bytes
+ * @param decoder decoder state initialized with FUOTA_IMAGE_DecoderInit
+ * @param buffer destination of the decoded bytes
+ * @param length number of bytes to decode
+ * @return FUOTA_IMAGE_op_result_t
+ */
+FUOTA_IMAGE_op_result_t FUOTA_IMAGE_Decode(FUOTA_IMAGE_Decoder_t *decoder, uint8_t *buffer, uint32_t length)
+{
+  FUOTA_IMAGE_op_result_t status;
+
+  if ((decoder == NULL) || (buffer == NULL) || (length > (decoder->Header.ImageSize - decoder->OutOffset)))
+  {
+    return FUOTA_IMAGE_OP_FAIL;
+  }
+
+  while (length > 0)
+  {
+    uint32_t count;
+
+    if (decoder->Remaining == 0)
+    {
+      status = FUOTA_IMAGE_NextToken(decoder);
+      if (status != FUOTA_IMAGE_OP_SUCCESS)
+      {
+        return status;
+      }
+    }
+    count = FUOTA_IMAGE_Min(length, decoder->Remaining);
+
+    switch (decoder->Op)
+    {
+    case FUOTA_IMAGE_TOKEN_LITERAL:
+      for (uint32_t done = 0; done < count;)
+      {
+        uint32_t chunk;
+        status = FUOTA_IMAGE_InputFill(decoder);
+        if (status != FUOTA_IMAGE_OP_SUCCESS)
+        {
+          return status;
+        }
+        chunk = FUOTA_IMAGE_Min(count - done, (uint32_t)(decoder->InputLen - decoder->InputPos));
+        memcpy(&buffer[done], &decoder->Input[decoder->InputPos], chunk);
+        decoder->InputPos += (uint16_t)chunk;
+        done += chunk;
+      }
+      break;
+    case FUOTA_IMAGE_TOKEN_WINDOW:
+      /* Byte per byte, the source may overlap the bytes being decoded */
+      for (uint32_t i = 0; i < count; i++)
+      {
+        buffer[i] = decoder->Window[(decoder->OutOffset + i - decoder->Reference) & FUOTA_IMAGE_WINDOW_MASK];
+        decoder->Window[(decoder->OutOffset + i) & FUOTA_IMAGE_WINDOW_MASK] = buffer[i];
+      }
+      break;
+    case FUOTA_IMAGE_TOKEN_BASE:
+      if (decoder->BaseRead(decoder->Context, decoder->Reference, buffer, count) != FUOTA_IMAGE_OP_SUCCESS)
+      {
+        return FUOTA_IMAGE_OP_FAIL;
+      }
+      decoder->Reference += count;
+      break;
+    default:
+      return FUOTA_IMAGE_OP_FORMAT_ERROR;
+    }
+
+    if (decoder->Op != FUOTA_IMAGE_TOKEN_WINDOW)
+    {
+      for (uint32_t i = 0; i < count; i++)
+      {
+        decoder->Window[(decoder->OutOffset + i) & FUOTA_IMAGE_WINDOW_MASK] = buffer[i];
+      }
+    }
+
+    decoder->Crc = UTIL_CRC32_Update(decoder->Crc, buffer, count);
+    decoder->OutOffset += count;
+    decoder->Remaining -= count;
+    buffer += count;
+    length -= count;
+  }
+  return FUOTA_IMAGE_OP_SUCCESS;
+}
+
+/**
+ * @brief Checks the whole application was decoded and matches the header CRC
+ * @param decoder decoder state
+ * @return FUOTA_IMAGE_op_result_t
+ */
+FUOTA_IMAGE_op_result_t FUOTA_IMAGE_DecoderFinish(FUOTA_IMAGE_Decoder_t *decoder)
+{
+  if ((decoder == NULL) || (decoder->OutOffset != decoder->Header.ImageSize) || (decoder->Remaining != 0))
+  {
+    return FUOTA_IMAGE_OP_FAIL;
+  }
+  if (decoder->Crc != decoder->Header.ImageCrc)
+  {
+    return FUOTA_IMAGE_OP_CRC_ERROR;
+  }
+  return FUOTA_IMAGE_OP_SUCCESS;
+}
+
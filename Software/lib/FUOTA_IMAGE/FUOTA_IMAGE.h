@@ -0,0 +1,170 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file FUOTA_IMAGE.h
+ *
+ * @brief Firmware update images received over FUOTA
+ *
+ * An update file starts with a FUOTA_IMAGE_Header_t followed by a payload that is either:
+ * - FUOTA_IMAGE_TYPE_RAW: the application binary as is
+ * - FUOTA_IMAGE_TYPE_LZ: an LZ-style token stream referencing the last decoded bytes
+ * - FUOTA_IMAGE_TYPE_DELTA: the same token stream, also referencing the application currently in flash
+ *
+ * Each token starts with a byte holding the operation in the two upper bits and the length in the
+ * lower bits (length - 1 up to 62, otherwise 63 followed by a varint of length - 64):
+ * - FUOTA_IMAGE_TOKEN_LITERAL: length bytes follow
+ * - FUOTA_IMAGE_TOKEN_WINDOW: varint of distance - 1, copies from the decoded output
+ * - FUOTA_IMAGE_TOKEN_BASE: zigzag varint of base offset - output offset, copies from the base image
+ *
+ * Images are generated and checked on the host with `tools/fuota_image_tool.py`.
+ * The decoder is pull-style with a fixed RAM window of FUOTA_IMAGE_WINDOW_SIZE bytes,
+ * so it can feed MCU_FLASH_WriteStream directly.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#ifndef FUOTA_IMAGE_H
+#define FUOTA_IMAGE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Decoder history window in bytes, must be a power of two
+ * @note Images generated with a larger window are rejected
+ */
+#ifndef FUOTA_IMAGE_WINDOW_SIZE
+#define FUOTA_IMAGE_WINDOW_SIZE 512U
+#endif
+
+/**
+ * Decoder input buffer in bytes, the update file is read in chunks of this size
+ */
+#ifndef FUOTA_IMAGE_INPUT_SIZE
+#define FUOTA_IMAGE_INPUT_SIZE 64U
+#endif
+
+/**
+ * External flash layout used to hand the received file over to the bootloader
+ * @note The MX25R1635 is reserved from 0x130000 on (BOOT_META areas below), SPIFFS must not be mounted on it
+ */
+#define FUOTA_IMAGE_STORE_ADDRESS 0x180000U /* Status page followed by the received file */
+#define FUOTA_IMAGE_STORE_SIZE 0x40000U
+#define FUOTA_IMAGE_FILE_ADDRESS (FUOTA_IMAGE_STORE_ADDRESS + FUOTA_IMAGE_STATUS_SIZE)
+#define FUOTA_IMAGE_FILE_SIZE_MAX (FUOTA_IMAGE_STORE_SIZE - FUOTA_IMAGE_STATUS_SIZE)
+#define FUOTA_IMAGE_STAGING_ADDRESS 0x1C0000U /* Decoded delta image before it is programmed */
+#define FUOTA_IMAGE_STAGING_SIZE 0x40000U
+#define FUOTA_IMAGE_STATUS_SIZE 0x100U
+#define FUOTA_IMAGE_BLOCK_SIZE 0x10000U
+
+/**
+ * Status word value once the matching step is done, erased words read as 0xFFFFFFFF
+ */
+#define FUOTA_IMAGE_STATUS_SET 0x55AA55AAU
+
+#define FUOTA_IMAGE_MAGIC 0x57464E47U /* "GNFW" */
+#define FUOTA_IMAGE_HEADER_VERSION 1U
+#define FUOTA_IMAGE_HEADER_SIZE 28U
+
+#define FUOTA_IMAGE_TYPE_RAW 0U
+#define FUOTA_IMAGE_TYPE_LZ 1U
+#define FUOTA_IMAGE_TYPE_DELTA 2U
+
+#define FUOTA_IMAGE_TOKEN_LITERAL 0U
+#define FUOTA_IMAGE_TOKEN_WINDOW 1U
+#define FUOTA_IMAGE_TOKEN_BASE 2U
+
+typedef enum
+{
+  FUOTA_IMAGE_OP_SUCCESS = 0,
+  FUOTA_IMAGE_OP_FAIL = 1,
+  FUOTA_IMAGE_OP_FORMAT_ERROR = 2,
+  FUOTA_IMAGE_OP_CRC_ERROR = 3,
+} FUOTA_IMAGE_op_result_t;
+
+/**
+ * Update file header, stored little-endian
+ */
+typedef struct
+{
+  uint32_t Magic;
+  uint8_t Type;
+  uint8_t Version;
+  uint8_t WindowLog2;  /* History window used by the encoder */
+  uint8_t Reserved;
+  uint32_t ImageVersion; /* Version of the decoded application */
+  uint32_t ImageSize;  /* Size of the decoded application */
+  uint32_t ImageCrc;   /* CRC-32 of the decoded application */
+  uint32_t BaseSize;   /* FUOTA_IMAGE_TYPE_DELTA only, size of the application the delta applies to */
+  uint32_t BaseCrc;    /* FUOTA_IMAGE_TYPE_DELTA only, CRC-32 of that application */
+} FUOTA_IMAGE_Header_t;
+
+/**
+ * Hand-over record in the status page of the external flash
+ * @note Every word is only ever programmed once from its erased state
+ */
+typedef struct
+{
+  uint32_t Pending;  /* Set by the application once a complete update file was received */
+  uint32_t FileSize;
+  uint32_t Staged;   /* Set by the bootloader once a delta was applied to the staging area */
+  uint32_t Done;     /* Set by the bootloader once the application was programmed */
+} FUOTA_IMAGE_Status_t;
+
+/**
+ * @brief Reads bytes of the update file or of the base image
+ * @param context user context of the decoder
+ * @param offset offset in bytes from the start of the file or image
+ * @param buffer destination of the requested bytes
+ * @param length number of requested bytes
+ * @return FUOTA_IMAGE_op_result_t
+ */
+typedef FUOTA_IMAGE_op_result_t (*FUOTA_IMAGE_Read_t)(void *context, uint32_t offset, uint8_t *buffer, uint32_t length);
+
+typedef struct
+{
+  FUOTA_IMAGE_Header_t Header;
+  FUOTA_IMAGE_Read_t FileRead;
+  FUOTA_IMAGE_Read_t BaseRead;
+  void *Context;
+  uint32_t FileSize;
+  uint32_t FileOffset;  /* Next update file byte to load in Input */
+  uint32_t OutOffset;   /* Number of decoded bytes */
+  uint32_t Crc;         /* Running CRC-32 of the decoded bytes */
+  uint32_t Remaining;   /* Bytes left in the current token */
+  uint32_t Reference;   /* Window distance or base offset of the current token */
+  uint8_t Op;
+  uint16_t InputPos;
+  uint16_t InputLen;
+  uint8_t Input[FUOTA_IMAGE_INPUT_SIZE];
+  uint8_t Window[FUOTA_IMAGE_WINDOW_SIZE];
+} FUOTA_IMAGE_Decoder_t;
+
+FUOTA_IMAGE_op_result_t FUOTA_IMAGE_ReadHeader(FUOTA_IMAGE_Read_t file_read, void *context, FUOTA_IMAGE_Header_t *header);
+FUOTA_IMAGE_op_result_t FUOTA_IMAGE_DecoderInit(FUOTA_IMAGE_Decoder_t *decoder, uint32_t file_size, FUOTA_IMAGE_Read_t file_read,
+                                                FUOTA_IMAGE_Read_t base_read, void *context);
+FUOTA_IMAGE_op_result_t FUOTA_IMAGE_Decode(FUOTA_IMAGE_Decoder_t *decoder, uint8_t *buffer, uint32_t length);
+FUOTA_IMAGE_op_result_t FUOTA_IMAGE_DecoderFinish(FUOTA_IMAGE_Decoder_t *decoder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FUOTA_IMAGE_H */
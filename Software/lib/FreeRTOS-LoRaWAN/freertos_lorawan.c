@@ -27,6 +27,7 @@
 #include "utilities.h"
 #include "LoRaMacTest.h"
 #include "radio.h"
+#include "stm32_evt_trace.h"
 
 /**
  * @brief An event to indicate there are pending events to be processed from radio layer.
@@ -430,6 +431,7 @@ static uint8_t prvGetBatteryLevel( void )
 static void prvOnMacNotify( void )
 {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    UTIL_EVT_TRACE( UTIL_EVT_TRACE_TASK_NOTIFY, LORAWAN_EVENT_MAC_PENDING, 0 );
     if( xPortIsInsideInterrupt() )
     {
         xTaskNotifyAndQueryFromISR( xLoRaMacTask, LORAWAN_EVENT_MAC_PENDING, eSetBits, NULL, &xHigherPriorityTaskWoken );
@@ -444,6 +446,7 @@ static void prvOnMacNotify( void )
 static void prvOnRadioNotify()
 {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    UTIL_EVT_TRACE( UTIL_EVT_TRACE_TASK_NOTIFY, LORAWAN_EVENT_RADIO_PENDING, 0 );
     xTaskNotifyAndQueryFromISR( xLoRaMacTask, LORAWAN_EVENT_RADIO_PENDING, eSetBits, NULL, &xHigherPriorityTaskWoken );
     portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
 }
@@ -796,6 +799,7 @@ LoRaMacStatus_t LoRaWAN_Send( LoRaWANMessage_t * pMessage,
             mcpsReq.Req.Confirmed.fBuffer = pMessage->data;
             mcpsReq.Req.Confirmed.fBufferSize = pMessage->length;
             mcpsReq.Req.Confirmed.NbTrials = lorawanConfigMAX_SEND_RETRIES;
+            mcpsReq.Req.Confirmed.RetransPolicy = NULL;
             mcpsReq.Req.Confirmed.Datarate = pMessage->dataRate;
         }
 
@@ -47,6 +47,16 @@
   */
 #define RTC_BKP_MSBTICKS   RTC_BKP_DR2
 
+/**
+  * @brief Backup frame counter register
+  */
+#define RTC_BKP_FCNT       RTC_BKP_DR3
+
+/**
+  * @brief Backup frame counter check register
+  */
+#define RTC_BKP_FCNT_CHECK RTC_BKP_DR4
+
 /* #define RTIF_DEBUG */
 
 #ifdef RTIF_DEBUG
@@ -382,6 +392,44 @@ uint32_t GNSE_RTC_BkUp_Read_SubSeconds(void)
   return HAL_RTCEx_BKUPRead(&GNSE_BSP_rtc, RTC_BKP_SUBSECONDS);
 }
 
+/**
+  * @brief writes the uplink frame counter in backUp register
+  * @note Used to resume the frame counter after a warm reset
+  * @param[in] FCnt uplink frame counter
+  */
+void GNSE_RTC_BkUp_Write_FCnt(uint32_t FCnt)
+{
+  HAL_RTCEx_BKUPWrite(&GNSE_BSP_rtc, RTC_BKP_FCNT, FCnt);
+}
+
+/**
+  * @brief reads the uplink frame counter from backUp register
+  * @return uplink frame counter
+  */
+uint32_t GNSE_RTC_BkUp_Read_FCnt(void)
+{
+  return HAL_RTCEx_BKUPRead(&GNSE_BSP_rtc, RTC_BKP_FCNT);
+}
+
+/**
+  * @brief writes the uplink frame counter check value in backUp register
+  * @note Used to tell a valid frame counter apart from a reset backup domain
+  * @param[in] FCntCheck check value of the uplink frame counter
+  */
+void GNSE_RTC_BkUp_Write_FCntCheck(uint32_t FCntCheck)
+{
+  HAL_RTCEx_BKUPWrite(&GNSE_BSP_rtc, RTC_BKP_FCNT_CHECK, FCntCheck);
+}
+
+/**
+  * @brief reads the uplink frame counter check value from backUp register
+  * @return check value of the uplink frame counter
+  */
+uint32_t GNSE_RTC_BkUp_Read_FCntCheck(void)
+{
+  return HAL_RTCEx_BKUPRead(&GNSE_BSP_rtc, RTC_BKP_FCNT_CHECK);
+}
+
 static void GNSE_RTC_BkUp_Write_MSBticks(uint32_t MSBticks)
 {
   HAL_RTCEx_BKUPWrite(&GNSE_BSP_rtc, RTC_BKP_MSBTICKS, MSBticks);
@@ -46,6 +46,10 @@ void GNSE_RTC_BkUp_Write_Seconds(uint32_t Seconds);
 uint32_t GNSE_RTC_BkUp_Read_Seconds(void);
 void GNSE_RTC_BkUp_Write_SubSeconds(uint32_t SubSeconds);
 uint32_t GNSE_RTC_BkUp_Read_SubSeconds(void);
+void GNSE_RTC_BkUp_Write_FCnt(uint32_t FCnt);
+uint32_t GNSE_RTC_BkUp_Read_FCnt(void);
+void GNSE_RTC_BkUp_Write_FCntCheck(uint32_t FCntCheck);
+uint32_t GNSE_RTC_BkUp_Read_FCntCheck(void);
 
 #ifdef __cplusplus
 }
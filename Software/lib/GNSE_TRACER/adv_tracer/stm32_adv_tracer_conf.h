@@ -35,7 +35,9 @@ extern "C" {
  *    ADV_TRACER_UNCHUNK_MODE shall be defined if you want use the unchunk mode
  *
  ******************************************************************************/
-#define ADV_TRACER_SUPPORT_FLOAT /** Comment this to get smaller code size and sacrifice float printing like %f, %4.2f **/
+#ifndef ADV_TRACER_NO_FLOAT
+#define ADV_TRACER_SUPPORT_FLOAT /** Define ADV_TRACER_NO_FLOAT to get smaller code size and sacrifice float printing like %f, %4.2f **/
+#endif
 // #define ADV_TRACER_SUPPORT_TINY_PRINTF /** Uncomment to get smaller printf code size **/
 #define ADV_TRACER_CONDITIONNAL                                                      /*!< not used */
 #define ADV_TRACER_UNCHUNK_MODE                                                      /*!< not used */
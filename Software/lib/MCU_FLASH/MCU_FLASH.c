@@ -21,6 +21,7 @@
  */
 
 #include "MCU_FLASH.h"
+#include "stm32_crc.h"
 
 #define NB_PAGE_SECTOR_PER_ERASE  2U    /*!< Nb page erased per erase */
 
@@ -142,19 +143,58 @@ HAL_StatusTypeDef MCU_FLASH_Erase(void *pStart, uint32_t uLength)
   return e_ret_status;
 }
 
+/**
+  * @brief  Source callback reading from a memory mapped buffer
+  * @param  pContext: start of the buffer
+  * @param  uOffset: offset in bytes from the start of the buffer
+  * @param  pBuffer: destination of the requested bytes
+  * @param  uLength: number of requested bytes
+  * @return HAL_OK
+  */
+static HAL_StatusTypeDef MCU_FLASH_MemorySource(void *pContext, uint32_t uOffset, uint8_t *pBuffer, uint32_t uLength)
+{
+  UTIL_MEM_cpy_8((void *)pBuffer, (const void *)((uint8_t *)pContext + uOffset), uLength);
+  return HAL_OK;
+}
+
 /**
   * @brief  This function writes a data buffer in flash (data are 64-bit aligned).
   * @note   After writing data buffer, the flash content is checked.
-  * @param  pDestination: Start address for target location
+  * @param  pDestination: Start address for target location, it has to be 64-bit aligned.
   * @param  pSource: pointer on buffer with data to write
-  * @param  uLength: Length of data buffer in byte. It has to be 64-bit aligned.
+  * @param  uLength: Length of data buffer in byte, a partial last double-word is padded with 0xFF.
   * @return HAL Status.
   */
 HAL_StatusTypeDef MCU_FLASH_Write(uint32_t pDestination, uint8_t *pSource, uint32_t uLength)
 {
+  return MCU_FLASH_WriteStream(pDestination, uLength, MCU_FLASH_MemorySource, (void *)pSource);
+}
+
+/**
+  * @brief  This function writes data pulled from a source callback in flash
+  * @note   The destination has to be erased. Rows of MCU_FLASH_ROW_SIZE bytes are
+  *         fast programmed, the unaligned head and tail are programmed per double-word
+  *         and a partial last double-word is padded with 0xFF.
+  *         The flash content is checked once per page with a CRC-32 of the programmed data.
+  * @param  pDestination: Start address for target location, it has to be 64-bit aligned.
+  * @param  uLength: Length of data in byte
+  * @param  pSource: callback providing the data to write, in increasing offset order
+  * @param  pContext: user context passed to pSource
+  * @return HAL Status.
+  */
+HAL_StatusTypeDef MCU_FLASH_WriteStream(uint32_t pDestination, uint32_t uLength, MCU_FLASH_Source_t pSource, void *pContext)
+{
+  /* Fast programming reads the row from RAM, it must not be located in flash */
+  static uint64_t row_buffer[MCU_FLASH_ROW_SIZE / sizeof(uint64_t)];
   HAL_StatusTypeDef e_ret_status = HAL_ERROR;
-  uint32_t i = 0U;
-  uint64_t data;
+  uint32_t offset = 0U;
+  uint32_t verify_start = pDestination;
+  uint32_t verify_crc = UTIL_CRC32_INIT;
+
+  if ((pSource == NULL) || ((pDestination % sizeof(uint64_t)) != 0U))
+  {
+    return HAL_ERROR;
+  }
 
   /* Initialize Flash */
   e_ret_status = MCU_FLASH_Init();
@@ -167,41 +207,71 @@ HAL_StatusTypeDef MCU_FLASH_Write(uint32_t pDestination, uint8_t *pSource, uint3
       MCU_FLASH_PPRINTF("ERROR ==> Unlock not possible\n");
       return HAL_ERROR;
     }
-    else
+
+    MCU_FLASH_PPRINTF("Flash Write : Memory addr 0x%08x length%04d\r\n", pDestination, uLength);
+
+    while (offset < uLength)
     {
-      MCU_FLASH_PPRINTF("Flash Write : Memory addr 0x%08x length%04d\r\n", pDestination, uLength);
+      uint32_t remaining = uLength - offset;
+      uint32_t chunk;
+      uint32_t programmed;
 
-      /* DataLength must be a multiple of 64 bit */
-      for (i = 0U; i < uLength; i += 8U)
+      if (((pDestination % MCU_FLASH_ROW_SIZE) == 0U) && (remaining >= MCU_FLASH_ROW_SIZE))
       {
-        UTIL_MEM_cpy_8((void*)&data, (const void*)(pSource + i), 8);
-        /* Device voltage range supposed to be [2.7V to 3.6V], the operation will
-        be done by word */
-        if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, pDestination, data) == HAL_OK)
+        chunk = MCU_FLASH_ROW_SIZE;
+        programmed = MCU_FLASH_ROW_SIZE;
+        if (pSource(pContext, offset, (uint8_t *)row_buffer, chunk) != HAL_OK)
         {
-          /* Check the written value */
-          if (*(uint64_t *)pDestination != data)
-          {
-            /* Flash content doesn't match SRAM content */
-            e_ret_status = HAL_ERROR;
-            MCU_FLASH_PPRINTF("ERROR ==> Memory check failure\n");
-            break;
-          }
-          /* Increment FLASH Destination address */
-          pDestination += 8U;
+          e_ret_status = HAL_ERROR;
+          MCU_FLASH_PPRINTF("ERROR ==> Source read failure\n");
+          break;
         }
-        else
+        e_ret_status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FAST, pDestination, (uint64_t)(uint32_t)row_buffer);
+      }
+      else
+      {
+        chunk = (remaining < sizeof(uint64_t)) ? remaining : sizeof(uint64_t);
+        programmed = sizeof(uint64_t);
+        row_buffer[0] = UINT64_MAX;
+        if (pSource(pContext, offset, (uint8_t *)row_buffer, chunk) != HAL_OK)
         {
-          /* Error occurred while writing data in Flash memory */
           e_ret_status = HAL_ERROR;
-          MCU_FLASH_PPRINTF("ERROR ==> Memory write failure\n");
+          MCU_FLASH_PPRINTF("ERROR ==> Source read failure\n");
           break;
         }
+        /* Device voltage range supposed to be [2.7V to 3.6V], the operation will
+        be done by word */
+        e_ret_status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, pDestination, row_buffer[0]);
+      }
+
+      if (e_ret_status != HAL_OK)
+      {
+        /* Error occurred while writing data in Flash memory */
+        MCU_FLASH_PPRINTF("ERROR ==> Memory write failure\n");
+        break;
+      }
+
+      verify_crc = UTIL_CRC32_Update(verify_crc, row_buffer, programmed);
+      pDestination += programmed;
+      offset += chunk;
+
+      /* Check the written page against the programmed data */
+      if (((pDestination % FLASH_PAGE_SIZE) == 0U) || (offset >= uLength))
+      {
+        if (UTIL_CRC32_Update(UTIL_CRC32_INIT, (const void *)verify_start, pDestination - verify_start) != verify_crc)
+        {
+          /* Flash content doesn't match SRAM content */
+          e_ret_status = HAL_ERROR;
+          MCU_FLASH_PPRINTF("ERROR ==> Memory check failure\n");
+          break;
+        }
+        verify_start = pDestination;
+        verify_crc = UTIL_CRC32_INIT;
       }
-      /* Lock the Flash to disable the flash control register access (recommended
-      to protect the FLASH memory against possible unwanted operation) *********/
-      HAL_FLASH_Lock();
     }
+    /* Lock the Flash to disable the flash control register access (recommended
+    to protect the FLASH memory against possible unwanted operation) *********/
+    HAL_FLASH_Lock();
   }
   return e_ret_status;
 }
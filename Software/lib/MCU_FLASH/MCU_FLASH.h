@@ -37,9 +37,25 @@ extern "C" {
 #define MCU_FLASH_PPRINTF(...)
 #endif
 
+/**
+ * Size in bytes of a fast programming row (32 double-words)
+ */
+#define MCU_FLASH_ROW_SIZE 256U
+
+/**
+ * @brief Pull-style data source for MCU_FLASH_WriteStream, e.g. a wrapper around GNSE_Flash_Read
+ * @param pContext user context given to MCU_FLASH_WriteStream
+ * @param uOffset offset in bytes from the start of the stream
+ * @param pBuffer destination of the requested bytes
+ * @param uLength number of requested bytes, at most MCU_FLASH_ROW_SIZE
+ * @return HAL_OK if all requested bytes were provided
+ */
+typedef HAL_StatusTypeDef (*MCU_FLASH_Source_t)(void *pContext, uint32_t uOffset, uint8_t *pBuffer, uint32_t uLength);
+
 HAL_StatusTypeDef MCU_FLASH_Init(void);
 HAL_StatusTypeDef MCU_FLASH_Erase(void *pStart, uint32_t uLength);
 HAL_StatusTypeDef MCU_FLASH_Write(uint32_t pDestination, uint8_t *pSource, uint32_t uLength);
+HAL_StatusTypeDef MCU_FLASH_WriteStream(uint32_t pDestination, uint32_t uLength, MCU_FLASH_Source_t pSource, void *pContext);
 HAL_StatusTypeDef MCU_FLASH_Read(void *pDestination, const void *pSource, uint32_t Length);
 
 #ifdef __cplusplus
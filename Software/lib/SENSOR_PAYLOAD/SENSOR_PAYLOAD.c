@@ -0,0 +1,180 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file SENSOR_PAYLOAD.c
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "SENSOR_PAYLOAD.h"
+
+/**
+ * Output of the encoder, Size goes past Limit once the block does not fit
+ */
+typedef struct
+{
+  uint8_t *Buffer;
+  uint16_t Size;
+  uint16_t Limit;
+} SENSOR_PAYLOAD_Writer_t;
+
+static void SENSOR_PAYLOAD_PutByte(SENSOR_PAYLOAD_Writer_t *writer, uint8_t value)
+{
+  if (writer->Size < writer->Limit)
+  {
+    writer->Buffer[writer->Size] = value;
+  }
+  writer->Size++;
+}
+
+static void SENSOR_PAYLOAD_PutVarint(SENSOR_PAYLOAD_Writer_t *writer, uint32_t value)
+{
+  while (value >= 0x80U)
+  {
+    SENSOR_PAYLOAD_PutByte(writer, (uint8_t)(value | 0x80U));
+    value >>= 7;
+  }
+  SENSOR_PAYLOAD_PutByte(writer, (uint8_t)value);
+}
+
+static void SENSOR_PAYLOAD_PutZigzag(SENSOR_PAYLOAD_Writer_t *writer, int32_t value)
+{
+  SENSOR_PAYLOAD_PutVarint(writer, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+static inline bool SENSOR_PAYLOAD_IsNibble(int32_t value)
+{
+  return (value >= -8) && (value <= 7);
+}
+
+/**
+ * @brief Encodes the first samples of a block
+ * @param block block to encode
+ * @param count number of samples to encode
+ * @param limit size of the block buffer to use
+ * @return encoded size, larger than limit if the samples do not fit
+ */
+static uint16_t SENSOR_PAYLOAD_Encode(SENSOR_PAYLOAD_Block_t *block, uint8_t count, uint16_t limit)
+{
+  SENSOR_PAYLOAD_Writer_t writer = {block->Buffer, 0, limit};
+  const SENSOR_PAYLOAD_Sample_t *samples = block->Samples;
+  uint32_t interval = 0;
+  bool irregular = false;
+
+  if (count == 0U)
+  {
+    return 0;
+  }
+
+  if (count > 1U)
+  {
+    interval = samples[1].Time - samples[0].Time;
+    for (uint8_t i = 2; i < count; i++)
+    {
+      if ((samples[i].Time - samples[i - 1].Time) != interval)
+      {
+        irregular = true;
+        break;
+      }
+    }
+  }
+
+  SENSOR_PAYLOAD_PutByte(&writer, (uint8_t)((SENSOR_PAYLOAD_FORMAT << 6) | (irregular ? SENSOR_PAYLOAD_IRREGULAR : 0U) | (count - 1U)));
+  SENSOR_PAYLOAD_PutVarint(&writer, samples[0].Time);
+  if ((count > 1U) && (irregular == false))
+  {
+    SENSOR_PAYLOAD_PutVarint(&writer, interval);
+  }
+
+  SENSOR_PAYLOAD_PutByte(&writer, samples[0].Battery);
+  SENSOR_PAYLOAD_PutZigzag(&writer, samples[0].Temperature);
+  SENSOR_PAYLOAD_PutVarint(&writer, samples[0].Humidity);
+
+  for (uint8_t i = 1; i < count; i++)
+  {
+    int32_t battery = (int32_t)samples[i].Battery - (int32_t)samples[i - 1].Battery;
+    int32_t temperature = (int32_t)samples[i].Temperature - (int32_t)samples[i - 1].Temperature;
+    int32_t humidity = (int32_t)samples[i].Humidity - (int32_t)samples[i - 1].Humidity;
+    uint8_t nibbles = (uint8_t)(((uint32_t)temperature << 4) | ((uint32_t)humidity & 0x0FU));
+
+    if (irregular == true)
+    {
+      SENSOR_PAYLOAD_PutVarint(&writer, samples[i].Time - samples[i - 1].Time);
+    }
+    if ((battery == 0) && SENSOR_PAYLOAD_IsNibble(temperature) && SENSOR_PAYLOAD_IsNibble(humidity) &&
+        (nibbles != SENSOR_PAYLOAD_ESCAPE))
+    {
+      SENSOR_PAYLOAD_PutByte(&writer, nibbles);
+    }
+    else
+    {
+      SENSOR_PAYLOAD_PutByte(&writer, SENSOR_PAYLOAD_ESCAPE);
+      SENSOR_PAYLOAD_PutZigzag(&writer, battery);
+      SENSOR_PAYLOAD_PutZigzag(&writer, temperature);
+      SENSOR_PAYLOAD_PutZigzag(&writer, humidity);
+    }
+  }
+
+  return writer.Size;
+}
+
+void SENSOR_PAYLOAD_Reset(SENSOR_PAYLOAD_Block_t *block)
+{
+  if (block != NULL)
+  {
+    block->Count = 0;
+    block->Size = 0;
+  }
+}
+
+SENSOR_PAYLOAD_op_result_t SENSOR_PAYLOAD_Add(SENSOR_PAYLOAD_Block_t *block, const SENSOR_PAYLOAD_Sample_t *sample, uint8_t max_size)
+{
+  uint16_t size;
+
+  if ((block == NULL) || (sample == NULL))
+  {
+    return SENSOR_PAYLOAD_OP_FAIL;
+  }
+  if ((block->Count > 0U) && ((int32_t)(sample->Time - block->Samples[block->Count - 1U].Time) < 0))
+  {
+    return SENSOR_PAYLOAD_OP_FAIL;
+  }
+  if (block->Count >= SENSOR_PAYLOAD_MAX_SAMPLES)
+  {
+    return SENSOR_PAYLOAD_OP_FULL;
+  }
+
+  if (max_size > SENSOR_PAYLOAD_BUFFER_SIZE)
+  {
+    max_size = SENSOR_PAYLOAD_BUFFER_SIZE;
+  }
+
+  block->Samples[block->Count] = *sample;
+  size = SENSOR_PAYLOAD_Encode(block, block->Count + 1U, max_size);
+  if (size > max_size)
+  {
+    /* Restore the encoding without the sample, it fitted before */
+    SENSOR_PAYLOAD_Encode(block, block->Count, SENSOR_PAYLOAD_BUFFER_SIZE);
+    return SENSOR_PAYLOAD_OP_FULL;
+  }
+
+  block->Count++;
+  block->Size = (uint8_t)size;
+  return SENSOR_PAYLOAD_OP_SUCCESS;
+}
@@ -0,0 +1,102 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file SENSOR_PAYLOAD.h
+ *
+ * @brief Aggregation of sensor samples in compact uplink payloads
+ *
+ * A block holds up to SENSOR_PAYLOAD_MAX_SAMPLES samples, encoded as:
+ * - header byte: SENSOR_PAYLOAD_FORMAT in the two upper bits, SENSOR_PAYLOAD_IRREGULAR, number of samples - 1 in the lower bits
+ * - varint of the time of the first sample in seconds
+ * - varint of the sampling interval in seconds, if there is more than one sample and SENSOR_PAYLOAD_IRREGULAR is not set
+ * - first sample: battery byte, zigzag varint of the temperature, varint of the humidity
+ * - every other sample: varint of the time since the previous sample if SENSOR_PAYLOAD_IRREGULAR is set, followed by
+ *   - one byte with the temperature and humidity deltas to the previous sample as signed nibbles, the battery is unchanged
+ *   - or SENSOR_PAYLOAD_ESCAPE followed by the zigzag varints of the battery, temperature and humidity deltas
+ *
+ * Blocks are self-delimiting, so several blocks can be sent in one uplink. They are decoded with
+ * `tools/sensor_payload_tool.py`.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#ifndef SENSOR_PAYLOAD_H
+#define SENSOR_PAYLOAD_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Maximum number of samples of a block
+ */
+#define SENSOR_PAYLOAD_MAX_SAMPLES 32U
+
+/**
+ * Encoded block buffer in bytes, the largest LoRaWAN application payload
+ */
+#define SENSOR_PAYLOAD_BUFFER_SIZE 242U
+
+#define SENSOR_PAYLOAD_FORMAT 1U
+#define SENSOR_PAYLOAD_IRREGULAR 0x20U
+#define SENSOR_PAYLOAD_ESCAPE 0x88U
+
+typedef enum
+{
+  SENSOR_PAYLOAD_OP_SUCCESS = 0,
+  SENSOR_PAYLOAD_OP_FAIL = 1,
+  SENSOR_PAYLOAD_OP_FULL = 2,
+} SENSOR_PAYLOAD_op_result_t;
+
+typedef struct
+{
+  uint32_t Time;       /* Seconds, uptime or calendar time */
+  int16_t Temperature; /* 0.1 degree Celsius */
+  uint16_t Humidity;   /* 0.1 % relative humidity */
+  uint8_t Battery;     /* 0.1 V */
+} SENSOR_PAYLOAD_Sample_t;
+
+typedef struct
+{
+  SENSOR_PAYLOAD_Sample_t Samples[SENSOR_PAYLOAD_MAX_SAMPLES];
+  uint8_t Count;
+  uint8_t Size;                                /* Encoded size of the samples */
+  uint8_t Buffer[SENSOR_PAYLOAD_BUFFER_SIZE];  /* Encoded samples */
+} SENSOR_PAYLOAD_Block_t;
+
+/**
+ * @brief Empties a block
+ * @param block block to empty
+ */
+void SENSOR_PAYLOAD_Reset(SENSOR_PAYLOAD_Block_t *block);
+
+/**
+ * @brief Adds a sample to a block and encodes it
+ * @param block block the sample is added to
+ * @param sample sample, not older than the last sample of the block
+ * @param max_size largest encoded size of the block in bytes
+ * @return SENSOR_PAYLOAD_OP_FULL if the sample does not fit, the block is unchanged
+ */
+SENSOR_PAYLOAD_op_result_t SENSOR_PAYLOAD_Add(SENSOR_PAYLOAD_Block_t *block, const SENSOR_PAYLOAD_Sample_t *sample, uint8_t max_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_PAYLOAD_H */
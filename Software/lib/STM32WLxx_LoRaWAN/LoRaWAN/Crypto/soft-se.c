@@ -50,6 +50,7 @@
 #include "utilities.h"
 #include "LoRaMacHeaderTypes.h"
 #include "secure-element.h"
+#include "LoRaMacInstance.h"
 #include "se-identity.h"
 #include "GNSE_tracer.h"
 
@@ -79,6 +80,13 @@
 #endif /* LORAMAC_MAX_MC_CTX */
 #endif /* USE_LRWAN_1_1_X_CRYPTO */
 
+/*!
+ * Slot of a key in the key list. The unicast keys and the multicast keys are two contiguous ranges of
+ * KeyIdentifier_t, the key list holds them one after the other in the order of the identifiers.
+ */
+#define KEY_SLOT(ID)     ( ( (ID) < LORAMAC_CRYPTO_MULTICAST_KEYS ) ?                                                \
+                           ( uint32_t )(ID) : ( ( uint32_t )(ID) - MC_KE_KEY + MC_ROOT_KEY + 1 ) )
+
 /*!
  * MIC computation offset
  * \remark required for 1.1.x support
@@ -152,31 +160,37 @@ typedef struct sSecureElementNvCtx
   Key_t KeyList[NUM_OF_KEYS];
 } SecureElementNvCtx_t;
 
+_Static_assert(sizeof(SecureElementNvCtx_t) <= sizeof(((SecureElementCtx_t *)0)->NvmCtx),
+               "SecureElementNvCtx_t does not fit SECURE_ELEMENT_CTX_SIZE");
+
 /* Private variables ---------------------------------------------------------*/
 /*!
- * Secure element context
+ * Secure element context of the current LoRaMac instance
  */
-static SecureElementNvCtx_t SeNvmCtx =
-{
-  /*!
-   * end-device IEEE EUI (big endian)
-   *
-   * \remark In this application the value is automatically generated by calling
-   *         BoardGetUniqueId function
-   */
-  .DevEui = LORAWAN_DEVICE_EUI,
-  /*!
-   * App/Join server IEEE EUI (big endian)
-   */
-  .JoinEui = LORAWAN_JOIN_EUI
-};
+#define SeNvmCtx         (*(SecureElementNvCtx_t *)LoRaMacCurrentInstance->SecureElement.NvmCtx)
+
+/*!
+ * Callback of the secure element context changes of the current LoRaMac instance
+ */
+#define SeNvmCtxChanged  (LoRaMacCurrentInstance->SecureElement.NvmCtxChanged)
+
+/*!
+ * end-device IEEE EUI (big endian)
+ *
+ * \remark In this application the value is automatically generated by calling
+ *         BoardGetUniqueId function
+ */
+static const uint8_t InitialDevEui[SE_EUI_SIZE] = LORAWAN_DEVICE_EUI;
+
+/*!
+ * App/Join server IEEE EUI (big endian)
+ */
+static const uint8_t InitialJoinEui[SE_EUI_SIZE] = LORAWAN_JOIN_EUI;
 
 #if (!defined (LORAWAN_KMS) || (LORAWAN_KMS == 0))
 static const Key_t InitialKeyList[NUM_OF_KEYS] = SOFT_SE_KEY_LIST;
 #endif /* LORAWAN_KMS == 0 */
 
-static SecureElementNvmEvent SeNvmCtxChanged;
-
 #if (!defined (LORAWAN_KMS) || (LORAWAN_KMS == 0))
 #else /* LORAWAN_KMS == 1 */
 static CK_ULONG DeriveKey_template_class = CKO_SECRET_KEY;
@@ -198,12 +212,14 @@ static CK_ATTRIBUTE DeriveKey_template[] =
  * - align to 32 bits and
  * - for Cmac combine InitVector + input buff
  */
-static uint8_t input_align_combined_buf[PAYLOAD_MAX_SIZE + SE_KEY_SIZE] ALIGN(4);
-static uint8_t output_align[PAYLOAD_MAX_SIZE] ALIGN(4);
-static uint8_t tag[SE_KEY_SIZE] ALIGN(4) = {0};
+static LORAMAC_THREAD_LOCAL uint8_t input_align_combined_buf[PAYLOAD_MAX_SIZE + SE_KEY_SIZE] ALIGN(4);
+static LORAMAC_THREAD_LOCAL uint8_t output_align[PAYLOAD_MAX_SIZE] ALIGN(4);
+static LORAMAC_THREAD_LOCAL uint8_t tag[SE_KEY_SIZE] ALIGN(4) = {0};
 #endif /* LORAWAN_KMS */
 
 /* Private functions prototypes ---------------------------------------------------*/
+static void SortKeyList(void);
+static Key_t *GetKeySlot(KeyIdentifier_t keyID);
 #if (!defined (LORAWAN_KMS) || (LORAWAN_KMS == 0))
 static SecureElementStatus_t GetKeyByID(KeyIdentifier_t keyID, Key_t **keyItem);
 #else /* LORAWAN_KMS == 1 */
@@ -215,6 +231,45 @@ static SecureElementStatus_t ComputeCmac(uint8_t *micBxBuffer, uint8_t *buffer,
 static void DummyCB(void);
 
 /* Private functions ---------------------------------------------------------*/
+/*
+ * Moves every key of the key list to the slot of its identifier, see KEY_SLOT.
+ * Keys without a valid slot and duplicates are left in place.
+ */
+static void SortKeyList(void)
+{
+  Key_t tmp;
+
+  for (uint32_t i = 0; i < NUM_OF_KEYS; i++)
+  {
+    uint32_t slot = KEY_SLOT(SeNvmCtx.KeyList[i].KeyID);
+
+    while ((slot != i) && (slot < NUM_OF_KEYS) && (SeNvmCtx.KeyList[slot].KeyID != SeNvmCtx.KeyList[i].KeyID))
+    {
+      tmp = SeNvmCtx.KeyList[slot];
+      SeNvmCtx.KeyList[slot] = SeNvmCtx.KeyList[i];
+      SeNvmCtx.KeyList[i] = tmp;
+      slot = KEY_SLOT(SeNvmCtx.KeyList[i].KeyID);
+    }
+  }
+}
+
+/*
+ * Gets the key list entry of a key identifier.
+ *
+ * \param[IN]  keyID          - Key identifier
+ * \retval                    - Key list entry, NULL if the key is not in the list
+ */
+static Key_t *GetKeySlot(KeyIdentifier_t keyID)
+{
+  uint32_t slot = KEY_SLOT(keyID);
+
+  if ((slot < NUM_OF_KEYS) && (SeNvmCtx.KeyList[slot].KeyID == keyID))
+  {
+    return &(SeNvmCtx.KeyList[slot]);
+  }
+  return NULL;
+}
+
 #if (!defined (LORAWAN_KMS) || (LORAWAN_KMS == 0))
 /*
  * Gets key item from key list.
@@ -225,15 +280,14 @@ static void DummyCB(void);
  */
 static SecureElementStatus_t GetKeyByID(KeyIdentifier_t keyID, Key_t **keyItem)
 {
-  for (uint8_t i = 0; i < NUM_OF_KEYS; i++)
+  Key_t *key = GetKeySlot(keyID);
+
+  if (key == NULL)
   {
-    if (SeNvmCtx.KeyList[i].KeyID == keyID)
-    {
-      *keyItem = &(SeNvmCtx.KeyList[i]);
-      return SECURE_ELEMENT_SUCCESS;
-    }
+    return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
   }
-  return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
+  *keyItem = key;
+  return SECURE_ELEMENT_SUCCESS;
 }
 
 #else /* LORAWAN_KMS == 1 */
@@ -247,15 +301,14 @@ static SecureElementStatus_t GetKeyByID(KeyIdentifier_t keyID, Key_t **keyItem)
  */
 static SecureElementStatus_t GetKeyIndexByID(KeyIdentifier_t keyID, CK_OBJECT_HANDLE *keyIndex)
 {
-  for (uint8_t i = 0; i < NUM_OF_KEYS; i++)
+  Key_t *key = GetKeySlot(keyID);
+
+  if (key == NULL)
   {
-    if (SeNvmCtx.KeyList[i].KeyID == keyID)
-    {
-      *keyIndex = SeNvmCtx.KeyList[i].Object_Index;
-      return SECURE_ELEMENT_SUCCESS;
-    }
+    return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
   }
-  return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
+  *keyIndex = key->Object_Index;
+  return SECURE_ELEMENT_SUCCESS;
 }
 
 #endif /* LORAWAN_KMS */
@@ -397,9 +450,17 @@ SecureElementStatus_t SecureElementInit(SecureElementNvmEvent seNvmCtxChanged)
 #if (!defined (LORAWAN_KMS) || (LORAWAN_KMS == 0))
   Key_t *keyItem;
   SecureElementStatus_t retval = SECURE_ELEMENT_ERROR;
+#endif /* LORAWAN_KMS == 0 */
+
+  /* Initialize the context of the instance */
+  memset1((uint8_t *)&SeNvmCtx, 0, sizeof(SeNvmCtx));
+  memcpy1(SeNvmCtx.DevEui, InitialDevEui, SE_EUI_SIZE);
+  memcpy1(SeNvmCtx.JoinEui, InitialJoinEui, SE_EUI_SIZE);
 
+#if (!defined (LORAWAN_KMS) || (LORAWAN_KMS == 0))
   /* Initialize LoRaWAN Key List buffer */
   memcpy1((uint8_t *)(SeNvmCtx.KeyList), (const uint8_t *)InitialKeyList, sizeof(Key_t)*NUM_OF_KEYS);
+  SortKeyList();
 
   retval = GetKeyByID(APP_KEY, &keyItem);
   KEY_LOG(ADV_TRACER_TS_OFF, ADV_TRACER_VLEVEL_M, "###### OTAA ######\r\n");
@@ -456,6 +517,7 @@ SecureElementStatus_t SecureElementInit(SecureElementNvmEvent seNvmCtxChanged)
   SeNvmCtx.KeyList[itr++].KeyID = MC_NWK_S_KEY_3;
 #endif /*LORAMAC_MAX_MC_CTX > 1 */
   SeNvmCtx.KeyList[itr].KeyID = SLOT_RAND_ZERO_KEY;
+  SortKeyList();
 
 #endif /* LORAWAN_KMS */
 
@@ -528,6 +590,8 @@ SecureElementStatus_t SecureElementRestoreNvmCtx(void *seNvmCtx)
   if (seNvmCtx != 0)
   {
     memcpy1((uint8_t *) &SeNvmCtx, (uint8_t *) seNvmCtx, sizeof(SeNvmCtx));
+    /* Contexts saved before the keys were stored by slot */
+    SortKeyList();
     return SECURE_ELEMENT_SUCCESS;
   }
   else
@@ -550,36 +614,35 @@ SecureElementStatus_t SecureElementSetKey(KeyIdentifier_t keyID, uint8_t *key)
   }
 
 #if (!defined (LORAWAN_KMS) || (LORAWAN_KMS == 0))
-  for (uint8_t i = 0; i < NUM_OF_KEYS; i++)
+  Key_t *keyItem = GetKeySlot(keyID);
+
+  if (keyItem == NULL)
   {
-    if (SeNvmCtx.KeyList[i].KeyID == keyID)
-    {
+    return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
+  }
 #if ( LORAMAC_MAX_MC_CTX == 1 )
-      if (keyID == MC_KEY_0)
+  if (keyID == MC_KEY_0)
 #else /* LORAMAC_MAX_MC_CTX > 1 */
-      if ((keyID == MC_KEY_0) || (keyID == MC_KEY_1) || (keyID == MC_KEY_2) || (keyID == MC_KEY_3))
+  if ((keyID == MC_KEY_0) || (keyID == MC_KEY_1) || (keyID == MC_KEY_2) || (keyID == MC_KEY_3))
 #endif /* LORAMAC_MAX_MC_CTX */
-      {
-        /* Decrypt the key if its a Mckey */
-        SecureElementStatus_t retval = SECURE_ELEMENT_ERROR;
-        uint8_t decryptedKey[16] = { 0 };
-
-        retval = SecureElementAesEncrypt(key, 16, MC_KE_KEY, decryptedKey);
-
-        memcpy1(SeNvmCtx.KeyList[i].KeyValue, decryptedKey, SE_KEY_SIZE);
-        SeNvmCtxChanged();
-
-        return retval;
-      }
-      else
-      {
-        memcpy1(SeNvmCtx.KeyList[i].KeyValue, key, SE_KEY_SIZE);
-        SeNvmCtxChanged();
-        return SECURE_ELEMENT_SUCCESS;
-      }
-    }
+  {
+    /* Decrypt the key if its a Mckey */
+    SecureElementStatus_t retval = SECURE_ELEMENT_ERROR;
+    uint8_t decryptedKey[16] = { 0 };
+
+    retval = SecureElementAesEncrypt(key, 16, MC_KE_KEY, decryptedKey);
+
+    memcpy1(keyItem->KeyValue, decryptedKey, SE_KEY_SIZE);
+    SeNvmCtxChanged();
+
+    return retval;
+  }
+  else
+  {
+    memcpy1(keyItem->KeyValue, key, SE_KEY_SIZE);
+    SeNvmCtxChanged();
+    return SECURE_ELEMENT_SUCCESS;
   }
-  return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
 #else /* LORAWAN_KMS == 1 */
   /* Indexes are already stored at init or when deriving the key */
   CK_OBJECT_HANDLE keyIndex;
@@ -592,16 +655,15 @@ SecureElementStatus_t SecureElementSetObjHandler(KeyIdentifier_t keyID, uint32_t
 #if (!defined (LORAWAN_KMS) || (LORAWAN_KMS == 0))
   return SECURE_ELEMENT_ERROR;
 #else /* LORAWAN_KMS == 1 */
-  for (uint8_t i = 0; i < NUM_OF_KEYS; i++)
+  Key_t *keyItem = GetKeySlot(keyID);
+
+  if (keyItem == NULL)
   {
-    if (SeNvmCtx.KeyList[i].KeyID == keyID)
-    {
-      SeNvmCtx.KeyList[i].Object_Index = (CK_OBJECT_HANDLE) keyIndex;
-      SeNvmCtxChanged();
-      return SECURE_ELEMENT_SUCCESS;
-    }
+    return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
   }
-  return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
+  keyItem->Object_Index = (CK_OBJECT_HANDLE) keyIndex;
+  SeNvmCtxChanged();
+  return SECURE_ELEMENT_SUCCESS;
 #endif /* LORAWAN_KMS */
 }
 
@@ -854,6 +916,66 @@ SecureElementStatus_t SecureElementDeriveAndStoreKey(Version_t version, uint8_t
   return retval;
 }
 
+SecureElementStatus_t SecureElementDeriveAndStoreKeys(Version_t version, KeyIdentifier_t rootKeyID,
+                                                      SecureElementDerivation_t *derivations, uint8_t nbDerivations)
+{
+  SecureElementStatus_t retval = SECURE_ELEMENT_SUCCESS;
+  if (derivations == NULL)
+  {
+    return SECURE_ELEMENT_ERROR_NPE;
+  }
+
+  for (uint8_t i = 0; i < nbDerivations; i++)
+  {
+    /* In case of MC_KE_KEY, only McRootKey can be used as root key */
+    if (((derivations[i].TargetKeyID == MC_KE_KEY) && (rootKeyID != MC_ROOT_KEY)) ||
+        (GetKeySlot(derivations[i].TargetKeyID) == NULL))
+    {
+      return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
+    }
+  }
+
+#if (!defined (LORAWAN_KMS) || (LORAWAN_KMS == 0))
+  lorawan_aes_context aesContext;
+  uint8_t key[16] = { 0 };
+  Key_t *rootKey;
+
+  retval = GetKeyByID(rootKeyID, &rootKey);
+  if (retval != SECURE_ELEMENT_SUCCESS)
+  {
+    return retval;
+  }
+
+  /* Expand the root key once for all the derived keys */
+  memset1(aesContext.ksch, '\0', 240);
+  lorawan_aes_set_key(rootKey->KeyValue, 16, &aesContext);
+
+  for (uint8_t i = 0; i < nbDerivations; i++)
+  {
+    /* Derive key */
+    lorawan_aes_encrypt(derivations[i].Input, key, &aesContext);
+
+    /* Store key */
+    retval = SecureElementSetKey(derivations[i].TargetKeyID, key);
+    if (retval != SECURE_ELEMENT_SUCCESS)
+    {
+      return retval;
+    }
+  }
+#else /* LORAWAN_KMS == 1 */
+  for (uint8_t i = 0; i < nbDerivations; i++)
+  {
+    retval = SecureElementDeriveAndStoreKey(version, derivations[i].Input, rootKeyID, derivations[i].TargetKeyID);
+    if (retval != SECURE_ELEMENT_SUCCESS)
+    {
+      return retval;
+    }
+  }
+#endif /* LORAWAN_KMS */
+
+  return retval;
+}
+
 SecureElementStatus_t SecureElementProcessJoinAccept(JoinReqIdentifier_t joinReqType, uint8_t *joinEui,
                                                      uint16_t devNonce, uint8_t *encJoinAccept,
                                                      uint8_t encJoinAcceptSize, uint8_t *decJoinAccept,
@@ -964,6 +1086,15 @@ SecureElementStatus_t SecureElementRandomNumber(uint32_t *randomNum)
   return SECURE_ELEMENT_SUCCESS;
 }
 
+void SecureElementBeginSession(void)
+{
+  /* The software secure element has no wake up cost */
+}
+
+void SecureElementEndSession(void)
+{
+}
+
 SecureElementStatus_t SecureElementSetDevEui(uint8_t *devEui)
 {
   if (devEui == NULL)
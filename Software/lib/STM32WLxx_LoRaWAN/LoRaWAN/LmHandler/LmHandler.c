@@ -307,6 +307,7 @@ LmHandlerErrorStatus_t LmHandlerInit(LmHandlerCallbacks_t *handlerCallbacks)
   LoRaMacCallbacks.GetTemperatureLevel = LmHandlerCallbacks.GetTemperature;
   LoRaMacCallbacks.NvmContextChange = NvmCtxMgmtEvent;
   LoRaMacCallbacks.MacProcessNotify = LmHandlerCallbacks.OnMacProcess;
+  LoRaMacCallbacks.ReserveFCntUp = NvmCtxMgmtReserveFCntUp;
 
   /*The LoRa-Alliance Compliance protocol package should always be initialized and activated.*/
   if (LmHandlerPackageRegister(PACKAGE_ID_COMPLIANCE, &LmhpComplianceParams) != LORAMAC_HANDLER_SUCCESS)
@@ -547,6 +548,9 @@ void LmHandlerJoin(ActivationType_t mode)
     mibReq.Param.NetworkActivation = ACTIVATION_TYPE_ABP;
     LoRaMacMibSetRequestConfirm(&mibReq);
 
+    /* Resume the uplink frame counter of the ABP session, if it was persisted */
+    NvmCtxMgmtRestoreFCnt();
+
     LmHandlerCallbacks.OnJoinRequest(&JoinParams);
     LmHandlerRequestClass(LmHandlerParams.DefaultClass);
   }
@@ -566,6 +570,13 @@ LmHandlerErrorStatus_t LmHandlerStop(void)
 
 LmHandlerErrorStatus_t LmHandlerSend(LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed,
                                      TimerTime_t *nextTxIn, bool allowDelayedTx)
+{
+  return LmHandlerSendWithPolicy(appData, isTxConfirmed, NULL, nextTxIn, allowDelayedTx);
+}
+
+LmHandlerErrorStatus_t LmHandlerSendWithPolicy(LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed,
+                                               const LoRaMacRetransPolicy_t *retransPolicy, TimerTime_t *nextTxIn,
+                                               bool allowDelayedTx)
 {
   LoRaMacStatus_t status;
   LmHandlerErrorStatus_t lmhStatus = LORAMAC_HANDLER_ERROR;
@@ -613,6 +624,7 @@ LmHandlerErrorStatus_t LmHandlerSend(LmHandlerAppData_t *appData, LmHandlerMsgTy
     {
       mcpsReq.Type = MCPS_CONFIRMED;
       mcpsReq.Req.Confirmed.NbTrials = 8;
+      mcpsReq.Req.Confirmed.RetransPolicy = retransPolicy;
     }
   }
 
@@ -661,6 +673,25 @@ LmHandlerErrorStatus_t LmHandlerSend(LmHandlerAppData_t *appData, LmHandlerMsgTy
   return lmhStatus;
 }
 
+LmHandlerErrorStatus_t LmHandlerGetTxBuffer(uint8_t **buffer, uint8_t *size)
+{
+  if (LmHandlerJoinStatus() != LORAMAC_HANDLER_SET)
+  {
+    /* The join request uses the frame buffer */
+    return LORAMAC_HANDLER_NO_NETWORK_JOINED;
+  }
+
+  switch (LoRaMacGetTxPayloadBuffer(buffer, size))
+  {
+  case LORAMAC_STATUS_OK:
+    return LORAMAC_HANDLER_SUCCESS;
+  case LORAMAC_STATUS_BUSY:
+    return LORAMAC_HANDLER_BUSY_ERROR;
+  default:
+    return LORAMAC_HANDLER_ERROR;
+  }
+}
+
 LmHandlerErrorStatus_t LmHandlerRequestClass(DeviceClass_t newClass)
 {
   MibRequestConfirm_t mibReq;
@@ -1385,6 +1416,7 @@ static void McpsConfirm(McpsConfirm_t *mcpsConfirm)
   TxParams.UplinkCounter = mcpsConfirm->UpLinkCounter;
   TxParams.TxPower = mcpsConfirm->TxPower;
   TxParams.Channel = mcpsConfirm->Channel;
+  TxParams.TxTimeOnAir = mcpsConfirm->TxTimeOnAir;
   TxParams.AckReceived = mcpsConfirm->AckReceived;
 
   LmHandlerCallbacks.OnTxData(&TxParams);
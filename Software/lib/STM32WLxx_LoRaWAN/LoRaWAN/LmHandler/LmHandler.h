@@ -70,6 +70,7 @@ typedef struct LmHandlerTxParams_s
   LmHandlerAppData_t AppData;
   int8_t TxPower;
   uint8_t Channel;
+  TimerTime_t TxTimeOnAir;
 } LmHandlerTxParams_t;
 
 /*!
@@ -225,6 +226,38 @@ void LmHandlerProcess(void);
 LmHandlerErrorStatus_t LmHandlerSend(LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed,
                                      TimerTime_t *nextTxIn, bool allowDelayedTx);
 
+/*!
+ * \brief Instructs the MAC layer to send a ClassA uplink, retransmitted with the
+ *        given policy when it is confirmed
+ *
+ * \param [in] appData Data to be sent
+ * \param [in] isTxConfirmed Indicates if the uplink requires an acknowledgement
+ * \param [in] retransPolicy Deadline, backoff and datarate of the retransmissions,
+ *                           NULL for the LoRaWAN default
+ * \param [out] nextTxIn Time before next uplink window available
+ * \param [in] allowDelayedTx when set to true, the frame will be delayed
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if request has been
+ *                processed else \ref LORAMAC_HANDLER_ERROR
+ */
+LmHandlerErrorStatus_t LmHandlerSendWithPolicy(LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed,
+                                               const LoRaMacRetransPolicy_t *retransPolicy, TimerTime_t *nextTxIn,
+                                               bool allowDelayedTx);
+
+/*!
+ * \brief Gets the buffer of the next uplink payload in the MAC frame buffer
+ *
+ * \note An appData pointing to this buffer is sent without copies. The payload
+ *       must be written and sent before \ref LmHandlerProcess runs again.
+ *
+ * \param [out] buffer Buffer to write the application payload to
+ * \param [out] size Size of the buffer
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if the buffer is available,
+ *                \ref LORAMAC_HANDLER_BUSY_ERROR while the MAC uses it
+ */
+LmHandlerErrorStatus_t LmHandlerGetTxBuffer(uint8_t **buffer, uint8_t *size);
+
 /*!
  * \brief   Check whether the Device is joined to the network
  *
@@ -42,6 +42,11 @@
   */
 /* Includes ------------------------------------------------------------------*/
 #include "NvmCtxMgmt.h"
+#if ( LORAWAN_FCNT_STORE_ENABLED == 1 )
+#include "LoRaMacCrypto.h"
+#include "GNSE_tracer.h"
+#include "FCNT_STORE.h"
+#endif /* LORAWAN_FCNT_STORE_ENABLED == 1 */
 
 /* Private typedef -----------------------------------------------------------*/
 #if ( CONTEXT_MANAGEMENT_ENABLED == 1 )
@@ -397,4 +402,54 @@ NvmCtxMgmtStatus_t NvmCtxMgmtRestore(void)
 #endif /* CONTEXT_MANAGEMENT_ENABLED */
 }
 
+NvmCtxMgmtStatus_t NvmCtxMgmtRestoreFCnt(void)
+{
+#if ( LORAWAN_FCNT_STORE_ENABLED == 1 )
+  MibRequestConfirm_t mibReq;
+  uint32_t nextUp;
+
+  mibReq.Type = MIB_NETWORK_ACTIVATION;
+  LoRaMacMibGetRequestConfirm(&mibReq);
+  if (mibReq.Param.NetworkActivation != ACTIVATION_TYPE_ABP)
+  {
+    return NVMCTXMGMT_STATUS_FAIL;
+  }
+
+  if (FCNT_STORE_Restore(&nextUp) != FCNT_STORE_OP_SUCCESS)
+  {
+    return NVMCTXMGMT_STATUS_FAIL;
+  }
+
+  if (LoRaMacCryptoSetFCntUp(nextUp) != LORAMAC_CRYPTO_SUCCESS)
+  {
+    return NVMCTXMGMT_STATUS_FAIL;
+  }
+  return NVMCTXMGMT_STATUS_SUCCESS;
+#else /* LORAWAN_FCNT_STORE_ENABLED == 0 */
+  return NVMCTXMGMT_STATUS_FAIL;
+#endif /* LORAWAN_FCNT_STORE_ENABLED */
+}
+
+bool NvmCtxMgmtReserveFCntUp(uint32_t fCntUp)
+{
+#if ( LORAWAN_FCNT_STORE_ENABLED == 1 )
+  MibRequestConfirm_t mibReq;
+
+  /* OTAA sessions are not restored, their frame counters restart with every join */
+  mibReq.Type = MIB_NETWORK_ACTIVATION;
+  LoRaMacMibGetRequestConfirm(&mibReq);
+  if (mibReq.Param.NetworkActivation != ACTIVATION_TYPE_ABP)
+  {
+    return true;
+  }
+
+  if (FCNT_STORE_Update(fCntUp) != FCNT_STORE_OP_SUCCESS)
+  {
+    LIB_LOG(ADV_TRACER_TS_ON, ADV_TRACER_VLEVEL_ALWAYS, "error: frame counter could not be persisted, uplink not sent\r\n");
+    return false;
+  }
+#endif /* LORAWAN_FCNT_STORE_ENABLED == 1 */
+  return true;
+}
+
 /* Private  functions ---------------------------------------------------------*/
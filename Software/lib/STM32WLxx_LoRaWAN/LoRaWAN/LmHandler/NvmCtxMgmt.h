@@ -55,6 +55,13 @@ extern "C" {
 #include "LoRaMac.h"
 
 /* Exported defines ----------------------------------------------------------*/
+/*!
+ * Enables/Disables the uplink frame counter persistence of ABP sessions, see FCNT_STORE.h
+ */
+#ifndef LORAWAN_FCNT_STORE_ENABLED
+#define LORAWAN_FCNT_STORE_ENABLED         0
+#endif /* LORAWAN_FCNT_STORE_ENABLED */
+
 /* Exported constants --------------------------------------------------------*/
 /* Exported types ------------------------------------------------------------*/
 /*!
@@ -87,6 +94,22 @@ NvmCtxMgmtStatus_t NvmCtxMgmtStore(void);
 
 NvmCtxMgmtStatus_t NvmCtxMgmtRestore(void);
 
+/*!
+ * \brief Resumes the uplink frame counter of the active ABP session from the frame counter store.
+ *
+ * \retval NVMCTXMGMT_STATUS_SUCCESS if the frame counter was moved forward
+ */
+NvmCtxMgmtStatus_t NvmCtxMgmtRestoreFCnt(void);
+
+/*!
+ * \brief Persists the uplink frame counter of the active ABP session before its first use.
+ *
+ * \param [in] fCntUp uplink frame counter of the frame about to be sent
+ *
+ * \retval false if the frame counter was used before or could not be persisted, the frame must not be sent
+ */
+bool NvmCtxMgmtReserveFCntUp(uint32_t fCntUp);
+
 
 #ifdef __cplusplus
 }
@@ -57,7 +57,9 @@
 #include "LoRaMacSerializer.h"
 
 #include "LoRaMac.h"
+#include "LoRaMacInstance.h"
 #include "GNSE_tracer.h"
+#include "stm32_evt_trace.h"
 
 /* Private macro -------------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -68,16 +70,6 @@
 #define LORAMAC_VERSION                             0x01000300
 #endif
 
-/*!
- * Maximum PHY layer payload size
- */
-#define LORAMAC_PHY_MAXPAYLOAD                      255
-
-/*!
- * Maximum MAC commands buffer size
- */
-#define LORA_MAC_COMMAND_MAX_LENGTH                 128
-
 /*!
  * Maximum length of the fOpts field
  */
@@ -98,6 +90,21 @@
  */
 #define BACKOFF_DC_24_HOURS                         10000
 
+/*!
+ * Upper limit in ms of the backoff of a retransmission before its jitter,
+ * 24 hours. The delay with the jitter stays below INT32_MAX.
+ */
+#define RETRANS_MAX_DELAY                           86400000
+
+/*!
+ * Radio events in the event trace, the bits of LoRaMacRadioEvents_t
+ */
+#define LORAMAC_TRACE_RX_TIMEOUT                    0x01
+#define LORAMAC_TRACE_RX_ERROR                      0x02
+#define LORAMAC_TRACE_TX_TIMEOUT                    0x04
+#define LORAMAC_TRACE_RX_DONE                       0x08
+#define LORAMAC_TRACE_TX_DONE                       0x10
+
 /* Private typedef -----------------------------------------------------------*/
 /*!
  * LoRaMac internal states
@@ -114,311 +121,45 @@ enum eLoRaMacState
     LORAMAC_RX_ABORT      = 0x00000080,
 };
 
+/* Private variables ---------------------------------------------------------*/
 /*
- * Request permission state
+ * Instance used by the LoRaMac API when no other instance is selected.
  */
-typedef enum eLoRaMacRequestHandling
-{
-    LORAMAC_REQUEST_HANDLING_OFF = 0,
-    LORAMAC_REQUEST_HANDLING_ON = !LORAMAC_REQUEST_HANDLING_OFF
-}LoRaMacRequestHandling_t;
-
-typedef struct sLoRaMacNvmCtx
-{
-    /*
-     * LoRaMac region.
-     */
-    LoRaMacRegion_t Region;
-    /*
-     * LoRaMac default parameters
-     */
-    LoRaMacParams_t MacParamsDefaults;
-    /*
-     * Network ID ( 3 bytes )
-     */
-    uint32_t NetID;
-    /*
-     * Mote Address
-     */
-    uint32_t DevAddr;
-    /*!
-    * Multicast channel list
-    */
-    MulticastCtx_t MulticastChannelList[LORAMAC_MAX_MC_CTX];
-    /*
-     * Actual device class
-     */
-    DeviceClass_t DeviceClass;
-    /*
-     * Indicates if the node is connected to
-     * a private or public network
-     */
-    bool PublicNetwork;
-    /*
-     * LoRaMac ADR control status
-     */
-    bool AdrCtrlOn;
-    /*
-     * Counts the number of missed ADR acknowledgements
-     */
-    uint32_t AdrAckCounter;
-
-    /*
-     * LoRaMac parameters
-     */
-    LoRaMacParams_t MacParams;
-    /*
-     * Maximum duty cycle
-     * \remark Possibility to shutdown the device.
-     */
-    uint8_t MaxDCycle;
-    /*
-    * Enables/Disables duty cycle management (Test only)
-    */
-    bool DutyCycleOn;
-    /*
-     * Holds the current rx window slot
-     */
-    bool RepeaterSupport;
-    /*
-     * Buffer containing the MAC layer commands
-     */
-    uint8_t MacCommandsBuffer[LORA_MAC_COMMAND_MAX_LENGTH];
-    /*
-     * If the server has sent a FRAME_TYPE_DATA_CONFIRMED_DOWN this variable indicates
-     * if the ACK bit must be set for the next transmission
-     */
-    bool SrvAckRequested;
-    /*
-     * Aggregated duty cycle management
-     */
-    uint16_t AggregatedDCycle;
-    /*
-    * Aggregated duty cycle management
-    */
-    TimerTime_t LastTxDoneTime;
-    TimerTime_t AggregatedTimeOff;
-    /*
-    * Stores the time at LoRaMac initialization.
-    *
-    * \remark Used for the BACKOFF_DC computation.
-    */
-    SysTime_t InitializationTime;
-    /*
-     * Current LoRaWAN Version
-     */
-    Version_t Version;
-    /*
-     * End-Device network activation
-     */
-    ActivationType_t NetworkActivation;
-    /*!
-     * Last received Message integrity Code (MIC)
-     */
-    uint32_t LastRxMic;
-}LoRaMacNvmCtx_t;
+static LoRaMacInstance_t LoRaMacDefaultInstance;
 
-typedef struct sLoRaMacCtx
-{
-    /*
-    * Length of packet in PktBuffer
-    */
-    uint16_t PktBufferLen;
-    /*
-    * Buffer containing the data to be sent or received.
-    */
-    uint8_t PktBuffer[LORAMAC_PHY_MAXPAYLOAD];
-    /*!
-    * Current processed transmit message
-    */
-    LoRaMacMessage_t TxMsg;
-    /*!
-    * Buffer containing the data received by the application.
-    */
-    uint8_t AppData[LORAMAC_PHY_MAXPAYLOAD];
-    /*
-    * Size of buffer containing the application data.
-    */
-    uint8_t AppDataSize;
-    /*
-    * Buffer containing the upper layer data.
-    */
-    uint8_t RxPayload[LORAMAC_PHY_MAXPAYLOAD];
-    SysTime_t LastTxSysTime;
-    /*
-    * LoRaMac internal state
-    */
-    uint32_t MacState;
-    /*
-    * LoRaMac upper layer event functions
-    */
-    LoRaMacPrimitives_t* MacPrimitives;
-    /*
-    * LoRaMac upper layer callback functions
-    */
-    LoRaMacCallback_t* MacCallbacks;
-    /*
-    * Radio events function pointer
-    */
-    RadioEvents_t RadioEvents;
-    /*
-    * LoRaMac duty cycle delayed Tx timer
-    */
-    TimerEvent_t TxDelayedTimer;
-    /*
-    * LoRaMac reception windows timers
-    */
-    TimerEvent_t RxWindowTimer1;
-    TimerEvent_t RxWindowTimer2;
-    /*
-    * LoRaMac reception windows delay
-    * \remark normal frame: RxWindowXDelay = ReceiveDelayX - RADIO_WAKEUP_TIME
-    *         join frame  : RxWindowXDelay = JoinAcceptDelayX - RADIO_WAKEUP_TIME
-    */
-    uint32_t RxWindow1Delay;
-    uint32_t RxWindow2Delay;
-    /*
-    * LoRaMac Rx windows configuration
-    */
-    RxConfigParams_t RxWindow1Config;
-    RxConfigParams_t RxWindow2Config;
-    RxConfigParams_t RxWindowCConfig;
-    /*
-     * Limit of uplinks without any donwlink response before the ADRACKReq bit will be set.
-     */
-    uint16_t AdrAckLimit;
-    /*
-     * Limit of uplinks without any donwlink response after a the first frame with set ADRACKReq bit
-     * before the trying to regain the connectivity.
-     */
-    uint16_t AdrAckDelay;
-    /*
-    * Acknowledge timeout timer. Used for packet retransmissions.
-    */
-    TimerEvent_t AckTimeoutTimer;
-    /*
-     * Uplink messages repetitions counter
-     */
-    uint8_t ChannelsNbTransCounter;
-    /*
-     * Number of trials to get a frame acknowledged
-     */
-    uint8_t AckTimeoutRetries;
-    /*
-     * Number of trials to get a frame acknowledged
-     */
-    uint8_t AckTimeoutRetriesCounter;
-    /*
-     * Indicates if the AckTimeout timer has expired or not
-     */
-    bool AckTimeoutRetry;
-    /*
-     * If the node has sent a FRAME_TYPE_DATA_CONFIRMED_UP this variable indicates
-     * if the nodes needs to manage the server acknowledgement.
-     */
-    bool NodeAckRequested;
-    /*
-     * Current channel index
-     */
-    uint8_t Channel;
-    /*
-    * Last transmission time on air
-    */
-    TimerTime_t TxTimeOnAir;
-    /*
-    * Structure to hold an MCPS indication data.
-    */
-    McpsIndication_t McpsIndication;
-    /*
-    * Structure to hold MCPS confirm data.
-    */
-    McpsConfirm_t McpsConfirm;
-    /*
-    * Structure to hold MLME confirm data.
-    */
-    MlmeConfirm_t MlmeConfirm;
-    /*
-    * Structure to hold MLME indication data.
-    */
-    MlmeIndication_t MlmeIndication;
-    /*
-    * Holds the current rx window slot
-    */
-    LoRaMacRxSlot_t RxSlot;
-    /*
-    * LoRaMac tx/rx operation state
-    */
-    LoRaMacFlags_t MacFlags;
-    /*
-    * Data structure indicating if a request is allowed or not.
-    */
-    LoRaMacRequestHandling_t AllowRequests;
-    /*
-    * Non-volatile module context structure
-    */
-    LoRaMacNvmCtx_t* NvmCtx;
-    /*
-    * Duty cycle wait time
-    */
-    TimerTime_t DutyCycleWaitTime;
-}LoRaMacCtx_t;
+LORAMAC_THREAD_LOCAL LoRaMacInstance_t* LoRaMacCurrentInstance = &LoRaMacDefaultInstance;
 
-/*!
- * Defines the LoRaMac radio events status
- */
-typedef union uLoRaMacRadioEvents
-{
-    uint32_t Value;
-    struct sEvents
-    {
-        uint32_t RxTimeout : 1;
-        uint32_t RxError   : 1;
-        uint32_t TxTimeout : 1;
-        uint32_t RxDone    : 1;
-        uint32_t TxDone    : 1;
-    }Events;
-}LoRaMacRadioEvents_t;
+LORAMAC_THREAD_LOCAL LoRaMacInstance_t* LoRaMacRadioOwner = &LoRaMacDefaultInstance;
 
-/*!
- * Structure used to store the radio Tx event data
+/*
+ * Module context of the current instance.
  */
-struct
-{
-    TimerTime_t CurTime;
-}TxDoneParams;
+#define MacCtx                                      ( LoRaMacCurrentInstance->Mac )
 
-/*!
- * Structure used to store the radio Rx event data
+/*
+ * Non-volatile module context of the current instance.
  */
-struct
-{
-    TimerTime_t LastRxDone;
-    uint8_t *Payload;
-    uint16_t Size;
-    int16_t Rssi;
-    int8_t Snr;
-}RxDoneParams;
+#define NvmMacCtx                                   ( LoRaMacCurrentInstance->MacNvm )
 
-/* Private variables ---------------------------------------------------------*/
 /*
- * Module context.
+ * List of module contexts of the current instance.
  */
-static LoRaMacCtx_t MacCtx;
+#define MacContexts                                 ( LoRaMacCurrentInstance->MacContexts )
 
-/*
- * Non-volatile module context.
+/*!
+ * LoRaMac radio events status of the current instance
  */
-static LoRaMacNvmCtx_t NvmMacCtx;
+#define LoRaMacRadioEvents                          ( LoRaMacCurrentInstance->RadioEvents )
 
-/*
- * List of module contexts.
+/*!
+ * Radio Tx event data of the current instance
  */
-static LoRaMacCtxs_t Contexts;
+#define TxDoneParams                                ( LoRaMacCurrentInstance->TxDoneParams )
 
 /*!
- * LoRaMac radio events status
+ * Radio Rx event data of the current instance
  */
-LoRaMacRadioEvents_t LoRaMacRadioEvents = { .Value = 0 };
+#define RxDoneParams                                ( LoRaMacCurrentInstance->RxDoneParams )
 
 /* Private function prototypes -----------------------------------------------*/
 /*!
@@ -572,6 +313,15 @@ static LoRaMacStatus_t SendReJoinReq( JoinReqIdentifier_t joinReqType );
  */
 static LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t* fCtrl, uint8_t fPort, void* fBuffer, uint16_t fBufferSize );
 
+/*!
+ * \brief Returns the position of the FRMPayload in PktBuffer
+ *
+ * \param [IN] fOptsLen Length of the FOpts field
+ *
+ * \retval Offset of the FRMPayload in PktBuffer
+ */
+static uint8_t GetTxPayloadOffset( uint8_t fOptsLen );
+
 /*
  * \brief Schedules the frame according to the duty cycle
  *
@@ -641,6 +391,13 @@ static LoRaMacStatus_t SetTxContinuousWave1( uint16_t timeout, uint32_t frequenc
  */
 static void ResetMacParameters( void );
 
+/*!
+ * \brief Reads the region parameters used on every frame into MacCtx.PhyParams.
+ *        Must be called when the region defaults, the dwell times or the
+ *        repeater support change.
+ */
+static void UpdatePhyParams( void );
+
 /*!
  * \brief Initializes and opens the reception window
  *
@@ -713,11 +470,31 @@ static bool StopRetransmission( void );
 /*!
  * \brief Handles the ACK retries algorithm.
  *        Increments the re-tries counter up until the specified number of
- *        trials or the allowed maximum. Decrease the uplink datarate every 2
- *        trials.
+ *        trials or the allowed maximum. Decrease the uplink datarate as set
+ *        by the retransmission policy, every 2 trials by default.
  */
 static void AckTimeoutRetriesProcess( void );
 
+/*!
+ * \brief Computes the backoff of the retransmission policy before the next
+ *        transmission of a confirmed frame.
+ *
+ * \param [IN] nbTrans Number of transmissions done
+ *
+ * \retval Delay in ms after the RX windows
+ */
+static TimerTime_t GetRetransDelay( uint8_t nbTrans );
+
+/*!
+ * \brief Checks if a retransmission starting after the given delay misses the
+ *        deadline of the retransmission policy.
+ *
+ * \param [IN] delay Delay in ms from now
+ *
+ * \retval True if the retransmission must not be started
+ */
+static bool CheckRetransDeadline( TimerTime_t delay );
+
 /*!
  * \brief Finalizes the ACK retries algorithm.
  *        If no ACK is received restores the default channels
@@ -814,20 +591,27 @@ static void LoRaMacHandleIndicationEvents( void );
 /* Private  functions ---------------------------------------------------------*/
 static void OnRadioTxDone( void )
 {
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( LoRaMacRadioOwner );
+
     TxDoneParams.CurTime = TimerGetCurrentTime( );
     MacCtx.LastTxSysTime = SysTimeGet( );
 
     LoRaMacRadioEvents.Events.TxDone = 1;
+    UTIL_EVT_TRACE( UTIL_EVT_TRACE_MAC_EVENT, LORAMAC_TRACE_TX_DONE, 0 );
 
     if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
     {
         MacCtx.MacCallbacks->MacProcessNotify( );
     }
     LIB_LOG(ADV_TRACER_TS_ON, ADV_TRACER_VLEVEL_M, "MAC txDone\r\n" );
+
+    LoRaMacInstanceSelect( previous );
 }
 
 static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr )
 {
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( LoRaMacRadioOwner );
+
     RxDoneParams.LastRxDone = TimerGetCurrentTime( );
     RxDoneParams.Payload = payload;
     RxDoneParams.Size = size;
@@ -835,44 +619,62 @@ static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t
     RxDoneParams.Snr = snr;
 
     LoRaMacRadioEvents.Events.RxDone = 1;
+    UTIL_EVT_TRACE( UTIL_EVT_TRACE_MAC_EVENT, LORAMAC_TRACE_RX_DONE, 0 );
 
     if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
     {
         MacCtx.MacCallbacks->MacProcessNotify( );
     }
     LIB_LOG(ADV_TRACER_TS_ON, ADV_TRACER_VLEVEL_M, "MAC rxDone\r\n" );
+
+    LoRaMacInstanceSelect( previous );
 }
 
 static void OnRadioTxTimeout( void )
 {
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( LoRaMacRadioOwner );
+
     LoRaMacRadioEvents.Events.TxTimeout = 1;
+    UTIL_EVT_TRACE( UTIL_EVT_TRACE_MAC_EVENT, LORAMAC_TRACE_TX_TIMEOUT, 0 );
 
     if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
     {
         MacCtx.MacCallbacks->MacProcessNotify( );
     }
     LIB_LOG(ADV_TRACER_TS_ON, ADV_TRACER_VLEVEL_M, "MAC txTimeOut\r\n" );
+
+    LoRaMacInstanceSelect( previous );
 }
 
 static void OnRadioRxError( void )
 {
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( LoRaMacRadioOwner );
+
     LoRaMacRadioEvents.Events.RxError = 1;
+    UTIL_EVT_TRACE( UTIL_EVT_TRACE_MAC_EVENT, LORAMAC_TRACE_RX_ERROR, 0 );
 
     if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
     {
         MacCtx.MacCallbacks->MacProcessNotify( );
     }
+
+    LoRaMacInstanceSelect( previous );
 }
 
 static void OnRadioRxTimeout( void )
 {
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( LoRaMacRadioOwner );
+
     LoRaMacRadioEvents.Events.RxTimeout = 1;
+    UTIL_EVT_TRACE( UTIL_EVT_TRACE_MAC_EVENT, LORAMAC_TRACE_RX_TIMEOUT, 0 );
 
     if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
     {
         MacCtx.MacCallbacks->MacProcessNotify( );
     }
     LIB_LOG(ADV_TRACER_TS_ON, ADV_TRACER_VLEVEL_M, "MAC rxTimeOut\r\n" );
+
+    LoRaMacInstanceSelect( previous );
 }
 
 static void UpdateRxSlotIdleState( void )
@@ -902,6 +704,8 @@ static void ProcessRadioTxDone( void )
     TimerStart( &MacCtx.RxWindowTimer1 );
     TimerSetValue( &MacCtx.RxWindowTimer2, MacCtx.RxWindow2Delay );
     TimerStart( &MacCtx.RxWindowTimer2 );
+    UTIL_EVT_TRACE( UTIL_EVT_TRACE_RX_TIMER_START, RX_SLOT_WIN_1, MacCtx.RxWindow1Delay );
+    UTIL_EVT_TRACE( UTIL_EVT_TRACE_RX_TIMER_START, RX_SLOT_WIN_2, MacCtx.RxWindow2Delay );
 
     if( ( MacCtx.NvmCtx->DeviceClass == CLASS_C ) || ( MacCtx.NodeAckRequested == true ) )
     {
@@ -952,8 +756,6 @@ static void ProcessRadioRxDone( void )
 {
     LoRaMacHeader_t macHdr;
     ApplyCFListParams_t applyCFList;
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
     LoRaMacCryptoStatus_t macCryptoStatus = LORAMAC_CRYPTO_ERROR;
 
     LoRaMacMessageData_t macMsgData;
@@ -1036,7 +838,9 @@ static void ProcessRadioRxDone( void )
                 PrepareRxDoneAbort( );
                 return;
             }
+            SecureElementBeginSession( );
             macCryptoStatus = LoRaMacCryptoHandleJoinAccept( JOIN_REQ, SecureElementGetJoinEui( ), &macMsgJoinAccept );
+            SecureElementEndSession( );
 
             if( LORAMAC_CRYPTO_SUCCESS == macCryptoStatus )
             {
@@ -1093,18 +897,8 @@ static void ProcessRadioRxDone( void )
             // Intentional fall through
         case FRAME_TYPE_DATA_UNCONFIRMED_DOWN:
             // Check if the received payload size is valid
-            getPhy.UplinkDwellTime = MacCtx.NvmCtx->MacParams.DownlinkDwellTime;
-            getPhy.Datarate = MacCtx.McpsIndication.RxDatarate;
-            getPhy.Attribute = PHY_MAX_PAYLOAD;
-
-            // Get the maximum payload length
-            if( MacCtx.NvmCtx->RepeaterSupport == true )
-            {
-                getPhy.Attribute = PHY_MAX_PAYLOAD_REPEATER;
-            }
-
-            phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-            if( ( MAX( 0, ( int16_t )( ( int16_t ) size - ( int16_t ) LORAMAC_FRAME_PAYLOAD_OVERHEAD_SIZE ) ) > ( int16_t )phyParam.Value ) ||
+            if( ( MacCtx.McpsIndication.RxDatarate >= LORAMAC_PHY_DATARATES ) ||
+                ( MAX( 0, ( int16_t )( ( int16_t ) size - ( int16_t ) LORAMAC_FRAME_PAYLOAD_OVERHEAD_SIZE ) ) > ( int16_t )MacCtx.PhyParams.MaxDownlinkPayload[MacCtx.McpsIndication.RxDatarate] ) ||
                 ( size < LORAMAC_FRAME_PAYLOAD_MIN_SIZE ) )
             {
                 MacCtx.McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
@@ -1116,7 +910,10 @@ static void ProcessRadioRxDone( void )
             macMsgData.FRMPayload = MacCtx.RxPayload;
             macMsgData.FRMPayloadSize = LORAMAC_PHY_MAXPAYLOAD;
 
-            if( LORAMAC_PARSER_SUCCESS != LoRaMacParserData( &macMsgData ) )
+            // Only read the header, the frames of other devices and the repeated
+            // frames are dropped before the frame is parsed and its MIC computed.
+            // LoRaMacCryptoUnsecureMessage parses the whole frame.
+            if( LORAMAC_PARSER_SUCCESS != LoRaMacParserDataHeader( &macMsgData ) )
             {
                 MacCtx.McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
                 PrepareRxDoneAbort( );
@@ -1164,12 +961,16 @@ static void ProcessRadioRxDone( void )
                 return;
             }
 
-            // Get maximum allowed counter difference
-            getPhy.Attribute = PHY_MAX_FCNT_GAP;
-            phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+            // Drop the frames of other devices before the frame counter check
+            if( ( multicast == 0 ) && ( macMsgData.FHDR.DevAddr != address ) )
+            {
+                MacCtx.McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_ADDRESS_FAIL;
+                PrepareRxDoneAbort( );
+                return;
+            }
 
             // Get downlink frame counter value
-            macCryptoStatus = GetFCntDown( addrID, fType, &macMsgData, MacCtx.NvmCtx->Version, phyParam.Value, &fCntID, &downLinkCounter );
+            macCryptoStatus = GetFCntDown( addrID, fType, &macMsgData, MacCtx.NvmCtx->Version, MacCtx.PhyParams.MaxFCntGap, &fCntID, &downLinkCounter );
             if( macCryptoStatus != LORAMAC_CRYPTO_SUCCESS )
             {
                 if( macCryptoStatus == LORAMAC_CRYPTO_FAIL_FCNT_DUPLICATED )
@@ -1196,7 +997,9 @@ static void ProcessRadioRxDone( void )
                 return;
             }
 
+            SecureElementBeginSession( );
             macCryptoStatus = LoRaMacCryptoUnsecureMessage( addrID, address, fCntID, downLinkCounter, &macMsgData );
+            SecureElementEndSession( );
             if( macCryptoStatus != LORAMAC_CRYPTO_SUCCESS )
             {
                 if( macCryptoStatus == LORAMAC_CRYPTO_FAIL_ADDRESS )
@@ -1466,6 +1269,7 @@ static void LoRaMacHandleIrqEvents( void )
 
     if( events.Value != 0 )
     {
+        UTIL_EVT_TRACE( UTIL_EVT_TRACE_MAC_PROCESS, events.Value, 0 );
         if( events.Events.TxDone == 1 )
         {
             ProcessRadioTxDone( );
@@ -1587,6 +1391,7 @@ static void LoRaMacHandleMcpsRequest( void )
     {
         bool stopRetransmission = false;
         bool waitForRetransmission = false;
+        TimerTime_t retransDelay = 0;
 
         if( ( MacCtx.McpsConfirm.McpsRequest == MCPS_UNCONFIRMED ) ||
             ( MacCtx.McpsConfirm.McpsRequest == MCPS_PROPRIETARY ) )
@@ -1598,6 +1403,11 @@ static void LoRaMacHandleMcpsRequest( void )
             if( MacCtx.AckTimeoutRetry == true )
             {
                 stopRetransmission = CheckRetransConfirmedUplink( );
+                if( stopRetransmission == false )
+                {
+                    retransDelay = GetRetransDelay( MacCtx.AckTimeoutRetriesCounter );
+                    stopRetransmission = CheckRetransDeadline( retransDelay );
+                }
 
                 if( MacCtx.NvmCtx->Version.Fields.Minor == 0 )
                 {
@@ -1628,8 +1438,17 @@ static void LoRaMacHandleMcpsRequest( void )
             MacCtx.MacFlags.Bits.MacDone = 0;
             // Reset the state of the AckTimeout
             MacCtx.AckTimeoutRetry = false;
-            // Sends the same frame again
-            OnTxDelayedTimerEvent( NULL );
+            if( retransDelay > 0 )
+            {// Sends the same frame again after the backoff
+                MacCtx.MacState |= LORAMAC_TX_DELAYED;
+                TimerSetValue( &MacCtx.TxDelayedTimer, retransDelay );
+                TimerStart( &MacCtx.TxDelayedTimer );
+            }
+            else
+            {
+                // Sends the same frame again
+                OnTxDelayedTimerEvent( NULL );
+            }
         }
     }
 }
@@ -1681,6 +1500,12 @@ static void LoRaMacCheckForRxAbort( void )
 
 static void OnTxDelayedTimerEvent( void* context )
 {
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( context );
+
+    if( context != NULL )
+    {// Not a direct call
+        UTIL_EVT_TRACE( UTIL_EVT_TRACE_TIMER, UTIL_EVT_TRACE_TIMER_TX_DELAYED, 0 );
+    }
     TimerStop( &MacCtx.TxDelayedTimer );
     MacCtx.MacState &= ~LORAMAC_TX_DELAYED;
 
@@ -1690,6 +1515,26 @@ static void OnTxDelayedTimerEvent( void* context )
         case LORAMAC_STATUS_OK:
         case LORAMAC_STATUS_DUTYCYCLE_RESTRICTED:
         {
+            if( ( ( MacCtx.MacState & LORAMAC_TX_DELAYED ) == LORAMAC_TX_DELAYED ) &&
+                ( MacCtx.NodeAckRequested == true ) && ( MacCtx.AckTimeoutRetriesCounter > 1 ) &&
+                ( CheckRetransDeadline( MacCtx.DutyCycleWaitTime ) == true ) )
+            {// The band is not free before the deadline, stop the retransmissions
+                TimerStop( &MacCtx.TxDelayedTimer );
+                MacCtx.MacState &= ~LORAMAC_TX_DELAYED;
+                // Undo AckTimeoutRetriesProcess for the retransmission which is not sent
+                MacCtx.AckTimeoutRetriesCounter--;
+                if( MacCtx.NvmCtx->Version.Fields.Minor == 0 )
+                {
+                    MacCtx.NvmCtx->MacParams.ChannelsDatarate = MacCtx.RetransDatarate;
+                }
+                AckTimeoutRetriesFinalize( );
+                StopRetransmission( );
+                MacCtx.MacFlags.Bits.MacDone = 1;
+                if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+                {
+                    MacCtx.MacCallbacks->MacProcessNotify( );
+                }
+            }
             break;
         }
         default:
@@ -1703,10 +1548,15 @@ static void OnTxDelayedTimerEvent( void* context )
             break;
         }
     }
+
+    LoRaMacInstanceSelect( previous );
 }
 
 static void OnRxWindow1TimerEvent( void* context )
 {
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( context );
+
+    UTIL_EVT_TRACE( UTIL_EVT_TRACE_TIMER, UTIL_EVT_TRACE_TIMER_RX_WINDOW1, 0 );
     MacCtx.RxWindow1Config.Channel = MacCtx.Channel;
     MacCtx.RxWindow1Config.DrOffset = MacCtx.NvmCtx->MacParams.Rx1DrOffset;
     MacCtx.RxWindow1Config.DownlinkDwellTime = MacCtx.NvmCtx->MacParams.DownlinkDwellTime;
@@ -1715,28 +1565,40 @@ static void OnRxWindow1TimerEvent( void* context )
     MacCtx.RxWindow1Config.RxSlot = RX_SLOT_WIN_1;
 
     RxWindowSetup( &MacCtx.RxWindowTimer1, &MacCtx.RxWindow1Config );
+
+    LoRaMacInstanceSelect( previous );
 }
 
 static void OnRxWindow2TimerEvent( void* context )
 {
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( context );
+
+    UTIL_EVT_TRACE( UTIL_EVT_TRACE_TIMER, UTIL_EVT_TRACE_TIMER_RX_WINDOW2, 0 );
     // Check if we are processing Rx1 window.
     // If yes, we don't setup the Rx2 window.
-    if( MacCtx.RxSlot == RX_SLOT_WIN_1 )
+    if( MacCtx.RxSlot != RX_SLOT_WIN_1 )
     {
-        return;
+        MacCtx.RxWindow2Config.Channel = MacCtx.Channel;
+        MacCtx.RxWindow2Config.Frequency = MacCtx.NvmCtx->MacParams.Rx2Channel.Frequency;
+        MacCtx.RxWindow2Config.DownlinkDwellTime = MacCtx.NvmCtx->MacParams.DownlinkDwellTime;
+        MacCtx.RxWindow2Config.RepeaterSupport = MacCtx.NvmCtx->RepeaterSupport;
+        MacCtx.RxWindow2Config.RxContinuous = false;
+        MacCtx.RxWindow2Config.RxSlot = RX_SLOT_WIN_2;
+
+        RxWindowSetup( &MacCtx.RxWindowTimer2, &MacCtx.RxWindow2Config );
     }
-    MacCtx.RxWindow2Config.Channel = MacCtx.Channel;
-    MacCtx.RxWindow2Config.Frequency = MacCtx.NvmCtx->MacParams.Rx2Channel.Frequency;
-    MacCtx.RxWindow2Config.DownlinkDwellTime = MacCtx.NvmCtx->MacParams.DownlinkDwellTime;
-    MacCtx.RxWindow2Config.RepeaterSupport = MacCtx.NvmCtx->RepeaterSupport;
-    MacCtx.RxWindow2Config.RxContinuous = false;
-    MacCtx.RxWindow2Config.RxSlot = RX_SLOT_WIN_2;
 
-    RxWindowSetup( &MacCtx.RxWindowTimer2, &MacCtx.RxWindow2Config );
+    LoRaMacInstanceSelect( previous );
 }
 
 static void OnAckTimeoutTimerEvent( void* context )
 {
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( context );
+
+    if( context != NULL )
+    {// Not a direct call
+        UTIL_EVT_TRACE( UTIL_EVT_TRACE_TIMER, UTIL_EVT_TRACE_TIMER_ACK_TIMEOUT, 0 );
+    }
     TimerStop( &MacCtx.AckTimeoutTimer );
 
     if( MacCtx.NodeAckRequested == true )
@@ -1751,6 +1613,8 @@ static void OnAckTimeoutTimerEvent( void* context )
     {
         MacCtx.MacCallbacks->MacProcessNotify( );
     }
+
+    LoRaMacInstanceSelect( previous );
 }
 
 static LoRaMacCryptoStatus_t GetFCntDown( AddressIdentifier_t addrID, FType_t fType, LoRaMacMessageData_t* macMsg, Version_t lrWanVersion,
@@ -1889,23 +1753,11 @@ static LoRaMacStatus_t SwitchClass( DeviceClass_t deviceClass )
 
 static uint8_t GetMaxAppPayloadWithoutFOptsLength( int8_t datarate )
 {
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
-
-    // Setup PHY request
-    getPhy.UplinkDwellTime = MacCtx.NvmCtx->MacParams.UplinkDwellTime;
-    getPhy.Datarate = datarate;
-    getPhy.Attribute = PHY_MAX_PAYLOAD;
-
-    // Get the maximum payload length
-    if( MacCtx.NvmCtx->RepeaterSupport == true )
+    if( ( datarate < 0 ) || ( datarate >= LORAMAC_PHY_DATARATES ) )
     {
-        getPhy.Attribute = PHY_MAX_PAYLOAD_REPEATER;
+        return 0;
     }
-
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-
-    return phyParam.Value;
+    return MacCtx.PhyParams.MaxUplinkPayload[datarate];
 }
 
 static bool ValidatePayloadLength( uint8_t lenN, int8_t datarate, uint8_t fOptsLen )
@@ -2114,7 +1966,8 @@ static void ProcessMacCommands( uint8_t *payload, uint8_t macIndex, uint8_t comm
                     // Accept command
                     MacCtx.NvmCtx->MacParams.UplinkDwellTime = txParamSetupReq.UplinkDwellTime;
                     MacCtx.NvmCtx->MacParams.DownlinkDwellTime = txParamSetupReq.DownlinkDwellTime;
-                    MacCtx.NvmCtx->MacParams.MaxEirp = LoRaMacMaxEirpTable[txParamSetupReq.MaxEirp];
+                    UpdatePhyParams( );
+                    MacCtx.NvmCtx->MacParams.MaxEirpQ8 = ( int16_t )( LoRaMacMaxEirpTable[txParamSetupReq.MaxEirp] << LORAMAC_DB_Q_BITS );
                     // Update the datarate in case of the new configuration limits it
                     getPhy.Attribute = PHY_MIN_TX_DR;
                     getPhy.UplinkDwellTime = MacCtx.NvmCtx->MacParams.UplinkDwellTime;
@@ -2560,7 +2413,9 @@ static LoRaMacStatus_t SecureFrame( uint8_t txDr, uint8_t txCh )
     switch( MacCtx.TxMsg.Type )
     {
         case LORAMAC_MSG_TYPE_JOIN_REQUEST:
+            SecureElementBeginSession( );
             macCryptoStatus = LoRaMacCryptoPrepareJoinRequest( &MacCtx.TxMsg.Message.JoinReq );
+            SecureElementEndSession( );
             if( LORAMAC_CRYPTO_SUCCESS != macCryptoStatus )
             {
                 return LORAMAC_STATUS_CRYPTO_ERROR;
@@ -2578,8 +2433,17 @@ static LoRaMacStatus_t SecureFrame( uint8_t txDr, uint8_t txCh )
             {
                 fCntUp -= 1;
             }
+            else if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->ReserveFCntUp != NULL ) &&
+                     ( MacCtx.MacCallbacks->ReserveFCntUp( fCntUp ) == false ) )
+            {
+                // The frame counter could be used again after a reset
+                return LORAMAC_STATUS_FCNT_HANDLER_ERROR;
+            }
 
+            // Payload encryption and MIC in one secure element session
+            SecureElementBeginSession( );
             macCryptoStatus = LoRaMacCryptoSecureMessage( fCntUp, txDr, txCh, &MacCtx.TxMsg.Message.Data );
+            SecureElementEndSession( );
             if( LORAMAC_CRYPTO_SUCCESS != macCryptoStatus )
             {
                 return LORAMAC_STATUS_CRYPTO_ERROR;
@@ -2648,8 +2512,8 @@ static void ResetMacParameters( void )
     MacCtx.NvmCtx->MacParams.RxCChannel = MacCtx.NvmCtx->MacParamsDefaults.RxCChannel;
     MacCtx.NvmCtx->MacParams.UplinkDwellTime = MacCtx.NvmCtx->MacParamsDefaults.UplinkDwellTime;
     MacCtx.NvmCtx->MacParams.DownlinkDwellTime = MacCtx.NvmCtx->MacParamsDefaults.DownlinkDwellTime;
-    MacCtx.NvmCtx->MacParams.MaxEirp = MacCtx.NvmCtx->MacParamsDefaults.MaxEirp;
-    MacCtx.NvmCtx->MacParams.AntennaGain = MacCtx.NvmCtx->MacParamsDefaults.AntennaGain;
+    MacCtx.NvmCtx->MacParams.MaxEirpQ8 = MacCtx.NvmCtx->MacParamsDefaults.MaxEirpQ8;
+    MacCtx.NvmCtx->MacParams.AntennaGainQ8 = MacCtx.NvmCtx->MacParamsDefaults.AntennaGainQ8;
 
     MacCtx.NodeAckRequested = false;
     MacCtx.NvmCtx->SrvAckRequested = false;
@@ -2676,6 +2540,51 @@ static void ResetMacParameters( void )
     MacCtx.RxWindowCConfig.RxContinuous = true;
     MacCtx.RxWindowCConfig.RxSlot = RX_SLOT_WIN_CLASS_C;
 
+    UpdatePhyParams( );
+}
+
+static void UpdatePhyParams( void )
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+    VerifyParams_t verify;
+    PhyAttribute_t maxPayload = PHY_MAX_PAYLOAD;
+
+    if( MacCtx.NvmCtx->RepeaterSupport == true )
+    {
+        maxPayload = PHY_MAX_PAYLOAD_REPEATER;
+    }
+
+    getPhy.Attribute = PHY_MAX_FCNT_GAP;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.PhyParams.MaxFCntGap = phyParam.Value;
+
+    verify.DatarateParams.UplinkDwellTime = MacCtx.NvmCtx->MacParams.UplinkDwellTime;
+    verify.DatarateParams.DownlinkDwellTime = MacCtx.NvmCtx->MacParams.DownlinkDwellTime;
+    getPhy.Attribute = maxPayload;
+
+    for( int8_t datarate = DR_0; datarate < LORAMAC_PHY_DATARATES; datarate++ )
+    {
+        // The region tables only hold the datarates which pass the verification
+        verify.DatarateParams.Datarate = datarate;
+        getPhy.Datarate = datarate;
+
+        MacCtx.PhyParams.MaxUplinkPayload[datarate] = 0;
+        if( RegionVerify( MacCtx.NvmCtx->Region, &verify, PHY_TX_DR ) == true )
+        {
+            getPhy.UplinkDwellTime = MacCtx.NvmCtx->MacParams.UplinkDwellTime;
+            phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+            MacCtx.PhyParams.MaxUplinkPayload[datarate] = phyParam.Value;
+        }
+
+        MacCtx.PhyParams.MaxDownlinkPayload[datarate] = 0;
+        if( RegionVerify( MacCtx.NvmCtx->Region, &verify, PHY_RX_DR ) == true )
+        {
+            getPhy.UplinkDwellTime = MacCtx.NvmCtx->MacParams.DownlinkDwellTime;
+            phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+            MacCtx.PhyParams.MaxDownlinkPayload[datarate] = phyParam.Value;
+        }
+    }
 }
 
 /*!
@@ -2693,8 +2602,10 @@ static void RxWindowSetup( TimerEvent_t* rxTimer, RxConfigParams_t* rxConfig )
 
     if( RegionRxConfig( MacCtx.NvmCtx->Region, rxConfig, ( int8_t* )&MacCtx.McpsIndication.RxDatarate ) == true )
     {
+        LoRaMacInstanceTakeRadio( );
         Radio.Rx( MacCtx.NvmCtx->MacParams.MaxRxWindow );
         MacCtx.RxSlot = rxConfig->RxSlot;
+        UTIL_EVT_TRACE( UTIL_EVT_TRACE_RX_WINDOW, rxConfig->RxSlot, 0 );
     }
 }
 
@@ -2715,6 +2626,7 @@ static void OpenContinuousRxCWindow( void )
     // Thus, there is no need to set the radio in standby mode.
     if( RegionRxConfig( MacCtx.NvmCtx->Region, &MacCtx.RxWindowCConfig, ( int8_t* )&MacCtx.McpsIndication.RxDatarate ) == true )
     {
+        LoRaMacInstanceTakeRadio( );
         Radio.Rx( 0 ); // Continuous mode
         MacCtx.RxSlot = MacCtx.RxWindowCConfig.RxSlot;
     }
@@ -2727,13 +2639,13 @@ static LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t
     uint32_t fCntUp = 0;
     size_t macCmdsSize = 0;
     uint8_t availableSize = 0;
+    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
 
     if( fBuffer == NULL )
     {
         fBufferSize = 0;
     }
 
-    memcpy1( MacCtx.AppData, ( uint8_t* ) fBuffer, fBufferSize );
     MacCtx.AppDataSize = fBufferSize;
     MacCtx.PktBuffer[0] = macHdr->Value;
 
@@ -2751,7 +2663,7 @@ static LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t
             MacCtx.TxMsg.Message.Data.FHDR.DevAddr = MacCtx.NvmCtx->DevAddr;
             MacCtx.TxMsg.Message.Data.FHDR.FCtrl.Value = fCtrl->Value;
             MacCtx.TxMsg.Message.Data.FRMPayloadSize = MacCtx.AppDataSize;
-            MacCtx.TxMsg.Message.Data.FRMPayload = MacCtx.AppData;
+            MacCtx.TxMsg.Message.Data.FRMPayload = NULL;
 
             if( LORAMAC_CRYPTO_SUCCESS != LoRaMacCryptoGetFCntUp( &fCntUp ) )
             {
@@ -2793,7 +2705,7 @@ static LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t
                     {
                         return LORAMAC_STATUS_MAC_COMMAD_ERROR;
                     }
-                    return LORAMAC_STATUS_SKIPPED_APP_DATA;
+                    status = LORAMAC_STATUS_SKIPPED_APP_DATA;
                 }
                 // No application payload available therefore add all mac commands to the FRMPayload.
                 else
@@ -2810,6 +2722,31 @@ static LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t
                 }
             }
 
+            if( MacCtx.AppDataSize > 0 )
+            {
+                // The application payload is encrypted and serialized in place, at its position in PktBuffer
+                uint8_t payloadOffset = GetTxPayloadOffset( fCtrl->Bits.FOptsLen );
+                uint8_t* payload = MacCtx.PktBuffer + payloadOffset;
+
+                if( ( payloadOffset + fBufferSize + LORAMAC_MIC_FIELD_SIZE ) > LORAMAC_PHY_MAXPAYLOAD )
+                {
+                    return LORAMAC_STATUS_LENGTH_ERROR;
+                }
+                if( ( payload > ( uint8_t* ) fBuffer ) && ( payload < ( ( uint8_t* ) fBuffer + fBufferSize ) ) )
+                {
+                    // Copy from the end, the buffer of LoRaMacGetTxPayloadBuffer overlaps
+                    // the payload when MAC commands were added since
+                    for( uint8_t i = MacCtx.AppDataSize; i > 0; i-- )
+                    {
+                        payload[i - 1] = ( ( uint8_t* ) fBuffer )[i - 1];
+                    }
+                }
+                else if( payload != ( uint8_t* ) fBuffer )
+                {
+                    memcpy1( payload, ( uint8_t* ) fBuffer, MacCtx.AppDataSize );
+                }
+                MacCtx.TxMsg.Message.Data.FRMPayload = payload;
+            }
             break;
         case FRAME_TYPE_PROPRIETARY:
             if( ( fBuffer != NULL ) && ( MacCtx.AppDataSize > 0 ) )
@@ -2822,7 +2759,13 @@ static LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t
             return LORAMAC_STATUS_SERVICE_UNKNOWN;
     }
 
-    return LORAMAC_STATUS_OK;
+    return status;
+}
+
+static uint8_t GetTxPayloadOffset( uint8_t fOptsLen )
+{
+    return LORAMAC_MHDR_FIELD_SIZE + LORAMAC_FHDR_DEV_ADDR_FIELD_SIZE + LORAMAC_FHDR_F_CTRL_FIELD_SIZE +
+           LORAMAC_FHDR_F_CNT_FIELD_SIZE + fOptsLen + LORAMAC_F_PORT_FIELD_SIZE;
 }
 
 static LoRaMacStatus_t SendFrameOnChannel( uint8_t channel )
@@ -2834,8 +2777,8 @@ static LoRaMacStatus_t SendFrameOnChannel( uint8_t channel )
     txConfig.Channel = channel;
     txConfig.Datarate = MacCtx.NvmCtx->MacParams.ChannelsDatarate;
     txConfig.TxPower = MacCtx.NvmCtx->MacParams.ChannelsTxPower;
-    txConfig.MaxEirp = MacCtx.NvmCtx->MacParams.MaxEirp;
-    txConfig.AntennaGain = MacCtx.NvmCtx->MacParams.AntennaGain;
+    txConfig.MaxEirpQ8 = MacCtx.NvmCtx->MacParams.MaxEirpQ8;
+    txConfig.AntennaGainQ8 = MacCtx.NvmCtx->MacParams.AntennaGainQ8;
     txConfig.PktLen = MacCtx.PktBufferLen;
 
     RegionTxConfig( MacCtx.NvmCtx->Region, &txConfig, &txPower, &MacCtx.TxTimeOnAir );
@@ -2883,6 +2826,7 @@ static LoRaMacStatus_t SendFrameOnChannel( uint8_t channel )
     }
 
     // Send now
+    LoRaMacInstanceTakeRadio( );
     Radio.Send( MacCtx.PktBuffer, MacCtx.PktBufferLen );
 
     return LORAMAC_STATUS_OK;
@@ -2895,10 +2839,11 @@ static LoRaMacStatus_t SetTxContinuousWave( uint16_t timeout )
     continuousWave.Channel = MacCtx.Channel;
     continuousWave.Datarate = MacCtx.NvmCtx->MacParams.ChannelsDatarate;
     continuousWave.TxPower = MacCtx.NvmCtx->MacParams.ChannelsTxPower;
-    continuousWave.MaxEirp = MacCtx.NvmCtx->MacParams.MaxEirp;
-    continuousWave.AntennaGain = MacCtx.NvmCtx->MacParams.AntennaGain;
+    continuousWave.MaxEirpQ8 = MacCtx.NvmCtx->MacParams.MaxEirpQ8;
+    continuousWave.AntennaGainQ8 = MacCtx.NvmCtx->MacParams.AntennaGainQ8;
     continuousWave.Timeout = timeout;
 
+    LoRaMacInstanceTakeRadio( );
     RegionSetContinuousWave( MacCtx.NvmCtx->Region, &continuousWave );
 
     MacCtx.MacState |= LORAMAC_TX_RUNNING;
@@ -2908,6 +2853,7 @@ static LoRaMacStatus_t SetTxContinuousWave( uint16_t timeout )
 
 static LoRaMacStatus_t SetTxContinuousWave1( uint16_t timeout, uint32_t frequency, uint8_t power )
 {
+    LoRaMacInstanceTakeRadio( );
     Radio.SetTxContinuousWave( frequency, power, timeout );
 
     MacCtx.MacState |= LORAMAC_TX_RUNNING;
@@ -2917,17 +2863,17 @@ static LoRaMacStatus_t SetTxContinuousWave1( uint16_t timeout, uint32_t frequenc
 
 static LoRaMacCtxs_t* GetCtxs( void )
 {
-    Contexts.MacNvmCtx = &NvmMacCtx;
-    Contexts.MacNvmCtxSize = sizeof( NvmMacCtx );
-    Contexts.CryptoNvmCtx = LoRaMacCryptoGetNvmCtx( &Contexts.CryptoNvmCtxSize );
+    MacContexts.MacNvmCtx = &NvmMacCtx;
+    MacContexts.MacNvmCtxSize = sizeof( NvmMacCtx );
+    MacContexts.CryptoNvmCtx = LoRaMacCryptoGetNvmCtx( &MacContexts.CryptoNvmCtxSize );
     GetNvmCtxParams_t params ={ 0 };
-    Contexts.RegionNvmCtx = RegionGetNvmCtx( MacCtx.NvmCtx->Region, &params );
-    Contexts.RegionNvmCtxSize = params.nvmCtxSize;
-    Contexts.SecureElementNvmCtx = SecureElementGetNvmCtx( &Contexts.SecureElementNvmCtxSize );
-    Contexts.CommandsNvmCtx = LoRaMacCommandsGetNvmCtx( &Contexts.CommandsNvmCtxSize );
-    Contexts.ClassBNvmCtx = LoRaMacClassBGetNvmCtx( &Contexts.ClassBNvmCtxSize );
-    Contexts.ConfirmQueueNvmCtx = LoRaMacConfirmQueueGetNvmCtx( &Contexts.ConfirmQueueNvmCtxSize );
-    return &Contexts;
+    MacContexts.RegionNvmCtx = RegionGetNvmCtx( MacCtx.NvmCtx->Region, &params );
+    MacContexts.RegionNvmCtxSize = params.nvmCtxSize;
+    MacContexts.SecureElementNvmCtx = SecureElementGetNvmCtx( &MacContexts.SecureElementNvmCtxSize );
+    MacContexts.CommandsNvmCtx = LoRaMacCommandsGetNvmCtx( &MacContexts.CommandsNvmCtxSize );
+    MacContexts.ClassBNvmCtx = LoRaMacClassBGetNvmCtx( &MacContexts.ClassBNvmCtxSize );
+    MacContexts.ConfirmQueueNvmCtx = LoRaMacConfirmQueueGetNvmCtx( &MacContexts.ConfirmQueueNvmCtxSize );
+    return &MacContexts;
 }
 
 static LoRaMacStatus_t RestoreCtxs( LoRaMacCtxs_t* contexts )
@@ -2959,6 +2905,8 @@ static LoRaMacStatus_t RestoreCtxs( LoRaMacCtxs_t* contexts )
     MacCtx.RxWindowCConfig.RxContinuous = true;
     MacCtx.RxWindowCConfig.RxSlot = RX_SLOT_WIN_CLASS_C;
 
+    UpdatePhyParams( );
+
     if( SecureElementRestoreNvmCtx( contexts->SecureElementNvmCtx ) != SECURE_ELEMENT_SUCCESS )
     {
         return LORAMAC_STATUS_CRYPTO_ERROR;
@@ -3106,10 +3054,14 @@ static bool StopRetransmission( void )
 
 static void AckTimeoutRetriesProcess( void )
 {
+    // Restored when the retransmission misses its deadline
+    MacCtx.RetransDatarate = MacCtx.NvmCtx->MacParams.ChannelsDatarate;
     if( MacCtx.AckTimeoutRetriesCounter < MacCtx.AckTimeoutRetries )
     {
         MacCtx.AckTimeoutRetriesCounter++;
-        if( ( MacCtx.AckTimeoutRetriesCounter % 2 ) == 1 )
+        if( ( ( MacCtx.RetransPolicy.Datarate == LORAMAC_RETRANS_DR_STEP_DOWN ) &&
+              ( ( MacCtx.AckTimeoutRetriesCounter % 2 ) == 1 ) ) ||
+            ( MacCtx.RetransPolicy.Datarate == LORAMAC_RETRANS_DR_STEP_DOWN_EACH ) )
         {
             GetPhyParams_t getPhy;
             PhyParam_t phyParam;
@@ -3123,13 +3075,72 @@ static void AckTimeoutRetriesProcess( void )
     }
 }
 
+static TimerTime_t GetRetransDelay( uint8_t nbTrans )
+{
+    TimerTime_t delay = MIN( MacCtx.RetransPolicy.BackoffDelay, RETRANS_MAX_DELAY );
+    TimerTime_t maxDelay = RETRANS_MAX_DELAY;
+
+    // A retransmission after the deadline is not started, longer delays are useless
+    if( ( MacCtx.RetransPolicy.BackoffMaxDelay != 0 ) && ( MacCtx.RetransPolicy.BackoffMaxDelay < maxDelay ) )
+    {
+        maxDelay = MacCtx.RetransPolicy.BackoffMaxDelay;
+    }
+    if( ( MacCtx.RetransPolicy.Deadline != 0 ) && ( MacCtx.RetransPolicy.Deadline < maxDelay ) )
+    {
+        maxDelay = MacCtx.RetransPolicy.Deadline;
+    }
+
+    switch( MacCtx.RetransPolicy.Backoff )
+    {
+        case LORAMAC_RETRANS_BACKOFF_CONSTANT:
+        {
+            break;
+        }
+        case LORAMAC_RETRANS_BACKOFF_LINEAR:
+        {
+            // At most RETRANS_MAX_DELAY times MAX_ACK_RETRIES, no overflow
+            delay *= nbTrans;
+            break;
+        }
+        case LORAMAC_RETRANS_BACKOFF_EXPONENTIAL:
+        {
+            for( uint8_t i = 1; ( i < nbTrans ) && ( delay < maxDelay ); i++ )
+            {
+                delay *= 2;
+            }
+            break;
+        }
+        default:
+        {
+            return 0;
+        }
+    }
+    delay = MIN( delay, maxDelay );
+    if( ( MacCtx.RetransPolicy.BackoffJitter != 0 ) && ( delay != 0 ) )
+    {
+        delay += randr( 0, ( int32_t )( ( ( uint64_t )delay * MacCtx.RetransPolicy.BackoffJitter ) / 100 ) );
+    }
+    return delay;
+}
+
+static bool CheckRetransDeadline( TimerTime_t delay )
+{
+    if( MacCtx.RetransPolicy.Deadline == 0 )
+    {
+        return false;
+    }
+    TimerTime_t elapsed = TimerGetElapsedTime( MacCtx.RetransStart );
+
+    return ( elapsed >= MacCtx.RetransPolicy.Deadline ) || ( delay >= ( MacCtx.RetransPolicy.Deadline - elapsed ) );
+}
+
 static void AckTimeoutRetriesFinalize( void )
 {
     if( MacCtx.McpsConfirm.AckReceived == false )
     {
         InitDefaultsParams_t params;
         params.Type = INIT_TYPE_ACTIVATE_DEFAULT_CHANNELS;
-        params.NvmCtx = Contexts.RegionNvmCtx;
+        params.NvmCtx = MacContexts.RegionNvmCtx;
         RegionInitDefaults( MacCtx.NvmCtx->Region, &params );
 
         MacCtx.NodeAckRequested = false;
@@ -3338,11 +3349,11 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
 
     getPhy.Attribute = PHY_DEF_MAX_EIRP;
     phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->MacParamsDefaults.MaxEirp = phyParam.fValue;
+    MacCtx.NvmCtx->MacParamsDefaults.MaxEirpQ8 = phyParam.QValue;
 
     getPhy.Attribute = PHY_DEF_ANTENNA_GAIN;
     phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->MacParamsDefaults.AntennaGain = phyParam.fValue;
+    MacCtx.NvmCtx->MacParamsDefaults.AntennaGainQ8 = phyParam.QValue;
 
     getPhy.Attribute = PHY_DEF_ADR_ACK_LIMIT;
     phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
@@ -3385,10 +3396,10 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
     MacCtx.NvmCtx->AggregatedTimeOff = 0;
 
     // Initialize timers
-    TimerInit( &MacCtx.TxDelayedTimer, OnTxDelayedTimerEvent );
-    TimerInit( &MacCtx.RxWindowTimer1, OnRxWindow1TimerEvent );
-    TimerInit( &MacCtx.RxWindowTimer2, OnRxWindow2TimerEvent );
-    TimerInit( &MacCtx.AckTimeoutTimer, OnAckTimeoutTimerEvent );
+    TimerInitWithContext( &MacCtx.TxDelayedTimer, OnTxDelayedTimerEvent, LoRaMacCurrentInstance );
+    TimerInitWithContext( &MacCtx.RxWindowTimer1, OnRxWindow1TimerEvent, LoRaMacCurrentInstance );
+    TimerInitWithContext( &MacCtx.RxWindowTimer2, OnRxWindow2TimerEvent, LoRaMacCurrentInstance );
+    TimerInitWithContext( &MacCtx.AckTimeoutTimer, OnAckTimeoutTimerEvent, LoRaMacCurrentInstance );
 
     // Store the current initialization time
     MacCtx.NvmCtx->InitializationTime = SysTimeGetMcuTime( );
@@ -3536,6 +3547,44 @@ LoRaMacStatus_t LoRaMacQueryTxPossible( uint8_t size, LoRaMacTxInfo_t* txInfo )
     }
 }
 
+LoRaMacStatus_t LoRaMacGetTxPayloadBuffer( uint8_t** buffer, uint8_t* maxSize )
+{
+    size_t macCmdsSize = 0;
+    uint8_t payloadOffset = 0;
+
+    if( buffer == NULL )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    // PktBuffer holds the frame until the MAC is done with it
+    if( LoRaMacIsBusy( ) == true )
+    {
+        return LORAMAC_STATUS_BUSY;
+    }
+
+    if( LoRaMacCommandsGetSizeSerializedCmds( &macCmdsSize ) != LORAMAC_COMMANDS_SUCCESS )
+    {
+        return LORAMAC_STATUS_MAC_COMMAD_ERROR;
+    }
+
+    // Same FOpts as PrepareFrame, MAC commands which do not fit into FOpts are sent without application data
+    if( macCmdsSize <= LORA_MAC_COMMAND_MAX_FOPTS_LENGTH )
+    {
+        payloadOffset = GetTxPayloadOffset( macCmdsSize );
+    }
+    else
+    {
+        payloadOffset = GetTxPayloadOffset( 0 );
+    }
+
+    *buffer = MacCtx.PktBuffer + payloadOffset;
+    if( maxSize != NULL )
+    {
+        *maxSize = LORAMAC_PHY_MAXPAYLOAD - payloadOffset - LORAMAC_MIC_FIELD_SIZE;
+    }
+    return LORAMAC_STATUS_OK;
+}
+
 LoRaMacStatus_t LoRaMacMibGetRequestConfirm( MibRequestConfirm_t* mibGet )
 {
     LoRaMacStatus_t status = LORAMAC_STATUS_OK;
@@ -3700,7 +3749,7 @@ LoRaMacStatus_t LoRaMacMibGetRequestConfirm( MibRequestConfirm_t* mibGet )
         }
         case MIB_ANTENNA_GAIN:
         {
-            mibGet->Param.AntennaGain = MacCtx.NvmCtx->MacParams.AntennaGain;
+            mibGet->Param.AntennaGainQ8 = MacCtx.NvmCtx->MacParams.AntennaGainQ8;
             break;
         }
         case MIB_NVM_CTXS:
@@ -3710,7 +3759,7 @@ LoRaMacStatus_t LoRaMacMibGetRequestConfirm( MibRequestConfirm_t* mibGet )
         }
         case MIB_DEFAULT_ANTENNA_GAIN:
         {
-            mibGet->Param.DefaultAntennaGain = MacCtx.NvmCtx->MacParamsDefaults.AntennaGain;
+            mibGet->Param.DefaultAntennaGainQ8 = MacCtx.NvmCtx->MacParamsDefaults.AntennaGainQ8;
             break;
         }
         case MIB_LORAWAN_VERSION:
@@ -4140,6 +4189,7 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t* mibSet )
         case MIB_REPEATER_SUPPORT:
         {
             MacCtx.NvmCtx->RepeaterSupport = mibSet->Param.EnableRepeaterSupport;
+            UpdatePhyParams( );
             break;
         }
         case MIB_RX2_CHANNEL:
@@ -4351,12 +4401,12 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t* mibSet )
         }
         case MIB_ANTENNA_GAIN:
         {
-            MacCtx.NvmCtx->MacParams.AntennaGain = mibSet->Param.AntennaGain;
+            MacCtx.NvmCtx->MacParams.AntennaGainQ8 = mibSet->Param.AntennaGainQ8;
             break;
         }
         case MIB_DEFAULT_ANTENNA_GAIN:
         {
-            MacCtx.NvmCtx->MacParamsDefaults.AntennaGain = mibSet->Param.DefaultAntennaGain;
+            MacCtx.NvmCtx->MacParamsDefaults.AntennaGainQ8 = mibSet->Param.DefaultAntennaGainQ8;
             break;
         }
         case MIB_NVM_CTXS:
@@ -4520,12 +4570,19 @@ LoRaMacStatus_t LoRaMacMcChannelDelete( AddressIdentifier_t groupID )
     }
 
     McChannelParams_t channel;
+    DeviceClass_t devClass = MacCtx.NvmCtx->MulticastChannelList[groupID].ChannelParams.Class;
 
     // Set all channel fields with 0
     memset1( ( uint8_t* )&channel, 0, sizeof( McChannelParams_t ) );
 
     MacCtx.NvmCtx->MulticastChannelList[groupID].ChannelParams = channel;
 
+    if( devClass == CLASS_B )
+    {
+        // The ping slot schedule of the current beacon period holds the deleted group
+        LoRaMacClassBSetMulticastPeriodicity( &MacCtx.NvmCtx->MulticastChannelList[groupID] );
+    }
+
     EventMacNvmCtxChanged( );
     EventRegionNvmCtxChanged( );
     return LORAMAC_STATUS_OK;
@@ -4602,6 +4659,11 @@ LoRaMacStatus_t LoRaMacMcChannelSetupRxParams( AddressIdentifier_t groupID, McRx
     {
         // Apply parameters
         MacCtx.NvmCtx->MulticastChannelList[groupID].ChannelParams.RxParams = *rxParams;
+        if( devClass == CLASS_B )
+        {
+            // Calculate class b parameters, the ping slot schedule of the current beacon period holds the former ones
+            LoRaMacClassBSetMulticastPeriodicity( &MacCtx.NvmCtx->MulticastChannelList[groupID] );
+        }
     }
 
     EventMacNvmCtxChanged( );
@@ -4791,6 +4853,8 @@ LoRaMacStatus_t LoRaMacMcpsRequest( McpsReq_t* mcpsRequest, bool allowDelayedTx
 
     // AckTimeoutRetriesCounter must be reset every time a new request (unconfirmed or confirmed) is performed.
     MacCtx.AckTimeoutRetriesCounter = 1;
+    memset1( ( uint8_t* ) &MacCtx.RetransPolicy, 0, sizeof( MacCtx.RetransPolicy ) );
+    MacCtx.RetransStart = TimerGetCurrentTime( );
 
     switch( mcpsRequest->Type )
     {
@@ -4810,6 +4874,10 @@ LoRaMacStatus_t LoRaMacMcpsRequest( McpsReq_t* mcpsRequest, bool allowDelayedTx
         {
             readyToSend = true;
             MacCtx.AckTimeoutRetries = MIN( mcpsRequest->Req.Confirmed.NbTrials, MAX_ACK_RETRIES );
+            if( mcpsRequest->Req.Confirmed.RetransPolicy != NULL )
+            {
+                MacCtx.RetransPolicy = *mcpsRequest->Req.Confirmed.RetransPolicy;
+            }
 
             macHdr.Bits.MType = FRAME_TYPE_DATA_CONFIRMED_UP;
             fPort = mcpsRequest->Req.Confirmed.fPort;
@@ -4917,3 +4985,174 @@ LoRaMacStatus_t LoRaMacDeInitialization( void )
         return LORAMAC_STATUS_BUSY;
     }
 }
+
+LoRaMacStatus_t LoRaMacInstanceInitialization( LoRaMacInstance_t* instance, LoRaMacPrimitives_t* primitives, LoRaMacCallback_t* callbacks, LoRaMacRegion_t region )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    LoRaMacStatus_t status = LoRaMacInitialization( primitives, callbacks, region );
+
+    LoRaMacInstanceSelect( previous );
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacInstanceStart( LoRaMacInstance_t* instance )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    LoRaMacStatus_t status = LoRaMacStart( );
+
+    LoRaMacInstanceSelect( previous );
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacInstanceStop( LoRaMacInstance_t* instance )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    LoRaMacStatus_t status = LoRaMacStop( );
+
+    LoRaMacInstanceSelect( previous );
+    return status;
+}
+
+bool LoRaMacInstanceIsBusy( LoRaMacInstance_t* instance )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    bool busy = LoRaMacIsBusy( );
+
+    LoRaMacInstanceSelect( previous );
+    return busy;
+}
+
+void LoRaMacInstanceProcess( LoRaMacInstance_t* instance )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+
+    LoRaMacProcess( );
+
+    LoRaMacInstanceSelect( previous );
+}
+
+LoRaMacStatus_t LoRaMacInstanceQueryTxPossible( LoRaMacInstance_t* instance, uint8_t size, LoRaMacTxInfo_t* txInfo )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    LoRaMacStatus_t status = LoRaMacQueryTxPossible( size, txInfo );
+
+    LoRaMacInstanceSelect( previous );
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacInstanceGetTxPayloadBuffer( LoRaMacInstance_t* instance, uint8_t** buffer, uint8_t* maxSize )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    LoRaMacStatus_t status = LoRaMacGetTxPayloadBuffer( buffer, maxSize );
+
+    LoRaMacInstanceSelect( previous );
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacInstanceChannelAdd( LoRaMacInstance_t* instance, uint8_t id, ChannelParams_t params )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    LoRaMacStatus_t status = LoRaMacChannelAdd( id, params );
+
+    LoRaMacInstanceSelect( previous );
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacInstanceChannelRemove( LoRaMacInstance_t* instance, uint8_t id )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    LoRaMacStatus_t status = LoRaMacChannelRemove( id );
+
+    LoRaMacInstanceSelect( previous );
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacInstanceMcChannelSetup( LoRaMacInstance_t* instance, McChannelParams_t *channel )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    LoRaMacStatus_t status = LoRaMacMcChannelSetup( channel );
+
+    LoRaMacInstanceSelect( previous );
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacInstanceMcChannelDelete( LoRaMacInstance_t* instance, AddressIdentifier_t groupID )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    LoRaMacStatus_t status = LoRaMacMcChannelDelete( groupID );
+
+    LoRaMacInstanceSelect( previous );
+    return status;
+}
+
+uint8_t LoRaMacInstanceMcChannelGetGroupId( LoRaMacInstance_t* instance, uint32_t mcAddress )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    uint8_t groupId = LoRaMacMcChannelGetGroupId( mcAddress );
+
+    LoRaMacInstanceSelect( previous );
+    return groupId;
+}
+
+LoRaMacStatus_t LoRaMacInstanceMcChannelSetupRxParams( LoRaMacInstance_t* instance, AddressIdentifier_t groupID, McRxParams_t *rxParams, uint8_t *status )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    LoRaMacStatus_t result = LoRaMacMcChannelSetupRxParams( groupID, rxParams, status );
+
+    LoRaMacInstanceSelect( previous );
+    return result;
+}
+
+LoRaMacStatus_t LoRaMacInstanceMibGetRequestConfirm( LoRaMacInstance_t* instance, MibRequestConfirm_t* mibGet )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    LoRaMacStatus_t status = LoRaMacMibGetRequestConfirm( mibGet );
+
+    LoRaMacInstanceSelect( previous );
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacInstanceMibSetRequestConfirm( LoRaMacInstance_t* instance, MibRequestConfirm_t* mibSet )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    LoRaMacStatus_t status = LoRaMacMibSetRequestConfirm( mibSet );
+
+    LoRaMacInstanceSelect( previous );
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacInstanceMlmeRequest( LoRaMacInstance_t* instance, MlmeReq_t* mlmeRequest )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    LoRaMacStatus_t status = LoRaMacMlmeRequest( mlmeRequest );
+
+    LoRaMacInstanceSelect( previous );
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacInstanceMcpsRequest( LoRaMacInstance_t* instance, McpsReq_t* mcpsRequest, bool allowDelayedTx )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    LoRaMacStatus_t status = LoRaMacMcpsRequest( mcpsRequest, allowDelayedTx );
+
+    LoRaMacInstanceSelect( previous );
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacInstanceDeInitialization( LoRaMacInstance_t* instance )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+    LoRaMacStatus_t status = LoRaMacDeInitialization( );
+
+    LoRaMacInstanceSelect( previous );
+    return status;
+}
+
+void LoRaMacInstanceTestSetDutyCycleOn( LoRaMacInstance_t* instance, bool enable )
+{
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( instance );
+
+    LoRaMacTestSetDutyCycleOn( enable );
+
+    LoRaMacInstanceSelect( previous );
+}
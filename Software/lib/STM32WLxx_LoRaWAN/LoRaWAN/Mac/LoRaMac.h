@@ -431,13 +431,13 @@ typedef struct sLoRaMacParams
      */
     uint8_t DownlinkDwellTime;
     /*!
-     * Maximum possible EIRP
+     * Maximum possible EIRP, in dBm Q8.8
      */
-    float MaxEirp;
+    int16_t MaxEirpQ8;
     /*!
-     * Antenna gain of the node
+     * Antenna gain of the node, in dBi Q8.8
      */
-    float AntennaGain;
+    int16_t AntennaGainQ8;
     /*!
      * Indicates if the node supports repeaters
      */
@@ -718,6 +718,85 @@ typedef struct sMcpsReqUnconfirmed
     int8_t Datarate;
 }McpsReqUnconfirmed_t;
 
+/*!
+ * Delay curve between the retransmissions of a confirmed frame
+ */
+typedef enum eLoRaMacRetransBackoff
+{
+    /*!
+     * Retransmit right after the RX windows, as defined by the LoRaWAN specification
+     */
+    LORAMAC_RETRANS_BACKOFF_NONE,
+    /*!
+     * Wait BackoffDelay before every retransmission
+     */
+    LORAMAC_RETRANS_BACKOFF_CONSTANT,
+    /*!
+     * Wait BackoffDelay times the number of transmissions done
+     */
+    LORAMAC_RETRANS_BACKOFF_LINEAR,
+    /*!
+     * Wait BackoffDelay, doubled after every retransmission
+     */
+    LORAMAC_RETRANS_BACKOFF_EXPONENTIAL,
+}LoRaMacRetransBackoff_t;
+
+/*!
+ * Datarate of the retransmissions of a confirmed frame
+ */
+typedef enum eLoRaMacRetransDatarate
+{
+    /*!
+     * One datarate lower every second transmission, see McpsReqConfirmed_t::NbTrials
+     */
+    LORAMAC_RETRANS_DR_STEP_DOWN,
+    /*!
+     * Keep the datarate of the first transmission
+     */
+    LORAMAC_RETRANS_DR_KEEP,
+    /*!
+     * One datarate lower every transmission
+     */
+    LORAMAC_RETRANS_DR_STEP_DOWN_EACH,
+}LoRaMacRetransDatarate_t;
+
+/*!
+ * Retransmission policy of a confirmed frame. A policy with all its fields set
+ * to zero is the LoRaWAN default.
+ *
+ * The delay of the backoff only sets the earliest time of a retransmission, the
+ * MAC still waits for the duty-cycle of the band as for any frame.
+ */
+typedef struct sLoRaMacRetransPolicy
+{
+    /*!
+     * Time in ms after the request after which no retransmission is started,
+     * 0 for no deadline
+     */
+    uint32_t Deadline;
+    /*!
+     * Delay curve between the retransmissions
+     */
+    LoRaMacRetransBackoff_t Backoff;
+    /*!
+     * Delay in ms after the RX windows before the first retransmission
+     */
+    uint32_t BackoffDelay;
+    /*!
+     * Upper limit of the delay in ms, 0 for no limit
+     */
+    uint32_t BackoffMaxDelay;
+    /*!
+     * Random part added to the delay, in percent of the delay, so that devices
+     * which lost their frames together do not retransmit together
+     */
+    uint8_t BackoffJitter;
+    /*!
+     * Datarate of the retransmissions
+     */
+    LoRaMacRetransDatarate_t Datarate;
+}LoRaMacRetransPolicy_t;
+
 /*!
  * LoRaMAC MCPS-Request for a confirmed frame
  */
@@ -763,6 +842,10 @@ typedef struct sMcpsReqConfirmed
      * the datarate, in case the LoRaMAC layer did not receive an acknowledgment
      */
     uint8_t NbTrials;
+    /*!
+     * Retransmission policy, copied by the MAC. NULL for the LoRaWAN default.
+     */
+    const LoRaMacRetransPolicy_t* RetransPolicy;
 }McpsReqConfirmed_t;
 
 /*!
@@ -1300,6 +1383,10 @@ typedef struct sMlmeIndication
  * \ref MIB_ABP_LORAWAN_VERSION                  | NO  | YES
  * \ref MIB_LORAWAN_VERSION                      | YES | NO
  *
+ * \ref MIB_ANTENNA_GAIN and \ref MIB_DEFAULT_ANTENNA_GAIN are Q8.8 fixed point
+ * values in dBi, in \ref MibParam_t.AntennaGainQ8 and
+ * \ref MibParam_t.DefaultAntennaGainQ8.
+ *
  * The following table provides links to the function implementations of the
  * related MIB primitives:
  *
@@ -1635,8 +1722,11 @@ typedef enum eMib
      * radioTxPower = ( int8_t )floor( maxEirp - antennaGain )
      *
      * \remark The antenna gain value is referenced to the isotropic antenna.
-     *         The value is in dBi.
+     *         The value is in dBi, Q8.8 fixed point, see \ref LORAMAC_DB_TO_Q.
      *         MIB_ANTENNA_GAIN[dBi] = measuredAntennaGain[dBd] + 2.15
+     *
+     * \remark Formerly a float in dBi. Set it with
+     *         mibReq.Param.AntennaGainQ8 = LORAMAC_DB_TO_Q( 2.15 ) for 2.15 dBi.
      */
     MIB_ANTENNA_GAIN,
     /*!
@@ -1646,8 +1736,11 @@ typedef enum eMib
      * radioTxPower = ( int8_t )floor( maxEirp - antennaGain )
      *
      * \remark The antenna gain value is referenced to the isotropic antenna.
-     *         The value is in dBi.
+     *         The value is in dBi, Q8.8 fixed point, see \ref LORAMAC_DB_TO_Q.
      *         MIB_DEFAULT_ANTENNA_GAIN[dBi] = measuredAntennaGain[dBd] + 2.15
+     *
+     * \remark Formerly a float in dBi. Set it with
+     *         mibReq.Param.DefaultAntennaGainQ8 = LORAMAC_DB_TO_Q( 2.15 ) for 2.15 dBi.
      */
     MIB_DEFAULT_ANTENNA_GAIN,
     /*!
@@ -2037,17 +2130,17 @@ typedef union uMibParam
      */
     uint8_t MinRxSymbols;
     /*!
-     * Antenna gain
+     * Antenna gain in dBi, Q8.8 fixed point
      *
      * Related MIB type: \ref MIB_ANTENNA_GAIN
      */
-    float AntennaGain;
+    int16_t AntennaGainQ8;
     /*!
-     * Default antenna gain
+     * Default antenna gain in dBi, Q8.8 fixed point
      *
      * Related MIB type: \ref MIB_DEFAULT_ANTENNA_GAIN
      */
-    float DefaultAntennaGain;
+    int16_t DefaultAntennaGainQ8;
     /*!
      * Structure holding pointers to internal non-volatile contexts and its lengths.
      *
@@ -2448,6 +2541,17 @@ typedef struct sLoRaMacCallback
      *\warning  Runs in a IRQ context. Should only change variables state.
      */
     void ( *MacProcessNotify )( void );
+    /*!
+     *\brief    Will be called before an uplink frame counter is used for the
+     *          first time, to persist it. Called again with the same frame
+     *          counter when the frame could not be secured.
+     *
+     *\param    fCntUp Uplink frame counter of the frame about to be sent
+     *
+     *\retval   false if the frame counter can not be used, the frame is not
+     *          sent.
+     */
+    bool ( *ReserveFCntUp )( uint32_t fCntUp );
 }LoRaMacCallback_t;
 
 
@@ -2456,6 +2560,12 @@ typedef struct sLoRaMacCallback
  */
 static const uint8_t LoRaMacMaxEirpTable[] = { 8, 10, 12, 13, 14, 16, 18, 20, 21, 24, 26, 27, 29, 30, 33, 36 };
 
+/*!
+ * LoRaMac instance, see \ref LoRaMacInstance.h. The functions below act on
+ * the current instance, a default instance unless another one is selected.
+ */
+typedef struct sLoRaMacInstance LoRaMacInstance_t;
+
 /*!
  * \brief   LoRaMAC layer initialization
  *
@@ -2539,6 +2649,27 @@ void LoRaMacProcess( void );
  */
 LoRaMacStatus_t LoRaMacQueryTxPossible( uint8_t size, LoRaMacTxInfo_t* txInfo );
 
+/*!
+ * \brief   Returns the buffer to write the application payload of the next uplink to.
+ *
+ * \details The buffer is the FRMPayload field of the MAC frame buffer. When it is passed
+ *          as fBuffer of \ref LoRaMacMcpsRequest, the payload is encrypted and sent in
+ *          place, without copies. The payload must be written and sent before
+ *          \ref LoRaMacProcess runs again, as received MAC commands move the FRMPayload.
+ *
+ * \param   [OUT] buffer - Pointer to the FRMPayload field of the next uplink
+ *
+ * \param   [OUT] maxSize - Size of the buffer, may be NULL. The datarate may allow less,
+ *                          see \ref LoRaMacQueryTxPossible.
+ *
+ * \retval  LoRaMacStatus_t Status of the operation. Possible returns are:
+ *          \ref LORAMAC_STATUS_OK,
+ *          \ref LORAMAC_STATUS_BUSY,
+ *          \ref LORAMAC_STATUS_PARAMETER_INVALID,
+ *          \ref LORAMAC_STATUS_MAC_COMMAD_ERROR.
+ */
+LoRaMacStatus_t LoRaMacGetTxPayloadBuffer( uint8_t** buffer, uint8_t* maxSize );
+
 /*!
  * \brief   LoRaMAC channel add service
  *
@@ -29,8 +29,8 @@
  * \author    Daniel Jaeckle ( STACKFORCE )
  */
 
-#include <math.h>
 #include "utilities.h"
+#include "stm32_crc.h"
 #include "secure-element.h"
 #include "LoRaMac.h"
 #include "Region.h"
@@ -38,80 +38,78 @@
 #include "LoRaMacClassBConfig.h"
 #include "LoRaMacCrypto.h"
 #include "LoRaMacConfirmQueue.h"
+#include "LoRaMacInstance.h"
+#include "LoRaMacTest.h"
 
 #if ( LORAMAC_CLASSB_ENABLED == 1 )
 
-/*!
- * Defines the LoRaMac radio events status
+/*
+ * Class B events status of the current LoRaMac instance.
  */
-typedef union uLoRaMacClassBEvents
-{
-    uint32_t Value;
-    struct sEvents
-    {
-        uint32_t Beacon        : 1;
-        uint32_t PingSlot      : 1;
-        uint32_t MulticastSlot : 1;
-    }Events;
-}LoRaMacClassBEvents_t;
+#define LoRaMacClassBEvents             ( LoRaMacCurrentInstance->ClassBEvents )
 
-LoRaMacClassBEvents_t LoRaMacClassBEvents = { .Value = 0 };
+/*
+ * Non-volatile module context of the current LoRaMac instance.
+ */
+#define ClassBNvmCtx                    ( LoRaMacCurrentInstance->ClassBNvm )
 
 /*
- * Non-volatile module context.
+ * Module context of the current LoRaMac instance.
  */
-static LoRaMacClassBNvmCtx_t NvmCtx;
+#define Ctx                             ( LoRaMacCurrentInstance->ClassB )
+
 
 /*
- * Module context.
+ * Worst case frequency deviation of the RTC per square degree from the
+ * turnover temperature, as a fraction Q48. Evaluated by the compiler.
  */
-static LoRaMacClassBCtx_t Ctx;
+#define RTC_TEMP_COEFFICIENT_Q48        ( ( int64_t )( ( ( RTC_TEMP_COEFFICIENT < 0 ) ? \
+                                                         ( RTC_TEMP_COEFFICIENT - RTC_TEMP_DEV_COEFFICIENT ) : \
+                                                         ( RTC_TEMP_COEFFICIENT + RTC_TEMP_DEV_COEFFICIENT ) ) * \
+                                                       281474976710656.0 / 1000000.0 ) )
 
+/*
+ * Worst case turnover temperature of the RTC in degrees, Q8.8
+ */
+#define RTC_TEMP_TURNOVER_Q8            ( ( int32_t )( ( RTC_TEMP_TURNOVER - RTC_TEMP_DEV_TURNOVER ) * 256.0 ) )
 
 /*!
  * \brief Computes the temperature compensation for a period of time on a
  *        specific temperature.
  *
  * \param [IN] period Time period to compensate
- * \param [IN] temperature Current temperature
+ * \param [IN] temperature Current temperature in degrees
  *
  * \retval Compensated time period
  */
-static TimerTime_t TimerTempCompensation( TimerTime_t period, float temperature )
+static TimerTime_t TimerTempCompensation( TimerTime_t period, int16_t temperature )
 {
-  float k = RTC_TEMP_COEFFICIENT;
-  float kDev = RTC_TEMP_DEV_COEFFICIENT;
-  float t = RTC_TEMP_TURNOVER;
-  float tDev = RTC_TEMP_DEV_TURNOVER;
-  float interim = 0.0f;
-  float ppm = 0.0f;
-
-  if (k < 0.0f)
-  {
-    ppm = (k - kDev);
-  }
-  else
-  {
-    ppm = (k + kDev);
-  }
-  interim = (temperature - (t - tDev));
-  ppm *=  interim * interim;
+  int32_t deltaQ8 = ( int32_t )temperature * 256 - RTC_TEMP_TURNOVER_Q8;
+  int64_t driftQ32 = 0;
+  int64_t interim = 0;
+
+  // Limit to 128 degrees from the turnover, keeps the products below 2^63
+  deltaQ8 = MIN( MAX( deltaQ8, -( 128 * 256 ) ), 128 * 256 );
+  // Calculate the drift per time unit, Q48 * Q16 to Q32
+  driftQ32 = ( RTC_TEMP_COEFFICIENT_Q48 * ( ( int64_t )deltaQ8 * deltaQ8 ) ) >> 32;
 
-  // Calculate the drift in time
-  interim = ((float) period * ppm) / 1000000.0f;
-  // Calculate the resulting time period
-  interim += period;
-  interim = floor(interim);
+  // Calculate the resulting time period, the arithmetic shift rounds down like floor( )
+  interim = ( int64_t )period + ( ( ( int64_t )period * driftQ32 ) >> 32 );
 
-  if (interim < 0.0f)
+  if (interim < 0)
   {
-    interim = (float)period;
+    interim = period;
   }
 
   // Calculate the resulting period
   return ( UTIL_TIMER_Time_t ) interim;
 }
 
+uint32_t LoRaMacTestTempCompensation( uint32_t period, int16_t temperature )
+{
+    return TimerTempCompensation( period, temperature );
+}
+
 /*!
  * Computes the Ping Offset
  *
@@ -225,6 +223,66 @@ static uint32_t CalcDownlinkChannelAndFrequency( uint32_t devAddr, TimerTime_t b
     return CalcDownlinkFrequency( channel, isBeacon );
 }
 
+/*!
+ * \brief Computes the ping offsets and the frequencies of the unicast and of
+ *        the multicast ping slots, once per beacon period. The slot state
+ *        machines then only compute the next slot time.
+ */
+static void ComputePingSlotSchedule( void )
+{
+    MulticastCtx_t *cur = Ctx.LoRaMacClassBParams.MulticastChannels;
+    uint32_t beaconTime = Ctx.BeaconCtx.BeaconTime.Seconds;
+    uint32_t devAddr = *Ctx.LoRaMacClassBParams.LoRaMacDevAddr;
+
+    if( ( Ctx.PingSlotCtx.ScheduleValid == true ) &&
+        ( Ctx.PingSlotCtx.ScheduleBeaconTime == beaconTime ) &&
+        ( Ctx.PingSlotCtx.ScheduleDevAddr == devAddr ) )
+    {
+        return;
+    }
+
+    if( Ctx.NvmCtx->PingSlotCtx.Ctrl.Assigned == 1 )
+    {
+        ComputePingOffset( beaconTime, devAddr, Ctx.NvmCtx->PingSlotCtx.PingPeriod, &( Ctx.PingSlotCtx.PingOffset ) );
+
+        Ctx.PingSlotCtx.Frequency = Ctx.NvmCtx->PingSlotCtx.Frequency;
+        // Apply a custom frequency if the following bit is set
+        if( Ctx.NvmCtx->PingSlotCtx.Ctrl.CustomFreq == 0 )
+        {
+            // Restore floor plan
+            Ctx.PingSlotCtx.Frequency = CalcDownlinkChannelAndFrequency( devAddr, beaconTime, CLASSB_BEACON_INTERVAL, false );
+        }
+    }
+
+    if( cur != NULL )
+    {
+        for( uint8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++ )
+        {
+            ComputePingOffset( beaconTime, cur->ChannelParams.Address, cur->PingPeriod, &( cur->PingOffset ) );
+
+            Ctx.PingSlotCtx.MulticastFrequency[i] = cur->ChannelParams.RxParams.ClassB.Frequency;
+            // Restore the floor plan frequency if there is no individual frequency assigned
+            if( Ctx.PingSlotCtx.MulticastFrequency[i] == 0 )
+            {
+                Ctx.PingSlotCtx.MulticastFrequency[i] = CalcDownlinkChannelAndFrequency( cur->ChannelParams.Address, beaconTime,
+                                                                                         CLASSB_BEACON_INTERVAL, false );
+            }
+            cur++;
+        }
+    }
+
+    Ctx.PingSlotCtx.ScheduleBeaconTime = beaconTime;
+    Ctx.PingSlotCtx.ScheduleDevAddr = devAddr;
+    Ctx.PingSlotCtx.ScheduleValid = true;
+}
+
+uint32_t LoRaMacTestMulticastSlotSchedule( uint8_t groupID, uint16_t *pingPeriod )
+{
+    ComputePingSlotSchedule( );
+    *pingPeriod = Ctx.LoRaMacClassBParams.MulticastChannels[groupID].PingPeriod;
+    return Ctx.PingSlotCtx.MulticastFrequency[groupID];
+}
+
 /*!
  * \brief Calculates the correct frequency and opens up the beacon reception window.
  *
@@ -288,6 +346,7 @@ static void RxBeaconSetup( TimerTime_t rxTime, bool activateDefaultChannel )
     rxBeaconSetup.RxTime = rxTime;
     rxBeaconSetup.Frequency = frequency;
 
+    LoRaMacInstanceTakeRadio( );
     RegionRxBeaconSetup( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &rxBeaconSetup, &Ctx.LoRaMacClassBParams.McpsIndication->RxDatarate );
 
     Ctx.LoRaMacClassBParams.MlmeIndication->BeaconInfo.Frequency = frequency;
@@ -350,26 +409,13 @@ static bool CalcNextSlotTime( uint16_t slotOffset, uint16_t pingPeriod, uint16_t
  */
 static uint16_t BeaconCrc( uint8_t *buffer, uint16_t length )
 {
-    // The CRC calculation follows CCITT
-    const uint16_t polynom = 0x1021;
-    // CRC initial value
-    uint16_t crc = 0x0000;
-
     if( buffer == NULL )
     {
         return 0;
     }
 
-    for( uint16_t i = 0; i < length; ++i )
-    {
-        crc ^= ( uint16_t ) buffer[i] << 8;
-        for( uint16_t j = 0; j < 8; ++j )
-        {
-            crc = ( crc & 0x8000 ) ? ( crc << 1 ) ^ polynom : ( crc << 1 );
-        }
-    }
-
-    return crc;
+    // The CRC calculation follows CCITT, with the initial value 0
+    return UTIL_CRC16_Update( UTIL_CRC16_INIT, buffer, length );
 }
 
 static void GetTemperature( LoRaMacClassBCallback_t *callbacks, BeaconContext_t *beaconCtx )
@@ -377,7 +423,7 @@ static void GetTemperature( LoRaMacClassBCallback_t *callbacks, BeaconContext_t
     // Measure temperature, if available
     if( ( callbacks != NULL ) && ( callbacks->GetTemperatureLevel != NULL ) )
     {
-        beaconCtx->Temperature = callbacks->GetTemperatureLevel( );
+        beaconCtx->Temperature = ( int16_t )callbacks->GetTemperatureLevel( );
     }
 }
 
@@ -390,12 +436,12 @@ static void InitClassB( void )
     LoRaMacClassBEvents.Value = 0;
 
     // Init variables to default
-    memset1( ( uint8_t* ) &NvmCtx, 0, sizeof( LoRaMacClassBNvmCtx_t ) );
+    memset1( ( uint8_t* ) &ClassBNvmCtx, 0, sizeof( LoRaMacClassBNvmCtx_t ) );
     memset1( ( uint8_t* ) &Ctx.PingSlotCtx, 0, sizeof( PingSlotContext_t ) );
     memset1( ( uint8_t* ) &Ctx.BeaconCtx, 0, sizeof( BeaconContext_t ) );
 
     // Setup default temperature
-    Ctx.BeaconCtx.Temperature = 25.0;
+    Ctx.BeaconCtx.Temperature = 25;
     GetTemperature( &Ctx.LoRaMacClassBCallbacks, &Ctx.BeaconCtx );
 
     // Setup default ping slot datarate
@@ -553,15 +599,15 @@ void LoRaMacClassBInit( LoRaMacClassBParams_t *classBParams, LoRaMacClassBCallba
     Ctx.LoRaMacClassBParams = *classBParams;
 
     // Assign non-volatile context
-    Ctx.NvmCtx = &NvmCtx;
+    Ctx.NvmCtx = &ClassBNvmCtx;
 
     // Assign callback
     Ctx.LoRaMacClassBNvmEvent = classBNvmCtxChanged;
 
     // Initialize timers
-    TimerInit( &Ctx.BeaconTimer, LoRaMacClassBBeaconTimerEvent );
-    TimerInit( &Ctx.PingSlotTimer, LoRaMacClassBPingSlotTimerEvent );
-    TimerInit( &Ctx.MulticastSlotTimer, LoRaMacClassBMulticastSlotTimerEvent );
+    TimerInitWithContext( &Ctx.BeaconTimer, LoRaMacClassBBeaconTimerEvent, LoRaMacCurrentInstance );
+    TimerInitWithContext( &Ctx.PingSlotTimer, LoRaMacClassBPingSlotTimerEvent, LoRaMacCurrentInstance );
+    TimerInitWithContext( &Ctx.MulticastSlotTimer, LoRaMacClassBMulticastSlotTimerEvent, LoRaMacCurrentInstance );
 
     InitClassB( );
 #endif // LORAMAC_CLASSB_ENABLED
@@ -573,7 +619,8 @@ bool LoRaMacClassBRestoreNvmCtx( void* classBNvmCtx )
     // Restore module context
     if( classBNvmCtx != NULL )
     {
-        memcpy1( ( uint8_t* ) &NvmCtx, ( uint8_t* ) classBNvmCtx, sizeof( NvmCtx ) );
+        memcpy1( ( uint8_t* ) &ClassBNvmCtx, ( uint8_t* ) classBNvmCtx, sizeof( ClassBNvmCtx ) );
+        Ctx.PingSlotCtx.ScheduleValid = false;
         return true;
     }
     else
@@ -588,8 +635,8 @@ bool LoRaMacClassBRestoreNvmCtx( void* classBNvmCtx )
 void* LoRaMacClassBGetNvmCtx( size_t* classBNvmCtxSize )
 {
 #if ( LORAMAC_CLASSB_ENABLED == 1 )
-    *classBNvmCtxSize = sizeof( NvmCtx );
-    return &NvmCtx;
+    *classBNvmCtxSize = sizeof( ClassBNvmCtx );
+    return &ClassBNvmCtx;
 #else
     *classBNvmCtxSize = 0;
     return NULL;
@@ -663,6 +710,8 @@ bool LoRaMacClassBIsAcquisitionInProgress( void )
 void LoRaMacClassBBeaconTimerEvent( void* context )
 {
 #if ( LORAMAC_CLASSB_ENABLED == 1 )
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( context );
+
     Ctx.BeaconCtx.TimeStamp = TimerGetCurrentTime( );
     TimerStop( &Ctx.BeaconTimer );
     LoRaMacClassBEvents.Events.Beacon = 1;
@@ -671,6 +720,8 @@ void LoRaMacClassBBeaconTimerEvent( void* context )
     {
         Ctx.LoRaMacClassBCallbacks.MacProcessNotify( );
     }
+
+    LoRaMacInstanceSelect( previous );
 #endif // LORAMAC_CLASSB_ENABLED
 }
 
@@ -904,29 +955,29 @@ static void LoRaMacClassBProcessBeacon( void )
 void LoRaMacClassBPingSlotTimerEvent( void* context )
 {
 #if ( LORAMAC_CLASSB_ENABLED == 1 )
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( context );
+
     LoRaMacClassBEvents.Events.PingSlot = 1;
 
     if( Ctx.LoRaMacClassBCallbacks.MacProcessNotify != NULL )
     {
         Ctx.LoRaMacClassBCallbacks.MacProcessNotify( );
     }
+
+    LoRaMacInstanceSelect( previous );
 #endif // LORAMAC_CLASSB_ENABLED
 }
 
 #if ( LORAMAC_CLASSB_ENABLED == 1 )
 static void LoRaMacClassBProcessPingSlot( void )
 {
-    static RxConfigParams_t pingSlotRxConfig;
     TimerTime_t pingSlotTime = 0;
 
     switch( Ctx.PingSlotState )
     {
         case PINGSLOT_STATE_CALC_PING_OFFSET:
         {
-            ComputePingOffset( Ctx.BeaconCtx.BeaconTime.Seconds,
-                               *Ctx.LoRaMacClassBParams.LoRaMacDevAddr,
-                               Ctx.NvmCtx->PingSlotCtx.PingPeriod,
-                               &( Ctx.PingSlotCtx.PingOffset ) );
+            ComputePingSlotSchedule( );
             Ctx.PingSlotState = PINGSLOT_STATE_SET_TIMER;
         }
             // Intentional fall through
@@ -942,12 +993,12 @@ static void LoRaMacClassBProcessPingSlot( void )
                                                      Ctx.NvmCtx->PingSlotCtx.Datarate,
                                                      Ctx.LoRaMacClassBParams.LoRaMacParams->MinRxSymbols,
                                                      Ctx.LoRaMacClassBParams.LoRaMacParams->SystemMaxRxError,
-                                                     &pingSlotRxConfig );
-                    Ctx.PingSlotCtx.SymbolTimeout = pingSlotRxConfig.WindowTimeout;
+                                                     &Ctx.PingSlotRxConfig );
+                    Ctx.PingSlotCtx.SymbolTimeout = Ctx.PingSlotRxConfig.WindowTimeout;
 
-                    if( ( int32_t )pingSlotTime > pingSlotRxConfig.WindowOffset )
+                    if( ( int32_t )pingSlotTime > Ctx.PingSlotRxConfig.WindowOffset )
                     {// Apply the window offset
-                        pingSlotTime += pingSlotRxConfig.WindowOffset;
+                        pingSlotTime += Ctx.PingSlotRxConfig.WindowOffset;
                     }
                 }
 
@@ -960,15 +1011,7 @@ static void LoRaMacClassBProcessPingSlot( void )
         }
         case PINGSLOT_STATE_IDLE:
         {
-            uint32_t frequency = Ctx.NvmCtx->PingSlotCtx.Frequency;
-
-            // Apply a custom frequency if the following bit is set
-            if( Ctx.NvmCtx->PingSlotCtx.Ctrl.CustomFreq == 0 )
-            {
-                // Restore floor plan
-                frequency = CalcDownlinkChannelAndFrequency( *Ctx.LoRaMacClassBParams.LoRaMacDevAddr, Ctx.BeaconCtx.BeaconTime.Seconds,
-                                                             CLASSB_BEACON_INTERVAL, false );
-            }
+            uint32_t frequency = Ctx.PingSlotCtx.Frequency;
 
             // Open the ping slot window only, if there is no multicast ping slot
             // open. Multicast ping slots have always priority
@@ -976,16 +1019,17 @@ static void LoRaMacClassBProcessPingSlot( void )
             {
                 Ctx.PingSlotState = PINGSLOT_STATE_RX;
 
-                pingSlotRxConfig.Datarate = Ctx.NvmCtx->PingSlotCtx.Datarate;
-                pingSlotRxConfig.DownlinkDwellTime = Ctx.LoRaMacClassBParams.LoRaMacParams->DownlinkDwellTime;
-                pingSlotRxConfig.RepeaterSupport = Ctx.LoRaMacClassBParams.LoRaMacParams->RepeaterSupport;
-                pingSlotRxConfig.Frequency = frequency;
-                pingSlotRxConfig.RxContinuous = false;
-                pingSlotRxConfig.RxSlot = RX_SLOT_WIN_CLASS_B_PING_SLOT;
+                Ctx.PingSlotRxConfig.Datarate = Ctx.NvmCtx->PingSlotCtx.Datarate;
+                Ctx.PingSlotRxConfig.DownlinkDwellTime = Ctx.LoRaMacClassBParams.LoRaMacParams->DownlinkDwellTime;
+                Ctx.PingSlotRxConfig.RepeaterSupport = Ctx.LoRaMacClassBParams.LoRaMacParams->RepeaterSupport;
+                Ctx.PingSlotRxConfig.Frequency = frequency;
+                Ctx.PingSlotRxConfig.RxContinuous = false;
+                Ctx.PingSlotRxConfig.RxSlot = RX_SLOT_WIN_CLASS_B_PING_SLOT;
 
-                RegionRxConfig( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &pingSlotRxConfig, ( int8_t* )&Ctx.LoRaMacClassBParams.McpsIndication->RxDatarate );
+                RegionRxConfig( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &Ctx.PingSlotRxConfig, ( int8_t* )&Ctx.LoRaMacClassBParams.McpsIndication->RxDatarate );
 
-                if( pingSlotRxConfig.RxContinuous == false )
+                LoRaMacInstanceTakeRadio( );
+                if( Ctx.PingSlotRxConfig.RxContinuous == false )
                 {
                     Radio.Rx( Ctx.LoRaMacClassBParams.LoRaMacParams->MaxRxWindow );
                 }
@@ -1015,19 +1059,22 @@ static void LoRaMacClassBProcessPingSlot( void )
 void LoRaMacClassBMulticastSlotTimerEvent( void* context )
 {
 #if ( LORAMAC_CLASSB_ENABLED == 1 )
+    LoRaMacInstance_t* previous = LoRaMacInstanceSelect( context );
+
     LoRaMacClassBEvents.Events.MulticastSlot = 1;
 
     if( Ctx.LoRaMacClassBCallbacks.MacProcessNotify != NULL )
     {
         Ctx.LoRaMacClassBCallbacks.MacProcessNotify( );
     }
+
+    LoRaMacInstanceSelect( previous );
 #endif // LORAMAC_CLASSB_ENABLED
 }
 
 #if ( LORAMAC_CLASSB_ENABLED == 1 )
 static void LoRaMacClassBProcessMulticastSlot( void )
 {
-    static RxConfigParams_t multicastSlotRxConfig;
     TimerTime_t multicastSlotTime = 0;
     TimerTime_t slotTime = 0;
     MulticastCtx_t *cur = Ctx.LoRaMacClassBParams.MulticastChannels;
@@ -1049,14 +1096,7 @@ static void LoRaMacClassBProcessMulticastSlot( void )
         case PINGSLOT_STATE_CALC_PING_OFFSET:
         {
             // Compute all offsets for every multicast slots
-            for( uint8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++ )
-            {
-                ComputePingOffset( Ctx.BeaconCtx.BeaconTime.Seconds,
-                                   cur->ChannelParams.Address,
-                                   cur->PingPeriod,
-                                   &( cur->PingOffset ) );
-                cur++;
-            }
+            ComputePingSlotSchedule( );
             Ctx.MulticastSlotState = PINGSLOT_STATE_SET_TIMER;
         }
             // Intentional fall through
@@ -1089,13 +1129,13 @@ static void LoRaMacClassBProcessMulticastSlot( void )
                                                     Ctx.NvmCtx->PingSlotCtx.Datarate,
                                                     Ctx.LoRaMacClassBParams.LoRaMacParams->MinRxSymbols,
                                                     Ctx.LoRaMacClassBParams.LoRaMacParams->SystemMaxRxError,
-                                                    &multicastSlotRxConfig );
-                    Ctx.PingSlotCtx.SymbolTimeout = multicastSlotRxConfig.WindowTimeout;
+                                                    &Ctx.MulticastSlotRxConfig );
+                    Ctx.PingSlotCtx.SymbolTimeout = Ctx.MulticastSlotRxConfig.WindowTimeout;
                 }
 
-                if( ( int32_t )multicastSlotTime > multicastSlotRxConfig.WindowOffset )
+                if( ( int32_t )multicastSlotTime > Ctx.MulticastSlotRxConfig.WindowOffset )
                 {// Apply the window offset
-                    multicastSlotTime += multicastSlotRxConfig.WindowOffset;
+                    multicastSlotTime += Ctx.MulticastSlotRxConfig.WindowOffset;
                 }
 
                 // Start the timer if the ping slot time is in range
@@ -1119,26 +1159,18 @@ static void LoRaMacClassBProcessMulticastSlot( void )
             }
 
             // Apply frequency
-            frequency = Ctx.PingSlotCtx.NextMulticastChannel->ChannelParams.RxParams.ClassB.Frequency;
-
-            // Restore the floor plan frequency if there is no individual frequency assigned
-            if( frequency == 0 )
-            {
-                // Restore floor plan
-                frequency = CalcDownlinkChannelAndFrequency( Ctx.PingSlotCtx.NextMulticastChannel->ChannelParams.Address,
-                                                             Ctx.BeaconCtx.BeaconTime.Seconds, CLASSB_BEACON_INTERVAL, false );
-            }
+            frequency = Ctx.PingSlotCtx.MulticastFrequency[Ctx.PingSlotCtx.NextMulticastChannel - Ctx.LoRaMacClassBParams.MulticastChannels];
 
             Ctx.MulticastSlotState = PINGSLOT_STATE_RX;
 
-            multicastSlotRxConfig.Datarate = Ctx.PingSlotCtx.NextMulticastChannel->ChannelParams.RxParams.ClassB.Datarate;
-            multicastSlotRxConfig.DownlinkDwellTime = Ctx.LoRaMacClassBParams.LoRaMacParams->DownlinkDwellTime;
-            multicastSlotRxConfig.RepeaterSupport = Ctx.LoRaMacClassBParams.LoRaMacParams->RepeaterSupport;
-            multicastSlotRxConfig.Frequency = frequency;
-            multicastSlotRxConfig.RxContinuous = false;
-            multicastSlotRxConfig.RxSlot = RX_SLOT_WIN_CLASS_B_MULTICAST_SLOT;
+            Ctx.MulticastSlotRxConfig.Datarate = Ctx.PingSlotCtx.NextMulticastChannel->ChannelParams.RxParams.ClassB.Datarate;
+            Ctx.MulticastSlotRxConfig.DownlinkDwellTime = Ctx.LoRaMacClassBParams.LoRaMacParams->DownlinkDwellTime;
+            Ctx.MulticastSlotRxConfig.RepeaterSupport = Ctx.LoRaMacClassBParams.LoRaMacParams->RepeaterSupport;
+            Ctx.MulticastSlotRxConfig.Frequency = frequency;
+            Ctx.MulticastSlotRxConfig.RxContinuous = false;
+            Ctx.MulticastSlotRxConfig.RxSlot = RX_SLOT_WIN_CLASS_B_MULTICAST_SLOT;
 
-            RegionRxConfig( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &multicastSlotRxConfig, ( int8_t* )&Ctx.LoRaMacClassBParams.McpsIndication->RxDatarate );
+            RegionRxConfig( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &Ctx.MulticastSlotRxConfig, ( int8_t* )&Ctx.LoRaMacClassBParams.McpsIndication->RxDatarate );
 
             if( Ctx.PingSlotState == PINGSLOT_STATE_RX )
             {
@@ -1149,7 +1181,8 @@ static void LoRaMacClassBProcessMulticastSlot( void )
                 TimerStart( &Ctx.PingSlotTimer );
             }
 
-            if( multicastSlotRxConfig.RxContinuous == false )
+            LoRaMacInstanceTakeRadio( );
+            if( Ctx.MulticastSlotRxConfig.RxContinuous == false )
             {
                 Radio.Rx( Ctx.LoRaMacClassBParams.LoRaMacParams->MaxRxWindow );
             }
@@ -1357,6 +1390,7 @@ void LoRaMacClassBSetPingSlotInfo( uint8_t periodicity )
 #if ( LORAMAC_CLASSB_ENABLED == 1 )
     Ctx.NvmCtx->PingSlotCtx.PingNb = CalcPingNb( periodicity );
     Ctx.NvmCtx->PingSlotCtx.PingPeriod = CalcPingPeriod( Ctx.NvmCtx->PingSlotCtx.PingNb );
+    Ctx.PingSlotCtx.ScheduleValid = false;
     NvmContextChange( );
 #endif // LORAMAC_CLASSB_ENABLED
 }
@@ -1493,6 +1527,7 @@ void LoRaMacClassBPingSlotInfoAns( void )
     {
         LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_PING_SLOT_INFO );
         Ctx.NvmCtx->PingSlotCtx.Ctrl.Assigned = 1;
+        Ctx.PingSlotCtx.ScheduleValid = false;
         NvmContextChange( );
     }
 #endif // LORAMAC_CLASSB_ENABLED
@@ -1536,6 +1571,7 @@ uint8_t LoRaMacClassBPingSlotChannelReq( uint8_t datarate, uint32_t frequency )
             Ctx.NvmCtx->PingSlotCtx.Frequency = 0;
         }
         Ctx.NvmCtx->PingSlotCtx.Datarate = datarate;
+        Ctx.PingSlotCtx.ScheduleValid = false;
         NvmContextChange( );
     }
 
@@ -1681,6 +1717,9 @@ void LoRaMacClassBStartRxSlots( void )
 #if ( LORAMAC_CLASSB_ENABLED == 1 )
     if( Ctx.NvmCtx->PingSlotCtx.Ctrl.Assigned == 1 )
     {
+        // Compute the ping slots of the new beacon period now, not in the first slot
+        ComputePingSlotSchedule( );
+
         Ctx.PingSlotState = PINGSLOT_STATE_CALC_PING_OFFSET;
         TimerSetValue( &Ctx.PingSlotTimer, 1 );
         TimerStart( &Ctx.PingSlotTimer );
@@ -1699,6 +1738,7 @@ void LoRaMacClassBSetMulticastPeriodicity( MulticastCtx_t* multicastChannel )
     {
         multicastChannel->PingNb = CalcPingNb( multicastChannel->ChannelParams.RxParams.ClassB.Periodicity );
         multicastChannel->PingPeriod = CalcPingPeriod( multicastChannel->PingNb );
+        Ctx.PingSlotCtx.ScheduleValid = false;
     }
 #endif // LORAMAC_CLASSB_ENABLED
 }
@@ -44,6 +44,7 @@ extern "C"
 
 #include "systime.h"
 #include "LoRaMacTypes.h"
+#include "Region.h"
 
 /*!
  * States of the class B beacon acquisition and tracking
@@ -144,6 +145,27 @@ typedef struct sPingSlotContext
      * The multicast channel which will be enabled next.
      */
     MulticastCtx_t *NextMulticastChannel;
+    /*!
+     * Set if the ping offsets and frequencies of the unicast and multicast
+     * ping slots are computed for the beacon period of ScheduleBeaconTime
+     */
+    bool ScheduleValid;
+    /*!
+     * Beacon time of the beacon period of the ping slot schedule
+     */
+    uint32_t ScheduleBeaconTime;
+    /*!
+     * Device address of the unicast ping slots of the schedule
+     */
+    uint32_t ScheduleDevAddr;
+    /*!
+     * Frequency of the unicast ping slots of the beacon period
+     */
+    uint32_t Frequency;
+    /*!
+     * Frequencies of the multicast ping slots of the beacon period
+     */
+    uint32_t MulticastFrequency[LORAMAC_MAX_MC_CTX];
 }PingSlotContext_t;
 
 
@@ -181,9 +203,9 @@ typedef struct sBeaconContext
     }Ctrl;
 
     /*!
-     * Current temperature
+     * Current temperature in degrees
      */
-    float Temperature;
+    int16_t Temperature;
     /*!
      * Beacon time received with the beacon frame
      */
@@ -414,8 +436,30 @@ typedef struct sLoRaMacClassBCtx
     * Non-volatile module context.
     */
     LoRaMacClassBNvmCtx_t* NvmCtx;
+    /*!
+    * Rx configuration of the last unicast ping slot.
+    */
+    RxConfigParams_t PingSlotRxConfig;
+    /*!
+    * Rx configuration of the last multicast ping slot.
+    */
+    RxConfigParams_t MulticastSlotRxConfig;
 } LoRaMacClassBCtx_t;
 
+/*!
+ * Defines the LoRaMac Class B events status
+ */
+typedef union uLoRaMacClassBEvents
+{
+    uint32_t Value;
+    struct sClassBEvents
+    {
+        uint32_t Beacon        : 1;
+        uint32_t PingSlot      : 1;
+        uint32_t MulticastSlot : 1;
+    }Events;
+}LoRaMacClassBEvents_t;
+
 /*!
  * \brief Initialize LoRaWAN Class B
  *
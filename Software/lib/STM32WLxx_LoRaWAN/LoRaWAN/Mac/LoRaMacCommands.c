@@ -33,281 +33,109 @@
 #include "utilities.h"
 #include "LoRaMacCommands.h"
 #include "LoRaMacConfirmQueue.h"
-
-/*!
- * Number of MAC Command slots
- */
-#define NUM_OF_MAC_COMMANDS 15
+#include "LoRaMacInstance.h"
 
 /*!
  * Size of the CID field of MAC commands
  */
 #define CID_FIELD_SIZE 1
 
-/*!
- *  Mac Commands list structure
- */
-typedef struct sMacCommandsList
-{
-    /*
-     * First element of MAC command list.
-     */
-    MacCommand_t* First;
-    /*
-     * Last element of MAC command list.
-     */
-    MacCommand_t* Last;
-} MacCommandsList_t;
-
-/*!
- * LoRaMac Commands Context structure
- */
-typedef struct sLoRaMacCommandsCtx
-{
-    /*
-     * List of MAC command elements
-     */
-    MacCommandsList_t MacCommandList;
-    /*
-     * Buffer to store MAC command elements
-     */
-    MacCommand_t MacCommandSlots[NUM_OF_MAC_COMMANDS];
-    /*
-     * Size of all MAC commands serialized as buffer
-     */
-    size_t SerializedCmdsSize;
-} LoRaMacCommandsCtx_t;
+#if ( NUM_OF_MAC_COMMANDS > 16 )
+#error "The sticky MAC commands bitmap holds 16 MAC commands"
+#endif
 
 /*!
  * Callback function to notify the upper layer about context change
  */
-static LoRaMacCommandsNvmEvent CommandsNvmCtxChanged;
-
-/*!
- * Non-volatile module context.
- */
-static LoRaMacCommandsCtx_t NvmCtx;
-
-/* Memory management functions */
+#define CommandsNvmCtxChanged   ( LoRaMacCurrentInstance->CommandsNvmCtxChanged )
 
 /*!
- * \brief Determines if a MAC command slot is free
- *
- * \param[IN]     slot           - Slot to check
- * \retval                       - Status of the operation
+ * Non-volatile module context of the current LoRaMac instance.
  */
-static bool IsSlotFree( const MacCommand_t* slot )
-{
-    uint8_t* mem = ( uint8_t* )slot;
-
-    for( uint16_t size = 0; size < sizeof( MacCommand_t ); size++ )
-    {
-        if( mem[size] != 0x00 )
-        {
-            return false;
-        }
-    }
-    return true;
-}
+#define NvmCtx                  ( LoRaMacCurrentInstance->Commands )
 
-/*!
- * \brief Allocates a new MAC command memory slot
- *
- * \retval                       - Pointer to slot
- */
-static MacCommand_t* MallocNewMacCommandSlot( void )
-{
-    uint8_t itr = 0;
-
-    while( IsSlotFree( ( const MacCommand_t* )&NvmCtx.MacCommandSlots[itr] ) == false )
-    {
-        itr++;
-        if( itr == NUM_OF_MAC_COMMANDS )
-        {
-            return NULL;
-        }
-    }
-
-    return &NvmCtx.MacCommandSlots[itr];
-}
-
-/*!
- * \brief Free memory slot
- *
- * \param[IN]     slot           - Slot to free
+/*
+ * \brief Determines if a MAC command is sticky or not
  *
- * \retval                       - Status of the operation
- */
-static bool FreeMacCommandSlot( MacCommand_t* slot )
-{
-    if( slot == NULL )
-    {
-        return false;
-    }
-
-    memset1( ( uint8_t* )slot, 0x00, sizeof( MacCommand_t ) );
-
-    return true;
-}
-
-/* Linked list functions */
-
-/*!
- * \brief Initialize list
+ * \param[IN]   cid                - MAC command identifier
  *
- * \param[IN]     list           - List that shall be initialized
- * \retval                       - Status of the operation
+ * \retval                     - Status of the operation
  */
-static bool LinkedListInit( MacCommandsList_t* list )
+static bool IsSticky( uint8_t cid )
 {
-    if( list == NULL )
+    switch( cid )
     {
-        return false;
+        case MOTE_MAC_DL_CHANNEL_ANS:
+        case MOTE_MAC_RX_PARAM_SETUP_ANS:
+        case MOTE_MAC_RX_TIMING_SETUP_ANS:
+        case MOTE_MAC_TX_PARAM_SETUP_ANS:
+            return true;
+        default:
+            return false;
     }
-
-    list->First = NULL;
-    list->Last = NULL;
-
-    return true;
 }
 
-/*!
- * \brief Add an element to the list
- *
- * \param[IN]     list           - List where the element shall be added.
- * \param[IN]     element        - Element to add
- * \retval                       - Status of the operation
+/*
+ * \brief Wrapper function for the NvmCtx
  */
-static bool LinkedListAdd( MacCommandsList_t* list, MacCommand_t* element )
+static void NvmCtxCallback( void )
 {
-    if( ( list == NULL ) || ( element == NULL ) )
-    {
-        return false;
-    }
-
-    // Check if this is the first entry to enter the list.
-    if( list->First == NULL )
-    {
-        list->First = element;
-    }
-
-    // Check if the last entry exists and update its next point.
-    if( list->Last )
+    if( CommandsNvmCtxChanged != NULL )
     {
-        list->Last->Next = element;
+        CommandsNvmCtxChanged( );
     }
-
-    // Update the next point of this entry.
-    element->Next = NULL;
-
-    // Update the last entry of the list.
-    list->Last = element;
-
-    return true;
 }
 
 /*!
- * \brief Return the previous element in the list.
- *
- * \param[IN]     list           - List
- * \param[IN]     element        - Element where the previous element shall be searched
- * \retval                       - Status of the operation
+ * \brief Rebuilds the CID index from the MAC command elements
  */
-static MacCommand_t* LinkedListGetPrevious( MacCommandsList_t* list, MacCommand_t* element )
+static void RebuildCidIndex( void )
 {
-    if( ( list == NULL ) || ( element == NULL ) )
-    {
-        return NULL;
-    }
-
-    MacCommand_t* curElement;
+    memset1( NvmCtx.CidIndex, 0, sizeof( NvmCtx.CidIndex ) );
 
-    // Start at the head of the list
-    curElement = list->First;
-
-    // When current element is the first of the list, there's no previous element so we can return NULL immediately.
-    if( element != curElement )
+    // Walk backwards, so the index ends on the first element of every CID
+    for( uint8_t i = NvmCtx.NumOfMacCommands; i > 0; i-- )
     {
-        // Loop through all elements until the end is reached or the next of current is the current element.
-        while( ( curElement != NULL ) && ( curElement->Next != element ) )
+        if( NvmCtx.MacCommands[i - 1].CID < LORAMAC_COMMANDS_NUM_OF_INDEXED_CIDS )
         {
-            curElement = curElement->Next;
+            NvmCtx.CidIndex[NvmCtx.MacCommands[i - 1].CID] = i;
         }
     }
-    else
-    {
-        curElement = NULL;
-    }
-
-    return curElement;
 }
 
 /*!
- * \brief Remove an element from the list
+ * \brief Removes MAC command elements and compacts the remaining ones
  *
- * \param[IN]     list           - List where the element shall be removed from.
- * \param[IN]     element        - Element to remove
- * \retval                       - Status of the operation
+ * \param[IN]     cmds           - Bit n is set to remove the element n
  */
-static bool LinkedListRemove( MacCommandsList_t* list, MacCommand_t* element )
+static void RemoveCmds( uint16_t cmds )
 {
-    if( ( list == NULL ) || ( element == NULL ) )
-    {
-        return false;
-    }
-
-    MacCommand_t* PrevElement = LinkedListGetPrevious( list, element );
-
-    if( list->First == element )
-    {
-        list->First = element->Next;
-    }
-
-    if( list->Last == element )
-    {
-        list->Last = PrevElement;
-    }
-
-    if( PrevElement != NULL )
-    {
-        PrevElement->Next = element->Next;
-    }
-
-    element->Next = NULL;
-
-    return true;
-}
+    uint8_t itr = 0;
+    uint16_t stickyCmds = 0;
 
-/*
- * \brief Determines if a MAC command is sticky or not
- *
- * \param[IN]   cid                - MAC command identifier
- *
- * \retval                     - Status of the operation
- */
-static bool IsSticky( uint8_t cid )
-{
-    switch( cid )
+    for( uint8_t i = 0; i < NvmCtx.NumOfMacCommands; i++ )
     {
-        case MOTE_MAC_DL_CHANNEL_ANS:
-        case MOTE_MAC_RX_PARAM_SETUP_ANS:
-        case MOTE_MAC_RX_TIMING_SETUP_ANS:
-        case MOTE_MAC_TX_PARAM_SETUP_ANS:
-            return true;
-        default:
-            return false;
+        if( ( cmds & ( 1U << i ) ) != 0 )
+        {
+            NvmCtx.SerializedCmdsSize -= ( CID_FIELD_SIZE + NvmCtx.MacCommands[i].PayloadSize );
+            continue;
+        }
+        if( ( NvmCtx.StickyCmds & ( 1U << i ) ) != 0 )
+        {
+            stickyCmds |= 1U << itr;
+        }
+        if( itr != i )
+        {
+            NvmCtx.MacCommands[itr] = NvmCtx.MacCommands[i];
+        }
+        itr++;
     }
-}
+    // Keep the unused elements cleared in the non-volatile context
+    memset1( ( uint8_t* )&NvmCtx.MacCommands[itr], 0, ( NvmCtx.NumOfMacCommands - itr ) * sizeof( MacCommand_t ) );
 
-/*
- * \brief Wrapper function for the NvmCtx
- */
-static void NvmCtxCallback( void )
-{
-    if( CommandsNvmCtxChanged != NULL )
-    {
-        CommandsNvmCtxChanged( );
-    }
+    NvmCtx.NumOfMacCommands = itr;
+    NvmCtx.StickyCmds = stickyCmds;
+    RebuildCidIndex( );
 }
 
 LoRaMacCommandStatus_t LoRaMacCommandsInit( LoRaMacCommandsNvmEvent commandsNvmCtxChanged )
@@ -315,8 +143,6 @@ LoRaMacCommandStatus_t LoRaMacCommandsInit( LoRaMacCommandsNvmEvent commandsNvmC
     // Initialize with default
     memset1( ( uint8_t* )&NvmCtx, 0, sizeof( NvmCtx ) );
 
-    LinkedListInit( &NvmCtx.MacCommandList );
-
     // Assign callback
     CommandsNvmCtxChanged = commandsNvmCtxChanged;
 
@@ -351,25 +177,28 @@ LoRaMacCommandStatus_t LoRaMacCommandsAddCmd( uint8_t cid, uint8_t* payload, siz
     }
     MacCommand_t* newCmd;
 
-    // Allocate a memory slot
-    newCmd = MallocNewMacCommandSlot( );
-
-    if( newCmd == NULL )
+    if( NvmCtx.NumOfMacCommands == NUM_OF_MAC_COMMANDS )
     {
         return LORAMAC_COMMANDS_ERROR_MEMORY;
     }
 
-    // Add it to the list of Mac commands
-    if( LinkedListAdd( &NvmCtx.MacCommandList, newCmd ) == false )
-    {
-        return LORAMAC_COMMANDS_ERROR;
-    }
+    // Append it to the MAC commands
+    newCmd = &NvmCtx.MacCommands[NvmCtx.NumOfMacCommands];
 
     // Set Values
     newCmd->CID = cid;
     newCmd->PayloadSize = payloadSize;
     memcpy1( ( uint8_t* )newCmd->Payload, payload, payloadSize );
-    newCmd->IsSticky = IsSticky( cid );
+
+    if( IsSticky( cid ) == true )
+    {
+        NvmCtx.StickyCmds |= 1U << NvmCtx.NumOfMacCommands;
+    }
+    if( ( cid < LORAMAC_COMMANDS_NUM_OF_INDEXED_CIDS ) && ( NvmCtx.CidIndex[cid] == 0 ) )
+    {
+        NvmCtx.CidIndex[cid] = NvmCtx.NumOfMacCommands + 1;
+    }
+    NvmCtx.NumOfMacCommands++;
 
     NvmCtx.SerializedCmdsSize += ( CID_FIELD_SIZE + payloadSize );
 
@@ -385,19 +214,13 @@ LoRaMacCommandStatus_t LoRaMacCommandsRemoveCmd( MacCommand_t* macCmd )
         return LORAMAC_COMMANDS_ERROR_NPE;
     }
 
-    // Remove the Mac command element from MacCommandList
-    if( LinkedListRemove( &NvmCtx.MacCommandList, macCmd ) == false )
+    // Check that the element is one of the MAC commands
+    if( ( macCmd < NvmCtx.MacCommands ) || ( macCmd >= &NvmCtx.MacCommands[NvmCtx.NumOfMacCommands] ) )
     {
         return LORAMAC_COMMANDS_ERROR_CMD_NOT_FOUND;
     }
 
-    NvmCtx.SerializedCmdsSize -= ( CID_FIELD_SIZE + macCmd->PayloadSize );
-
-    // Free the MacCommand Slot
-    if( FreeMacCommandSlot( macCmd ) == false )
-    {
-        return LORAMAC_COMMANDS_ERROR;
-    }
+    RemoveCmds( 1U << ( macCmd - NvmCtx.MacCommands ) );
 
     NvmCtxCallback( );
 
@@ -406,15 +229,26 @@ LoRaMacCommandStatus_t LoRaMacCommandsRemoveCmd( MacCommand_t* macCmd )
 
 LoRaMacCommandStatus_t LoRaMacCommandsGetCmd( uint8_t cid, MacCommand_t** macCmd )
 {
-    MacCommand_t* curElement;
-
-    // Start at the head of the list
-    curElement = NvmCtx.MacCommandList.First;
+    MacCommand_t* curElement = NULL;
 
-    // Loop through all elements until we find the element with the given CID
-    while( ( curElement != NULL ) && ( curElement->CID != cid ) )
+    if( cid < LORAMAC_COMMANDS_NUM_OF_INDEXED_CIDS )
     {
-        curElement = curElement->Next;
+        if( NvmCtx.CidIndex[cid] != 0 )
+        {
+            curElement = &NvmCtx.MacCommands[NvmCtx.CidIndex[cid] - 1];
+        }
+    }
+    else
+    {
+        // Proprietary commands are not indexed
+        for( uint8_t i = 0; i < NvmCtx.NumOfMacCommands; i++ )
+        {
+            if( NvmCtx.MacCommands[i].CID == cid )
+            {
+                curElement = &NvmCtx.MacCommands[i];
+                break;
+            }
+        }
     }
 
     // Update the pointer anyway
@@ -430,26 +264,7 @@ LoRaMacCommandStatus_t LoRaMacCommandsGetCmd( uint8_t cid, MacCommand_t** macCmd
 
 LoRaMacCommandStatus_t LoRaMacCommandsRemoveNoneStickyCmds( void )
 {
-    MacCommand_t* curElement;
-    MacCommand_t* nexElement;
-
-    // Start at the head of the list
-    curElement = NvmCtx.MacCommandList.First;
-
-    // Loop through all elements
-    while( curElement != NULL )
-    {
-        if( curElement->IsSticky == false )
-        {
-            nexElement = curElement->Next;
-            LoRaMacCommandsRemoveCmd( curElement );
-            curElement = nexElement;
-        }
-        else
-        {
-            curElement = curElement->Next;
-        }
-    }
+    RemoveCmds( ( uint16_t )~NvmCtx.StickyCmds );
 
     NvmCtxCallback( );
 
@@ -458,22 +273,7 @@ LoRaMacCommandStatus_t LoRaMacCommandsRemoveNoneStickyCmds( void )
 
 LoRaMacCommandStatus_t LoRaMacCommandsRemoveStickyAnsCmds( void )
 {
-    MacCommand_t* curElement;
-    MacCommand_t* nexElement;
-
-    // Start at the head of the list
-    curElement = NvmCtx.MacCommandList.First;
-
-    // Loop through all elements
-    while( curElement != NULL )
-    {
-        nexElement = curElement->Next;
-        if( IsSticky( curElement->CID ) == true )
-        {
-            LoRaMacCommandsRemoveCmd( curElement );
-        }
-        curElement = nexElement;
-    }
+    RemoveCmds( NvmCtx.StickyCmds );
 
     NvmCtxCallback( );
 
@@ -492,9 +292,9 @@ LoRaMacCommandStatus_t LoRaMacCommandsGetSizeSerializedCmds( size_t* size )
 
 LoRaMacCommandStatus_t LoRaMacCommandsSerializeCmds( size_t availableSize, size_t* effectiveSize, uint8_t* buffer )
 {
-    MacCommand_t* curElement = NvmCtx.MacCommandList.First;
-    MacCommand_t* nextElement;
+    MacCommand_t* curElement;
     uint8_t itr = 0;
+    uint8_t i;
 
     if( ( buffer == NULL ) || ( effectiveSize == NULL ) )
     {
@@ -502,10 +302,12 @@ LoRaMacCommandStatus_t LoRaMacCommandsSerializeCmds( size_t availableSize, size_
     }
 
     // Loop through all elements which fits into the buffer
-    while( curElement != NULL )
+    for( i = 0; i < NvmCtx.NumOfMacCommands; i++ )
     {
+        curElement = &NvmCtx.MacCommands[i];
+
         // If the next MAC command still fits into the buffer, add it.
-        if( ( availableSize - itr ) >= ( CID_FIELD_SIZE + curElement->PayloadSize ) )
+        if( ( availableSize - itr ) >= ( size_t )( CID_FIELD_SIZE + curElement->PayloadSize ) )
         {
             buffer[itr++] = curElement->CID;
             memcpy1( &buffer[itr], curElement->Payload, curElement->PayloadSize );
@@ -515,16 +317,13 @@ LoRaMacCommandStatus_t LoRaMacCommandsSerializeCmds( size_t availableSize, size_
         {
             break;
         }
-        curElement = curElement->Next;
     }
 
     // Remove all commands which do not fit into the buffer
-    while( curElement != NULL )
+    if( i < NvmCtx.NumOfMacCommands )
     {
-        // Store the next element before removing the current one
-        nextElement = curElement->Next;
-        LoRaMacCommandsRemoveCmd( curElement );
-        curElement = nextElement;
+        RemoveCmds( ( uint16_t )~( ( 1U << i ) - 1 ) );
+        NvmCtxCallback( );
     }
 
     // Fetch the effective size of the mac commands
@@ -539,22 +338,8 @@ LoRaMacCommandStatus_t LoRaMacCommandsStickyCmdsPending( bool* cmdsPending )
     {
         return LORAMAC_COMMANDS_ERROR_NPE;
     }
-    MacCommand_t* curElement;
-    curElement = NvmCtx.MacCommandList.First;
 
-    *cmdsPending = false;
-
-    // Loop through all elements
-    while( curElement != NULL )
-    {
-        if( curElement->IsSticky == true )
-        {
-            // Found one sticky MAC command
-            *cmdsPending = true;
-            return LORAMAC_COMMANDS_SUCCESS;
-        }
-        curElement = curElement->Next;
-    }
+    *cmdsPending = ( NvmCtx.StickyCmds != 0 );
 
     return LORAMAC_COMMANDS_SUCCESS;
 }
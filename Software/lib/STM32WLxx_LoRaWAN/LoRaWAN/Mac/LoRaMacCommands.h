@@ -51,16 +51,21 @@ extern "C"
 #define LORAMAC_COMMADS_MAX_NUM_OF_PARAMS   2
 
 /*!
- * LoRaWAN MAC Command element
+ * Number of MAC Command slots
+ */
+#define NUM_OF_MAC_COMMANDS 15
+
+/*!
+ * Number of MAC command identifiers found with a direct index, covers the
+ * MAC commands of the LoRaWAN specification
  */
-typedef struct sMacCommand MacCommand_t;
+#define LORAMAC_COMMANDS_NUM_OF_INDEXED_CIDS 32
 
-struct sMacCommand
+/*!
+ * LoRaWAN MAC Command element
+ */
+typedef struct sMacCommand
 {
-    /*!
-     *  The pointer to the next MAC Command element in the list
-     */
-    MacCommand_t* Next;
     /*!
      * MAC command identifier
      */
@@ -72,12 +77,8 @@ struct sMacCommand
     /*!
      * Size of MAC command payload
      */
-    size_t PayloadSize;
-    /*!
-     * Indicates if it's a sticky MAC command
-     */
-    bool IsSticky;
-};
+    uint8_t PayloadSize;
+}MacCommand_t;
 
 /*!
  * LoRaMac Commands Status
@@ -116,6 +117,36 @@ typedef enum eLoRaMacCommandsStatus
  */
 typedef void ( *LoRaMacCommandsNvmEvent )( void );
 
+/*!
+ * LoRaMac Commands Context structure
+ */
+typedef struct sLoRaMacCommandsCtx
+{
+    /*
+     * MAC command elements in the order they were added, the first
+     * NumOfMacCommands elements are used. python3 tools/host_test.py mac_commands
+     * checks them against the former linked list
+     */
+    MacCommand_t MacCommands[NUM_OF_MAC_COMMANDS];
+    /*
+     * Number of MAC command elements
+     */
+    uint8_t NumOfMacCommands;
+    /*
+     * Position + 1 of the first MAC command element of every CID below
+     * LORAMAC_COMMANDS_NUM_OF_INDEXED_CIDS, 0 if there is none
+     */
+    uint8_t CidIndex[LORAMAC_COMMANDS_NUM_OF_INDEXED_CIDS];
+    /*
+     * Bit n is set if the MAC command element n is sticky
+     */
+    uint16_t StickyCmds;
+    /*
+     * Size of all MAC commands serialized as buffer
+     */
+    size_t SerializedCmdsSize;
+} LoRaMacCommandsCtx_t;
+
 /*!
  * \brief Initialization of LoRaMac MAC commands module
  *
@@ -36,63 +36,17 @@
 #include "utilities.h"
 #include "LoRaMac.h"
 #include "LoRaMacConfirmQueue.h"
-
-
-/*
- * LoRaMac Confirm Queue Context NVM structure
- */
-typedef struct sLoRaMacConfirmQueueNvmCtx
-{
-    /*!
-    * MlmeConfirm queue data structure
-    */
-    MlmeConfirmQueue_t MlmeConfirmQueue[LORA_MAC_MLME_CONFIRM_QUEUE_LEN];
-    /*!
-    * Counts the number of MlmeConfirms to process
-    */
-    uint8_t MlmeConfirmQueueCnt;
-    /*!
-    * Variable which holds a common status
-    */
-    LoRaMacEventInfoStatus_t CommonStatus;
-} LoRaMacConfirmQueueNvmCtx_t;
-
-/*
- * LoRaMac Confirm Queue Context structure
- */
-typedef struct sLoRaMacConfirmQueueCtx
-{
-    /*!
-    * LoRaMac callback function primitives
-    */
-    LoRaMacPrimitives_t* Primitives;
-    /*!
-    * Pointer to the first element of the ring buffer
-    */
-    MlmeConfirmQueue_t* BufferStart;
-    /*!
-    * Pointer to the last element of the ring buffer
-    */
-    MlmeConfirmQueue_t* BufferEnd;
-    /*
-     * Callback function to notify the upper layer about context change
-     */
-    LoRaMacConfirmQueueNvmEvent LoRaMacConfirmQueueNvmEvent;
-    /*!
-    * Non-volatile module context.
-    */
-    LoRaMacConfirmQueueNvmCtx_t* ConfirmQueueNvmCtx;
-} LoRaMacConfirmQueueCtx_t;
+#include "LoRaMacInstance.h"
 
 /*
- * Non-volatile module context.
+ * Non-volatile module context of the current LoRaMac instance.
  */
-static LoRaMacConfirmQueueNvmCtx_t ConfirmQueueNvmCtx;
+#define QueueNvmCtx                     ( LoRaMacCurrentInstance->ConfirmQueueNvm )
 
 /*
- * Module context.
+ * Module context of the current LoRaMac instance.
  */
-static LoRaMacConfirmQueueCtx_t ConfirmQueueCtx;
+#define ConfirmQueueCtx                 ( LoRaMacCurrentInstance->ConfirmQueue )
 
 static MlmeConfirmQueue_t* IncreaseBufferPointer( MlmeConfirmQueue_t* bufferPointer )
 {
@@ -168,7 +122,7 @@ void LoRaMacConfirmQueueInit( LoRaMacPrimitives_t* primitives, LoRaMacConfirmQue
     ConfirmQueueCtx.Primitives = primitives;
 
     // Assign nvm context
-    ConfirmQueueCtx.ConfirmQueueNvmCtx = &ConfirmQueueNvmCtx;
+    ConfirmQueueCtx.ConfirmQueueNvmCtx = &QueueNvmCtx;
 
     // Init counter
     ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueueCnt = 0;
@@ -191,7 +145,7 @@ bool LoRaMacConfirmQueueRestoreNvmCtx( void* confirmQueueNvmCtx )
     // Restore module context
     if( confirmQueueNvmCtx != NULL )
     {
-        memcpy1( ( uint8_t* )&ConfirmQueueNvmCtx, ( uint8_t* ) confirmQueueNvmCtx, sizeof( ConfirmQueueNvmCtx ) );
+        memcpy1( ( uint8_t* )&QueueNvmCtx, ( uint8_t* ) confirmQueueNvmCtx, sizeof( QueueNvmCtx ) );
         return true;
     }
     else
@@ -202,8 +156,8 @@ bool LoRaMacConfirmQueueRestoreNvmCtx( void* confirmQueueNvmCtx )
 
 void* LoRaMacConfirmQueueGetNvmCtx( size_t* confirmQueueNvmCtxSize )
 {
-    *confirmQueueNvmCtxSize = sizeof( ConfirmQueueNvmCtx );
-    return &ConfirmQueueNvmCtx;
+    *confirmQueueNvmCtxSize = sizeof( QueueNvmCtx );
+    return &QueueNvmCtx;
 }
 
 bool LoRaMacConfirmQueueAdd( MlmeConfirmQueue_t* mlmeConfirm )
@@ -84,6 +84,52 @@ typedef struct sMlmeConfirmQueue
  */
 typedef void ( *LoRaMacConfirmQueueNvmEvent )( void );
 
+/*
+ * LoRaMac Confirm Queue Context NVM structure
+ */
+typedef struct sLoRaMacConfirmQueueNvmCtx
+{
+    /*!
+    * MlmeConfirm queue data structure
+    */
+    MlmeConfirmQueue_t MlmeConfirmQueue[LORA_MAC_MLME_CONFIRM_QUEUE_LEN];
+    /*!
+    * Counts the number of MlmeConfirms to process
+    */
+    uint8_t MlmeConfirmQueueCnt;
+    /*!
+    * Variable which holds a common status
+    */
+    LoRaMacEventInfoStatus_t CommonStatus;
+} LoRaMacConfirmQueueNvmCtx_t;
+
+/*
+ * LoRaMac Confirm Queue Context structure
+ */
+typedef struct sLoRaMacConfirmQueueCtx
+{
+    /*!
+    * LoRaMac callback function primitives
+    */
+    LoRaMacPrimitives_t* Primitives;
+    /*!
+    * Pointer to the first element of the ring buffer
+    */
+    MlmeConfirmQueue_t* BufferStart;
+    /*!
+    * Pointer to the last element of the ring buffer
+    */
+    MlmeConfirmQueue_t* BufferEnd;
+    /*
+     * Callback function to notify the upper layer about context change
+     */
+    LoRaMacConfirmQueueNvmEvent LoRaMacConfirmQueueNvmEvent;
+    /*!
+    * Non-volatile module context.
+    */
+    LoRaMacConfirmQueueNvmCtx_t* ConfirmQueueNvmCtx;
+} LoRaMacConfirmQueueCtx_t;
+
 /*!
  * \brief   Initializes the confirm queue
  *
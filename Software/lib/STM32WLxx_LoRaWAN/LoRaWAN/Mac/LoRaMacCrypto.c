@@ -40,6 +40,7 @@
 #include "LoRaMacParser.h"
 #include "LoRaMacSerializer.h"
 #include "LoRaMacCrypto.h"
+#include "LoRaMacInstance.h"
 
 /*
  * Frame direction definition for uplink communications
@@ -59,7 +60,7 @@
 /*
  * Number of security context entries
  */
-#define NUM_OF_SEC_CTX                  LORAMAC_MAX_MC_CTX + 1
+#define NUM_OF_SEC_CTX                  ( LORAMAC_MAX_MC_CTX + 1 )
 
 /*
  * Size of the module context
@@ -81,108 +82,6 @@
  */
 #define CRYPTO_BUFFER_SIZE              CRYPTO_MAXMESSAGE_SIZE + MIC_BLOCK_BX_SIZE
 
-/*!
- * LoRaWAN Frame counter list.
- */
-typedef struct sFCntList
-{
-    /*!
-     * Uplink frame counter which is incremented with each uplink.
-     */
-    uint32_t FCntUp;
-    /*!
-     * Network downlink frame counter which is incremented with each downlink on FPort 0
-     * or when the FPort field is missing.
-     */
-    uint32_t NFCntDown;
-    /*!
-     * Application downlink frame counter which is incremented with each downlink
-     * on a port different than 0.
-     */
-    uint32_t AFCntDown;
-    /*!
-     * In case if the device is connected to a LoRaWAN 1.0 Server,
-     * this counter is used for every kind of downlink frame.
-     */
-    uint32_t FCntDown;
-    /*!
-     * Multicast downlink counter for index 0
-     */
-    uint32_t McFCntDown0;
-#if ( LORAMAC_MAX_MC_CTX > 1 )
-    /*!
-     * Multicast downlink counter for index 1
-     */
-    uint32_t McFCntDown1;
-    /*!
-     * Multicast downlink counter for index 2
-     */
-    uint32_t McFCntDown2;
-    /*!
-     * Multicast downlink counter for index 3
-     */
-    uint32_t McFCntDown3;
-#endif /* LORAMAC_MAX_MC_CTX > 1 */
-#if ( USE_LRWAN_1_1_X_CRYPTO == 1 )
-    /*
-     * RJcount1 is a counter incremented with every Rejoin request Type 1 frame transmitted.
-     */
-    uint16_t RJcount1;
-#endif
-}FCntList_t;
-
-/*
- * LoRaMac Crypto Non Volatile Context structure
- */
-typedef struct sLoRaMacCryptoNvmCtx
-{
-    /*
-     * Stores the information if the device is connected to a LoRaWAN network
-     * server with prior to 1.1.0 implementation.
-     */
-    Version_t LrWanVersion;
-    /*
-     * Device nonce is a counter starting at 0 when the device is initially
-     * powered up and incremented with every JoinRequest.
-     */
-    uint16_t DevNonce;
-    /*
-     * JoinNonce is a device specific counter value (that never repeats itself)
-     * provided by the join server and incremented with every JoinAccept message.
-     */
-    uint32_t JoinNonce;
-    /*
-     * Frame counter list
-     */
-    FCntList_t FCntList;
-    /*
-     * LastDownFCnt stores the information which frame counter was used to unsecure the last frame.
-     * This information is needed to compute ConfFCnt in B1 block for the MIC.
-     */
-    uint32_t* LastDownFCnt;
-}LoRaMacCryptoNvmCtx_t;
-
-/*
- * LoRaMac Crypto Context structure
- */
-typedef struct sLoRaMacCryptoCtx
-{
-#if ( USE_LRWAN_1_1_X_CRYPTO == 1 )
-    /*
-     * RJcount0 is a counter incremented with every Type 0 or 2 Rejoin frame transmitted.
-     */
-    uint16_t RJcount0;
-#endif
-    /*
-     * Non volatile module context structure
-     */
-    LoRaMacCryptoNvmCtx_t* NvmCtx;
-    /*
-     * Callback function to notify the upper layer about context change
-     */
-    LoRaMacCryptoNvmEvent EventCryptoNvmCtxChanged;
-}LoRaMacCryptoCtx_t;
-
 /*
  * Key-Address item
  */
@@ -207,19 +106,19 @@ typedef struct sKeyAddr
 }KeyAddr_t;
 
 /*
- *Crypto module context.
+ *Crypto module context of the current LoRaMac instance.
  */
-static LoRaMacCryptoCtx_t CryptoCtx;
+#define CryptoCtx                       ( LoRaMacCurrentInstance->Crypto )
 
 /*
- * Non volatile module context.
+ * Non volatile module context of the current LoRaMac instance.
  */
-static LoRaMacCryptoNvmCtx_t NvmCryptoCtx;
+#define NvmCryptoCtx                    ( LoRaMacCurrentInstance->CryptoNvm )
 
 /*
- * Key-Address list
+ * Key-Address list, indexed by the address identifier
  */
-static KeyAddr_t KeyAddrList[NUM_OF_SEC_CTX] =
+static const KeyAddr_t KeyAddrList[NUM_OF_SEC_CTX] =
     {
         { MULTICAST_0_ADDR, MC_APP_S_KEY_0, MC_NWK_S_KEY_0, MC_KEY_0 },
 #if ( LORAMAC_MAX_MC_CTX > 1 )
@@ -631,36 +530,38 @@ static LoRaMacCryptoStatus_t ComputeCmacB1( uint8_t* msg, uint16_t len, KeyIdent
  * \param[OUT] keyItem        - Key item reference
  * \retval                    - Status of the operation
  */
-static LoRaMacCryptoStatus_t GetKeyAddrItem( AddressIdentifier_t addrID, KeyAddr_t** item )
+static LoRaMacCryptoStatus_t GetKeyAddrItem( AddressIdentifier_t addrID, const KeyAddr_t** item )
 {
-    for( uint8_t i = 0; i < NUM_OF_SEC_CTX; i++ )
+    if( ( uint32_t )addrID >= NUM_OF_SEC_CTX )
     {
-        if( KeyAddrList[i].AddrID == addrID )
-        {
-            *item = &( KeyAddrList[i] );
-            return LORAMAC_CRYPTO_SUCCESS;
-        }
+        return LORAMAC_CRYPTO_ERROR_INVALID_ADDR_ID;
     }
-    return LORAMAC_CRYPTO_ERROR_INVALID_ADDR_ID;
+    *item = &( KeyAddrList[addrID] );
+    return LORAMAC_CRYPTO_SUCCESS;
 }
 
 /*
- * Derives a session key as of LoRaWAN versions prior to 1.1.0
+ * Prepares the derivation of a session key as of LoRaWAN versions prior to 1.1.0.
+ * The session keys are derived from the NwkKey.
  *
  * \param[IN]  keyID          - Key Identifier for the key to be calculated
  * \param[IN]  joinNonce      - Sever nonce
  * \param[IN]  netID          - Network Identifier
  * \param[IN]  deviceNonce    - Device nonce
+ * \param[OUT] derivation     - Derivation input and target key
  * \retval                    - Status of the operation
  */
-static LoRaMacCryptoStatus_t DeriveSessionKey10x( KeyIdentifier_t keyID, uint8_t* joinNonce, uint8_t* netID, uint8_t* devNonce )
+static LoRaMacCryptoStatus_t PrepareSessionKey10x( KeyIdentifier_t keyID, uint8_t* joinNonce, uint8_t* netID, uint8_t* devNonce,
+                                                   SecureElementDerivation_t* derivation )
 {
     if( ( joinNonce == 0 ) || ( netID == 0 ) || ( devNonce == 0 ) )
     {
         return LORAMAC_CRYPTO_ERROR_NPE;
     }
 
-    uint8_t compBase[16] = { 0 };
+    uint8_t* compBase = derivation->Input;
+
+    memset1( compBase, 0, SE_KEY_SIZE );
 
     switch( keyID )
     {
@@ -683,34 +584,34 @@ static LoRaMacCryptoStatus_t DeriveSessionKey10x( KeyIdentifier_t keyID, uint8_t
     memcpy1( compBase + 1, joinNonce, 3 );
     memcpy1( compBase + 4, netID, 3 );
     memcpy1( compBase + 7, devNonce, 2 );
-
-    if( SecureElementDeriveAndStoreKey( CryptoCtx.NvmCtx->LrWanVersion, compBase, NWK_KEY, keyID ) != SECURE_ELEMENT_SUCCESS )
-    {
-        return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
-    }
+    derivation->TargetKeyID = keyID;
 
     return LORAMAC_CRYPTO_SUCCESS;
 }
 
 #if ( USE_LRWAN_1_1_X_CRYPTO == 1 )
 /*
- * Derives a session key as of LoRaWAN 1.1.0
+ * Prepares the derivation of a session key as of LoRaWAN 1.1.0.
+ * The AppSKey is derived from the AppKey, the network session keys from the NwkKey.
  *
  * \param[IN]  keyID          - Key Identifier for the key to be calculated
  * \param[IN]  joinNonce      - Sever nonce
  * \param[IN]  joinEUI        - Join Server EUI
  * \param[IN]  deviceNonce    - Device nonce
+ * \param[OUT] derivation     - Derivation input and target key
  * \retval                    - Status of the operation
  */
-static LoRaMacCryptoStatus_t DeriveSessionKey11x( KeyIdentifier_t keyID, uint8_t* joinNonce, uint8_t* joinEUI, uint8_t* devNonce )
+static LoRaMacCryptoStatus_t PrepareSessionKey11x( KeyIdentifier_t keyID, uint8_t* joinNonce, uint8_t* joinEUI, uint8_t* devNonce,
+                                                   SecureElementDerivation_t* derivation )
 {
     if( ( joinNonce == 0 ) || ( joinEUI == 0 ) || ( devNonce == 0 ) )
     {
         return LORAMAC_CRYPTO_ERROR_NPE;
     }
 
-    uint8_t compBase[16] = { 0 };
-    KeyIdentifier_t rootKeyId = NWK_KEY;
+    uint8_t* compBase = derivation->Input;
+
+    memset1( compBase, 0, SE_KEY_SIZE );
 
     switch( keyID )
     {
@@ -724,7 +625,6 @@ static LoRaMacCryptoStatus_t DeriveSessionKey11x( KeyIdentifier_t keyID, uint8_t
             compBase[0] = 0x04;
             break;
         case APP_S_KEY:
-            rootKeyId = APP_KEY;
             compBase[0] = 0x02;
             break;
         default:
@@ -734,11 +634,7 @@ static LoRaMacCryptoStatus_t DeriveSessionKey11x( KeyIdentifier_t keyID, uint8_t
     memcpy1( compBase + 1, joinNonce, 3 );
     memcpyr( compBase + 4, joinEUI, 8 );
     memcpy1( compBase + 12, devNonce, 2 );
-
-    if( SecureElementDeriveAndStoreKey( CryptoCtx.NvmCtx->LrWanVersion, compBase, rootKeyId, keyID ) != SECURE_ELEMENT_SUCCESS )
-    {
-        return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
-    }
+    derivation->TargetKeyID = keyID;
 
     return LORAMAC_CRYPTO_SUCCESS;
 }
@@ -999,6 +895,19 @@ LoRaMacCryptoStatus_t LoRaMacCryptoGetFCntUp( uint32_t* currentUp )
     return LORAMAC_CRYPTO_SUCCESS;
 }
 
+LoRaMacCryptoStatus_t LoRaMacCryptoSetFCntUp( uint32_t nextUp )
+{
+    if( ( nextUp == 0 ) || ( ( nextUp - 1 ) < CryptoCtx.NvmCtx->FCntList.FCntUp ) )
+    {
+        return LORAMAC_CRYPTO_FAIL_FCNT_SMALLER;
+    }
+
+    CryptoCtx.NvmCtx->FCntList.FCntUp = nextUp - 1;
+    CryptoCtx.EventCryptoNvmCtxChanged( );
+
+    return LORAMAC_CRYPTO_SUCCESS;
+}
+
 LoRaMacCryptoStatus_t LoRaMacCryptoGetFCntDown( FCntIdentifier_t fCntID, uint16_t maxFCntGap, uint32_t frameFcnt, uint32_t* currentDown )
 {
     uint32_t lastDown = 0;
@@ -1308,29 +1217,42 @@ LoRaMacCryptoStatus_t LoRaMacCryptoHandleJoinAccept( JoinReqIdentifier_t joinReq
             return retval;
         }
 
-        retval = DeriveSessionKey11x( F_NWK_S_INT_KEY, macMsg->JoinNonce, joinEUI, nonce );
+        // Derive the network session keys from the NwkKey in one secure element call
+        SecureElementDerivation_t sessionKeys[3];
+
+        retval = PrepareSessionKey11x( F_NWK_S_INT_KEY, macMsg->JoinNonce, joinEUI, nonce, &sessionKeys[0] );
         if( retval != LORAMAC_CRYPTO_SUCCESS )
         {
             return retval;
         }
 
-        retval = DeriveSessionKey11x( S_NWK_S_INT_KEY, macMsg->JoinNonce, joinEUI, nonce );
+        retval = PrepareSessionKey11x( S_NWK_S_INT_KEY, macMsg->JoinNonce, joinEUI, nonce, &sessionKeys[1] );
         if( retval != LORAMAC_CRYPTO_SUCCESS )
         {
             return retval;
         }
 
-        retval = DeriveSessionKey11x( NWK_S_ENC_KEY, macMsg->JoinNonce, joinEUI, nonce );
+        retval = PrepareSessionKey11x( NWK_S_ENC_KEY, macMsg->JoinNonce, joinEUI, nonce, &sessionKeys[2] );
         if( retval != LORAMAC_CRYPTO_SUCCESS )
         {
             return retval;
         }
 
-        retval = DeriveSessionKey11x( APP_S_KEY, macMsg->JoinNonce, joinEUI, nonce );
+        if( SecureElementDeriveAndStoreKeys( CryptoCtx.NvmCtx->LrWanVersion, NWK_KEY, sessionKeys, 3 ) != SECURE_ELEMENT_SUCCESS )
+        {
+            return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
+        }
+
+        retval = PrepareSessionKey11x( APP_S_KEY, macMsg->JoinNonce, joinEUI, nonce, &sessionKeys[0] );
         if( retval != LORAMAC_CRYPTO_SUCCESS )
         {
             return retval;
         }
+
+        if( SecureElementDeriveAndStoreKeys( CryptoCtx.NvmCtx->LrWanVersion, APP_KEY, sessionKeys, 1 ) != SECURE_ELEMENT_SUCCESS )
+        {
+            return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
+        }
     }
 #else
     // Operating in LoRaWAN 1.0.x mode
@@ -1346,16 +1268,24 @@ LoRaMacCryptoStatus_t LoRaMacCryptoHandleJoinAccept( JoinReqIdentifier_t joinReq
         return retval;
     }
 
-    retval = DeriveSessionKey10x( APP_S_KEY, macMsg->JoinNonce, macMsg->NetID, ( uint8_t* )&CryptoCtx.NvmCtx->DevNonce );
+    // Derive the session keys from the NwkKey in one secure element call
+    SecureElementDerivation_t sessionKeys[2];
+
+    retval = PrepareSessionKey10x( APP_S_KEY, macMsg->JoinNonce, macMsg->NetID, ( uint8_t* )&CryptoCtx.NvmCtx->DevNonce, &sessionKeys[0] );
     if( retval != LORAMAC_CRYPTO_SUCCESS )
     {
         return retval;
     }
-    retval = DeriveSessionKey10x( NWK_S_KEY, macMsg->JoinNonce, macMsg->NetID, ( uint8_t* )&CryptoCtx.NvmCtx->DevNonce );
+    retval = PrepareSessionKey10x( NWK_S_KEY, macMsg->JoinNonce, macMsg->NetID, ( uint8_t* )&CryptoCtx.NvmCtx->DevNonce, &sessionKeys[1] );
     if( retval != LORAMAC_CRYPTO_SUCCESS )
     {
         return retval;
     }
+
+    if( SecureElementDeriveAndStoreKeys( CryptoCtx.NvmCtx->LrWanVersion, NWK_KEY, sessionKeys, 2 ) != SECURE_ELEMENT_SUCCESS )
+    {
+        return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
+    }
 #endif /* USE_LRWAN_1_1_X_CRYPTO */
 
     // Join-Accept is successfully processed
@@ -1500,7 +1430,7 @@ LoRaMacCryptoStatus_t LoRaMacCryptoUnsecureMessage( AddressIdentifier_t addrID,
 #else /* USE_LRWAN_1_1_X_CRYPTO == 0 */
     KeyIdentifier_t micComputationKeyID = NWK_S_KEY;
 #endif /* USE_LRWAN_1_1_X_CRYPTO */
-    KeyAddr_t* curItem;
+    const KeyAddr_t* curItem;
 
     // Parse the message
     if( LoRaMacParserData( macMsg ) != LORAMAC_PARSER_SUCCESS )
@@ -1626,7 +1556,7 @@ LoRaMacCryptoStatus_t LoRaMacCryptoDeriveMcSessionKeyPair( AddressIdentifier_t a
     LoRaMacCryptoStatus_t retval = LORAMAC_CRYPTO_ERROR;
 
     // Determine current security context
-    KeyAddr_t* curItem;
+    const KeyAddr_t* curItem;
     retval = GetKeyAddrItem( addrID, &curItem );
     if( retval != LORAMAC_CRYPTO_SUCCESS )
     {
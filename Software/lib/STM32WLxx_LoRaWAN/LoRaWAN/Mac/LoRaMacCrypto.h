@@ -159,6 +159,108 @@ typedef enum eLoRaMacCryptoStatus
  */
 typedef void ( *LoRaMacCryptoNvmEvent )( void );
 
+/*!
+ * LoRaWAN Frame counter list.
+ */
+typedef struct sFCntList
+{
+    /*!
+     * Uplink frame counter which is incremented with each uplink.
+     */
+    uint32_t FCntUp;
+    /*!
+     * Network downlink frame counter which is incremented with each downlink on FPort 0
+     * or when the FPort field is missing.
+     */
+    uint32_t NFCntDown;
+    /*!
+     * Application downlink frame counter which is incremented with each downlink
+     * on a port different than 0.
+     */
+    uint32_t AFCntDown;
+    /*!
+     * In case if the device is connected to a LoRaWAN 1.0 Server,
+     * this counter is used for every kind of downlink frame.
+     */
+    uint32_t FCntDown;
+    /*!
+     * Multicast downlink counter for index 0
+     */
+    uint32_t McFCntDown0;
+#if ( LORAMAC_MAX_MC_CTX > 1 )
+    /*!
+     * Multicast downlink counter for index 1
+     */
+    uint32_t McFCntDown1;
+    /*!
+     * Multicast downlink counter for index 2
+     */
+    uint32_t McFCntDown2;
+    /*!
+     * Multicast downlink counter for index 3
+     */
+    uint32_t McFCntDown3;
+#endif /* LORAMAC_MAX_MC_CTX > 1 */
+#if ( USE_LRWAN_1_1_X_CRYPTO == 1 )
+    /*
+     * RJcount1 is a counter incremented with every Rejoin request Type 1 frame transmitted.
+     */
+    uint16_t RJcount1;
+#endif
+}FCntList_t;
+
+/*
+ * LoRaMac Crypto Non Volatile Context structure
+ */
+typedef struct sLoRaMacCryptoNvmCtx
+{
+    /*
+     * Stores the information if the device is connected to a LoRaWAN network
+     * server with prior to 1.1.0 implementation.
+     */
+    Version_t LrWanVersion;
+    /*
+     * Device nonce is a counter starting at 0 when the device is initially
+     * powered up and incremented with every JoinRequest.
+     */
+    uint16_t DevNonce;
+    /*
+     * JoinNonce is a device specific counter value (that never repeats itself)
+     * provided by the join server and incremented with every JoinAccept message.
+     */
+    uint32_t JoinNonce;
+    /*
+     * Frame counter list
+     */
+    FCntList_t FCntList;
+    /*
+     * LastDownFCnt stores the information which frame counter was used to unsecure the last frame.
+     * This information is needed to compute ConfFCnt in B1 block for the MIC.
+     */
+    uint32_t* LastDownFCnt;
+}LoRaMacCryptoNvmCtx_t;
+
+/*
+ * LoRaMac Crypto Context structure
+ */
+typedef struct sLoRaMacCryptoCtx
+{
+#if ( USE_LRWAN_1_1_X_CRYPTO == 1 )
+    /*
+     * RJcount0 is a counter incremented with every Type 0 or 2 Rejoin frame transmitted.
+     */
+    uint16_t RJcount0;
+#endif
+    /*
+     * Non volatile module context structure
+     */
+    LoRaMacCryptoNvmCtx_t* NvmCtx;
+    /*
+     * Callback function to notify the upper layer about context change
+     */
+    LoRaMacCryptoNvmEvent EventCryptoNvmCtxChanged;
+}LoRaMacCryptoCtx_t;
+
 /*!
  * Initialization of LoRaMac Crypto module
  * It sets initial values of volatile variables and assigns the non-volatile context.
@@ -215,6 +317,17 @@ LoRaMacCryptoStatus_t LoRaMacCryptoGetFCntDown( FCntIdentifier_t fCntID, uint16_
  */
 LoRaMacCryptoStatus_t LoRaMacCryptoGetFCntUp( uint32_t* currentUp );
 
+/*!
+ * Moves the uplink counter forward so that the next uplink uses nextUp.
+ *
+ * \remark Used to resume an ABP session from a persisted frame counter.
+ *         The counter can never be moved backwards.
+ *
+ * \param[IN]     nextUp         - Uplink counter value of the next uplink
+ * \retval                       - Status of the operation
+ */
+LoRaMacCryptoStatus_t LoRaMacCryptoSetFCntUp( uint32_t nextUp );
+
 /*!
  * Provides multicast context.
  *
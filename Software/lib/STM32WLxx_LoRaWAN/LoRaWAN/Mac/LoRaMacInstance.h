@@ -0,0 +1,707 @@
+/*!
+ * \file      LoRaMacInstance.h
+ *
+ * \brief     LoRa MAC layer instances
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ * \defgroup  LORAMACINSTANCE LoRa MAC layer instances
+ *            All the state of the LoRa MAC layer, the crypto, MAC commands,
+ *            confirm queue, class B and region modules is held by an instance.
+ *            The LoRaMac API acts on the current instance, which is a default
+ *            instance unless another one is selected. The LoRaMacInstance API
+ *            runs the LoRaMac API on an explicit instance, so several stacks
+ *            can run in one program.
+ *
+ *            Timer callbacks run on the instance which started the timer and
+ *            radio events on the instance which started the last radio
+ *            operation. The soft secure element keeps its keys and EUIs in the
+ *            instance, a hardware secure element is shared by all the
+ *            instances. The timer server and the radio driver are shared by
+ *            all the instances of a thread: a host program running instances
+ *            on several threads builds with LORAMAC_THREAD_LOCAL (see
+ *            utilities_conf.h) defined as _Thread_local and gives each thread
+ *            its own radio.
+ * \{
+ */
+#ifndef __LORAMAC_INSTANCE_H__
+#define __LORAMAC_INSTANCE_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "LoRaMac.h"
+#include "LoRaMacMessageTypes.h"
+#include "LoRaMacCrypto.h"
+#include "secure-element.h"
+#include "LoRaMacCommands.h"
+#include "LoRaMacConfirmQueue.h"
+#include "LoRaMacClassB.h"
+#include "Region.h"
+#ifdef REGION_AS923
+#include "RegionAS923.h"
+#endif
+#ifdef REGION_AU915
+#include "RegionAU915.h"
+#endif
+#ifdef REGION_CN470
+#include "RegionCN470.h"
+#endif
+#ifdef REGION_CN779
+#include "RegionCN779.h"
+#endif
+#ifdef REGION_EU433
+#include "RegionEU433.h"
+#endif
+#ifdef REGION_EU868
+#include "RegionEU868.h"
+#endif
+#ifdef REGION_IN865
+#include "RegionIN865.h"
+#endif
+#ifdef REGION_KR920
+#include "RegionKR920.h"
+#endif
+#ifdef REGION_RU864
+#include "RegionRU864.h"
+#endif
+#ifdef REGION_US915
+#include "RegionUS915.h"
+#endif
+
+/*!
+ * Maximum PHY layer payload size
+ */
+#define LORAMAC_PHY_MAXPAYLOAD                      255
+
+/*!
+ * Maximum MAC commands buffer size
+ */
+#define LORA_MAC_COMMAND_MAX_LENGTH                 128
+
+/*!
+ * Number of datarates of the region parameter tables
+ */
+#define LORAMAC_PHY_DATARATES                       ( DR_15 + 1 )
+
+/*
+ * Region parameters read on every frame, refreshed by UpdatePhyParams. python3 tools/host_test.py phy_params checks them
+ * against RegionGetPhyParam.
+ */
+typedef struct sLoRaMacPhyParams
+{
+    /*
+    * Maximum frame counter gap
+    */
+    uint32_t MaxFCntGap;
+    /*
+    * Maximum payload of the uplink datarates, 0 for datarates the region does not support
+    */
+    uint8_t MaxUplinkPayload[LORAMAC_PHY_DATARATES];
+    /*
+    * Maximum payload of the downlink datarates, 0 for datarates the region does not support
+    */
+    uint8_t MaxDownlinkPayload[LORAMAC_PHY_DATARATES];
+}LoRaMacPhyParams_t;
+
+/*
+ * Request permission state
+ */
+typedef enum eLoRaMacRequestHandling
+{
+    LORAMAC_REQUEST_HANDLING_OFF = 0,
+    LORAMAC_REQUEST_HANDLING_ON = !LORAMAC_REQUEST_HANDLING_OFF
+}LoRaMacRequestHandling_t;
+
+typedef struct sLoRaMacNvmCtx
+{
+    /*
+     * LoRaMac region.
+     */
+    LoRaMacRegion_t Region;
+    /*
+     * LoRaMac default parameters
+     */
+    LoRaMacParams_t MacParamsDefaults;
+    /*
+     * Network ID ( 3 bytes )
+     */
+    uint32_t NetID;
+    /*
+     * Mote Address
+     */
+    uint32_t DevAddr;
+    /*!
+    * Multicast channel list
+    */
+    MulticastCtx_t MulticastChannelList[LORAMAC_MAX_MC_CTX];
+    /*
+     * Actual device class
+     */
+    DeviceClass_t DeviceClass;
+    /*
+     * Indicates if the node is connected to
+     * a private or public network
+     */
+    bool PublicNetwork;
+    /*
+     * LoRaMac ADR control status
+     */
+    bool AdrCtrlOn;
+    /*
+     * Counts the number of missed ADR acknowledgements
+     */
+    uint32_t AdrAckCounter;
+
+    /*
+     * LoRaMac parameters
+     */
+    LoRaMacParams_t MacParams;
+    /*
+     * Maximum duty cycle
+     * \remark Possibility to shutdown the device.
+     */
+    uint8_t MaxDCycle;
+    /*
+    * Enables/Disables duty cycle management (Test only)
+    */
+    bool DutyCycleOn;
+    /*
+     * Holds the current rx window slot
+     */
+    bool RepeaterSupport;
+    /*
+     * Buffer containing the MAC layer commands
+     */
+    uint8_t MacCommandsBuffer[LORA_MAC_COMMAND_MAX_LENGTH];
+    /*
+     * If the server has sent a FRAME_TYPE_DATA_CONFIRMED_DOWN this variable indicates
+     * if the ACK bit must be set for the next transmission
+     */
+    bool SrvAckRequested;
+    /*
+     * Aggregated duty cycle management
+     */
+    uint16_t AggregatedDCycle;
+    /*
+    * Aggregated duty cycle management
+    */
+    TimerTime_t LastTxDoneTime;
+    TimerTime_t AggregatedTimeOff;
+    /*
+    * Stores the time at LoRaMac initialization.
+    *
+    * \remark Used for the BACKOFF_DC computation.
+    */
+    SysTime_t InitializationTime;
+    /*
+     * Current LoRaWAN Version
+     */
+    Version_t Version;
+    /*
+     * End-Device network activation
+     */
+    ActivationType_t NetworkActivation;
+    /*!
+     * Last received Message integrity Code (MIC)
+     */
+    uint32_t LastRxMic;
+}LoRaMacNvmCtx_t;
+
+typedef struct sLoRaMacCtx
+{
+    /*
+    * Length of packet in PktBuffer
+    */
+    uint16_t PktBufferLen;
+    /*
+    * Buffer containing the data to be sent or received.
+    */
+    uint8_t PktBuffer[LORAMAC_PHY_MAXPAYLOAD];
+    /*!
+    * Current processed transmit message
+    */
+    LoRaMacMessage_t TxMsg;
+    /*
+    * Size of the application data, in PktBuffer at the FRMPayload position.
+    */
+    uint8_t AppDataSize;
+    /*
+    * Buffer containing the upper layer data.
+    */
+    uint8_t RxPayload[LORAMAC_PHY_MAXPAYLOAD];
+    SysTime_t LastTxSysTime;
+    /*
+    * LoRaMac internal state
+    */
+    uint32_t MacState;
+    /*
+    * LoRaMac upper layer event functions
+    */
+    LoRaMacPrimitives_t* MacPrimitives;
+    /*
+    * LoRaMac upper layer callback functions
+    */
+    LoRaMacCallback_t* MacCallbacks;
+    /*
+    * Radio events function pointer
+    */
+    RadioEvents_t RadioEvents;
+    /*
+    * LoRaMac duty cycle delayed Tx timer
+    */
+    TimerEvent_t TxDelayedTimer;
+    /*
+    * LoRaMac reception windows timers
+    */
+    TimerEvent_t RxWindowTimer1;
+    TimerEvent_t RxWindowTimer2;
+    /*
+    * LoRaMac reception windows delay
+    * \remark normal frame: RxWindowXDelay = ReceiveDelayX - RADIO_WAKEUP_TIME
+    *         join frame  : RxWindowXDelay = JoinAcceptDelayX - RADIO_WAKEUP_TIME
+    */
+    uint32_t RxWindow1Delay;
+    uint32_t RxWindow2Delay;
+    /*
+    * LoRaMac Rx windows configuration
+    */
+    RxConfigParams_t RxWindow1Config;
+    RxConfigParams_t RxWindow2Config;
+    RxConfigParams_t RxWindowCConfig;
+    /*
+     * Limit of uplinks without any donwlink response before the ADRACKReq bit will be set.
+     */
+    uint16_t AdrAckLimit;
+    /*
+     * Limit of uplinks without any donwlink response after a the first frame with set ADRACKReq bit
+     * before the trying to regain the connectivity.
+     */
+    uint16_t AdrAckDelay;
+    /*
+    * Acknowledge timeout timer. Used for packet retransmissions.
+    */
+    TimerEvent_t AckTimeoutTimer;
+    /*
+     * Uplink messages repetitions counter
+     */
+    uint8_t ChannelsNbTransCounter;
+    /*
+     * Number of trials to get a frame acknowledged
+     */
+    uint8_t AckTimeoutRetries;
+    /*
+     * Number of trials to get a frame acknowledged
+     */
+    uint8_t AckTimeoutRetriesCounter;
+    /*
+     * Indicates if the AckTimeout timer has expired or not
+     */
+    bool AckTimeoutRetry;
+    /*
+     * Retransmission policy of the confirmed frame
+     */
+    LoRaMacRetransPolicy_t RetransPolicy;
+    /*
+     * Time of the MCPS request of the confirmed frame
+     */
+    TimerTime_t RetransStart;
+    /*
+     * Datarate of the last transmission of the confirmed frame, before the
+     * step down of its retransmission
+     */
+    int8_t RetransDatarate;
+    /*
+     * If the node has sent a FRAME_TYPE_DATA_CONFIRMED_UP this variable indicates
+     * if the nodes needs to manage the server acknowledgement.
+     */
+    bool NodeAckRequested;
+    /*
+     * Current channel index
+     */
+    uint8_t Channel;
+    /*
+    * Last transmission time on air
+    */
+    TimerTime_t TxTimeOnAir;
+    /*
+    * Structure to hold an MCPS indication data.
+    */
+    McpsIndication_t McpsIndication;
+    /*
+    * Structure to hold MCPS confirm data.
+    */
+    McpsConfirm_t McpsConfirm;
+    /*
+    * Structure to hold MLME confirm data.
+    */
+    MlmeConfirm_t MlmeConfirm;
+    /*
+    * Structure to hold MLME indication data.
+    */
+    MlmeIndication_t MlmeIndication;
+    /*
+    * Holds the current rx window slot
+    */
+    LoRaMacRxSlot_t RxSlot;
+    /*
+    * LoRaMac tx/rx operation state
+    */
+    LoRaMacFlags_t MacFlags;
+    /*
+    * Data structure indicating if a request is allowed or not.
+    */
+    LoRaMacRequestHandling_t AllowRequests;
+    /*
+    * Non-volatile module context structure
+    */
+    LoRaMacNvmCtx_t* NvmCtx;
+    /*
+    * Duty cycle wait time
+    */
+    TimerTime_t DutyCycleWaitTime;
+    /*
+    * Region parameters read on every frame
+    */
+    LoRaMacPhyParams_t PhyParams;
+}LoRaMacCtx_t;
+
+/*!
+ * Defines the LoRaMac radio events status
+ */
+typedef union uLoRaMacRadioEvents
+{
+    uint32_t Value;
+    struct sEvents
+    {
+        uint32_t RxTimeout : 1;
+        uint32_t RxError   : 1;
+        uint32_t TxTimeout : 1;
+        uint32_t RxDone    : 1;
+        uint32_t TxDone    : 1;
+    }Events;
+}LoRaMacRadioEvents_t;
+
+/*!
+ * Structure used to store the radio Tx event data
+ */
+typedef struct sLoRaMacTxDoneParams
+{
+    TimerTime_t CurTime;
+}LoRaMacTxDoneParams_t;
+
+/*!
+ * Structure used to store the radio Rx event data
+ */
+typedef struct sLoRaMacRxDoneParams
+{
+    TimerTime_t LastRxDone;
+    uint8_t *Payload;
+    uint16_t Size;
+    int16_t Rssi;
+    int8_t Snr;
+}LoRaMacRxDoneParams_t;
+
+/*!
+ * Time-on-air table, the entries of datarate n are the range [First[n], First[n + 1])
+ */
+typedef struct sRegionCommonTimeOnAirTable
+{
+    RegionCommonTimeOnAirFormula_t Formula;
+    uint16_t First[DR_15 + 2];
+    uint8_t StepLength[REGION_COMMON_TOA_TABLE_STEPS];
+    uint16_t StepTimeOnAir[REGION_COMMON_TOA_TABLE_STEPS];
+}RegionCommonTimeOnAirTable_t;
+
+/*!
+ * LoRaMac instance, holds the state of the LoRa MAC layer and of its modules
+ */
+struct sLoRaMacInstance
+{
+    /*!
+     * LoRaMac context
+     */
+    LoRaMacCtx_t Mac;
+    /*!
+     * LoRaMac non-volatile context
+     */
+    LoRaMacNvmCtx_t MacNvm;
+    /*!
+     * List of the non-volatile contexts, returned by MIB_NVM_CTXS
+     */
+    LoRaMacCtxs_t MacContexts;
+    /*!
+     * Radio events status
+     */
+    LoRaMacRadioEvents_t RadioEvents;
+    /*!
+     * Radio Tx event data
+     */
+    LoRaMacTxDoneParams_t TxDoneParams;
+    /*!
+     * Radio Rx event data
+     */
+    LoRaMacRxDoneParams_t RxDoneParams;
+    /*!
+     * Crypto context
+     */
+    LoRaMacCryptoCtx_t Crypto;
+    /*!
+     * Crypto non-volatile context
+     */
+    LoRaMacCryptoNvmCtx_t CryptoNvm;
+    /*!
+     * Secure element context
+     */
+    SecureElementCtx_t SecureElement;
+    /*!
+     * MAC commands non-volatile context
+     */
+    LoRaMacCommandsCtx_t Commands;
+    /*!
+     * Callback of the MAC commands non-volatile context changes
+     */
+    LoRaMacCommandsNvmEvent CommandsNvmCtxChanged;
+    /*!
+     * Confirm queue context
+     */
+    LoRaMacConfirmQueueCtx_t ConfirmQueue;
+    /*!
+     * Confirm queue non-volatile context
+     */
+    LoRaMacConfirmQueueNvmCtx_t ConfirmQueueNvm;
+#if ( LORAMAC_CLASSB_ENABLED == 1 )
+    /*!
+     * Class B context
+     */
+    LoRaMacClassBCtx_t ClassB;
+    /*!
+     * Class B non-volatile context
+     */
+    LoRaMacClassBNvmCtx_t ClassBNvm;
+    /*!
+     * Class B events status
+     */
+    LoRaMacClassBEvents_t ClassBEvents;
+#endif /* LORAMAC_CLASSB_ENABLED == 1 */
+    /*!
+     * Time-on-air table of the active region
+     */
+    RegionCommonTimeOnAirTable_t TimeOnAirTable;
+    /*!
+     * Contexts of the regions
+     */
+    struct sLoRaMacInstanceRegions
+    {
+#ifdef REGION_AS923
+        /*!
+         * AS923 region context
+         */
+        RegionAS923NvmCtx_t AS923;
+#endif
+#ifdef REGION_AU915
+        /*!
+         * AU915 region context
+         */
+        RegionAU915NvmCtx_t AU915;
+        RegionCommonChannelsBitmap_t AU915ChannelsBitmap;
+        int8_t AU915JoinTrialsCount;
+#endif
+#ifdef REGION_CN470
+        /*!
+         * CN470 region context
+         */
+        RegionCN470NvmCtx_t CN470;
+        RegionCommonChannelsBitmap_t CN470ChannelsBitmap;
+#endif
+#ifdef REGION_CN779
+        /*!
+         * CN779 region context
+         */
+        RegionCN779NvmCtx_t CN779;
+#endif
+#ifdef REGION_EU433
+        /*!
+         * EU433 region context
+         */
+        RegionEU433NvmCtx_t EU433;
+#endif
+#ifdef REGION_EU868
+        /*!
+         * EU868 region context
+         */
+        RegionEU868NvmCtx_t EU868;
+#endif
+#ifdef REGION_IN865
+        /*!
+         * IN865 region context
+         */
+        RegionIN865NvmCtx_t IN865;
+#endif
+#ifdef REGION_KR920
+        /*!
+         * KR920 region context
+         */
+        RegionKR920NvmCtx_t KR920;
+#endif
+#ifdef REGION_RU864
+        /*!
+         * RU864 region context
+         */
+        RegionRU864NvmCtx_t RU864;
+#endif
+#ifdef REGION_US915
+        /*!
+         * US915 region context
+         */
+        RegionUS915NvmCtx_t US915;
+        RegionCommonChannelsBitmap_t US915ChannelsBitmap;
+#endif
+    }Regions;
+};
+
+/*!
+ * Instance the LoRaMac API acts on
+ */
+extern LORAMAC_THREAD_LOCAL LoRaMacInstance_t* LoRaMacCurrentInstance;
+
+/*!
+ * Instance which started the last radio operation, radio events are processed on it
+ */
+extern LORAMAC_THREAD_LOCAL LoRaMacInstance_t* LoRaMacRadioOwner;
+
+/*!
+ * \brief   Selects the instance the LoRaMac API acts on
+ *
+ * \param   [IN] instance - Instance to select, NULL keeps the current one
+ *
+ * \retval  Instance selected before, to be selected again when done
+ */
+static inline LoRaMacInstance_t* LoRaMacInstanceSelect( LoRaMacInstance_t* instance )
+{
+    LoRaMacInstance_t* previous = LoRaMacCurrentInstance;
+
+    if( instance != NULL )
+    {
+        LoRaMacCurrentInstance = instance;
+    }
+    return previous;
+}
+
+/*!
+ * \brief   Makes the current instance process the next radio events,
+ *          called before starting a radio operation
+ */
+static inline void LoRaMacInstanceTakeRadio( void )
+{
+    LoRaMacRadioOwner = LoRaMacCurrentInstance;
+}
+
+/*!
+ * \brief   LoRaMacInitialization on an instance, see \ref LoRaMacInitialization
+ *
+ * \param   [IN] instance - Instance to initialize, zero filled
+ */
+LoRaMacStatus_t LoRaMacInstanceInitialization( LoRaMacInstance_t* instance, LoRaMacPrimitives_t* primitives, LoRaMacCallback_t* callbacks, LoRaMacRegion_t region );
+
+/*!
+ * \brief   LoRaMacStart on an instance, see \ref LoRaMacStart
+ */
+LoRaMacStatus_t LoRaMacInstanceStart( LoRaMacInstance_t* instance );
+
+/*!
+ * \brief   LoRaMacStop on an instance, see \ref LoRaMacStop
+ */
+LoRaMacStatus_t LoRaMacInstanceStop( LoRaMacInstance_t* instance );
+
+/*!
+ * \brief   LoRaMacIsBusy on an instance, see \ref LoRaMacIsBusy
+ */
+bool LoRaMacInstanceIsBusy( LoRaMacInstance_t* instance );
+
+/*!
+ * \brief   LoRaMacProcess on an instance, see \ref LoRaMacProcess
+ */
+void LoRaMacInstanceProcess( LoRaMacInstance_t* instance );
+
+/*!
+ * \brief   LoRaMacQueryTxPossible on an instance, see \ref LoRaMacQueryTxPossible
+ */
+LoRaMacStatus_t LoRaMacInstanceQueryTxPossible( LoRaMacInstance_t* instance, uint8_t size, LoRaMacTxInfo_t* txInfo );
+
+/*!
+ * \brief   LoRaMacGetTxPayloadBuffer on an instance, see \ref LoRaMacGetTxPayloadBuffer
+ */
+LoRaMacStatus_t LoRaMacInstanceGetTxPayloadBuffer( LoRaMacInstance_t* instance, uint8_t** buffer, uint8_t* maxSize );
+
+/*!
+ * \brief   LoRaMacChannelAdd on an instance, see \ref LoRaMacChannelAdd
+ */
+LoRaMacStatus_t LoRaMacInstanceChannelAdd( LoRaMacInstance_t* instance, uint8_t id, ChannelParams_t params );
+
+/*!
+ * \brief   LoRaMacChannelRemove on an instance, see \ref LoRaMacChannelRemove
+ */
+LoRaMacStatus_t LoRaMacInstanceChannelRemove( LoRaMacInstance_t* instance, uint8_t id );
+
+/*!
+ * \brief   LoRaMacMcChannelSetup on an instance, see \ref LoRaMacMcChannelSetup
+ */
+LoRaMacStatus_t LoRaMacInstanceMcChannelSetup( LoRaMacInstance_t* instance, McChannelParams_t *channel );
+
+/*!
+ * \brief   LoRaMacMcChannelDelete on an instance, see \ref LoRaMacMcChannelDelete
+ */
+LoRaMacStatus_t LoRaMacInstanceMcChannelDelete( LoRaMacInstance_t* instance, AddressIdentifier_t groupID );
+
+/*!
+ * \brief   LoRaMacMcChannelGetGroupId on an instance, see \ref LoRaMacMcChannelGetGroupId
+ */
+uint8_t LoRaMacInstanceMcChannelGetGroupId( LoRaMacInstance_t* instance, uint32_t mcAddress );
+
+/*!
+ * \brief   LoRaMacMcChannelSetupRxParams on an instance, see \ref LoRaMacMcChannelSetupRxParams
+ */
+LoRaMacStatus_t LoRaMacInstanceMcChannelSetupRxParams( LoRaMacInstance_t* instance, AddressIdentifier_t groupID, McRxParams_t *rxParams, uint8_t *status );
+
+/*!
+ * \brief   LoRaMacMibGetRequestConfirm on an instance, see \ref LoRaMacMibGetRequestConfirm
+ */
+LoRaMacStatus_t LoRaMacInstanceMibGetRequestConfirm( LoRaMacInstance_t* instance, MibRequestConfirm_t* mibGet );
+
+/*!
+ * \brief   LoRaMacMibSetRequestConfirm on an instance, see \ref LoRaMacMibSetRequestConfirm
+ */
+LoRaMacStatus_t LoRaMacInstanceMibSetRequestConfirm( LoRaMacInstance_t* instance, MibRequestConfirm_t* mibSet );
+
+/*!
+ * \brief   LoRaMacMlmeRequest on an instance, see \ref LoRaMacMlmeRequest
+ */
+LoRaMacStatus_t LoRaMacInstanceMlmeRequest( LoRaMacInstance_t* instance, MlmeReq_t* mlmeRequest );
+
+/*!
+ * \brief   LoRaMacMcpsRequest on an instance, see \ref LoRaMacMcpsRequest
+ */
+LoRaMacStatus_t LoRaMacInstanceMcpsRequest( LoRaMacInstance_t* instance, McpsReq_t* mcpsRequest, bool allowDelayedTx );
+
+/*!
+ * \brief   LoRaMacDeInitialization on an instance, see \ref LoRaMacDeInitialization
+ */
+LoRaMacStatus_t LoRaMacInstanceDeInitialization( LoRaMacInstance_t* instance );
+
+/*!
+ * \brief   LoRaMacTestSetDutyCycleOn on an instance, see \ref LoRaMacTestSetDutyCycleOn
+ */
+void LoRaMacInstanceTestSetDutyCycleOn( LoRaMacInstance_t* instance, bool enable );
+
+/*! \} defgroup LORAMACINSTANCE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __LORAMAC_INSTANCE_H__
@@ -77,7 +77,7 @@ LoRaMacParserStatus_t LoRaMacParserJoinAccept( LoRaMacMessageJoinAccept_t* macMs
     return LORAMAC_PARSER_SUCCESS;
 }
 
-LoRaMacParserStatus_t LoRaMacParserData( LoRaMacMessageData_t* macMsg )
+LoRaMacParserStatus_t LoRaMacParserDataHeader( LoRaMacMessageData_t* macMsg )
 {
     if( ( macMsg == 0 ) || ( macMsg->Buffer == 0 ) )
     {
@@ -100,7 +100,6 @@ LoRaMacParserStatus_t LoRaMacParserData( LoRaMacMessageData_t* macMsg )
 
     if( macMsg->FHDR.FCtrl.Bits.FOptsLen <= 15 )
     {
-        memcpy1( macMsg->FHDR.FOpts, &macMsg->Buffer[bufItr], macMsg->FHDR.FCtrl.Bits.FOptsLen );
         bufItr = bufItr + macMsg->FHDR.FCtrl.Bits.FOptsLen;
     }
     else
@@ -117,8 +116,6 @@ LoRaMacParserStatus_t LoRaMacParserData( LoRaMacMessageData_t* macMsg )
         macMsg->FPort = macMsg->Buffer[bufItr++];
 
         macMsg->FRMPayloadSize = ( macMsg->BufSize - bufItr - LORAMAC_MIC_FIELD_SIZE );
-        memcpy1( macMsg->FRMPayload, &macMsg->Buffer[bufItr], macMsg->FRMPayloadSize );
-        bufItr = bufItr + macMsg->FRMPayloadSize;
     }
 
     macMsg->MIC = ( uint32_t ) macMsg->Buffer[( macMsg->BufSize - LORAMAC_MIC_FIELD_SIZE )];
@@ -128,3 +125,28 @@ LoRaMacParserStatus_t LoRaMacParserData( LoRaMacMessageData_t* macMsg )
 
     return LORAMAC_PARSER_SUCCESS;
 }
+
+LoRaMacParserStatus_t LoRaMacParserData( LoRaMacMessageData_t* macMsg )
+{
+    LoRaMacParserStatus_t status = LoRaMacParserDataHeader( macMsg );
+
+    if( status != LORAMAC_PARSER_SUCCESS )
+    {
+        return status;
+    }
+
+    // FOpts field after the MHDR, DevAddr, FCtrl and FCnt fields
+    uint16_t bufItr = 8;
+
+    memcpy1( macMsg->FHDR.FOpts, &macMsg->Buffer[bufItr], macMsg->FHDR.FCtrl.Bits.FOptsLen );
+    bufItr = bufItr + macMsg->FHDR.FCtrl.Bits.FOptsLen;
+
+    if( ( macMsg->BufSize - bufItr - LORAMAC_MIC_FIELD_SIZE ) > 0 )
+    {
+        // Skip FPort
+        bufItr++;
+        memcpy1( macMsg->FRMPayload, &macMsg->Buffer[bufItr], macMsg->FRMPayloadSize );
+    }
+
+    return LORAMAC_PARSER_SUCCESS;
+}
@@ -85,6 +85,16 @@ LoRaMacParserStatus_t LoRaMacParserJoinAccept( LoRaMacMessageJoinAccept_t *macMs
  */
 LoRaMacParserStatus_t LoRaMacParserData( LoRaMacMessageData_t *macMsg );
 
+/*!
+ * Parse the header fields, FPort, FRMPayload size and MIC of a serialized data
+ * message without copying the FOpts and the FRMPayload. Used to check the
+ * address and the frame counter of a received frame before it is processed.
+ *
+ * \param[IN/OUT] macMsg       - Data message object
+ * \retval                     - Status of the operation
+ */
+LoRaMacParserStatus_t LoRaMacParserDataHeader( LoRaMacMessageData_t *macMsg );
+
 /*! \} addtogroup LORAMAC */
 
 #ifdef __cplusplus
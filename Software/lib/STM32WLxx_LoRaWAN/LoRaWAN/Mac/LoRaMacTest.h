@@ -42,6 +42,7 @@ extern "C"
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /*!
  * \brief   Enabled or disables the duty cycle
@@ -53,6 +54,33 @@ extern "C"
  */
 void LoRaMacTestSetDutyCycleOn( bool enable );
 
+/*!
+ * \brief   Computes the Class B temperature compensation of a period of time
+ *
+ * \details This is a test function. It shall be used for testing purposes only.
+ *          Only available when LORAMAC_CLASSB_ENABLED is 1.
+ *
+ * \param   [IN] period - Time period to compensate
+ * \param   [IN] temperature - Current temperature in degrees
+ *
+ * \retval  Compensated time period
+ */
+uint32_t LoRaMacTestTempCompensation( uint32_t period, int16_t temperature );
+
+/*!
+ * \brief   Gets the ping slot schedule of a multicast group for the current
+ *          beacon period, as the multicast slots use it
+ *
+ * \details This is a test function. It shall be used for testing purposes only.
+ *          Only available when LORAMAC_CLASSB_ENABLED is 1.
+ *
+ * \param   [IN] groupID - Multicast group
+ * \param   [OUT] pingPeriod - Ping period of the group
+ *
+ * \retval  Frequency of the multicast ping slots of the group
+ */
+uint32_t LoRaMacTestMulticastSlotSchedule( uint8_t groupID, uint16_t *pingPeriod );
+
 /*! \} defgroup LORAMACTEST */
 
 #ifdef __cplusplus
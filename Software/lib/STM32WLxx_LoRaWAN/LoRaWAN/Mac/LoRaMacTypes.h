@@ -64,6 +64,19 @@ extern "C"
  */
 #define   LORAMAC_MAX_MC_CTX            1
 
+/*!
+ * Number of fractional bits of the powers and gains in dB, which are stored
+ * as Q8.8 fixed point values in int16_t
+ */
+#define LORAMAC_DB_Q_BITS               8
+
+/*!
+ * Converts a constant value in dB to Q8.8, rounded to the nearest.
+ *
+ * \remark Only for constant expressions, which are evaluated by the compiler
+ */
+#define LORAMAC_DB_TO_Q( db )           ( ( int16_t )( ( db ) * ( 1 << LORAMAC_DB_Q_BITS ) + ( ( ( db ) < 0 ) ? -0.5 : 0.5 ) ) )
+
 /*!
  * LoRaWAN devices classes definition
  *
@@ -898,9 +898,9 @@ typedef union uPhyParam
      */
     uint32_t Value;
     /*!
-     * A floating point value.
+     * A fixed point value, Q8.8.
      */
-    float fValue;
+    int16_t QValue;
     /*!
      * Pointer to the channels mask.
      */
@@ -1146,13 +1146,13 @@ typedef struct sTxConfigParams
      */
     int8_t TxPower;
     /*!
-     * The Max EIRP, if applicable.
+     * The Max EIRP in dBm Q8.8, if applicable.
      */
-    float MaxEirp;
+    int16_t MaxEirpQ8;
     /*!
-     * The antenna gain, if applicable.
+     * The antenna gain in dBi Q8.8, if applicable.
      */
-    float AntennaGain;
+    int16_t AntennaGainQ8;
     /*!
      * Frame length to setup.
      */
@@ -1364,13 +1364,13 @@ typedef struct sContinuousWaveParams
      */
     int8_t TxPower;
     /*!
-     * Max EIRP, if applicable.
+     * Max EIRP in dBm Q8.8, if applicable.
      */
-    float MaxEirp;
+    int16_t MaxEirpQ8;
     /*!
-     * The antenna gain, if applicable.
+     * The antenna gain in dBi Q8.8, if applicable.
      */
-    float AntennaGain;
+    int16_t AntennaGainQ8;
     /*!
      * Specifies the time the radio will stay in CW mode.
      */
@@ -354,6 +354,34 @@ static const uint8_t MaxPayloadOfDatarateDwell1DownAS923[] = { 0, 0, 11, 53, 126
  */
 static const int8_t EffectiveRx1DrOffsetAS923[] = { 0, 1, 2, 3, 4, 5, -1, -2 };
 
+/*!
+ * Size of the channels mask
+ */
+#define AS923_CHANNELS_MASK_SIZE            1
+
+/*!
+ * Region specific context
+ */
+typedef struct sRegionAS923NvmCtx
+{
+    /*!
+     * LoRaMAC channels
+     */
+    ChannelParams_t Channels[ AS923_MAX_NB_CHANNELS ];
+    /*!
+     * LoRaMac bands
+     */
+    Band_t Bands[ AS923_MAX_NB_BANDS ];
+    /*!
+     * LoRaMac channels mask
+     */
+    uint16_t ChannelsMask[ AS923_CHANNELS_MASK_SIZE ];
+    /*!
+     * LoRaMac channels default mask
+     */
+    uint16_t ChannelsDefaultMask[ AS923_CHANNELS_MASK_SIZE ];
+}RegionAS923NvmCtx_t;
+
 /*!
  * \brief The function gets a value of a specific phy attribute.
  *
@@ -32,44 +32,30 @@
 
 #include "RegionCommon.h"
 #include "RegionAU915.h"
+#include "LoRaMacInstance.h"
+
+#ifdef REGION_AU915
 
 // Definitions
-#define CHANNELS_MASK_SIZE              6
+#define CHANNELS_MASK_SIZE              AU915_CHANNELS_MASK_SIZE
 
 // A mask to select only valid 500KHz channels
 #define CHANNELS_MASK_500KHZ_MASK       0x00FF
 
-/*!
- * Region specific context
+/*
+ * Non-volatile module context of the current LoRaMac instance.
  */
-typedef struct sRegionAU915NvmCtx
-{
-    /*!
-     * LoRaMAC channels
-     */
-    ChannelParams_t Channels[ AU915_MAX_NB_CHANNELS ];
-    /*!
-     * LoRaMac bands
-     */
-    Band_t Bands[ AU915_MAX_NB_BANDS ];
-    /*!
-     * LoRaMac channels mask
-     */
-    uint16_t ChannelsMask[ CHANNELS_MASK_SIZE ];
-    /*!
-     * LoRaMac channels remaining
-     */
-    uint16_t ChannelsMaskRemaining[CHANNELS_MASK_SIZE];
-    /*!
-     * LoRaMac channels default mask
-     */
-    uint16_t ChannelsDefaultMask[ CHANNELS_MASK_SIZE ];
-}RegionAU915NvmCtx_t;
+#define RegionNvmCtx                    ( LoRaMacCurrentInstance->Regions.AU915 )
 
 /*
- * Non-volatile module context.
+ * Channels of RegionNvmCtx.Channels by datarate and band, rebuilt when the channels change.
  */
-static RegionAU915NvmCtx_t NvmCtx;
+#define ChannelsBitmap                  ( LoRaMacCurrentInstance->Regions.AU915ChannelsBitmap )
+
+/*
+ * Counter of join trials needed to alternate between DR2 and DR6, see \ref RegionAU915AlternateDr
+ */
+#define JoinTrialsCount                 ( LoRaMacCurrentInstance->Regions.AU915JoinTrialsCount )
 
 // Static functions
 static int8_t GetNextLowerTxDr( int8_t dr, int8_t minDr )
@@ -296,12 +282,12 @@ PhyParam_t RegionAU915GetPhyParam( GetPhyParams_t* getPhy )
         }
         case PHY_CHANNELS_MASK:
         {
-            phyParam.ChannelsMask = NvmCtx.ChannelsMask;
+            phyParam.ChannelsMask = RegionNvmCtx.ChannelsMask;
             break;
         }
         case PHY_CHANNELS_DEFAULT_MASK:
         {
-            phyParam.ChannelsMask = NvmCtx.ChannelsDefaultMask;
+            phyParam.ChannelsMask = RegionNvmCtx.ChannelsDefaultMask;
             break;
         }
         case PHY_MAX_NB_CHANNELS:
@@ -311,7 +297,7 @@ PhyParam_t RegionAU915GetPhyParam( GetPhyParams_t* getPhy )
         }
         case PHY_CHANNELS:
         {
-            phyParam.Channels = NvmCtx.Channels;
+            phyParam.Channels = RegionNvmCtx.Channels;
             break;
         }
         case PHY_DEF_UPLINK_DWELL_TIME:
@@ -326,12 +312,12 @@ PhyParam_t RegionAU915GetPhyParam( GetPhyParams_t* getPhy )
         }
         case PHY_DEF_MAX_EIRP:
         {
-            phyParam.fValue = AU915_DEFAULT_MAX_EIRP;
+            phyParam.QValue = LORAMAC_DB_TO_Q( AU915_DEFAULT_MAX_EIRP );
             break;
         }
         case PHY_DEF_ANTENNA_GAIN:
         {
-            phyParam.fValue = AU915_DEFAULT_ANTENNA_GAIN;
+            phyParam.QValue = LORAMAC_DB_TO_Q( AU915_DEFAULT_ANTENNA_GAIN );
             break;
         }
         case PHY_BEACON_CHANNEL_FREQ:
@@ -397,7 +383,7 @@ PhyParam_t RegionAU915GetPhyParam( GetPhyParams_t* getPhy )
 
 void RegionAU915SetBandTxDone( SetBandTxDoneParams_t* txDone )
 {
-    RegionCommonSetBandTxDone( &NvmCtx.Bands[NvmCtx.Channels[txDone->Channel].Band],
+    RegionCommonSetBandTxDone( &RegionNvmCtx.Bands[RegionNvmCtx.Channels[txDone->Channel].Band],
                                txDone->LastTxAirTime, txDone->Joined, txDone->ElapsedTimeSinceStartUp );
 }
 
@@ -412,49 +398,55 @@ void RegionAU915InitDefaults( InitDefaultsParams_t* params )
     {
         case INIT_TYPE_DEFAULTS:
         {
+            // Time-on-air table of the uplink datarates
+            RegionCommonTimeOnAirTableInit( GetTimeOnAir, REGION_COMMON_DATARATE_MASK( DR_0, DR_6 ) | REGION_COMMON_DATARATE_MASK( DR_8, DR_13 ) );
+
             // Default bands
-            memcpy1( ( uint8_t* )NvmCtx.Bands, ( uint8_t* )bands, sizeof( Band_t ) * AU915_MAX_NB_BANDS );
+            memcpy1( ( uint8_t* )RegionNvmCtx.Bands, ( uint8_t* )bands, sizeof( Band_t ) * AU915_MAX_NB_BANDS );
 
             // Channels
             for( uint8_t i = 0; i < AU915_MAX_NB_CHANNELS - 8; i++ )
             {
                 // 125 kHz channels
-                NvmCtx.Channels[i].Frequency = 915200000 + i * 200000;
-                NvmCtx.Channels[i].DrRange.Value = ( DR_5 << 4 ) | DR_0;
-                NvmCtx.Channels[i].Band = 0;
+                RegionNvmCtx.Channels[i].Frequency = 915200000 + i * 200000;
+                RegionNvmCtx.Channels[i].DrRange.Value = ( DR_5 << 4 ) | DR_0;
+                RegionNvmCtx.Channels[i].Band = 0;
             }
             for( uint8_t i = AU915_MAX_NB_CHANNELS - 8; i < AU915_MAX_NB_CHANNELS; i++ )
             {
                 // 500 kHz channels
-                NvmCtx.Channels[i].Frequency = 915900000 + ( i - ( AU915_MAX_NB_CHANNELS - 8 ) ) * 1600000;
-                NvmCtx.Channels[i].DrRange.Value = ( DR_6 << 4 ) | DR_6;
-                NvmCtx.Channels[i].Band = 0;
+                RegionNvmCtx.Channels[i].Frequency = 915900000 + ( i - ( AU915_MAX_NB_CHANNELS - 8 ) ) * 1600000;
+                RegionNvmCtx.Channels[i].DrRange.Value = ( DR_6 << 4 ) | DR_6;
+                RegionNvmCtx.Channels[i].Band = 0;
             }
 
+            // Channels bitmap of the uplink channel selection
+            RegionCommonChannelsBitmapInit( &ChannelsBitmap, RegionNvmCtx.Channels, AU915_MAX_NB_CHANNELS );
+
             // Initialize channels default mask
             /* ST_WORKAROUND_BEGIN: Hybrid mode */
 #if ( HYBRID_ENABLED == 1 )
-            NvmCtx.ChannelsDefaultMask[0] = 0x00FF;
-            NvmCtx.ChannelsDefaultMask[1] = 0x0000;
-            NvmCtx.ChannelsDefaultMask[2] = 0x0000;
-            NvmCtx.ChannelsDefaultMask[3] = 0x0000;
-            NvmCtx.ChannelsDefaultMask[4] = 0x0001;
-            NvmCtx.ChannelsDefaultMask[5] = 0x0000;
+            RegionNvmCtx.ChannelsDefaultMask[0] = 0x00FF;
+            RegionNvmCtx.ChannelsDefaultMask[1] = 0x0000;
+            RegionNvmCtx.ChannelsDefaultMask[2] = 0x0000;
+            RegionNvmCtx.ChannelsDefaultMask[3] = 0x0000;
+            RegionNvmCtx.ChannelsDefaultMask[4] = 0x0001;
+            RegionNvmCtx.ChannelsDefaultMask[5] = 0x0000;
 #else
-            NvmCtx.ChannelsDefaultMask[0] = 0xFFFF;
-            NvmCtx.ChannelsDefaultMask[1] = 0xFFFF;
-            NvmCtx.ChannelsDefaultMask[2] = 0xFFFF;
-            NvmCtx.ChannelsDefaultMask[3] = 0xFFFF;
-            NvmCtx.ChannelsDefaultMask[4] = 0x00FF;
-            NvmCtx.ChannelsDefaultMask[5] = 0x0000;
+            RegionNvmCtx.ChannelsDefaultMask[0] = 0xFFFF;
+            RegionNvmCtx.ChannelsDefaultMask[1] = 0xFFFF;
+            RegionNvmCtx.ChannelsDefaultMask[2] = 0xFFFF;
+            RegionNvmCtx.ChannelsDefaultMask[3] = 0xFFFF;
+            RegionNvmCtx.ChannelsDefaultMask[4] = 0x00FF;
+            RegionNvmCtx.ChannelsDefaultMask[5] = 0x0000;
 #endif /* HYBRID_ENABLED == 1 */
             /* ST_WORKAROUND_END */
 
             // Copy channels default mask
-            RegionCommonChanMaskCopy( NvmCtx.ChannelsMask, NvmCtx.ChannelsDefaultMask, CHANNELS_MASK_SIZE );
+            RegionCommonChanMaskCopy( RegionNvmCtx.ChannelsMask, RegionNvmCtx.ChannelsDefaultMask, CHANNELS_MASK_SIZE );
 
             // Copy into channels mask remaining
-            RegionCommonChanMaskCopy( NvmCtx.ChannelsMaskRemaining, NvmCtx.ChannelsMask, CHANNELS_MASK_SIZE );
+            RegionCommonChanMaskCopy( RegionNvmCtx.ChannelsMaskRemaining, RegionNvmCtx.ChannelsMask, CHANNELS_MASK_SIZE );
             break;
         }
         case INIT_TYPE_RESET_TO_DEFAULT_CHANNELS:
@@ -464,11 +456,11 @@ void RegionAU915InitDefaults( InitDefaultsParams_t* params )
         case INIT_TYPE_ACTIVATE_DEFAULT_CHANNELS:
         {
             // Copy channels default mask
-            RegionCommonChanMaskCopy( NvmCtx.ChannelsMask, NvmCtx.ChannelsDefaultMask, CHANNELS_MASK_SIZE );
+            RegionCommonChanMaskCopy( RegionNvmCtx.ChannelsMask, RegionNvmCtx.ChannelsDefaultMask, CHANNELS_MASK_SIZE );
 
             for( uint8_t i = 0; i < CHANNELS_MASK_SIZE; i++ )
             { // Copy-And the channels mask
-                NvmCtx.ChannelsMaskRemaining[i] &= NvmCtx.ChannelsMask[i];
+                RegionNvmCtx.ChannelsMaskRemaining[i] &= RegionNvmCtx.ChannelsMask[i];
             }
             break;
         }
@@ -476,7 +468,8 @@ void RegionAU915InitDefaults( InitDefaultsParams_t* params )
         {
             if( params->NvmCtx != 0 )
             {
-                memcpy1( (uint8_t*) &NvmCtx, (uint8_t*) params->NvmCtx, sizeof( NvmCtx ) );
+                memcpy1( (uint8_t*) &RegionNvmCtx, (uint8_t*) params->NvmCtx, sizeof( RegionNvmCtx ) );
+                RegionCommonChannelsBitmapInit( &ChannelsBitmap, RegionNvmCtx.Channels, AU915_MAX_NB_CHANNELS );
             }
             break;
         }
@@ -490,7 +483,7 @@ void RegionAU915InitDefaults( InitDefaultsParams_t* params )
 void* RegionAU915GetNvmCtx( GetNvmCtxParams_t* params )
 {
     params->nvmCtxSize = sizeof( RegionAU915NvmCtx_t );
-    return &NvmCtx;
+    return &RegionNvmCtx;
 }
 
 bool RegionAU915Verify( VerifyParams_t* verify, PhyAttribute_t phyAttribute )
@@ -556,14 +549,14 @@ void RegionAU915ApplyCFList( ApplyCFListParams_t* applyCFList )
     // ChMask0 - ChMask4 must be set (every ChMask has 16 bit)
     for( uint8_t chMaskItr = 0, cntPayload = 0; chMaskItr <= 4; chMaskItr++, cntPayload+=2 )
     {
-        NvmCtx.ChannelsMask[chMaskItr] = (uint16_t) (0x00FF & applyCFList->Payload[cntPayload]);
-        NvmCtx.ChannelsMask[chMaskItr] |= (uint16_t) (applyCFList->Payload[cntPayload+1] << 8);
+        RegionNvmCtx.ChannelsMask[chMaskItr] = (uint16_t) (0x00FF & applyCFList->Payload[cntPayload]);
+        RegionNvmCtx.ChannelsMask[chMaskItr] |= (uint16_t) (applyCFList->Payload[cntPayload+1] << 8);
         if( chMaskItr == 4 )
         {
-            NvmCtx.ChannelsMask[chMaskItr] = NvmCtx.ChannelsMask[chMaskItr] & CHANNELS_MASK_500KHZ_MASK;
+            RegionNvmCtx.ChannelsMask[chMaskItr] = RegionNvmCtx.ChannelsMask[chMaskItr] & CHANNELS_MASK_500KHZ_MASK;
         }
         // Set the channel mask to the remaining
-        NvmCtx.ChannelsMaskRemaining[chMaskItr] &= NvmCtx.ChannelsMask[chMaskItr];
+        RegionNvmCtx.ChannelsMaskRemaining[chMaskItr] &= RegionNvmCtx.ChannelsMask[chMaskItr];
     }
 }
 
@@ -573,20 +566,20 @@ bool RegionAU915ChanMaskSet( ChanMaskSetParams_t* chanMaskSet )
     {
         case CHANNELS_MASK:
         {
-            RegionCommonChanMaskCopy( NvmCtx.ChannelsMask, chanMaskSet->ChannelsMaskIn, 6 );
+            RegionCommonChanMaskCopy( RegionNvmCtx.ChannelsMask, chanMaskSet->ChannelsMaskIn, 6 );
 
-            NvmCtx.ChannelsDefaultMask[4] = NvmCtx.ChannelsDefaultMask[4] & CHANNELS_MASK_500KHZ_MASK;
-            NvmCtx.ChannelsDefaultMask[5] = 0x0000;
+            RegionNvmCtx.ChannelsDefaultMask[4] = RegionNvmCtx.ChannelsDefaultMask[4] & CHANNELS_MASK_500KHZ_MASK;
+            RegionNvmCtx.ChannelsDefaultMask[5] = 0x0000;
 
             for( uint8_t i = 0; i < 6; i++ )
             { // Copy-And the channels mask
-                NvmCtx.ChannelsMaskRemaining[i] &= NvmCtx.ChannelsMask[i];
+                RegionNvmCtx.ChannelsMaskRemaining[i] &= RegionNvmCtx.ChannelsMask[i];
             }
             break;
         }
         case CHANNELS_DEFAULT_MASK:
         {
-            RegionCommonChanMaskCopy( NvmCtx.ChannelsDefaultMask, chanMaskSet->ChannelsMaskIn, 6 );
+            RegionCommonChanMaskCopy( RegionNvmCtx.ChannelsDefaultMask, chanMaskSet->ChannelsMaskIn, 6 );
             break;
         }
         default:
@@ -656,25 +649,25 @@ bool RegionAU915RxConfig( RxConfigParams_t* rxConfig, int8_t* datarate )
 bool RegionAU915TxConfig( TxConfigParams_t* txConfig, int8_t* txPower, TimerTime_t* txTimeOnAir )
 {
     int8_t phyDr = DataratesAU915[txConfig->Datarate];
-    int8_t txPowerLimited = LimitTxPower( txConfig->TxPower, NvmCtx.Bands[NvmCtx.Channels[txConfig->Channel].Band].TxMaxPower, txConfig->Datarate, NvmCtx.ChannelsMask );
+    int8_t txPowerLimited = LimitTxPower( txConfig->TxPower, RegionNvmCtx.Bands[RegionNvmCtx.Channels[txConfig->Channel].Band].TxMaxPower, txConfig->Datarate, RegionNvmCtx.ChannelsMask );
     uint32_t bandwidth = GetBandwidth( txConfig->Datarate );
     int8_t phyTxPower = 0;
 
     // Calculate physical TX power
-    phyTxPower = RegionCommonComputeTxPower( txPowerLimited, txConfig->MaxEirp, txConfig->AntennaGain );
+    phyTxPower = RegionCommonComputeTxPower( txPowerLimited, txConfig->MaxEirpQ8, txConfig->AntennaGainQ8 );
 
     // Setup the radio frequency
-    Radio.SetChannel( NvmCtx.Channels[txConfig->Channel].Frequency );
+    Radio.SetChannel( RegionNvmCtx.Channels[txConfig->Channel].Frequency );
 
     Radio.SetTxConfig( MODEM_LORA, phyTxPower, 0, bandwidth, phyDr, 1, 8, false, true, 0, 0, false, 4000 );
     /* ST_WORKAROUND_BEGIN: Print Tx config */
-    RegionCommonTxConfigPrint(NvmCtx.Channels[txConfig->Channel].Frequency, txConfig->Datarate);
+    RegionCommonTxConfigPrint(RegionNvmCtx.Channels[txConfig->Channel].Frequency, txConfig->Datarate);
     /* ST_WORKAROUND_END */
 
     // Setup maximum payload length of the radio driver
     Radio.SetMaxPayloadLength( MODEM_LORA, txConfig->PktLen );
     // Update time-on-air
-    *txTimeOnAir = GetTimeOnAir( txConfig->Datarate, txConfig->PktLen );
+    *txTimeOnAir = RegionCommonGetTimeOnAir( GetTimeOnAir, txConfig->Datarate, txConfig->PktLen );
 
     *txPower = txPowerLimited;
     return true;
@@ -692,7 +685,7 @@ uint8_t RegionAU915LinkAdrReq( LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, in
     RegionCommonLinkAdrReqVerifyParams_t linkAdrVerifyParams;
 
     // Initialize local copy of channels mask
-    RegionCommonChanMaskCopy( channelsMask, NvmCtx.ChannelsMask, 6 );
+    RegionCommonChanMaskCopy( channelsMask, RegionNvmCtx.ChannelsMask, 6 );
 
     while( bytesProcessed < linkAdrReq->PayloadSize )
     {
@@ -810,7 +803,7 @@ uint8_t RegionAU915LinkAdrReq( LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, in
     linkAdrVerifyParams.ChannelsMask = channelsMask;
     linkAdrVerifyParams.MinDatarate = ( int8_t )phyParam.Value;
     linkAdrVerifyParams.MaxDatarate = AU915_TX_MAX_DATARATE;
-    linkAdrVerifyParams.Channels = NvmCtx.Channels;
+    linkAdrVerifyParams.Channels = RegionNvmCtx.Channels;
     linkAdrVerifyParams.MinTxPower = AU915_MIN_TX_POWER;
     linkAdrVerifyParams.MaxTxPower = AU915_MAX_TX_POWER;
     linkAdrVerifyParams.Version = linkAdrReq->Version;
@@ -822,14 +815,14 @@ uint8_t RegionAU915LinkAdrReq( LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, in
     if( status == 0x07 )
     {
         // Copy Mask
-        RegionCommonChanMaskCopy( NvmCtx.ChannelsMask, channelsMask, 6 );
-
-        NvmCtx.ChannelsMaskRemaining[0] &= NvmCtx.ChannelsMask[0];
-        NvmCtx.ChannelsMaskRemaining[1] &= NvmCtx.ChannelsMask[1];
-        NvmCtx.ChannelsMaskRemaining[2] &= NvmCtx.ChannelsMask[2];
-        NvmCtx.ChannelsMaskRemaining[3] &= NvmCtx.ChannelsMask[3];
-        NvmCtx.ChannelsMaskRemaining[4] = NvmCtx.ChannelsMask[4];
-        NvmCtx.ChannelsMaskRemaining[5] = NvmCtx.ChannelsMask[5];
+        RegionCommonChanMaskCopy( RegionNvmCtx.ChannelsMask, channelsMask, 6 );
+
+        RegionNvmCtx.ChannelsMaskRemaining[0] &= RegionNvmCtx.ChannelsMask[0];
+        RegionNvmCtx.ChannelsMaskRemaining[1] &= RegionNvmCtx.ChannelsMask[1];
+        RegionNvmCtx.ChannelsMaskRemaining[2] &= RegionNvmCtx.ChannelsMask[2];
+        RegionNvmCtx.ChannelsMaskRemaining[3] &= RegionNvmCtx.ChannelsMask[3];
+        RegionNvmCtx.ChannelsMaskRemaining[4] = RegionNvmCtx.ChannelsMask[4];
+        RegionNvmCtx.ChannelsMaskRemaining[5] = RegionNvmCtx.ChannelsMask[5];
     }
 
     // Update status variables
@@ -890,12 +883,10 @@ uint8_t RegionAU915DlChannelReq( DlChannelReqParams_t* dlChannelReq )
 
 int8_t RegionAU915AlternateDr( int8_t currentDr, AlternateDrType_t type )
 {
-    static int8_t trialsCount = 0;
-
     // Re-enable 500 kHz default channels
-    NvmCtx.ChannelsMask[4] = CHANNELS_MASK_500KHZ_MASK;
+    RegionNvmCtx.ChannelsMask[4] = CHANNELS_MASK_500KHZ_MASK;
 
-    if( ( trialsCount & 0x01 ) == 0x01 )
+    if( ( JoinTrialsCount & 0x01 ) == 0x01 )
     {
         currentDr = DR_6;
     }
@@ -903,7 +894,7 @@ int8_t RegionAU915AlternateDr( int8_t currentDr, AlternateDrType_t type )
     {
         currentDr = DR_2;
     }
-    trialsCount++;
+    JoinTrialsCount++;
     return currentDr;
 }
 
@@ -911,31 +902,31 @@ LoRaMacStatus_t RegionAU915NextChannel( NextChanParams_t* nextChanParams, uint8_
 {
     uint8_t nbEnabledChannels = 0;
     uint8_t nbRestrictedChannels = 0;
-    uint8_t enabledChannels[AU915_MAX_NB_CHANNELS] = { 0 };
+    uint16_t enabledChannels[REGION_COMMON_CHANNELS_BITMAP_SIZE] = { 0 };
     RegionCommonIdentifyChannelsParam_t identifyChannelsParam;
     RegionCommonCountNbOfEnabledChannelsParams_t countChannelsParams;
     LoRaMacStatus_t status = LORAMAC_STATUS_NO_CHANNEL_FOUND;
 
     // Count 125kHz channels
-    if( RegionCommonCountChannels( NvmCtx.ChannelsMaskRemaining, 0, 4 ) == 0 )
+    if( RegionCommonCountChannels( RegionNvmCtx.ChannelsMaskRemaining, 0, 4 ) == 0 )
     { // Reactivate default channels
-        RegionCommonChanMaskCopy( NvmCtx.ChannelsMaskRemaining, NvmCtx.ChannelsMask, 4  );
+        RegionCommonChanMaskCopy( RegionNvmCtx.ChannelsMaskRemaining, RegionNvmCtx.ChannelsMask, 4  );
     }
     // Check other channels
     if( nextChanParams->Datarate >= DR_6 )
     {
-        if( ( NvmCtx.ChannelsMaskRemaining[4] & CHANNELS_MASK_500KHZ_MASK ) == 0 )
+        if( ( RegionNvmCtx.ChannelsMaskRemaining[4] & CHANNELS_MASK_500KHZ_MASK ) == 0 )
         {
-            NvmCtx.ChannelsMaskRemaining[4] = NvmCtx.ChannelsMask[4];
+            RegionNvmCtx.ChannelsMaskRemaining[4] = RegionNvmCtx.ChannelsMask[4];
         }
     }
 
     // Search how many channels are enabled
     countChannelsParams.Joined = nextChanParams->Joined;
     countChannelsParams.Datarate = nextChanParams->Datarate;
-    countChannelsParams.ChannelsMask = NvmCtx.ChannelsMaskRemaining;
-    countChannelsParams.Channels = NvmCtx.Channels;
-    countChannelsParams.Bands = NvmCtx.Bands;
+    countChannelsParams.ChannelsMask = RegionNvmCtx.ChannelsMaskRemaining;
+    countChannelsParams.Channels = RegionNvmCtx.Channels;
+    countChannelsParams.Bands = RegionNvmCtx.Bands;
     countChannelsParams.MaxNbChannels = AU915_MAX_NB_CHANNELS;
     countChannelsParams.JoinChannels = 0;
 
@@ -946,19 +937,19 @@ LoRaMacStatus_t RegionAU915NextChannel( NextChanParams_t* nextChanParams, uint8_
 
     identifyChannelsParam.ElapsedTimeSinceStartUp = nextChanParams->ElapsedTimeSinceStartUp;
     identifyChannelsParam.LastTxIsJoinRequest = nextChanParams->LastTxIsJoinRequest;
-    identifyChannelsParam.ExpectedTimeOnAir = GetTimeOnAir( nextChanParams->Datarate, nextChanParams->PktLen );
+    identifyChannelsParam.ExpectedTimeOnAir = RegionCommonGetTimeOnAir( GetTimeOnAir, nextChanParams->Datarate, nextChanParams->PktLen );
 
     identifyChannelsParam.CountNbOfEnabledChannelsParam = &countChannelsParams;
 
-    status = RegionCommonIdentifyChannels( &identifyChannelsParam, aggregatedTimeOff, enabledChannels,
-                                           &nbEnabledChannels, &nbRestrictedChannels, time );
+    status = RegionCommonIdentifyChannelsBitmap( &identifyChannelsParam, &ChannelsBitmap, aggregatedTimeOff, enabledChannels,
+                                                 &nbEnabledChannels, &nbRestrictedChannels, time );
 
     if( status == LORAMAC_STATUS_OK )
     {
         // We found a valid channel
-        *channel = enabledChannels[randr( 0, nbEnabledChannels - 1 )];
+        *channel = RegionCommonChannelsBitmapSelect( enabledChannels, randr( 0, nbEnabledChannels - 1 ) );
         // Disable the channel in the mask
-        RegionCommonChanDisable( NvmCtx.ChannelsMaskRemaining, *channel, AU915_MAX_NB_CHANNELS - 8 );
+        RegionCommonChanDisable( RegionNvmCtx.ChannelsMaskRemaining, *channel, AU915_MAX_NB_CHANNELS - 8 );
     }
     return status;
 }
@@ -975,12 +966,12 @@ bool RegionAU915ChannelsRemove( ChannelRemoveParams_t* channelRemove  )
 
 void RegionAU915SetContinuousWave( ContinuousWaveParams_t* continuousWave )
 {
-    int8_t txPowerLimited = LimitTxPower( continuousWave->TxPower, NvmCtx.Bands[NvmCtx.Channels[continuousWave->Channel].Band].TxMaxPower, continuousWave->Datarate, NvmCtx.ChannelsMask );
+    int8_t txPowerLimited = LimitTxPower( continuousWave->TxPower, RegionNvmCtx.Bands[RegionNvmCtx.Channels[continuousWave->Channel].Band].TxMaxPower, continuousWave->Datarate, RegionNvmCtx.ChannelsMask );
     int8_t phyTxPower = 0;
-    uint32_t frequency = NvmCtx.Channels[continuousWave->Channel].Frequency;
+    uint32_t frequency = RegionNvmCtx.Channels[continuousWave->Channel].Frequency;
 
     // Calculate physical TX power
-    phyTxPower = RegionCommonComputeTxPower( txPowerLimited, continuousWave->MaxEirp, continuousWave->AntennaGain );
+    phyTxPower = RegionCommonComputeTxPower( txPowerLimited, continuousWave->MaxEirpQ8, continuousWave->AntennaGainQ8 );
 
     Radio.SetTxContinuousWave( frequency, phyTxPower, continuousWave->Timeout );
 }
@@ -1020,3 +1011,5 @@ void RegionAU915RxBeaconSetup( RxBeaconSetup_t* rxBeaconSetup, uint8_t* outDr )
     // Store downlink datarate
     *outDr = AU915_BEACON_CHANNEL_DR;
 }
+
+#endif /* REGION_AU915 */
@@ -333,6 +333,38 @@ static const uint8_t MaxPayloadOfDatarateDwell1AU915[] = { 0, 0, 11, 53, 125, 24
  */
 static const uint8_t MaxPayloadOfDatarateRepeaterDwell1AU915[] = { 0, 0, 11, 53, 125, 242, 242, 0, 33, 109, 222, 222, 222, 222 };
 
+/*!
+ * Size of the channels mask
+ */
+#define AU915_CHANNELS_MASK_SIZE            6
+
+/*!
+ * Region specific context
+ */
+typedef struct sRegionAU915NvmCtx
+{
+    /*!
+     * LoRaMAC channels
+     */
+    ChannelParams_t Channels[ AU915_MAX_NB_CHANNELS ];
+    /*!
+     * LoRaMac bands
+     */
+    Band_t Bands[ AU915_MAX_NB_BANDS ];
+    /*!
+     * LoRaMac channels mask
+     */
+    uint16_t ChannelsMask[ AU915_CHANNELS_MASK_SIZE ];
+    /*!
+     * LoRaMac channels remaining
+     */
+    uint16_t ChannelsMaskRemaining[AU915_CHANNELS_MASK_SIZE];
+    /*!
+     * LoRaMac channels default mask
+     */
+    uint16_t ChannelsDefaultMask[ AU915_CHANNELS_MASK_SIZE ];
+}RegionAU915NvmCtx_t;
+
 /*!
  * \brief The function gets a value of a specific phy attribute.
  *
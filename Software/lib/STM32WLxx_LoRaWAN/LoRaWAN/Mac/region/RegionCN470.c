@@ -32,37 +32,22 @@
 
 #include "RegionCommon.h"
 #include "RegionCN470.h"
+#include "LoRaMacInstance.h"
+
+#ifdef REGION_CN470
 
 // Definitions
-#define CHANNELS_MASK_SIZE              6
+#define CHANNELS_MASK_SIZE              CN470_CHANNELS_MASK_SIZE
 
-/*!
- * Region specific context
+/*
+ * Non-volatile module context of the current LoRaMac instance.
  */
-typedef struct sRegionCN470NvmCtx
-{
-    /*!
-     * LoRaMAC channels
-     */
-    ChannelParams_t Channels[ CN470_MAX_NB_CHANNELS ];
-    /*!
-     * LoRaMac bands
-     */
-    Band_t Bands[ CN470_MAX_NB_BANDS ];
-    /*!
-     * LoRaMac channels mask
-     */
-    uint16_t ChannelsMask[ CHANNELS_MASK_SIZE ];
-    /*!
-     * LoRaMac channels default mask
-     */
-    uint16_t ChannelsDefaultMask[ CHANNELS_MASK_SIZE ];
-}RegionCN470NvmCtx_t;
+#define RegionNvmCtx                    ( LoRaMacCurrentInstance->Regions.CN470 )
 
 /*
- * Non-volatile module context.
+ * Channels of RegionNvmCtx.Channels by datarate and band, rebuilt when the channels change.
  */
-static RegionCN470NvmCtx_t NvmCtx;
+#define ChannelsBitmap                  ( LoRaMacCurrentInstance->Regions.CN470ChannelsBitmap )
 
 // Static functions
 static int8_t GetNextLowerTxDr( int8_t dr, int8_t minDr )
@@ -249,12 +234,12 @@ PhyParam_t RegionCN470GetPhyParam( GetPhyParams_t* getPhy )
         }
         case PHY_CHANNELS_MASK:
         {
-            phyParam.ChannelsMask = NvmCtx.ChannelsMask;
+            phyParam.ChannelsMask = RegionNvmCtx.ChannelsMask;
             break;
         }
         case PHY_CHANNELS_DEFAULT_MASK:
         {
-            phyParam.ChannelsMask = NvmCtx.ChannelsDefaultMask;
+            phyParam.ChannelsMask = RegionNvmCtx.ChannelsDefaultMask;
             break;
         }
         case PHY_MAX_NB_CHANNELS:
@@ -264,7 +249,7 @@ PhyParam_t RegionCN470GetPhyParam( GetPhyParams_t* getPhy )
         }
         case PHY_CHANNELS:
         {
-            phyParam.Channels = NvmCtx.Channels;
+            phyParam.Channels = RegionNvmCtx.Channels;
             break;
         }
         case PHY_DEF_UPLINK_DWELL_TIME:
@@ -275,12 +260,12 @@ PhyParam_t RegionCN470GetPhyParam( GetPhyParams_t* getPhy )
         }
         case PHY_DEF_MAX_EIRP:
         {
-            phyParam.fValue = CN470_DEFAULT_MAX_EIRP;
+            phyParam.QValue = LORAMAC_DB_TO_Q( CN470_DEFAULT_MAX_EIRP );
             break;
         }
         case PHY_DEF_ANTENNA_GAIN:
         {
-            phyParam.fValue = CN470_DEFAULT_ANTENNA_GAIN;
+            phyParam.QValue = LORAMAC_DB_TO_Q( CN470_DEFAULT_ANTENNA_GAIN );
             break;
         }
         case PHY_BEACON_CHANNEL_FREQ:
@@ -346,7 +331,7 @@ PhyParam_t RegionCN470GetPhyParam( GetPhyParams_t* getPhy )
 
 void RegionCN470SetBandTxDone( SetBandTxDoneParams_t* txDone )
 {
-    RegionCommonSetBandTxDone( &NvmCtx.Bands[NvmCtx.Channels[txDone->Channel].Band],
+    RegionCommonSetBandTxDone( &RegionNvmCtx.Bands[RegionNvmCtx.Channels[txDone->Channel].Band],
                                txDone->LastTxAirTime, txDone->Joined, txDone->ElapsedTimeSinceStartUp );
 }
 
@@ -361,40 +346,46 @@ void RegionCN470InitDefaults( InitDefaultsParams_t* params )
     {
         case INIT_TYPE_DEFAULTS:
         {
+            // Time-on-air table of the uplink datarates
+            RegionCommonTimeOnAirTableInit( GetTimeOnAir, REGION_COMMON_DATARATE_MASK( CN470_TX_MIN_DATARATE, CN470_TX_MAX_DATARATE ) );
+
             // Default bands
-            memcpy1( ( uint8_t* )NvmCtx.Bands, ( uint8_t* )bands, sizeof( Band_t ) * CN470_MAX_NB_BANDS );
+            memcpy1( ( uint8_t* )RegionNvmCtx.Bands, ( uint8_t* )bands, sizeof( Band_t ) * CN470_MAX_NB_BANDS );
 
             // Channels
             for( uint8_t i = 0; i < CN470_MAX_NB_CHANNELS; i++ )
             {
                 // 125 kHz channels
-                NvmCtx.Channels[i].Frequency = 470300000 + i * 200000;
-                NvmCtx.Channels[i].DrRange.Value = ( DR_5 << 4 ) | DR_0;
-                NvmCtx.Channels[i].Band = 0;
+                RegionNvmCtx.Channels[i].Frequency = 470300000 + i * 200000;
+                RegionNvmCtx.Channels[i].DrRange.Value = ( DR_5 << 4 ) | DR_0;
+                RegionNvmCtx.Channels[i].Band = 0;
             }
 
+            // Channels bitmap of the uplink channel selection
+            RegionCommonChannelsBitmapInit( &ChannelsBitmap, RegionNvmCtx.Channels, CN470_MAX_NB_CHANNELS );
+
             // Initialize channels default mask
             /* ST_WORKAROUND_BEGIN: Hybrid mode */
 #if ( HYBRID_ENABLED == 1 )
-            NvmCtx.ChannelsDefaultMask[0] = 0x00FF;
-            NvmCtx.ChannelsDefaultMask[1] = 0x0000;
-            NvmCtx.ChannelsDefaultMask[2] = 0x0000;
-            NvmCtx.ChannelsDefaultMask[3] = 0x0000;
-            NvmCtx.ChannelsDefaultMask[4] = 0x0000;
-            NvmCtx.ChannelsDefaultMask[5] = 0x0000;
+            RegionNvmCtx.ChannelsDefaultMask[0] = 0x00FF;
+            RegionNvmCtx.ChannelsDefaultMask[1] = 0x0000;
+            RegionNvmCtx.ChannelsDefaultMask[2] = 0x0000;
+            RegionNvmCtx.ChannelsDefaultMask[3] = 0x0000;
+            RegionNvmCtx.ChannelsDefaultMask[4] = 0x0000;
+            RegionNvmCtx.ChannelsDefaultMask[5] = 0x0000;
 #else
-            NvmCtx.ChannelsDefaultMask[0] = 0xFFFF;
-            NvmCtx.ChannelsDefaultMask[1] = 0xFFFF;
-            NvmCtx.ChannelsDefaultMask[2] = 0xFFFF;
-            NvmCtx.ChannelsDefaultMask[3] = 0xFFFF;
-            NvmCtx.ChannelsDefaultMask[4] = 0xFFFF;
-            NvmCtx.ChannelsDefaultMask[5] = 0xFFFF;
+            RegionNvmCtx.ChannelsDefaultMask[0] = 0xFFFF;
+            RegionNvmCtx.ChannelsDefaultMask[1] = 0xFFFF;
+            RegionNvmCtx.ChannelsDefaultMask[2] = 0xFFFF;
+            RegionNvmCtx.ChannelsDefaultMask[3] = 0xFFFF;
+            RegionNvmCtx.ChannelsDefaultMask[4] = 0xFFFF;
+            RegionNvmCtx.ChannelsDefaultMask[5] = 0xFFFF;
 #endif /* HYBRID_ENABLED == 1 */
             /* ST_WORKAROUND_END */
 
 
             // Copy channels default mask
-            RegionCommonChanMaskCopy( NvmCtx.ChannelsMask, NvmCtx.ChannelsDefaultMask, CHANNELS_MASK_SIZE );
+            RegionCommonChanMaskCopy( RegionNvmCtx.ChannelsMask, RegionNvmCtx.ChannelsDefaultMask, CHANNELS_MASK_SIZE );
             break;
         }
         case INIT_TYPE_RESET_TO_DEFAULT_CHANNELS:
@@ -404,14 +395,15 @@ void RegionCN470InitDefaults( InitDefaultsParams_t* params )
         case INIT_TYPE_ACTIVATE_DEFAULT_CHANNELS:
         {
             // Copy channels default mask
-            RegionCommonChanMaskCopy( NvmCtx.ChannelsMask, NvmCtx.ChannelsDefaultMask, CHANNELS_MASK_SIZE );
+            RegionCommonChanMaskCopy( RegionNvmCtx.ChannelsMask, RegionNvmCtx.ChannelsDefaultMask, CHANNELS_MASK_SIZE );
             break;
         }
         case INIT_TYPE_RESTORE_CTX:
         {
             if( params->NvmCtx != 0 )
             {
-                memcpy1( (uint8_t*) &NvmCtx, (uint8_t*) params->NvmCtx, sizeof( NvmCtx ) );
+                memcpy1( (uint8_t*) &RegionNvmCtx, (uint8_t*) params->NvmCtx, sizeof( RegionNvmCtx ) );
+                RegionCommonChannelsBitmapInit( &ChannelsBitmap, RegionNvmCtx.Channels, CN470_MAX_NB_CHANNELS );
             }
             break;
         }
@@ -425,7 +417,7 @@ void RegionCN470InitDefaults( InitDefaultsParams_t* params )
 void* RegionCN470GetNvmCtx( GetNvmCtxParams_t* params )
 {
     params->nvmCtxSize = sizeof( RegionCN470NvmCtx_t );
-    return &NvmCtx;
+    return &RegionNvmCtx;
 }
 
 bool RegionCN470Verify( VerifyParams_t* verify, PhyAttribute_t phyAttribute )
@@ -477,8 +469,8 @@ void RegionCN470ApplyCFList( ApplyCFListParams_t* applyCFList )
     // ChMask0 - ChMask5 must be set (every ChMask has 16 bit)
     for( uint8_t chMaskItr = 0, cntPayload = 0; chMaskItr <= 5; chMaskItr++, cntPayload+=2 )
     {
-        NvmCtx.ChannelsMask[chMaskItr] = (uint16_t) (0x00FF & applyCFList->Payload[cntPayload]);
-        NvmCtx.ChannelsMask[chMaskItr] |= (uint16_t) (applyCFList->Payload[cntPayload+1] << 8);
+        RegionNvmCtx.ChannelsMask[chMaskItr] = (uint16_t) (0x00FF & applyCFList->Payload[cntPayload]);
+        RegionNvmCtx.ChannelsMask[chMaskItr] |= (uint16_t) (applyCFList->Payload[cntPayload+1] << 8);
     }
 }
 
@@ -488,12 +480,12 @@ bool RegionCN470ChanMaskSet( ChanMaskSetParams_t* chanMaskSet )
     {
         case CHANNELS_MASK:
         {
-            RegionCommonChanMaskCopy( NvmCtx.ChannelsMask, chanMaskSet->ChannelsMaskIn, 6 );
+            RegionCommonChanMaskCopy( RegionNvmCtx.ChannelsMask, chanMaskSet->ChannelsMaskIn, 6 );
             break;
         }
         case CHANNELS_DEFAULT_MASK:
         {
-            RegionCommonChanMaskCopy( NvmCtx.ChannelsDefaultMask, chanMaskSet->ChannelsMaskIn, 6 );
+            RegionCommonChanMaskCopy( RegionNvmCtx.ChannelsDefaultMask, chanMaskSet->ChannelsMaskIn, 6 );
             break;
         }
         default:
@@ -563,24 +555,24 @@ bool RegionCN470RxConfig( RxConfigParams_t* rxConfig, int8_t* datarate )
 bool RegionCN470TxConfig( TxConfigParams_t* txConfig, int8_t* txPower, TimerTime_t* txTimeOnAir )
 {
     int8_t phyDr = DataratesCN470[txConfig->Datarate];
-    int8_t txPowerLimited = LimitTxPower( txConfig->TxPower, NvmCtx.Bands[NvmCtx.Channels[txConfig->Channel].Band].TxMaxPower, txConfig->Datarate, NvmCtx.ChannelsMask );
+    int8_t txPowerLimited = LimitTxPower( txConfig->TxPower, RegionNvmCtx.Bands[RegionNvmCtx.Channels[txConfig->Channel].Band].TxMaxPower, txConfig->Datarate, RegionNvmCtx.ChannelsMask );
     int8_t phyTxPower = 0;
 
     // Calculate physical TX power
-    phyTxPower = RegionCommonComputeTxPower( txPowerLimited, txConfig->MaxEirp, txConfig->AntennaGain );
+    phyTxPower = RegionCommonComputeTxPower( txPowerLimited, txConfig->MaxEirpQ8, txConfig->AntennaGainQ8 );
 
     // Setup the radio frequency
-    Radio.SetChannel( NvmCtx.Channels[txConfig->Channel].Frequency );
+    Radio.SetChannel( RegionNvmCtx.Channels[txConfig->Channel].Frequency );
 
     Radio.SetTxConfig( MODEM_LORA, phyTxPower, 0, 0, phyDr, 1, 8, false, true, 0, 0, false, 4000 );
     /* ST_WORKAROUND_BEGIN: Print Tx config */
-    RegionCommonTxConfigPrint(NvmCtx.Channels[txConfig->Channel].Frequency, txConfig->Datarate);
+    RegionCommonTxConfigPrint(RegionNvmCtx.Channels[txConfig->Channel].Frequency, txConfig->Datarate);
     /* ST_WORKAROUND_END */
 
     // Setup maximum payload length of the radio driver
     Radio.SetMaxPayloadLength( MODEM_LORA, txConfig->PktLen );
     // Update time-on-air
-    *txTimeOnAir = GetTimeOnAir( txConfig->Datarate, txConfig->PktLen );
+    *txTimeOnAir = RegionCommonGetTimeOnAir( GetTimeOnAir, txConfig->Datarate, txConfig->PktLen );
     *txPower = txPowerLimited;
 
     return true;
@@ -598,7 +590,7 @@ uint8_t RegionCN470LinkAdrReq( LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, in
     RegionCommonLinkAdrReqVerifyParams_t linkAdrVerifyParams;
 
     // Initialize local copy of channels mask
-    RegionCommonChanMaskCopy( channelsMask, NvmCtx.ChannelsMask, 6 );
+    RegionCommonChanMaskCopy( channelsMask, RegionNvmCtx.ChannelsMask, 6 );
 
     while( bytesProcessed < linkAdrReq->PayloadSize )
     {
@@ -633,7 +625,7 @@ uint8_t RegionCN470LinkAdrReq( LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, in
             for( uint8_t i = 0; i < 16; i++ )
             {
                 if( ( ( linkAdrParams.ChMask & ( 1 << i ) ) != 0 ) &&
-                    ( NvmCtx.Channels[linkAdrParams.ChMaskCtrl * 16 + i].Frequency == 0 ) )
+                    ( RegionNvmCtx.Channels[linkAdrParams.ChMaskCtrl * 16 + i].Frequency == 0 ) )
                 {// Trying to enable an undefined channel
                     status &= 0xFE; // Channel mask KO
                 }
@@ -659,7 +651,7 @@ uint8_t RegionCN470LinkAdrReq( LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, in
     linkAdrVerifyParams.ChannelsMask = channelsMask;
     linkAdrVerifyParams.MinDatarate = ( int8_t )phyParam.Value;
     linkAdrVerifyParams.MaxDatarate = CN470_TX_MAX_DATARATE;
-    linkAdrVerifyParams.Channels = NvmCtx.Channels;
+    linkAdrVerifyParams.Channels = RegionNvmCtx.Channels;
     linkAdrVerifyParams.MinTxPower = CN470_MIN_TX_POWER;
     linkAdrVerifyParams.MaxTxPower = CN470_MAX_TX_POWER;
     linkAdrVerifyParams.Version = linkAdrReq->Version;
@@ -671,7 +663,7 @@ uint8_t RegionCN470LinkAdrReq( LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, in
     if( status == 0x07 )
     {
         // Copy Mask
-        RegionCommonChanMaskCopy( NvmCtx.ChannelsMask, channelsMask, 6 );
+        RegionCommonChanMaskCopy( RegionNvmCtx.ChannelsMask, channelsMask, 6 );
     }
 
     // Update status variables
@@ -733,28 +725,28 @@ LoRaMacStatus_t RegionCN470NextChannel( NextChanParams_t* nextChanParams, uint8_
 {
     uint8_t nbEnabledChannels = 0;
     uint8_t nbRestrictedChannels = 0;
-    uint8_t enabledChannels[CN470_MAX_NB_CHANNELS] = { 0 };
+    uint16_t enabledChannels[REGION_COMMON_CHANNELS_BITMAP_SIZE] = { 0 };
     RegionCommonIdentifyChannelsParam_t identifyChannelsParam;
     RegionCommonCountNbOfEnabledChannelsParams_t countChannelsParams;
     LoRaMacStatus_t status = LORAMAC_STATUS_NO_CHANNEL_FOUND;
 
     // Count 125kHz channels
-    if( RegionCommonCountChannels( NvmCtx.ChannelsMask, 0, 6 ) == 0 )
+    if( RegionCommonCountChannels( RegionNvmCtx.ChannelsMask, 0, 6 ) == 0 )
     { // Reactivate default channels
-        NvmCtx.ChannelsMask[0] = 0xFFFF;
-        NvmCtx.ChannelsMask[1] = 0xFFFF;
-        NvmCtx.ChannelsMask[2] = 0xFFFF;
-        NvmCtx.ChannelsMask[3] = 0xFFFF;
-        NvmCtx.ChannelsMask[4] = 0xFFFF;
-        NvmCtx.ChannelsMask[5] = 0xFFFF;
+        RegionNvmCtx.ChannelsMask[0] = 0xFFFF;
+        RegionNvmCtx.ChannelsMask[1] = 0xFFFF;
+        RegionNvmCtx.ChannelsMask[2] = 0xFFFF;
+        RegionNvmCtx.ChannelsMask[3] = 0xFFFF;
+        RegionNvmCtx.ChannelsMask[4] = 0xFFFF;
+        RegionNvmCtx.ChannelsMask[5] = 0xFFFF;
     }
 
     // Search how many channels are enabled
     countChannelsParams.Joined = nextChanParams->Joined;
     countChannelsParams.Datarate = nextChanParams->Datarate;
-    countChannelsParams.ChannelsMask = NvmCtx.ChannelsMask;
-    countChannelsParams.Channels = NvmCtx.Channels;
-    countChannelsParams.Bands = NvmCtx.Bands;
+    countChannelsParams.ChannelsMask = RegionNvmCtx.ChannelsMask;
+    countChannelsParams.Channels = RegionNvmCtx.Channels;
+    countChannelsParams.Bands = RegionNvmCtx.Bands;
     countChannelsParams.MaxNbChannels = CN470_MAX_NB_CHANNELS;
     countChannelsParams.JoinChannels = 0;
 
@@ -765,17 +757,17 @@ LoRaMacStatus_t RegionCN470NextChannel( NextChanParams_t* nextChanParams, uint8_
 
     identifyChannelsParam.ElapsedTimeSinceStartUp = nextChanParams->ElapsedTimeSinceStartUp;
     identifyChannelsParam.LastTxIsJoinRequest = nextChanParams->LastTxIsJoinRequest;
-    identifyChannelsParam.ExpectedTimeOnAir = GetTimeOnAir( nextChanParams->Datarate, nextChanParams->PktLen );
+    identifyChannelsParam.ExpectedTimeOnAir = RegionCommonGetTimeOnAir( GetTimeOnAir, nextChanParams->Datarate, nextChanParams->PktLen );
 
     identifyChannelsParam.CountNbOfEnabledChannelsParam = &countChannelsParams;
 
-    status = RegionCommonIdentifyChannels( &identifyChannelsParam, aggregatedTimeOff, enabledChannels,
-                                           &nbEnabledChannels, &nbRestrictedChannels, time );
+    status = RegionCommonIdentifyChannelsBitmap( &identifyChannelsParam, &ChannelsBitmap, aggregatedTimeOff, enabledChannels,
+                                                 &nbEnabledChannels, &nbRestrictedChannels, time );
 
     if( status == LORAMAC_STATUS_OK )
     {
         // We found a valid channel
-        *channel = enabledChannels[randr( 0, nbEnabledChannels - 1 )];
+        *channel = RegionCommonChannelsBitmapSelect( enabledChannels, randr( 0, nbEnabledChannels - 1 ) );
     }
     return status;
 }
@@ -792,12 +784,12 @@ bool RegionCN470ChannelsRemove( ChannelRemoveParams_t* channelRemove  )
 
 void RegionCN470SetContinuousWave( ContinuousWaveParams_t* continuousWave )
 {
-    int8_t txPowerLimited = LimitTxPower( continuousWave->TxPower, NvmCtx.Bands[NvmCtx.Channels[continuousWave->Channel].Band].TxMaxPower, continuousWave->Datarate, NvmCtx.ChannelsMask );
+    int8_t txPowerLimited = LimitTxPower( continuousWave->TxPower, RegionNvmCtx.Bands[RegionNvmCtx.Channels[continuousWave->Channel].Band].TxMaxPower, continuousWave->Datarate, RegionNvmCtx.ChannelsMask );
     int8_t phyTxPower = 0;
-    uint32_t frequency = NvmCtx.Channels[continuousWave->Channel].Frequency;
+    uint32_t frequency = RegionNvmCtx.Channels[continuousWave->Channel].Frequency;
 
     // Calculate physical TX power
-    phyTxPower = RegionCommonComputeTxPower( txPowerLimited, continuousWave->MaxEirp, continuousWave->AntennaGain );
+    phyTxPower = RegionCommonComputeTxPower( txPowerLimited, continuousWave->MaxEirpQ8, continuousWave->AntennaGainQ8 );
 
     Radio.SetTxContinuousWave( frequency, phyTxPower, continuousWave->Timeout );
 }
@@ -830,3 +822,5 @@ void RegionCN470RxBeaconSetup( RxBeaconSetup_t* rxBeaconSetup, uint8_t* outDr )
     // Store downlink datarate
     *outDr = CN470_BEACON_CHANNEL_DR;
 }
+
+#endif /* REGION_CN470 */
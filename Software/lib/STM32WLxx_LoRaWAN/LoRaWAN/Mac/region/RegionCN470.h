@@ -283,6 +283,34 @@ static const uint8_t MaxPayloadOfDatarateCN470[] = { 51, 51, 51, 115, 242, 242 }
  */
 static const uint8_t MaxPayloadOfDatarateRepeaterCN470[] = { 51, 51, 51, 115, 222, 222 };
 
+/*!
+ * Size of the channels mask
+ */
+#define CN470_CHANNELS_MASK_SIZE            6
+
+/*!
+ * Region specific context
+ */
+typedef struct sRegionCN470NvmCtx
+{
+    /*!
+     * LoRaMAC channels
+     */
+    ChannelParams_t Channels[ CN470_MAX_NB_CHANNELS ];
+    /*!
+     * LoRaMac bands
+     */
+    Band_t Bands[ CN470_MAX_NB_BANDS ];
+    /*!
+     * LoRaMac channels mask
+     */
+    uint16_t ChannelsMask[ CN470_CHANNELS_MASK_SIZE ];
+    /*!
+     * LoRaMac channels default mask
+     */
+    uint16_t ChannelsDefaultMask[ CN470_CHANNELS_MASK_SIZE ];
+}RegionCN470NvmCtx_t;
+
 /*!
  * \brief The function gets a value of a specific phy attribute.
  *
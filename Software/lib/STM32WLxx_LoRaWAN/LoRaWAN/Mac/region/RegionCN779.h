@@ -292,6 +292,34 @@ static const uint8_t MaxPayloadOfDatarateCN779[] = { 51, 51, 51, 115, 242, 242,
  */
 static const uint8_t MaxPayloadOfDatarateRepeaterCN779[] = { 51, 51, 51, 115, 222, 222, 222, 222 };
 
+/*!
+ * Size of the channels mask
+ */
+#define CN779_CHANNELS_MASK_SIZE            1
+
+/*!
+ * Region specific context
+ */
+typedef struct sRegionCN779NvmCtx
+{
+    /*!
+     * LoRaMAC channels
+     */
+    ChannelParams_t Channels[ CN779_MAX_NB_CHANNELS ];
+    /*!
+     * LoRaMac bands
+     */
+    Band_t Bands[ CN779_MAX_NB_BANDS ];
+    /*!
+     * LoRaMac channels mask
+     */
+    uint16_t ChannelsMask[ CN779_CHANNELS_MASK_SIZE ];
+    /*!
+     * LoRaMac channels default mask
+     */
+    uint16_t ChannelsDefaultMask[ CN779_CHANNELS_MASK_SIZE ];
+}RegionCN779NvmCtx_t;
+
 /*!
  * \brief The function gets a value of a specific phy attribute.
  *
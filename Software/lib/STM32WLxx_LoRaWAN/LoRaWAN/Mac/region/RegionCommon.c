@@ -28,8 +28,9 @@
  *
  * \author    Daniel Jaeckle ( STACKFORCE )
  */
-#include <math.h>
+#include "utilities.h"
 #include "RegionCommon.h"
+#include "LoRaMacInstance.h"
 #include "GNSE_tracer.h"
 
 #define BACKOFF_DC_1_HOUR                   100
@@ -44,6 +45,11 @@
 #define DUTY_CYCLE_TIME_PERIOD              3600000
 #endif
 
+/*!
+ * Time-on-air table of the current LoRaMac instance
+ */
+#define TimeOnAirTable                      ( LoRaMacCurrentInstance->TimeOnAirTable )
+
 static uint16_t GetDutyCycle( Band_t* band, bool joined, SysTime_t elapsedTimeSinceStartup )
 {
     uint16_t joinDutyCycle = RegionCommonGetJoinDc( elapsedTimeSinceStartup );
@@ -137,16 +143,18 @@ static uint16_t UpdateTimeCredits( Band_t* band, bool joined, bool dutyCycleEnab
 
 static uint8_t CountChannels( uint16_t mask, uint8_t nbBits )
 {
-    uint8_t nbActiveBits = 0;
+    uint32_t bits = mask;
 
-    for( uint8_t j = 0; j < nbBits; j++ )
+    if( nbBits < 16 )
     {
-        if( ( mask & ( 1 << j ) ) == ( 1 << j ) )
-        {
-            nbActiveBits++;
-        }
+        bits &= ( 1UL << nbBits ) - 1;
     }
-    return nbActiveBits;
+
+    // Population count of the 16 bits
+    bits = bits - ( ( bits >> 1 ) & 0x5555 );
+    bits = ( bits & 0x3333 ) + ( ( bits >> 2 ) & 0x3333 );
+    bits = ( bits + ( bits >> 4 ) ) & 0x0F0F;
+    return ( uint8_t )( ( bits + ( bits >> 8 ) ) & 0x1F );
 }
 
 uint16_t RegionCommonGetJoinDc( SysTime_t elapsedTime )
@@ -421,6 +429,72 @@ uint32_t RegionCommonComputeSymbolTimeFsk( uint8_t phyDr )
     return 160000UL;
 }
 
+void RegionCommonTimeOnAirTableInit( RegionCommonTimeOnAirFormula_t formula, uint16_t datarateMask )
+{
+    uint16_t count = 0;
+
+    TimeOnAirTable.Formula = NULL;
+    for( int8_t dr = DR_0; dr <= DR_15; dr++ )
+    {
+        uint16_t first = count;
+
+        TimeOnAirTable.First[dr] = first;
+        if( ( datarateMask & ( 1 << dr ) ) == 0 )
+        {
+            continue;
+        }
+        for( uint16_t pktLen = 0; pktLen <= UINT8_MAX; pktLen++ )
+        {
+            TimerTime_t timeOnAir = formula( dr, pktLen );
+
+            if( ( pktLen > 0 ) && ( timeOnAir == TimeOnAirTable.StepTimeOnAir[count - 1] ) )
+            {
+                continue;
+            }
+            if( ( count >= REGION_COMMON_TOA_TABLE_STEPS ) || ( timeOnAir > UINT16_MAX ) )
+            {
+                // The datarate does not fit, it uses the formula
+                count = first;
+                break;
+            }
+            TimeOnAirTable.StepLength[count] = pktLen;
+            TimeOnAirTable.StepTimeOnAir[count] = timeOnAir;
+            count++;
+        }
+    }
+    TimeOnAirTable.First[DR_15 + 1] = count;
+    TimeOnAirTable.Formula = formula;
+}
+
+TimerTime_t RegionCommonGetTimeOnAir( RegionCommonTimeOnAirFormula_t formula, int8_t datarate, uint16_t pktLen )
+{
+    if( ( formula == TimeOnAirTable.Formula ) && ( datarate >= DR_0 ) && ( datarate <= DR_15 ) && ( pktLen <= UINT8_MAX ) )
+    {
+        uint16_t low = TimeOnAirTable.First[datarate];
+        uint16_t high = TimeOnAirTable.First[datarate + 1];
+
+        if( low < high )
+        {
+            // Last entry starting at or before pktLen, the first entry starts at 0
+            while( ( high - low ) > 1 )
+            {
+                uint16_t mid = ( low + high ) >> 1;
+
+                if( TimeOnAirTable.StepLength[mid] <= pktLen )
+                {
+                    low = mid;
+                }
+                else
+                {
+                    high = mid;
+                }
+            }
+            return TimeOnAirTable.StepTimeOnAir[low];
+        }
+    }
+    return formula( datarate, pktLen );
+}
+
 void RegionCommonComputeRxWindowParameters( uint32_t tSymbol, uint8_t minRxSymbols, uint32_t rxError, uint32_t wakeUpTime, uint32_t* windowTimeout, int32_t* windowOffset )
 {
   *windowTimeout = MAX( (uint32_t)2 * minRxSymbols - 8 + DIVC(2 * rxError * 1000000UL, tSymbol ), minRxSymbols);
@@ -428,11 +502,13 @@ void RegionCommonComputeRxWindowParameters( uint32_t tSymbol, uint8_t minRxSymbo
 }
 /* ST_WORKAROUND_END */
 
-int8_t RegionCommonComputeTxPower( int8_t txPowerIndex, float maxEirp, float antennaGain )
+int8_t RegionCommonComputeTxPower( int8_t txPowerIndex, int16_t maxEirp, int16_t antennaGain )
 {
     int8_t phyTxPower = 0;
+    int32_t txPower = ( int32_t )maxEirp - ( ( int32_t )txPowerIndex * 2 << LORAMAC_DB_Q_BITS ) - antennaGain;
 
-    phyTxPower = ( int8_t )floor( ( maxEirp - ( txPowerIndex * 2U ) ) - antennaGain );
+    // Q8.8 to dBm, the arithmetic shift rounds down like floor( )
+    phyTxPower = ( int8_t )( txPower >> LORAMAC_DB_Q_BITS );
 
     return phyTxPower;
 }
@@ -510,15 +586,16 @@ void RegionCommonCountNbOfEnabledChannels( RegionCommonCountNbOfEnabledChannelsP
     *nbRestrictedChannels = nbRestrictedChannelsCount;
 }
 
-LoRaMacStatus_t RegionCommonIdentifyChannels( RegionCommonIdentifyChannelsParam_t* identifyChannelsParam,
-                                              TimerTime_t* aggregatedTimeOff, uint8_t* enabledChannels,
-                                              uint8_t* nbEnabledChannels, uint8_t* nbRestrictedChannels,
-                                              TimerTime_t* nextTxDelay )
+/*!
+ * \brief Updates the time-off of the bands once the aggregated time-off is over.
+ *
+ * \retval Returns true if the bands were updated and the channels must be counted.
+ */
+static bool UpdateIdentifyChannelsTimeOff( RegionCommonIdentifyChannelsParam_t* identifyChannelsParam,
+                                           TimerTime_t* aggregatedTimeOff, TimerTime_t* nextTxDelay )
 {
     TimerTime_t elapsed = TimerGetElapsedTime( identifyChannelsParam->LastAggrTx );
     *nextTxDelay = identifyChannelsParam->AggrTimeOff - elapsed;
-    *nbRestrictedChannels = 1;
-    *nbEnabledChannels = 0;
 
     if( ( identifyChannelsParam->LastAggrTx == 0 ) ||
         ( identifyChannelsParam->AggrTimeOff <= elapsed ) )
@@ -534,17 +611,20 @@ LoRaMacStatus_t RegionCommonIdentifyChannels( RegionCommonIdentifyChannelsParam_
                                                       identifyChannelsParam->LastTxIsJoinRequest,
                                                       identifyChannelsParam->ElapsedTimeSinceStartUp,
                                                       identifyChannelsParam->ExpectedTimeOnAir );
-
-        RegionCommonCountNbOfEnabledChannels( identifyChannelsParam->CountNbOfEnabledChannelsParam, enabledChannels,
-                                              nbEnabledChannels, nbRestrictedChannels );
+        return true;
     }
+    return false;
+}
 
-    if( *nbEnabledChannels > 0 )
+static LoRaMacStatus_t GetIdentifyChannelsStatus( uint8_t nbEnabledChannels, uint8_t nbRestrictedChannels,
+                                                  TimerTime_t* nextTxDelay )
+{
+    if( nbEnabledChannels > 0 )
     {
         *nextTxDelay = 0;
         return LORAMAC_STATUS_OK;
     }
-    else if( *nbRestrictedChannels > 0 )
+    else if( nbRestrictedChannels > 0 )
     {
         return LORAMAC_STATUS_DUTYCYCLE_RESTRICTED;
     }
@@ -554,6 +634,120 @@ LoRaMacStatus_t RegionCommonIdentifyChannels( RegionCommonIdentifyChannelsParam_
     }
 }
 
+LoRaMacStatus_t RegionCommonIdentifyChannels( RegionCommonIdentifyChannelsParam_t* identifyChannelsParam,
+                                              TimerTime_t* aggregatedTimeOff, uint8_t* enabledChannels,
+                                              uint8_t* nbEnabledChannels, uint8_t* nbRestrictedChannels,
+                                              TimerTime_t* nextTxDelay )
+{
+    *nbRestrictedChannels = 1;
+    *nbEnabledChannels = 0;
+
+    if( UpdateIdentifyChannelsTimeOff( identifyChannelsParam, aggregatedTimeOff, nextTxDelay ) == true )
+    {
+        RegionCommonCountNbOfEnabledChannels( identifyChannelsParam->CountNbOfEnabledChannelsParam, enabledChannels,
+                                              nbEnabledChannels, nbRestrictedChannels );
+    }
+
+    return GetIdentifyChannelsStatus( *nbEnabledChannels, *nbRestrictedChannels, nextTxDelay );
+}
+
+void RegionCommonChannelsBitmapInit( RegionCommonChannelsBitmap_t* channelsBitmap, ChannelParams_t* channels, uint8_t maxNbChannels )
+{
+    memset1( ( uint8_t* )channelsBitmap, 0, sizeof( RegionCommonChannelsBitmap_t ) );
+
+    for( uint8_t i = 0; ( i < maxNbChannels ) && ( i < ( 16 * REGION_COMMON_CHANNELS_BITMAP_SIZE ) ); i++ )
+    {
+        uint16_t bit = 1 << ( i % 16 );
+
+        if( ( channels[i].Frequency == 0 ) || ( channels[i].Band >= REGION_COMMON_CHANNELS_BITMAP_BANDS ) )
+        {
+            continue;
+        }
+        channelsBitmap->Bands[channels[i].Band][i / 16] |= bit;
+
+        for( uint8_t dr = 0; dr < REGION_COMMON_CHANNELS_BITMAP_DATARATES; dr++ )
+        {
+            if( RegionCommonValueInRange( dr, channels[i].DrRange.Fields.Min, channels[i].DrRange.Fields.Max ) == 1 )
+            {
+                channelsBitmap->Datarates[dr][i / 16] |= bit;
+            }
+        }
+    }
+}
+
+void RegionCommonCountNbOfEnabledChannelsBitmap( RegionCommonCountNbOfEnabledChannelsParams_t* countNbOfEnabledChannelsParams,
+                                                 RegionCommonChannelsBitmap_t* channelsBitmap, uint16_t* enabledChannels,
+                                                 uint8_t* nbEnabledChannels, uint8_t* nbRestrictedChannels )
+{
+    uint8_t nbChannelCount = 0;
+    uint8_t nbRestrictedChannelsCount = 0;
+    uint8_t datarate = countNbOfEnabledChannelsParams->Datarate;
+    uint8_t nbWords = ( countNbOfEnabledChannelsParams->MaxNbChannels + 15 ) / 16;
+
+    for( uint8_t k = 0; k < REGION_COMMON_CHANNELS_BITMAP_SIZE; k++ )
+    {
+        uint16_t ready = 0;
+        uint16_t channels = 0;
+
+        if( ( k < nbWords ) && ( datarate < REGION_COMMON_CHANNELS_BITMAP_DATARATES ) )
+        {
+            channels = countNbOfEnabledChannelsParams->ChannelsMask[k] & channelsBitmap->Datarates[datarate][k];
+        }
+        for( uint8_t band = 0; band < REGION_COMMON_CHANNELS_BITMAP_BANDS; band++ )
+        {
+            if( countNbOfEnabledChannelsParams->Bands[band].ReadyForTransmission == true )
+            {
+                ready |= channelsBitmap->Bands[band][k];
+            }
+        }
+
+        enabledChannels[k] = channels & ready;
+        nbChannelCount += CountChannels( channels & ready, 16 );
+        nbRestrictedChannelsCount += CountChannels( channels & ~ready, 16 );
+    }
+    *nbEnabledChannels = nbChannelCount;
+    *nbRestrictedChannels = nbRestrictedChannelsCount;
+}
+
+LoRaMacStatus_t RegionCommonIdentifyChannelsBitmap( RegionCommonIdentifyChannelsParam_t* identifyChannelsParam,
+                                                    RegionCommonChannelsBitmap_t* channelsBitmap,
+                                                    TimerTime_t* aggregatedTimeOff, uint16_t* enabledChannels,
+                                                    uint8_t* nbEnabledChannels, uint8_t* nbRestrictedChannels,
+                                                    TimerTime_t* nextTxDelay )
+{
+    *nbRestrictedChannels = 1;
+    *nbEnabledChannels = 0;
+
+    if( UpdateIdentifyChannelsTimeOff( identifyChannelsParam, aggregatedTimeOff, nextTxDelay ) == true )
+    {
+        RegionCommonCountNbOfEnabledChannelsBitmap( identifyChannelsParam->CountNbOfEnabledChannelsParam, channelsBitmap,
+                                                    enabledChannels, nbEnabledChannels, nbRestrictedChannels );
+    }
+
+    return GetIdentifyChannelsStatus( *nbEnabledChannels, *nbRestrictedChannels, nextTxDelay );
+}
+
+uint8_t RegionCommonChannelsBitmapSelect( uint16_t* channelsMask, uint8_t n )
+{
+    for( uint8_t k = 0; k < REGION_COMMON_CHANNELS_BITMAP_SIZE; k++ )
+    {
+        uint16_t mask = channelsMask[k];
+        uint8_t count = CountChannels( mask, 16 );
+
+        if( n < count )
+        {
+            // Clear the n lowest channels, the channel is the lowest remaining bit
+            while( n-- > 0 )
+            {
+                mask &= mask - 1;
+            }
+            return ( k * 16 ) + CountChannels( ( uint16_t )( ( mask & -mask ) - 1 ), 16 );
+        }
+        n -= count;
+    }
+    return 0;
+}
+
 void RegionCommonRxConfigPrint(LoRaMacRxSlot_t rxSlot, uint32_t frequency, int8_t dr)
 {
     const char *slotStrings[] = { "1", "2", "C", "Multi_C", "P", "Multi_P" };
@@ -54,6 +54,46 @@ extern "C"
  */
 #define REGION_COMMON_DEFAULT_PING_SLOT_PERIODICITY     7
 
+#ifndef REGION_COMMON_TOA_TABLE_STEPS
+/*!
+ * Number of entries of the time-on-air table, each entry takes 3 bytes of RAM.
+ * 512 covers all datarates of the EU868 like regions. Datarates which do not fit
+ * use the time-on-air formula.
+ */
+#define REGION_COMMON_TOA_TABLE_STEPS                   512
+#endif
+
+/*!
+ * Bit mask of the datarates from minDr to maxDr, for RegionCommonTimeOnAirTableInit
+ */
+#define REGION_COMMON_DATARATE_MASK( minDr, maxDr )     ( ( uint16_t )( ( 2UL << ( maxDr ) ) - ( 1UL << ( minDr ) ) ) )
+
+/*!
+ * Number of channels mask words of RegionCommonChannelsBitmap_t, 96 channels for CN470
+ */
+#define REGION_COMMON_CHANNELS_BITMAP_SIZE              6
+
+/*!
+ * Number of uplink datarates of RegionCommonChannelsBitmap_t
+ */
+#define REGION_COMMON_CHANNELS_BITMAP_DATARATES         8
+
+/*!
+ * Number of bands of RegionCommonChannelsBitmap_t, the regions using it have a single band
+ */
+#define REGION_COMMON_CHANNELS_BITMAP_BANDS             1
+
+/*!
+ * \brief Computes the time-on-air of a frame with the radio formula.
+ *
+ * \param [IN] datarate Region datarate.
+ *
+ * \param [IN] pktLen PHY payload length in bytes.
+ *
+ * \retval Time-on-air in ms.
+ */
+typedef TimerTime_t ( *RegionCommonTimeOnAirFormula_t )( int8_t datarate, uint16_t pktLen );
+
 typedef struct sRegionCommonLinkAdrParams
 {
     /*!
@@ -246,6 +286,22 @@ typedef struct sRegionCommonIdentifyChannelsParam
     RegionCommonCountNbOfEnabledChannelsParams_t* CountNbOfEnabledChannelsParam;
 }RegionCommonIdentifyChannelsParam_t;
 
+/*!
+ * Channels of a region as channels masks, for the regions with fixed channel plans
+ * which select the uplink channel with RegionCommonIdentifyChannelsBitmap
+ */
+typedef struct sRegionCommonChannelsBitmap
+{
+    /*!
+     * Channels which have a frequency and support the datarate, one mask per datarate
+     */
+    uint16_t Datarates[REGION_COMMON_CHANNELS_BITMAP_DATARATES][REGION_COMMON_CHANNELS_BITMAP_SIZE];
+    /*!
+     * Channels of each band
+     */
+    uint16_t Bands[REGION_COMMON_CHANNELS_BITMAP_BANDS][REGION_COMMON_CHANNELS_BITMAP_SIZE];
+}RegionCommonChannelsBitmap_t;
+
 typedef struct sRegionCommonSetDutyCycleParams
 {
     /*!
@@ -438,6 +494,33 @@ uint32_t RegionCommonComputeSymbolTimeLoRa( uint8_t phyDr, uint32_t bandwidth );
  */
 uint32_t RegionCommonComputeSymbolTimeFsk( uint8_t phyDr );
 
+/*!
+ * \brief Generates the time-on-air table of a region from its radio formula.
+ *        The table holds one entry per change of the time-on-air for payload lengths
+ *        from 0 to 255 bytes, so it matches the formula for every entry.
+ *        python3 tools/host_test.py toa_table checks it against the datasheet formula.
+ *
+ * \param [IN] formula Time-on-air formula of the region.
+ *
+ * \param [IN] datarateMask Bit mask of the datarates to add to the table.
+ */
+void RegionCommonTimeOnAirTableInit( RegionCommonTimeOnAirFormula_t formula, uint16_t datarateMask );
+
+/*!
+ * \brief Gets the time-on-air of a frame from the time-on-air table.
+ *        Falls back to the formula if the table was generated for another formula,
+ *        or does not hold the datarate or the payload length.
+ *
+ * \param [IN] formula Time-on-air formula of the region.
+ *
+ * \param [IN] datarate Region datarate.
+ *
+ * \param [IN] pktLen PHY payload length in bytes.
+ *
+ * \retval Time-on-air in ms.
+ */
+TimerTime_t RegionCommonGetTimeOnAir( RegionCommonTimeOnAirFormula_t formula, int8_t datarate, uint16_t pktLen );
+
 /*!
  * \brief Computes the RX window timeout and the RX window offset.
  *
@@ -464,14 +547,14 @@ void RegionCommonComputeRxWindowParameters( uint32_t tSymbol, uint8_t minRxSymbo
  *
  * \param [IN] txPower TX power index.
  *
- * \param [IN] maxEirp Maximum EIRP.
+ * \param [IN] maxEirp Maximum EIRP. Value is in dBm, Q8.8.
  *
  * \param [IN] antennaGain Antenna gain. Referenced to the isotropic antenna.
- *                         Value is in dBi. ( antennaGain[dBi] = measuredAntennaGain[dBd] + 2.15 )
+ *                         Value is in dBi, Q8.8. ( antennaGain[dBi] = measuredAntennaGain[dBd] + 2.15 )
  *
  * \retval Returns the physical TX power.
  */
-int8_t RegionCommonComputeTxPower( int8_t txPowerIndex, float maxEirp, float antennaGain );
+int8_t RegionCommonComputeTxPower( int8_t txPowerIndex, int16_t maxEirp, int16_t antennaGain );
 
 /*!
  * \brief Sets up the radio into RX beacon mode.
@@ -522,6 +605,83 @@ LoRaMacStatus_t RegionCommonIdentifyChannels( RegionCommonIdentifyChannelsParam_
                                               uint8_t* nbEnabledChannels, uint8_t* nbRestrictedChannels,
                                               TimerTime_t* nextTxDelay );
 
+/*!
+ * \brief Builds the channels bitmap of a region. Must be called when the
+ *        channels of the region change. Channels of bands beyond
+ *        REGION_COMMON_CHANNELS_BITMAP_BANDS are left out.
+ *
+ * \param [OUT] channelsBitmap Channels bitmap to build.
+ *
+ * \param [IN] channels The channels of the region.
+ *
+ * \param [IN] maxNbChannels Number of channels, up to 16 * REGION_COMMON_CHANNELS_BITMAP_SIZE.
+ */
+void RegionCommonChannelsBitmapInit( RegionCommonChannelsBitmap_t* channelsBitmap, ChannelParams_t* channels, uint8_t maxNbChannels );
+
+/*!
+ * \brief Counts the number of enabled channels with the channels bitmap.
+ *        Same as RegionCommonCountNbOfEnabledChannels, without JoinChannels support.
+ *        python3 tools/host_test.py channel_bitmap checks them against each other.
+ *
+ * \param [IN] countNbOfEnabledChannelsParams A pointer to the input parameters.
+ *
+ * \param [IN] channelsBitmap Channels bitmap of the region.
+ *
+ * \param [OUT] enabledChannels Channels mask of REGION_COMMON_CHANNELS_BITMAP_SIZE words.
+ *              The function stores the available channels into this mask.
+ *
+ * \param [OUT] nbEnabledChannels The number of available channels found.
+ *
+ * \param [OUT] nbRestrictedChannels It contains the number of channel
+ *                      which are available, but restricted due to duty cycle.
+ */
+void RegionCommonCountNbOfEnabledChannelsBitmap( RegionCommonCountNbOfEnabledChannelsParams_t* countNbOfEnabledChannelsParams,
+                                                 RegionCommonChannelsBitmap_t* channelsBitmap, uint16_t* enabledChannels,
+                                                 uint8_t* nbEnabledChannels, uint8_t* nbRestrictedChannels );
+
+/*!
+ * \brief Identifies all channels which are available currently with the channels bitmap.
+ *        Same as RegionCommonIdentifyChannels, the channel is picked with
+ *        RegionCommonChannelsBitmapSelect.
+ *
+ * \param [IN] identifyChannelsParam A pointer to the input parameters.
+ *
+ * \param [IN] channelsBitmap Channels bitmap of the region.
+ *
+ * \param [OUT] aggregatedTimeOff The new value of the aggregatedTimeOff. The function
+ *                                may resets it to 0.
+ *
+ * \param [OUT] enabledChannels Channels mask of REGION_COMMON_CHANNELS_BITMAP_SIZE words.
+ *              The function stores the available channels into this mask.
+ *
+ * \param [OUT] nbEnabledChannels The number of available channels found.
+ *
+ * \param [OUT] nbRestrictedChannels It contains the number of channel
+ *                      which are available, but restricted due to duty cycle.
+ *
+ * \param [OUT] nextTxDelay Holds the time which has to be waited for the next possible
+ *                          uplink transmission.
+ *
+ *\retval Status of the operation.
+ */
+LoRaMacStatus_t RegionCommonIdentifyChannelsBitmap( RegionCommonIdentifyChannelsParam_t* identifyChannelsParam,
+                                                    RegionCommonChannelsBitmap_t* channelsBitmap,
+                                                    TimerTime_t* aggregatedTimeOff, uint16_t* enabledChannels,
+                                                    uint8_t* nbEnabledChannels, uint8_t* nbRestrictedChannels,
+                                                    TimerTime_t* nextTxDelay );
+
+/*!
+ * \brief Returns the n-th enabled channel of a channels mask, in increasing
+ *        channel order as RegionCommonCountNbOfEnabledChannels lists them.
+ *
+ * \param [IN] channelsMask Channels mask of REGION_COMMON_CHANNELS_BITMAP_SIZE words.
+ *
+ * \param [IN] n Index of the channel, lower than the number of enabled channels.
+ *
+ * \retval Channel number.
+ */
+uint8_t RegionCommonChannelsBitmapSelect( uint16_t* channelsMask, uint8_t n );
+
 /*!
  * \brief Print the current RX configuration
  *
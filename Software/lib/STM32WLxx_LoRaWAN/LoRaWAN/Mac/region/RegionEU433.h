@@ -293,6 +293,34 @@ static const uint8_t MaxPayloadOfDatarateEU433[] = { 51, 51, 51, 115, 242, 242,
  */
 static const uint8_t MaxPayloadOfDatarateRepeaterEU433[] = { 51, 51, 51, 115, 222, 222, 222, 222 };
 
+/*!
+ * Size of the channels mask
+ */
+#define EU433_CHANNELS_MASK_SIZE            1
+
+/*!
+ * Region specific context
+ */
+typedef struct sRegionEU433NvmCtx
+{
+    /*!
+     * LoRaMAC channels
+     */
+    ChannelParams_t Channels[ EU433_MAX_NB_CHANNELS ];
+    /*!
+     * LoRaMac bands
+     */
+    Band_t Bands[ EU433_MAX_NB_BANDS ];
+    /*!
+     * LoRaMac channels mask
+     */
+    uint16_t ChannelsMask[ EU433_CHANNELS_MASK_SIZE ];
+    /*!
+     * LoRaMac channels default mask
+     */
+    uint16_t ChannelsDefaultMask[ EU433_CHANNELS_MASK_SIZE ];
+}RegionEU433NvmCtx_t;
+
 /*!
  * \brief The function gets a value of a specific phy attribute.
  *
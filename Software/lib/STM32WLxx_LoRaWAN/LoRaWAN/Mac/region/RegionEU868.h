@@ -321,6 +321,34 @@ static const uint8_t MaxPayloadOfDatarateEU868[] = { 51, 51, 51, 115, 242, 242,
  */
 static const uint8_t MaxPayloadOfDatarateRepeaterEU868[] = { 51, 51, 51, 115, 222, 222, 222, 222 };
 
+/*!
+ * Size of the channels mask
+ */
+#define EU868_CHANNELS_MASK_SIZE            1
+
+/*!
+ * Region specific context
+ */
+typedef struct sRegionEU868NvmCtx
+{
+    /*!
+     * LoRaMAC channels
+     */
+    ChannelParams_t Channels[ EU868_MAX_NB_CHANNELS ];
+    /*!
+     * LoRaMac bands
+     */
+    Band_t Bands[ EU868_MAX_NB_BANDS ];
+    /*!
+     * LoRaMac channels mask
+     */
+    uint16_t ChannelsMask[ EU868_CHANNELS_MASK_SIZE ];
+    /*!
+     * LoRaMac channels default mask
+     */
+    uint16_t ChannelsDefaultMask[ EU868_CHANNELS_MASK_SIZE ];
+}RegionEU868NvmCtx_t;
+
 /*!
  * \brief The function gets a value of a specific phy attribute.
  *
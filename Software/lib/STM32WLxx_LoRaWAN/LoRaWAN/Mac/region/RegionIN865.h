@@ -295,6 +295,34 @@ static const uint8_t MaxPayloadOfDatarateRepeaterIN865[] = { 51, 51, 51, 115, 22
  */
 static const int8_t EffectiveRx1DrOffsetIN865[] = { 0, 1, 2, 3, 4, 5, -1, -2 };
 
+/*!
+ * Size of the channels mask
+ */
+#define IN865_CHANNELS_MASK_SIZE            1
+
+/*!
+ * Region specific context
+ */
+typedef struct sRegionIN865NvmCtx
+{
+    /*!
+     * LoRaMAC channels
+     */
+    ChannelParams_t Channels[ IN865_MAX_NB_CHANNELS ];
+    /*!
+     * LoRaMac bands
+     */
+    Band_t Bands[ IN865_MAX_NB_BANDS ];
+    /*!
+     * LoRaMac channels mask
+     */
+    uint16_t ChannelsMask[ IN865_CHANNELS_MASK_SIZE ];
+    /*!
+     * LoRaMac channels default mask
+     */
+    uint16_t ChannelsDefaultMask[ IN865_CHANNELS_MASK_SIZE ];
+}RegionIN865NvmCtx_t;
+
 /*!
  * \brief The function gets a value of a specific phy attribute.
  *
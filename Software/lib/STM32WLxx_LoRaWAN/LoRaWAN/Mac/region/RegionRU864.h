@@ -283,6 +283,34 @@ static const uint8_t MaxPayloadOfDatarateRU864[] = { 51, 51, 51, 115, 242, 242,
  */
 static const uint8_t MaxPayloadOfDatarateRepeaterRU864[] = { 51, 51, 51, 115, 222, 222, 222, 222 };
 
+/*!
+ * Size of the channels mask
+ */
+#define RU864_CHANNELS_MASK_SIZE            1
+
+/*!
+ * Region specific context
+ */
+typedef struct sRegionRU864NvmCtx
+{
+    /*!
+     * LoRaMAC channels
+     */
+    ChannelParams_t Channels[ RU864_MAX_NB_CHANNELS ];
+    /*!
+     * LoRaMac bands
+     */
+    Band_t Bands[ RU864_MAX_NB_BANDS ];
+    /*!
+     * LoRaMac channels mask
+     */
+    uint16_t ChannelsMask[ RU864_CHANNELS_MASK_SIZE ];
+    /*!
+     * LoRaMac channels default mask
+     */
+    uint16_t ChannelsDefaultMask[ RU864_CHANNELS_MASK_SIZE ];
+}RegionRU864NvmCtx_t;
+
 /*!
  * \brief The function gets a value of a specific phy attribute.
  *
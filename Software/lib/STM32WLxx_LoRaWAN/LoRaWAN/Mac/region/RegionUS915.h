@@ -293,6 +293,46 @@ static const uint8_t MaxPayloadOfDatarateUS915[] = { 11, 53, 125, 242, 242, 0, 0
  */
 static const uint8_t MaxPayloadOfDatarateRepeaterUS915[] = { 11, 53, 125, 242, 242, 0, 0, 0, 33, 109, 222, 222, 222, 222, 0, 0 };
 
+/*!
+ * Size of the channels mask
+ */
+#define US915_CHANNELS_MASK_SIZE            6
+
+/*!
+ * Region specific context
+ */
+typedef struct sRegionUS915NvmCtx
+{
+    /*!
+     * LoRaMAC channels
+     */
+    ChannelParams_t Channels[ US915_MAX_NB_CHANNELS ];
+    /*!
+     * LoRaMac bands
+     */
+    Band_t Bands[ US915_MAX_NB_BANDS ];
+    /*!
+     * LoRaMac channels mask
+     */
+    uint16_t ChannelsMask[ US915_CHANNELS_MASK_SIZE ];
+    /*!
+     * LoRaMac channels remaining
+     */
+    uint16_t ChannelsMaskRemaining[US915_CHANNELS_MASK_SIZE];
+    /*!
+     * LoRaMac channels default mask
+     */
+    uint16_t ChannelsDefaultMask[ US915_CHANNELS_MASK_SIZE ];
+    /*!
+     * Index of current in use 8 bit group (0: bit 0 - 7, 1: bit 8 - 15, ..., 7: bit 56 - 63)
+     */
+    uint8_t JoinChannelGroupsCurrentIndex;
+    /*!
+     * Counter of join trials needed to alternate between DR0 and DR4, see \ref RegionUS915AlternateDr
+     */
+    uint8_t JoinTrialsCounter;
+}RegionUS915NvmCtx_t;
+
 /*!
  * \brief The function gets a value of a specific phy attribute.
  *
@@ -107,6 +107,56 @@ typedef enum eSecureElementStatus
  */
 typedef void ( *SecureElementNvmEvent )( void );
 
+/*!
+ * Number of keys a secure element context holds: the root, session and zero
+ * keys, and the root and session keys of each multicast group
+ */
+#if ( USE_LRWAN_1_1_X_CRYPTO == 1 )
+#define SE_CTX_NB_KEYS          ( 11 + ( 3 * LORAMAC_MAX_MC_CTX ) )
+#else
+#define SE_CTX_NB_KEYS          ( 7 + ( 3 * LORAMAC_MAX_MC_CTX ) )
+#endif
+
+#ifndef SECURE_ELEMENT_CTX_SIZE
+/*!
+ * Size in bytes of the secure element context held by each LoRaMac instance:
+ * the EUIs, the pin, and the keys with their identifiers
+ */
+#define SECURE_ELEMENT_CTX_SIZE ( ( 2 * SE_EUI_SIZE ) + SE_PIN_SIZE + ( SE_CTX_NB_KEYS * ( SE_KEY_SIZE + 4 ) ) )
+#endif
+
+/*!
+ * Secure element context of a LoRaMac instance. A secure element which keeps
+ * its context in the current instance stores it in NvmCtx, and checks that
+ * it fits SECURE_ELEMENT_CTX_SIZE.
+ */
+typedef struct sSecureElementCtx
+{
+    /*!
+     * Non-volatile context of the secure element
+     */
+    uint32_t NvmCtx[( SECURE_ELEMENT_CTX_SIZE + 3 ) / 4];
+    /*!
+     * Callback function called when the non-volatile context has to be stored
+     */
+    SecureElementNvmEvent NvmCtxChanged;
+}SecureElementCtx_t;
+
+/*!
+ * Key derivation of SecureElementDeriveAndStoreKeys
+ */
+typedef struct sSecureElementDerivation
+{
+    /*!
+     * Input data from which the key is derived
+     */
+    uint8_t Input[SE_KEY_SIZE];
+    /*!
+     * Key identifier of the key which will be derived
+     */
+    KeyIdentifier_t TargetKeyID;
+}SecureElementDerivation_t;
+
 /*!
  * Initialization of Secure Element driver
  *
@@ -203,6 +253,20 @@ SecureElementStatus_t SecureElementAesEncrypt( uint8_t* buffer, uint16_t size, K
  */
 SecureElementStatus_t SecureElementDeriveAndStoreKey( Version_t version, uint8_t* input, KeyIdentifier_t rootKeyID, KeyIdentifier_t targetKeyID );
 
+/*!
+ * Derives and store several keys from the same root key
+ *
+ * \remark The root key is only loaded once for all the keys, the target key identifiers are
+ *         checked before the first key is derived.
+ *
+ * \param[IN]  version        - LoRaWAN specification version currently in use.
+ * \param[IN]  rootKeyID      - Key identifier of the root key to use to perform the derivations
+ * \param[IN]  derivations    - Inputs and key identifiers of the keys which will be derived
+ * \param[IN]  nbDerivations  - Number of keys to derive
+ * \retval                    - Status of the operation
+ */
+SecureElementStatus_t SecureElementDeriveAndStoreKeys( Version_t version, KeyIdentifier_t rootKeyID, SecureElementDerivation_t* derivations, uint8_t nbDerivations );
+
 /*!
  * Process JoinAccept message.
  *
@@ -227,6 +291,19 @@ SecureElementStatus_t SecureElementProcessJoinAccept( JoinReqIdentifier_t joinRe
  */
 SecureElementStatus_t SecureElementRandomNumber( uint32_t* randomNum );
 
+/*!
+ * Starts a sequence of secure element operations, for example the ones of a frame
+ *
+ * \remark A hardware secure element can stay awake until SecureElementEndSession instead of
+ *         waking up for every operation. Sessions can be nested.
+ */
+void SecureElementBeginSession( void );
+
+/*!
+ * Ends a sequence of secure element operations started with SecureElementBeginSession
+ */
+void SecureElementEndSession( void );
+
 /*!
  * Sets the DevEUI
  *
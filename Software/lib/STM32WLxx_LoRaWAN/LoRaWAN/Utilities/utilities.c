@@ -41,7 +41,7 @@
 // Standard random functions redefinition start
 #define RAND_LOCAL_MAX 2147483647L
 
-static uint32_t next = 1;
+static LORAMAC_THREAD_LOCAL uint32_t next = 1;
 
 static int32_t rand1( void );
 
@@ -37,6 +37,7 @@
 #include "radio_driver.h"
 #include "radio_conf.h"
 #include "GNSE_tracer.h"
+#include "stm32_evt_trace.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /*!
@@ -1790,6 +1791,7 @@ void RadioSetEventNotify( void ( * notify ) ( void ) )
 
 static void RadioOnDioIrq( RadioIrqMasks_t radioIrq )
 {
+  UTIL_EVT_TRACE( UTIL_EVT_TRACE_RADIO_IRQ, 0, radioIrq );
   SubgRf.RadioIrq = radioIrq;
 
   RadioIrqProcess();
@@ -1803,6 +1805,7 @@ static void RadioIrqProcess( void )
 {
   uint8_t size;
 
+  UTIL_EVT_TRACE( UTIL_EVT_TRACE_RADIO_PROCESS, 0, SubgRf.RadioIrq );
   switch (SubgRf.RadioIrq)
   {
   case IRQ_TX_DONE:
@@ -0,0 +1,339 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file UPLINK_SCHED.c
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "UPLINK_SCHED.h"
+
+typedef struct
+{
+  UPLINK_SCHED_Request_t Request;
+  uint32_t Deadline;
+  uint8_t Size;
+  uint8_t Payload[UPLINK_SCHED_PAYLOAD_SIZE];
+} UPLINK_SCHED_Entry_t;
+
+/**
+ * Queued uplinks in the order they were queued
+ */
+static UPLINK_SCHED_Entry_t Queue[UPLINK_SCHED_QUEUE_SIZE];
+static uint8_t QueueCount = 0;
+
+static uint8_t Frame[UPLINK_SCHED_FRAME_SIZE];
+
+/**
+ * A frame is in flight until its MCPS-Confirm
+ */
+static bool TxBusy = false;
+
+/**
+ * Earliest time of the next attempt, in the past when there is nothing to wait for
+ */
+static uint32_t NextTxTime = 0;
+
+static UPLINK_SCHED_Stats_t Stats;
+
+static void (*ProcessNotify)(void) = NULL;
+
+/**
+ * Wrap-around safe comparison of two times in ms
+ */
+static inline bool UPLINK_SCHED_Before(uint32_t time, uint32_t reference)
+{
+  return (int32_t)(time - reference) < 0;
+}
+
+/**
+ * @brief Orders the queued uplinks, the lowest Priority first, then the earliest deadline
+ * @return true if entry a is sent before entry b
+ */
+static bool UPLINK_SCHED_Better(const UPLINK_SCHED_Entry_t *a, const UPLINK_SCHED_Entry_t *b)
+{
+  if (a->Request.Priority != b->Request.Priority)
+  {
+    return a->Request.Priority < b->Request.Priority;
+  }
+  return UPLINK_SCHED_Before(a->Deadline, b->Deadline);
+}
+
+static void UPLINK_SCHED_Notify(void)
+{
+  if (ProcessNotify != NULL)
+  {
+    ProcessNotify();
+  }
+}
+
+/**
+ * @brief Removes the queued uplinks of a bit mask, keeping the order of the others
+ * @param mask bit i set to remove Queue[i]
+ */
+static void UPLINK_SCHED_Remove(uint32_t mask)
+{
+  uint8_t count = 0;
+
+  for (uint8_t i = 0; i < QueueCount; i++)
+  {
+    if ((mask & (1UL << i)) == 0U)
+    {
+      if (count != i)
+      {
+        Queue[count] = Queue[i];
+      }
+      count++;
+    }
+  }
+  QueueCount = count;
+}
+
+static void UPLINK_SCHED_DropExpired(uint32_t now)
+{
+  uint32_t mask = 0;
+
+  for (uint8_t i = 0; i < QueueCount; i++)
+  {
+    if (UPLINK_SCHED_Before(Queue[i].Deadline, now))
+    {
+      mask |= 1UL << i;
+      Stats.Dropped++;
+    }
+  }
+  if (mask != 0U)
+  {
+    UPLINK_SCHED_Remove(mask);
+  }
+}
+
+/**
+ * @brief Selects the best queued uplink and the uplinks it can be merged with
+ * @param max_size largest frame payload
+ * @param size size of the selected payloads
+ * @return bit mask of the selected uplinks, with the best uplink always selected
+ */
+static uint32_t UPLINK_SCHED_Select(uint8_t max_size, uint16_t *size)
+{
+  const UPLINK_SCHED_Entry_t *head;
+  uint32_t mask;
+  uint8_t best = 0;
+
+  for (uint8_t i = 1; i < QueueCount; i++)
+  {
+    if (UPLINK_SCHED_Better(&Queue[i], &Queue[best]))
+    {
+      best = i;
+    }
+  }
+  head = &Queue[best];
+  mask = 1UL << best;
+  *size = head->Size;
+
+  if (head->Request.Mergeable == false)
+  {
+    return mask;
+  }
+
+  /* Add the other mergeable uplinks of the port, best first, as long as they fit */
+  for (;;)
+  {
+    int16_t next = -1;
+
+    for (uint8_t i = 0; i < QueueCount; i++)
+    {
+      const UPLINK_SCHED_Entry_t *entry = &Queue[i];
+
+      if (((mask & (1UL << i)) == 0U) && (entry->Request.Mergeable == true) &&
+          (entry->Request.Port == head->Request.Port) && (entry->Request.Confirmed == head->Request.Confirmed) &&
+          ((*size + entry->Size) <= max_size) && ((next < 0) || UPLINK_SCHED_Better(entry, &Queue[next])))
+      {
+        next = i;
+      }
+    }
+    if (next < 0)
+    {
+      return mask;
+    }
+    mask |= 1UL << next;
+    *size += Queue[next].Size;
+  }
+}
+
+void UPLINK_SCHED_Init(void (*process_notify)(void))
+{
+  ProcessNotify = process_notify;
+  QueueCount = 0;
+  TxBusy = false;
+  NextTxTime = UPLINK_SCHED_Driver.GetTime();
+  memset(&Stats, 0, sizeof(Stats));
+}
+
+UPLINK_SCHED_op_result_t UPLINK_SCHED_Enqueue(const UPLINK_SCHED_Request_t *request, const uint8_t *payload, uint8_t size)
+{
+  UPLINK_SCHED_Entry_t *entry;
+
+  if ((request == NULL) || ((payload == NULL) && (size != 0U)) || (size > UPLINK_SCHED_PAYLOAD_SIZE))
+  {
+    return UPLINK_SCHED_OP_FAIL;
+  }
+
+  if (QueueCount < UPLINK_SCHED_QUEUE_SIZE)
+  {
+    entry = &Queue[QueueCount++];
+  }
+  else
+  {
+    /* Evict the worst uplink if the new one is better */
+    uint8_t worst = 0;
+
+    for (uint8_t i = 1; i < QueueCount; i++)
+    {
+      if (UPLINK_SCHED_Better(&Queue[worst], &Queue[i]))
+      {
+        worst = i;
+      }
+    }
+    if (request->Priority >= Queue[worst].Request.Priority)
+    {
+      Stats.Dropped++;
+      return UPLINK_SCHED_OP_FULL;
+    }
+    UPLINK_SCHED_Remove(1UL << worst);
+    Stats.Dropped++;
+    entry = &Queue[QueueCount++];
+  }
+
+  entry->Request = *request;
+  entry->Deadline = UPLINK_SCHED_Driver.GetTime() + request->Lifetime;
+  entry->Size = size;
+  if (size != 0U)
+  {
+    memcpy(entry->Payload, payload, size);
+  }
+  Stats.Queued++;
+
+  UPLINK_SCHED_Notify();
+  return UPLINK_SCHED_OP_SUCCESS;
+}
+
+void UPLINK_SCHED_Process(void)
+{
+  uint32_t now = UPLINK_SCHED_Driver.GetTime();
+  uint32_t next_tx_in = 0;
+  uint32_t mask;
+  uint16_t size = 0;
+  uint8_t max_size;
+  uint8_t count = 0;
+  uint8_t port = 0;
+  bool confirmed = false;
+
+  UPLINK_SCHED_DropExpired(now);
+
+  if ((QueueCount == 0U) || (TxBusy == true))
+  {
+    return;
+  }
+  if (UPLINK_SCHED_Before(now, NextTxTime))
+  {
+    UPLINK_SCHED_Driver.StartTimer(NextTxTime - now);
+    return;
+  }
+
+  max_size = UPLINK_SCHED_Driver.MaxPayload();
+  mask = UPLINK_SCHED_Select(max_size, &size);
+
+  /* Merged payloads are kept in the order they were queued */
+  size = 0;
+  for (uint8_t i = 0; i < QueueCount; i++)
+  {
+    if ((mask & (1UL << i)) != 0U)
+    {
+      memcpy(&Frame[size], Queue[i].Payload, Queue[i].Size);
+      size += Queue[i].Size;
+      port = Queue[i].Request.Port;
+      confirmed = Queue[i].Request.Confirmed;
+      count++;
+    }
+  }
+
+  switch (UPLINK_SCHED_Driver.Send(port, Frame, (uint8_t)size, confirmed, &next_tx_in))
+  {
+    case UPLINK_SCHED_OP_SUCCESS:
+      UPLINK_SCHED_Remove(mask);
+      Stats.Sent += count;
+      Stats.Frames++;
+      TxBusy = true;
+      break;
+    case UPLINK_SCHED_OP_RESTRICTED:
+      /* The band is ready once its time credits exceed the cost of the frame, 1 ms after next_tx_in */
+      Stats.Restricted++;
+      NextTxTime = now + next_tx_in + 1U;
+      UPLINK_SCHED_Driver.StartTimer(next_tx_in + 1U);
+      break;
+    case UPLINK_SCHED_OP_BUSY:
+      NextTxTime = now + UPLINK_SCHED_RETRY_DELAY_MS;
+      UPLINK_SCHED_Driver.StartTimer(UPLINK_SCHED_RETRY_DELAY_MS);
+      break;
+    case UPLINK_SCHED_OP_NOT_JOINED:
+      NextTxTime = now + UPLINK_SCHED_JOIN_RETRY_DELAY_MS;
+      UPLINK_SCHED_Driver.StartTimer(UPLINK_SCHED_JOIN_RETRY_DELAY_MS);
+      break;
+    default:
+      /* Refused by the MAC, e.g. too large for the datarate, retrying would not help */
+      UPLINK_SCHED_Remove(mask);
+      Stats.Dropped += count;
+      UPLINK_SCHED_Notify();
+      break;
+  }
+}
+
+void UPLINK_SCHED_OnTxDone(uint32_t time_on_air)
+{
+  if (TxBusy == true)
+  {
+    TxBusy = false;
+    Stats.AirTime += time_on_air;
+  }
+  UPLINK_SCHED_Notify();
+}
+
+void UPLINK_SCHED_OnJoined(void)
+{
+  NextTxTime = UPLINK_SCHED_Driver.GetTime();
+  UPLINK_SCHED_Notify();
+}
+
+void UPLINK_SCHED_OnTimer(void)
+{
+  UPLINK_SCHED_Notify();
+}
+
+uint8_t UPLINK_SCHED_Pending(void)
+{
+  return QueueCount;
+}
+
+void UPLINK_SCHED_GetStats(UPLINK_SCHED_Stats_t *stats)
+{
+  if (stats != NULL)
+  {
+    *stats = Stats;
+  }
+}
@@ -0,0 +1,182 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file UPLINK_SCHED.h
+ *
+ * @brief Air-time aware uplink scheduler between the application and LmHandler
+ *
+ * Instead of calling LmHandlerSend() on a fixed period and losing the uplink when the duty-cycle
+ * is restricted, the application queues its uplinks with a priority and a deadline:
+ * - the best uplink (lowest Priority, then earliest deadline) is sent at the earliest legal instant,
+ *   the MAC returns the band time-off left when it is restricted and the scheduler waits exactly that long
+ * - mergeable uplinks queued for the same FPort are sent in a single frame, in the order they were queued,
+ *   up to the payload size allowed by the current datarate
+ * - uplinks still queued at their deadline are dropped
+ *
+ * Merging is only valid for FPorts whose payload is a sequence of records the application server can split.
+ * The host simulation `tools/uplink_sched_sim.py` runs this scheduler built for the host and compares it with a fixed
+ * period over the EU868 bands.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#ifndef UPLINK_SCHED_H
+#define UPLINK_SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Number of queued uplinks, at most 32
+ */
+#ifndef UPLINK_SCHED_QUEUE_SIZE
+#define UPLINK_SCHED_QUEUE_SIZE 8U
+#endif
+
+/**
+ * Payload size of a queued uplink in bytes, merged frames can be larger
+ * @note 51 bytes is the smallest payload size of the EU868 datarates
+ */
+#ifndef UPLINK_SCHED_PAYLOAD_SIZE
+#define UPLINK_SCHED_PAYLOAD_SIZE 51U
+#endif
+
+/**
+ * Frame size in bytes, the largest LoRaWAN application payload
+ */
+#define UPLINK_SCHED_FRAME_SIZE 242U
+
+/**
+ * Delay in ms before trying again when the MAC is busy
+ */
+#ifndef UPLINK_SCHED_RETRY_DELAY_MS
+#define UPLINK_SCHED_RETRY_DELAY_MS 1000U
+#endif
+
+/**
+ * Delay in ms before trying again when not joined, every attempt starts a new join
+ */
+#ifndef UPLINK_SCHED_JOIN_RETRY_DELAY_MS
+#define UPLINK_SCHED_JOIN_RETRY_DELAY_MS 60000U
+#endif
+
+#if (UPLINK_SCHED_QUEUE_SIZE > 32U)
+#error "UPLINK_SCHED_QUEUE_SIZE must not exceed 32"
+#endif
+
+typedef enum
+{
+  UPLINK_SCHED_OP_SUCCESS = 0,
+  UPLINK_SCHED_OP_FAIL = 1,
+  UPLINK_SCHED_OP_BUSY = 2,       /* The MAC is busy */
+  UPLINK_SCHED_OP_RESTRICTED = 3, /* Duty-cycle restricted, the wait time is returned */
+  UPLINK_SCHED_OP_FULL = 4,       /* Queue full of uplinks with the same or a better priority */
+  UPLINK_SCHED_OP_NOT_JOINED = 5,
+} UPLINK_SCHED_op_result_t;
+
+/**
+ * Uplink request
+ */
+typedef struct
+{
+  uint8_t Port;
+  uint8_t Priority;   /* 0 is the highest priority */
+  bool Confirmed;
+  bool Mergeable;     /* The payload may share a frame with other mergeable uplinks of the same Port */
+  uint32_t Lifetime;  /* Time in ms after which the uplink is dropped if still queued */
+} UPLINK_SCHED_Request_t;
+
+typedef struct
+{
+  uint32_t Queued;     /* Uplinks accepted in the queue */
+  uint32_t Sent;       /* Uplinks sent, merged or not */
+  uint32_t Frames;     /* Frames sent */
+  uint32_t Dropped;    /* Uplinks dropped at their deadline, evicted or refused by the MAC */
+  uint32_t Restricted; /* Duty-cycle restricted attempts */
+  uint32_t AirTime;    /* Time-on-air in ms of the frames sent */
+} UPLINK_SCHED_Stats_t;
+
+/**
+ * Driver between the scheduler and the LoRaWAN stack
+ */
+typedef struct
+{
+  uint32_t (*GetTime)(void);
+  /**
+   * Sends a frame now, next_tx_in is the duty-cycle time-off left when UPLINK_SCHED_OP_RESTRICTED is returned
+   */
+  UPLINK_SCHED_op_result_t (*Send)(uint8_t port, const uint8_t *buffer, uint8_t size, bool confirmed, uint32_t *next_tx_in);
+  /**
+   * Largest payload that can be sent now, at the current datarate and with the pending MAC commands
+   */
+  uint8_t (*MaxPayload)(void);
+  /**
+   * Calls UPLINK_SCHED_OnTimer() after delay ms, replacing the previous request
+   */
+  void (*StartTimer)(uint32_t delay);
+} UPLINK_SCHED_Driver_t;
+
+extern const UPLINK_SCHED_Driver_t UPLINK_SCHED_Driver;
+
+/**
+ * @brief Initializes the scheduler with an empty queue
+ * @param process_notify called when UPLINK_SCHED_Process() has to run, e.g. to set a sequencer task
+ */
+void UPLINK_SCHED_Init(void (*process_notify)(void));
+
+/**
+ * @brief Queues an uplink
+ * @param request port, priority and lifetime of the uplink
+ * @param payload uplink payload, copied
+ * @param size payload size, at most UPLINK_SCHED_PAYLOAD_SIZE
+ * @return UPLINK_SCHED_OP_FULL if the queue is full and no queued uplink has a lower priority
+ */
+UPLINK_SCHED_op_result_t UPLINK_SCHED_Enqueue(const UPLINK_SCHED_Request_t *request, const uint8_t *payload, uint8_t size);
+
+/**
+ * @brief Sends the best queued uplink if the duty-cycle allows it, otherwise waits for the earliest legal instant
+ */
+void UPLINK_SCHED_Process(void);
+
+/**
+ * @brief To be called on every MCPS-Confirm, the MAC is free for the next uplink
+ * @param time_on_air time-on-air in ms of the frame
+ */
+void UPLINK_SCHED_OnTxDone(uint32_t time_on_air);
+
+/**
+ * @brief To be called once joined, the uplinks waiting for the join are sent right away
+ */
+void UPLINK_SCHED_OnJoined(void);
+
+/**
+ * @brief To be called by the driver timer
+ */
+void UPLINK_SCHED_OnTimer(void);
+
+uint8_t UPLINK_SCHED_Pending(void);
+void UPLINK_SCHED_GetStats(UPLINK_SCHED_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UPLINK_SCHED_H */
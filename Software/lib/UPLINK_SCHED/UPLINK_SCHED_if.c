@@ -0,0 +1,106 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file UPLINK_SCHED_if.c
+ *
+ * @brief Uplink scheduler driver using LmHandler and the timer server
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include "UPLINK_SCHED.h"
+#include "LmHandler.h"
+#include "stm32_timer.h"
+
+static UTIL_TIMER_Object_t UplinkSchedTimer;
+static bool UplinkSchedTimerCreated = false;
+
+static void UPLINK_SCHED_OnTimerEvent(void *context)
+{
+  UPLINK_SCHED_OnTimer();
+}
+
+static uint32_t UPLINK_SCHED_GetTime(void)
+{
+  return UTIL_TIMER_GetCurrentTime();
+}
+
+static UPLINK_SCHED_op_result_t UPLINK_SCHED_Send(uint8_t port, const uint8_t *buffer, uint8_t size, bool confirmed, uint32_t *next_tx_in)
+{
+  LmHandlerAppData_t app_data = {port, size, (uint8_t *)buffer};
+  LoRaMacTxInfo_t tx_info = {0};
+  TimerTime_t wait = 0;
+  bool flush = false;
+
+  if (LoRaMacQueryTxPossible(size, &tx_info) != LORAMAC_STATUS_OK)
+  {
+    if (size > tx_info.CurrentPossiblePayloadSize)
+    {
+      /* Does not fit the current datarate even without MAC commands */
+      return UPLINK_SCHED_OP_FAIL;
+    }
+    /* LmHandlerSend() sends the pending MAC commands alone, the payload is sent afterwards */
+    flush = true;
+  }
+
+  switch (LmHandlerSend(&app_data, confirmed ? LORAMAC_HANDLER_CONFIRMED_MSG : LORAMAC_HANDLER_UNCONFIRMED_MSG, &wait, false))
+  {
+    case LORAMAC_HANDLER_SUCCESS:
+      return (flush == true) ? UPLINK_SCHED_OP_BUSY : UPLINK_SCHED_OP_SUCCESS;
+    case LORAMAC_HANDLER_DUTYCYCLE_RESTRICTED:
+      *next_tx_in = wait;
+      return UPLINK_SCHED_OP_RESTRICTED;
+    case LORAMAC_HANDLER_NO_NETWORK_JOINED:
+      return UPLINK_SCHED_OP_NOT_JOINED;
+    case LORAMAC_HANDLER_BUSY_ERROR:
+    case LORAMAC_HANDLER_COMPLIANCE_RUNNING:
+      return UPLINK_SCHED_OP_BUSY;
+    default:
+      return UPLINK_SCHED_OP_FAIL;
+  }
+}
+
+static uint8_t UPLINK_SCHED_MaxPayload(void)
+{
+  LoRaMacTxInfo_t tx_info = {0};
+
+  LoRaMacQueryTxPossible(0, &tx_info);
+  return tx_info.MaxPossibleApplicationDataSize;
+}
+
+static void UPLINK_SCHED_StartTimer(uint32_t delay)
+{
+  if (UplinkSchedTimerCreated == false)
+  {
+    UTIL_TIMER_Create(&UplinkSchedTimer, 0xFFFFFFFFU, UTIL_TIMER_ONESHOT, UPLINK_SCHED_OnTimerEvent, NULL);
+    UplinkSchedTimerCreated = true;
+  }
+  UTIL_TIMER_Stop(&UplinkSchedTimer);
+  UTIL_TIMER_SetPeriod(&UplinkSchedTimer, delay);
+  UTIL_TIMER_Start(&UplinkSchedTimer);
+}
+
+/**
+  * @brief Uplink scheduler driver callbacks handler
+  */
+const UPLINK_SCHED_Driver_t UPLINK_SCHED_Driver =
+{
+  UPLINK_SCHED_GetTime,
+  UPLINK_SCHED_Send,
+  UPLINK_SCHED_MaxPayload,
+  UPLINK_SCHED_StartTimer,
+};
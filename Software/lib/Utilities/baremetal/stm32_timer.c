@@ -86,10 +86,10 @@
  */
 
 /**
-  * @brief Timers list head pointer
+  * @brief Timers list head pointer, one list per thread on the host (see LORAMAC_THREAD_LOCAL)
   *
   */
-static UTIL_TIMER_Object_t *TimerListHead = NULL;
+static LORAMAC_THREAD_LOCAL UTIL_TIMER_Object_t *TimerListHead = NULL;
 
 /**
   *  @}
@@ -48,6 +48,13 @@ extern "C" {
                                    UTIL_TIMER_Create( HANDLE, TIMERTIME_T_MAX, UTIL_TIMER_ONESHOT, CB, NULL);\
                                  } while(0)
 
+/**
+  * @brief Create the timer object, CB is called with CONTEXT as argument
+  */
+#define TimerInitWithContext(HANDLE, CB, CONTEXT) do {\
+                                                     UTIL_TIMER_Create( HANDLE, TIMERTIME_T_MAX, UTIL_TIMER_ONESHOT, CB, CONTEXT);\
+                                                   } while(0)
+
 /**
   * @brief update the period and start the timer
   */
@@ -66,6 +66,18 @@ void TimerInit( TimerEvent_t *obj, void ( *callback )( void *context ) );
  */
 void TimerSetContext( TimerEvent_t *obj, void* context );
 
+/*!
+ * \brief Initializes the timer object, the callback is called with context
+ *
+ * \param [IN] obj          Structure containing the timer object parameters
+ * \param [IN] callback     Function callback called at the end of the timeout
+ * \param [IN] context      User defined data object pointer passed to callback
+ */
+#define TimerInitWithContext( obj, callback, context ) do {\
+                                                           TimerInit( obj, callback );\
+                                                           TimerSetContext( obj, context );\
+                                                         } while( 0 )
+
 /*!
  * Timer IRQ event handler
  */
@@ -0,0 +1,125 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file stm32_crc.h
+ *
+ * @brief CRC-32 (IEEE 802.3, same as zlib) shared by the FUOTA, bootloader and storage code and CRC-16/CCITT
+ *        (polynomial 0x1021, initial value 0, same as XMODEM) of the LoRaWAN Class B beacons
+ *
+ * All CRC-32 backends return the same value and can be mixed on the same running CRC:
+ * - UTIL_CRC32_Slice4: 4 KBytes of tables, 4 bytes per step
+ * - UTIL_CRC32_Slice8: 8 KBytes of tables, 8 bytes per step
+ * - UTIL_CRC32_Hw: STM32WL CRC peripheral, 64 bytes of table for the unaligned bytes
+ *
+ * UTIL_CRC32_Update uses the backend selected with UTIL_CRC32_BACKEND. Unused tables are removed by the linker.
+ * The check value, CRC-32 of the ASCII string "123456789", is UTIL_CRC32_CHECK. The table backends are tested
+ * and benchmarked on the host with `python3 tools/host_test.py stm32_crc --bench`.
+ *
+ * The CRC-16 backends work the same way, UTIL_CRC16_Update uses UTIL_CRC16_BACKEND:
+ * - UTIL_CRC16_Nibble: 32 bytes of table, 2 steps per byte
+ * - UTIL_CRC16_Table: 512 bytes of table, 1 step per byte
+ * - UTIL_CRC16_Hw: STM32WL CRC peripheral, no table, not verified on the device yet
+ *
+ * The CRC-16 check value is UTIL_CRC16_CHECK. The Nibble and Table backends are covered by the same host test.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#ifndef __STM32_CRC_H__
+#define __STM32_CRC_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UTIL_CRC32_BACKEND_SLICE4 0
+#define UTIL_CRC32_BACKEND_SLICE8 1
+#define UTIL_CRC32_BACKEND_HW 2
+
+/**
+ * Backend of UTIL_CRC32_Update, host builds must select a table backend
+ * @note The CRC peripheral is not shared between contexts, do not use UTIL_CRC32_Hw from interrupts
+ */
+#ifndef UTIL_CRC32_BACKEND
+#define UTIL_CRC32_BACKEND UTIL_CRC32_BACKEND_HW
+#endif
+
+/**
+ * Initial value of a running CRC
+ */
+#define UTIL_CRC32_INIT 0U
+
+#define UTIL_CRC32_CHECK 0xCBF43926U
+
+#define UTIL_CRC16_BACKEND_NIBBLE 0
+#define UTIL_CRC16_BACKEND_TABLE 1
+#define UTIL_CRC16_BACKEND_HW 2
+
+/**
+ * Backend of UTIL_CRC16_Update. The beacon fields are a few bytes long, the table is as fast as loading the
+ * peripheral and leaves it to the CRC-32 users.
+ * @warning UTIL_CRC16_BACKEND_HW is unverified: its register setup was never run on a device and the host test
+ *          cannot cover it, check it against UTIL_CRC16_CHECK on the target before selecting it
+ */
+#ifndef UTIL_CRC16_BACKEND
+#define UTIL_CRC16_BACKEND UTIL_CRC16_BACKEND_TABLE
+#endif
+
+/**
+ * Initial value of a running CRC-16
+ */
+#define UTIL_CRC16_INIT 0U
+
+#define UTIL_CRC16_CHECK 0x31C3U
+
+/**
+ * @brief Updates a running CRC-32 with a buffer, using the UTIL_CRC32_BACKEND backend
+ * @param crc UTIL_CRC32_INIT for the first buffer, the previous result otherwise
+ * @param buffer data to add to the CRC
+ * @param length number of bytes
+ * @return CRC-32 of all buffers so far
+ */
+uint32_t UTIL_CRC32_Update(uint32_t crc, const void *buffer, uint32_t length);
+
+uint32_t UTIL_CRC32_Slice4(uint32_t crc, const void *buffer, uint32_t length);
+uint32_t UTIL_CRC32_Slice8(uint32_t crc, const void *buffer, uint32_t length);
+#if (UTIL_CRC32_BACKEND == UTIL_CRC32_BACKEND_HW)
+uint32_t UTIL_CRC32_Hw(uint32_t crc, const void *buffer, uint32_t length);
+#endif
+
+/**
+ * @brief Updates a running CRC-16/CCITT with a buffer, using the UTIL_CRC16_BACKEND backend
+ * @param crc UTIL_CRC16_INIT for the first buffer, the previous result otherwise
+ * @param buffer data to add to the CRC
+ * @param length number of bytes
+ * @return CRC-16 of all buffers so far
+ */
+uint16_t UTIL_CRC16_Update(uint16_t crc, const void *buffer, uint32_t length);
+
+uint16_t UTIL_CRC16_Nibble(uint16_t crc, const void *buffer, uint32_t length);
+uint16_t UTIL_CRC16_Table(uint16_t crc, const void *buffer, uint32_t length);
+#if (UTIL_CRC16_BACKEND == UTIL_CRC16_BACKEND_HW)
+uint16_t UTIL_CRC16_Hw(uint16_t crc, const void *buffer, uint32_t length);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32_CRC_H__ */
@@ -0,0 +1,77 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file stm32_evt_trace.c
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include <stddef.h>
+#include "stm32_evt_trace.h"
+#include "utilities_conf.h"
+
+UTIL_EVT_TRACE_Ring_t UTIL_EVT_TRACE_Ring = {UTIL_EVT_TRACE_MAGIC, 0, UTIL_EVT_TRACE_SIZE, 0};
+
+static UTIL_EVT_TRACE_GetTime_t UTIL_EVT_TRACE_GetTime = NULL;
+
+void UTIL_EVT_TRACE_Init(UTIL_EVT_TRACE_GetTime_t get_time, uint32_t ticks_per_second)
+{
+  UTIL_EVT_TRACE_ENTER_CRITICAL_SECTION();
+  UTIL_EVT_TRACE_GetTime = get_time;
+  UTIL_EVT_TRACE_Ring.TicksPerSecond = ticks_per_second;
+  UTIL_EVT_TRACE_Ring.Count = 0;
+  UTIL_EVT_TRACE_EXIT_CRITICAL_SECTION();
+}
+
+void UTIL_EVT_TRACE_Record(UTIL_EVT_TRACE_Id_t id, uint8_t arg, uint16_t value)
+{
+  UTIL_EVT_TRACE_Record_t *record;
+
+  if (UTIL_EVT_TRACE_GetTime == NULL)
+  {
+    return;
+  }
+  /* The time is read in the critical section, the records are in time order */
+  UTIL_EVT_TRACE_ENTER_CRITICAL_SECTION();
+  record = &UTIL_EVT_TRACE_Ring.Records[UTIL_EVT_TRACE_Ring.Count & (UTIL_EVT_TRACE_SIZE - 1)];
+  record->Time = UTIL_EVT_TRACE_GetTime();
+  record->Value = value;
+  record->Id = (uint8_t)id;
+  record->Arg = arg;
+  UTIL_EVT_TRACE_Ring.Count++;
+  UTIL_EVT_TRACE_EXIT_CRITICAL_SECTION();
+}
+
+bool UTIL_EVT_TRACE_Read(uint32_t *cursor, UTIL_EVT_TRACE_Record_t *record)
+{
+  bool found = false;
+
+  UTIL_EVT_TRACE_ENTER_CRITICAL_SECTION();
+  if ((UTIL_EVT_TRACE_Ring.Count - *cursor) > UTIL_EVT_TRACE_SIZE)
+  {
+    /* Overwritten, or a cursor of before UTIL_EVT_TRACE_Init */
+    *cursor = (UTIL_EVT_TRACE_Ring.Count > UTIL_EVT_TRACE_SIZE) ? (UTIL_EVT_TRACE_Ring.Count - UTIL_EVT_TRACE_SIZE) : 0;
+  }
+  if (*cursor != UTIL_EVT_TRACE_Ring.Count)
+  {
+    *record = UTIL_EVT_TRACE_Ring.Records[*cursor & (UTIL_EVT_TRACE_SIZE - 1)];
+    (*cursor)++;
+    found = true;
+  }
+  UTIL_EVT_TRACE_EXIT_CRITICAL_SECTION();
+  return found;
+}
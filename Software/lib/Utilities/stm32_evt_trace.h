@@ -0,0 +1,149 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file stm32_evt_trace.h
+ *
+ * @brief Timestamped trace of the radio interrupts and of the LoRaWAN MAC events that follow them, in a fixed
+ *        RAM ring, to measure the latency of the deferred hops between the radio IRQ, its processing, the MAC
+ *        processing and the RX windows
+ *
+ * A record is 8 bytes: the time read from the clock given to UTIL_EVT_TRACE_Init, the event and two arguments.
+ * Recording is a few stores in a critical section and does nothing until UTIL_EVT_TRACE_Init is called, so it
+ * can stay in production builds. UTIL_EVT_TRACE_ENABLE set to 0 removes the calls.
+ *
+ * The ring is UTIL_EVT_TRACE_Ring, which a debugger can dump as is (gdb: dump binary value trace.bin
+ * UTIL_EVT_TRACE_Ring), or the application can print it with UTIL_EVT_TRACE_Read. tools/evt_trace.py in the
+ * Software folder reads both and gives the latency distributions.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#ifndef __STM32_EVT_TRACE_H__
+#define __STM32_EVT_TRACE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef UTIL_EVT_TRACE_ENABLE
+#define UTIL_EVT_TRACE_ENABLE 1
+#endif
+
+/**
+ * Records in the ring, a power of two
+ */
+#ifndef UTIL_EVT_TRACE_SIZE
+#define UTIL_EVT_TRACE_SIZE 64
+#endif
+
+#if ((UTIL_EVT_TRACE_SIZE & (UTIL_EVT_TRACE_SIZE - 1)) != 0)
+#error "UTIL_EVT_TRACE_SIZE must be a power of two"
+#endif
+
+/**
+ * UTIL_EVT_TRACE_Ring_t::Magic, "EVT1"
+ */
+#define UTIL_EVT_TRACE_MAGIC 0x31545645U
+
+/**
+ * Traced events, 0 is an empty record
+ */
+typedef enum
+{
+  UTIL_EVT_TRACE_RADIO_IRQ = 1,   /*!< Radio interrupt, value: RadioIrqMasks_t */
+  UTIL_EVT_TRACE_RADIO_PROCESS,   /*!< Processing of the radio interrupt, value: RadioIrqMasks_t */
+  UTIL_EVT_TRACE_MAC_EVENT,       /*!< Radio event given to the MAC, arg: LoRaMacRadioEvents_t bit */
+  UTIL_EVT_TRACE_MAC_PROCESS,     /*!< LoRaMacProcess of the radio events, arg: LoRaMacRadioEvents_t bits */
+  UTIL_EVT_TRACE_RX_TIMER_START,  /*!< RX window timer started, arg: LoRaMacRxSlot_t, value: delay in ms */
+  UTIL_EVT_TRACE_TIMER,           /*!< MAC timer fired, arg: UTIL_EVT_TRACE_Timer_t */
+  UTIL_EVT_TRACE_RX_WINDOW,       /*!< Radio in RX for a window, arg: LoRaMacRxSlot_t */
+  UTIL_EVT_TRACE_TASK_NOTIFY,     /*!< MAC task notified of radio or MAC events, arg: notification bits */
+} UTIL_EVT_TRACE_Id_t;
+
+/**
+ * MAC timers of UTIL_EVT_TRACE_TIMER
+ */
+typedef enum
+{
+  UTIL_EVT_TRACE_TIMER_TX_DELAYED,
+  UTIL_EVT_TRACE_TIMER_RX_WINDOW1,
+  UTIL_EVT_TRACE_TIMER_RX_WINDOW2,
+  UTIL_EVT_TRACE_TIMER_ACK_TIMEOUT,
+} UTIL_EVT_TRACE_Timer_t;
+
+typedef struct
+{
+  uint32_t Time;  /*!< Clock ticks */
+  uint16_t Value;
+  uint8_t Id;     /*!< UTIL_EVT_TRACE_Id_t */
+  uint8_t Arg;
+} UTIL_EVT_TRACE_Record_t;
+
+typedef struct
+{
+  uint32_t Magic;
+  uint32_t TicksPerSecond;
+  uint32_t Size;
+  uint32_t Count; /*!< Records written since the initialization, the last one is Records[(Count - 1) % Size] */
+  UTIL_EVT_TRACE_Record_t Records[UTIL_EVT_TRACE_SIZE];
+} UTIL_EVT_TRACE_Ring_t;
+
+/**
+ * Timestamp source, a free running 32-bit counter
+ */
+typedef uint32_t (*UTIL_EVT_TRACE_GetTime_t)(void);
+
+extern UTIL_EVT_TRACE_Ring_t UTIL_EVT_TRACE_Ring;
+
+/**
+ * @brief Empties the ring and starts recording
+ * @param get_time timestamp source, called in interrupts, NULL stops recording
+ * @param ticks_per_second rate of get_time
+ */
+void UTIL_EVT_TRACE_Init(UTIL_EVT_TRACE_GetTime_t get_time, uint32_t ticks_per_second);
+
+/**
+ * @brief Adds a record to the ring, overwriting the oldest one, use UTIL_EVT_TRACE instead
+ * @param id event
+ * @param arg first argument of the event
+ * @param value second argument of the event
+ */
+void UTIL_EVT_TRACE_Record(UTIL_EVT_TRACE_Id_t id, uint8_t arg, uint16_t value);
+
+/**
+ * @brief Copies the record after a cursor
+ * @param cursor 0 to read from the oldest record, the sequence number of the next record on return. Records
+ *        overwritten since the previous call are skipped, the cursor moves by more than one.
+ * @param record copy of the record
+ * @return false if there is no record after the cursor
+ */
+bool UTIL_EVT_TRACE_Read(uint32_t *cursor, UTIL_EVT_TRACE_Record_t *record);
+
+#if (UTIL_EVT_TRACE_ENABLE == 1)
+#define UTIL_EVT_TRACE(id, arg, value) UTIL_EVT_TRACE_Record((id), (uint8_t)(arg), (uint16_t)(value))
+#else
+#define UTIL_EVT_TRACE(id, arg, value)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32_EVT_TRACE_H__ */
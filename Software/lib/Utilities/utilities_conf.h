@@ -36,6 +36,15 @@ extern "C" {
   */
 #define UTIL_PLACE_IN_SECTION( __x__ )  __attribute__((section (__x__)))
 
+/**
+  * @brief Storage class of the state the LoRaMac instances of a thread share: the current instance, the timer
+  *        list and the random generator. _Thread_local for host programs running LoRaMac instances on several
+  *        threads
+  */
+#ifndef LORAMAC_THREAD_LOCAL
+#define LORAMAC_THREAD_LOCAL
+#endif
+
 /**
   * @brief Memory alignment macro
   */
@@ -61,6 +70,16 @@ extern "C" {
   */
 #define UTIL_SEQ_EXIT_CRITICAL_SECTION( )    UTILS_EXIT_CRITICAL_SECTION()
 
+/**
+  * @brief macro used to enter the critical section of the event trace
+  */
+#define UTIL_EVT_TRACE_ENTER_CRITICAL_SECTION( )   UTILS_ENTER_CRITICAL_SECTION()
+
+/**
+  * @brief macro used to exit the critical section of the event trace
+  */
+#define UTIL_EVT_TRACE_EXIT_CRITICAL_SECTION( )    UTILS_EXIT_CRITICAL_SECTION()
+
 /**
   * @brief Memset utilities interface to application
   */
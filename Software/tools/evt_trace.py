@@ -0,0 +1,196 @@
+"""
+Copyright 2021 The Things Industries B.V.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+# Reads the radio and MAC event trace of a device (see lib/Utilities/stm32_evt_trace.h) and gives the distribution
+# of the latency of every hop from the radio interrupt to the LoRaWAN MAC, and of the error of the RX windows.
+# The trace is either a binary dump of UTIL_EVT_TRACE_Ring made with a debugger:
+#
+#   (gdb) dump binary value trace.bin UTIL_EVT_TRACE_Ring
+#
+# or a log of the device with the EVT_TRACE and EVT lines printed by UTIL_EVT_TRACE_Read (EVT_TRACE_LOG_ENABLE in
+# basic_lorawan), several logs can be given. With FreeRTOS (freertos_lorawan), the notifications of the MAC task are
+# traced too and give the hop from the notification to the task.
+
+import re
+import struct
+import sys
+
+MAGIC = 0x31545645
+HEADER = struct.Struct('<4I')
+RECORD = struct.Struct('<IHBB')
+
+# UTIL_EVT_TRACE_Id_t
+RADIO_IRQ, RADIO_PROCESS, MAC_EVENT, MAC_PROCESS, RX_TIMER_START, TIMER, RX_WINDOW, TASK_NOTIFY = range(1, 9)
+# UTIL_EVT_TRACE_Timer_t
+TIMER_RX_WINDOW1, TIMER_RX_WINDOW2 = 1, 2
+# RadioIrqMasks_t
+IRQ_TX_DONE = 0x0001
+# LoRaMacRadioEvents_t bits
+MAC_EVENTS = {0x01: 'rx-timeout', 0x02: 'rx-error', 0x04: 'tx-timeout', 0x08: 'rx-done', 0x10: 'tx-done'}
+# LoRaMacRxSlot_t
+RX_SLOTS = {0: 'RX1', 1: 'RX2'}
+# Task notification bits of freertos_lorawan.c
+NOTIFY_RADIO_PENDING, NOTIFY_MAC_PENDING = 0x1, 0x2
+
+# A hop that takes longer is a missing event, not a latency
+MAX_HOP_S = 1.0
+MAX_RX_DELAY_S = 8.0
+
+LOG_HEADER = re.compile(r'EVT_TRACE (\d+)')
+LOG_RECORD = re.compile(r'EVT (\d+) (\d+) (\d+) (\d+) (\d+)')
+
+
+class Event:
+    def __init__(self, seq, time, id, arg, value):
+        self.seq = seq
+        self.time = time
+        self.id = id
+        self.arg = arg
+        self.value = value
+
+
+def read_dump(data):
+    """Returns the ticks per second and the events of a binary dump of UTIL_EVT_TRACE_Ring, oldest first"""
+    magic, ticks_per_second, size, count = HEADER.unpack_from(data)
+    if magic != MAGIC or len(data) < HEADER.size + size * RECORD.size:
+        sys.exit('Not a dump of UTIL_EVT_TRACE_Ring')
+    events = []
+    for seq in range(max(count - size, 0), count):
+        offset = HEADER.size + (seq % size) * RECORD.size
+        time, value, id, arg = RECORD.unpack_from(data, offset)
+        events.append(Event(seq, time, id, arg, value))
+    return ticks_per_second, [events]
+
+
+def read_log(text):
+    """Returns the ticks per second and the runs of consecutive events of a device log"""
+    ticks_per_second = None
+    runs = [[]]
+    for line in text.splitlines():
+        match = LOG_HEADER.search(line)
+        if match:
+            ticks_per_second = int(match.group(1))
+            continue
+        match = LOG_RECORD.search(line)
+        if match:
+            event = Event(*(int(v) for v in match.groups()))
+            if runs[-1] and event.seq != runs[-1][-1].seq + 1:
+                # Records lost in the ring or in the log
+                runs.append([])
+            runs[-1].append(event)
+    return ticks_per_second, [run for run in runs if run]
+
+
+def hops(events, tick_s):
+    """Yields (hop, latency in s) for the events of a run"""
+
+    def elapsed(start, end):
+        return ((end.time - start.time) & 0xFFFFFFFF) * tick_s
+
+    def following(index, match, stop=lambda e: False):
+        """First event after events[index] that matches, None if an event stops the search first"""
+        for event in events[index + 1:]:
+            if elapsed(events[index], event) > MAX_HOP_S or stop(event):
+                return None
+            if match(event):
+                return event
+        return None
+
+    for i, event in enumerate(events):
+        if event.id == RADIO_IRQ:
+            process = following(i, lambda e: e.id == RADIO_PROCESS and e.value == event.value,
+                                lambda e: e.id == RADIO_IRQ)
+            if process is not None:
+                yield 'radio IRQ -> radio processing', elapsed(event, process)
+            # Preamble and header interrupts are not given to the MAC
+            mac = following(i, lambda e: e.id == MAC_EVENT, lambda e: e.id == RADIO_IRQ)
+            if mac is not None:
+                yield 'radio IRQ -> MAC event', elapsed(event, mac)
+            if event.value & IRQ_TX_DONE:
+                start = following(i, lambda e: e.id == RX_TIMER_START)
+                if start is not None:
+                    yield 'TX done IRQ -> RX timers started', elapsed(event, start)
+                # Up to the next TX done, the RX windows of a join accept open after 6 s at most
+                frame = []
+                for e in events[i + 1:]:
+                    if (e.id == RADIO_IRQ and e.value & IRQ_TX_DONE) or elapsed(event, e) > MAX_RX_DELAY_S:
+                        break
+                    frame.append(e)
+                for slot, name in RX_SLOTS.items():
+                    delay = next((e for e in frame if e.id == RX_TIMER_START and e.arg == slot), None)
+                    window = next((e for e in frame if e.id == RX_WINDOW and e.arg == slot), None)
+                    if delay is not None and window is not None:
+                        yield '%s opened late' % name, elapsed(event, window) - delay.value / 1000
+        elif event.id == MAC_EVENT:
+            process = following(i, lambda e: e.id == MAC_PROCESS and e.arg & event.arg)
+            if process is not None:
+                yield 'MAC event -> LoRaMacProcess (%s)' % MAC_EVENTS.get(event.arg, event.arg), \
+                    elapsed(event, process)
+        elif event.id == TIMER and event.arg in (TIMER_RX_WINDOW1, TIMER_RX_WINDOW2):
+            window = following(i, lambda e: e.id == RX_WINDOW and e.arg == event.arg - 1, lambda e: e.id == TIMER)
+            if window is not None:
+                yield '%s timer -> radio in RX' % RX_SLOTS[event.arg - 1], elapsed(event, window)
+        elif event.id == TASK_NOTIFY:
+            # The MAC task processes the radio IRQ, a MAC notification runs LoRaMacProcess, traced for radio events only
+            if event.arg & NOTIFY_RADIO_PENDING:
+                process = following(i, lambda e: e.id == RADIO_PROCESS, lambda e: e.id == TASK_NOTIFY)
+                if process is not None:
+                    yield 'task notify -> radio processing', elapsed(event, process)
+            elif event.arg & NOTIFY_MAC_PENDING:
+                process = following(i, lambda e: e.id == MAC_PROCESS, lambda e: e.id == TASK_NOTIFY)
+                if process is not None:
+                    yield 'task notify -> LoRaMacProcess', elapsed(event, process)
+
+
+def percentile(values, p):
+    """Nearest-rank percentile of the sorted values"""
+    return values[max(-(-p * len(values) // 100) - 1, 0)]
+
+
+def report(latencies, tick_s):
+    print('%-40s %6s %9s %9s %9s %9s %9s' % ('hop', 'count', 'min us', 'p50 us', 'p90 us', 'p99 us', 'max us'))
+    for hop, values in latencies.items():
+        values = sorted(values)
+        print('%-40s %6d %9.0f %9.0f %9.0f %9.0f %9.0f' % (
+            hop, len(values), values[0] * 1e6, percentile(values, 50) * 1e6, percentile(values, 90) * 1e6,
+            percentile(values, 99) * 1e6, values[-1] * 1e6))
+    print('clock resolution %.3g us' % (tick_s * 1e6))
+
+
+if __name__ == '__main__':
+    import argparse
+
+    parser = argparse.ArgumentParser(description='Latency distributions of the radio and MAC event trace.')
+    parser.add_argument('traces', nargs='+', help='binary dumps of UTIL_EVT_TRACE_Ring or device logs')
+    parser.add_argument('--ticks-per-second', type=int,
+                        help='rate of the trace clock, for logs without the EVT_TRACE line')
+    args = parser.parse_args()
+
+    latencies = {}
+    ticks_per_second = args.ticks_per_second
+    for path in args.traces:
+        with open(path, 'rb') as f:
+            data = f.read()
+        if len(data) >= HEADER.size and HEADER.unpack_from(data)[0] == MAGIC:
+            rate, runs = read_dump(data)
+        else:
+            rate, runs = read_log(data.decode(errors='replace'))
+        ticks_per_second = args.ticks_per_second or rate or ticks_per_second
+        if not ticks_per_second:
+            sys.exit('%s: unknown clock rate, use --ticks-per-second' % path)
+        for run in runs:
+            for hop, latency in hops(run, 1.0 / ticks_per_second):
+                latencies.setdefault(hop, []).append(latency)
+    if not latencies:
+        sys.exit('No events')
+    report(latencies, 1.0 / ticks_per_second)
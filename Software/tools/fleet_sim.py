@@ -0,0 +1,764 @@
+"""
+Copyright 2021 The Things Industries B.V.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+# Simulates a fleet of EU868 end devices around one gateway in virtual time. Every device runs the firmware
+# LoRaMac, region and crypto sources built for the host (see fleet_sim_node/fleet_sim_node.c) in its own process,
+# this script models the radio channel, the gateway and a network server with joins, ADR and acknowledgements:
+# - path loss 120.9 + 37.6 log10(d km) with log-normal shadowing per device
+# - same channel collisions with the SIR thresholds of Croce et al., "Impact of LoRa Imperfect Orthogonality"
+# - 8 demodulation paths, half-duplex gateway and gateway duty-cycle
+# The devices are stepped in lockstep windows shorter than RX1 delay, so that every downlink is queued before
+# the device opens its receive window.
+
+import glob
+import hashlib
+import math
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+TOOLS_DIR = os.path.dirname(os.path.abspath(__file__))
+SOFTWARE_DIR = os.path.dirname(TOOLS_DIR)
+LORAWAN_DIR = os.path.join(SOFTWARE_DIR, 'lib', 'STM32WLxx_LoRaWAN', 'LoRaWAN')
+NODE_DIR = os.path.join(TOOLS_DIR, 'fleet_sim_node')
+
+NODE_SOURCES = ['Mac/*.c', 'Mac/region/*.c', 'Crypto/*.c', 'Utilities/utilities.c']
+NODE_INCLUDES = [NODE_DIR] + [os.path.join(LORAWAN_DIR, d) for d in ('Mac', 'Mac/region', 'Crypto', 'Utilities')] + [
+    os.path.join(SOFTWARE_DIR, 'lib', 'STM32WLxx_LoRaWAN', 'SubGHz_Phy'),
+    os.path.join(SOFTWARE_DIR, 'lib', 'Utilities'),
+    os.path.join(SOFTWARE_DIR, 'lib', 'Utilities', 'baremetal'),
+    # se-identity.h
+    os.path.join(SOFTWARE_DIR, 'app', 'basic_lorawan', 'conf'),
+]
+# The host has no CRC peripheral, and no interrupts to trace
+NODE_DEFINES = ['-DUTIL_CRC32_BACKEND=UTIL_CRC32_BACKEND_SLICE4', '-DUTIL_CRC16_BACKEND=UTIL_CRC16_BACKEND_TABLE',
+                '-DUTIL_EVT_TRACE_ENABLE=0']
+
+# Lockstep window in ms, shorter than RECEIVE_DELAY1 minus the largest RX window offset
+STEP_MS = 500
+
+# LoRaMacStatus_t and LoRaMacEventInfoStatus_t of LoRaMac.h
+LORAMAC_STATUS = {0: 'ok', 1: 'busy', 8: 'length', 11: 'duty-cycle', 12: 'no-channel', 13: 'no-free-channel'}
+LORAMAC_EVENT_INFO_STATUS_OK = 0
+
+# EU868
+RX2_FREQUENCY = 869525000
+RX2_SF = 12
+RX1_GATEWAY_EIRP = 14
+RX2_GATEWAY_EIRP = 27
+DEVICE_ANTENNA_GAIN = 2.15
+JOIN_ACCEPT_DELAY_MS = 5000
+RECEIVE_DELAY_MS = 1000
+CFLIST_FREQUENCIES = [867100000, 867300000, 867500000, 867700000, 867900000]
+MAX_DATARATE = 5
+MAX_TX_POWER_INDEX = 7
+
+# Gateway sub-bands of the downlinks: 868.0 - 868.6 MHz and 865 - 868 MHz at 1%, 869.4 - 869.65 MHz at 10%
+GATEWAY_BANDS = [(868000000, 868600000, 100), (865000000, 868000000, 100), (869400000, 869650000, 10)]
+GATEWAY_DEMODULATORS = 8
+DUTY_CYCLE_TIME_PERIOD = 3600000
+
+# SX126x sensitivity at 125 kHz and demodulation floor of SF7 to SF12 in dBm and dB
+SENSITIVITY = {7: -123.0, 8: -126.0, 9: -129.0, 10: -132.0, 11: -134.5, 12: -137.0}
+REQUIRED_SNR = {7: -7.5, 8: -10.0, 9: -12.5, 10: -15.0, 11: -17.5, 12: -20.0}
+NOISE_FLOOR = -174 + 10 * math.log10(125000) + 6
+# LoRa demodulators do not report more than about +10 dB
+MAX_SNR = 10.0
+
+# Minimum SIR in dB of a signal at SF (rows, 7 to 12) over the interference at SF (columns)
+SIR_THRESHOLD = [
+    [1, -8, -9, -9, -9, -9],
+    [-11, 1, -11, -12, -13, -13],
+    [-15, -13, 1, -13, -14, -15],
+    [-19, -18, -17, 1, -17, -18],
+    [-22, -22, -21, -20, 1, -20],
+    [-25, -25, -25, -24, -23, 1],
+]
+
+# Network server ADR, as the default algorithm of The Things Stack
+ADR_HISTORY = 20
+ADR_MARGIN = 15.0
+ADR_STEP = 3.0
+
+# Loss causes of the uplinks
+LOSS_CAUSES = ['sensitivity', 'demodulators', 'collision', 'gateway-tx']
+# LoRaMacRetransBackoff_t and LoRaMacRetransDatarate_t of LoRaMac.h
+RETRANS_BACKOFFS = ['none', 'constant', 'linear', 'exponential']
+RETRANS_DATARATES = ['step-down', 'keep', 'step-down-each']
+
+
+def time_on_air(sf, size, crc=True):
+    """LoRa time-on-air in ms at 125 kHz, as RadioTimeOnAir() with CR 4/5 and 8 preamble symbols"""
+    ldro = 1 if sf >= 11 else 0
+    symbols = 8 + max(math.ceil((8 * size - 4 * sf + 28 + (16 if crc else 0)) / (4 * (sf - 2 * ldro))) * 5, 0)
+    return math.ceil((symbols + 4.25 + 8) * (1 << sf) / 125)
+
+
+# AES-128 and CMAC of the network server. The firmware AES only implements the encryption, the join-accept is
+# encrypted with the decryption
+def _aes_tables():
+    sbox = [0] * 256
+    p = q = 1
+    while True:
+        p = p ^ ((p << 1) & 0xFF) ^ (0x1B if p & 0x80 else 0)
+        q ^= q << 1
+        q ^= q << 2
+        q ^= q << 4
+        q &= 0xFF
+        if q & 0x80:
+            q ^= 0x09
+        x = q ^ (q << 1 | q >> 7) ^ (q << 2 | q >> 6) ^ (q << 3 | q >> 5) ^ (q << 4 | q >> 4)
+        sbox[p] = (x ^ 0x63) & 0xFF
+        if p == 1:
+            break
+    sbox[0] = 0x63
+    inverse = [0] * 256
+    for i, value in enumerate(sbox):
+        inverse[value] = i
+    return sbox, inverse
+
+
+AES_SBOX, AES_INV_SBOX = _aes_tables()
+
+
+def _xtime(a):
+    return ((a << 1) ^ 0x1B) & 0xFF if a & 0x80 else a << 1
+
+
+def _mul(a, b):
+    result = 0
+    while b:
+        if b & 1:
+            result ^= a
+        a = _xtime(a)
+        b >>= 1
+    return result
+
+
+def _aes_round_keys(key):
+    words = [list(key[i:i + 4]) for i in range(0, 16, 4)]
+    rcon = 1
+    for i in range(4, 44):
+        word = list(words[i - 1])
+        if i % 4 == 0:
+            word = [AES_SBOX[b] for b in word[1:] + word[:1]]
+            word[0] ^= rcon
+            rcon = _xtime(rcon)
+        words.append([a ^ b for a, b in zip(words[i - 4], word)])
+    return [sum(words[4 * r:4 * r + 4], []) for r in range(11)]
+
+
+def _shift_rows(state, direction):
+    return [state[(i + direction * 4 * (i % 4)) % 16] for i in range(16)]
+
+
+def _mix_columns(state, factors):
+    out = []
+    for c in range(0, 16, 4):
+        column = state[c:c + 4]
+        for r in range(4):
+            value = 0
+            for i in range(4):
+                value ^= _mul(column[i], factors[(i - r) % 4])
+            out.append(value)
+    return out
+
+
+def aes_encrypt(key, block):
+    keys = _aes_round_keys(key)
+    state = [a ^ b for a, b in zip(block, keys[0])]
+    for r in range(1, 11):
+        state = _shift_rows([AES_SBOX[b] for b in state], 1)
+        if r != 10:
+            state = _mix_columns(state, [2, 3, 1, 1])
+        state = [a ^ b for a, b in zip(state, keys[r])]
+    return bytes(state)
+
+
+def aes_decrypt(key, block):
+    keys = _aes_round_keys(key)
+    state = [a ^ b for a, b in zip(block, keys[10])]
+    for r in range(9, -1, -1):
+        state = [AES_INV_SBOX[b] for b in _shift_rows(state, -1)]
+        state = [a ^ b for a, b in zip(state, keys[r])]
+        if r != 0:
+            state = _mix_columns(state, [14, 11, 13, 9])
+    return bytes(state)
+
+
+def aes_cmac(key, message):
+    def shift(block):
+        value = int.from_bytes(block, 'big') << 1
+        if value >> 128:
+            value = (value & ((1 << 128) - 1)) ^ 0x87
+        return value.to_bytes(16, 'big')
+
+    k1 = shift(aes_encrypt(key, bytes(16)))
+    k2 = shift(k1)
+    blocks = [message[i:i + 16] for i in range(0, len(message), 16)] or [b'']
+    if len(blocks[-1]) == 16:
+        blocks[-1] = bytes(a ^ b for a, b in zip(blocks[-1], k1))
+    else:
+        padded = blocks[-1] + b'\x80' + bytes(15 - len(blocks[-1]))
+        blocks[-1] = bytes(a ^ b for a, b in zip(padded, k2))
+    mac = bytes(16)
+    for block in blocks:
+        mac = aes_encrypt(key, bytes(a ^ b for a, b in zip(mac, block)))
+    return mac
+
+
+def frame_mic(key, direction, devaddr, fcnt, message):
+    b0 = bytes([0x49, 0, 0, 0, 0, direction]) + devaddr.to_bytes(4, 'little') + fcnt.to_bytes(4, 'little') + \
+        bytes([0, len(message)])
+    return aes_cmac(key, b0 + message)[:4]
+
+
+def frame_payload_crypt(key, direction, devaddr, fcnt, payload):
+    out = bytearray()
+    for i in range(0, len(payload), 16):
+        a = bytes([0x01, 0, 0, 0, 0, direction]) + devaddr.to_bytes(4, 'little') + fcnt.to_bytes(4, 'little') + \
+            bytes([0, i // 16 + 1])
+        out += bytes(x ^ y for x, y in zip(payload[i:i + 16], aes_encrypt(key, a)))
+    return bytes(out)
+
+
+def build_node(name='fleet_sim_node', node_dirs=(NODE_DIR,), flags=()):
+    """Builds node_dirs[0]/name.c with the LoRaWAN sources once per version of the sources, returns the path of the
+    executable. The headers of node_dirs are found in this order, before the LoRaWAN ones."""
+    sources = sorted(sum((glob.glob(os.path.join(LORAWAN_DIR, pattern)) for pattern in NODE_SOURCES), []))
+    sources += [os.path.join(SOFTWARE_DIR, 'lib', 'Utilities', 'baremetal', source)
+                for source in ('stm32_timer.c', 'stm32_systime.c')]
+    sources.append(os.path.join(SOFTWARE_DIR, 'lib', 'Utilities', 'stm32_crc.c'))
+    sources.append(os.path.join(node_dirs[0], name + '.c'))
+    includes = list(node_dirs) + NODE_INCLUDES[1:]
+    compiler = os.environ.get('CC', 'cc')
+    digest = hashlib.sha1(compiler.encode() + ''.join(flags).encode())
+    for path in sorted(sources + glob.glob(os.path.join(LORAWAN_DIR, '*', '*.h')) +
+                       glob.glob(os.path.join(LORAWAN_DIR, 'Mac', 'region', '*.h')) +
+                       glob.glob(os.path.join(SOFTWARE_DIR, 'lib', 'Utilities', '*.h')) +
+                       sum((glob.glob(os.path.join(d, '*.h')) for d in node_dirs), [])):
+        with open(path, 'rb') as f:
+            digest.update(f.read())
+    binary = os.path.join(tempfile.gettempdir(), '%s-%s' % (name, digest.hexdigest()[:12]))
+    if not os.path.exists(binary):
+        command = [compiler, '-O2', '-std=gnu11', '-w'] + NODE_DEFINES + ['-I' + d for d in includes] + sources + \
+            list(flags) + ['-o', binary + '.tmp']
+        if subprocess.call(command) != 0:
+            sys.exit('Failed to build %s' % sources[-1])
+        os.replace(binary + '.tmp', binary)
+    return binary
+
+
+class Band:
+    """Downlink time credits of a gateway sub-band over one hour"""
+
+    def __init__(self, dcycle):
+        self.dcycle = dcycle
+        self.credits = DUTY_CYCLE_TIME_PERIOD
+        self.last = 0
+
+    def take(self, now, toa):
+        self.credits = min(self.credits + now - self.last, DUTY_CYCLE_TIME_PERIOD)
+        self.last = now
+        if self.credits < toa * self.dcycle:
+            return False
+        self.credits -= toa * self.dcycle
+        return True
+
+
+class Uplink:
+    def __init__(self, node, start, frequency, sf, power, toa, frame):
+        self.node = node
+        self.start = start
+        self.end = start + toa
+        self.frequency = frequency
+        self.sf = sf
+        self.power = power
+        self.toa = toa
+        self.frame = frame
+        self.rssi = power + DEVICE_ANTENNA_GAIN - node.path_loss
+        self.snr = min(self.rssi - NOISE_FLOOR, MAX_SNR)
+        self.loss = None
+
+
+class Node:
+    """Process of a simulated end device and its state in the network server"""
+
+    def __init__(self, index, binary, args, rng):
+        self.index = index
+        self.deveui = 0x70B3D57ED0000000 + index
+        self.appkey = bytes(rng.getrandbits(8) for _ in range(16))
+        angle = rng.uniform(0, 2 * math.pi)
+        self.distance = max(args.radius * math.sqrt(rng.random()), 10.0)
+        self.position = (self.distance * math.cos(angle), self.distance * math.sin(angle))
+        self.path_loss = 120.9 + 37.6 * math.log10(self.distance / 1000) + rng.gauss(0, args.shadowing)
+        join_at = rng.randrange(0, max(args.join_spread * 1000, 1))
+        self.process = subprocess.Popen(
+            [binary, '%016x' % self.deveui, self.appkey.hex(), str(rng.getrandbits(32)), str(join_at),
+             str(args.period * 1000), str(args.size), str(args.datarate), str(int(not args.no_adr)),
+             str(int(args.confirmed)), str(args.nb_trials), str(int(args.deadline * 1000)),
+             str(RETRANS_BACKOFFS.index(args.backoff)), str(int(args.backoff_delay * 1000)),
+             str(int(args.backoff_max * 1000)), str(args.jitter), str(RETRANS_DATARATES.index(args.retrans_dr))],
+            stdin=subprocess.PIPE, stdout=subprocess.PIPE, universal_newlines=True, bufsize=1)
+        self.next = 0
+        # Device side
+        self.samples = 0
+        self.not_sent = {}
+        self.joins = 0
+        self.uplinks = []
+        self.air_time = 0
+        self.tx_charge = 0.0
+        self.rx_ms = 0
+        self.downlinks = 0
+        self.datarate = None
+        self.tx_power = None
+        self.requested = None
+        self.sent_at = None
+        self.requests = {}
+        self.acked = 0
+        self.not_acked = 0
+        # Network server side
+        self.devaddr = None
+        self.nwkskey = None
+        self.join_nonce = 0
+        self.fcnt_up = None
+        self.fcnt_down = 0
+        self.delivered = set()
+        self.latencies = []
+        self.snr_history = []
+        self.adr = None
+        self.adr_pending = None
+
+    def send(self, line):
+        self.process.stdin.write(line + '\n')
+
+    def receive(self):
+        """Reads the events up to NEXT and returns the uplinks"""
+        uplinks = []
+        for line in self.process.stdout:
+            fields = line.split()
+            if fields[0] == 'TX':
+                start, frequency, sf, _, power, toa = (int(v) for v in fields[1:7])
+                uplinks.append(Uplink(self, start, frequency, sf, power, toa, bytes.fromhex(fields[7])))
+                frame = uplinks[-1].frame
+                fcnt = int.from_bytes(frame[6:8], 'little')
+                if frame[0] in (0x40, 0x80) and fcnt not in self.requests:
+                    # Time of the application request of every frame counter: UP follows TX when the frame is
+                    # sent right away, and precedes it when the frame is delayed by the duty-cycle
+                    self.requests[fcnt] = start if self.requested is None else self.requested
+                    self.sent_at = start if self.requested is None else None
+                    self.requested = None
+            elif fields[0] == 'UP':
+                self.samples += 1
+                status = LORAMAC_STATUS.get(int(fields[2]), fields[2])
+                if status != 'ok':
+                    self.not_sent[status] = self.not_sent.get(status, 0) + 1
+                elif self.sent_at != int(fields[1]):
+                    self.requested = int(fields[1])
+                self.sent_at = None
+            elif fields[0] == 'CONF':
+                if int(fields[2]):
+                    self.acked += 1
+                else:
+                    self.not_acked += 1
+            elif fields[0] == 'JOIN':
+                if int(fields[2]) == LORAMAC_EVENT_INFO_STATUS_OK:
+                    self.joins += 1
+            elif fields[0] == 'RX':
+                self.downlinks += 1
+            elif fields[0] == 'NEXT':
+                self.next = int(fields[1]) if int(fields[1]) >= 0 else None
+                return uplinks
+            elif fields[0] == 'STATS':
+                self.rx_ms, self.datarate, self.tx_power = (int(v) for v in fields[1:4])
+                return uplinks
+        sys.exit('Device %d exited' % self.index)
+
+
+class Gateway:
+    def __init__(self, args):
+        self.orthogonal = args.orthogonal
+        # Fading is drawn from its own generator so that the other draws do not depend on --loss
+        self.loss = args.loss
+        self.fading = random.Random(args.seed + 1)
+        self.bands = [Band(dcycle) for _, _, dcycle in GATEWAY_BANDS]
+        self.receiving = []
+        self.transmitting = []
+        self.downlinks = 0
+        self.downlinks_dropped = 0
+
+    def arrive(self, uplink, uplinks):
+        """Locks a demodulator on the preamble of the uplink"""
+        if uplink.rssi < SENSITIVITY[uplink.sf]:
+            uplink.loss = 'sensitivity'
+            return
+        self.receiving = [u for u in self.receiving if u.end > uplink.start]
+        if len(self.receiving) >= GATEWAY_DEMODULATORS:
+            uplink.loss = 'demodulators'
+            return
+        self.receiving.append(uplink)
+
+    def resolve(self, uplink, uplinks):
+        """Decides whether the uplink is received, once all the uplinks overlapping it are known"""
+        if uplink.loss is not None:
+            return False
+        if self.faded():
+            uplink.loss = 'fading'
+            return False
+        if any(start < uplink.end and end > uplink.start for start, end in self.transmitting):
+            uplink.loss = 'gateway-tx'
+            return False
+        interference = {}
+        for other in uplinks:
+            if other is uplink or other.frequency != uplink.frequency or \
+                    other.start >= uplink.end or other.end <= uplink.start:
+                continue
+            if self.orthogonal and other.sf != uplink.sf:
+                continue
+            interference[other.sf] = interference.get(other.sf, 0.0) + 10 ** (other.rssi / 10)
+        for sf, power in interference.items():
+            if uplink.rssi - 10 * math.log10(power) < SIR_THRESHOLD[uplink.sf - 7][sf - 7]:
+                uplink.loss = 'collision'
+                return False
+        return True
+
+    def faded(self):
+        """Returns True if a frame is lost to fading, independently of the path loss and of the other frames"""
+        return self.loss > 0 and self.fading.random() < self.loss
+
+    def transmit(self, start, frequency, sf, size):
+        """Returns True if the downlink can be sent, taking the half-duplex radio and the duty-cycle into account"""
+        toa = time_on_air(sf, size, crc=False)
+        self.transmitting = [(s, e) for s, e in self.transmitting if e > start - DUTY_CYCLE_TIME_PERIOD // 60]
+        if any(s < start + toa and e > start for s, e in self.transmitting):
+            return False
+        for (low, high, _), band in zip(GATEWAY_BANDS, self.bands):
+            if low <= frequency < high:
+                if not band.take(start, toa):
+                    return False
+                break
+        self.transmitting.append((start, start + toa))
+        return True
+
+
+class NetworkServer:
+    def __init__(self, nodes, gateway):
+        self.nodes = {node.deveui: node for node in nodes}
+        self.sessions = {}
+        self.gateway = gateway
+        self.next_devaddr = 0x26000000
+        self.mic_failures = 0
+
+    def handle(self, uplink):
+        mhdr = uplink.frame[0]
+        if mhdr == 0x00 and len(uplink.frame) == 23:
+            self.join(uplink)
+        elif mhdr in (0x40, 0x80) and len(uplink.frame) >= 12:
+            self.data(uplink, mhdr == 0x80)
+
+    def join(self, uplink):
+        frame = uplink.frame
+        node = self.nodes.get(int.from_bytes(frame[9:17], 'little'))
+        if node is None or aes_cmac(node.appkey, frame[:19])[:4] != frame[19:23]:
+            self.mic_failures += 1
+            return
+        devnonce = frame[17:19]
+        node.join_nonce += 1
+        if node.devaddr is None:
+            node.devaddr = self.next_devaddr
+            self.next_devaddr += 1
+        netid = bytes([0x13, 0, 0])
+        join_nonce = node.join_nonce.to_bytes(3, 'little')
+        cflist = b''.join((f // 100).to_bytes(3, 'little') for f in CFLIST_FREQUENCIES) + b'\x00'
+        message = bytes([0x20]) + join_nonce + netid + node.devaddr.to_bytes(4, 'little') + \
+            bytes([0x00, RECEIVE_DELAY_MS // 1000]) + cflist
+        message += aes_cmac(node.appkey, message)[:4]
+        encrypted = message[:1] + b''.join(aes_decrypt(node.appkey, message[i:i + 16])
+                                           for i in range(1, len(message), 16))
+        if not self.downlink(uplink, encrypted, JOIN_ACCEPT_DELAY_MS):
+            return
+        node.nwkskey = aes_encrypt(node.appkey, bytes([0x01]) + join_nonce + netid + devnonce + bytes(7))
+        node.fcnt_up = None
+        node.fcnt_down = 0
+        node.snr_history = []
+        node.adr = [12 - uplink.sf, 0]
+        node.adr_pending = None
+        self.sessions[node.devaddr] = node
+
+    def data(self, uplink, confirmed):
+        frame = uplink.frame
+        node = self.sessions.get(int.from_bytes(frame[1:5], 'little'))
+        if node is None:
+            return
+        fctrl = frame[5]
+        fopts_len = fctrl & 0x0F
+        fcnt = int.from_bytes(frame[6:8], 'little')
+        if node.fcnt_up is not None:
+            fcnt |= node.fcnt_up & 0xFFFF0000
+            if fcnt < node.fcnt_up:
+                fcnt += 0x10000
+        if frame_mic(node.nwkskey, 0, node.devaddr, fcnt, frame[:-4]) != frame[-4:]:
+            self.mic_failures += 1
+            return
+        retransmission = fcnt == node.fcnt_up
+        node.fcnt_up = fcnt
+        commands = frame[8:8 + fopts_len]
+        payload = frame[8 + fopts_len:-4]
+        if payload:
+            if payload[0] == 0:
+                commands = frame_payload_crypt(node.nwkskey, 0, node.devaddr, fcnt, payload[1:])
+            elif payload[0] == 2 and fcnt not in node.delivered:
+                node.delivered.add(fcnt)
+                node.latencies.append(uplink.end - node.requests.pop(fcnt & 0xFFFF, uplink.start))
+
+        i = 0
+        while i < len(commands):
+            if commands[i] == 0x03 and i + 1 < len(commands):
+                if node.adr_pending is not None and commands[i + 1] & 0x07 == 0x07:
+                    node.adr = node.adr_pending
+                    node.snr_history = []
+                node.adr_pending = None
+                i += 2
+            else:
+                # Only LinkADRAns is expected
+                break
+
+        fopts = b''
+        if fctrl & 0x80 and not retransmission:
+            self.adr(node, uplink)
+        if node.adr_pending is not None:
+            datarate, power = node.adr_pending
+            fopts = bytes([0x03, (datarate << 4) | power, 0xFF, 0x00, 0x01])
+        if not (confirmed or fctrl & 0x40 or fopts):
+            return
+        downlink = bytes([0x60]) + node.devaddr.to_bytes(4, 'little') + \
+            bytes([0x80 | (0x20 if confirmed else 0) | len(fopts)]) + (node.fcnt_down & 0xFFFF).to_bytes(2, 'little') + \
+            fopts
+        downlink += frame_mic(node.nwkskey, 1, node.devaddr, node.fcnt_down, downlink)
+        if self.downlink(uplink, downlink, RECEIVE_DELAY_MS):
+            node.fcnt_down += 1
+
+    def adr(self, node, uplink):
+        node.snr_history = (node.snr_history + [uplink.snr])[-ADR_HISTORY:]
+        if len(node.snr_history) < ADR_HISTORY or node.adr_pending is not None:
+            return
+        datarate, power = node.adr
+        steps = int((max(node.snr_history) - REQUIRED_SNR[uplink.sf] - ADR_MARGIN) / ADR_STEP)
+        while steps > 0 and datarate < MAX_DATARATE:
+            datarate += 1
+            steps -= 1
+        while steps > 0 and power < MAX_TX_POWER_INDEX:
+            power += 1
+            steps -= 1
+        while steps < 0 and power > 0:
+            power -= 1
+            steps += 1
+        if [datarate, power] != node.adr:
+            node.adr_pending = [datarate, power]
+
+    def downlink(self, uplink, frame, delay):
+        """Sends the frame in RX1, or in RX2 when the gateway cannot transmit in RX1"""
+        windows = [(uplink.end + delay, uplink.frequency, uplink.sf, RX1_GATEWAY_EIRP),
+                   (uplink.end + delay + 1000, RX2_FREQUENCY, RX2_SF, RX2_GATEWAY_EIRP)]
+        for start, frequency, sf, eirp in windows:
+            if self.gateway.transmit(start, frequency, sf, len(frame)):
+                self.gateway.downlinks += 1
+                rssi = eirp + DEVICE_ANTENNA_GAIN - uplink.node.path_loss
+                if rssi >= SENSITIVITY[sf] and not self.gateway.faded():
+                    snr = min(rssi - NOISE_FLOOR, MAX_SNR)
+                    uplink.node.send('DL %d %d %d 0 %d %d %s' % (start, frequency, sf, rssi, snr, frame.hex()))
+                return True
+        self.gateway.downlinks_dropped += 1
+        return False
+
+
+def simulate(args):
+    binary = build_node()
+    rng = random.Random(args.seed)
+    nodes = [Node(i, binary, args, rng) for i in range(args.nodes)]
+    gateway = Gateway(args)
+    server = NetworkServer(nodes, gateway)
+    end = int(args.hours * 3600000)
+    uplinks = []
+    pending = []
+    now = -1
+
+    while True:
+        times = [n.next for n in nodes if n.next is not None] + [u.end for u in pending]
+        if not times or min(times) > end:
+            break
+        now = min(max(min(times), now + 1) + STEP_MS, end)
+        due = [n for n in nodes if n.next is not None and n.next <= now]
+        for node in due:
+            node.send('RUN %d' % now)
+        arrived = []
+        for node in due:
+            arrived += node.receive()
+        for uplink in sorted(arrived, key=lambda u: u.start):
+            uplink.node.uplinks.append(uplink)
+            uplink.node.air_time += uplink.toa
+            uplink.node.tx_charge += uplink.toa * tx_current(args, uplink.power)
+            gateway.arrive(uplink, uplinks)
+            uplinks.append(uplink)
+            pending.append(uplink)
+        for uplink in sorted((u for u in pending if u.end <= now), key=lambda u: u.end):
+            if gateway.resolve(uplink, uplinks):
+                server.handle(uplink)
+        pending = [u for u in pending if u.end > now]
+        uplinks = [u for u in uplinks if u.end > now - 60000]
+        if now >= end:
+            break
+
+    for node in nodes:
+        node.send('RUN %d' % end)
+        node.send('END')
+    for node in nodes:
+        node.receive()
+        node.receive()
+        node.process.wait()
+    report(args, nodes, gateway, server, end)
+
+
+def tx_current(args, power):
+    """Radio current in mA while transmitting at power dBm, linear in the output power above a fixed part"""
+    floor = min(8.0, args.tx_ma)
+    return floor + (args.tx_ma - floor) * 10 ** ((power - 14) / 10)
+
+
+def percentile(values, p):
+    """Nearest-rank percentile of the sorted values"""
+    return values[max(int(math.ceil(p / 100 * len(values))) - 1, 0)]
+
+
+def report(args, nodes, gateway, server, end):
+    rows = []
+    for node in nodes:
+        sent = [u for u in node.uplinks if u.frame[0] in (0x40, 0x80)]
+        rssi = sent[-1].rssi if sent else (node.uplinks[-1].rssi if node.uplinks else float('nan'))
+        sleep_ms = max(end - node.air_time - node.rx_ms, 0)
+        energy = args.voltage * (node.tx_charge + node.rx_ms * args.rx_ma + sleep_ms * args.sleep_ua / 1000) / 1000
+        rows.append((node.index, node.distance, rssi, node.datarate, node.tx_power, node.samples, len(sent),
+                     len(node.delivered), len(node.delivered) / max(node.samples, 1), node.air_time / 1000, energy,
+                     energy / max(len(node.delivered), 1)))
+
+    print('%d devices within %d m, %.1f hours, %d s period, %d byte payloads, %s ADR%s' %
+          (args.nodes, args.radius, args.hours, args.period, args.size, 'no' if args.no_adr else 'with',
+           ', confirmed' if args.confirmed else ''))
+    if args.verbose:
+        print('%6s %7s %7s %4s %4s %8s %8s %8s %6s %8s %9s %9s' %
+              ('device', 'dist m', 'RSSI', 'DR', 'txp', 'samples', 'frames', 'dlvd', 'PDR', 'air s', 'J', 'mJ/smp'))
+        for row in rows:
+            print('%6d %7.0f %7.1f %4d %4d %8d %8d %8d %5.1f%% %8.1f %9.3f %9.3f' %
+                  (row[:8] + (100 * row[8], row[9], row[10] / 1000, row[11])))
+
+    samples = sum(r[5] for r in rows)
+    delivered = sum(r[7] for r in rows)
+    frames = [u for n in nodes for u in n.uplinks]
+    print('joined %d/%d, %d samples, %d delivered (%.1f%%), %.3f J per delivered sample' %
+          (sum(1 for n in nodes if n.joins), len(nodes), samples, delivered, 100 * delivered / max(samples, 1),
+           sum(r[10] for r in rows) / 1000 / max(delivered, 1)))
+    not_sent = {}
+    for node in nodes:
+        for status, count in node.not_sent.items():
+            not_sent[status] = not_sent.get(status, 0) + count
+    print('samples not sent by the MAC: %s' %
+          (', '.join('%s %d' % item for item in sorted(not_sent.items())) or 'none'))
+    causes = LOSS_CAUSES + (['fading'] if args.loss else [])
+    lost = {cause: sum(1 for u in frames if u.loss == cause) for cause in causes}
+    print('%d frames, lost: %s' % (len(frames), ', '.join('%s %d' % (c, lost[c]) for c in causes)))
+    if args.confirmed:
+        latencies = sorted(latency for n in nodes for latency in n.latencies)
+        acked = sum(n.acked for n in nodes)
+        not_acked = sum(n.not_acked for n in nodes)
+        print('confirmed: %d acknowledged, %d not acknowledged, %.2f frames per sample' %
+              (acked, not_acked, len([u for u in frames if u.frame[0] == 0x80]) / max(acked + not_acked, 1)))
+        if latencies:
+            print('delivery latency: p50 %.1f s, p90 %.1f s, p99 %.1f s, max %.1f s' %
+                  tuple(percentile(latencies, p) / 1000 for p in (50, 90, 99, 100)))
+    print('gateway: %d downlinks, %d dropped by the duty-cycle or half-duplex, %d MIC failures' %
+          (gateway.downlinks, gateway.downlinks_dropped, server.mic_failures))
+    print('%4s %8s %8s %8s' % ('SF', 'devices', 'frames', 'lost'))
+    for sf in range(7, 13):
+        sf_frames = [u for u in frames if u.sf == sf]
+        devices = sum(1 for n in nodes if n.datarate is not None and 12 - n.datarate == sf)
+        print('%4d %8d %8d %7.1f%%' % (sf, devices, len(sf_frames),
+                                       100 * sum(1 for u in sf_frames if u.loss) / max(len(sf_frames), 1)))
+
+    if args.csv:
+        with open(args.csv, 'w') as f:
+            f.write('device,distance_m,rssi_dbm,datarate,tx_power_index,samples,frames,delivered,pdr,air_time_s,'
+                    'energy_mj,energy_per_sample_mj\n')
+            for row in rows:
+                f.write('%d,%.0f,%.1f,%d,%d,%d,%d,%d,%.4f,%.3f,%.3f,%.3f\n' % row)
+
+
+if __name__ == '__main__':
+    import argparse
+
+    parser = argparse.ArgumentParser(description='Simulate a fleet of EU868 devices running the firmware LoRaMac.')
+    parser.add_argument('-n', '--nodes', type=int, default=50,
+                        help='number of devices (default: %(default)s)')
+    parser.add_argument('--hours', type=float, default=1.0,
+                        help='simulated time in hours (default: %(default)s)')
+    parser.add_argument('-p', '--period', type=int, default=300,
+                        help='uplink period in seconds after the join (default: %(default)s)')
+    parser.add_argument('-s', '--size', type=int, default=10,
+                        help='application payload size (default: %(default)s)')
+    parser.add_argument('-d', '--datarate', type=int, choices=range(MAX_DATARATE + 1), default=0,
+                        help='initial EU868 datarate (default: %(default)s)')
+    parser.add_argument('--no-adr', action='store_true',
+                        help='disable ADR on the devices')
+    parser.add_argument('--confirmed', action='store_true',
+                        help='send confirmed uplinks')
+    parser.add_argument('--nb-trials', type=int, default=8,
+                        help='transmissions of a confirmed uplink, at most 8 (default: %(default)s)')
+    parser.add_argument('--deadline', type=float, default=0,
+                        help='no retransmission of a confirmed uplink this many seconds after the request, '
+                             '0 for none (default: %(default)s)')
+    parser.add_argument('--backoff', choices=RETRANS_BACKOFFS, default='none',
+                        help='delay between the retransmissions of a confirmed uplink (default: %(default)s)')
+    parser.add_argument('--backoff-delay', type=float, default=0,
+                        help='base delay of the backoff in seconds (default: %(default)s)')
+    parser.add_argument('--backoff-max', type=float, default=0,
+                        help='maximum delay of the backoff in seconds, 0 for none (default: %(default)s)')
+    parser.add_argument('--jitter', type=int, default=0,
+                        help='random delay added to the backoff in percent of it (default: %(default)s)')
+    parser.add_argument('--retrans-dr', choices=RETRANS_DATARATES, default='step-down',
+                        help='datarate of the retransmissions (default: %(default)s)')
+    parser.add_argument('--loss', type=float, default=0,
+                        help='probability that a frame is lost to fading, on top of the modelled losses '
+                             '(default: %(default)s)')
+    parser.add_argument('--radius', type=float, default=3000,
+                        help='radius in m of the disc around the gateway (default: %(default)s)')
+    parser.add_argument('--shadowing', type=float, default=4.0,
+                        help='standard deviation of the shadowing in dB (default: %(default)s)')
+    parser.add_argument('--join-spread', type=int, default=600,
+                        help='the devices join within this many seconds (default: %(default)s)')
+    parser.add_argument('--orthogonal', action='store_true',
+                        help='spreading factors do not interfere with each other')
+    parser.add_argument('--seed', type=int, default=1,
+                        help='seed of the device placement, keys and radios (default: %(default)s)')
+    parser.add_argument('--tx-ma', type=float, default=24.0,
+                        help='radio current while transmitting at +14 dBm in mA (default: %(default)s)')
+    parser.add_argument('--rx-ma', type=float, default=5.0,
+                        help='radio current while receiving in mA (default: %(default)s)')
+    parser.add_argument('--sleep-ua', type=float, default=2.0,
+                        help='device current while sleeping in uA (default: %(default)s)')
+    parser.add_argument('--voltage', type=float, default=3.3,
+                        help='supply voltage in V (default: %(default)s)')
+    parser.add_argument('--csv', help='write the statistics of every device to this CSV file')
+    parser.add_argument('-v', '--verbose', action='store_true',
+                        help='print the statistics of every device')
+    simulate(parser.parse_args())
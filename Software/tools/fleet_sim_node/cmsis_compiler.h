@@ -0,0 +1,47 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cmsis_compiler.h
+ *
+ * @brief Stands in for the CMSIS compiler header in the host build used by fleet_sim.py
+ *
+ * The interrupt mask intrinsics of the critical sections of utilities_conf.h do nothing, the host programs run the
+ * code of the interrupts in their own thread.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#ifndef __CMSIS_COMPILER_H
+#define __CMSIS_COMPILER_H
+
+#include <stdint.h>
+
+static inline uint32_t __get_PRIMASK(void)
+{
+  return 0;
+}
+
+static inline void __set_PRIMASK(uint32_t priMask)
+{
+  (void)priMask;
+}
+
+static inline void __disable_irq(void)
+{
+}
+
+#endif /* __CMSIS_COMPILER_H */
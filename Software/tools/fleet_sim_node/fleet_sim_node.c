@@ -0,0 +1,763 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file fleet_sim_node.c
+ *
+ * @brief One simulated end device of fleet_sim.py: the firmware LoRaMac, timer server and
+ *        systime built for the host, driven in virtual time over stdin and stdout
+ *
+ * Usage: fleet_sim_node DEVEUI APPKEY SEED JOIN_AT_MS PERIOD_MS PAYLOAD_SIZE DATARATE ADR CONFIRMED
+ *        [NB_TRIALS DEADLINE_MS BACKOFF BACKOFF_DELAY_MS BACKOFF_MAX_DELAY_MS BACKOFF_JITTER RETRANS_DR]
+ *
+ * The optional arguments are the number of trials and the LoRaMacRetransPolicy_t of the confirmed
+ * uplinks, BACKOFF and RETRANS_DR are the values of LoRaMacRetransBackoff_t and LoRaMacRetransDatarate_t.
+ *
+ * Commands on stdin, one per line:
+ *  - RUN t: processes the timer and radio events up to t ms, then prints NEXT with the time of
+ *    the next event, or -1 if there is none
+ *  - DL t freq sf bw rssi snr frame: a downlink starting at t ms, received if an RX window
+ *    is open on the same frequency and spreading factor
+ *  - END: prints STATS and exits
+ *
+ * Events on stdout, one per line:
+ *  - TX t freq sf bw power toa frame
+ *  - UP t status: application uplink request, status is the LoRaMacStatus_t of the request
+ *  - JOIN t status: join confirmation, status is the LoRaMacEventInfoStatus_t
+ *  - RX t port size: downlink indication
+ *  - CONF t ack retries: confirmation of a confirmed uplink, ack is 1 if it was acknowledged
+ *  - STATS rx_ms datarate tx_power
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "LoRaMac.h"
+#include "LoRaMacTest.h"
+#include "Region.h"
+#include "radio.h"
+#include "stm32_timer.h"
+#include "stm32_systime.h"
+
+#define FLEET_SIM_NODE_APP_PORT 2
+#define FLEET_SIM_NODE_JOIN_RETRY_MS 10000U
+#define FLEET_SIM_NODE_LINE_SIZE 1024
+#define FLEET_SIM_NODE_MAX_FRAME_SIZE 255
+/* Same as SUBGRF_GetRadioWakeUpTime() + RADIO_WAKEUP_TIME with the GNSE TCXO */
+#define FLEET_SIM_NODE_RADIO_WAKEUP_MS 8U
+#define FLEET_SIM_NODE_NO_EVENT 0xFFFFFFFFU
+
+typedef enum
+{
+  RADIO_EVENT_NONE,
+  RADIO_EVENT_TX_DONE,
+  RADIO_EVENT_RX_DONE,
+  RADIO_EVENT_RX_TIMEOUT,
+} RadioEvent_t;
+
+typedef struct
+{
+  bool Pending;
+  uint32_t Time;
+  uint32_t Frequency;
+  uint32_t SpreadingFactor;
+  uint32_t Bandwidth;
+  int16_t Rssi;
+  int8_t Snr;
+  uint8_t Size;
+  uint8_t Frame[FLEET_SIM_NODE_MAX_FRAME_SIZE];
+} Downlink_t;
+
+/* Virtual time in ms, advanced by RUN */
+static uint32_t Now = 0;
+
+/* Low layer of the timer server */
+static uint32_t TimerContext = 0;
+static uint32_t AlarmTime = 0;
+static bool AlarmArmed = false;
+
+/* Low layer of systime */
+static uint32_t SysTimeBackupSeconds = 0;
+static uint32_t SysTimeBackupSubSeconds = 0;
+
+/* Radio state */
+static RadioEvents_t *RadioEvents = NULL;
+static RadioEvent_t PendingRadioEvent = RADIO_EVENT_NONE;
+static uint32_t PendingRadioEventTime = 0;
+static uint32_t RadioFrequency = 0;
+static int8_t TxPower = 0;
+static uint32_t TxSpreadingFactor = 0;
+static uint32_t TxBandwidth = 0;
+static uint32_t RxSpreadingFactor = 0;
+static uint32_t RxBandwidth = 0;
+static uint16_t RxSymbolTimeout = 0;
+static bool RxOn = false;
+static uint32_t RxStart = 0;
+static uint32_t RxTime = 0;
+static Downlink_t Downlink;
+static Downlink_t *ReceivedDownlink = NULL;
+
+/* Application state */
+static uint8_t DevEui[8];
+static uint8_t AppKey[16];
+static uint32_t Seed = 0;
+static uint32_t JoinAt = 0;
+static uint32_t Period = 0;
+static uint8_t PayloadSize = 0;
+static int8_t Datarate = DR_0;
+static bool AdrEnable = true;
+static bool Confirmed = false;
+static uint8_t NbTrials = 8;
+static LoRaMacRetransPolicy_t RetransPolicy = {0};
+static bool Joined = false;
+static bool JoinPending = false;
+static bool UplinkPending = false;
+static TimerEvent_t JoinTimer;
+static TimerEvent_t UplinkTimer;
+static uint8_t Payload[FLEET_SIM_NODE_MAX_FRAME_SIZE];
+
+static UTIL_TIMER_Status_t SimTimerInit(void)
+{
+  return UTIL_TIMER_OK;
+}
+
+static UTIL_TIMER_Status_t SimTimerStartEvent(uint32_t timeout)
+{
+  AlarmTime = TimerContext + timeout;
+  AlarmArmed = true;
+  return UTIL_TIMER_OK;
+}
+
+static UTIL_TIMER_Status_t SimTimerStopEvent(void)
+{
+  AlarmArmed = false;
+  return UTIL_TIMER_OK;
+}
+
+static uint32_t SimTimerSetContext(void)
+{
+  TimerContext = Now;
+  return TimerContext;
+}
+
+static uint32_t SimTimerGetContext(void)
+{
+  return TimerContext;
+}
+
+static uint32_t SimTimerGetElapsedTime(void)
+{
+  return Now - TimerContext;
+}
+
+static uint32_t SimTimerGetValue(void)
+{
+  return Now;
+}
+
+static uint32_t SimTimerGetMinimumTimeout(void)
+{
+  return 1;
+}
+
+static uint32_t SimTimerConvert(uint32_t value)
+{
+  return value;
+}
+
+const UTIL_TIMER_Driver_s UTIL_TimerDriver =
+{
+  SimTimerInit,
+  SimTimerInit,
+  SimTimerStartEvent,
+  SimTimerStopEvent,
+  SimTimerSetContext,
+  SimTimerGetContext,
+  SimTimerGetElapsedTime,
+  SimTimerGetValue,
+  SimTimerGetMinimumTimeout,
+  SimTimerConvert,
+  SimTimerConvert,
+};
+
+static void SimSysTimeWriteSeconds(uint32_t seconds)
+{
+  SysTimeBackupSeconds = seconds;
+}
+
+static uint32_t SimSysTimeReadSeconds(void)
+{
+  return SysTimeBackupSeconds;
+}
+
+static void SimSysTimeWriteSubSeconds(uint32_t subSeconds)
+{
+  SysTimeBackupSubSeconds = subSeconds;
+}
+
+static uint32_t SimSysTimeReadSubSeconds(void)
+{
+  return SysTimeBackupSubSeconds;
+}
+
+static uint32_t SimSysTimeGetCalendarTime(uint16_t *subSeconds)
+{
+  *subSeconds = (uint16_t)(Now % 1000U);
+  return Now / 1000U;
+}
+
+const UTIL_SYSTIM_Driver_s UTIL_SYSTIMDriver =
+{
+  SimSysTimeWriteSeconds,
+  SimSysTimeReadSeconds,
+  SimSysTimeWriteSubSeconds,
+  SimSysTimeReadSubSeconds,
+  SimSysTimeGetCalendarTime,
+};
+
+static uint32_t BandwidthInHz(uint32_t bandwidth)
+{
+  return 125000U << bandwidth;
+}
+
+static uint32_t SymbolTime(uint32_t spreadingFactor, uint32_t bandwidth)
+{
+  return ((1000U << spreadingFactor) + BandwidthInHz(bandwidth) - 1U) / BandwidthInHz(bandwidth);
+}
+
+static void SimRadioStopRx(void)
+{
+  if (RxOn == true)
+  {
+    RxTime += Now - RxStart;
+    RxOn = false;
+  }
+  if ((PendingRadioEvent == RADIO_EVENT_RX_DONE) || (PendingRadioEvent == RADIO_EVENT_RX_TIMEOUT))
+  {
+    PendingRadioEvent = RADIO_EVENT_NONE;
+  }
+}
+
+static void SimRadioInit(RadioEvents_t *events)
+{
+  RadioEvents = events;
+}
+
+static RadioState_t SimRadioGetStatus(void)
+{
+  if (PendingRadioEvent == RADIO_EVENT_TX_DONE)
+  {
+    return RF_TX_RUNNING;
+  }
+  return (RxOn == true) ? RF_RX_RUNNING : RF_IDLE;
+}
+
+static void SimRadioSetChannel(uint32_t freq)
+{
+  RadioFrequency = freq;
+}
+
+static bool SimRadioIsChannelFree(uint32_t freq, uint32_t rxBandwidth, int16_t rssiThresh, uint32_t maxCarrierSenseTime)
+{
+  return true;
+}
+
+static uint32_t SimRadioRandom(void)
+{
+  Seed = Seed * 1103515245U + 12345U;
+  return Seed;
+}
+
+static void SimRadioSetRxConfig(RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                             uint32_t bandwidthAfc, uint16_t preambleLen, uint16_t symbTimeout, bool fixLen,
+                             uint8_t payloadLen, bool crcOn, bool freqHopOn, uint8_t hopPeriod, bool iqInverted,
+                             bool rxContinuous)
+{
+  RxSpreadingFactor = datarate;
+  RxBandwidth = bandwidth;
+  RxSymbolTimeout = symbTimeout;
+}
+
+static void SimRadioSetTxConfig(RadioModems_t modem, int8_t power, uint32_t fdev, uint32_t bandwidth, uint32_t datarate,
+                             uint8_t coderate, uint16_t preambleLen, bool fixLen, bool crcOn, bool freqHopOn,
+                             uint8_t hopPeriod, bool iqInverted, uint32_t timeout)
+{
+  TxPower = power;
+  TxSpreadingFactor = datarate;
+  TxBandwidth = bandwidth;
+}
+
+static bool SimRadioCheckRfFrequency(uint32_t frequency)
+{
+  return true;
+}
+
+/* Same as RadioGetLoRaTimeOnAirNumerator() of the radio driver, LoRa only */
+static uint32_t SimRadioTimeOnAir(RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                               uint16_t preambleLen, bool fixLen, uint8_t payloadLen, bool crcOn)
+{
+  int32_t crDenom = coderate + 4;
+  bool lowDatarateOptimize = ((bandwidth == 0) && ((datarate == 11) || (datarate == 12))) ||
+                             ((bandwidth == 1) && (datarate == 12));
+  int32_t ceilDenominator = 4 * (int32_t)(lowDatarateOptimize ? (datarate - 2) : datarate);
+  int32_t ceilNumerator = (payloadLen << 3) + (crcOn ? 16 : 0) - (4 * (int32_t)datarate) + (fixLen ? 0 : 20) + 8;
+
+  if (ceilNumerator < 0)
+  {
+    ceilNumerator = 0;
+  }
+
+  int32_t intermediate = ((ceilNumerator + ceilDenominator - 1) / ceilDenominator) * crDenom + preambleLen + 12;
+  uint32_t numerator = 1000U * (uint32_t)((4 * intermediate + 1) * (1 << (datarate - 2)));
+
+  return (numerator + BandwidthInHz(bandwidth) - 1U) / BandwidthInHz(bandwidth);
+}
+
+static void SimRadioSend(uint8_t *buffer, uint8_t size)
+{
+  uint32_t toa = SimRadioTimeOnAir(MODEM_LORA, TxBandwidth, TxSpreadingFactor, 1, 8, false, size, true);
+
+  SimRadioStopRx();
+  printf("TX %u %u %u %u %d %u ", Now, RadioFrequency, TxSpreadingFactor, TxBandwidth, TxPower, toa);
+  for (uint8_t i = 0; i < size; i++)
+  {
+    printf("%02x", buffer[i]);
+  }
+  printf("\n");
+
+  PendingRadioEvent = RADIO_EVENT_TX_DONE;
+  PendingRadioEventTime = Now + toa;
+}
+
+static void SimRadioSleep(void)
+{
+  SimRadioStopRx();
+}
+
+static void SimRadioRx(uint32_t timeout)
+{
+  uint32_t symbolTime = SymbolTime(RxSpreadingFactor, RxBandwidth);
+  uint32_t windowEnd = Now + RxSymbolTimeout * symbolTime;
+
+  SimRadioStopRx();
+  RxOn = true;
+  RxStart = Now;
+  PendingRadioEvent = RADIO_EVENT_RX_TIMEOUT;
+  PendingRadioEventTime = windowEnd;
+
+  /* The preamble must start while the window is open, the radio locks on its last symbols */
+  if ((Downlink.Pending == true) && (Downlink.Frequency == RadioFrequency) &&
+      (Downlink.SpreadingFactor == RxSpreadingFactor) && (Downlink.Bandwidth == RxBandwidth) &&
+      ((Downlink.Time + 4U * symbolTime) >= Now) && (Downlink.Time <= windowEnd))
+  {
+    uint32_t toa = SimRadioTimeOnAir(MODEM_LORA, RxBandwidth, RxSpreadingFactor, 1, 8, false, Downlink.Size, false);
+
+    PendingRadioEvent = RADIO_EVENT_RX_DONE;
+    PendingRadioEventTime = ((Downlink.Time + toa) > Now) ? (Downlink.Time + toa) : (Now + 1U);
+  }
+}
+
+static void SimRadioSetTxContinuousWave(uint32_t freq, int8_t power, uint16_t time)
+{
+}
+
+static void SimRadioSetMaxPayloadLength(RadioModems_t modem, uint8_t max)
+{
+}
+
+static void SimRadioSetPublicNetwork(bool enable)
+{
+}
+
+static uint32_t SimRadioGetWakeupTime(void)
+{
+  return FLEET_SIM_NODE_RADIO_WAKEUP_MS;
+}
+
+const struct Radio_s Radio =
+{
+  .Init = SimRadioInit,
+  .GetStatus = SimRadioGetStatus,
+  .SetChannel = SimRadioSetChannel,
+  .IsChannelFree = SimRadioIsChannelFree,
+  .Random = SimRadioRandom,
+  .SetRxConfig = SimRadioSetRxConfig,
+  .SetTxConfig = SimRadioSetTxConfig,
+  .CheckRfFrequency = SimRadioCheckRfFrequency,
+  .TimeOnAir = SimRadioTimeOnAir,
+  .Send = SimRadioSend,
+  .Sleep = SimRadioSleep,
+  .Standby = SimRadioSleep,
+  .Rx = SimRadioRx,
+  .SetTxContinuousWave = SimRadioSetTxContinuousWave,
+  .SetMaxPayloadLength = SimRadioSetMaxPayloadLength,
+  .SetPublicNetwork = SimRadioSetPublicNetwork,
+  .GetWakeupTime = SimRadioGetWakeupTime,
+};
+
+static void OnMacProcessNotify(void)
+{
+}
+
+static void OnNvmContextChange(LoRaMacNvmCtxModule_t module)
+{
+}
+
+static void McpsConfirm(McpsConfirm_t *mcpsConfirm)
+{
+  if (mcpsConfirm->McpsRequest == MCPS_CONFIRMED)
+  {
+    printf("CONF %u %u %u\n", Now, mcpsConfirm->AckReceived, mcpsConfirm->NbRetries);
+  }
+}
+
+static void McpsIndication(McpsIndication_t *mcpsIndication)
+{
+  if ((mcpsIndication->Status == LORAMAC_EVENT_INFO_STATUS_OK) && (mcpsIndication->RxData == true))
+  {
+    printf("RX %u %u %u\n", Now, mcpsIndication->Port, mcpsIndication->BufferSize);
+  }
+}
+
+static void MlmeConfirm(MlmeConfirm_t *mlmeConfirm)
+{
+  if (mlmeConfirm->MlmeRequest != MLME_JOIN)
+  {
+    return;
+  }
+
+  printf("JOIN %u %u\n", Now, mlmeConfirm->Status);
+  if (mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK)
+  {
+    Joined = true;
+    UTIL_TIMER_Start(&UplinkTimer);
+  }
+  else
+  {
+    UTIL_TIMER_SetPeriod(&JoinTimer, FLEET_SIM_NODE_JOIN_RETRY_MS);
+    UTIL_TIMER_Start(&JoinTimer);
+  }
+}
+
+static void MlmeIndication(MlmeIndication_t *mlmeIndication)
+{
+}
+
+static void OnJoinTimerEvent(void *context)
+{
+  JoinPending = true;
+}
+
+static void OnUplinkTimerEvent(void *context)
+{
+  UplinkPending = true;
+}
+
+/* As LmHandlerJoin() */
+static void Join(void)
+{
+  MlmeReq_t mlmeReq;
+  LoRaMacStatus_t status;
+
+  mlmeReq.Type = MLME_JOIN;
+  mlmeReq.Req.Join.Datarate = Datarate;
+  status = LoRaMacMlmeRequest(&mlmeReq);
+  if (status != LORAMAC_STATUS_OK)
+  {
+    uint32_t retry = FLEET_SIM_NODE_JOIN_RETRY_MS;
+
+    if ((status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED) && (mlmeReq.ReqReturn.DutyCycleWaitTime > retry))
+    {
+      retry = mlmeReq.ReqReturn.DutyCycleWaitTime;
+    }
+    UTIL_TIMER_SetPeriod(&JoinTimer, retry);
+    UTIL_TIMER_Start(&JoinTimer);
+  }
+}
+
+/* As LmHandlerSend(), the sample is lost when the MAC cannot send it now */
+static void Send(void)
+{
+  McpsReq_t mcpsReq;
+  LoRaMacTxInfo_t txInfo;
+  LoRaMacStatus_t status = LORAMAC_STATUS_BUSY;
+
+  if (LoRaMacIsBusy() == false)
+  {
+    mcpsReq.Req.Unconfirmed.Datarate = Datarate;
+    if (LoRaMacQueryTxPossible(PayloadSize, &txInfo) != LORAMAC_STATUS_OK)
+    {
+      /* Send empty frame in order to flush MAC commands */
+      mcpsReq.Type = MCPS_UNCONFIRMED;
+      mcpsReq.Req.Unconfirmed.fBuffer = NULL;
+      mcpsReq.Req.Unconfirmed.fBufferSize = 0;
+      LoRaMacMcpsRequest(&mcpsReq, false);
+      status = LORAMAC_STATUS_LENGTH_ERROR;
+    }
+    else
+    {
+      mcpsReq.Type = (Confirmed == true) ? MCPS_CONFIRMED : MCPS_UNCONFIRMED;
+      mcpsReq.Req.Unconfirmed.fPort = FLEET_SIM_NODE_APP_PORT;
+      mcpsReq.Req.Unconfirmed.fBuffer = Payload;
+      mcpsReq.Req.Unconfirmed.fBufferSize = PayloadSize;
+      if (Confirmed == true)
+      {
+        mcpsReq.Req.Confirmed.NbTrials = NbTrials;
+        mcpsReq.Req.Confirmed.RetransPolicy = &RetransPolicy;
+      }
+      status = LoRaMacMcpsRequest(&mcpsReq, false);
+    }
+  }
+  printf("UP %u %u\n", Now, status);
+}
+
+static void Process(void)
+{
+  LoRaMacProcess();
+  if (JoinPending == true)
+  {
+    JoinPending = false;
+    Join();
+  }
+  if (UplinkPending == true)
+  {
+    UplinkPending = false;
+    Send();
+  }
+  LoRaMacProcess();
+}
+
+static void MibSet(MibRequestConfirm_t *mibReq)
+{
+  if (LoRaMacMibSetRequestConfirm(mibReq) != LORAMAC_STATUS_OK)
+  {
+    fprintf(stderr, "MIB %d failed\n", mibReq->Type);
+    exit(1);
+  }
+}
+
+/* As LmHandlerInit() and LmHandlerConfigure() */
+static void Setup(void)
+{
+  static LoRaMacPrimitives_t primitives = {McpsConfirm, McpsIndication, MlmeConfirm, MlmeIndication};
+  static LoRaMacCallback_t callbacks = {0};
+  MibRequestConfirm_t mibReq;
+
+  callbacks.NvmContextChange = OnNvmContextChange;
+  callbacks.MacProcessNotify = OnMacProcessNotify;
+  UTIL_TIMER_Init();
+  if (LoRaMacInitialization(&primitives, &callbacks, LORAMAC_REGION_EU868) != LORAMAC_STATUS_OK)
+  {
+    fprintf(stderr, "LoRaMacInitialization failed\n");
+    exit(1);
+  }
+
+  mibReq.Type = MIB_DEV_EUI;
+  mibReq.Param.DevEui = DevEui;
+  MibSet(&mibReq);
+  mibReq.Type = MIB_APP_KEY;
+  mibReq.Param.AppKey = AppKey;
+  MibSet(&mibReq);
+  mibReq.Type = MIB_NWK_KEY;
+  mibReq.Param.NwkKey = AppKey;
+  MibSet(&mibReq);
+  mibReq.Type = MIB_PUBLIC_NETWORK;
+  mibReq.Param.EnablePublicNetwork = true;
+  MibSet(&mibReq);
+  mibReq.Type = MIB_ADR;
+  mibReq.Param.AdrEnable = AdrEnable;
+  MibSet(&mibReq);
+  mibReq.Type = MIB_SYSTEM_MAX_RX_ERROR;
+  mibReq.Param.SystemMaxRxError = 20;
+  MibSet(&mibReq);
+  LoRaMacTestSetDutyCycleOn(true);
+  LoRaMacStart();
+
+  UTIL_TIMER_Create(&JoinTimer, JoinAt + 1U, UTIL_TIMER_ONESHOT, OnJoinTimerEvent, NULL);
+  UTIL_TIMER_Start(&JoinTimer);
+  UTIL_TIMER_Create(&UplinkTimer, Period, UTIL_TIMER_PERIODIC, OnUplinkTimerEvent, NULL);
+}
+
+static uint32_t NextEvent(void)
+{
+  uint32_t next = FLEET_SIM_NODE_NO_EVENT;
+
+  if (AlarmArmed == true)
+  {
+    next = AlarmTime;
+  }
+  if ((PendingRadioEvent != RADIO_EVENT_NONE) && (PendingRadioEventTime < next))
+  {
+    next = PendingRadioEventTime;
+  }
+  return next;
+}
+
+static void RunUntil(uint32_t target)
+{
+  uint32_t next;
+
+  while ((next = NextEvent()) <= target)
+  {
+    if (next > Now)
+    {
+      Now = next;
+    }
+    if ((PendingRadioEvent != RADIO_EVENT_NONE) && (PendingRadioEventTime <= Now))
+    {
+      RadioEvent_t event = PendingRadioEvent;
+
+      PendingRadioEvent = RADIO_EVENT_NONE;
+      switch (event)
+      {
+        case RADIO_EVENT_TX_DONE:
+          RadioEvents->TxDone();
+          break;
+        case RADIO_EVENT_RX_DONE:
+          RxTime += Now - RxStart;
+          RxOn = false;
+          Downlink.Pending = false;
+          ReceivedDownlink = &Downlink;
+          RadioEvents->RxDone(Downlink.Frame, Downlink.Size, Downlink.Rssi, Downlink.Snr);
+          break;
+        default:
+          RxTime += Now - RxStart;
+          RxOn = false;
+          RadioEvents->RxTimeout();
+          break;
+      }
+    }
+    else
+    {
+      AlarmArmed = false;
+      UTIL_TIMER_IRQ_Handler();
+    }
+    Process();
+  }
+  if (target > Now)
+  {
+    Now = target;
+  }
+}
+
+static bool ParseHex(const char *hex, uint8_t *buffer, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+  {
+    unsigned int value;
+
+    if (sscanf(&hex[2 * i], "%2x", &value) != 1)
+    {
+      return false;
+    }
+    buffer[i] = (uint8_t)value;
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  static char line[FLEET_SIM_NODE_LINE_SIZE];
+
+  if (((argc != 10) && (argc != 17)) || (strlen(argv[1]) != 16) || (strlen(argv[2]) != 32) ||
+      (ParseHex(argv[1], DevEui, sizeof(DevEui)) == false) || (ParseHex(argv[2], AppKey, sizeof(AppKey)) == false))
+  {
+    fprintf(stderr, "usage: %s DEVEUI APPKEY SEED JOIN_AT_MS PERIOD_MS PAYLOAD_SIZE DATARATE ADR CONFIRMED "
+            "[NB_TRIALS DEADLINE_MS BACKOFF BACKOFF_DELAY_MS BACKOFF_MAX_DELAY_MS BACKOFF_JITTER RETRANS_DR]\n", argv[0]);
+    return 1;
+  }
+  Seed = strtoul(argv[3], NULL, 0);
+  JoinAt = strtoul(argv[4], NULL, 0);
+  Period = strtoul(argv[5], NULL, 0);
+  PayloadSize = (uint8_t)strtoul(argv[6], NULL, 0);
+  Datarate = (int8_t)strtol(argv[7], NULL, 0);
+  AdrEnable = strtoul(argv[8], NULL, 0) != 0;
+  Confirmed = strtoul(argv[9], NULL, 0) != 0;
+  if (argc == 17)
+  {
+    NbTrials = (uint8_t)strtoul(argv[10], NULL, 0);
+    RetransPolicy.Deadline = strtoul(argv[11], NULL, 0);
+    RetransPolicy.Backoff = (LoRaMacRetransBackoff_t)strtoul(argv[12], NULL, 0);
+    RetransPolicy.BackoffDelay = strtoul(argv[13], NULL, 0);
+    RetransPolicy.BackoffMaxDelay = strtoul(argv[14], NULL, 0);
+    RetransPolicy.BackoffJitter = (uint8_t)strtoul(argv[15], NULL, 0);
+    RetransPolicy.Datarate = (LoRaMacRetransDatarate_t)strtoul(argv[16], NULL, 0);
+  }
+  for (uint8_t i = 0; i < PayloadSize; i++)
+  {
+    Payload[i] = (uint8_t)SimRadioRandom();
+  }
+
+  setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+  Setup();
+
+  while (fgets(line, sizeof(line), stdin) != NULL)
+  {
+    char frame[2 * FLEET_SIM_NODE_MAX_FRAME_SIZE + 1];
+    unsigned int time, frequency, spreadingFactor, bandwidth;
+    int rssi, snr;
+
+    if (strncmp(line, "RUN ", 4) == 0)
+    {
+      uint32_t next;
+
+      RunUntil(strtoul(&line[4], NULL, 0));
+      next = NextEvent();
+      if (next == FLEET_SIM_NODE_NO_EVENT)
+      {
+        printf("NEXT -1\n");
+      }
+      else
+      {
+        printf("NEXT %u\n", next);
+      }
+      fflush(stdout);
+    }
+    else if (sscanf(line, "DL %u %u %u %u %d %d %510s", &time, &frequency, &spreadingFactor, &bandwidth, &rssi, &snr,
+                    frame) == 7)
+    {
+      Downlink.Size = (uint8_t)(strlen(frame) / 2);
+      if (ParseHex(frame, Downlink.Frame, Downlink.Size) == true)
+      {
+        Downlink.Pending = true;
+        Downlink.Time = time;
+        Downlink.Frequency = frequency;
+        Downlink.SpreadingFactor = spreadingFactor;
+        Downlink.Bandwidth = bandwidth;
+        Downlink.Rssi = (int16_t)rssi;
+        Downlink.Snr = (int8_t)snr;
+      }
+    }
+    else if (strncmp(line, "END", 3) == 0)
+    {
+      MibRequestConfirm_t mibReq;
+      int8_t datarate;
+
+      SimRadioStopRx();
+      mibReq.Type = MIB_CHANNELS_DATARATE;
+      LoRaMacMibGetRequestConfirm(&mibReq);
+      datarate = mibReq.Param.ChannelsDatarate;
+      mibReq.Type = MIB_CHANNELS_TX_POWER;
+      LoRaMacMibGetRequestConfirm(&mibReq);
+      printf("STATS %u %d %d\n", RxTime, datarate, mibReq.Param.ChannelsTxPower);
+      fflush(stdout);
+      return 0;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,53 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file utilities_conf.h
+ *
+ * @brief Utilities configuration of the host build used by fleet_sim.py
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#ifndef __UTILITIES_CONF_H__
+#define __UTILITIES_CONF_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define UTIL_PLACE_IN_SECTION( __x__ )
+
+/* fleet_sim.py runs one node per process, LoRaMac instances on threads build with -DLORAMAC_THREAD_LOCAL=_Thread_local */
+#ifndef LORAMAC_THREAD_LOCAL
+#define LORAMAC_THREAD_LOCAL
+#endif
+
+#undef ALIGN
+#define ALIGN(n)             __attribute__((aligned(n)))
+
+#define UTILS_INIT_CRITICAL_SECTION()
+#define UTILS_ENTER_CRITICAL_SECTION()
+#define UTILS_EXIT_CRITICAL_SECTION()
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__UTILITIES_CONF_H__ */
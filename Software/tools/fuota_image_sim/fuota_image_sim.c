@@ -0,0 +1,433 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file fuota_image_sim.c
+ *
+ * @brief Update replay of fuota_image_tool.py: runs the FUOTA_IMAGE decoder built for the host through the
+ *        steps of Bootloader_Update on simulated MCU and external flash and measures them
+ *
+ * Usage: fuota_image_sim FILE BASE APP_SIZE REPEAT
+ *
+ * FILE is the update file, BASE the application in the MCU flash before the update or - for none. Every
+ * decoding step is run REPEAT times and the fastest run is kept. Results on stdout:
+ *  - HEADER type image_version image_size file_size
+ *  - STEP name decode_ns file_reads file_bytes base_reads base_bytes: Bootloader_VerifyUpdate (verify),
+ *    Bootloader_StageUpdate (stage, delta files only) and Bootloader_ProgramUpdate (program), decode_ns
+ *    includes the reads
+ *  - MCU page_erases rows double_words
+ *  - EXT bytes_read bytes_written block_erases
+ *  - RAM decoder_bytes buffer_bytes stack_bytes: FUOTA_IMAGE_Decoder_t, the bootloader flash_buffer with the
+ *    MCU_FLASH_WriteStream row buffer, and the host stack used by the update
+ *  - RESULT OK, or RESULT ERROR step reason
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "FUOTA_IMAGE.h"
+#include "stm32_crc.h"
+
+/* Same as MCU_FLASH_ROW_SIZE and FLASH_PAGE_SIZE of the STM32WL */
+#define SIM_ROW_SIZE 256U
+#define SIM_PAGE_SIZE 2048U
+#define SIM_STACK_PAINT_SIZE 32768
+#define SIM_STACK_PATTERN 0xA5U
+
+typedef struct
+{
+  const char *Name;
+  uint64_t DecodeNs;
+  uint32_t FileReads;
+  uint32_t FileBytes;
+  uint32_t BaseReads;
+  uint32_t BaseBytes;
+} SimStep_t;
+
+static uint8_t *File;
+static uint32_t FileSize;
+static uint8_t *McuFlash;
+static uint32_t AppSize;
+static uint8_t *Staging;
+static unsigned Repeat;
+
+/* Bootloader state, same sizes as bootloader.c and MCU_FLASH.c */
+static FUOTA_IMAGE_Decoder_t update_decoder;
+static uint8_t flash_buffer[SIM_ROW_SIZE];
+static uint64_t row_buffer[SIM_ROW_SIZE / sizeof(uint64_t)];
+
+static SimStep_t *Step;
+static uint32_t PageErases;
+static uint32_t Rows;
+static uint32_t DoubleWords;
+static uint32_t StagingRead;
+static uint32_t ExtWritten;
+static uint32_t BlockErases;
+static const char *Error;
+
+static volatile uint8_t *StackPainted = NULL;
+
+static uint64_t NowNs(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+static FUOTA_IMAGE_op_result_t FileRead(void *context, uint32_t offset, uint8_t *buffer, uint32_t length)
+{
+  if ((offset > FileSize) || (length > (FileSize - offset)))
+  {
+    return FUOTA_IMAGE_OP_FAIL;
+  }
+  memcpy(buffer, &File[offset], length);
+  Step->FileReads++;
+  Step->FileBytes += length;
+  return FUOTA_IMAGE_OP_SUCCESS;
+}
+
+static FUOTA_IMAGE_op_result_t AppRead(void *context, uint32_t offset, uint8_t *buffer, uint32_t length)
+{
+  if ((offset > AppSize) || (length > (AppSize - offset)))
+  {
+    return FUOTA_IMAGE_OP_FAIL;
+  }
+  memcpy(buffer, &McuFlash[offset], length);
+  Step->BaseReads++;
+  Step->BaseBytes += length;
+  return FUOTA_IMAGE_OP_SUCCESS;
+}
+
+typedef bool (*SimSource_t)(uint32_t offset, uint8_t *buffer, uint32_t length);
+
+static bool DecoderSource(uint32_t offset, uint8_t *buffer, uint32_t length)
+{
+  return FUOTA_IMAGE_Decode(&update_decoder, buffer, length) == FUOTA_IMAGE_OP_SUCCESS;
+}
+
+static bool StagingSource(uint32_t offset, uint8_t *buffer, uint32_t length)
+{
+  memcpy(buffer, &Staging[offset], length);
+  StagingRead += length;
+  return true;
+}
+
+static bool Program(uint32_t destination, const void *data, uint32_t length)
+{
+  for (uint32_t i = 0; i < length; i++)
+  {
+    if (McuFlash[destination + i] != 0xFFU)
+    {
+      Error = "programming a non-erased area";
+      return false;
+    }
+  }
+  memcpy(&McuFlash[destination], data, length);
+  return true;
+}
+
+/* Same steps as MCU_FLASH_WriteStream, with the page verification */
+static bool WriteStream(uint32_t destination, uint32_t length, SimSource_t source)
+{
+  uint32_t offset = 0U;
+  uint32_t verify_start = destination;
+  uint32_t verify_crc = UTIL_CRC32_INIT;
+
+  while (offset < length)
+  {
+    uint32_t remaining = length - offset;
+    uint32_t chunk;
+    uint32_t programmed;
+
+    if (((destination % SIM_ROW_SIZE) == 0U) && (remaining >= SIM_ROW_SIZE))
+    {
+      chunk = SIM_ROW_SIZE;
+      programmed = SIM_ROW_SIZE;
+      if (!source(offset, (uint8_t *)row_buffer, chunk) || !Program(destination, row_buffer, programmed))
+      {
+        return false;
+      }
+      Rows++;
+    }
+    else
+    {
+      chunk = (remaining < sizeof(uint64_t)) ? remaining : sizeof(uint64_t);
+      programmed = sizeof(uint64_t);
+      row_buffer[0] = UINT64_MAX;
+      if (!source(offset, (uint8_t *)row_buffer, chunk) || !Program(destination, row_buffer, programmed))
+      {
+        return false;
+      }
+      DoubleWords++;
+    }
+    verify_crc = UTIL_CRC32_Update(verify_crc, row_buffer, programmed);
+    destination += programmed;
+    offset += chunk;
+    if (((destination % SIM_PAGE_SIZE) == 0U) || (offset >= length))
+    {
+      if (UTIL_CRC32_Update(UTIL_CRC32_INIT, &McuFlash[verify_start], destination - verify_start) != verify_crc)
+      {
+        Error = "page check failure";
+        return false;
+      }
+      verify_start = destination;
+      verify_crc = UTIL_CRC32_INIT;
+    }
+  }
+  return true;
+}
+
+/* Decodes the whole file into flash_buffer like Bootloader_VerifyUpdate, or into the staging area like
+ * Bootloader_StageUpdate, once per repeat */
+static bool DecodeFile(SimStep_t *step, bool stage)
+{
+  for (unsigned run = 0; run < Repeat; run++)
+  {
+    uint64_t start;
+    uint64_t elapsed;
+    uint32_t length;
+
+    step->FileReads = step->FileBytes = step->BaseReads = step->BaseBytes = 0;
+    if (stage)
+    {
+      ExtWritten = 0;
+    }
+    start = NowNs();
+    if (FUOTA_IMAGE_DecoderInit(&update_decoder, FileSize, FileRead, AppRead, NULL) != FUOTA_IMAGE_OP_SUCCESS)
+    {
+      Error = "invalid header";
+      return false;
+    }
+    for (uint32_t offset = 0; offset < update_decoder.Header.ImageSize; offset += length)
+    {
+      length = update_decoder.Header.ImageSize - offset;
+      length = (length > sizeof(flash_buffer)) ? sizeof(flash_buffer) : length;
+      if (FUOTA_IMAGE_Decode(&update_decoder, flash_buffer, length) != FUOTA_IMAGE_OP_SUCCESS)
+      {
+        Error = "decoding failure";
+        return false;
+      }
+      if (stage)
+      {
+        memcpy(&Staging[offset], flash_buffer, length);
+        ExtWritten += length;
+      }
+    }
+    if (FUOTA_IMAGE_DecoderFinish(&update_decoder) != FUOTA_IMAGE_OP_SUCCESS)
+    {
+      Error = "image CRC mismatch";
+      return false;
+    }
+    elapsed = NowNs() - start;
+    if ((run == 0) || (elapsed < step->DecodeNs))
+    {
+      step->DecodeNs = elapsed;
+    }
+  }
+  return true;
+}
+
+/* Same steps as Bootloader_Update with one update file pending */
+static bool Update(SimStep_t steps[3])
+{
+  FUOTA_IMAGE_Header_t *header = &update_decoder.Header;
+  uint64_t start;
+  bool programmed;
+
+  steps[0].Name = "verify";
+  Step = &steps[0];
+  if (!DecodeFile(&steps[0], false))
+  {
+    return false;
+  }
+  if (header->ImageSize > AppSize)
+  {
+    Error = "image larger than the application area";
+    return false;
+  }
+
+  if (header->Type == FUOTA_IMAGE_TYPE_DELTA)
+  {
+    steps[1].Name = "stage";
+    Step = &steps[1];
+    if ((header->BaseSize > AppSize) || (UTIL_CRC32_Update(UTIL_CRC32_INIT, McuFlash, header->BaseSize) != header->BaseCrc))
+    {
+      Error = "base image mismatch";
+      return false;
+    }
+    if (header->ImageSize > FUOTA_IMAGE_STAGING_SIZE)
+    {
+      Error = "image larger than the staging area";
+      return false;
+    }
+    BlockErases = (header->ImageSize + FUOTA_IMAGE_BLOCK_SIZE - 1U) / FUOTA_IMAGE_BLOCK_SIZE;
+    if (!DecodeFile(&steps[1], true))
+    {
+      return false;
+    }
+  }
+
+  steps[2].Name = "program";
+  Step = &steps[2];
+  PageErases = (header->ImageSize + SIM_PAGE_SIZE - 1U) / SIM_PAGE_SIZE;
+  memset(McuFlash, 0xFF, PageErases * SIM_PAGE_SIZE);
+  start = NowNs();
+  if (header->Type == FUOTA_IMAGE_TYPE_DELTA)
+  {
+    programmed = WriteStream(0, header->ImageSize, StagingSource);
+  }
+  else
+  {
+    if (FUOTA_IMAGE_DecoderInit(&update_decoder, FileSize, FileRead, NULL, NULL) != FUOTA_IMAGE_OP_SUCCESS)
+    {
+      Error = "invalid header";
+      return false;
+    }
+    programmed = WriteStream(0, header->ImageSize, DecoderSource);
+  }
+  steps[2].DecodeNs = NowNs() - start;
+  if (!programmed)
+  {
+    if (Error == NULL)
+    {
+      Error = "decoding failure";
+    }
+    return false;
+  }
+  if (UTIL_CRC32_Update(UTIL_CRC32_INIT, McuFlash, header->ImageSize) != header->ImageCrc)
+  {
+    Error = "programmed image CRC mismatch";
+    return false;
+  }
+  return true;
+}
+
+/* Fills the stack below the caller with a pattern, the callee frames of the caller overwrite it */
+static __attribute__((noinline)) void StackPaint(void)
+{
+  volatile uint8_t area[SIM_STACK_PAINT_SIZE];
+
+  for (size_t i = 0; i < sizeof(area); i++)
+  {
+    area[i] = SIM_STACK_PATTERN;
+  }
+  StackPainted = area;
+}
+
+/* Bytes of the painted stack used since StackPaint(), from its deepest overwritten byte */
+static __attribute__((noinline)) size_t StackUsed(void)
+{
+  size_t unused = 0;
+
+  while ((unused < SIM_STACK_PAINT_SIZE) && (StackPainted[unused] == SIM_STACK_PATTERN))
+  {
+    unused++;
+  }
+  return SIM_STACK_PAINT_SIZE - unused;
+}
+
+static uint8_t *LoadFile(const char *path, uint32_t *size)
+{
+  FILE *f = fopen(path, "rb");
+  uint8_t *data;
+  long length;
+
+  if (f == NULL)
+  {
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  length = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  data = malloc((length > 0) ? (size_t)length : 1U);
+  if ((data != NULL) && (fread(data, 1, (size_t)length, f) != (size_t)length))
+  {
+    free(data);
+    data = NULL;
+  }
+  fclose(f);
+  *size = (uint32_t)length;
+  return data;
+}
+
+int main(int argc, char **argv)
+{
+  SimStep_t steps[3];
+  uint32_t base_size = 0;
+  uint8_t *base = NULL;
+  size_t stack;
+  bool ok;
+
+  if (argc != 5)
+  {
+    fprintf(stderr, "Usage: %s FILE BASE APP_SIZE REPEAT\n", argv[0]);
+    return 2;
+  }
+  File = LoadFile(argv[1], &FileSize);
+  if ((strcmp(argv[2], "-") != 0) && ((base = LoadFile(argv[2], &base_size)) == NULL))
+  {
+    fprintf(stderr, "Cannot read %s\n", argv[2]);
+    return 2;
+  }
+  AppSize = (uint32_t)strtoul(argv[3], NULL, 0);
+  Repeat = (unsigned)strtoul(argv[4], NULL, 0);
+  McuFlash = malloc(AppSize);
+  Staging = malloc(FUOTA_IMAGE_STAGING_SIZE);
+  if ((File == NULL) || (McuFlash == NULL) || (Staging == NULL) || (base_size > AppSize) || (Repeat == 0))
+  {
+    fprintf(stderr, "Invalid arguments\n");
+    return 2;
+  }
+  memset(McuFlash, 0xFF, AppSize);
+  if (base != NULL)
+  {
+    memcpy(McuFlash, base, base_size);
+  }
+  memset(steps, 0, sizeof(steps));
+
+  StackPaint();
+  ok = Update(steps);
+  stack = StackUsed();
+
+  printf("HEADER %u %u %u %u\n", update_decoder.Header.Type, update_decoder.Header.ImageVersion,
+         update_decoder.Header.ImageSize, FileSize);
+  for (unsigned i = 0; i < 3; i++)
+  {
+    if (steps[i].Name != NULL)
+    {
+      printf("STEP %s %llu %u %u %u %u\n", steps[i].Name, (unsigned long long)steps[i].DecodeNs, steps[i].FileReads,
+             steps[i].FileBytes, steps[i].BaseReads, steps[i].BaseBytes);
+    }
+  }
+  printf("MCU %u %u %u\n", PageErases, Rows, DoubleWords);
+  printf("EXT %u %u %u\n", steps[0].FileBytes + steps[1].FileBytes + steps[2].FileBytes + StagingRead, ExtWritten,
+         BlockErases);
+  printf("RAM %zu %zu %zu\n", sizeof(update_decoder), sizeof(flash_buffer) + sizeof(row_buffer), stack);
+  if (ok)
+  {
+    printf("RESULT OK\n");
+  }
+  else
+  {
+    printf("RESULT ERROR %s %s\n", Step->Name, Error);
+  }
+  return ok ? 0 : 1;
+}
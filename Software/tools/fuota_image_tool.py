@@ -0,0 +1,487 @@
+"""
+Copyright 2021 The Things Industries B.V.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+# Generates, verifies and replays FUOTA update files, see lib/FUOTA_IMAGE/FUOTA_IMAGE.h for the format. The replay
+# builds the FUOTA_IMAGE decoder for the host (see fuota_image_sim/fuota_image_sim.c), runs it through the steps of
+# the bootloader update and measures its RAM, its decoding time and the flash operations.
+
+import glob
+import hashlib
+import os
+import random
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+import zlib
+
+from fleet_sim import SOFTWARE_DIR, TOOLS_DIR
+
+FUOTA_IMAGE_MAGIC = 0x57464E47
+FUOTA_IMAGE_HEADER_VERSION = 1
+header_format = "<I4B5I"
+HEADER_SIZE = struct.calcsize(header_format)
+
+TYPE_RAW = 0
+TYPE_LZ = 1
+TYPE_DELTA = 2
+type_names = {'raw': TYPE_RAW, 'lz': TYPE_LZ, 'delta': TYPE_DELTA}
+
+TOKEN_LITERAL = 0
+TOKEN_WINDOW = 1
+TOKEN_BASE = 2
+TOKEN_LEN_EXTENDED = 0x3F
+
+# Must match the device configuration, see FUOTA_IMAGE.h and MCU_FLASH.h
+DECODER_WINDOW_SIZE = 512
+
+MIN_WINDOW_MATCH = 3
+MIN_BASE_MATCH = 6
+MAX_CHAIN = 32
+
+SIM_SOURCES = [os.path.join(TOOLS_DIR, 'fuota_image_sim', 'fuota_image_sim.c'),
+               os.path.join(SOFTWARE_DIR, 'lib', 'FUOTA_IMAGE', 'FUOTA_IMAGE.c'),
+               os.path.join(SOFTWARE_DIR, 'lib', 'Utilities', 'stm32_crc.c')]
+SIM_FLAGS = ['-DUTIL_CRC32_BACKEND=UTIL_CRC32_BACKEND_SLICE4', '-I' + os.path.join(SOFTWARE_DIR, 'lib', 'FUOTA_IMAGE'),
+             '-I' + os.path.join(SOFTWARE_DIR, 'lib', 'Utilities')]
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def zigzag(value):
+    return (value << 1) if value >= 0 else ((-value << 1) - 1)
+
+
+def token(op, length):
+    if length - 1 < TOKEN_LEN_EXTENDED:
+        return bytes([(op << 6) | (length - 1)])
+    return bytes([(op << 6) | TOKEN_LEN_EXTENDED]) + varint(length - TOKEN_LEN_EXTENDED - 1)
+
+
+def create_header(image_type, window_log2, version, image, base):
+    base_size = len(base) if image_type == TYPE_DELTA else 0
+    base_crc = (zlib.crc32(base) & 0xffffffff) if image_type == TYPE_DELTA else 0
+    return struct.pack(header_format, FUOTA_IMAGE_MAGIC, image_type, FUOTA_IMAGE_HEADER_VERSION, window_log2, 0,
+                       version, len(image), zlib.crc32(image) & 0xffffffff, base_size, base_crc)
+
+
+def match_length(a, a_pos, b, b_pos, limit):
+    length = 0
+    while length < limit and a[a_pos + length] == b[b_pos + length]:
+        length += 1
+    return length
+
+
+def index_base(base):
+    # 4 byte prefixes of the base image, most recent position first
+    index = {}
+    for pos in range(len(base) - 3):
+        index.setdefault(base[pos:pos + 4], []).append(pos)
+    return index
+
+
+def encode(image, base, image_type, window_size):
+    """Greedy LZ encoder, base references are only used for delta images"""
+    out = bytearray()
+    literals = bytearray()
+    window_heads = {}
+    base_index = index_base(base) if image_type == TYPE_DELTA else {}
+    last_delta = 0
+    pos = 0
+
+    def flush_literals():
+        if literals:
+            out.extend(token(TOKEN_LITERAL, len(literals)))
+            out.extend(literals)
+            literals.clear()
+
+    while pos < len(image):
+        best_op, best_len, best_ref = None, 0, 0
+        remaining = len(image) - pos
+        key = image[pos:pos + 4]
+
+        if image_type == TYPE_DELTA:
+            # Prefer the offset of the previous base copy, shifted code keeps matching there
+            candidates = [pos + last_delta] + base_index.get(key, [])[-MAX_CHAIN:]
+            for ref in candidates:
+                if 0 <= ref < len(base):
+                    length = match_length(image, pos, base, ref, min(remaining, len(base) - ref))
+                    if length > best_len:
+                        best_op, best_len, best_ref = TOKEN_BASE, length, ref
+
+        for ref in reversed(window_heads.get(image[pos:pos + 3], [])[-MAX_CHAIN:]):
+            if pos - ref > window_size:
+                break
+            length = match_length(image, pos, image, ref, remaining)
+            if length > best_len or (best_op == TOKEN_BASE and length == best_len):
+                best_op, best_len, best_ref = TOKEN_WINDOW, length, ref
+
+        if (best_op == TOKEN_WINDOW and best_len >= MIN_WINDOW_MATCH) or \
+           (best_op == TOKEN_BASE and best_len >= MIN_BASE_MATCH):
+            flush_literals()
+            out.extend(token(best_op, best_len))
+            if best_op == TOKEN_WINDOW:
+                out.extend(varint(pos - best_ref - 1))
+            else:
+                last_delta = best_ref - pos
+                out.extend(varint(zigzag(last_delta)))
+            step = best_len
+        else:
+            literals.append(image[pos])
+            step = 1
+
+        for i in range(pos, pos + step):
+            window_heads.setdefault(image[i:i + 3], []).append(i)
+        pos += step
+
+    flush_literals()
+    return bytes(out)
+
+
+def create(image, base, image_type, window_log2, version):
+    header = create_header(image_type, window_log2, version, image, base)
+    if image_type == TYPE_RAW:
+        return header + image
+    return header + encode(image, base, image_type, 1 << window_log2)
+
+
+class Decoder:
+    """Reference decoder of the generated files, mirrors FUOTA_IMAGE_Decode"""
+
+    def __init__(self, data, base):
+        if len(data) < HEADER_SIZE:
+            raise ValueError('file too small')
+        (self.magic, self.type, self.version, self.window_log2, _, self.image_version, self.image_size, self.image_crc,
+         self.base_size, self.base_crc) = struct.unpack_from(header_format, data)
+        if self.magic != FUOTA_IMAGE_MAGIC or self.version != FUOTA_IMAGE_HEADER_VERSION or self.type > TYPE_DELTA:
+            raise ValueError('not a FUOTA image')
+        if (1 << self.window_log2) > DECODER_WINDOW_SIZE:
+            raise ValueError('window of {} bytes exceeds the decoder window'.format(1 << self.window_log2))
+        if self.type == TYPE_DELTA:
+            if base is None:
+                raise ValueError('delta image requires the base image')
+            if len(base) != self.base_size or (zlib.crc32(base) & 0xffffffff) != self.base_crc:
+                raise ValueError('base image does not match the delta')
+        self.data = data
+        self.base = base
+
+    def read_byte(self, pos):
+        if pos >= len(self.data):
+            raise ValueError('token stream truncated')
+        return self.data[pos]
+
+    def read_varint(self, pos):
+        value, shift = 0, 0
+        while True:
+            byte = self.read_byte(pos)
+            pos += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value, pos
+
+    def decode(self):
+        out = bytearray()
+        pos = HEADER_SIZE
+        if self.type == TYPE_RAW:
+            if len(self.data) < pos + self.image_size:
+                raise ValueError('image truncated')
+            out.extend(self.data[pos:pos + self.image_size])
+            pos += self.image_size
+        while len(out) < self.image_size:
+            head = self.read_byte(pos)
+            pos += 1
+            op, length = head >> 6, (head & TOKEN_LEN_EXTENDED) + 1
+            if (head & TOKEN_LEN_EXTENDED) == TOKEN_LEN_EXTENDED:
+                value, pos = self.read_varint(pos)
+                length = value + TOKEN_LEN_EXTENDED + 1
+            if length > self.image_size - len(out):
+                raise ValueError('token past the end of the image')
+            if op == TOKEN_LITERAL:
+                if pos + length > len(self.data):
+                    raise ValueError('token stream truncated')
+                out.extend(self.data[pos:pos + length])
+                pos += length
+            elif op == TOKEN_WINDOW:
+                value, pos = self.read_varint(pos)
+                distance = value + 1
+                if distance > len(out) or distance > DECODER_WINDOW_SIZE:
+                    raise ValueError('window reference out of range')
+                for _ in range(length):
+                    out.append(out[-distance])
+            elif op == TOKEN_BASE and self.type == TYPE_DELTA:
+                value, pos = self.read_varint(pos)
+                ref = len(out) + ((value >> 1) ^ -(value & 1))
+                if ref < 0 or ref + length > self.base_size:
+                    raise ValueError('base reference out of range')
+                out.extend(self.base[ref:ref + length])
+            else:
+                raise ValueError('invalid token')
+        if (zlib.crc32(out) & 0xffffffff) != self.image_crc:
+            raise ValueError('CRC mismatch')
+        return bytes(out)
+
+
+def build_sim():
+    """Builds the update replay once per version of its sources, returns the executable"""
+    compiler = os.environ.get('CC', 'cc')
+    digest = hashlib.sha1(compiler.encode() + ''.join(SIM_FLAGS).encode())
+    for path in sorted(SIM_SOURCES + glob.glob(os.path.join(SOFTWARE_DIR, 'lib', 'FUOTA_IMAGE', '*.h')) +
+                       [os.path.join(SOFTWARE_DIR, 'lib', 'Utilities', 'stm32_crc.h')]):
+        with open(path, 'rb') as f:
+            digest.update(f.read())
+    binary = os.path.join(tempfile.gettempdir(), 'fuota_image_sim-%s' % digest.hexdigest()[:12])
+    if not os.path.exists(binary):
+        command = [compiler, '-O2', '-std=gnu11', '-w'] + SIM_FLAGS + SIM_SOURCES + ['-o', binary + '.tmp']
+        if subprocess.call(command) != 0:
+            sys.exit('Failed to build %s' % SIM_SOURCES[0])
+        os.replace(binary + '.tmp', binary)
+    return binary
+
+
+def run_sim(data, base, app_size, repeat):
+    """Replays the bootloader update of an update file with the C decoder, returns its measurements"""
+    with tempfile.TemporaryDirectory() as tmp:
+        paths = []
+        for name, content in (('update.img', data), ('base.bin', base)):
+            if content is None:
+                paths.append('-')
+                continue
+            paths.append(os.path.join(tmp, name))
+            with open(paths[-1], 'wb') as f:
+                f.write(content)
+        process = subprocess.run([build_sim()] + paths + [str(app_size), str(repeat)], stdout=subprocess.PIPE,
+                                 universal_newlines=True)
+    result = {'steps': {}}
+    for line in process.stdout.splitlines():
+        fields = line.split()
+        if fields[0] == 'HEADER':
+            result['type'], result['image_version'], result['image_size'], result['file_size'] = map(int, fields[1:])
+        elif fields[0] == 'STEP':
+            decode_ns, file_reads, file_bytes, base_reads, base_bytes = map(int, fields[2:])
+            result['steps'][fields[1]] = {'decode_ns': decode_ns, 'file_reads': file_reads, 'file_bytes': file_bytes,
+                                          'base_reads': base_reads, 'base_bytes': base_bytes}
+        elif fields[0] == 'MCU':
+            result['page_erases'], result['rows'], result['double_words'] = map(int, fields[1:])
+        elif fields[0] == 'EXT':
+            result['spi_read'], result['spi_write'], result['block_erases'] = map(int, fields[1:])
+        elif fields[0] == 'RAM':
+            result['decoder_bytes'], result['buffer_bytes'], result['stack_bytes'] = map(int, fields[1:])
+        elif fields[0] == 'RESULT' and fields[1] != 'OK':
+            raise ValueError('update failed in the {} step: {}'.format(fields[2], ' '.join(fields[3:])))
+    if process.returncode != 0 or 'decoder_bytes' not in result:
+        raise ValueError('update replay failed')
+    return result
+
+
+def flash_time(result, args):
+    """Flash part of the update time from the datasheet timings, in s: MCU flash, SPI transfers, external flash"""
+    t_mcu = result['page_erases'] * args.t_page_erase + result['rows'] * args.t_row + \
+        result['double_words'] * args.t_double_word
+    t_spi = (result['spi_read'] + result['spi_write']) * 8.0 / args.spi_hz
+    t_ext = result['block_erases'] * args.t_block_erase + (result['spi_write'] / 256.0) * args.t_ext_page
+    return t_mcu, t_spi, t_ext
+
+
+def simulate(data, base, args):
+    result = run_sim(data, base, args.app_size, args.repeat)
+    t_mcu, t_spi, t_ext = flash_time(result, args)
+    decode_ns = sum(step['decode_ns'] for step in result['steps'].values())
+    image_size = result['image_size']
+    frag_raw = (image_size + HEADER_SIZE + args.frag_size - 1) // args.frag_size
+    frag_file = (len(data) + args.frag_size - 1) // args.frag_size
+
+    print('image type:        {}'.format([k for k, v in type_names.items() if v == result['type']][0]))
+    print('image version:     {}'.format(result['image_version']))
+    print('image size:        {}'.format(image_size))
+    print('file size:         {}'.format(len(data)))
+    print('bytes saved:       {} ({:.1f}%)'.format(image_size - len(data), 100.0 * (image_size - len(data)) / image_size))
+    print('fragments:         {} instead of {} ({} bytes each)'.format(frag_file, frag_raw, args.frag_size))
+    print('RAM peak:          {} bytes static (decoder {}, buffers {}) + {} bytes of host stack'.format(
+        result['decoder_bytes'] + result['buffer_bytes'], result['decoder_bytes'], result['buffer_bytes'],
+        result['stack_bytes']))
+    for name, step in sorted(result['steps'].items(), key=lambda item: ['verify', 'stage', 'program'].index(item[0])):
+        print('{:<19}{:.2f} ms on the host, {} file reads ({} bytes), {} base reads ({} bytes)'.format(
+            name + ':', step['decode_ns'] / 1e6, step['file_reads'], step['file_bytes'], step['base_reads'],
+            step['base_bytes']))
+    print('MCU flash:         {} page erases, {} fast rows, {} double-words'.format(
+        result['page_erases'], result['rows'], result['double_words']))
+    print('external flash:    {} bytes read, {} bytes written, {} block erases'.format(
+        result['spi_read'], result['spi_write'], result['block_erases']))
+    print('flash time:        {:.0f} ms (MCU flash {:.0f} ms, SPI transfers {:.0f} ms, external flash {:.0f} ms)'.format(
+        1000.0 * (t_mcu + t_spi + t_ext), 1000.0 * t_mcu, 1000.0 * t_spi, 1000.0 * t_ext))
+    print('host decode time:  {:.2f} ms'.format(decode_ns / 1e6))
+
+
+def generate_images(size, changes, seed):
+    """Application-like binaries: instruction words drawn from a small vocabulary, repeated sequences and literal
+    pools, and the same binary after changes that insert, remove and patch code"""
+    rng = random.Random(seed)
+    words = [rng.getrandbits(16).to_bytes(2, 'little') for _ in range(600)]
+    base = bytearray()
+    while len(base) < size:
+        kind = rng.random()
+        if kind < 0.05:
+            base.extend(rng.getrandbits(32).to_bytes(4, 'little') * rng.randint(1, 4))
+        elif kind < 0.15 and len(base) > 512:
+            start = len(base) - rng.randrange(32, 512, 2)
+            base.extend(base[start:start + rng.randrange(8, 32, 2)])
+        else:
+            base.extend(words[min(int(rng.expovariate(0.02)), len(words) - 1)])
+    base = bytes(base[:size])
+    image = bytearray(base)
+    for _ in range(changes):
+        pos = rng.randrange(len(image))
+        length = rng.randint(2, 64)
+        kind = rng.random()
+        if kind < 0.4:
+            image[pos:pos] = bytes(rng.getrandbits(8) for _ in range(length))
+        elif kind < 0.7:
+            del image[pos:pos + length]
+        else:
+            image[pos:pos + length] = bytes(rng.getrandbits(8) for _ in range(len(image[pos:pos + length])))
+    return base, bytes(image)
+
+
+def bench(args):
+    """Creates raw, lz and delta files of generated images and replays the bootloader update of each"""
+    print('{:>8} {:>8} {:>6} {:>8} {:>8} {:>7} {:>7} {:>10} {:>10}'.format(
+        'size', 'changes', 'type', 'file', 'decoder', 'buffers', 'stack', 'decode ms', 'flash ms'))
+    for size in args.sizes:
+        for changes in args.changes:
+            base, image = generate_images(size, changes, args.seed)
+            for name in ('raw', 'lz', 'delta'):
+                data = create(image, base, type_names[name], 9, 1)
+                result = run_sim(data, base, args.app_size, args.repeat)
+                decode_ns = sum(step['decode_ns'] for step in result['steps'].values())
+                print('{:>8} {:>8} {:>6} {:>8} {:>8} {:>7} {:>7} {:>10.2f} {:>10.0f}'.format(
+                    len(image), changes, name, len(data), result['decoder_bytes'], result['buffer_bytes'],
+                    result['stack_bytes'], decode_ns / 1e6, 1000.0 * sum(flash_time(result, args))))
+                sys.stdout.flush()
+
+
+def read_file(f):
+    if f is None:
+        return None
+    data = f.read()
+    f.close()
+    return data
+
+
+if __name__ == '__main__':
+    import argparse
+
+    parser = argparse.ArgumentParser(description='Generate, verify and replay FUOTA update files.')
+    parser._optionals.title = "arguments"
+    subparsers = parser.add_subparsers(dest='command')
+
+    p_create = subparsers.add_parser('create', help='generate an update file')
+    p_create.add_argument('-a', '--app', type=argparse.FileType('rb'), required=True,
+                          help='path to the new application binary')
+    p_create.add_argument('-b', '--base', type=argparse.FileType('rb'),
+                          help='path to the application binary running on the device, required for delta')
+    p_create.add_argument('-t', '--type', choices=type_names.keys(), default='lz',
+                          help='update file type')
+    p_create.add_argument('-w', '--window-log2', type=int, default=9,
+                          help='log2 of the history window, at most the decoder window')
+    p_create.add_argument('-s', '--set-version', type=int, default=int(time.time()),
+                          help='set version number of the new application')
+    p_create.add_argument('-o', '--output', type=argparse.FileType('wb'), required=True,
+                          help='output update file path')
+
+    p_verify = subparsers.add_parser('verify', help='decode an update file and compare it with the application')
+    p_verify.add_argument('-i', '--input', type=argparse.FileType('rb'), required=True,
+                          help='path to the update file')
+    p_verify.add_argument('-a', '--app', type=argparse.FileType('rb'), required=True,
+                          help='path to the expected application binary')
+    p_verify.add_argument('-b', '--base', type=argparse.FileType('rb'),
+                          help='path to the base application binary for delta files')
+
+    p_simulate = subparsers.add_parser('simulate', help='replay the bootloader update with the C decoder')
+    p_simulate.add_argument('-i', '--input', type=argparse.FileType('rb'), required=True,
+                            help='path to the update file')
+    p_simulate.add_argument('-b', '--base', type=argparse.FileType('rb'),
+                            help='path to the base application binary for delta files')
+    p_simulate.add_argument('--frag-size', type=int, default=50,
+                            help='FUOTA fragment size in bytes')
+
+    p_bench = subparsers.add_parser('bench', help='replay the bootloader update of generated images')
+    p_bench.add_argument('--sizes', type=lambda s: [int(v, 0) for v in s.split(',')], default=[0x8000, 0x20000],
+                         help='comma-separated sizes of the generated applications')
+    p_bench.add_argument('--changes', type=lambda s: [int(v) for v in s.split(',')], default=[10, 100],
+                         help='comma-separated numbers of changes between the base and the new application')
+    p_bench.add_argument('--seed', type=int, default=1, help='seed of the generated images')
+
+    for p in (p_simulate, p_bench):
+        p.add_argument('--app-size', type=lambda s: int(s, 0), default=0x34000,
+                       help='size of the application flash area')
+        p.add_argument('--repeat', type=int, default=5,
+                       help='decoding runs of every step, the fastest is reported')
+        p.add_argument('--spi-hz', type=float, default=8e6,
+                       help='external flash SPI clock')
+        # Approximate typical timings, adjust to the datasheets of the parts in use
+        p.add_argument('--t-page-erase', type=float, default=22e-3,
+                       help='MCU flash page erase time in s')
+        p.add_argument('--t-row', type=float, default=2.7e-3,
+                       help='MCU flash fast row programming time in s')
+        p.add_argument('--t-double-word', type=float, default=82e-6,
+                       help='MCU flash double-word programming time in s')
+        p.add_argument('--t-block-erase', type=float, default=0.45,
+                       help='external flash 64 KByte block erase time in s')
+        p.add_argument('--t-ext-page', type=float, default=0.85e-3,
+                       help='external flash page program time in s')
+
+    args = parser.parse_args()
+
+    try:
+        if args.command == 'create':
+            image = read_file(args.app)
+            base = read_file(args.base)
+            image_type = type_names[args.type]
+            if image_type == TYPE_DELTA and base is None:
+                parser.error('delta files require --base')
+            if (1 << args.window_log2) > DECODER_WINDOW_SIZE:
+                parser.error('window larger than the decoder window of {} bytes'.format(DECODER_WINDOW_SIZE))
+            data = create(image, base if base is not None else b'', image_type, args.window_log2, args.set_version)
+            if Decoder(data, base).decode() != image:
+                raise ValueError('generated file does not decode to the application')
+            args.output.write(data)
+            args.output.close()
+            print('Update file:' + args.output.name)
+            print('{} -> {} bytes'.format(len(image), len(data)))
+        elif args.command == 'verify':
+            data = read_file(args.input)
+            image = read_file(args.app)
+            if Decoder(data, read_file(args.base)).decode() != image:
+                raise ValueError('decoded image does not match the application')
+            print('OK')
+        elif args.command == 'simulate':
+            simulate(read_file(args.input), read_file(args.base), args)
+        elif args.command == 'bench':
+            bench(args)
+        else:
+            parser.print_help()
+    except ValueError as e:
+        print('ERROR: {}'.format(e))
+        sys.exit(1)
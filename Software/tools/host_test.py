@@ -0,0 +1,98 @@
+"""
+Copyright 2021 The Things Industries B.V.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+# Builds and runs the host tests of the libraries. A test is a C program in host_test/ built with the library sources
+# it covers, see host_test/host_test.h, or with the LoRaWAN stack, see host_test/host_test_lorawan.h. It prints its checks and exits with an error when one of them fails, so
+# the script can be run in CI. With --bench, the tests that have a benchmark also run it and print its results.
+#
+#   $ python3 tools/host_test.py
+#   $ python3 tools/host_test.py fcnt_store --bench
+
+import glob
+import hashlib
+import os
+import subprocess
+import sys
+import tempfile
+
+from fleet_sim import NODE_DIR, SOFTWARE_DIR, TOOLS_DIR, build_node
+
+TEST_DIR = os.path.join(TOOLS_DIR, 'host_test')
+
+# Name: (library sources, include directories, defines), relative to the Software folder. The test program is
+# host_test/<name>_test.c, the headers of host_test/ are found first.
+TESTS = {
+    'boot_meta': (['lib/BOOT_META/BOOT_META.c', 'lib/Utilities/stm32_crc.c'], ['lib/BOOT_META', 'lib/Utilities'],
+                  ['UTIL_CRC32_BACKEND=UTIL_CRC32_BACKEND_SLICE4']),
+    'stm32_crc': (['lib/Utilities/stm32_crc.c'], ['lib/Utilities'], ['UTIL_CRC32_BACKEND=UTIL_CRC32_BACKEND_SLICE8']),
+    'fcnt_store': (['lib/FCNT_STORE/FCNT_STORE.c'], ['lib/FCNT_STORE'], ['FCNT_STORE_RESERVE_SIZE=4U']),
+    # The cmsis_compiler.h of the fleet_sim nodes stands in for CMSIS
+    'stm32_evt_trace': (['lib/Utilities/stm32_evt_trace.c'], ['tools/fleet_sim_node', 'lib/Utilities'], []),
+}
+
+# Name: defines of the tests built with the LoRaWAN stack by fleet_sim.build_node, with the lorawan_conf.h of host_test/
+LORAWAN_TESTS = {
+    'channel_bitmap': [],
+    'classb_schedule': ['LORAMAC_CLASSB_ENABLED=1'],
+    'fixed_point': ['LORAMAC_CLASSB_ENABLED=1'],
+    'mac_commands': [],
+    'phy_params': [],
+    'region_dispatch': [],
+    'se_instance': [],
+    'toa_table': [],
+}
+
+
+def build_test(name):
+    """Builds a test once per version of its sources, returns the executable"""
+    if name in LORAWAN_TESTS:
+        return build_node(name + '_test', (TEST_DIR, NODE_DIR), ['-D' + d for d in LORAWAN_TESTS[name]])
+    sources, includes, defines = TESTS[name]
+    sources = [os.path.join(TEST_DIR, name + '_test.c')] + [os.path.join(SOFTWARE_DIR, s) for s in sources]
+    includes = [TEST_DIR] + [os.path.join(SOFTWARE_DIR, i) for i in includes]
+    flags = ['-D' + d for d in defines]
+    compiler = os.environ.get('CC', 'cc')
+    digest = hashlib.sha1(compiler.encode() + ''.join(flags).encode())
+    for path in sorted(sources + sum((glob.glob(os.path.join(i, '*.h')) for i in includes), [])):
+        with open(path, 'rb') as f:
+            digest.update(f.read())
+    binary = os.path.join(tempfile.gettempdir(), '%s_test-%s' % (name, digest.hexdigest()[:12]))
+    if not os.path.exists(binary):
+        command = [compiler, '-O2', '-std=gnu11', '-Wall', '-Wno-unused-function'] + flags + \
+            ['-I' + i for i in includes] + sources + ['-lm', '-o', binary + '.tmp']
+        if subprocess.call(command) != 0:
+            sys.exit('Failed to build %s' % sources[0])
+        os.replace(binary + '.tmp', binary)
+    return binary
+
+
+if __name__ == '__main__':
+    import argparse
+
+    parser = argparse.ArgumentParser(description='Run the host tests of the libraries.')
+    parser.add_argument('tests', nargs='*', default=sorted(list(TESTS) + list(LORAWAN_TESTS)),
+                        help='tests to run (default: all): %s' % ' '.join(sorted(list(TESTS) + list(LORAWAN_TESTS))))
+    parser.add_argument('--bench', action='store_true', help='run the benchmarks of the tests too')
+    args = parser.parse_args()
+
+    failed = []
+    for name in args.tests:
+        if name not in TESTS and name not in LORAWAN_TESTS:
+            sys.exit('Unknown test %s' % name)
+        print('=== %s' % name)
+        sys.stdout.flush()
+        if subprocess.call([build_test(name)] + (['bench'] if args.bench else [])) != 0:
+            failed.append(name)
+    if failed:
+        sys.exit('Failed: %s' % ' '.join(failed))
+    print('%d tests passed' % len(args.tests))
@@ -0,0 +1,363 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file boot_meta_test.c
+ *
+ * @brief Host test of BOOT_META: the BOOT_META_SelectAction() table over valid and corrupt slots, confirmed,
+ *        partially confirmed and unconfirmed records and every trial count, the boots of the bootloader
+ *        on a simulated metadata area with interrupted and failing record writes, and the count of the boots over
+ *        the time budget
+ *
+ * The metadata area is a NOR model: a write only clears bits, an erase sets all bits. A power loss during a
+ * record write leaves its first bytes programmed and a random subset of the bits of the next byte cleared.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include <stddef.h>
+#include "host_test.h"
+#include "BOOT_META.h"
+
+#define BOOT_META_TEST_ROUNDS 12000U
+
+static uint8_t Area[BOOT_META_AREA_SIZE];
+/* Faults of the next write: bytes written before a power loss, 0 for none, or a failure */
+static uint32_t PowerLossAfter = 0;
+static bool WriteFails = false;
+static uint32_t Erases = 0;
+
+static BOOT_META_op_result_t TestRead(uint32_t offset, uint8_t *buffer, uint32_t length)
+{
+  if ((offset > sizeof(Area)) || (length > (sizeof(Area) - offset)))
+  {
+    return BOOT_META_OP_FAIL;
+  }
+  memcpy(buffer, &Area[offset], length);
+  return BOOT_META_OP_SUCCESS;
+}
+
+static BOOT_META_op_result_t TestWrite(uint32_t offset, const uint8_t *buffer, uint32_t length)
+{
+  if ((offset > sizeof(Area)) || (length > (sizeof(Area) - offset)) || WriteFails)
+  {
+    return BOOT_META_OP_FAIL;
+  }
+  if ((PowerLossAfter != 0) && (PowerLossAfter < length))
+  {
+    for (uint32_t i = 0; i < PowerLossAfter; i++)
+    {
+      Area[offset + i] &= buffer[i];
+    }
+    Area[offset + PowerLossAfter] &= buffer[PowerLossAfter] | (uint8_t)HostTestRandom();
+    return BOOT_META_OP_FAIL;
+  }
+  for (uint32_t i = 0; i < length; i++)
+  {
+    Area[offset + i] &= buffer[i];
+  }
+  return BOOT_META_OP_SUCCESS;
+}
+
+static BOOT_META_op_result_t TestErase(void)
+{
+  memset(Area, 0xFF, sizeof(Area));
+  Erases++;
+  return BOOT_META_OP_SUCCESS;
+}
+
+const BOOT_META_Driver_t BOOT_META_Driver =
+{
+  TestRead,
+  TestWrite,
+  TestErase,
+};
+
+/* Latest record after a reset, EMPTY when there is none */
+static BOOT_META_op_result_t Latest(BOOT_META_Record_t *record)
+{
+  HOST_TEST_CHECK(BOOT_META_Init() == BOOT_META_OP_SUCCESS);
+  return BOOT_META_Get(record);
+}
+
+static BOOT_META_Record_t Record(uint32_t version, bool confirmed)
+{
+  BOOT_META_Record_t record;
+
+  memset(&record, 0xFF, sizeof(record));
+  record.Version = version;
+  record.Size = 0x1000U + version;
+  record.Crc = version * 0x9E3779B9U;
+  record.BackupVersion = version - 1U;
+  record.BackupSize = 0x1000U + version - 1U;
+  record.BackupCrc = (version - 1U) * 0x9E3779B9U;
+  record.Trials = BOOT_META_TRIALS_NONE;
+  record.Confirmed = confirmed ? BOOT_META_CONFIRMED : 0xFFFFFFFFU;
+  return record;
+}
+
+static void TestTrialCount(void)
+{
+  for (uint32_t count = 0; count <= 32U; count++)
+  {
+    uint32_t trials = (count == 32U) ? 0U : (BOOT_META_TRIALS_NONE << count);
+
+    HOST_TEST_CHECK(BOOT_META_TrialCount(trials) == count);
+  }
+}
+
+static void TestSelectAction(void)
+{
+  static const uint32_t confirmed_words[] = { BOOT_META_CONFIRMED, 0xFFFFFFFFU, 0x55AAFFFFU, 0x55AA55A8U, 0U };
+  BOOT_META_Record_t record = Record(1, false);
+
+  HOST_TEST_CHECK(BOOT_META_SelectAction(NULL, false) == BOOT_META_ADOPT);
+  HOST_TEST_CHECK(BOOT_META_SelectAction(NULL, true) == BOOT_META_ADOPT);
+
+  for (uint32_t c = 0; c < (sizeof(confirmed_words) / sizeof(confirmed_words[0])); c++)
+  {
+    for (uint32_t count = 0; count <= 32U; count++)
+    {
+      BOOT_META_action_t expected;
+
+      record.Confirmed = confirmed_words[c];
+      record.Trials = (count == 32U) ? 0U : (BOOT_META_TRIALS_NONE << count);
+      /* A corrupt slot is always rolled back, only a fully programmed Confirmed word counts */
+      HOST_TEST_CHECK(BOOT_META_SelectAction(&record, false) == BOOT_META_ROLLBACK);
+      if (record.Confirmed == BOOT_META_CONFIRMED)
+      {
+        expected = BOOT_META_BOOT;
+      }
+      else
+      {
+        expected = (count < BOOT_META_MAX_TRIALS) ? BOOT_META_BOOT_TRIAL : BOOT_META_ROLLBACK;
+      }
+      HOST_TEST_CHECK(BOOT_META_SelectAction(&record, true) == expected);
+    }
+  }
+}
+
+/* Boots like Bootloader_CheckApp after a reset, returns the action */
+static BOOT_META_action_t Boot(bool image_valid, BOOT_META_Record_t *record)
+{
+  BOOT_META_action_t action;
+
+  HOST_TEST_CHECK(BOOT_META_Init() == BOOT_META_OP_SUCCESS);
+  switch (BOOT_META_Get(record))
+  {
+  case BOOT_META_OP_SUCCESS:
+    action = BOOT_META_SelectAction(record, image_valid);
+    break;
+  case BOOT_META_OP_EMPTY:
+    action = BOOT_META_SelectAction(NULL, false);
+    break;
+  default:
+    HOST_TEST_CHECK(false);
+    return BOOT_META_BOOT;
+  }
+  if (action == BOOT_META_BOOT_TRIAL)
+  {
+    HOST_TEST_CHECK(BOOT_META_UseTrial() == BOOT_META_OP_SUCCESS);
+  }
+  return action;
+}
+
+/* Adoption, trials, confirmation, rollback and a corrupt slot */
+static void TestBoots(void)
+{
+  BOOT_META_Record_t record;
+  BOOT_META_Record_t update;
+
+  TestErase();
+  HOST_TEST_CHECK(Boot(true, &record) == BOOT_META_ADOPT);
+  record = Record(1, true);
+  HOST_TEST_CHECK(BOOT_META_Append(&record) == BOOT_META_OP_SUCCESS);
+  for (uint32_t i = 0; i < 5U; i++)
+  {
+    HOST_TEST_CHECK(Boot(true, &record) == BOOT_META_BOOT);
+    HOST_TEST_CHECK(record.Version == 1U);
+  }
+
+  /* Confirmed during its last trial */
+  update = Record(2, false);
+  HOST_TEST_CHECK(BOOT_META_Append(&update) == BOOT_META_OP_SUCCESS);
+  for (uint32_t i = 0; i < BOOT_META_MAX_TRIALS; i++)
+  {
+    HOST_TEST_CHECK(Boot(true, &record) == BOOT_META_BOOT_TRIAL);
+    HOST_TEST_CHECK(record.Version == 2U);
+  }
+  HOST_TEST_CHECK(BOOT_META_Confirm() == BOOT_META_OP_SUCCESS);
+  HOST_TEST_CHECK(BOOT_META_Confirm() == BOOT_META_OP_SUCCESS);
+  for (uint32_t i = 0; i < 5U; i++)
+  {
+    HOST_TEST_CHECK(Boot(true, &record) == BOOT_META_BOOT);
+    HOST_TEST_CHECK(BOOT_META_TrialCount(record.Trials) == BOOT_META_MAX_TRIALS);
+  }
+
+  /* Never confirmed */
+  update = Record(3, false);
+  HOST_TEST_CHECK(BOOT_META_Append(&update) == BOOT_META_OP_SUCCESS);
+  for (uint32_t i = 0; i < BOOT_META_MAX_TRIALS; i++)
+  {
+    HOST_TEST_CHECK(Boot(true, &record) == BOOT_META_BOOT_TRIAL);
+  }
+  HOST_TEST_CHECK(Boot(true, &record) == BOOT_META_ROLLBACK);
+  HOST_TEST_CHECK((record.Version == 3U) && (record.BackupVersion == 2U));
+
+  /* The rollback records the restored backup as confirmed */
+  update = Record(2, true);
+  HOST_TEST_CHECK(BOOT_META_Append(&update) == BOOT_META_OP_SUCCESS);
+  HOST_TEST_CHECK(Boot(true, &record) == BOOT_META_BOOT);
+  HOST_TEST_CHECK(record.Version == 2U);
+
+  /* Corrupt slot, confirmed or not */
+  HOST_TEST_CHECK(Boot(false, &record) == BOOT_META_ROLLBACK);
+  update = Record(4, false);
+  HOST_TEST_CHECK(BOOT_META_Append(&update) == BOOT_META_OP_SUCCESS);
+  HOST_TEST_CHECK(Boot(false, &record) == BOOT_META_ROLLBACK);
+  HOST_TEST_CHECK(BOOT_META_TrialCount(record.Trials) == 0U);
+}
+
+/* Boots over the time budget are counted in the record of the application, up to 32, and do not change the action */
+static void TestOverruns(void)
+{
+  BOOT_META_Record_t record;
+  BOOT_META_Record_t update;
+
+  TestErase();
+  HOST_TEST_CHECK(BOOT_META_Init() == BOOT_META_OP_SUCCESS);
+  HOST_TEST_CHECK(BOOT_META_RecordOverrun() == BOOT_META_OP_EMPTY);
+  update = Record(1, false);
+  update.Overruns = 0;
+  HOST_TEST_CHECK(BOOT_META_Append(&update) == BOOT_META_OP_SUCCESS);
+  HOST_TEST_CHECK(Latest(&record) == BOOT_META_OP_SUCCESS);
+  HOST_TEST_CHECK(BOOT_META_TrialCount(record.Overruns) == 0U);
+  for (uint32_t count = 1; count <= 34U; count++)
+  {
+    HOST_TEST_CHECK(Boot(true, &record) == ((count <= BOOT_META_MAX_TRIALS) ? BOOT_META_BOOT_TRIAL :
+                                            BOOT_META_ROLLBACK));
+    HOST_TEST_CHECK(BOOT_META_RecordOverrun() == BOOT_META_OP_SUCCESS);
+    HOST_TEST_CHECK(Latest(&record) == BOOT_META_OP_SUCCESS);
+    HOST_TEST_CHECK(BOOT_META_TrialCount(record.Overruns) == ((count < 32U) ? count : 32U));
+    HOST_TEST_CHECK(record.Version == 1U);
+  }
+
+  /* A new application starts without any */
+  update = Record(2, true);
+  HOST_TEST_CHECK(BOOT_META_Append(&update) == BOOT_META_OP_SUCCESS);
+  HOST_TEST_CHECK(Boot(true, &record) == BOOT_META_BOOT);
+  HOST_TEST_CHECK(record.Overruns == 0xFFFFFFFFU);
+}
+
+/*
+ * Records appended with power losses and failures in the middle of the writes, until the area wraps several times.
+ * After a reset, the latest record is the new one if its words up to Check were written, the previous one otherwise.
+ * The previous records are lost when the area was erased for the new one.
+ */
+static void TestInterruptedAppends(void)
+{
+  BOOT_META_Record_t record;
+  BOOT_META_Record_t expected = Record(1, true);
+  bool expected_valid = true;
+  uint32_t version = 1;
+  uint32_t interrupted = 0;
+  uint32_t failed = 0;
+  uint32_t lost = 0;
+
+  TestErase();
+  Erases = 0;
+  HOST_TEST_CHECK(BOOT_META_Init() == BOOT_META_OP_SUCCESS);
+  HOST_TEST_CHECK(BOOT_META_Append(&expected) == BOOT_META_OP_SUCCESS);
+
+  for (uint32_t round = 0; round < BOOT_META_TEST_ROUNDS; round++)
+  {
+    BOOT_META_Record_t update = Record(++version, HostTestRandomBelow(2) == 0U);
+    uint32_t fault = HostTestRandomBelow(4);
+    uint32_t loss_after = (fault == 0U) ? 1U + HostTestRandomBelow(sizeof(update) - 1U) : 0U;
+    uint32_t erases = Erases;
+    BOOT_META_op_result_t result;
+
+    PowerLossAfter = loss_after;
+    WriteFails = fault == 1U;
+    result = BOOT_META_Append(&update);
+    PowerLossAfter = 0;
+    WriteFails = false;
+    if (Erases != erases)
+    {
+      expected_valid = false;
+    }
+
+    if (fault >= 2U)
+    {
+      HOST_TEST_CHECK(result == BOOT_META_OP_SUCCESS);
+      HOST_TEST_CHECK(Latest(&record) == BOOT_META_OP_SUCCESS);
+      HOST_TEST_CHECK(memcmp(&record, &update, sizeof(record)) == 0);
+    }
+    else if (fault == 1U)
+    {
+      HOST_TEST_CHECK(result == BOOT_META_OP_FAIL);
+      failed++;
+      /* Nothing usable until the reset */
+      HOST_TEST_CHECK(BOOT_META_Get(&record) == BOOT_META_OP_EMPTY);
+      result = Latest(&record);
+      HOST_TEST_CHECK(result == (expected_valid ? BOOT_META_OP_SUCCESS : BOOT_META_OP_EMPTY));
+      HOST_TEST_CHECK(!expected_valid || (memcmp(&record, &expected, sizeof(record)) == 0));
+    }
+    else
+    {
+      HOST_TEST_CHECK(result == BOOT_META_OP_FAIL);
+      interrupted++;
+      result = Latest(&record);
+      if ((result == BOOT_META_OP_SUCCESS) && (record.Version == update.Version))
+      {
+        /* Complete up to Check, a partially written Confirmed word leaves the application on trial */
+        HOST_TEST_CHECK((loss_after + 1U) >= offsetof(BOOT_META_Record_t, Trials));
+        HOST_TEST_CHECK(memcmp(&record, &update, offsetof(BOOT_META_Record_t, Trials)) == 0);
+        HOST_TEST_CHECK((record.Confirmed != BOOT_META_CONFIRMED) || (update.Confirmed == BOOT_META_CONFIRMED));
+      }
+      else
+      {
+        HOST_TEST_CHECK(result == (expected_valid ? BOOT_META_OP_SUCCESS : BOOT_META_OP_EMPTY));
+        HOST_TEST_CHECK(!expected_valid || (memcmp(&record, &expected, sizeof(record)) == 0));
+        lost += (expected_valid == false) ? 1U : 0U;
+      }
+    }
+    expected_valid = (result == BOOT_META_OP_SUCCESS);
+    if (expected_valid)
+    {
+      expected = record;
+      HOST_TEST_CHECK(BOOT_META_SelectAction(&record, true) ==
+                      ((record.Confirmed == BOOT_META_CONFIRMED) ? BOOT_META_BOOT : BOOT_META_BOOT_TRIAL));
+    }
+    else
+    {
+      HOST_TEST_CHECK(Boot(true, &record) == BOOT_META_ADOPT);
+    }
+  }
+  printf("%u records, %u interrupted, %u failed, %u area erases, %u with all records lost\n", BOOT_META_TEST_ROUNDS,
+         interrupted, failed, Erases, lost);
+  HOST_TEST_CHECK(Erases >= 2U);
+}
+
+int main(int argc, char **argv)
+{
+  TestTrialCount();
+  TestSelectAction();
+  TestBoots();
+  TestOverruns();
+  TestInterruptedAppends();
+  return HOST_TEST_RESULT();
+}
@@ -0,0 +1,175 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file channel_bitmap_test.c
+ *
+ * @brief Host test of the uplink channel selection of US915, AU915 and CN470: the channels bitmap must select the
+ *        channels of the linear scan of RegionCommonCountNbOfEnabledChannels
+ *
+ * Random channel plans of up to 96 channels, with random frequencies, datarate ranges, channels masks, datarates,
+ * joined state and band readiness, are counted by both functions. The enabled and restricted channels counts must be
+ * equal, and RegionCommonChannelsBitmapSelect must give the n-th channel of the list of the scan for every n, so
+ * that a randr() value selects the same channel. The benchmark counts and selects a channel on the default channel
+ * plan of each region at DR0, with the scan and with the bitmap.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include "host_test_lorawan.h"
+#include "RegionCommon.h"
+#include "RegionAU915.h"
+#include "RegionCN470.h"
+#include "RegionUS915.h"
+
+#define BITMAP_PLANS 200000U
+#define BITMAP_BENCH_SELECTIONS 2000000U
+#define BITMAP_MAX_CHANNELS (16U * REGION_COMMON_CHANNELS_BITMAP_SIZE)
+
+static const struct
+{
+  const char *Name;
+  LoRaMacRegion_t Region;
+  uint8_t MaxNbChannels;
+} Regions[] =
+{
+  { "US915", LORAMAC_REGION_US915, US915_MAX_NB_CHANNELS },
+  { "AU915", LORAMAC_REGION_AU915, AU915_MAX_NB_CHANNELS },
+  { "CN470", LORAMAC_REGION_CN470, CN470_MAX_NB_CHANNELS },
+};
+
+#define ARRAY_COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+static void RandomPlan(ChannelParams_t *channels, uint8_t maxNbChannels)
+{
+  memset(channels, 0, BITMAP_MAX_CHANNELS * sizeof(ChannelParams_t));
+  for (uint8_t i = 0; i < maxNbChannels; i++)
+  {
+    /* A quarter of the channels have no frequency, some datarate ranges are empty */
+    channels[i].Frequency = (HostTestRandomBelow(4) == 0U) ? 0U : 902300000U + (200000U * i);
+    channels[i].DrRange.Fields.Min = (int8_t)HostTestRandomBelow(8);
+    channels[i].DrRange.Fields.Max = (int8_t)HostTestRandomBelow(8);
+    channels[i].Band = 0;
+  }
+}
+
+static void TestPlan(void)
+{
+  static ChannelParams_t channels[BITMAP_MAX_CHANNELS];
+  RegionCommonChannelsBitmap_t bitmap;
+  uint16_t channelsMask[REGION_COMMON_CHANNELS_BITMAP_SIZE];
+  Band_t bands[REGION_COMMON_CHANNELS_BITMAP_BANDS] = { 0 };
+  RegionCommonCountNbOfEnabledChannelsParams_t params =
+  {
+    .ChannelsMask = channelsMask, .Channels = channels, .Bands = bands, .JoinChannels = 0
+  };
+  uint8_t listed[BITMAP_MAX_CHANNELS];
+  uint16_t enabledChannels[REGION_COMMON_CHANNELS_BITMAP_SIZE];
+  uint8_t nbListed = 0;
+  uint8_t nbListedRestricted = 0;
+  uint8_t nbEnabled = 0;
+  uint8_t nbRestricted = 0;
+
+  params.MaxNbChannels = (uint16_t)(1U + HostTestRandomBelow(BITMAP_MAX_CHANNELS));
+  RandomPlan(channels, (uint8_t)params.MaxNbChannels);
+  RegionCommonChannelsBitmapInit(&bitmap, channels, (uint8_t)params.MaxNbChannels);
+
+  /* Mask bits of the channels the region has, with a density of 1/8 to 1 */
+  for (uint16_t k = 0; k < REGION_COMMON_CHANNELS_BITMAP_SIZE; k++)
+  {
+    uint32_t density = HostTestRandomBelow(8);
+
+    channelsMask[k] = 0;
+    for (uint16_t j = 0; (j < 16U) && (((16U * k) + j) < params.MaxNbChannels); j++)
+    {
+      if (HostTestRandomBelow(8) <= density)
+      {
+        channelsMask[k] |= (uint16_t)(1U << j);
+      }
+    }
+  }
+  /* Datarates beyond the bitmap have no channel */
+  params.Datarate = (uint8_t)HostTestRandomBelow(REGION_COMMON_CHANNELS_BITMAP_DATARATES + 2U);
+  params.Joined = HostTestRandomBelow(2) != 0U;
+  bands[0].ReadyForTransmission = HostTestRandomBelow(4) != 0U;
+
+  RegionCommonCountNbOfEnabledChannels(&params, listed, &nbListed, &nbListedRestricted);
+  RegionCommonCountNbOfEnabledChannelsBitmap(&params, &bitmap, enabledChannels, &nbEnabled, &nbRestricted);
+
+  HOST_TEST_CHECK(nbEnabled == nbListed);
+  HOST_TEST_CHECK(nbRestricted == nbListedRestricted);
+  for (uint8_t n = 0; (n < nbListed) && (n < nbEnabled); n++)
+  {
+    HOST_TEST_CHECK(RegionCommonChannelsBitmapSelect(enabledChannels, n) == listed[n]);
+  }
+}
+
+static void Bench(void)
+{
+  for (uint32_t r = 0; r < ARRAY_COUNT(Regions); r++)
+  {
+    MibRequestConfirm_t mibChannels = { .Type = MIB_CHANNELS };
+    MibRequestConfirm_t mibMask = { .Type = MIB_CHANNELS_MASK };
+    RegionCommonChannelsBitmap_t bitmap;
+    Band_t bands[REGION_COMMON_CHANNELS_BITMAP_BANDS] = { 0 };
+    RegionCommonCountNbOfEnabledChannelsParams_t params = { .Joined = true, .Datarate = DR_0, .Bands = bands };
+    uint8_t listed[BITMAP_MAX_CHANNELS];
+    uint16_t enabledChannels[REGION_COMMON_CHANNELS_BITMAP_SIZE];
+    uint8_t nbEnabled;
+    uint8_t nbRestricted;
+    volatile uint32_t sink = 0;
+    uint64_t start;
+    double scan;
+
+    HOST_TEST_CHECK(HostTestLoRaWANInit(Regions[r].Region) == LORAMAC_STATUS_OK);
+    HOST_TEST_CHECK(LoRaMacMibGetRequestConfirm(&mibChannels) == LORAMAC_STATUS_OK);
+    HOST_TEST_CHECK(LoRaMacMibGetRequestConfirm(&mibMask) == LORAMAC_STATUS_OK);
+    params.Channels = mibChannels.Param.ChannelList;
+    params.ChannelsMask = mibMask.Param.ChannelsMask;
+    params.MaxNbChannels = Regions[r].MaxNbChannels;
+    bands[0].ReadyForTransmission = true;
+    RegionCommonChannelsBitmapInit(&bitmap, params.Channels, Regions[r].MaxNbChannels);
+
+    start = HostTestNowNs();
+    for (uint32_t i = 0; i < BITMAP_BENCH_SELECTIONS; i++)
+    {
+      RegionCommonCountNbOfEnabledChannels(&params, listed, &nbEnabled, &nbRestricted);
+      sink += listed[i % nbEnabled];
+    }
+    scan = (double)(HostTestNowNs() - start) / BITMAP_BENCH_SELECTIONS;
+    start = HostTestNowNs();
+    for (uint32_t i = 0; i < BITMAP_BENCH_SELECTIONS; i++)
+    {
+      RegionCommonCountNbOfEnabledChannelsBitmap(&params, &bitmap, enabledChannels, &nbEnabled, &nbRestricted);
+      sink += RegionCommonChannelsBitmapSelect(enabledChannels, (uint8_t)(i % nbEnabled));
+    }
+    printf("%s DR0 channel selection, %u channels: scan %.1f ns, bitmap %.1f ns\n", Regions[r].Name, nbEnabled, scan,
+           (double)(HostTestNowNs() - start) / BITMAP_BENCH_SELECTIONS);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  for (uint32_t i = 0; i < BITMAP_PLANS; i++)
+  {
+    TestPlan();
+  }
+  if (HOST_TEST_BENCH(argc, argv))
+  {
+    Bench();
+  }
+  return HOST_TEST_RESULT();
+}
@@ -0,0 +1,111 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file classb_schedule_test.c
+ *
+ * @brief Host test of the Class B ping slot schedule of the multicast groups, computed once per beacon period
+ *
+ * Within one beacon period, the multicast slots must use the reception parameters the group has when they open:
+ * the frequency and the ping period set up with LoRaMacMcChannelSetup, then changed with
+ * LoRaMacMcChannelSetupRxParams, and the floor plan frequency once the group is deleted. Rejected parameters must
+ * leave the schedule as it is.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include "host_test_lorawan.h"
+#include "LoRaMacTest.h"
+
+#define CLASSB_TEST_GROUP MULTICAST_0_ADDR
+#define CLASSB_TEST_ADDRESS 0x01FFFFFFU
+#define CLASSB_TEST_FREQUENCY 869100000U
+#define CLASSB_TEST_NEW_FREQUENCY 868500000U
+/* Floor plan frequency of the EU868 ping slots */
+#define CLASSB_TEST_EU868_FREQUENCY 869525000U
+#define CLASSB_TEST_INVALID_FREQUENCY 915000000U
+
+static uint8_t McAppSKey[16] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+                                 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+static uint8_t McNwkSKey[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F };
+
+/* Ping period of a periodicity, 4096 slots of a beacon window over 128 / 2^periodicity pings */
+static uint16_t PingPeriod(uint16_t periodicity)
+{
+  return 4096U / (128U >> periodicity);
+}
+
+static void CheckSchedule(uint32_t frequency, uint16_t periodicity)
+{
+  uint16_t pingPeriod = 0;
+
+  HOST_TEST_CHECK(LoRaMacTestMulticastSlotSchedule(CLASSB_TEST_GROUP, &pingPeriod) == frequency);
+  HOST_TEST_CHECK(pingPeriod == PingPeriod(periodicity));
+}
+
+static uint8_t SetupRxParams(uint32_t frequency, uint16_t periodicity)
+{
+  McRxParams_t rxParams;
+  uint8_t status = 0xFF;
+
+  rxParams.ClassB.Frequency = frequency;
+  rxParams.ClassB.Datarate = DR_3;
+  rxParams.ClassB.Periodicity = periodicity;
+  HOST_TEST_CHECK(LoRaMacMcChannelSetupRxParams(CLASSB_TEST_GROUP, &rxParams, &status) == LORAMAC_STATUS_OK);
+  return status;
+}
+
+int main(void)
+{
+  McChannelParams_t channel;
+
+  HOST_TEST_CHECK(HostTestLoRaWANInit(LORAMAC_REGION_EU868) == LORAMAC_STATUS_OK);
+
+  memset(&channel, 0, sizeof(channel));
+  channel.IsRemotelySetup = false;
+  channel.Class = CLASS_B;
+  channel.IsEnabled = true;
+  channel.GroupID = CLASSB_TEST_GROUP;
+  channel.Address = CLASSB_TEST_ADDRESS;
+  channel.McKeys.Session.McAppSKey = McAppSKey;
+  channel.McKeys.Session.McNwkSKey = McNwkSKey;
+  channel.FCountMin = 0;
+  channel.FCountMax = UINT32_MAX;
+  channel.RxParams.ClassB.Frequency = CLASSB_TEST_FREQUENCY;
+  channel.RxParams.ClassB.Datarate = DR_3;
+  channel.RxParams.ClassB.Periodicity = 4;
+  HOST_TEST_CHECK(LoRaMacMcChannelSetup(&channel) == LORAMAC_STATUS_OK);
+  CheckSchedule(CLASSB_TEST_FREQUENCY, 4);
+  /* Computed once, unchanged until something changes */
+  CheckSchedule(CLASSB_TEST_FREQUENCY, 4);
+
+  /* New reception parameters within the same beacon period */
+  HOST_TEST_CHECK(SetupRxParams(CLASSB_TEST_NEW_FREQUENCY, 2) == (CLASSB_TEST_GROUP & 0x03));
+  CheckSchedule(CLASSB_TEST_NEW_FREQUENCY, 2);
+
+  /* Rejected parameters are not applied */
+  HOST_TEST_CHECK(SetupRxParams(CLASSB_TEST_INVALID_FREQUENCY, 7) != (CLASSB_TEST_GROUP & 0x03));
+  CheckSchedule(CLASSB_TEST_NEW_FREQUENCY, 2);
+
+  HOST_TEST_CHECK(SetupRxParams(CLASSB_TEST_FREQUENCY, 5) == (CLASSB_TEST_GROUP & 0x03));
+  CheckSchedule(CLASSB_TEST_FREQUENCY, 5);
+
+  /* A deleted group has no frequency left */
+  HOST_TEST_CHECK(LoRaMacMcChannelDelete(CLASSB_TEST_GROUP) == LORAMAC_STATUS_OK);
+  CheckSchedule(CLASSB_TEST_EU868_FREQUENCY, 0);
+  return HOST_TEST_RESULT();
+}
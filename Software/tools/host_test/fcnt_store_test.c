@@ -0,0 +1,391 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file fcnt_store_test.c
+ *
+ * @brief Host test of FCNT_STORE: a device sends uplinks through the store on a simulated flash and backup
+ *        domain, with warm and cold resets, power losses in the middle of any flash or backup register write
+ *        and failing writes and erases, and no frame counter may ever be sent twice. An uplink that fails after its
+ *        frame counter was recorded is retried with the same frame counter
+ *
+ * The flash is a NOR model: a program only clears bits and a slot is programmed once, an erase sets all bits.
+ * An interrupted program leaves a random subset of the bits cleared, an interrupted erase a random subset of the
+ * bits set, and such a slot reads back as garbage or fails to read (ECC error).
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include "host_test.h"
+#include "FCNT_STORE.h"
+
+#define FCNT_STORE_TEST_MAX_FCNT (1U << 22)
+#define FCNT_STORE_TEST_EMPTY UINT64_MAX
+/* Consecutive refused uplinks before the device resets */
+#define FCNT_STORE_TEST_MAX_REFUSED 8U
+
+/* Flash and backup domain */
+static uint64_t Flash[FCNT_STORE_PAGE_COUNT][FCNT_STORE_SLOTS_PER_PAGE];
+static bool Ecc[FCNT_STORE_PAGE_COUNT][FCNT_STORE_SLOTS_PER_PAGE];
+static uint32_t BkUpFCnt = 0;
+static uint32_t BkUpCheck = 0;
+
+/* Faults, a power loss happens at the OpsToPowerLoss-th write when it is not 0 */
+static jmp_buf PowerLossJump;
+static uint32_t OpsToPowerLoss = 0;
+static uint32_t FailPercent = 0;
+/* Uplinks whose securing fails after their frame counter was recorded */
+static uint32_t CryptoFailPercent = 0;
+
+/* Statistics */
+static uint32_t SlotWrites = 0;
+static uint32_t PageErases = 0;
+static uint32_t PowerLosses = 0;
+
+/* Device */
+static uint8_t Used[FCNT_STORE_TEST_MAX_FCNT / 8];
+static uint32_t Sent = 0;
+static uint32_t Reused = 0;
+static uint32_t Refused = 0;
+static uint32_t CryptoFails = 0;
+static uint32_t ColdBoots = 0;
+static uint32_t WarmBoots = 0;
+static uint32_t LastSent = 0;
+static uint32_t MaxColdSkip = 0;
+static uint32_t MaxWarmSkip = 0;
+
+static bool PowerLoss(void)
+{
+  return (OpsToPowerLoss != 0) && (--OpsToPowerLoss == 0);
+}
+
+static bool WriteFails(void)
+{
+  return (FailPercent != 0) && (HostTestRandomBelow(100) < FailPercent);
+}
+
+static void PartialProgram(uint32_t page, uint32_t slot, uint64_t data)
+{
+  Flash[page][slot] = data | (HostTestRandom() & ~data);
+  Ecc[page][slot] = (Flash[page][slot] != data) && (Flash[page][slot] != FCNT_STORE_TEST_EMPTY) &&
+                    (HostTestRandomBelow(2) == 0);
+}
+
+static void PartialErase(uint32_t page)
+{
+  for (uint32_t slot = 0; slot < FCNT_STORE_SLOTS_PER_PAGE; slot++)
+  {
+    Flash[page][slot] = (HostTestRandomBelow(2) == 0) ? FCNT_STORE_TEST_EMPTY : (Flash[page][slot] | HostTestRandom());
+    Ecc[page][slot] = (Flash[page][slot] != FCNT_STORE_TEST_EMPTY) && (HostTestRandomBelow(2) == 0);
+  }
+}
+
+static FCNT_STORE_op_result_t SlotRead(uint32_t page, uint32_t slot, uint64_t *data)
+{
+  if (Ecc[page][slot])
+  {
+    return FCNT_STORE_OP_FAIL;
+  }
+  *data = Flash[page][slot];
+  return FCNT_STORE_OP_SUCCESS;
+}
+
+static FCNT_STORE_op_result_t SlotWrite(uint32_t page, uint32_t slot, uint64_t data)
+{
+  if ((page >= FCNT_STORE_PAGE_COUNT) || (slot >= FCNT_STORE_SLOTS_PER_PAGE))
+  {
+    HOST_TEST_CHECK(false);
+    return FCNT_STORE_OP_FAIL;
+  }
+  if ((Flash[page][slot] != FCNT_STORE_TEST_EMPTY) || Ecc[page][slot])
+  {
+    /* Programming error, a double word is only programmed once after an erase */
+    return FCNT_STORE_OP_FAIL;
+  }
+  SlotWrites++;
+  if (PowerLoss())
+  {
+    PartialProgram(page, slot, data);
+    longjmp(PowerLossJump, 1);
+  }
+  if (WriteFails())
+  {
+    PartialProgram(page, slot, data);
+    return FCNT_STORE_OP_FAIL;
+  }
+  Flash[page][slot] = data;
+  return FCNT_STORE_OP_SUCCESS;
+}
+
+static FCNT_STORE_op_result_t PageErase(uint32_t page)
+{
+  HOST_TEST_CHECK(page < FCNT_STORE_PAGE_COUNT);
+  PageErases++;
+  if (PowerLoss())
+  {
+    PartialErase(page);
+    longjmp(PowerLossJump, 1);
+  }
+  if (WriteFails())
+  {
+    PartialErase(page);
+    return FCNT_STORE_OP_FAIL;
+  }
+  memset(Flash[page], 0xFF, sizeof(Flash[page]));
+  memset(Ecc[page], 0, sizeof(Ecc[page]));
+  return FCNT_STORE_OP_SUCCESS;
+}
+
+static void BkUpWrite(uint32_t fcnt, uint32_t check)
+{
+  if (PowerLoss())
+  {
+    longjmp(PowerLossJump, 1);
+  }
+  BkUpFCnt = fcnt;
+  if (PowerLoss())
+  {
+    longjmp(PowerLossJump, 1);
+  }
+  BkUpCheck = check;
+}
+
+static void BkUpRead(uint32_t *fcnt, uint32_t *check)
+{
+  *fcnt = BkUpFCnt;
+  *check = BkUpCheck;
+}
+
+const FCNT_STORE_Driver_t FCNT_STORE_Driver =
+{
+  SlotRead,
+  SlotWrite,
+  PageErase,
+  BkUpWrite,
+  BkUpRead,
+};
+
+static void Transmit(uint32_t fcnt)
+{
+  HOST_TEST_CHECK(fcnt < FCNT_STORE_TEST_MAX_FCNT);
+  if (Used[fcnt / 8] & (1U << (fcnt % 8)))
+  {
+    Reused++;
+  }
+  Used[fcnt / 8] |= 1U << (fcnt % 8);
+  Sent++;
+  LastSent = fcnt;
+}
+
+/**
+ * @brief Runs the device until it sent a number of uplinks
+ * @param uplinks uplinks to send
+ * @param reset_every average uplinks between two resets
+ * @param power_loss_ops power loss after a random number of writes up to this, 0 for none
+ */
+static void Run(uint32_t uplinks, uint32_t reset_every, uint32_t power_loss_ops)
+{
+  static uint32_t target;
+  static uint32_t fcnt;
+  static uint32_t refused;
+  uint32_t next;
+
+  target = Sent + uplinks;
+  if (setjmp(PowerLossJump) != 0)
+  {
+    PowerLosses++;
+  }
+  while (Sent < target)
+  {
+    /* Boot, the backup domain is lost after a cold reset */
+    if (HostTestRandomBelow(2) == 0)
+    {
+      BkUpFCnt = 0;
+      BkUpCheck = 0;
+      ColdBoots++;
+    }
+    else
+    {
+      WarmBoots++;
+    }
+    OpsToPowerLoss = (power_loss_ops != 0) ? 1 + HostTestRandomBelow(power_loss_ops) : 0;
+
+    FCNT_STORE_Init();
+    fcnt = (FCNT_STORE_Restore(&next) == FCNT_STORE_OP_SUCCESS) ? next : 1;
+    if ((Sent != 0) && (power_loss_ops == 0) && (FailPercent == 0))
+    {
+      uint32_t skip = fcnt - (LastSent + 1);
+      if (BkUpCheck != 0)
+      {
+        MaxWarmSkip = (skip > MaxWarmSkip) ? skip : MaxWarmSkip;
+      }
+      else
+      {
+        MaxColdSkip = (skip > MaxColdSkip) ? skip : MaxColdSkip;
+      }
+    }
+
+    refused = 0;
+    while ((Sent < target) && (refused < FCNT_STORE_TEST_MAX_REFUSED))
+    {
+      if (FCNT_STORE_Update(fcnt) == FCNT_STORE_OP_SUCCESS)
+      {
+        if ((CryptoFailPercent != 0) && (HostTestRandomBelow(100) < CryptoFailPercent))
+        {
+          /* The uplink is not sent, the MAC retries with the same frame counter */
+          CryptoFails++;
+          continue;
+        }
+        Transmit(fcnt++);
+        refused = 0;
+        if (HostTestRandomBelow(reset_every) == 0)
+        {
+          break;
+        }
+      }
+      else
+      {
+        /* The MAC keeps the frame counter of a refused uplink */
+        Refused++;
+        refused++;
+      }
+    }
+  }
+  OpsToPowerLoss = 0;
+}
+
+static void Reset(void)
+{
+  memset(Flash, 0xFF, sizeof(Flash));
+  memset(Ecc, 0, sizeof(Ecc));
+  memset(Used, 0, sizeof(Used));
+  BkUpFCnt = 0;
+  BkUpCheck = 0;
+  FailPercent = 0;
+  CryptoFailPercent = 0;
+  SlotWrites = 0;
+  PageErases = 0;
+  PowerLosses = 0;
+  Sent = 0;
+  Reused = 0;
+  Refused = 0;
+  CryptoFails = 0;
+  ColdBoots = 0;
+  WarmBoots = 0;
+  LastSent = 0;
+  MaxColdSkip = 0;
+  MaxWarmSkip = 0;
+}
+
+static void Report(const char *name)
+{
+  printf("%-12s %7u sent %5u refused %5u cold %5u warm %5u power losses %6u slot writes %4u erases\n", name, Sent,
+         Refused, ColdBoots, WarmBoots, PowerLosses, SlotWrites, PageErases);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t next;
+  uint32_t writes;
+
+  /* Resets only: exact after a warm reset, at most one reserved block skipped after a cold one, one slot write
+     per block and per cold reset */
+  Reset();
+  Run(20000, 100, 0);
+  Report("resets");
+  HOST_TEST_CHECK(Reused == 0);
+  HOST_TEST_CHECK(Refused == 0);
+  HOST_TEST_CHECK(MaxWarmSkip == 0);
+  HOST_TEST_CHECK(MaxColdSkip <= FCNT_STORE_RESERVE_SIZE);
+  HOST_TEST_CHECK(SlotWrites <= (Sent / FCNT_STORE_RESERVE_SIZE) + ColdBoots + 1);
+  HOST_TEST_CHECK(PageErases <= (SlotWrites / FCNT_STORE_SLOTS_PER_PAGE) + 1);
+
+  /* A frame counter below the restored one is refused */
+  FCNT_STORE_Init();
+  HOST_TEST_CHECK(FCNT_STORE_Restore(&next) == FCNT_STORE_OP_SUCCESS);
+  HOST_TEST_CHECK(FCNT_STORE_Update(next - 1) == FCNT_STORE_OP_FAIL);
+  HOST_TEST_CHECK(FCNT_STORE_Update(LastSent) == FCNT_STORE_OP_FAIL);
+  HOST_TEST_CHECK(FCNT_STORE_Update(next) == FCNT_STORE_OP_SUCCESS);
+
+  /* Securing the uplink failed after its frame counter was recorded: the retry with the same frame counter is
+     accepted without any write, until the next frame counter is recorded or the device resets */
+  writes = SlotWrites;
+  HOST_TEST_CHECK(FCNT_STORE_Update(next) == FCNT_STORE_OP_SUCCESS);
+  HOST_TEST_CHECK(FCNT_STORE_Update(next) == FCNT_STORE_OP_SUCCESS);
+  HOST_TEST_CHECK(SlotWrites == writes);
+  HOST_TEST_CHECK(BkUpFCnt == next + 1U);
+  HOST_TEST_CHECK(FCNT_STORE_Update(next - 1U) == FCNT_STORE_OP_FAIL);
+  HOST_TEST_CHECK(FCNT_STORE_Update(next + 1U) == FCNT_STORE_OP_SUCCESS);
+  HOST_TEST_CHECK(FCNT_STORE_Update(next) == FCNT_STORE_OP_FAIL);
+  HOST_TEST_CHECK(FCNT_STORE_Update(next + 1U) == FCNT_STORE_OP_SUCCESS);
+  FCNT_STORE_Init();
+  HOST_TEST_CHECK(FCNT_STORE_Update(next + 1U) == FCNT_STORE_OP_FAIL);
+  HOST_TEST_CHECK(FCNT_STORE_Update(next + 2U) == FCNT_STORE_OP_SUCCESS);
+
+  /* Uplinks failing after their frame counter was recorded, and resets */
+  Reset();
+  CryptoFailPercent = 20;
+  Run(20000, 100, 0);
+  Report("crypto fail");
+  HOST_TEST_CHECK(Reused == 0);
+  HOST_TEST_CHECK(Refused == 0);
+  HOST_TEST_CHECK(CryptoFails > 1000);
+  HOST_TEST_CHECK(MaxWarmSkip == 0);
+
+  /* Power losses in the middle of the writes */
+  Reset();
+  Run(200000, 50, 40);
+  Report("power loss");
+  HOST_TEST_CHECK(Reused == 0);
+  HOST_TEST_CHECK(PowerLosses > 1000);
+
+  /* Failing writes and erases, and power losses */
+  Reset();
+  FailPercent = 10;
+  Run(100000, 50, 200);
+  Report("write fail");
+  HOST_TEST_CHECK(Reused == 0);
+  HOST_TEST_CHECK(Refused > 0);
+
+  /* Flash never written by the store: page 0 is erased before its first slot is written */
+  Reset();
+  for (uint32_t page = 0; page < FCNT_STORE_PAGE_COUNT; page++)
+  {
+    for (uint32_t slot = 0; slot < FCNT_STORE_SLOTS_PER_PAGE; slot++)
+    {
+      Flash[page][slot] = HostTestRandom() & ~(uint64_t)HostTestRandomBelow(2);
+    }
+  }
+  FCNT_STORE_Init();
+  HOST_TEST_CHECK(FCNT_STORE_Restore(&next) == FCNT_STORE_OP_EMPTY);
+  HOST_TEST_CHECK(PageErases == 1);
+  Run(5000, 1000, 0);
+  Report("garbage");
+  HOST_TEST_CHECK(Reused == 0);
+  HOST_TEST_CHECK(Refused == 0);
+
+  /* A blank flash is not erased */
+  Reset();
+  FCNT_STORE_Init();
+  HOST_TEST_CHECK(FCNT_STORE_Restore(&next) == FCNT_STORE_OP_EMPTY);
+  HOST_TEST_CHECK(PageErases == 0);
+
+  (void)argc;
+  (void)argv;
+  return HOST_TEST_RESULT();
+}
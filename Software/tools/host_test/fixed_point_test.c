@@ -0,0 +1,194 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file fixed_point_test.c
+ *
+ * @brief Host test of the fixed point TX power and Class B temperature compensation against the float code they
+ *        replace
+ *
+ * RegionCommonComputeTxPower takes the maximum EIRP and the antenna gain in dB Q8.8. It must give the TX power of the
+ * float version for every Q8.8 EIRP from 0 to 40 dBm with the gains up to 3 dB and all the TX power indexes, and for
+ * the dB constants of the regions converted with LORAMAC_DB_TO_Q. The temperature compensation of Class B, computed
+ * in Q8.8 degrees and a Q48 coefficient, is checked for the periods up to a beacon interval and the temperatures of
+ * -40 to 85 degrees against the float version and the compensation computed in double: both roundings down to the ms
+ * may differ by 1 ms, the float one being the less accurate, and the numbers of periods equal to each are printed.
+ * Beyond 128 degrees from the turnover the temperature is clamped, the compensation must then be the one of the
+ * clamped temperature.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include "host_test_lorawan.h"
+#include "LoRaMacTest.h"
+#include "RegionCommon.h"
+
+#define FIXED_POINT_MAX_EIRP_Q (40 * 256)
+#define FIXED_POINT_MAX_GAIN_Q (3 * 256)
+#define FIXED_POINT_MAX_PERIOD 128000U
+#define FIXED_POINT_MIN_TEMPERATURE (-40)
+#define FIXED_POINT_MAX_TEMPERATURE 85
+/* Turnover of the compensation and its clamp, in degrees */
+#define FIXED_POINT_TURNOVER ((int32_t)(RTC_TEMP_TURNOVER - RTC_TEMP_DEV_TURNOVER))
+#define FIXED_POINT_CLAMP 128
+
+/* dB constants of the regions and applications */
+static const float Gains[] = { 0.0f, 2.15f, 1.5f, 3.0f, 6.0f };
+static const float Eirps[] = { 2.0f, 10.0f, 12.5f, 14.0f, 16.0f, 20.0f, 27.0f, 30.0f, 36.0f };
+
+#define ARRAY_COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+static float FloorFloat(float x)
+{
+  float truncated = (float)(int32_t)x;
+
+  return (truncated > x) ? (truncated - 1.0f) : truncated;
+}
+
+/* RegionCommonComputeTxPower before Q8.8 */
+static int8_t FloatTxPower(int8_t txPowerIndex, float maxEirp, float antennaGain)
+{
+  return (int8_t)FloorFloat((maxEirp - (txPowerIndex * 2U)) - antennaGain);
+}
+
+/* TimerTempCompensation of LoRaMacClassB.c before Q8.8 */
+static uint32_t FloatTempCompensation(uint32_t period, float temperature)
+{
+  float k = RTC_TEMP_COEFFICIENT;
+  float kDev = RTC_TEMP_DEV_COEFFICIENT;
+  float t = RTC_TEMP_TURNOVER;
+  float tDev = RTC_TEMP_DEV_TURNOVER;
+  float interim = 0.0f;
+  float ppm = 0.0f;
+
+  if (k < 0.0f)
+  {
+    ppm = (k - kDev);
+  }
+  else
+  {
+    ppm = (k + kDev);
+  }
+  interim = (temperature - (t - tDev));
+  ppm *= interim * interim;
+  interim = ((float)period * ppm) / 1000000.0f;
+  interim += period;
+  interim = FloorFloat(interim);
+  if (interim < 0.0f)
+  {
+    interim = (float)period;
+  }
+  return (uint32_t)interim;
+}
+
+/* Temperature compensation in double, rounded down to the ms */
+static uint32_t DoubleTempCompensation(uint32_t period, int32_t temperature)
+{
+  double ppm = (RTC_TEMP_COEFFICIENT < 0.0) ? (RTC_TEMP_COEFFICIENT - RTC_TEMP_DEV_COEFFICIENT) :
+                                              (RTC_TEMP_COEFFICIENT + RTC_TEMP_DEV_COEFFICIENT);
+  double delta = (double)temperature - (RTC_TEMP_TURNOVER - RTC_TEMP_DEV_TURNOVER);
+  double interim = (double)period + (((double)period * ppm * delta * delta) / 1000000.0);
+  uint32_t truncated = (uint32_t)interim;
+
+  return ((double)truncated > interim) ? (truncated - 1U) : truncated;
+}
+
+/* Checks a compensation against a reference, true when they are equal */
+static bool CheckCompensation(uint32_t fixed, uint32_t reference)
+{
+  HOST_TEST_CHECK((fixed == reference) || (fixed + 1U == reference) || (fixed == reference + 1U));
+  return fixed == reference;
+}
+
+static void TestTxPower(void)
+{
+  for (int32_t maxEirp = 0; maxEirp <= FIXED_POINT_MAX_EIRP_Q; maxEirp++)
+  {
+    for (int32_t gain = 0; gain <= FIXED_POINT_MAX_GAIN_Q; gain++)
+    {
+      for (int8_t index = 0; index < 16; index++)
+      {
+        HOST_TEST_CHECK(RegionCommonComputeTxPower(index, (int16_t)maxEirp, (int16_t)gain) ==
+                        FloatTxPower(index, (float)maxEirp / 256.0f, (float)gain / 256.0f));
+      }
+    }
+  }
+  for (uint32_t e = 0; e < ARRAY_COUNT(Eirps); e++)
+  {
+    for (uint32_t g = 0; g < ARRAY_COUNT(Gains); g++)
+    {
+      for (int8_t index = 0; index < 16; index++)
+      {
+        HOST_TEST_CHECK(RegionCommonComputeTxPower(index, LORAMAC_DB_TO_Q(Eirps[e]), LORAMAC_DB_TO_Q(Gains[g])) ==
+                        FloatTxPower(index, Eirps[e], Gains[g]));
+      }
+    }
+  }
+}
+
+static void TestTempCompensation(void)
+{
+  uint32_t periods = 0;
+  uint32_t floatEqual = 0;
+  uint32_t doubleEqual = 0;
+
+  for (int16_t temperature = FIXED_POINT_MIN_TEMPERATURE; temperature <= FIXED_POINT_MAX_TEMPERATURE; temperature++)
+  {
+    for (uint32_t period = 0; period <= FIXED_POINT_MAX_PERIOD; period++)
+    {
+      uint32_t fixed = LoRaMacTestTempCompensation(period, temperature);
+
+      floatEqual += CheckCompensation(fixed, FloatTempCompensation(period, (float)temperature)) ? 1U : 0U;
+      doubleEqual += CheckCompensation(fixed, DoubleTempCompensation(period, temperature)) ? 1U : 0U;
+      periods++;
+    }
+  }
+  printf("Temperature compensation of %u periods: %u equal to float, %u equal to double\n", periods, floatEqual,
+         doubleEqual);
+}
+
+static void TestTempClamp(void)
+{
+  for (int32_t temperature = INT16_MIN; temperature <= INT16_MAX; temperature += 7)
+  {
+    int32_t clamped = temperature;
+
+    if (clamped > FIXED_POINT_TURNOVER + FIXED_POINT_CLAMP)
+    {
+      clamped = FIXED_POINT_TURNOVER + FIXED_POINT_CLAMP;
+    }
+    else if (clamped < FIXED_POINT_TURNOVER - FIXED_POINT_CLAMP)
+    {
+      clamped = FIXED_POINT_TURNOVER - FIXED_POINT_CLAMP;
+    }
+    for (uint32_t period = 1000U; period <= FIXED_POINT_MAX_PERIOD; period += 1000U)
+    {
+      uint32_t fixed = LoRaMacTestTempCompensation(period, (int16_t)temperature);
+
+      HOST_TEST_CHECK(fixed == LoRaMacTestTempCompensation(period, (int16_t)clamped));
+      HOST_TEST_CHECK(fixed <= period);
+      CheckCompensation(fixed, DoubleTempCompensation(period, clamped));
+    }
+  }
+}
+
+int main(void)
+{
+  TestTxPower();
+  TestTempCompensation();
+  TestTempClamp();
+  return HOST_TEST_RESULT();
+}
@@ -0,0 +1,97 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file host_test.h
+ *
+ * @brief Checks, random numbers and clock of the host tests of host_test.py
+ *
+ * A test is a program whose main() runs HOST_TEST_CHECK()s and returns HOST_TEST_RESULT(). It runs its
+ * benchmark when HOST_TEST_BENCH(argc, argv) is true.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static unsigned HostTestChecks = 0;
+static unsigned HostTestFailures = 0;
+static uint64_t HostTestSeed = 0x9E3779B97F4A7C15ULL;
+
+/**
+ * Counts a check, prints it when it fails
+ */
+#define HOST_TEST_CHECK(condition) \
+  do \
+  { \
+    HostTestChecks++; \
+    if (!(condition)) \
+    { \
+      HostTestFailures++; \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+    } \
+  } while (0)
+
+/**
+ * Prints the checks and gives the exit status of the test
+ */
+#define HOST_TEST_RESULT() \
+  (printf("%u checks, %u failed\n", HostTestChecks, HostTestFailures), (HostTestFailures == 0) ? 0 : 1)
+
+#define HOST_TEST_BENCH(argc, argv) (((argc) > 1) && (strcmp((argv)[1], "bench") == 0))
+
+/**
+ * @brief Pseudo-random numbers, the same sequence on every run
+ * @return xorshift64* value
+ */
+static inline uint64_t HostTestRandom(void)
+{
+  HostTestSeed ^= HostTestSeed >> 12;
+  HostTestSeed ^= HostTestSeed << 25;
+  HostTestSeed ^= HostTestSeed >> 27;
+  return HostTestSeed * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief Pseudo-random number below a bound
+ * @param bound upper bound, excluded
+ * @return value in [0, bound)
+ */
+static inline uint32_t HostTestRandomBelow(uint32_t bound)
+{
+  return (uint32_t)((HostTestRandom() >> 32) % bound);
+}
+
+/**
+ * @brief Monotonic clock of the benchmarks
+ * @return time in ns
+ */
+static inline uint64_t HostTestNowNs(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+#endif /* HOST_TEST_H */
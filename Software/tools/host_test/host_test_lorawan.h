@@ -0,0 +1,308 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file host_test_lorawan.h
+ *
+ * @brief Timer, system time and radio drivers of the host tests built with the LoRaWAN stack
+ *
+ * Included once by the tests of host_test.py listed in LORAWAN_TESTS. The timer runs on HostTestLoRaWANNow, set by
+ * the test. The radio computes the time-on-air with the closed-form formula of the SX126x datasheet and counts its
+ * calls, its other operations do nothing, it never receives and sees every channel free.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#ifndef HOST_TEST_LORAWAN_H
+#define HOST_TEST_LORAWAN_H
+
+#include "host_test.h"
+#include "LoRaMac.h"
+#include "Region.h"
+#include "radio.h"
+#include "stm32_timer.h"
+#include "stm32_systime.h"
+
+/* Time of the timer and of the system time in ms */
+static uint32_t HostTestLoRaWANNow = 0;
+static uint32_t HostTestLoRaWANTimerContext = 0;
+static uint32_t HostTestLoRaWANSeconds = 0;
+static uint32_t HostTestLoRaWANSubSeconds = 0;
+/* Calls of Radio.TimeOnAir */
+static uint32_t HostTestLoRaWANTimeOnAirCalls = 0;
+
+/**
+ * @brief Time-on-air from the SX126x datasheet, 6.1.4 for LoRa and 6.2.3 for (G)FSK with a 3 bytes sync word
+ * @param modem MODEM_LORA or MODEM_FSK
+ * @param bandwidth LoRa bandwidth in Hz
+ * @param datarate LoRa spreading factor or FSK bit rate in bit/s
+ * @param coderate LoRa coding rate 4/(coderate + 4)
+ * @param preambleLen preamble length in symbols (LoRa) or bytes (FSK)
+ * @param fixLen implicit header (LoRa) or fixed length (FSK)
+ * @param payloadLen payload length in bytes
+ * @param crcOn CRC appended to the payload
+ * @return time-on-air in ms, rounded up
+ */
+static inline uint32_t HostTestTimeOnAir(RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                         uint16_t preambleLen, bool fixLen, uint8_t payloadLen, bool crcOn)
+{
+  if (modem == MODEM_FSK)
+  {
+    uint64_t bits = 8U * ((uint64_t)preambleLen + 3U + (fixLen ? 0U : 1U) + payloadLen + (crcOn ? 2U : 0U));
+
+    return (uint32_t)((bits * 1000U + datarate - 1U) / datarate);
+  }
+
+  /* Low data rate optimization when the symbol time is 16 ms or more, the SX126x needs 12 preamble symbols at SF5
+     and SF6, which also have 2 more symbols of header and their payload starts without the 8 bits of SF7 up */
+  bool ldro = ((1000U << datarate) / bandwidth) >= 16U;
+  int32_t bits = (8 * (int32_t)payloadLen) + (crcOn ? 16 : 0) - (4 * (int32_t)datarate) + (fixLen ? 0 : 20) +
+                 ((datarate >= 7U) ? 8 : 0);
+  int32_t bitsPerBlock = 4 * ((int32_t)datarate - (ldro ? 2 : 0));
+  int32_t blocks = (bits > 0) ? ((bits + bitsPerBlock - 1) / bitsPerBlock) : 0;
+  uint32_t preamble = ((datarate <= 6U) && (preambleLen < 12U)) ? 12U : preambleLen;
+  /* Symbols times 4, for the quarter symbol of the preamble: preamble + 4.25 + 8 + payload blocks */
+  uint64_t quarterSymbols = (4U * (uint64_t)preamble) + 17U + 32U + (4U * (uint64_t)blocks * (coderate + 4U)) +
+                            ((datarate <= 6U) ? 8U : 0U);
+  uint64_t divisor = 4U * (uint64_t)bandwidth;
+
+  return (uint32_t)(((quarterSymbols << datarate) * 1000U + divisor - 1U) / divisor);
+}
+
+static UTIL_TIMER_Status_t HostTestLoRaWANTimerInit(void)
+{
+  return UTIL_TIMER_OK;
+}
+
+static UTIL_TIMER_Status_t HostTestLoRaWANTimerStartEvent(uint32_t timeout)
+{
+  return UTIL_TIMER_OK;
+}
+
+static UTIL_TIMER_Status_t HostTestLoRaWANTimerStopEvent(void)
+{
+  return UTIL_TIMER_OK;
+}
+
+static uint32_t HostTestLoRaWANTimerSetContext(void)
+{
+  HostTestLoRaWANTimerContext = HostTestLoRaWANNow;
+  return HostTestLoRaWANTimerContext;
+}
+
+static uint32_t HostTestLoRaWANTimerGetContext(void)
+{
+  return HostTestLoRaWANTimerContext;
+}
+
+static uint32_t HostTestLoRaWANTimerGetElapsedTime(void)
+{
+  return HostTestLoRaWANNow - HostTestLoRaWANTimerContext;
+}
+
+static uint32_t HostTestLoRaWANTimerGetValue(void)
+{
+  return HostTestLoRaWANNow;
+}
+
+static uint32_t HostTestLoRaWANTimerGetMinimumTimeout(void)
+{
+  return 1;
+}
+
+static uint32_t HostTestLoRaWANTimerConvert(uint32_t value)
+{
+  return value;
+}
+
+const UTIL_TIMER_Driver_s UTIL_TimerDriver =
+{
+  HostTestLoRaWANTimerInit,
+  HostTestLoRaWANTimerInit,
+  HostTestLoRaWANTimerStartEvent,
+  HostTestLoRaWANTimerStopEvent,
+  HostTestLoRaWANTimerSetContext,
+  HostTestLoRaWANTimerGetContext,
+  HostTestLoRaWANTimerGetElapsedTime,
+  HostTestLoRaWANTimerGetValue,
+  HostTestLoRaWANTimerGetMinimumTimeout,
+  HostTestLoRaWANTimerConvert,
+  HostTestLoRaWANTimerConvert,
+};
+
+static void HostTestLoRaWANWriteSeconds(uint32_t seconds)
+{
+  HostTestLoRaWANSeconds = seconds;
+}
+
+static uint32_t HostTestLoRaWANReadSeconds(void)
+{
+  return HostTestLoRaWANSeconds;
+}
+
+static void HostTestLoRaWANWriteSubSeconds(uint32_t subSeconds)
+{
+  HostTestLoRaWANSubSeconds = subSeconds;
+}
+
+static uint32_t HostTestLoRaWANReadSubSeconds(void)
+{
+  return HostTestLoRaWANSubSeconds;
+}
+
+static uint32_t HostTestLoRaWANGetCalendarTime(uint16_t *subSeconds)
+{
+  *subSeconds = (uint16_t)(HostTestLoRaWANNow % 1000U);
+  return HostTestLoRaWANNow / 1000U;
+}
+
+const UTIL_SYSTIM_Driver_s UTIL_SYSTIMDriver =
+{
+  HostTestLoRaWANWriteSeconds,
+  HostTestLoRaWANReadSeconds,
+  HostTestLoRaWANWriteSubSeconds,
+  HostTestLoRaWANReadSubSeconds,
+  HostTestLoRaWANGetCalendarTime,
+};
+
+static uint32_t HostTestLoRaWANRadioRandom(void)
+{
+  return (uint32_t)(HostTestRandom() >> 32);
+}
+
+static void HostTestLoRaWANRadioInit(RadioEvents_t *events)
+{
+}
+
+static RadioState_t HostTestLoRaWANRadioGetStatus(void)
+{
+  return RF_IDLE;
+}
+
+static void HostTestLoRaWANRadioSetChannel(uint32_t freq)
+{
+}
+
+static bool HostTestLoRaWANRadioIsChannelFree(uint32_t freq, uint32_t rxBandwidth, int16_t rssiThresh,
+                                              uint32_t maxCarrierSenseTime)
+{
+  return true;
+}
+
+static void HostTestLoRaWANRadioSetRxConfig(RadioModems_t modem, uint32_t bandwidth, uint32_t datarate,
+                                            uint8_t coderate, uint32_t bandwidthAfc, uint16_t preambleLen,
+                                            uint16_t symbTimeout, bool fixLen, uint8_t payloadLen, bool crcOn,
+                                            bool freqHopOn, uint8_t hopPeriod, bool iqInverted, bool rxContinuous)
+{
+}
+
+static void HostTestLoRaWANRadioSetTxConfig(RadioModems_t modem, int8_t power, uint32_t fdev, uint32_t bandwidth,
+                                            uint32_t datarate, uint8_t coderate, uint16_t preambleLen, bool fixLen,
+                                            bool crcOn, bool freqHopOn, uint8_t hopPeriod, bool iqInverted,
+                                            uint32_t timeout)
+{
+}
+
+static bool HostTestLoRaWANRadioCheckRfFrequency(uint32_t frequency)
+{
+  return true;
+}
+
+static void HostTestLoRaWANRadioSetMaxPayloadLength(RadioModems_t modem, uint8_t max)
+{
+}
+
+static void HostTestLoRaWANRadioSetPublicNetwork(bool enable)
+{
+}
+
+static void HostTestLoRaWANRadioSleep(void)
+{
+}
+
+static void HostTestLoRaWANRadioRx(uint32_t timeout)
+{
+}
+
+static uint32_t HostTestLoRaWANRadioGetWakeupTime(void)
+{
+  return 0;
+}
+
+static uint32_t HostTestLoRaWANRadioTimeOnAir(RadioModems_t modem, uint32_t bandwidth, uint32_t datarate,
+                                              uint8_t coderate, uint16_t preambleLen, bool fixLen,
+                                              uint8_t payloadLen, bool crcOn)
+{
+  /* The regions give the LoRa bandwidth as 0: 125 kHz, 1: 250 kHz, 2: 500 kHz */
+  HostTestLoRaWANTimeOnAirCalls++;
+  return HostTestTimeOnAir(modem, 125000U << bandwidth, datarate, coderate, preambleLen, fixLen, payloadLen, crcOn);
+}
+
+const struct Radio_s Radio =
+{
+  .Init = HostTestLoRaWANRadioInit,
+  .GetStatus = HostTestLoRaWANRadioGetStatus,
+  .SetChannel = HostTestLoRaWANRadioSetChannel,
+  .IsChannelFree = HostTestLoRaWANRadioIsChannelFree,
+  .Random = HostTestLoRaWANRadioRandom,
+  .SetRxConfig = HostTestLoRaWANRadioSetRxConfig,
+  .SetTxConfig = HostTestLoRaWANRadioSetTxConfig,
+  .CheckRfFrequency = HostTestLoRaWANRadioCheckRfFrequency,
+  .TimeOnAir = HostTestLoRaWANRadioTimeOnAir,
+  .Sleep = HostTestLoRaWANRadioSleep,
+  .Standby = HostTestLoRaWANRadioSleep,
+  .Rx = HostTestLoRaWANRadioRx,
+  .SetMaxPayloadLength = HostTestLoRaWANRadioSetMaxPayloadLength,
+  .SetPublicNetwork = HostTestLoRaWANRadioSetPublicNetwork,
+  .GetWakeupTime = HostTestLoRaWANRadioGetWakeupTime,
+};
+
+static void HostTestLoRaWANMcpsConfirm(McpsConfirm_t *mcpsConfirm)
+{
+}
+
+static void HostTestLoRaWANMcpsIndication(McpsIndication_t *mcpsIndication)
+{
+}
+
+static void HostTestLoRaWANMlmeConfirm(MlmeConfirm_t *mlmeConfirm)
+{
+}
+
+static void HostTestLoRaWANMlmeIndication(MlmeIndication_t *mlmeIndication)
+{
+}
+
+/**
+ * @brief Initializes the MAC of the current instance for a region, the MAC events are ignored
+ * @param region LoRaWAN region
+ * @return status of LoRaMacInitialization
+ */
+static inline LoRaMacStatus_t HostTestLoRaWANInit(LoRaMacRegion_t region)
+{
+  static LoRaMacPrimitives_t primitives =
+  {
+    HostTestLoRaWANMcpsConfirm,
+    HostTestLoRaWANMcpsIndication,
+    HostTestLoRaWANMlmeConfirm,
+    HostTestLoRaWANMlmeIndication,
+  };
+  static LoRaMacCallback_t callbacks = { 0 };
+
+  return LoRaMacInitialization(&primitives, &callbacks, region);
+}
+
+#endif /* HOST_TEST_LORAWAN_H */
@@ -0,0 +1,87 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file lorawan_conf.h
+ *
+ * @brief LoRaWAN stack configuration of the host tests of host_test.py, with all the regions
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#ifndef __LORAWAN_CONF_H__
+#define __LORAWAN_CONF_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32_systime.h"
+
+/* Region ------------------------------------*/
+#define REGION_AS923
+#define REGION_AU915
+#define REGION_CN470
+#define REGION_CN779
+#define REGION_EU433
+#define REGION_EU868
+#define REGION_KR920
+#define REGION_IN865
+#define REGION_US915
+#define REGION_RU864
+
+#define HYBRID_ENABLED          0
+
+#define KEY_LOG_ENABLED         0
+
+/* Class B ------------------------------------*/
+/* Enabled by the tests of Class B with -DLORAMAC_CLASSB_ENABLED=1 */
+#ifndef LORAMAC_CLASSB_ENABLED
+#define LORAMAC_CLASSB_ENABLED  0
+#endif
+
+#if ( LORAMAC_CLASSB_ENABLED == 1 )
+/* CLASS B LSE crystall calibration, the values of the applications */
+/**
+  * \brief Temperature coefficient of the clock source
+  */
+#define RTC_TEMP_COEFFICIENT                            ( -0.035 )
+
+/**
+  * \brief Temperature coefficient deviation of the clock source
+  */
+#define RTC_TEMP_DEV_COEFFICIENT                        ( 0.0035 )
+
+/**
+  * \brief Turnover temperature of the clock source
+  */
+#define RTC_TEMP_TURNOVER                               ( 25.0 )
+
+/**
+  * \brief Turnover temperature deviation of the clock source
+  */
+#define RTC_TEMP_DEV_TURNOVER                           ( 5.0 )
+#endif /* LORAMAC_CLASSB_ENABLED == 1 */
+
+/* The tests are single threaded processes */
+#define CRITICAL_SECTION_BEGIN( )
+#define CRITICAL_SECTION_END( )
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LORAWAN_CONF_H__ */
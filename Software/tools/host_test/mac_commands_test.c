@@ -0,0 +1,421 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file mac_commands_test.c
+ *
+ * @brief Host test of the MAC commands of LoRaMacCommands.c against the linked list implementation they replace
+ *
+ * The former implementation, a linked list over slots found free by their zero bytes, is kept here as the reference.
+ * Random sequences of operations run on both: adds of sticky, non-sticky, indexed and proprietary CIDs with random
+ * payloads, lookups, removes of single commands found by lookup or by position, removes of the sticky and non-sticky
+ * commands, serializations into random FOpts sizes, and the pending and size queries. Every status and result must
+ * be the same, and after every operation both must hold the same commands in the same order, with the same sticky
+ * flags and serialized size. CID 0 is not added: the former code took a command of CID 0 without payload for a free
+ * slot. The benchmark runs a typical uplink cycle on both.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include "host_test_lorawan.h"
+#include "LoRaMacCommands.h"
+#include "LoRaMacInstance.h"
+
+#define COMMANDS_SEQUENCES 10U
+#define COMMANDS_OPERATIONS 200000U
+#define COMMANDS_BENCH_CYCLES 2000000U
+/* Serialized size of all the MAC commands with the largest payload, and the FOpts size of the uplinks */
+#define COMMANDS_MAX_SIZE (NUM_OF_MAC_COMMANDS * (1U + LORAMAC_COMMADS_MAX_NUM_OF_PARAMS))
+#define COMMANDS_FOPTS_SIZE 15U
+
+/* CIDs of the device, the answers 0x05, 0x08, 0x09 and 0x0A are sticky */
+static const uint8_t MoteCids[] =
+{
+  MOTE_MAC_LINK_CHECK_REQ, MOTE_MAC_LINK_ADR_ANS, MOTE_MAC_DUTY_CYCLE_ANS, MOTE_MAC_RX_PARAM_SETUP_ANS,
+  MOTE_MAC_DEV_STATUS_ANS, MOTE_MAC_NEW_CHANNEL_ANS, MOTE_MAC_RX_TIMING_SETUP_ANS, MOTE_MAC_TX_PARAM_SETUP_ANS,
+  MOTE_MAC_DL_CHANNEL_ANS, MOTE_MAC_DEVICE_TIME_REQ, MOTE_MAC_PING_SLOT_INFO_REQ, MOTE_MAC_PING_SLOT_FREQ_ANS,
+  MOTE_MAC_BEACON_TIMING_REQ, MOTE_MAC_BEACON_FREQ_ANS,
+};
+
+#define ARRAY_COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+/* Element of the former implementation */
+typedef struct sRefCommand
+{
+  struct sRefCommand *Next;
+  uint8_t CID;
+  uint8_t Payload[LORAMAC_COMMADS_MAX_NUM_OF_PARAMS];
+  size_t PayloadSize;
+  bool IsSticky;
+} RefCommand_t;
+
+static struct
+{
+  RefCommand_t *First;
+  RefCommand_t *Last;
+  RefCommand_t Slots[NUM_OF_MAC_COMMANDS];
+  size_t SerializedCmdsSize;
+} Ref;
+
+static bool RefIsSticky(uint8_t cid)
+{
+  return (cid == MOTE_MAC_DL_CHANNEL_ANS) || (cid == MOTE_MAC_RX_PARAM_SETUP_ANS) ||
+         (cid == MOTE_MAC_RX_TIMING_SETUP_ANS) || (cid == MOTE_MAC_TX_PARAM_SETUP_ANS);
+}
+
+static bool RefIsSlotFree(const RefCommand_t *slot)
+{
+  const uint8_t *mem = (const uint8_t *)slot;
+
+  for (size_t i = 0; i < sizeof(RefCommand_t); i++)
+  {
+    if (mem[i] != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void RefInit(void)
+{
+  memset(&Ref, 0, sizeof(Ref));
+}
+
+static LoRaMacCommandStatus_t RefAddCmd(uint8_t cid, const uint8_t *payload, size_t payloadSize)
+{
+  RefCommand_t *newCmd = NULL;
+
+  for (uint8_t i = 0; (i < NUM_OF_MAC_COMMANDS) && (newCmd == NULL); i++)
+  {
+    newCmd = RefIsSlotFree(&Ref.Slots[i]) ? &Ref.Slots[i] : NULL;
+  }
+  if (newCmd == NULL)
+  {
+    return LORAMAC_COMMANDS_ERROR_MEMORY;
+  }
+  if (Ref.First == NULL)
+  {
+    Ref.First = newCmd;
+  }
+  if (Ref.Last != NULL)
+  {
+    Ref.Last->Next = newCmd;
+  }
+  newCmd->Next = NULL;
+  Ref.Last = newCmd;
+  newCmd->CID = cid;
+  newCmd->PayloadSize = payloadSize;
+  memcpy(newCmd->Payload, payload, payloadSize);
+  newCmd->IsSticky = RefIsSticky(cid);
+  Ref.SerializedCmdsSize += 1U + payloadSize;
+  return LORAMAC_COMMANDS_SUCCESS;
+}
+
+static void RefRemoveCmd(RefCommand_t *element)
+{
+  RefCommand_t *previous = NULL;
+
+  if (element != Ref.First)
+  {
+    previous = Ref.First;
+    while ((previous != NULL) && (previous->Next != element))
+    {
+      previous = previous->Next;
+    }
+  }
+  if (Ref.First == element)
+  {
+    Ref.First = element->Next;
+  }
+  if (Ref.Last == element)
+  {
+    Ref.Last = previous;
+  }
+  if (previous != NULL)
+  {
+    previous->Next = element->Next;
+  }
+  Ref.SerializedCmdsSize -= 1U + element->PayloadSize;
+  memset(element, 0, sizeof(RefCommand_t));
+}
+
+static RefCommand_t *RefGetCmd(uint8_t cid)
+{
+  RefCommand_t *element = Ref.First;
+
+  while ((element != NULL) && (element->CID != cid))
+  {
+    element = element->Next;
+  }
+  return element;
+}
+
+static void RefRemoveCmds(bool sticky)
+{
+  RefCommand_t *element = Ref.First;
+
+  while (element != NULL)
+  {
+    RefCommand_t *next = element->Next;
+
+    if (element->IsSticky == sticky)
+    {
+      RefRemoveCmd(element);
+    }
+    element = next;
+  }
+}
+
+static size_t RefSerializeCmds(size_t availableSize, uint8_t *buffer)
+{
+  RefCommand_t *element = Ref.First;
+  size_t itr = 0;
+
+  while ((element != NULL) && ((availableSize - itr) >= (1U + element->PayloadSize)))
+  {
+    buffer[itr++] = element->CID;
+    memcpy(&buffer[itr], element->Payload, element->PayloadSize);
+    itr += element->PayloadSize;
+    element = element->Next;
+  }
+  while (element != NULL)
+  {
+    RefCommand_t *next = element->Next;
+
+    RefRemoveCmd(element);
+    element = next;
+  }
+  return Ref.SerializedCmdsSize;
+}
+
+static bool RefStickyCmdsPending(void)
+{
+  for (RefCommand_t *element = Ref.First; element != NULL; element = element->Next)
+  {
+    if (element->IsSticky)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Position of an element in the order of the list, -1 for none */
+static int32_t RefPosition(const RefCommand_t *element)
+{
+  int32_t position = 0;
+
+  if (element == NULL)
+  {
+    return -1;
+  }
+  for (const RefCommand_t *e = Ref.First; e != element; e = e->Next)
+  {
+    position++;
+  }
+  return position;
+}
+
+static RefCommand_t *RefAt(uint32_t position)
+{
+  RefCommand_t *element = Ref.First;
+
+  while (position-- > 0U)
+  {
+    element = element->Next;
+  }
+  return element;
+}
+
+static uint8_t RandomCid(void)
+{
+  uint32_t kind = HostTestRandomBelow(8);
+
+  if (kind < 6U)
+  {
+    return MoteCids[HostTestRandomBelow(ARRAY_COUNT(MoteCids))];
+  }
+  /* Other indexed CIDs, then the ones of the proprietary range and above the index */
+  return (kind == 6U) ? (uint8_t)(1U + HostTestRandomBelow(LORAMAC_COMMANDS_NUM_OF_INDEXED_CIDS - 1U)) :
+                        (uint8_t)(LORAMAC_COMMANDS_NUM_OF_INDEXED_CIDS +
+                                  HostTestRandomBelow(256U - LORAMAC_COMMANDS_NUM_OF_INDEXED_CIDS));
+}
+
+/* Both must hold the same commands in the same order */
+static void CheckState(void)
+{
+  const LoRaMacCommandsCtx_t *ctx = &LoRaMacCurrentInstance->Commands;
+  const RefCommand_t *element = Ref.First;
+  uint8_t count = 0;
+
+  for (; (element != NULL) && (count < ctx->NumOfMacCommands); element = element->Next, count++)
+  {
+    const MacCommand_t *cmd = &ctx->MacCommands[count];
+
+    HOST_TEST_CHECK(cmd->CID == element->CID);
+    HOST_TEST_CHECK(cmd->PayloadSize == element->PayloadSize);
+    HOST_TEST_CHECK(memcmp(cmd->Payload, element->Payload, element->PayloadSize) == 0);
+    HOST_TEST_CHECK(((ctx->StickyCmds & (1U << count)) != 0U) == element->IsSticky);
+  }
+  HOST_TEST_CHECK((element == NULL) && (count == ctx->NumOfMacCommands));
+  HOST_TEST_CHECK(ctx->SerializedCmdsSize == Ref.SerializedCmdsSize);
+}
+
+static void Operation(void)
+{
+  const LoRaMacCommandsCtx_t *ctx = &LoRaMacCurrentInstance->Commands;
+  uint32_t operation = HostTestRandomBelow(20);
+  MacCommand_t *cmd = NULL;
+
+  if (operation < 8U)
+  {
+    uint8_t payload[LORAMAC_COMMADS_MAX_NUM_OF_PARAMS] = { (uint8_t)HostTestRandom(), (uint8_t)HostTestRandom() };
+    uint8_t cid = RandomCid();
+    size_t size = HostTestRandomBelow(LORAMAC_COMMADS_MAX_NUM_OF_PARAMS + 1U);
+
+    HOST_TEST_CHECK(LoRaMacCommandsAddCmd(cid, payload, size) == RefAddCmd(cid, payload, size));
+  }
+  else if (operation < 11U)
+  {
+    uint8_t cid = RandomCid();
+    RefCommand_t *element = RefGetCmd(cid);
+    LoRaMacCommandStatus_t status = LoRaMacCommandsGetCmd(cid, &cmd);
+
+    HOST_TEST_CHECK(status == ((element != NULL) ? LORAMAC_COMMANDS_SUCCESS : LORAMAC_COMMANDS_ERROR_CMD_NOT_FOUND));
+    HOST_TEST_CHECK(((cmd == NULL) ? -1 : (int32_t)(cmd - ctx->MacCommands)) == RefPosition(element));
+    /* The MAC removes the command it found half of the time */
+    if ((element != NULL) && (cmd != NULL) && (HostTestRandomBelow(2) == 0U))
+    {
+      HOST_TEST_CHECK(LoRaMacCommandsRemoveCmd(cmd) == LORAMAC_COMMANDS_SUCCESS);
+      RefRemoveCmd(element);
+    }
+  }
+  else if ((operation == 11U) && (ctx->NumOfMacCommands > 0U))
+  {
+    uint32_t position = HostTestRandomBelow(ctx->NumOfMacCommands);
+
+    HOST_TEST_CHECK(LoRaMacCommandsRemoveCmd((MacCommand_t *)&ctx->MacCommands[position]) ==
+                    LORAMAC_COMMANDS_SUCCESS);
+    RefRemoveCmd(RefAt(position));
+  }
+  else if (operation == 12U)
+  {
+    HOST_TEST_CHECK(LoRaMacCommandsRemoveNoneStickyCmds() == LORAMAC_COMMANDS_SUCCESS);
+    RefRemoveCmds(false);
+  }
+  else if (operation == 13U)
+  {
+    HOST_TEST_CHECK(LoRaMacCommandsRemoveStickyAnsCmds() == LORAMAC_COMMANDS_SUCCESS);
+    RefRemoveCmds(true);
+  }
+  else if (operation < 17U)
+  {
+    uint8_t buffer[COMMANDS_MAX_SIZE];
+    uint8_t refBuffer[COMMANDS_MAX_SIZE];
+    size_t available = HostTestRandomBelow(COMMANDS_MAX_SIZE + 1U);
+    size_t effective = 0;
+    size_t refEffective;
+    size_t serialized = Ref.SerializedCmdsSize;
+
+    memset(buffer, 0, sizeof(buffer));
+    memset(refBuffer, 0, sizeof(refBuffer));
+    HOST_TEST_CHECK(LoRaMacCommandsSerializeCmds(available, &effective, buffer) == LORAMAC_COMMANDS_SUCCESS);
+    refEffective = RefSerializeCmds(available, refBuffer);
+    HOST_TEST_CHECK(effective == refEffective);
+    HOST_TEST_CHECK(memcmp(buffer, refBuffer, sizeof(buffer)) == 0);
+    HOST_TEST_CHECK(effective <= serialized);
+  }
+  else
+  {
+    bool pending = false;
+    size_t size = 0;
+
+    HOST_TEST_CHECK(LoRaMacCommandsStickyCmdsPending(&pending) == LORAMAC_COMMANDS_SUCCESS);
+    HOST_TEST_CHECK(pending == RefStickyCmdsPending());
+    HOST_TEST_CHECK(LoRaMacCommandsGetSizeSerializedCmds(&size) == LORAMAC_COMMANDS_SUCCESS);
+    HOST_TEST_CHECK(size == Ref.SerializedCmdsSize);
+  }
+  CheckState();
+}
+
+/* The MAC answers of a downlink, the uplink takes them and removes them */
+static const uint8_t CycleCids[] =
+{
+  MOTE_MAC_LINK_ADR_ANS, MOTE_MAC_LINK_ADR_ANS, MOTE_MAC_LINK_ADR_ANS, MOTE_MAC_RX_PARAM_SETUP_ANS,
+  MOTE_MAC_DEV_STATUS_ANS, MOTE_MAC_DUTY_CYCLE_ANS,
+};
+
+static void Bench(void)
+{
+  uint8_t payload[LORAMAC_COMMADS_MAX_NUM_OF_PARAMS] = { 0x07, 0x20 };
+  uint8_t buffer[COMMANDS_FOPTS_SIZE];
+  volatile size_t sink = 0;
+  MacCommand_t *cmd;
+  size_t effective;
+  uint64_t start;
+  double former;
+
+  RefInit();
+  start = HostTestNowNs();
+  for (uint32_t i = 0; i < COMMANDS_BENCH_CYCLES; i++)
+  {
+    for (uint32_t c = 0; c < ARRAY_COUNT(CycleCids); c++)
+    {
+      RefAddCmd(CycleCids[c], payload, 1);
+    }
+    sink += (RefGetCmd(MOTE_MAC_DEV_STATUS_ANS) != NULL) ? 1U : 0U;
+    sink += RefSerializeCmds(sizeof(buffer), buffer);
+    RefRemoveCmds(false);
+    RefRemoveCmds(true);
+  }
+  former = (double)(HostTestNowNs() - start) / COMMANDS_BENCH_CYCLES;
+
+  LoRaMacCommandsInit(NULL);
+  start = HostTestNowNs();
+  for (uint32_t i = 0; i < COMMANDS_BENCH_CYCLES; i++)
+  {
+    for (uint32_t c = 0; c < ARRAY_COUNT(CycleCids); c++)
+    {
+      LoRaMacCommandsAddCmd(CycleCids[c], payload, 1);
+    }
+    sink += (LoRaMacCommandsGetCmd(MOTE_MAC_DEV_STATUS_ANS, &cmd) == LORAMAC_COMMANDS_SUCCESS) ? 1U : 0U;
+    LoRaMacCommandsSerializeCmds(sizeof(buffer), &effective, buffer);
+    sink += effective;
+    LoRaMacCommandsRemoveNoneStickyCmds();
+    LoRaMacCommandsRemoveStickyAnsCmds();
+  }
+  printf("Uplink cycle of %u MAC commands: linked list %.1f ns, array %.1f ns\n", (unsigned)ARRAY_COUNT(CycleCids),
+         former, (double)(HostTestNowNs() - start) / COMMANDS_BENCH_CYCLES);
+}
+
+int main(int argc, char **argv)
+{
+  for (uint32_t s = 0; s < COMMANDS_SEQUENCES; s++)
+  {
+    LoRaMacCommandsInit(NULL);
+    RefInit();
+    for (uint32_t i = 0; i < COMMANDS_OPERATIONS; i++)
+    {
+      Operation();
+    }
+  }
+  if (HOST_TEST_BENCH(argc, argv))
+  {
+    Bench();
+  }
+  return HOST_TEST_RESULT();
+}
@@ -0,0 +1,186 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file phy_params_test.c
+ *
+ * @brief Host test of the PHY parameters LoRaMac caches for every frame: after LoRaMacInitialization and after each
+ *        change of the repeater support and dwell times, MacCtx.PhyParams must hold what RegionGetPhyParam gives
+ *
+ * Every region is checked with all the repeater support and dwell time combinations, on every datarate: the maximum
+ * uplink and downlink payloads of the datarates the region verifies, 0 for the others, and the maximum frame counter
+ * gap. LoRaMacQueryTxPossible must give the cached uplink payload. The dwell times are written in the NVM context as
+ * TxParamSetupReq does. The benchmark gives the time of the per-frame queries with RegionGetPhyParam and from the
+ * cache.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include "host_test_lorawan.h"
+#include "LoRaMacInstance.h"
+
+#define PHY_BENCH_FRAMES 10000000U
+
+static const struct
+{
+  const char *Name;
+  LoRaMacRegion_t Region;
+} Regions[] =
+{
+  { "AS923", LORAMAC_REGION_AS923 },
+  { "AU915", LORAMAC_REGION_AU915 },
+  { "CN470", LORAMAC_REGION_CN470 },
+  { "CN779", LORAMAC_REGION_CN779 },
+  { "EU433", LORAMAC_REGION_EU433 },
+  { "EU868", LORAMAC_REGION_EU868 },
+  { "KR920", LORAMAC_REGION_KR920 },
+  { "IN865", LORAMAC_REGION_IN865 },
+  { "US915", LORAMAC_REGION_US915 },
+  { "RU864", LORAMAC_REGION_RU864 },
+};
+
+#define ARRAY_COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+/* Maximum payload of a datarate as LoRaMac queried it on every frame, 0 if the region does not verify it */
+static uint32_t MaxPayload(LoRaMacRegion_t region, PhyAttribute_t verifyAttribute, int8_t datarate, bool repeater,
+                           uint8_t uplinkDwellTime, uint8_t downlinkDwellTime, uint8_t dwellTime)
+{
+  VerifyParams_t verify =
+  {
+    .DatarateParams =
+    {
+      .Datarate = datarate, .UplinkDwellTime = uplinkDwellTime, .DownlinkDwellTime = downlinkDwellTime
+    }
+  };
+  GetPhyParams_t getPhy =
+  {
+    .Attribute = repeater ? PHY_MAX_PAYLOAD_REPEATER : PHY_MAX_PAYLOAD, .Datarate = datarate,
+    .UplinkDwellTime = dwellTime
+  };
+
+  if (!RegionVerify(region, &verify, verifyAttribute))
+  {
+    return 0;
+  }
+  return RegionGetPhyParam(region, &getPhy).Value;
+}
+
+static void SetParameters(bool repeater, uint8_t uplinkDwellTime, uint8_t downlinkDwellTime)
+{
+  MibRequestConfirm_t mibReq;
+
+  LoRaMacCurrentInstance->Mac.NvmCtx->MacParams.UplinkDwellTime = uplinkDwellTime;
+  LoRaMacCurrentInstance->Mac.NvmCtx->MacParams.DownlinkDwellTime = downlinkDwellTime;
+  mibReq.Type = MIB_REPEATER_SUPPORT;
+  mibReq.Param.EnableRepeaterSupport = repeater;
+  HOST_TEST_CHECK(LoRaMacMibSetRequestConfirm(&mibReq) == LORAMAC_STATUS_OK);
+}
+
+static void TestRegion(LoRaMacRegion_t region)
+{
+  const LoRaMacPhyParams_t *cache = &LoRaMacCurrentInstance->Mac.PhyParams;
+  GetPhyParams_t getPhy = { .Attribute = PHY_MAX_FCNT_GAP };
+
+  HOST_TEST_CHECK(HostTestLoRaWANInit(region) == LORAMAC_STATUS_OK);
+
+  for (uint32_t combination = 0; combination <= 8U; combination++)
+  {
+    /* The state after the initialization first */
+    bool repeater = (combination > 0U) && (((combination - 1U) & 4U) != 0U);
+    uint8_t uplinkDwellTime = (combination > 0U) ? (uint8_t)((combination - 1U) & 1U) : 0U;
+    uint8_t downlinkDwellTime = (combination > 0U) ? (uint8_t)(((combination - 1U) >> 1) & 1U) : 0U;
+
+    if (combination > 0U)
+    {
+      SetParameters(repeater, uplinkDwellTime, downlinkDwellTime);
+    }
+    uplinkDwellTime = LoRaMacCurrentInstance->Mac.NvmCtx->MacParams.UplinkDwellTime;
+    downlinkDwellTime = LoRaMacCurrentInstance->Mac.NvmCtx->MacParams.DownlinkDwellTime;
+
+    HOST_TEST_CHECK(cache->MaxFCntGap == RegionGetPhyParam(region, &getPhy).Value);
+    for (int8_t dr = DR_0; dr < LORAMAC_PHY_DATARATES; dr++)
+    {
+      uint32_t uplink = MaxPayload(region, PHY_TX_DR, dr, repeater, uplinkDwellTime, downlinkDwellTime,
+                                   uplinkDwellTime);
+      uint32_t downlink = MaxPayload(region, PHY_RX_DR, dr, repeater, uplinkDwellTime, downlinkDwellTime,
+                                     downlinkDwellTime);
+
+      HOST_TEST_CHECK(cache->MaxUplinkPayload[dr] == uplink);
+      HOST_TEST_CHECK(cache->MaxDownlinkPayload[dr] == downlink);
+      if (uplink != 0U)
+      {
+        MibRequestConfirm_t mibReq = { .Type = MIB_CHANNELS_DATARATE, .Param.ChannelsDatarate = dr };
+        LoRaMacTxInfo_t txInfo;
+
+        HOST_TEST_CHECK(LoRaMacMibSetRequestConfirm(&mibReq) == LORAMAC_STATUS_OK);
+        HOST_TEST_CHECK(LoRaMacQueryTxPossible(0, &txInfo) == LORAMAC_STATUS_OK);
+        HOST_TEST_CHECK(txInfo.CurrentPossiblePayloadSize == uplink);
+      }
+    }
+  }
+}
+
+static void Bench(void)
+{
+  const LoRaMacPhyParams_t *cache = &LoRaMacCurrentInstance->Mac.PhyParams;
+  GetPhyParams_t getPhy = { .Datarate = DR_0 };
+  volatile uint32_t sink = 0;
+  uint64_t start;
+  double queries;
+
+  HOST_TEST_CHECK(HostTestLoRaWANInit(LORAMAC_REGION_EU868) == LORAMAC_STATUS_OK);
+  /* ValidatePayloadLength, LoRaMacQueryTxPossible, and the downlink payload and FCnt gap of ProcessRadioRxDone */
+  start = HostTestNowNs();
+  for (uint32_t i = 0; i < PHY_BENCH_FRAMES; i++)
+  {
+    getPhy.Datarate = (int8_t)(i & 7U);
+    getPhy.Attribute = PHY_MAX_PAYLOAD;
+    sink += RegionGetPhyParam(LORAMAC_REGION_EU868, &getPhy).Value;
+    sink += RegionGetPhyParam(LORAMAC_REGION_EU868, &getPhy).Value;
+    sink += RegionGetPhyParam(LORAMAC_REGION_EU868, &getPhy).Value;
+    getPhy.Attribute = PHY_MAX_FCNT_GAP;
+    sink += RegionGetPhyParam(LORAMAC_REGION_EU868, &getPhy).Value;
+  }
+  queries = (double)(HostTestNowNs() - start) / PHY_BENCH_FRAMES;
+  start = HostTestNowNs();
+  for (uint32_t i = 0; i < PHY_BENCH_FRAMES; i++)
+  {
+    int8_t datarate = (int8_t)(i & 7U);
+
+    sink += cache->MaxUplinkPayload[datarate];
+    sink += cache->MaxUplinkPayload[datarate];
+    sink += cache->MaxDownlinkPayload[datarate];
+    sink += cache->MaxFCntGap;
+  }
+  printf("EU868 per-frame queries: RegionGetPhyParam %.1f ns, cache %.1f ns\n", queries,
+         (double)(HostTestNowNs() - start) / PHY_BENCH_FRAMES);
+}
+
+int main(int argc, char **argv)
+{
+  for (uint32_t r = 0; r < ARRAY_COUNT(Regions); r++)
+  {
+    uint32_t failures = HostTestFailures;
+
+    TestRegion(Regions[r].Region);
+    printf("%s: %s\n", Regions[r].Name, (HostTestFailures == failures) ? "ok" : "FAILED");
+  }
+  if (HOST_TEST_BENCH(argc, argv))
+  {
+    Bench();
+  }
+  return HOST_TEST_RESULT();
+}
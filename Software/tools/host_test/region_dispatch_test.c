@@ -0,0 +1,335 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file region_dispatch_test.c
+ *
+ * @brief Host test of the Region*() dispatch of Region.c with all the regions enabled: every call through Region*()
+ *        must give the same result as the Region<name>*() function of the region, and a region which is not
+ *        enabled the defaults of Region.c
+ *
+ * The calls compared are GetPhyParam for every attribute, datarate and dwell time, Verify, ApplyDrOffset,
+ * ComputeRxWindowParameters, and the calls of an uplink frame: NextChannel, TxConfig, SetBandTxDone, the RX1 and RX2
+ * window parameters, RxConfig and the payload queries. The benchmark gives the time of a frame and of a
+ * GetPhyParam call through Region*() and with direct calls, the difference is the cost of the dispatch.
+ * `python3 tools/region_size.py` compares the code size of Region.c.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include "host_test_lorawan.h"
+#include "RegionAS923.h"
+#include "RegionAU915.h"
+#include "RegionCN470.h"
+#include "RegionCN779.h"
+#include "RegionEU433.h"
+#include "RegionEU868.h"
+#include "RegionKR920.h"
+#include "RegionIN865.h"
+#include "RegionUS915.h"
+#include "RegionRU864.h"
+
+#define DISPATCH_SEED 0x5EEDU
+#define DISPATCH_BENCH_FRAMES 2000000U
+#define DISPATCH_BENCH_CALLS 20000000U
+#define DISPATCH_FRAME_SIZE 23U
+
+typedef struct
+{
+  const char *Name;
+  LoRaMacRegion_t Region;
+  PhyParam_t (*GetPhyParam)(GetPhyParams_t *getPhy);
+  bool (*Verify)(VerifyParams_t *verify, PhyAttribute_t phyAttribute);
+  uint8_t (*ApplyDrOffset)(uint8_t downlinkDwellTime, int8_t dr, int8_t drOffset);
+  void (*ComputeRxWindowParameters)(int8_t datarate, uint8_t minRxSymbols, uint32_t rxError,
+                                    RxConfigParams_t *rxConfigParams);
+  LoRaMacStatus_t (*NextChannel)(NextChanParams_t *nextChanParams, uint8_t *channel, TimerTime_t *time,
+                                 TimerTime_t *aggregatedTimeOff);
+  bool (*TxConfig)(TxConfigParams_t *txConfig, int8_t *txPower, TimerTime_t *txTimeOnAir);
+  void (*SetBandTxDone)(SetBandTxDoneParams_t *txDone);
+  bool (*RxConfig)(RxConfigParams_t *rxConfig, int8_t *datarate);
+} DispatchRegion_t;
+
+#define DISPATCH_REGION(name) \
+  { #name, LORAMAC_REGION_##name, Region##name##GetPhyParam, Region##name##Verify, Region##name##ApplyDrOffset, \
+    Region##name##ComputeRxWindowParameters, Region##name##NextChannel, Region##name##TxConfig, \
+    Region##name##SetBandTxDone, Region##name##RxConfig }
+
+static const DispatchRegion_t Regions[] =
+{
+  DISPATCH_REGION(AS923),
+  DISPATCH_REGION(AU915),
+  DISPATCH_REGION(CN470),
+  DISPATCH_REGION(CN779),
+  DISPATCH_REGION(EU433),
+  DISPATCH_REGION(EU868),
+  DISPATCH_REGION(KR920),
+  DISPATCH_REGION(IN865),
+  DISPATCH_REGION(US915),
+  DISPATCH_REGION(RU864),
+};
+
+/* Outputs of the calls of an uplink frame */
+typedef struct
+{
+  LoRaMacStatus_t Status;
+  uint8_t Channel;
+  TimerTime_t Time;
+  TimerTime_t AggregatedTimeOff;
+  bool TxConfigured;
+  int8_t TxPower;
+  TimerTime_t TimeOnAir;
+  RxConfigParams_t Rx1;
+  RxConfigParams_t Rx2;
+  bool Rx1Configured;
+  bool Rx2Configured;
+  int8_t Rx1Datarate;
+  int8_t Rx2Datarate;
+  uint32_t MaxPayload;
+  uint32_t MaxFCntGap;
+} DispatchFrame_t;
+
+#define ARRAY_COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+static void InitRegion(const DispatchRegion_t *region)
+{
+  InitDefaultsParams_t params = { .NvmCtx = NULL, .Type = INIT_TYPE_DEFAULTS };
+
+  RegionInitDefaults(region->Region, &params);
+}
+
+static int8_t FrameDatarate(const DispatchRegion_t *region)
+{
+  GetPhyParams_t getPhy = { .Attribute = PHY_DEF_TX_DR };
+
+  return (int8_t)region->GetPhyParam(&getPhy).Value;
+}
+
+/* The calls of LoRaMac for an uplink, through Region*() */
+static void FrameDispatch(const DispatchRegion_t *region, int8_t datarate, DispatchFrame_t *frame)
+{
+  LoRaMacRegion_t id = region->Region;
+  NextChanParams_t nextChan =
+  {
+    .Datarate = datarate, .Joined = true, .DutyCycleEnabled = true,
+    .ElapsedTimeSinceStartUp = { .Seconds = 100000 }, .PktLen = DISPATCH_FRAME_SIZE
+  };
+  TxConfigParams_t txConfig = { .Datarate = datarate, .TxPower = 0, .MaxEirpQ8 = LORAMAC_DB_TO_Q( 16 ), .PktLen = DISPATCH_FRAME_SIZE };
+  SetBandTxDoneParams_t txDone = { .Joined = true, .ElapsedTimeSinceStartUp = { .Seconds = 100000 } };
+  GetPhyParams_t getPhy = { .Datarate = datarate };
+
+  frame->Status = RegionNextChannel(id, &nextChan, &frame->Channel, &frame->Time, &frame->AggregatedTimeOff);
+  txConfig.Channel = frame->Channel;
+  frame->TxConfigured = RegionTxConfig(id, &txConfig, &frame->TxPower, &frame->TimeOnAir);
+  txDone.Channel = frame->Channel;
+  txDone.LastTxAirTime = frame->TimeOnAir;
+  RegionSetBandTxDone(id, &txDone);
+  RegionComputeRxWindowParameters(id, RegionApplyDrOffset(id, 0, datarate, 0), 6, 10, &frame->Rx1);
+  RegionComputeRxWindowParameters(id, 0, 6, 10, &frame->Rx2);
+  frame->Rx1.Channel = frame->Channel;
+  frame->Rx1.RxSlot = RX_SLOT_WIN_1;
+  frame->Rx1Configured = RegionRxConfig(id, &frame->Rx1, &frame->Rx1Datarate);
+  frame->Rx2.RxSlot = RX_SLOT_WIN_2;
+  frame->Rx2Configured = RegionRxConfig(id, &frame->Rx2, &frame->Rx2Datarate);
+  getPhy.Attribute = PHY_MAX_PAYLOAD;
+  frame->MaxPayload = RegionGetPhyParam(id, &getPhy).Value;
+  getPhy.Attribute = PHY_MAX_FCNT_GAP;
+  frame->MaxFCntGap = RegionGetPhyParam(id, &getPhy).Value;
+}
+
+/* The same calls, made directly to the region */
+static void FrameDirect(const DispatchRegion_t *region, int8_t datarate, DispatchFrame_t *frame)
+{
+  NextChanParams_t nextChan =
+  {
+    .Datarate = datarate, .Joined = true, .DutyCycleEnabled = true,
+    .ElapsedTimeSinceStartUp = { .Seconds = 100000 }, .PktLen = DISPATCH_FRAME_SIZE
+  };
+  TxConfigParams_t txConfig = { .Datarate = datarate, .TxPower = 0, .MaxEirpQ8 = LORAMAC_DB_TO_Q( 16 ), .PktLen = DISPATCH_FRAME_SIZE };
+  SetBandTxDoneParams_t txDone = { .Joined = true, .ElapsedTimeSinceStartUp = { .Seconds = 100000 } };
+  GetPhyParams_t getPhy = { .Datarate = datarate };
+
+  frame->Status = region->NextChannel(&nextChan, &frame->Channel, &frame->Time, &frame->AggregatedTimeOff);
+  txConfig.Channel = frame->Channel;
+  frame->TxConfigured = region->TxConfig(&txConfig, &frame->TxPower, &frame->TimeOnAir);
+  txDone.Channel = frame->Channel;
+  txDone.LastTxAirTime = frame->TimeOnAir;
+  region->SetBandTxDone(&txDone);
+  region->ComputeRxWindowParameters(region->ApplyDrOffset(0, datarate, 0), 6, 10, &frame->Rx1);
+  region->ComputeRxWindowParameters(0, 6, 10, &frame->Rx2);
+  frame->Rx1.Channel = frame->Channel;
+  frame->Rx1.RxSlot = RX_SLOT_WIN_1;
+  frame->Rx1Configured = region->RxConfig(&frame->Rx1, &frame->Rx1Datarate);
+  frame->Rx2.RxSlot = RX_SLOT_WIN_2;
+  frame->Rx2Configured = region->RxConfig(&frame->Rx2, &frame->Rx2Datarate);
+  getPhy.Attribute = PHY_MAX_PAYLOAD;
+  frame->MaxPayload = region->GetPhyParam(&getPhy).Value;
+  getPhy.Attribute = PHY_MAX_FCNT_GAP;
+  frame->MaxFCntGap = region->GetPhyParam(&getPhy).Value;
+}
+
+static void TestRegion(const DispatchRegion_t *region)
+{
+  HOST_TEST_CHECK(RegionIsActive(region->Region));
+  InitRegion(region);
+
+  for (PhyAttribute_t attribute = 0; attribute <= PHY_BEACON_DELAY_BEACON_TIMING_ANS; attribute++)
+  {
+    for (int8_t dr = DR_0; dr <= DR_15; dr++)
+    {
+      for (uint8_t dwell = 0; dwell < 4U; dwell++)
+      {
+        GetPhyParams_t getPhy =
+        {
+          .Attribute = attribute, .Datarate = dr, .UplinkDwellTime = dwell & 1U, .DownlinkDwellTime = dwell >> 1
+        };
+        PhyParam_t dispatched;
+        PhyParam_t direct;
+
+        /* PHY_ACK_TIMEOUT is random */
+        srand1(DISPATCH_SEED);
+        dispatched = RegionGetPhyParam(region->Region, &getPhy);
+        srand1(DISPATCH_SEED);
+        direct = region->GetPhyParam(&getPhy);
+        HOST_TEST_CHECK(memcmp(&dispatched, &direct, sizeof(direct)) == 0);
+      }
+    }
+  }
+
+  for (PhyAttribute_t attribute = 0; attribute <= PHY_BEACON_DELAY_BEACON_TIMING_ANS; attribute++)
+  {
+    for (int8_t dr = -1; dr <= DR_15 + 1; dr++)
+    {
+      VerifyParams_t verify = { .DatarateParams = { .Datarate = dr, .DownlinkDwellTime = 0, .UplinkDwellTime = 0 } };
+
+      HOST_TEST_CHECK(RegionVerify(region->Region, &verify, attribute) == region->Verify(&verify, attribute));
+    }
+  }
+
+  for (int8_t dr = DR_0; dr <= DR_15; dr++)
+  {
+    for (int8_t offset = 0; offset < 8; offset++)
+    {
+      HOST_TEST_CHECK(RegionApplyDrOffset(region->Region, 0, dr, offset) == region->ApplyDrOffset(0, dr, offset));
+      HOST_TEST_CHECK(RegionApplyDrOffset(region->Region, 1, dr, offset) == region->ApplyDrOffset(1, dr, offset));
+    }
+  }
+
+  for (uint32_t round = 0; round < 4U; round++)
+  {
+    DispatchFrame_t dispatched;
+    DispatchFrame_t direct;
+    int8_t datarate = FrameDatarate(region);
+
+    memset(&dispatched, 0, sizeof(dispatched));
+    memset(&direct, 0, sizeof(direct));
+    InitRegion(region);
+    srand1(DISPATCH_SEED + round);
+    FrameDispatch(region, datarate, &dispatched);
+    InitRegion(region);
+    srand1(DISPATCH_SEED + round);
+    FrameDirect(region, datarate, &direct);
+    HOST_TEST_CHECK(dispatched.Status == LORAMAC_STATUS_OK);
+    HOST_TEST_CHECK(dispatched.TxConfigured && dispatched.Rx1Configured && dispatched.Rx2Configured);
+    HOST_TEST_CHECK(memcmp(&dispatched, &direct, sizeof(direct)) == 0);
+  }
+}
+
+static void TestNotEnabled(void)
+{
+  LoRaMacRegion_t region = (LoRaMacRegion_t)(LORAMAC_REGION_RU864 + 1);
+  GetPhyParams_t getPhy = { .Attribute = PHY_MAX_PAYLOAD, .Datarate = DR_0 };
+  VerifyParams_t verify = { .DatarateParams = { .Datarate = DR_0 } };
+  NextChanParams_t nextChan = { .Datarate = DR_0 };
+  TxConfigParams_t txConfig = { .Datarate = DR_0 };
+  RxConfigParams_t rxConfig = { .Datarate = DR_0 };
+  uint8_t channel = 0;
+  TimerTime_t time = 0;
+  int8_t datarate = 0;
+  int8_t txPower = 0;
+
+  HOST_TEST_CHECK(!RegionIsActive(region));
+  HOST_TEST_CHECK(RegionGetPhyParam(region, &getPhy).Value == 0);
+  HOST_TEST_CHECK(!RegionVerify(region, &verify, PHY_TX_DR));
+  HOST_TEST_CHECK(RegionNextChannel(region, &nextChan, &channel, &time, &time) == LORAMAC_STATUS_REGION_NOT_SUPPORTED);
+  HOST_TEST_CHECK(!RegionTxConfig(region, &txConfig, &txPower, &time));
+  HOST_TEST_CHECK(!RegionRxConfig(region, &rxConfig, &datarate));
+  HOST_TEST_CHECK(RegionApplyDrOffset(region, 0, DR_3, 2) == DR_3);
+  HOST_TEST_CHECK(RegionAlternateDr(region, DR_3, ALTERNATE_DR) == 0);
+  HOST_TEST_CHECK(RegionGetNvmCtx(region, &(GetNvmCtxParams_t){ 0 }) == NULL);
+}
+
+static void Bench(void)
+{
+  volatile uint32_t sink = 0;
+
+  printf("%-8s %14s %14s %14s %14s\n", "region", "frame ns", "direct ns", "GetPhyParam ns", "direct ns");
+  for (uint32_t r = 0; r < ARRAY_COUNT(Regions); r++)
+  {
+    const DispatchRegion_t *region = &Regions[r];
+    int8_t datarate = FrameDatarate(region);
+    GetPhyParams_t getPhy = { .Attribute = PHY_MAX_PAYLOAD, .Datarate = datarate };
+    DispatchFrame_t frame;
+    double ns[4];
+    uint64_t start;
+
+    InitRegion(region);
+    start = HostTestNowNs();
+    for (uint32_t i = 0; i < DISPATCH_BENCH_FRAMES; i++)
+    {
+      FrameDispatch(region, datarate, &frame);
+      sink += frame.Channel;
+    }
+    ns[0] = (double)(HostTestNowNs() - start) / DISPATCH_BENCH_FRAMES;
+    InitRegion(region);
+    start = HostTestNowNs();
+    for (uint32_t i = 0; i < DISPATCH_BENCH_FRAMES; i++)
+    {
+      FrameDirect(region, datarate, &frame);
+      sink += frame.Channel;
+    }
+    ns[1] = (double)(HostTestNowNs() - start) / DISPATCH_BENCH_FRAMES;
+    start = HostTestNowNs();
+    for (uint32_t i = 0; i < DISPATCH_BENCH_CALLS; i++)
+    {
+      getPhy.Attribute = (i & 1U) ? PHY_MAX_PAYLOAD : PHY_MAX_FCNT_GAP;
+      sink += RegionGetPhyParam(region->Region, &getPhy).Value;
+    }
+    ns[2] = (double)(HostTestNowNs() - start) / DISPATCH_BENCH_CALLS;
+    start = HostTestNowNs();
+    for (uint32_t i = 0; i < DISPATCH_BENCH_CALLS; i++)
+    {
+      getPhy.Attribute = (i & 1U) ? PHY_MAX_PAYLOAD : PHY_MAX_FCNT_GAP;
+      sink += region->GetPhyParam(&getPhy).Value;
+    }
+    ns[3] = (double)(HostTestNowNs() - start) / DISPATCH_BENCH_CALLS;
+    printf("%-8s %14.1f %14.1f %14.1f %14.1f\n", region->Name, ns[0], ns[1], ns[2], ns[3]);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  for (uint32_t r = 0; r < ARRAY_COUNT(Regions); r++)
+  {
+    TestRegion(&Regions[r]);
+  }
+  TestNotEnabled();
+  if (HOST_TEST_BENCH(argc, argv))
+  {
+    Bench();
+  }
+  return HOST_TEST_RESULT();
+}
@@ -0,0 +1,139 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file se_instance_test.c
+ *
+ * @brief Host test of the soft secure element contexts of two LoRaMac instances
+ *
+ * Each instance is initialized with the EUIs and keys of se-identity.h, then gets its own DevEUI, JoinEUI and AppKey.
+ * The EUIs read through each instance and the AES of a block with the AppKey must be the ones of that instance, and
+ * the secure element context saved by LoRaMac must be the one held by the instance. Initializing one instance again
+ * must not change the other one.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include "host_test_lorawan.h"
+#include "LoRaMacInstance.h"
+#include "secure-element.h"
+#include "se-identity.h"
+#include "lorawan_aes.h"
+
+static LoRaMacInstance_t Instances[2];
+
+static const uint8_t DevEuis[2][SE_EUI_SIZE] =
+{
+  { 0x70, 0xB3, 0xD5, 0x7E, 0xD0, 0x00, 0x00, 0x01 },
+  { 0x70, 0xB3, 0xD5, 0x7E, 0xD0, 0x00, 0x00, 0x02 },
+};
+static const uint8_t JoinEuis[2][SE_EUI_SIZE] =
+{
+  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x11 },
+  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x22 },
+};
+static const uint8_t AppKeys[2][SE_KEY_SIZE] =
+{
+  { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C },
+  { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F },
+};
+static const uint8_t Block[16] =
+{
+  0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A
+};
+
+static void Init(uint32_t i)
+{
+  LoRaMacInstance_t *previous = LoRaMacInstanceSelect(&Instances[i]);
+
+  HOST_TEST_CHECK(HostTestLoRaWANInit(LORAMAC_REGION_EU868) == LORAMAC_STATUS_OK);
+  LoRaMacInstanceSelect(previous);
+}
+
+static void Provision(uint32_t i)
+{
+  MibRequestConfirm_t mibReq;
+
+  mibReq.Type = MIB_DEV_EUI;
+  mibReq.Param.DevEui = (uint8_t *)DevEuis[i];
+  HOST_TEST_CHECK(LoRaMacInstanceMibSetRequestConfirm(&Instances[i], &mibReq) == LORAMAC_STATUS_OK);
+  mibReq.Type = MIB_JOIN_EUI;
+  mibReq.Param.JoinEui = (uint8_t *)JoinEuis[i];
+  HOST_TEST_CHECK(LoRaMacInstanceMibSetRequestConfirm(&Instances[i], &mibReq) == LORAMAC_STATUS_OK);
+  mibReq.Type = MIB_APP_KEY;
+  mibReq.Param.AppKey = (uint8_t *)AppKeys[i];
+  HOST_TEST_CHECK(LoRaMacInstanceMibSetRequestConfirm(&Instances[i], &mibReq) == LORAMAC_STATUS_OK);
+}
+
+/* Checks the EUIs and AppKey of an instance, expected is the index of its provisioning, or -1 for se-identity.h */
+static void Check(uint32_t i, int32_t expected)
+{
+  LoRaMacInstance_t *previous = LoRaMacInstanceSelect(&Instances[i]);
+  uint8_t defaultDevEui[SE_EUI_SIZE] = LORAWAN_DEVICE_EUI;
+  uint8_t defaultJoinEui[SE_EUI_SIZE] = LORAWAN_JOIN_EUI;
+  uint8_t cipher[16];
+  uint8_t reference[16];
+  MibRequestConfirm_t mibReq;
+  size_t size;
+
+  mibReq.Type = MIB_DEV_EUI;
+  HOST_TEST_CHECK(LoRaMacMibGetRequestConfirm(&mibReq) == LORAMAC_STATUS_OK);
+  HOST_TEST_CHECK(memcmp(mibReq.Param.DevEui, (expected < 0) ? defaultDevEui : DevEuis[expected], SE_EUI_SIZE) == 0);
+  mibReq.Type = MIB_JOIN_EUI;
+  HOST_TEST_CHECK(LoRaMacMibGetRequestConfirm(&mibReq) == LORAMAC_STATUS_OK);
+  HOST_TEST_CHECK(memcmp(mibReq.Param.JoinEui, (expected < 0) ? defaultJoinEui : JoinEuis[expected],
+                         SE_EUI_SIZE) == 0);
+
+  /* The MAC saves the context the instance holds */
+  mibReq.Type = MIB_NVM_CTXS;
+  HOST_TEST_CHECK(LoRaMacMibGetRequestConfirm(&mibReq) == LORAMAC_STATUS_OK);
+  HOST_TEST_CHECK(mibReq.Param.Contexts->SecureElementNvmCtx == (void *)Instances[i].SecureElement.NvmCtx);
+  HOST_TEST_CHECK(SecureElementGetNvmCtx(&size) == (void *)Instances[i].SecureElement.NvmCtx);
+  HOST_TEST_CHECK(size <= sizeof(Instances[i].SecureElement.NvmCtx));
+
+  if (expected >= 0)
+  {
+    lorawan_aes_context aes;
+
+    lorawan_aes_set_key(AppKeys[expected], SE_KEY_SIZE, &aes);
+    lorawan_aes_encrypt(Block, reference, &aes);
+    HOST_TEST_CHECK(SecureElementAesEncrypt((uint8_t *)Block, sizeof(Block), APP_KEY, cipher) ==
+                    SECURE_ELEMENT_SUCCESS);
+    HOST_TEST_CHECK(memcmp(cipher, reference, sizeof(cipher)) == 0);
+  }
+  LoRaMacInstanceSelect(previous);
+}
+
+int main(void)
+{
+  Init(0);
+  Init(1);
+  Check(0, -1);
+  Check(1, -1);
+
+  Provision(0);
+  Check(0, 0);
+  Check(1, -1);
+  Provision(1);
+  Check(0, 0);
+  Check(1, 1);
+
+  /* A new initialization resets the context of its instance only */
+  Init(1);
+  Check(0, 0);
+  Check(1, -1);
+  return HOST_TEST_RESULT();
+}
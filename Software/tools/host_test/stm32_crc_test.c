@@ -0,0 +1,274 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file stm32_crc_test.c
+ *
+ * @brief Host test of the table backends of stm32_crc, CRC-32 and CRC-16: pinned check values, and random
+ *        buffers at every alignment split into random incremental calls against bitwise references
+ *
+ * The benchmark gives the throughput of every backend on aligned and unaligned buffers, and the time of the
+ * CRC-16 of a beacon. UTIL_CRC32_Hw and UTIL_CRC16_Hw need the CRC peripheral and are not covered.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include "host_test.h"
+#include "stm32_crc.h"
+
+#define CRC_TEST_BUFFER_SIZE 1024U
+#define CRC_TEST_ROUNDS 20000U
+#define CRC_BENCH_SIZE 4096U
+#define CRC_BENCH_BYTES (64U * 1024U * 1024U)
+/* GwSpecific and RFU of an EU868 beacon, the longer of its two CRC-16 fields */
+#define CRC_BENCH_BEACON_SIZE 7U
+#define CRC_BENCH_BEACON_COUNT 10000000U
+
+typedef uint32_t (*Crc32_t)(uint32_t crc, const void *buffer, uint32_t length);
+typedef uint16_t (*Crc16_t)(uint16_t crc, const void *buffer, uint32_t length);
+
+/* CRC16 is the CRC-16/XMODEM of the data, Crc16Ffff the CRC-16/CCITT-FALSE, same polynomial started at 0xFFFF */
+typedef struct
+{
+  const char *Data;
+  uint32_t Length;
+  uint32_t Crc32;
+  uint16_t Crc16;
+  uint16_t Crc16Ffff;
+} CrcVector_t;
+
+static const CrcVector_t Vectors[] =
+{
+  { "", 0, 0x00000000U, 0x0000U, 0xFFFFU },
+  { "a", 1, 0xE8B7BE43U, 0x7C87U, 0x9D77U },
+  { "abc", 3, 0x352441C2U, 0x9DD6U, 0x514AU },
+  { "123456789", 9, UTIL_CRC32_CHECK, UTIL_CRC16_CHECK, 0x29B1U },
+  { "The quick brown fox jumps over the lazy dog", 43, 0x414FA339U, 0xF0C8U, 0x8FDDU },
+  { "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 32, 0x190A55ADU, 0x0000U, 0xF14CU },
+  { "\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
+    "\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff", 32, 0xFF6CAB0BU, 0x84B4U, 0x75F8U },
+};
+
+static const struct
+{
+  const char *Name;
+  Crc32_t Crc32;
+} Backends32[] =
+{
+  { "UTIL_CRC32_Slice4", UTIL_CRC32_Slice4 },
+  { "UTIL_CRC32_Slice8", UTIL_CRC32_Slice8 },
+  { "UTIL_CRC32_Update", UTIL_CRC32_Update },
+};
+
+static const struct
+{
+  const char *Name;
+  Crc16_t Crc16;
+} Backends16[] =
+{
+  { "UTIL_CRC16_Nibble", UTIL_CRC16_Nibble },
+  { "UTIL_CRC16_Table", UTIL_CRC16_Table },
+  { "UTIL_CRC16_Update", UTIL_CRC16_Update },
+};
+
+#define ARRAY_COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+/* Bit at a time reference of the reflected 0x04C11DB7 polynomial */
+static uint32_t Crc32Reference(uint32_t crc, const void *buffer, uint32_t length)
+{
+  const uint8_t *data = (const uint8_t *)buffer;
+
+  crc = ~crc;
+  while (length-- > 0U)
+  {
+    crc ^= *data++;
+    for (uint32_t bit = 0; bit < 8U; bit++)
+    {
+      crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+    }
+  }
+  return ~crc;
+}
+
+/* Bit at a time reference of the 0x1021 polynomial, not reflected */
+static uint16_t Crc16Reference(uint16_t crc, const void *buffer, uint32_t length)
+{
+  const uint8_t *data = (const uint8_t *)buffer;
+
+  while (length-- > 0U)
+  {
+    crc ^= (uint16_t)(*data++ << 8);
+    for (uint32_t bit = 0; bit < 8U; bit++)
+    {
+      crc = (uint16_t)((crc << 1) ^ (0x1021U & (0U - (crc >> 15))));
+    }
+  }
+  return crc;
+}
+
+static void TestCrc32(void)
+{
+  /* 8 extra bytes to start at every alignment */
+  static uint8_t buffer[CRC_TEST_BUFFER_SIZE + 8U];
+
+  for (uint32_t v = 0; v < ARRAY_COUNT(Vectors); v++)
+  {
+    HOST_TEST_CHECK(Crc32Reference(UTIL_CRC32_INIT, Vectors[v].Data, Vectors[v].Length) == Vectors[v].Crc32);
+    for (uint32_t b = 0; b < ARRAY_COUNT(Backends32); b++)
+    {
+      HOST_TEST_CHECK(Backends32[b].Crc32(UTIL_CRC32_INIT, Vectors[v].Data, Vectors[v].Length) == Vectors[v].Crc32);
+    }
+  }
+
+  for (uint32_t round = 0; round < CRC_TEST_ROUNDS; round++)
+  {
+    uint32_t offset = HostTestRandomBelow(8);
+    uint32_t length = HostTestRandomBelow(CRC_TEST_BUFFER_SIZE + 1U);
+    uint32_t expected;
+
+    for (uint32_t i = 0; i < length; i++)
+    {
+      buffer[offset + i] = (uint8_t)HostTestRandom();
+    }
+    expected = Crc32Reference(UTIL_CRC32_INIT, &buffer[offset], length);
+    for (uint32_t b = 0; b < ARRAY_COUNT(Backends32); b++)
+    {
+      uint32_t crc = UTIL_CRC32_INIT;
+      uint32_t done = 0;
+
+      HOST_TEST_CHECK(Backends32[b].Crc32(UTIL_CRC32_INIT, &buffer[offset], length) == expected);
+      /* Incremental calls, each one starting at any alignment */
+      while (done < length)
+      {
+        uint32_t part = 1U + HostTestRandomBelow(length - done);
+
+        crc = Backends32[b].Crc32(crc, &buffer[offset + done], part);
+        done += part;
+      }
+      HOST_TEST_CHECK(crc == expected);
+    }
+  }
+}
+
+static void TestCrc16(void)
+{
+  static uint8_t buffer[CRC_TEST_BUFFER_SIZE + 8U];
+
+  for (uint32_t v = 0; v < ARRAY_COUNT(Vectors); v++)
+  {
+    HOST_TEST_CHECK(Crc16Reference(UTIL_CRC16_INIT, Vectors[v].Data, Vectors[v].Length) == Vectors[v].Crc16);
+    HOST_TEST_CHECK(Crc16Reference(0xFFFFU, Vectors[v].Data, Vectors[v].Length) == Vectors[v].Crc16Ffff);
+    for (uint32_t b = 0; b < ARRAY_COUNT(Backends16); b++)
+    {
+      HOST_TEST_CHECK(Backends16[b].Crc16(UTIL_CRC16_INIT, Vectors[v].Data, Vectors[v].Length) == Vectors[v].Crc16);
+      HOST_TEST_CHECK(Backends16[b].Crc16(0xFFFFU, Vectors[v].Data, Vectors[v].Length) == Vectors[v].Crc16Ffff);
+    }
+  }
+
+  for (uint32_t round = 0; round < CRC_TEST_ROUNDS; round++)
+  {
+    uint32_t offset = HostTestRandomBelow(8);
+    uint32_t length = HostTestRandomBelow(CRC_TEST_BUFFER_SIZE + 1U);
+    uint16_t init = (uint16_t)HostTestRandom();
+    uint16_t expected;
+
+    for (uint32_t i = 0; i < length; i++)
+    {
+      buffer[offset + i] = (uint8_t)HostTestRandom();
+    }
+    expected = Crc16Reference(init, &buffer[offset], length);
+    for (uint32_t b = 0; b < ARRAY_COUNT(Backends16); b++)
+    {
+      uint16_t crc = init;
+      uint32_t done = 0;
+
+      HOST_TEST_CHECK(Backends16[b].Crc16(init, &buffer[offset], length) == expected);
+      while (done < length)
+      {
+        uint32_t part = 1U + HostTestRandomBelow(length - done);
+
+        crc = Backends16[b].Crc16(crc, &buffer[offset + done], part);
+        done += part;
+      }
+      HOST_TEST_CHECK(crc == expected);
+    }
+  }
+}
+
+static void Bench(void)
+{
+  static uint8_t buffer[CRC_BENCH_SIZE + 8U];
+  volatile uint32_t sink = 0;
+
+  for (uint32_t i = 0; i < sizeof(buffer); i++)
+  {
+    buffer[i] = (uint8_t)HostTestRandom();
+  }
+  printf("%-20s %10s %10s\n", "CRC-32", "MB/s", "unaligned");
+  for (uint32_t b = 0; b <= ARRAY_COUNT(Backends32); b++)
+  {
+    Crc32_t crc32 = (b < ARRAY_COUNT(Backends32)) ? Backends32[b].Crc32 : Crc32Reference;
+    double rates[2];
+
+    for (uint32_t offset = 0; offset < 2U; offset++)
+    {
+      uint64_t start = HostTestNowNs();
+
+      for (uint32_t done = 0; done < CRC_BENCH_BYTES; done += CRC_BENCH_SIZE)
+      {
+        sink ^= crc32(sink, &buffer[offset * 3U], CRC_BENCH_SIZE);
+      }
+      rates[offset] = (double)CRC_BENCH_BYTES * 1e3 / (double)(HostTestNowNs() - start);
+    }
+    printf("%-20s %10.0f %10.0f\n", (b < ARRAY_COUNT(Backends32)) ? Backends32[b].Name : "bitwise", rates[0], rates[1]);
+  }
+
+  printf("%-20s %10s %10s %10s\n", "CRC-16", "MB/s", "unaligned", "beacon ns");
+  for (uint32_t b = 0; b <= ARRAY_COUNT(Backends16); b++)
+  {
+    Crc16_t crc16 = (b < ARRAY_COUNT(Backends16)) ? Backends16[b].Crc16 : Crc16Reference;
+    double rates[2];
+    uint64_t start;
+
+    for (uint32_t offset = 0; offset < 2U; offset++)
+    {
+      start = HostTestNowNs();
+      for (uint32_t done = 0; done < CRC_BENCH_BYTES; done += CRC_BENCH_SIZE)
+      {
+        sink ^= crc16((uint16_t)sink, &buffer[offset * 3U], CRC_BENCH_SIZE);
+      }
+      rates[offset] = (double)CRC_BENCH_BYTES * 1e3 / (double)(HostTestNowNs() - start);
+    }
+    start = HostTestNowNs();
+    for (uint32_t i = 0; i < CRC_BENCH_BEACON_COUNT; i++)
+    {
+      sink ^= crc16(UTIL_CRC16_INIT, &buffer[i & 0xFFU], CRC_BENCH_BEACON_SIZE);
+    }
+    printf("%-20s %10.0f %10.0f %10.1f\n", (b < ARRAY_COUNT(Backends16)) ? Backends16[b].Name : "bitwise", rates[0],
+           rates[1], (double)(HostTestNowNs() - start) / CRC_BENCH_BEACON_COUNT);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  TestCrc32();
+  TestCrc16();
+  if (HOST_TEST_BENCH(argc, argv))
+  {
+    Bench();
+  }
+  return HOST_TEST_RESULT();
+}
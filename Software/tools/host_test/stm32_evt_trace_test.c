@@ -0,0 +1,155 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file stm32_evt_trace_test.c
+ *
+ * @brief Host test of the event trace ring: recording before and after UTIL_EVT_TRACE_Init, the wrap of the ring
+ *        overwriting the oldest records, and the resync of the UTIL_EVT_TRACE_Read cursors
+ *
+ * Every record carries its sequence number in its value and the time of a clock started near its 32-bit wrap. A
+ * reader that keeps up must get every record in order; a cursor left behind by more than the ring must resync to the
+ * oldest record still in the ring and then get the UTIL_EVT_TRACE_SIZE last ones, a cursor exactly one ring behind
+ * must not skip any. A cursor of before UTIL_EVT_TRACE_Init must restart at the first record of the new trace.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include "host_test.h"
+#include "stm32_evt_trace.h"
+
+#define EVT_TRACE_TEST_TIME_START 0xFFFFFFF0U
+#define EVT_TRACE_TEST_TICKS_PER_SECOND 32768U
+
+static uint32_t Clock;
+
+static uint32_t GetTime(void)
+{
+  return Clock;
+}
+
+/* Records seq, the time of the record is the one of the clock before its increment */
+static void Record(uint32_t seq)
+{
+  UTIL_EVT_TRACE(UTIL_EVT_TRACE_RADIO_IRQ + (seq % UTIL_EVT_TRACE_RX_WINDOW), seq >> 16, seq);
+  Clock++;
+}
+
+/* Reads the records of first to end - 1 from a cursor, then checks that there is none after them */
+static void CheckRead(uint32_t *cursor, uint32_t first, uint32_t end)
+{
+  UTIL_EVT_TRACE_Record_t record;
+
+  for (uint32_t seq = first; seq != end; seq++)
+  {
+    HOST_TEST_CHECK(UTIL_EVT_TRACE_Read(cursor, &record));
+    HOST_TEST_CHECK(*cursor == seq + 1U);
+    HOST_TEST_CHECK(record.Id == UTIL_EVT_TRACE_RADIO_IRQ + (seq % UTIL_EVT_TRACE_RX_WINDOW));
+    HOST_TEST_CHECK(record.Arg == (uint8_t)(seq >> 16));
+    HOST_TEST_CHECK(record.Value == (uint16_t)seq);
+    HOST_TEST_CHECK(record.Time == EVT_TRACE_TEST_TIME_START + seq);
+  }
+  HOST_TEST_CHECK(!UTIL_EVT_TRACE_Read(cursor, &record));
+  HOST_TEST_CHECK(*cursor == end);
+}
+
+static void Start(void)
+{
+  Clock = EVT_TRACE_TEST_TIME_START;
+  UTIL_EVT_TRACE_Init(GetTime, EVT_TRACE_TEST_TICKS_PER_SECOND);
+  HOST_TEST_CHECK(UTIL_EVT_TRACE_Ring.Count == 0U);
+  HOST_TEST_CHECK(UTIL_EVT_TRACE_Ring.TicksPerSecond == EVT_TRACE_TEST_TICKS_PER_SECOND);
+}
+
+static void TestDisabled(void)
+{
+  uint32_t cursor = 0;
+  UTIL_EVT_TRACE_Record_t record;
+
+  HOST_TEST_CHECK(UTIL_EVT_TRACE_Ring.Magic == UTIL_EVT_TRACE_MAGIC);
+  HOST_TEST_CHECK(UTIL_EVT_TRACE_Ring.Size == UTIL_EVT_TRACE_SIZE);
+  Record(0);
+  HOST_TEST_CHECK(UTIL_EVT_TRACE_Ring.Count == 0U);
+  HOST_TEST_CHECK(!UTIL_EVT_TRACE_Read(&cursor, &record));
+
+  /* A NULL clock stops recording */
+  Start();
+  Record(0);
+  UTIL_EVT_TRACE_Init(NULL, 0);
+  Record(1);
+  HOST_TEST_CHECK(UTIL_EVT_TRACE_Ring.Count == 0U);
+}
+
+static void TestWrap(void)
+{
+  uint32_t reader = 0;
+  uint32_t stale = 0;
+  uint32_t behind = 0;
+  uint32_t seq = 0;
+
+  Start();
+  for (; seq < UTIL_EVT_TRACE_SIZE / 2U; seq++)
+  {
+    Record(seq);
+  }
+  CheckRead(&reader, 0, seq);
+
+  /* The ring wraps a few times, the reader keeps up and the stale cursor stays at the first record */
+  for (uint32_t round = 0; round < 4U * UTIL_EVT_TRACE_SIZE; round += 5U)
+  {
+    for (uint32_t i = 0; i < 5U; i++, seq++)
+    {
+      Record(seq);
+    }
+    CheckRead(&reader, seq - 5U, seq);
+  }
+  HOST_TEST_CHECK(UTIL_EVT_TRACE_Ring.Count == seq);
+  HOST_TEST_CHECK(UTIL_EVT_TRACE_Ring.Records[(seq - 1U) & (UTIL_EVT_TRACE_SIZE - 1U)].Value == (uint16_t)(seq - 1U));
+  HOST_TEST_CHECK(UTIL_EVT_TRACE_Ring.Records[seq & (UTIL_EVT_TRACE_SIZE - 1U)].Value ==
+                  (uint16_t)(seq - UTIL_EVT_TRACE_SIZE));
+  CheckRead(&stale, seq - UTIL_EVT_TRACE_SIZE, seq);
+
+  /* Exactly one ring behind, nothing is lost */
+  behind = seq;
+  for (uint32_t i = 0; i < UTIL_EVT_TRACE_SIZE; i++, seq++)
+  {
+    Record(seq);
+  }
+  CheckRead(&behind, behind, seq);
+
+  /* One record more than the ring, the oldest one is skipped */
+  behind = seq;
+  for (uint32_t i = 0; i <= UTIL_EVT_TRACE_SIZE; i++, seq++)
+  {
+    Record(seq);
+  }
+  CheckRead(&behind, behind + 1U, seq);
+
+  /* A cursor of before the initialization restarts at the first record of the new trace */
+  Start();
+  for (seq = 0; seq < 3U; seq++)
+  {
+    Record(seq);
+  }
+  CheckRead(&reader, 0, seq);
+}
+
+int main(void)
+{
+  TestDisabled();
+  TestWrap();
+  return HOST_TEST_RESULT();
+}
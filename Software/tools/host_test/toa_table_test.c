@@ -0,0 +1,191 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file toa_table_test.c
+ *
+ * @brief Host test of the time-on-air table of RegionCommon: every region using it regenerates its table, each
+ *        datarate and payload length from 0 to 255 bytes is looked up and compared with the closed-form formula
+ *        of the datasheet, on the datarates and bandwidths of the LoRaWAN regional parameters
+ *
+ * The lookups of the datarates held by the table must not call Radio.TimeOnAir, the other datarates and the
+ * lengths above 255 bytes must give the formula. The benchmark gives the time of a lookup and of the formula.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include "host_test_lorawan.h"
+#include "LoRaMacInstance.h"
+#include "RegionCommon.h"
+
+#define TOA_BENCH_LOOKUPS 10000000U
+#define TOA_FSK 0xFFU
+
+typedef struct
+{
+  const char *Name;
+  LoRaMacRegion_t Region;
+  int8_t TxMinDr;
+  int8_t TxMaxDr;
+  /* Spreading factor, TOA_FSK for the 50 kbit/s FSK datarate, 0 if the datarate is not used */
+  uint8_t SpreadingFactors[DR_15 + 1];
+  uint32_t Bandwidths[DR_15 + 1];
+} ToaRegion_t;
+
+#define TOA_EU_SPREADING_FACTORS { 12, 11, 10, 9, 8, 7, 7, TOA_FSK }
+#define TOA_EU_BANDWIDTHS { 125000, 125000, 125000, 125000, 125000, 125000, 250000 }
+
+static const ToaRegion_t Regions[] =
+{
+  { "EU868", LORAMAC_REGION_EU868, DR_0, DR_7, TOA_EU_SPREADING_FACTORS, TOA_EU_BANDWIDTHS },
+  { "CN779", LORAMAC_REGION_CN779, DR_0, DR_7, TOA_EU_SPREADING_FACTORS, TOA_EU_BANDWIDTHS },
+  { "RU864", LORAMAC_REGION_RU864, DR_0, DR_7, TOA_EU_SPREADING_FACTORS, TOA_EU_BANDWIDTHS },
+  { "IN865", LORAMAC_REGION_IN865, DR_0, DR_7, TOA_EU_SPREADING_FACTORS, TOA_EU_BANDWIDTHS },
+  { "KR920", LORAMAC_REGION_KR920, DR_0, DR_5, { 12, 11, 10, 9, 8, 7 },
+    { 125000, 125000, 125000, 125000, 125000, 125000 } },
+  { "US915", LORAMAC_REGION_US915, DR_0, DR_4, { 10, 9, 8, 7, 8, 0, 0, 0, 12, 11, 10, 9, 8, 7 },
+    { 125000, 125000, 125000, 125000, 500000, 0, 0, 0, 500000, 500000, 500000, 500000, 500000, 500000 } },
+};
+
+#define ARRAY_COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+/* LoRaWAN frames: coding rate 4/5, 8 preamble symbols, explicit header and CRC, FSK with 5 preamble bytes */
+static uint32_t ClosedForm(const ToaRegion_t *region, int8_t datarate, uint16_t pktLen)
+{
+  if (region->SpreadingFactors[datarate] == TOA_FSK)
+  {
+    return HostTestTimeOnAir(MODEM_FSK, 0, 50000, 0, 5, false, (uint8_t)pktLen, true);
+  }
+  return HostTestTimeOnAir(MODEM_LORA, region->Bandwidths[datarate], region->SpreadingFactors[datarate], 1, 8, false,
+                           (uint8_t)pktLen, true);
+}
+
+static void InitRegion(const ToaRegion_t *region)
+{
+  InitDefaultsParams_t params = { .NvmCtx = NULL, .Type = INIT_TYPE_DEFAULTS };
+
+  RegionInitDefaults(region->Region, &params);
+}
+
+static void TestRegion(const ToaRegion_t *region)
+{
+  const RegionCommonTimeOnAirTable_t *table = &LoRaMacCurrentInstance->TimeOnAirTable;
+  uint32_t tableDatarates = 0;
+
+  HostTestLoRaWANTimeOnAirCalls = 0;
+  InitRegion(region);
+  printf("%s: table of %u steps built with %u formula calls,", region->Name, table->First[DR_15 + 1],
+         HostTestLoRaWANTimeOnAirCalls);
+  HOST_TEST_CHECK(table->Formula != NULL);
+  HOST_TEST_CHECK(table->First[DR_15 + 1] <= REGION_COMMON_TOA_TABLE_STEPS);
+
+  for (int8_t dr = DR_0; dr <= DR_15; dr++)
+  {
+    bool inTable = table->First[dr] < table->First[dr + 1];
+
+    if (region->SpreadingFactors[dr] == 0)
+    {
+      HOST_TEST_CHECK(!inTable);
+      continue;
+    }
+    /* The uplink datarates only, each one starting at length 0 */
+    HOST_TEST_CHECK(!inTable || ((dr >= region->TxMinDr) && (dr <= region->TxMaxDr)));
+    HOST_TEST_CHECK(!inTable || (table->StepLength[table->First[dr]] == 0));
+    if (inTable)
+    {
+      printf(" DR%d %u", dr, table->First[dr + 1] - table->First[dr]);
+      tableDatarates++;
+    }
+    for (uint16_t pktLen = 0; pktLen <= UINT8_MAX; pktLen++)
+    {
+      uint32_t calls = HostTestLoRaWANTimeOnAirCalls;
+      TimerTime_t timeOnAir = RegionCommonGetTimeOnAir(table->Formula, dr, pktLen);
+
+      if (timeOnAir != ClosedForm(region, dr, pktLen))
+      {
+        printf("\n%s DR%d %u bytes: %u ms, closed form %u ms", region->Name, dr, pktLen, (unsigned)timeOnAir,
+               ClosedForm(region, dr, pktLen));
+      }
+      HOST_TEST_CHECK(timeOnAir == ClosedForm(region, dr, pktLen));
+      HOST_TEST_CHECK((HostTestLoRaWANTimeOnAirCalls - calls) == (inTable ? 0U : 1U));
+    }
+    /* The lengths above the table use the formula */
+    uint32_t calls = HostTestLoRaWANTimeOnAirCalls;
+    (void)RegionCommonGetTimeOnAir(table->Formula, dr, UINT8_MAX + 1);
+    HOST_TEST_CHECK((HostTestLoRaWANTimeOnAirCalls - calls) == 1U);
+  }
+  printf("\n");
+  /* All the uplink datarates of the regions fit */
+  HOST_TEST_CHECK(tableDatarates == (uint32_t)(region->TxMaxDr - region->TxMinDr + 1));
+}
+
+static void TestOtherFormula(void)
+{
+  const RegionCommonTimeOnAirTable_t *table = &LoRaMacCurrentInstance->TimeOnAirTable;
+  RegionCommonTimeOnAirFormula_t formula;
+  uint32_t calls;
+
+  /* The table of the last region initialized is not used for another region */
+  InitRegion(&Regions[0]);
+  formula = table->Formula;
+  InitRegion(&Regions[ARRAY_COUNT(Regions) - 1]);
+  calls = HostTestLoRaWANTimeOnAirCalls;
+  HOST_TEST_CHECK(RegionCommonGetTimeOnAir(formula, DR_7, 20) == ClosedForm(&Regions[0], DR_7, 20));
+  HOST_TEST_CHECK((HostTestLoRaWANTimeOnAirCalls - calls) == 1U);
+}
+
+static void Bench(void)
+{
+  const RegionCommonTimeOnAirTable_t *table = &LoRaMacCurrentInstance->TimeOnAirTable;
+  volatile uint32_t sink = 0;
+
+  printf("%-8s %12s %12s\n", "region", "table ns", "formula ns");
+  for (uint32_t r = 0; r < ARRAY_COUNT(Regions); r++)
+  {
+    const ToaRegion_t *region = &Regions[r];
+    uint32_t datarates = (uint32_t)(region->TxMaxDr - region->TxMinDr + 1);
+    uint64_t start;
+    double lookup;
+
+    InitRegion(region);
+    start = HostTestNowNs();
+    for (uint32_t i = 0; i < TOA_BENCH_LOOKUPS; i++)
+    {
+      sink += RegionCommonGetTimeOnAir(table->Formula, region->TxMinDr + (int8_t)(i % datarates), i & 0xFFU);
+    }
+    lookup = (double)(HostTestNowNs() - start) / TOA_BENCH_LOOKUPS;
+    start = HostTestNowNs();
+    for (uint32_t i = 0; i < TOA_BENCH_LOOKUPS; i++)
+    {
+      sink += table->Formula(region->TxMinDr + (int8_t)(i % datarates), i & 0xFFU);
+    }
+    printf("%-8s %12.1f %12.1f\n", region->Name, lookup, (double)(HostTestNowNs() - start) / TOA_BENCH_LOOKUPS);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  for (uint32_t r = 0; r < ARRAY_COUNT(Regions); r++)
+  {
+    TestRegion(&Regions[r]);
+  }
+  TestOtherFormula();
+  if (HOST_TEST_BENCH(argc, argv))
+  {
+    Bench();
+  }
+  return HOST_TEST_RESULT();
+}
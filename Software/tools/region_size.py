@@ -0,0 +1,92 @@
+"""
+Copyright 2021 The Things Industries B.V.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+# Prints the code size of the Region*() dispatch of Region.c for one region, the EU868 and US915 regions of the
+# applications, and all the regions. With --base, Region.c of a git revision is built with the same headers and
+# flags, e.g. the revision before the operation tables to compare them with the switch of every Region*() function.
+# The sections are summed as text, read-only data (with the relocated constants of position independent code) and
+# data. python3 tools/host_test.py region_dispatch checks the dispatch and measures its time.
+#
+#   $ python3 tools/region_size.py
+#   $ CC=cc SIZE=size python3 tools/region_size.py --flags "" -O 2 --base <revision>
+
+import os
+import subprocess
+import sys
+import tempfile
+
+from fleet_sim import NODE_INCLUDES, SOFTWARE_DIR
+from soft_float_check import TARGET_FLAGS
+
+REGION_C = os.path.join('lib', 'STM32WLxx_LoRaWAN', 'LoRaWAN', 'Mac', 'region', 'Region.c')
+CONFIGURATIONS = [
+    ('EU868', ['EU868']),
+    ('EU868 US915', ['EU868', 'US915']),
+    ('all', ['AS923', 'AU915', 'CN470', 'CN779', 'EU433', 'EU868', 'KR920', 'IN865', 'US915', 'RU864']),
+]
+
+
+def section_sizes(size_tool, obj):
+    """Returns the text, rodata and data sizes of an object"""
+    sizes = {'text': 0, 'rodata': 0, 'data': 0}
+    output = subprocess.check_output([size_tool, '-A', obj], universal_newlines=True)
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) < 2 or not fields[0].startswith('.') or not fields[1].isdigit():
+            continue
+        name, value = fields[0], int(fields[1])
+        if name.startswith('.text'):
+            sizes['text'] += value
+        elif name.startswith('.rodata') or name.startswith('.data.rel.ro'):
+            sizes['rodata'] += value
+        elif name.startswith('.data'):
+            sizes['data'] += value
+    return sizes
+
+
+def build(compiler, size_tool, source, regions, flags, tmp):
+    obj = os.path.join(tmp, 'Region.o')
+    command = [compiler, '-c'] + flags + ['-DREGION_' + region for region in regions] + \
+        ['-I' + include for include in NODE_INCLUDES] + [source, '-o', obj]
+    if subprocess.call(command) != 0:
+        sys.exit('Failed to build %s' % source)
+    return section_sizes(size_tool, obj)
+
+
+if __name__ == '__main__':
+    import argparse
+
+    parser = argparse.ArgumentParser(description='Print the code size of the Region*() dispatch of Region.c.')
+    parser.add_argument('--flags', default=TARGET_FLAGS, help='target flags (default: %(default)s)')
+    parser.add_argument('-O', dest='optimization', default='s', help='optimization level (default: %(default)s)')
+    parser.add_argument('--base', help='git revision of Region.c to compare with')
+    args = parser.parse_args()
+
+    compiler = os.environ.get('CC', 'arm-none-eabi-gcc')
+    size_tool = os.environ.get('SIZE', 'arm-none-eabi-size')
+    flags = args.flags.split() + ['-O' + args.optimization, '-std=gnu11', '-w']
+
+    with tempfile.TemporaryDirectory() as tmp:
+        sources = [('tree', os.path.join(SOFTWARE_DIR, REGION_C))]
+        if args.base:
+            base = os.path.join(tmp, 'Region.c')
+            with open(base, 'wb') as f:
+                f.write(subprocess.check_output(['git', 'show', '%s:./%s' % (args.base, REGION_C)], cwd=SOFTWARE_DIR))
+            sources.insert(0, (args.base, base))
+
+        print('Region.o -O%s, %s' % (args.optimization, ' '.join(args.flags.split()) or 'host'))
+        print('%-12s %-12s %8s %8s %8s' % ('regions', 'Region.c', 'text', 'rodata', 'data'))
+        for name, regions in CONFIGURATIONS:
+            for label, source in sources:
+                sizes = build(compiler, size_tool, source, regions, flags, tmp)
+                print('%-12s %-12s %8d %8d %8d' % (name, label, sizes['text'], sizes['rodata'], sizes['data']))
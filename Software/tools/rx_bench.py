@@ -0,0 +1,312 @@
+"""
+Copyright 2021 The Things Industries B.V.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+# Benchmarks the RX path of the firmware LoRaMac on the host. A corpus of received PHY payloads is replayed
+# through the radio RX done event of LoRaMac built for the host (see rx_bench/rx_bench.c), which measures for
+# every frame the time from the radio IRQ to the MAC primitive giving it to the application (McpsIndication
+# for a data frame), the time to the end of LoRaMacProcess(), the stack high-water mark and the heap allocations.
+#
+# The corpus is a text file, see rx_bench/rx_bench.c for its format. Without a corpus, a representative one is
+# generated: unicast downlinks with and without MAC commands, Class C multicast fragments, Class B beacons, frames
+# with an invalid MIC, downlinks of other devices and replayed downlinks. --baseline compares the result with the --json output of an earlier run and exits
+# with an error on a regression, to be run in CI.
+
+import json
+import os
+import random
+import subprocess
+import sys
+
+from fleet_sim import TOOLS_DIR, NODE_DIR, build_node, frame_mic, frame_payload_crypt
+
+BENCH_DIR = os.path.join(TOOLS_DIR, 'rx_bench')
+BENCH_FLAGS = ['-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free', '-lm']
+
+# LoRaMacEventInfoStatus_t of LoRaMac.h
+EVENT_INFO_STATUS = {0: 'ok', 1: 'error', 8: 'downlink-repeated', 10: 'fcnt-gap', 11: 'address-fail',
+                     12: 'mic-fail', 13: 'multicast-fail', 14: 'beacon-locked', 16: 'beacon-not-found'}
+
+# EU868
+RX2_FREQUENCY = 869525000
+RX2_DATARATE = 0
+BEACON_RFU1_SIZE = 2
+# GPS time of the start of the corpus in s
+GPS_EPOCH_OFFSET_S = 1300000000
+# LoRaMacClassBConfig.h
+CLASSB_BEACON_INTERVAL = 128000
+CLASSB_BEACON_GUARD = 3000
+# RX done of a beacon after the beacon period start, its time on air at SF9
+BEACON_RX_DONE_MS = 152
+
+# Data frame mix of the generated corpus in percent, a beacon is added every beacon interval
+CORPUS_MIX = [('unicast', 45), ('unicast-confirmed', 5), ('unicast-fopts', 15), ('mac-port0', 5),
+              ('multicast-frag', 20), ('bad-mic', 10), ('other-device', 30), ('replay', 5)]
+# Largest FRMPayload of a downlink in RX2 at DR0
+MAX_PAYLOAD = 51
+FRAG_PORT = 201
+APP_PORT = 2
+
+# Latency histogram buckets in us
+HISTOGRAM_US = [1, 2, 4, 8, 16, 32, 64, 128]
+
+
+def beacon_crc(data):
+    """CRC-16/CCITT of BeaconCrc() in LoRaMacClassB.c"""
+    crc = 0
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def beacon(gps_seconds, info):
+    time = bytes(BEACON_RFU1_SIZE) + gps_seconds.to_bytes(4, 'little')
+    gw_specific = bytes([0]) + info
+    return time + beacon_crc(time).to_bytes(2, 'little') + gw_specific + beacon_crc(gw_specific).to_bytes(2, 'little')
+
+
+def data_down(mtype, devaddr, fcnt, fopts, port, payload, nwkskey, appskey):
+    """Downlink data frame of LoRaWAN 1.0.x, the MAC commands of port 0 are encrypted with nwkskey"""
+    frame = bytes([mtype << 5]) + devaddr.to_bytes(4, 'little') + bytes([len(fopts)]) + \
+        (fcnt & 0xFFFF).to_bytes(2, 'little') + fopts
+    if port is not None:
+        key = nwkskey if port == 0 else appskey
+        frame += bytes([port]) + frame_payload_crypt(key, 1, devaddr, fcnt, payload)
+    return frame + frame_mic(nwkskey, 1, devaddr, fcnt, frame)
+
+
+def generate_corpus(frames, seed):
+    rng = random.Random(seed)
+    devaddr = 0x26000000 | rng.getrandbits(24)
+    nwkskey = bytes(rng.getrandbits(8) for _ in range(16))
+    appskey = bytes(rng.getrandbits(8) for _ in range(16))
+    mcaddr = 0x01000000 | rng.getrandbits(24)
+    mcnwkskey = bytes(rng.getrandbits(8) for _ in range(16))
+    mcappskey = bytes(rng.getrandbits(8) for _ in range(16))
+    # Devices of the same network around this one
+    others = [(0x26000000 | rng.getrandbits(24), bytes(rng.getrandbits(8) for _ in range(16)),
+               bytes(rng.getrandbits(8) for _ in range(16))) for _ in range(8)]
+    otherfcnt = [0] * len(others)
+    lines = ['# rx_bench corpus, generated with seed %d' % seed,
+             'SESSION %08x %s %s' % (devaddr, nwkskey.hex(), appskey.hex()),
+             'MULTICAST %08x %s %s %d %d' % (mcaddr, mcnwkskey.hex(), mcappskey.hex(), RX2_FREQUENCY, RX2_DATARATE)]
+    labels = [label for label, weight in CORPUS_MIX for _ in range(weight)]
+    fcnt = 0
+    mcfcnt = 0
+    fragment = 0
+    last = None
+    time = 0
+    next_beacon = CLASSB_BEACON_INTERVAL
+    while len(lines) < frames + 3:
+        time += rng.randrange(1000, 10000)
+        rssi = rng.randrange(-120, -40)
+        snr = rng.randrange(-15, 10)
+        if time >= next_beacon - CLASSB_BEACON_GUARD:
+            # Nothing else is received in the beacon windows
+            time = next_beacon + BEACON_RX_DONE_MS
+            info = bytes(rng.getrandbits(8) for _ in range(6))
+            frame = beacon(GPS_EPOCH_OFFSET_S + next_beacon // 1000, info)
+            lines.append('RX %d BEACON beacon %d %d %s' % (time, rssi, snr, frame.hex()))
+            time = next_beacon + CLASSB_BEACON_GUARD
+            next_beacon += CLASSB_BEACON_INTERVAL
+            continue
+        label = rng.choice(labels)
+        payload = bytes(rng.getrandbits(8) for _ in range(rng.randrange(1, MAX_PAYLOAD)))
+        if label == 'unicast':
+            fcnt += 1
+            frame = data_down(3, devaddr, fcnt, b'', APP_PORT, payload, nwkskey, appskey)
+        elif label == 'unicast-confirmed':
+            fcnt += 1
+            frame = data_down(5, devaddr, fcnt, b'', APP_PORT, payload, nwkskey, appskey)
+        elif label == 'unicast-fopts':
+            # DevStatusReq, LinkADRReq DR5 on channels 0-2, RXTimingSetupReq 1 s
+            fcnt += 1
+            fopts = bytes([0x06, 0x03, 0x50, 0x07, 0x00, 0x01, 0x08, 0x01])
+            frame = data_down(3, devaddr, fcnt, fopts, APP_PORT, payload[:MAX_PAYLOAD - 1 - len(fopts)], nwkskey,
+                              appskey)
+        elif label == 'mac-port0':
+            # NewChannelReq of channel 3 on 867.1 MHz DR0-5, DutyCycleReq, DevStatusReq
+            fcnt += 1
+            commands = bytes([0x07, 0x03]) + (8671000).to_bytes(3, 'little') + bytes([0x50, 0x04, 0x00, 0x06])
+            frame = data_down(3, devaddr, fcnt, b'', 0, commands, nwkskey, appskey)
+        elif label == 'multicast-frag':
+            # FragDataFragment of fragmentation session 0
+            mcfcnt += 1
+            fragment += 1
+            payload = bytes([0x08]) + (fragment & 0x3FFF).to_bytes(2, 'little') + \
+                bytes(rng.getrandbits(8) for _ in range(MAX_PAYLOAD - 4))
+            frame = data_down(3, mcaddr, mcfcnt, b'', FRAG_PORT, payload, mcnwkskey, mcappskey)
+        elif label == 'other-device':
+            other = rng.randrange(len(others))
+            otherfcnt[other] += 1
+            frame = data_down(3, others[other][0], otherfcnt[other], b'', APP_PORT, payload, others[other][1],
+                              others[other][2])
+        elif label == 'replay' and last is not None:
+            # Repeated or replayed copy of the last unicast downlink
+            frame = last
+        else:
+            label = 'bad-mic'
+            frame = bytearray(data_down(3, devaddr, fcnt + 1, b'', APP_PORT, payload, nwkskey, appskey))
+            frame[-1] ^= 0xFF
+            frame = bytes(frame)
+        if label.startswith('unicast') or label == 'mac-port0':
+            last = frame
+        lines.append('RX %d C %s %d %d %s' % (time, label, rssi, snr, frame.hex()))
+    return '\n'.join(lines) + '\n'
+
+
+def percentile(values, fraction):
+    values = sorted(values)
+    return values[min(int(fraction * len(values)), len(values) - 1)]
+
+
+def run(corpus, passes):
+    binary = build_node('rx_bench', (BENCH_DIR, NODE_DIR), BENCH_FLAGS)
+    labels = [line.split()[3] for line in corpus.splitlines() if line.startswith('RX ')]
+    process = subprocess.run([binary, str(passes)], input=corpus, stdout=subprocess.PIPE, universal_newlines=True)
+    if process.returncode != 0:
+        sys.exit('rx_bench failed')
+    frames = [{'label': label, 'latency': [], 'total': [], 'stack': 0, 'allocations': 0, 'status': None}
+              for label in labels]
+    for line in process.stdout.splitlines():
+        fields = line.split()
+        frame = frames[int(fields[1])]
+        frame['primitive'] = fields[3]
+        frame['status'] = int(fields[4])
+        frame['latency'].append(int(fields[5]) / 1000)
+        frame['total'].append(int(fields[6]) / 1000)
+        frame['stack'] = max(frame['stack'], int(fields[7]))
+        frame['allocations'] += int(fields[8])
+    return frames
+
+
+def summarize(frames):
+    """Statistics per label of the per frame medians over the passes, in us"""
+    summary = {}
+    for label in sorted(set(f['label'] for f in frames)) + ['all']:
+        selected = [f for f in frames if label in ('all', f['label'])]
+        latency = [percentile(f['latency'], 0.5) for f in selected]
+        total = [percentile(f['total'], 0.5) for f in selected]
+        histogram = [0] * (len(HISTOGRAM_US) + 1)
+        for f in selected:
+            for value in f['latency']:
+                histogram[sum(1 for limit in HISTOGRAM_US if value >= limit)] += 1
+        statuses = {}
+        for f in selected:
+            status = '%s %s' % (f['primitive'], EVENT_INFO_STATUS.get(f['status'], f['status']))
+            statuses[status] = statuses.get(status, 0) + 1
+        summary[label] = {
+            'frames': len(selected),
+            'latency_p50_us': percentile(latency, 0.5),
+            'latency_p90_us': percentile(latency, 0.9),
+            'latency_p99_us': percentile(latency, 0.99),
+            'latency_max_us': max(latency),
+            'total_p50_us': percentile(total, 0.5),
+            'frames_per_s': len(total) * 1e6 / sum(total),
+            'stack_bytes': max(f['stack'] for f in selected),
+            'allocations': sum(f['allocations'] for f in selected),
+            'histogram': histogram,
+            'results': statuses,
+        }
+    return summary
+
+
+def report(args, summary):
+    print('%d frames, %d passes' % (summary['all']['frames'], args.passes))
+    print('%-18s %6s %8s %8s %8s %8s %8s %9s %7s %6s' %
+          ('label', 'frames', 'p50 us', 'p90 us', 'p99 us', 'max us', 'total us', 'frames/s', 'stack', 'alloc'))
+    for label, s in summary.items():
+        print('%-18s %6d %8.1f %8.1f %8.1f %8.1f %8.1f %9d %7d %6d' %
+              (label, s['frames'], s['latency_p50_us'], s['latency_p90_us'], s['latency_p99_us'], s['latency_max_us'],
+               s['total_p50_us'], s['frames_per_s'], s['stack_bytes'], s['allocations']))
+    print('latency histogram of all the replays, us:')
+    limits = ['<%d' % HISTOGRAM_US[0]] + ['%d-%d' % pair for pair in zip(HISTOGRAM_US, HISTOGRAM_US[1:])] + \
+        ['>=%d' % HISTOGRAM_US[-1]]
+    print('%-18s %s' % ('label', ' '.join('%8s' % limit for limit in limits)))
+    for label, s in summary.items():
+        print('%-18s %s' % (label, ' '.join('%8d' % count for count in s['histogram'])))
+    if args.verbose:
+        print('first MAC primitive and status:')
+        for label, s in summary.items():
+            print('%-18s %s' % (label, ', '.join('%s %d' % item for item in sorted(s['results'].items()))))
+
+
+def compare(args, summary):
+    """Returns the regressions against the baseline summary"""
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    regressions = []
+    for label, s in summary.items():
+        if label not in baseline:
+            continue
+        b = baseline[label]
+        for key in ('latency_p50_us', 'latency_p99_us', 'total_p50_us'):
+            if s[key] > b[key] * (1 + args.max_regression / 100):
+                regressions.append('%s %s %.1f, baseline %.1f' % (label, key, s[key], b[key]))
+        if s['stack_bytes'] > b['stack_bytes'] + args.max_stack_increase:
+            regressions.append('%s stack_bytes %d, baseline %d' % (label, s['stack_bytes'], b['stack_bytes']))
+        if s['allocations'] > b['allocations']:
+            regressions.append('%s allocations %d, baseline %d' % (label, s['allocations'], b['allocations']))
+        if s['results'] != b['results']:
+            regressions.append('%s results %s, baseline %s' % (label, s['results'], b['results']))
+    return regressions
+
+
+if __name__ == '__main__':
+    import argparse
+
+    parser = argparse.ArgumentParser(description='Benchmark the RX path of the firmware LoRaMac on a frame corpus.')
+    parser.add_argument('corpus', nargs='?',
+                        help='corpus file, a representative corpus is generated if not given')
+    parser.add_argument('-n', '--frames', type=int, default=1000,
+                        help='number of frames of the generated corpus (default: %(default)s)')
+    parser.add_argument('--seed', type=int, default=1,
+                        help='seed of the generated corpus (default: %(default)s)')
+    parser.add_argument('--write-corpus',
+                        help='write the generated corpus to this file')
+    parser.add_argument('-p', '--passes', type=int, default=20,
+                        help='replays of the corpus, each on a new LoRaMac instance (default: %(default)s)')
+    parser.add_argument('--json',
+                        help='write the statistics per label to this JSON file')
+    parser.add_argument('--baseline',
+                        help='JSON file of an earlier run, exits with an error on a regression')
+    parser.add_argument('--max-regression', type=float, default=25.0,
+                        help='allowed latency increase over the baseline in percent (default: %(default)s)')
+    parser.add_argument('--max-stack-increase', type=int, default=64,
+                        help='allowed stack increase over the baseline in bytes, stack values may contain the '
+                        'paint pattern (default: %(default)s)')
+    parser.add_argument('-v', '--verbose', action='store_true',
+                        help='print the MAC primitives and statuses per label')
+    args = parser.parse_args()
+
+    if args.corpus:
+        with open(args.corpus) as f:
+            corpus = f.read()
+    else:
+        corpus = generate_corpus(args.frames, args.seed)
+        if args.write_corpus:
+            with open(args.write_corpus, 'w') as f:
+                f.write(corpus)
+    summary = summarize(run(corpus, args.passes))
+    report(args, summary)
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(summary, f, indent=2, sort_keys=True)
+    if args.baseline:
+        regressions = compare(args, summary)
+        for regression in regressions:
+            print('regression: %s' % regression)
+        if regressions:
+            sys.exit(1)
@@ -0,0 +1,704 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file rx_bench.c
+ *
+ * @brief RX path benchmark of rx_bench.py: replays a corpus of received PHY payloads through the
+ *        radio RX done event of the firmware LoRaMac built for the host and measures every frame
+ *
+ * Usage: rx_bench PASSES < corpus
+ *
+ * Corpus on stdin, one entry per line, # starts a comment:
+ *  - SESSION devaddr nwkskey appskey: ABP session of the device, must come first
+ *  - MULTICAST addr mcnwkskey mcappskey freq dr: Class C multicast group
+ *  - RX t window label rssi snr frame: a PHY payload received t ms after the start, window is C
+ *    when it is received in the Class C window or BEACON in a beacon window
+ *
+ * The corpus is replayed PASSES times, each pass on a new LoRaMac instance. Results on stdout:
+ *  - FRAME index pass primitive status latency_ns total_ns stack_bytes allocations
+ *    primitive is the first MAC primitive giving the frame to the application after the radio IRQ:
+ *    MCPS-IND for a data frame, MLME-IND of a locked beacon or MLME-CONF of the beacon acquisition,
+ *    NONE if there is none. status is its LoRaMacEventInfoStatus_t, latency_ns the time from the
+ *    radio IRQ to this primitive and total_ns to the end of LoRaMacProcess()
+ *
+ * Build with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free to count the allocations.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "LoRaMac.h"
+#include "LoRaMacInstance.h"
+#include "LoRaMacTest.h"
+#include "Region.h"
+#include "radio.h"
+#include "stm32_timer.h"
+#include "stm32_systime.h"
+
+#define RX_BENCH_LINE_SIZE 1024
+#define RX_BENCH_LABEL_SIZE 32
+#define RX_BENCH_MAX_FRAME_SIZE 255
+#define RX_BENCH_STACK_PAINT_SIZE 32768
+#define RX_BENCH_STACK_PATTERN 0xA5U
+/* Same as SUBGRF_GetRadioWakeUpTime() + RADIO_WAKEUP_TIME with the GNSE TCXO */
+#define RX_BENCH_RADIO_WAKEUP_MS 8U
+
+typedef enum
+{
+  RX_WINDOW_CLASS_C,
+  RX_WINDOW_BEACON,
+} RxWindow_t;
+
+typedef struct
+{
+  uint32_t Time;
+  RxWindow_t Window;
+  int16_t Rssi;
+  int8_t Snr;
+  uint8_t Size;
+  uint8_t Payload[RX_BENCH_MAX_FRAME_SIZE];
+} RxFrame_t;
+
+typedef enum
+{
+  PRIMITIVE_NONE,
+  PRIMITIVE_MCPS_INDICATION,
+  PRIMITIVE_MLME_INDICATION,
+  PRIMITIVE_MLME_CONFIRM,
+} Primitive_t;
+
+static const char *const PrimitiveNames[] = {"NONE", "MCPS-IND", "MLME-IND", "MLME-CONF"};
+
+/* Virtual time in ms, set from the corpus */
+static uint32_t Now = 0;
+
+/* Low layer of the timer server */
+static uint32_t TimerContext = 0;
+static uint32_t AlarmTime = 0;
+static bool AlarmArmed = false;
+
+/* Low layer of systime */
+static uint32_t SysTimeBackupSeconds = 0;
+static uint32_t SysTimeBackupSubSeconds = 0;
+
+/* Radio state */
+static RadioEvents_t *RadioEvents = NULL;
+static uint32_t Seed = 1;
+
+/* Corpus */
+static uint8_t DevAddr[4];
+static uint8_t NwkSKey[16];
+static uint8_t AppSKey[16];
+static bool SessionSet = false;
+static McChannelParams_t Multicast;
+static uint8_t McNwkSKey[16];
+static uint8_t McAppSKey[16];
+static bool MulticastSet = false;
+static RxFrame_t *Frames = NULL;
+static size_t FrameCount = 0;
+
+/* Measurement of the frame being replayed */
+static LoRaMacInstance_t Instance;
+static bool Measuring = false;
+static struct timespec RxStart;
+static uint64_t Latency = 0;
+static Primitive_t FirstPrimitive = PRIMITIVE_NONE;
+static uint8_t FirstStatus = 0;
+static uint32_t Allocations = 0;
+static volatile uint8_t *StackPainted = NULL;
+static bool BeaconLocked = false;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+void __real_free(void *pointer);
+
+void *__wrap_malloc(size_t size)
+{
+  Allocations += (Measuring == true) ? 1U : 0U;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+  Allocations += (Measuring == true) ? 1U : 0U;
+  return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size)
+{
+  Allocations += (Measuring == true) ? 1U : 0U;
+  return __real_realloc(pointer, size);
+}
+
+void __wrap_free(void *pointer)
+{
+  Allocations += ((Measuring == true) && (pointer != NULL)) ? 1U : 0U;
+  __real_free(pointer);
+}
+
+static UTIL_TIMER_Status_t BenchTimerInit(void)
+{
+  return UTIL_TIMER_OK;
+}
+
+static UTIL_TIMER_Status_t BenchTimerStartEvent(uint32_t timeout)
+{
+  AlarmTime = TimerContext + timeout;
+  AlarmArmed = true;
+  return UTIL_TIMER_OK;
+}
+
+static UTIL_TIMER_Status_t BenchTimerStopEvent(void)
+{
+  AlarmArmed = false;
+  return UTIL_TIMER_OK;
+}
+
+static uint32_t BenchTimerSetContext(void)
+{
+  TimerContext = Now;
+  return TimerContext;
+}
+
+static uint32_t BenchTimerGetContext(void)
+{
+  return TimerContext;
+}
+
+static uint32_t BenchTimerGetElapsedTime(void)
+{
+  return Now - TimerContext;
+}
+
+static uint32_t BenchTimerGetValue(void)
+{
+  return Now;
+}
+
+static uint32_t BenchTimerGetMinimumTimeout(void)
+{
+  return 1;
+}
+
+static uint32_t BenchTimerConvert(uint32_t value)
+{
+  return value;
+}
+
+const UTIL_TIMER_Driver_s UTIL_TimerDriver =
+{
+  BenchTimerInit,
+  BenchTimerInit,
+  BenchTimerStartEvent,
+  BenchTimerStopEvent,
+  BenchTimerSetContext,
+  BenchTimerGetContext,
+  BenchTimerGetElapsedTime,
+  BenchTimerGetValue,
+  BenchTimerGetMinimumTimeout,
+  BenchTimerConvert,
+  BenchTimerConvert,
+};
+
+static void BenchSysTimeWriteSeconds(uint32_t seconds)
+{
+  SysTimeBackupSeconds = seconds;
+}
+
+static uint32_t BenchSysTimeReadSeconds(void)
+{
+  return SysTimeBackupSeconds;
+}
+
+static void BenchSysTimeWriteSubSeconds(uint32_t subSeconds)
+{
+  SysTimeBackupSubSeconds = subSeconds;
+}
+
+static uint32_t BenchSysTimeReadSubSeconds(void)
+{
+  return SysTimeBackupSubSeconds;
+}
+
+static uint32_t BenchSysTimeGetCalendarTime(uint16_t *subSeconds)
+{
+  *subSeconds = (uint16_t)(Now % 1000U);
+  return Now / 1000U;
+}
+
+const UTIL_SYSTIM_Driver_s UTIL_SYSTIMDriver =
+{
+  BenchSysTimeWriteSeconds,
+  BenchSysTimeReadSeconds,
+  BenchSysTimeWriteSubSeconds,
+  BenchSysTimeReadSubSeconds,
+  BenchSysTimeGetCalendarTime,
+};
+
+/* The frames are injected by the benchmark, the radio only keeps the MAC events */
+static void BenchRadioInit(RadioEvents_t *events)
+{
+  RadioEvents = events;
+}
+
+static RadioState_t BenchRadioGetStatus(void)
+{
+  return RF_IDLE;
+}
+
+static void BenchRadioSetChannel(uint32_t freq)
+{
+}
+
+static bool BenchRadioIsChannelFree(uint32_t freq, uint32_t rxBandwidth, int16_t rssiThresh,
+                                    uint32_t maxCarrierSenseTime)
+{
+  return true;
+}
+
+static uint32_t BenchRadioRandom(void)
+{
+  Seed = Seed * 1103515245U + 12345U;
+  return Seed;
+}
+
+static void BenchRadioSetRxConfig(RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                  uint32_t bandwidthAfc, uint16_t preambleLen, uint16_t symbTimeout, bool fixLen,
+                                  uint8_t payloadLen, bool crcOn, bool freqHopOn, uint8_t hopPeriod, bool iqInverted,
+                                  bool rxContinuous)
+{
+}
+
+static void BenchRadioSetTxConfig(RadioModems_t modem, int8_t power, uint32_t fdev, uint32_t bandwidth,
+                                  uint32_t datarate, uint8_t coderate, uint16_t preambleLen, bool fixLen, bool crcOn,
+                                  bool freqHopOn, uint8_t hopPeriod, bool iqInverted, uint32_t timeout)
+{
+}
+
+static bool BenchRadioCheckRfFrequency(uint32_t frequency)
+{
+  return true;
+}
+
+static uint32_t BenchRadioTimeOnAir(RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                    uint16_t preambleLen, bool fixLen, uint8_t payloadLen, bool crcOn)
+{
+  return 0;
+}
+
+static void BenchRadioSend(uint8_t *buffer, uint8_t size)
+{
+}
+
+static void BenchRadioSleep(void)
+{
+}
+
+static void BenchRadioRx(uint32_t timeout)
+{
+}
+
+static void BenchRadioSetTxContinuousWave(uint32_t freq, int8_t power, uint16_t time)
+{
+}
+
+static void BenchRadioSetMaxPayloadLength(RadioModems_t modem, uint8_t max)
+{
+}
+
+static void BenchRadioSetPublicNetwork(bool enable)
+{
+}
+
+static uint32_t BenchRadioGetWakeupTime(void)
+{
+  return RX_BENCH_RADIO_WAKEUP_MS;
+}
+
+const struct Radio_s Radio =
+{
+  .Init = BenchRadioInit,
+  .GetStatus = BenchRadioGetStatus,
+  .SetChannel = BenchRadioSetChannel,
+  .IsChannelFree = BenchRadioIsChannelFree,
+  .Random = BenchRadioRandom,
+  .SetRxConfig = BenchRadioSetRxConfig,
+  .SetTxConfig = BenchRadioSetTxConfig,
+  .CheckRfFrequency = BenchRadioCheckRfFrequency,
+  .TimeOnAir = BenchRadioTimeOnAir,
+  .Send = BenchRadioSend,
+  .Sleep = BenchRadioSleep,
+  .Standby = BenchRadioSleep,
+  .Rx = BenchRadioRx,
+  .SetTxContinuousWave = BenchRadioSetTxContinuousWave,
+  .SetMaxPayloadLength = BenchRadioSetMaxPayloadLength,
+  .SetPublicNetwork = BenchRadioSetPublicNetwork,
+  .GetWakeupTime = BenchRadioGetWakeupTime,
+};
+
+static uint64_t ElapsedNs(const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)(now.tv_sec - start->tv_sec) * 1000000000ULL + (uint64_t)now.tv_nsec - (uint64_t)start->tv_nsec;
+}
+
+static void Primitive(Primitive_t primitive, uint8_t status)
+{
+  if ((Measuring == true) && (FirstPrimitive == PRIMITIVE_NONE))
+  {
+    Latency = ElapsedNs(&RxStart);
+    FirstPrimitive = primitive;
+    FirstStatus = status;
+  }
+}
+
+static void OnMacProcessNotify(void)
+{
+}
+
+static void McpsConfirm(McpsConfirm_t *mcpsConfirm)
+{
+}
+
+static void McpsIndication(McpsIndication_t *mcpsIndication)
+{
+  Primitive(PRIMITIVE_MCPS_INDICATION, mcpsIndication->Status);
+}
+
+static void MlmeConfirm(MlmeConfirm_t *mlmeConfirm)
+{
+  if (mlmeConfirm->MlmeRequest == MLME_BEACON_ACQUISITION)
+  {
+    BeaconLocked = mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK;
+    Primitive(PRIMITIVE_MLME_CONFIRM, mlmeConfirm->Status);
+  }
+}
+
+/* The MAC also gives the pending beacon state indications when it processes a frame, they are not counted */
+static void MlmeIndication(MlmeIndication_t *mlmeIndication)
+{
+  if (mlmeIndication->MlmeIndication == MLME_BEACON_LOST)
+  {
+    BeaconLocked = false;
+  }
+  else if (mlmeIndication->MlmeIndication == MLME_BEACON)
+  {
+    BeaconLocked = mlmeIndication->Status == LORAMAC_EVENT_INFO_STATUS_BEACON_LOCKED;
+    if (BeaconLocked == true)
+    {
+      Primitive(PRIMITIVE_MLME_INDICATION, mlmeIndication->Status);
+    }
+  }
+}
+
+/* Fills the stack below the caller with a pattern, the callee frames of the caller overwrite it */
+static __attribute__((noinline)) void StackPaint(void)
+{
+  volatile uint8_t area[RX_BENCH_STACK_PAINT_SIZE];
+
+  for (size_t i = 0; i < sizeof(area); i++)
+  {
+    area[i] = RX_BENCH_STACK_PATTERN;
+  }
+  StackPainted = area;
+}
+
+/* Bytes of the painted stack used since StackPaint(), from its deepest overwritten byte */
+static __attribute__((noinline)) size_t StackUsed(void)
+{
+  size_t unused = 0;
+
+  while ((unused < RX_BENCH_STACK_PAINT_SIZE) && (StackPainted[unused] == RX_BENCH_STACK_PATTERN))
+  {
+    unused++;
+  }
+  return RX_BENCH_STACK_PAINT_SIZE - unused;
+}
+
+static void RunUntil(uint32_t target)
+{
+  while ((AlarmArmed == true) && (AlarmTime <= target))
+  {
+    if (AlarmTime > Now)
+    {
+      Now = AlarmTime;
+    }
+    AlarmArmed = false;
+    UTIL_TIMER_IRQ_Handler();
+    LoRaMacProcess();
+  }
+  if (target > Now)
+  {
+    Now = target;
+  }
+}
+
+/* The MAC keeps the Class C window open and opens the beacon windows once it tracks the beacons,
+   the beacon acquisition is started for the first beacon and after a beacon loss */
+static void OpenWindow(const RxFrame_t *frame)
+{
+  if ((frame->Window == RX_WINDOW_BEACON) && (BeaconLocked == false))
+  {
+    MlmeReq_t mlmeReq;
+
+    mlmeReq.Type = MLME_BEACON_ACQUISITION;
+    LoRaMacMlmeRequest(&mlmeReq);
+    LoRaMacProcess();
+  }
+}
+
+static void Replay(size_t index, uint32_t pass)
+{
+  RxFrame_t *frame = &Frames[index];
+  uint64_t total;
+  size_t stack;
+
+  RunUntil(frame->Time);
+  OpenWindow(frame);
+
+  FirstPrimitive = PRIMITIVE_NONE;
+  FirstStatus = 0;
+  Latency = 0;
+  Allocations = 0;
+  StackPaint();
+  Measuring = true;
+  clock_gettime(CLOCK_MONOTONIC, &RxStart);
+  /* As the radio IRQ, then the main loop */
+  RadioEvents->RxDone(frame->Payload, frame->Size, frame->Rssi, frame->Snr);
+  LoRaMacProcess();
+  total = ElapsedNs(&RxStart);
+  Measuring = false;
+  stack = StackUsed();
+
+  if (FirstPrimitive == PRIMITIVE_NONE)
+  {
+    Latency = total;
+  }
+  printf("FRAME %zu %u %s %u %llu %llu %zu %u\n", index, pass, PrimitiveNames[FirstPrimitive], FirstStatus,
+         (unsigned long long)Latency, (unsigned long long)total, stack, Allocations);
+}
+
+static void MibSet(MibRequestConfirm_t *mibReq)
+{
+  if (LoRaMacMibSetRequestConfirm(mibReq) != LORAMAC_STATUS_OK)
+  {
+    fprintf(stderr, "MIB %d failed\n", mibReq->Type);
+    exit(1);
+  }
+}
+
+/* A new device with the ABP session and multicast group of the corpus, in Class C */
+static void Setup(void)
+{
+  static LoRaMacPrimitives_t primitives = {McpsConfirm, McpsIndication, MlmeConfirm, MlmeIndication};
+  static LoRaMacCallback_t callbacks = {0};
+  MibRequestConfirm_t mibReq;
+
+  Now = 0;
+  AlarmArmed = false;
+  BeaconLocked = false;
+  memset(&Instance, 0, sizeof(Instance));
+  LoRaMacInstanceSelect(&Instance);
+  callbacks.MacProcessNotify = OnMacProcessNotify;
+  UTIL_TIMER_Init();
+  if (LoRaMacInitialization(&primitives, &callbacks, LORAMAC_REGION_EU868) != LORAMAC_STATUS_OK)
+  {
+    fprintf(stderr, "LoRaMacInitialization failed\n");
+    exit(1);
+  }
+
+  mibReq.Type = MIB_NET_ID;
+  mibReq.Param.NetID = 0;
+  MibSet(&mibReq);
+  mibReq.Type = MIB_DEV_ADDR;
+  mibReq.Param.DevAddr = ((uint32_t)DevAddr[0] << 24) | ((uint32_t)DevAddr[1] << 16) | ((uint32_t)DevAddr[2] << 8) |
+                         DevAddr[3];
+  MibSet(&mibReq);
+  mibReq.Type = MIB_NWK_S_KEY;
+  mibReq.Param.NwkSKey = NwkSKey;
+  MibSet(&mibReq);
+  mibReq.Type = MIB_APP_S_KEY;
+  mibReq.Param.AppSKey = AppSKey;
+  MibSet(&mibReq);
+  mibReq.Type = MIB_NETWORK_ACTIVATION;
+  mibReq.Param.NetworkActivation = ACTIVATION_TYPE_ABP;
+  MibSet(&mibReq);
+  mibReq.Type = MIB_PUBLIC_NETWORK;
+  mibReq.Param.EnablePublicNetwork = true;
+  MibSet(&mibReq);
+  LoRaMacTestSetDutyCycleOn(false);
+  LoRaMacStart();
+
+  if (MulticastSet == true)
+  {
+    if (LoRaMacMcChannelSetup(&Multicast) != LORAMAC_STATUS_OK)
+    {
+      fprintf(stderr, "LoRaMacMcChannelSetup failed\n");
+      exit(1);
+    }
+  }
+  mibReq.Type = MIB_DEVICE_CLASS;
+  mibReq.Param.Class = CLASS_C;
+  MibSet(&mibReq);
+  LoRaMacProcess();
+}
+
+static void Teardown(void)
+{
+  LoRaMacDeInitialization();
+}
+
+static bool ParseHex(const char *hex, uint8_t *buffer, size_t size)
+{
+  if (strlen(hex) != 2 * size)
+  {
+    return false;
+  }
+  for (size_t i = 0; i < size; i++)
+  {
+    unsigned int value;
+
+    if (sscanf(&hex[2 * i], "%2x", &value) != 1)
+    {
+      return false;
+    }
+    buffer[i] = (uint8_t)value;
+  }
+  return true;
+}
+
+static bool ParseLine(char *line)
+{
+  char devAddr[9], nwkSKey[33], appSKey[33], window[8], label[RX_BENCH_LABEL_SIZE], frame[2 * RX_BENCH_MAX_FRAME_SIZE + 1];
+  unsigned int time, frequency;
+  int datarate, rssi, snr;
+
+  if ((line[0] == '#') || (strspn(line, " \t\r\n") == strlen(line)))
+  {
+    return true;
+  }
+  if (sscanf(line, "SESSION %8s %32s %32s", devAddr, nwkSKey, appSKey) == 3)
+  {
+    SessionSet = ParseHex(devAddr, DevAddr, sizeof(DevAddr)) && ParseHex(nwkSKey, NwkSKey, sizeof(NwkSKey)) &&
+                 ParseHex(appSKey, AppSKey, sizeof(AppSKey));
+    return SessionSet;
+  }
+  if (sscanf(line, "MULTICAST %8s %32s %32s %u %d", devAddr, nwkSKey, appSKey, &frequency, &datarate) == 5)
+  {
+    uint8_t address[4];
+
+    if ((ParseHex(devAddr, address, sizeof(address)) == false) ||
+        (ParseHex(nwkSKey, McNwkSKey, sizeof(McNwkSKey)) == false) ||
+        (ParseHex(appSKey, McAppSKey, sizeof(McAppSKey)) == false))
+    {
+      return false;
+    }
+    memset(&Multicast, 0, sizeof(Multicast));
+    Multicast.IsRemotelySetup = false;
+    Multicast.Class = CLASS_C;
+    Multicast.IsEnabled = true;
+    Multicast.GroupID = MULTICAST_0_ADDR;
+    Multicast.Address = ((uint32_t)address[0] << 24) | ((uint32_t)address[1] << 16) | ((uint32_t)address[2] << 8) |
+                        address[3];
+    Multicast.McKeys.Session.McNwkSKey = McNwkSKey;
+    Multicast.McKeys.Session.McAppSKey = McAppSKey;
+    Multicast.FCountMin = 0;
+    Multicast.FCountMax = UINT32_MAX;
+    Multicast.RxParams.ClassC.Frequency = frequency;
+    Multicast.RxParams.ClassC.Datarate = (int8_t)datarate;
+    MulticastSet = true;
+    return true;
+  }
+  if (sscanf(line, "RX %u %7s %31s %d %d %510s", &time, window, label, &rssi, &snr, frame) == 6)
+  {
+    RxFrame_t *frames = realloc(Frames, (FrameCount + 1) * sizeof(RxFrame_t));
+    RxFrame_t *entry;
+
+    if ((frames == NULL) || ((FrameCount > 0) && (time < frames[FrameCount - 1].Time)))
+    {
+      return false;
+    }
+    Frames = frames;
+    entry = &Frames[FrameCount++];
+    entry->Time = time;
+    entry->Rssi = (int16_t)rssi;
+    entry->Snr = (int8_t)snr;
+    entry->Size = (uint8_t)(strlen(frame) / 2);
+    if (strcmp(window, "C") == 0)
+    {
+      entry->Window = RX_WINDOW_CLASS_C;
+    }
+    else if (strcmp(window, "BEACON") == 0)
+    {
+      entry->Window = RX_WINDOW_BEACON;
+    }
+    else
+    {
+      return false;
+    }
+    return ParseHex(frame, entry->Payload, entry->Size);
+  }
+  return false;
+}
+
+int main(int argc, char **argv)
+{
+  static char line[RX_BENCH_LINE_SIZE];
+  uint32_t passes;
+  unsigned int number = 0;
+
+  if (argc != 2)
+  {
+    fprintf(stderr, "usage: %s PASSES < corpus\n", argv[0]);
+    return 1;
+  }
+  passes = strtoul(argv[1], NULL, 0);
+
+  while (fgets(line, sizeof(line), stdin) != NULL)
+  {
+    number++;
+    if (ParseLine(line) == false)
+    {
+      fprintf(stderr, "corpus line %u: invalid entry\n", number);
+      return 1;
+    }
+  }
+  if (SessionSet == false)
+  {
+    fprintf(stderr, "corpus: no SESSION\n");
+    return 1;
+  }
+
+  setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+  for (uint32_t pass = 0; pass < passes; pass++)
+  {
+    Setup();
+    for (size_t i = 0; i < FrameCount; i++)
+    {
+      Replay(i, pass);
+    }
+    Teardown();
+  }
+  free(Frames);
+  return 0;
+}
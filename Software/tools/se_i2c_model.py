@@ -0,0 +1,117 @@
+"""
+Copyright 2021 The Things Industries B.V.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+# Models the I2C transactions of the ATECC608A secure element on the host. The secure element and its HAL
+# (lib/ATECC608A-TNGLORA/atecc608a-tnglora-se.c and atecc608a-tnglora-se-hal.c) are built with the profiler of the HAL
+# and stand-ins of cryptoauthlib against a simulated device (see se_i2c_model/se_i2c_model.c), once with the sessions
+# and once without. The secure element calls of a join, of a join accept with the session keys derived in one call or
+# one call per key, and of uplinks and downlinks are replayed in virtual time. The report gives per frame the commands,
+# the wake sequences, the time the device is awake and the total time, which bounds the crypto part of the uplink
+# latency and the energy of the secure element.
+
+import glob
+import hashlib
+import os
+import subprocess
+import sys
+import tempfile
+
+from fleet_sim import LORAWAN_DIR, NODE_INCLUDES, SOFTWARE_DIR, TOOLS_DIR
+
+MODEL_DIR = os.path.join(TOOLS_DIR, 'se_i2c_model')
+SE_DIR = os.path.join(SOFTWARE_DIR, 'lib', 'ATECC608A-TNGLORA')
+SOURCES = [os.path.join(MODEL_DIR, 'se_i2c_model.c'), os.path.join(SE_DIR, 'atecc608a-tnglora-se.c'),
+           os.path.join(SE_DIR, 'atecc608a-tnglora-se-hal.c'), os.path.join(LORAWAN_DIR, 'Utilities', 'utilities.c')]
+# The stand-ins of cryptoauthlib and the se-identity.h of the ATECC608A before the LoRaWAN headers
+INCLUDES = [MODEL_DIR, SE_DIR] + NODE_INCLUDES
+DEFAULT_FRAMES = ['join', 'join-accept', 'join-accept:per-key', 'up:3', 'up:11', 'up:51', 'up:222', 'down:0',
+                  'down:11']
+OPCODES = {0x02: 'Read', 0x51: 'AES', 0x56: 'KDF'}
+
+
+def build_model(session):
+    """Builds the model with or without the sessions once per version of the sources, returns the executable"""
+    flags = ['-DATCA_HAL_ATECC608A_PROFILE_ENABLE=1', '-DATCA_HAL_ATECC608A_SESSION_ENABLE=%d' % session]
+    compiler = os.environ.get('CC', 'cc')
+    digest = hashlib.sha1(compiler.encode() + ''.join(flags).encode())
+    for path in sorted(SOURCES + sum((glob.glob(os.path.join(d, '*.h')) for d in INCLUDES), [])):
+        with open(path, 'rb') as f:
+            digest.update(f.read())
+    binary = os.path.join(tempfile.gettempdir(), 'se_i2c_model-%s' % digest.hexdigest()[:12])
+    if not os.path.exists(binary):
+        command = [compiler, '-O2', '-std=gnu11', '-w'] + ['-I' + d for d in INCLUDES] + flags + SOURCES + \
+            ['-o', binary + '.tmp']
+        if subprocess.call(command) != 0:
+            sys.exit('Failed to build %s' % SOURCES[0])
+        os.replace(binary + '.tmp', binary)
+    return binary
+
+
+def run(binary, aes_us, kdf_us, frames):
+    """Returns the FRAME results of the model with the COMMAND results of every frame"""
+    try:
+        output = subprocess.check_output([binary, str(aes_us), str(kdf_us)] + frames, universal_newlines=True)
+    except subprocess.CalledProcessError:
+        sys.exit('The model failed')
+    results = []
+    for line in output.splitlines():
+        fields = line.split()
+        if fields[0] == 'FRAME':
+            total, commands, wakes, skipped, idles, wake, awake, failures = map(int, fields[2:])
+            results.append({'frame': fields[1], 'total_us': total, 'commands': commands, 'wakes': wakes,
+                            'skipped_wakes': skipped, 'idles': idles, 'wake_us': wake, 'awake_us': awake,
+                            'failures': failures, 'opcodes': {}})
+        elif fields[0] == 'COMMAND':
+            count, tx, rx, time = map(int, fields[2:])
+            results[-1]['opcodes'][int(fields[1], 16)] = {'count': count, 'tx_bytes': tx, 'rx_bytes': rx,
+                                                          'time_us': time}
+    return results
+
+
+def report(without, with_sessions, verbose):
+    print('%-19s %8s %6s %13s %11s %15s %15s %7s' % ('frame', 'commands', 'bytes', 'wakes', 'wake ms',
+                                                   'awake ms', 'total ms', 'saved'))
+    for old, new in zip(without, with_sessions):
+        size = sum(op['tx_bytes'] + op['rx_bytes'] for op in new['opcodes'].values())
+        print('%-19s %8d %6d %6d -> %3d %4.1f -> %4.1f %6.1f -> %6.1f %6.1f -> %6.1f %6.1f%%' % (
+            new['frame'], new['commands'], size, old['wakes'], new['wakes'], old['wake_us'] / 1000.0,
+            new['wake_us'] / 1000.0, old['awake_us'] / 1000.0, new['awake_us'] / 1000.0, old['total_us'] / 1000.0,
+            new['total_us'] / 1000.0, 100.0 * (old['total_us'] - new['total_us']) / old['total_us']))
+        if verbose:
+            for opcode, op in sorted(new['opcodes'].items()):
+                print('  %-6s %4d commands %6d bytes sent %6d received %8.1f ms' % (
+                    OPCODES.get(opcode, '0x%02X' % opcode), op['count'], op['tx_bytes'], op['rx_bytes'],
+                    op['time_us'] / 1000.0))
+
+
+if __name__ == '__main__':
+    import argparse
+
+    parser = argparse.ArgumentParser(description='Model the I2C transactions of the ATECC608A secure element.')
+    parser.add_argument('frames', nargs='*', default=DEFAULT_FRAMES,
+                        help='frames: join, join-accept, join-accept:per-key, up:N or down:N with N the FRMPayload '
+                        'size (default: %s)' % ' '.join(DEFAULT_FRAMES))
+    parser.add_argument('--aes-us', type=int, default=1000,
+                        help='execution time of the AES command in us (default: %(default)s)')
+    parser.add_argument('--kdf-us', type=int, default=2000,
+                        help='execution time of the KDF command in us (default: %(default)s)')
+    parser.add_argument('-v', '--verbose', action='store_true',
+                        help='print the commands per opcode')
+    args = parser.parse_args()
+
+    without = run(build_model(0), args.aes_us, args.kdf_us, args.frames)
+    with_sessions = run(build_model(1), args.aes_us, args.kdf_us, args.frames)
+    report(without, with_sessions, args.verbose)
+    failures = sum(result['failures'] for result in without + with_sessions)
+    if failures:
+        sys.exit('%d commands failed' % failures)
@@ -0,0 +1,32 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file GNSE_bsp.h
+ *
+ * @brief Sensor I2C bus of the host build used by se_i2c_model.py
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#ifndef GNSE_BSP_H
+#define GNSE_BSP_H
+
+#include "stm32wlxx_hal_i2c.h"
+
+extern I2C_HandleTypeDef GNSE_BSP_sensor_i2c1;
+
+#endif /* GNSE_BSP_H */
@@ -0,0 +1,30 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file atca_devtypes.h
+ *
+ * @brief Stands in for the cryptoauthlib header in the host build used by se_i2c_model.py
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#ifndef ATCA_DEVTYPES_H
+#define ATCA_DEVTYPES_H
+
+#include "cryptoauthlib.h"
+
+#endif /* ATCA_DEVTYPES_H */
@@ -0,0 +1,36 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file atca_hal.h
+ *
+ * @brief I2C HAL functions of cryptoauthlib in the host build used by se_i2c_model.py
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#ifndef ATCA_HAL_H
+#define ATCA_HAL_H
+
+#include "cryptoauthlib.h"
+
+ATCA_STATUS hal_i2c_send(ATCAIface iface, uint8_t word_address, uint8_t *txdata, int txlength);
+ATCA_STATUS hal_i2c_receive(ATCAIface iface, uint8_t word_address, uint8_t *rxdata, uint16_t *rxlength);
+ATCA_STATUS hal_i2c_wake(ATCAIface iface);
+ATCA_STATUS hal_i2c_idle(ATCAIface iface);
+ATCA_STATUS hal_i2c_sleep(ATCAIface iface);
+
+#endif /* ATCA_HAL_H */
@@ -0,0 +1,102 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cryptoauthlib.h
+ *
+ * @brief Stands in for the cryptoauthlib types used by the ATECC608A HAL and secure element in the host build used by
+ *        se_i2c_model.py
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#ifndef CRYPTOAUTHLIB_H
+#define CRYPTOAUTHLIB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "atca_config.h"
+
+typedef int ATCA_STATUS;
+
+#define ATCA_SUCCESS               0x00
+#define ATCA_BAD_PARAM             0xE2
+#define ATCA_STATUS_SELFTEST_ERROR 0x07
+#define ATCA_WAKE_FAILED           0xD0
+#define ATCA_RX_TIMEOUT            0xE7
+#define ATCA_SMALL_BUFFER          0xED
+#define ATCA_TX_FAIL               0xF7
+#define ATCA_GEN_FAIL              0xE1
+
+#define RANDOM_NUM_SIZE 32
+#define ATCA_BLOCK_SIZE 32
+#define ATCA_ZONE_DATA  0x02
+
+#define KDF_MODE_ALG_AES     0x20
+#define KDF_MODE_SOURCE_SLOT 0x02
+#define KDF_MODE_TARGET_SLOT 0x08
+
+typedef enum
+{
+  ATCA_I2C_IFACE,
+} ATCAIfaceType;
+
+typedef enum
+{
+  ATECC608A = 3,
+} ATCADeviceType;
+
+typedef struct
+{
+  ATCAIfaceType iface_type;
+  ATCADeviceType devtype;
+  struct
+  {
+    uint8_t slave_address;
+    uint8_t bus;
+    uint32_t baud;
+  } atcai2c;
+  int rx_retries;
+  uint32_t wake_delay;
+} ATCAIfaceCfg;
+
+/* CMAC context of atcab_aes_cmac_init(), the block not encrypted yet and the CBC state */
+typedef struct
+{
+  uint16_t key_id;
+  uint8_t key_block;
+  uint32_t block_size;
+  uint8_t block[16];
+  uint8_t ciphertext[16];
+} atca_aes_cmac_ctx_t;
+
+typedef struct atca_iface
+{
+  ATCAIfaceCfg *mIfaceCFG;
+} *ATCAIface;
+
+ATCA_STATUS atcab_random(uint8_t *rand_out);
+ATCA_STATUS atcab_init(ATCAIfaceCfg *cfg);
+ATCA_STATUS atcab_read_zone(uint8_t zone, uint16_t slot, uint8_t block, uint8_t offset, uint8_t *data, uint8_t len);
+ATCA_STATUS atcab_aes_encrypt(uint16_t key_id, uint8_t key_block, const uint8_t *plaintext, uint8_t *ciphertext);
+ATCA_STATUS atcab_aes_cmac_init(atca_aes_cmac_ctx_t *ctx, uint16_t key_id, uint8_t key_block);
+ATCA_STATUS atcab_aes_cmac_update(atca_aes_cmac_ctx_t *ctx, const uint8_t *data, uint32_t data_size);
+ATCA_STATUS atcab_aes_cmac_finish(atca_aes_cmac_ctx_t *ctx, uint8_t *cmac, uint32_t cmac_size);
+ATCA_STATUS atcab_kdf(uint8_t mode, uint16_t key_id, const uint32_t details, const uint8_t *message, uint8_t *out_data,
+                      uint8_t *out_nonce);
+
+#endif /* CRYPTOAUTHLIB_H */
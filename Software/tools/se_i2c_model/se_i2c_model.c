@@ -0,0 +1,486 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file se_i2c_model.c
+ *
+ * @brief ATECC608A I2C model of se_i2c_model.py: the ATECC608A secure element (atecc608a-tnglora-se.c) and its HAL
+ *        (atecc608a-tnglora-se-hal.c) built for the host against a simulated device, in virtual time
+ *
+ * Usage: se_i2c_model AES_US KDF_US FRAME...
+ *
+ * AES_US and KDF_US are the execution times of the AES and KDF commands in us. A FRAME is the
+ * sequence of secure element operations of the LoRaWAN stack for one frame:
+ *  - join: join request MIC, then join accept decryption, MIC and session key derivation
+ *  - join-accept: the join accept alone, the session keys derived in one SecureElementDeriveAndStoreKeys() call
+ *  - join-accept:per-key: the join accept with one SecureElementDeriveAndStoreKey() call per session key, as
+ *    before SecureElementDeriveAndStoreKeys()
+ *  - up:N: uplink with a FRMPayload of N bytes, encryption then MIC
+ *  - down:N: downlink with a FRMPayload of N bytes, MIC then decryption
+ * The frames call the SecureElement functions of atecc608a-tnglora-se.c the way LoRaMacCrypto.c does, in the
+ * sessions of LoRaMac.c, and the cryptoauthlib functions it uses send the commands of the ones of cryptoauthlib.
+ * Every command goes through the wake, send, poll and idle sequence of calib_execute_command(). The calls of
+ * LoRaMacCrypto.c are written here and must follow its changes, the secure element ones come from the sources.
+ *
+ * Results on stdout, for every frame:
+ *  - FRAME name total_us commands wakes session_wakes idles wake_us awake_us failures
+ *  - COMMAND opcode count tx_bytes rx_bytes time_us, for every opcode of the frame
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "atca_hal.h"
+#include "GNSE_bsp.h"
+#include "atecc608a-tnglora-se-hal.h"
+#include "secure-element.h"
+
+/* 9 bits per byte at ATCA_HAL_ATECC608A_I2C_FREQUENCY */
+#define MODEL_I2C_BYTE_US (9U * 1000000U / ATCA_HAL_ATECC608A_I2C_FREQUENCY)
+/* tWHI, wake high delay to data communication */
+#define MODEL_WAKE_US 1500U
+/* Watchdog of the device, it goes to sleep this long after the wake up */
+#define MODEL_WATCHDOG_US 1300000U
+/* ATCA_POLLING_INIT_TIME_MSEC and ATCA_POLLING_FREQUENCY_TIME_MSEC of cryptoauthlib */
+#define MODEL_POLLING_INIT_MS 1U
+#define MODEL_POLLING_FREQUENCY_MS 2U
+#define MODEL_POLLING_MAX_MS 200U
+/* Time between two frames */
+#define MODEL_FRAME_INTERVAL_US 10000000U
+
+#define MODEL_OPCODE_READ 0x02U
+#define MODEL_OPCODE_AES 0x51U
+#define MODEL_OPCODE_KDF 0x56U
+/* tEXEC of the Read command */
+#define MODEL_READ_US 1000U
+/* Command packet without data: word address, count, opcode, param1, param2 (2 bytes) and CRC (2 bytes) */
+#define MODEL_COMMAND_SIZE 7U
+
+typedef enum
+{
+  DEVICE_SLEEP,
+  DEVICE_IDLE,
+  DEVICE_AWAKE,
+} DeviceState_t;
+
+DWT_Type ModelDwt;
+CoreDebug_Type ModelCoreDebug;
+uint32_t SystemCoreClock = 48000000U;
+I2C_HandleTypeDef GNSE_BSP_sensor_i2c1;
+
+/* Virtual time in us */
+static uint64_t Now = 0;
+
+/* Simulated device */
+static DeviceState_t State = DEVICE_SLEEP;
+static uint64_t WakeTime = 0;
+static uint64_t BusyUntil = 0;
+static bool WakeResponse = false;
+static uint8_t ResponseSize = 0;
+static uint32_t ExecutionUs[256];
+
+static ATCAIfaceCfg Cfg = {
+  .atcai2c = {.slave_address = ATCA_HAL_ATECC608A_I2C_ADDRESS},
+  .rx_retries = ATCA_HAL_ATECC608A_I2C_RX_RETRIES,
+  .wake_delay = ATCA_HAL_ATECC608A_I2C_WAKEUP_DELAY,
+};
+static struct atca_iface Iface = {.mIfaceCFG = &Cfg};
+static uint32_t Failures = 0;
+
+static void Advance(uint64_t us)
+{
+  Now += us;
+  ModelDwt.CYCCNT = (uint32_t)(Now * (SystemCoreClock / 1000000U));
+  if ((State == DEVICE_AWAKE) && ((Now - WakeTime) >= MODEL_WATCHDOG_US))
+  {
+    State = DEVICE_SLEEP;
+  }
+}
+
+uint32_t HAL_GetTick(void)
+{
+  return (uint32_t)(Now / 1000U);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+  /* HAL_Delay() of the STM32 HAL waits one more tick */
+  Advance(((uint64_t)Delay + 1U) * 1000U);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+  Advance(((uint64_t)Size + 1U) * MODEL_I2C_BYTE_US);
+  if (DevAddress == 0x00)
+  {
+    /* Wake pulse, the address is not acknowledged */
+    if (State != DEVICE_AWAKE)
+    {
+      State = DEVICE_AWAKE;
+      WakeTime = Now + MODEL_WAKE_US;
+      WakeResponse = true;
+    }
+    return HAL_ERROR;
+  }
+  if ((State != DEVICE_AWAKE) || (Now < WakeTime) || (Now < BusyUntil))
+  {
+    return HAL_ERROR;
+  }
+  switch (pData[0])
+  {
+  case 0x01:
+    State = DEVICE_SLEEP;
+    break;
+  case 0x02:
+    State = DEVICE_IDLE;
+    break;
+  case 0x03:
+    /* Count, status, 16 bytes of data or a 32 bytes block, and CRC */
+    ResponseSize = (pData[2] == MODEL_OPCODE_READ) ? 35U :
+                   ((pData[2] == MODEL_OPCODE_AES) || (pData[2] == MODEL_OPCODE_KDF)) ? 19U : 4U;
+    BusyUntil = Now + ExecutionUs[pData[2]];
+    WakeResponse = false;
+    break;
+  default:
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+  static const uint8_t wakeResponse[4] = {0x04, 0x11, 0x33, 0x43};
+
+  Advance(((uint64_t)Size + 1U) * MODEL_I2C_BYTE_US);
+  if ((State != DEVICE_AWAKE) || (Now < WakeTime) || (Now < BusyUntil))
+  {
+    return HAL_ERROR;
+  }
+  if (WakeResponse == true)
+  {
+    memcpy(pData, wakeResponse, (Size < 4U) ? Size : 4U);
+  }
+  else if (Size == 1U)
+  {
+    pData[0] = ResponseSize;
+  }
+  else
+  {
+    memset(pData, 0, Size);
+  }
+  return HAL_OK;
+}
+
+ATCA_STATUS atcab_random(uint8_t *rand_out)
+{
+  memset(rand_out, 0, RANDOM_NUM_SIZE);
+  return ATCA_SUCCESS;
+}
+
+/* calib_execute_command() of cryptoauthlib with polling */
+static ATCA_STATUS ExecuteCommand(uint8_t opcode, uint8_t dataSize)
+{
+  uint8_t packet[MODEL_COMMAND_SIZE + 64] = {0};
+  uint8_t response[64];
+  uint16_t responseSize = sizeof(response);
+  uint32_t waited = MODEL_POLLING_INIT_MS;
+  ATCA_STATUS status = ATCA_SUCCESS;
+
+  packet[1] = MODEL_COMMAND_SIZE + dataSize - 1U;
+  packet[2] = opcode;
+  if (hal_i2c_wake(&Iface) != ATCA_SUCCESS)
+  {
+    Failures++;
+    return ATCA_WAKE_FAILED;
+  }
+  if (hal_i2c_send(&Iface, 0x03, packet, MODEL_COMMAND_SIZE - 1U + dataSize) != ATCA_SUCCESS)
+  {
+    Failures++;
+    status = ATCA_TX_FAIL;
+  }
+  HAL_Delay(MODEL_POLLING_INIT_MS);
+  while (hal_i2c_receive(&Iface, 0x00, response, &responseSize) != ATCA_SUCCESS)
+  {
+    if (waited >= MODEL_POLLING_MAX_MS)
+    {
+      Failures++;
+      status = ATCA_RX_TIMEOUT;
+      break;
+    }
+    HAL_Delay(MODEL_POLLING_FREQUENCY_MS);
+    waited += MODEL_POLLING_FREQUENCY_MS;
+    responseSize = sizeof(response);
+  }
+  hal_i2c_idle(&Iface);
+  return status;
+}
+
+/*
+ * cryptoauthlib functions used by atecc608a-tnglora-se.c, with the commands of calib_*() of cryptoauthlib. The
+ * simulated device answers zeros: the data read are ASCII zeros, the ciphertexts and CMACs are zeros, the MIC of a
+ * zero join accept or downlink then matches.
+ */
+
+ATCA_STATUS atcab_init(ATCAIfaceCfg *cfg)
+{
+  /* The device is woken up by the first command */
+  return ATCA_SUCCESS;
+}
+
+ATCA_STATUS atcab_read_zone(uint8_t zone, uint16_t slot, uint8_t block, uint8_t offset, uint8_t *data, uint8_t len)
+{
+  memset(data, '0', len);
+  return ExecuteCommand(MODEL_OPCODE_READ, 0U);
+}
+
+ATCA_STATUS atcab_aes_encrypt(uint16_t key_id, uint8_t key_block, const uint8_t *plaintext, uint8_t *ciphertext)
+{
+  memset(ciphertext, 0, 16);
+  return ExecuteCommand(MODEL_OPCODE_AES, 16U);
+}
+
+/* calib_aes_cmac_init() keeps the key, no command */
+ATCA_STATUS atcab_aes_cmac_init(atca_aes_cmac_ctx_t *ctx, uint16_t key_id, uint8_t key_block)
+{
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->key_id = key_id;
+  ctx->key_block = key_block;
+  return ATCA_SUCCESS;
+}
+
+/* calib_aes_cmac_update() encrypts every full block but the last one, which waits for the subkey of the finish */
+ATCA_STATUS atcab_aes_cmac_update(atca_aes_cmac_ctx_t *ctx, const uint8_t *data, uint32_t data_size)
+{
+  ATCA_STATUS status = ATCA_SUCCESS;
+
+  while ((data_size != 0U) && (status == ATCA_SUCCESS))
+  {
+    uint32_t copy = 16U - ctx->block_size;
+
+    if (ctx->block_size == 16U)
+    {
+      status = atcab_aes_encrypt(ctx->key_id, ctx->key_block, ctx->block, ctx->ciphertext);
+      ctx->block_size = 0;
+      continue;
+    }
+    copy = (copy < data_size) ? copy : data_size;
+    memcpy(&ctx->block[ctx->block_size], data, copy);
+    ctx->block_size += copy;
+    data += copy;
+    data_size -= copy;
+  }
+  return status;
+}
+
+/* calib_aes_cmac_finish(): one AES command for the subkey and one for the last block */
+ATCA_STATUS atcab_aes_cmac_finish(atca_aes_cmac_ctx_t *ctx, uint8_t *cmac, uint32_t cmac_size)
+{
+  uint8_t subkey[16] = {0};
+  ATCA_STATUS status = atcab_aes_encrypt(ctx->key_id, ctx->key_block, subkey, subkey);
+
+  if (status == ATCA_SUCCESS)
+  {
+    status = atcab_aes_encrypt(ctx->key_id, ctx->key_block, ctx->block, ctx->ciphertext);
+  }
+  memcpy(cmac, ctx->ciphertext, cmac_size);
+  return status;
+}
+
+ATCA_STATUS atcab_kdf(uint8_t mode, uint16_t key_id, const uint32_t details, const uint8_t *message, uint8_t *out_data,
+                      uint8_t *out_nonce)
+{
+  return ExecuteCommand(MODEL_OPCODE_KDF, 16U);
+}
+
+/* Message and output buffers of the frames, a FRMPayload of up to 242 bytes with the B0 block and the headers */
+static uint8_t Message[256 + 32];
+static uint8_t Output[256 + 32];
+/* LrWanVersion of LoRaMacCrypto.c for LoRaWAN 1.0.4 */
+static const Version_t Version = {.Fields = {.Major = 1, .Minor = 0, .Patch = 4}};
+
+/* PayloadEncrypt() of LoRaMacCrypto.c: one SecureElementAesEncrypt() call per block of the FRMPayload */
+static bool PayloadEncrypt(uint16_t size, KeyIdentifier_t keyID)
+{
+  for (uint16_t block = 0; block < size; block += 16U)
+  {
+    if (SecureElementAesEncrypt(Message, 16U, keyID, Output) != SECURE_ELEMENT_SUCCESS)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* LoRaMacCryptoPrepareJoinRequest in the session of LoRaMac.c: MIC of MHDR, JoinEUI, DevEUI and DevNonce */
+static bool JoinRequest(void)
+{
+  uint32_t mic = 0;
+  SecureElementStatus_t status;
+
+  SecureElementBeginSession();
+  status = SecureElementComputeAesCmac(NULL, Message, LORAMAC_JOIN_REQ_MSG_SIZE - LORAMAC_MIC_FIELD_SIZE, NWK_KEY,
+                                       &mic);
+  SecureElementEndSession();
+  return status == SECURE_ELEMENT_SUCCESS;
+}
+
+/* LoRaMacCryptoHandleJoinAccept in the session of LoRaMac.c: decryption and MIC of a join accept without CFList,
+ * then derivation of the McRootKey, McKEKey, NwkSKey and AppSKey. The McRootKey and McKEKey derivations send no
+ * command, their root keys are not in the device. */
+static bool JoinAccept(bool perKey)
+{
+  SecureElementDerivation_t sessionKeys[2] = {{.TargetKeyID = APP_S_KEY}, {.TargetKeyID = NWK_S_KEY}};
+  uint8_t versionMinor = 0;
+  bool success = true;
+
+  SecureElementBeginSession();
+  success &= SecureElementProcessJoinAccept(JOIN_REQ, SecureElementGetJoinEui(), 0, Message,
+                                            LORAMAC_JOIN_ACCEPT_FRAME_MAX_SIZE - LORAMAC_CF_LIST_FIELD_SIZE, Output,
+                                            &versionMinor) == SECURE_ELEMENT_SUCCESS;
+  success &= SecureElementDeriveAndStoreKey(Version, Message, APP_KEY, MC_ROOT_KEY) == SECURE_ELEMENT_SUCCESS;
+  success &= SecureElementDeriveAndStoreKey(Version, Message, MC_ROOT_KEY, MC_KE_KEY) == SECURE_ELEMENT_SUCCESS;
+  if (perKey == true)
+  {
+    success &= SecureElementDeriveAndStoreKey(Version, sessionKeys[0].Input, NWK_KEY, APP_S_KEY) ==
+               SECURE_ELEMENT_SUCCESS;
+    success &= SecureElementDeriveAndStoreKey(Version, sessionKeys[1].Input, NWK_KEY, NWK_S_KEY) ==
+               SECURE_ELEMENT_SUCCESS;
+  }
+  else
+  {
+    success &= SecureElementDeriveAndStoreKeys(Version, NWK_KEY, sessionKeys, 2U) == SECURE_ELEMENT_SUCCESS;
+  }
+  SecureElementEndSession();
+  return success;
+}
+
+/* LoRaMacCryptoSecureMessage in the session of LoRaMac.c: FRMPayload encryption, then MIC of B0, MHDR, FHDR, FPort
+ * and FRMPayload */
+static bool Uplink(uint16_t size)
+{
+  uint32_t mic = 0;
+  bool success;
+
+  SecureElementBeginSession();
+  success = PayloadEncrypt(size, APP_S_KEY);
+  success &= SecureElementComputeAesCmac(Message, Message, 9U + size, NWK_S_KEY, &mic) == SECURE_ELEMENT_SUCCESS;
+  SecureElementEndSession();
+  return success;
+}
+
+/* LoRaMacCryptoUnsecureMessage in the session of LoRaMac.c: MIC, then FRMPayload decryption */
+static bool Downlink(uint16_t size)
+{
+  bool success;
+
+  SecureElementBeginSession();
+  success = SecureElementVerifyAesCmac(Message, 16U + 9U + size, 0, NWK_S_KEY) == SECURE_ELEMENT_SUCCESS;
+  success &= PayloadEncrypt(size, APP_S_KEY);
+  SecureElementEndSession();
+  return success;
+}
+
+/* Secure element operations of LoRaMac.c for one frame, with the sizes of a LoRaWAN 1.0.x frame */
+static bool RunFrame(const char *frame)
+{
+  unsigned int size = 0;
+  bool success;
+
+  if (strcmp(frame, "join") == 0)
+  {
+    success = JoinRequest();
+    success &= JoinAccept(false);
+  }
+  else if (strcmp(frame, "join-accept") == 0)
+  {
+    success = JoinAccept(false);
+  }
+  else if (strcmp(frame, "join-accept:per-key") == 0)
+  {
+    success = JoinAccept(true);
+  }
+  else if ((sscanf(frame, "up:%u", &size) == 1) && (size <= 242U))
+  {
+    success = Uplink((uint16_t)size);
+  }
+  else if ((sscanf(frame, "down:%u", &size) == 1) && (size <= 242U))
+  {
+    success = Downlink((uint16_t)size);
+  }
+  else
+  {
+    fprintf(stderr, "Unknown frame %s\n", frame);
+    return false;
+  }
+  if (success == false)
+  {
+    fprintf(stderr, "Secure element error in frame %s\n", frame);
+  }
+  return success;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 4)
+  {
+    fprintf(stderr, "Usage: %s AES_US KDF_US FRAME...\n", argv[0]);
+    return 1;
+  }
+  ExecutionUs[MODEL_OPCODE_AES] = (uint32_t)strtoul(argv[1], NULL, 0);
+  ExecutionUs[MODEL_OPCODE_KDF] = (uint32_t)strtoul(argv[2], NULL, 0);
+  ExecutionUs[MODEL_OPCODE_READ] = MODEL_READ_US;
+  /* Reads the DevEUI and JoinEUI, before the first frame */
+  if (SecureElementInit(NULL) != SECURE_ELEMENT_SUCCESS)
+  {
+    fprintf(stderr, "Secure element initialization failed\n");
+    return 1;
+  }
+  Advance(MODEL_FRAME_INTERVAL_US);
+
+  for (int i = 3; i < argc; i++)
+  {
+    uint64_t start = Now;
+    uint32_t failures = Failures;
+    uint32_t commands = 0;
+
+    ATECC608ASeHalResetProfile();
+    if (RunFrame(argv[i]) == false)
+    {
+      return 1;
+    }
+    const ATECC608ASeHalProfile_t *profile = ATECC608ASeHalGetProfile();
+    for (int j = 0; j <= ATECC608A_SE_HAL_PROFILE_COMMANDS; j++)
+    {
+      commands += profile->Commands[j].Count;
+    }
+    printf("FRAME %s %llu %u %u %u %u %u %u %u\n", argv[i], (unsigned long long)(Now - start), commands,
+           profile->Wakes, profile->SessionWakes, profile->Idles, profile->WakeTimeUs, profile->AwakeTimeUs,
+           Failures - failures);
+    for (int j = 0; j <= ATECC608A_SE_HAL_PROFILE_COMMANDS; j++)
+    {
+      const ATECC608ASeHalCommandProfile_t *command = &profile->Commands[j];
+      if (command->Count != 0)
+      {
+        printf("COMMAND 0x%02X %u %u %u %u\n", command->Opcode, command->Count, command->TxBytes,
+               command->RxBytes, command->TimeUs);
+      }
+    }
+    Advance(MODEL_FRAME_INTERVAL_US);
+  }
+  return 0;
+}
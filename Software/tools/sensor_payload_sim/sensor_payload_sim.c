@@ -0,0 +1,87 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file sensor_payload_sim.c
+ *
+ * @brief Encoder run of sensor_payload_tool.py: adds samples to SENSOR_PAYLOAD blocks built for the host
+ *
+ * Usage: sensor_payload_sim MAX_SIZE < SAMPLES
+ *
+ * SAMPLES has one "time battery temperature humidity" sample per line. A block is closed when the next sample does
+ * not fit MAX_SIZE bytes or SENSOR_PAYLOAD_MAX_SAMPLES samples, and at the end. Results on stdout:
+ *  - BLOCK hex: encoded block
+ *  - SKIP time: sample which does not fit an empty block
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "SENSOR_PAYLOAD.h"
+
+static SENSOR_PAYLOAD_Block_t Block;
+
+static void PrintBlock(void)
+{
+  if (Block.Count == 0U)
+  {
+    return;
+  }
+  printf("BLOCK ");
+  for (uint8_t i = 0; i < Block.Size; i++)
+  {
+    printf("%02x", Block.Buffer[i]);
+  }
+  printf("\n");
+  SENSOR_PAYLOAD_Reset(&Block);
+}
+
+int main(int argc, char **argv)
+{
+  SENSOR_PAYLOAD_Sample_t sample;
+  unsigned long time;
+  unsigned battery;
+  int temperature;
+  unsigned humidity;
+  uint8_t max_size;
+
+  if (argc != 2)
+  {
+    fprintf(stderr, "Usage: %s MAX_SIZE < SAMPLES\n", argv[0]);
+    return 2;
+  }
+  max_size = (uint8_t)atoi(argv[1]);
+
+  SENSOR_PAYLOAD_Reset(&Block);
+  while (scanf("%lu %u %d %u", &time, &battery, &temperature, &humidity) == 4)
+  {
+    sample.Time = (uint32_t)time;
+    sample.Battery = (uint8_t)battery;
+    sample.Temperature = (int16_t)temperature;
+    sample.Humidity = (uint16_t)humidity;
+    if (SENSOR_PAYLOAD_Add(&Block, &sample, max_size) == SENSOR_PAYLOAD_OP_FULL)
+    {
+      PrintBlock();
+      if (SENSOR_PAYLOAD_Add(&Block, &sample, max_size) != SENSOR_PAYLOAD_OP_SUCCESS)
+      {
+        printf("SKIP %lu\n", time);
+      }
+    }
+  }
+  PrintBlock();
+  return 0;
+}
@@ -0,0 +1,348 @@
+"""
+Copyright 2021 The Things Industries B.V.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+# Decodes aggregated sensor payloads and estimates their air-time and energy per sample,
+# see lib/SENSOR_PAYLOAD/SENSOR_PAYLOAD.h for the format. The check command compares the encoder of this script
+# with SENSOR_PAYLOAD.c built for the host with sensor_payload_sim/sensor_payload_sim.c, on random sample traces.
+
+import glob
+import hashlib
+import math
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+from uplink_sched_sim import EU868_MAX_PAYLOAD, EU868_SF, EU868_BW, SOFTWARE_DIR, TOOLS_DIR, time_on_air
+
+FORMAT = 1
+IRREGULAR = 0x20
+ESCAPE = 0x88
+MAX_SAMPLES = 32
+
+# Must match app/sensors_lorawan/conf/app_conf.h and lib/UPLINK_SCHED/UPLINK_SCHED.h
+SENSORS_AGGREGATE_SAMPLES = 10
+SENSORS_AGGREGATE_DEADLINE_S = 900
+UPLINK_SCHED_PAYLOAD_SIZE = 51
+# Payload of a sample sent on its own before SENSOR_PAYLOAD: battery, temperature and humidity
+RAW_SAMPLE_SIZE = 5
+
+SIM_SOURCES = [os.path.join(TOOLS_DIR, 'sensor_payload_sim', 'sensor_payload_sim.c'),
+               os.path.join(SOFTWARE_DIR, 'lib', 'SENSOR_PAYLOAD', 'SENSOR_PAYLOAD.c')]
+SIM_FLAGS = ['-I' + os.path.join(SOFTWARE_DIR, 'lib', 'SENSOR_PAYLOAD')]
+
+# The RX windows stay open for about 8 symbols when no downlink is received, RX2 uses DR0 in EU868
+RX_WINDOW_SYMBOLS = 8
+RX2_DATARATE = 0
+
+
+def varint(value):
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return bytes(out)
+
+
+def zigzag(value):
+    return ((value << 1) ^ (value >> 31)) & 0xFFFFFFFF
+
+
+def encode(samples):
+    """Encodes (time, battery, temperature, humidity) samples as SENSOR_PAYLOAD_Add() does"""
+    count = len(samples)
+    intervals = [samples[i][0] - samples[i - 1][0] for i in range(1, count)]
+    irregular = len(set(intervals)) > 1
+
+    out = bytearray([(FORMAT << 6) | (IRREGULAR if irregular else 0) | (count - 1)])
+    out += varint(samples[0][0])
+    if count > 1 and not irregular:
+        out += varint(intervals[0])
+    out.append(samples[0][1])
+    out += varint(zigzag(samples[0][2]))
+    out += varint(samples[0][3])
+
+    for previous, sample in zip(samples, samples[1:]):
+        battery, temperature, humidity = (sample[i] - previous[i] for i in (1, 2, 3))
+        nibbles = ((temperature << 4) | (humidity & 0x0F)) & 0xFF
+        if irregular:
+            out += varint(sample[0] - previous[0])
+        if battery == 0 and -8 <= temperature <= 7 and -8 <= humidity <= 7 and nibbles != ESCAPE:
+            out.append(nibbles)
+        else:
+            out.append(ESCAPE)
+            out += varint(zigzag(battery)) + varint(zigzag(temperature)) + varint(zigzag(humidity))
+    return bytes(out)
+
+
+class Reader:
+    def __init__(self, payload):
+        self.payload = payload
+        self.offset = 0
+
+    def byte(self):
+        if self.offset >= len(self.payload):
+            raise ValueError('truncated payload')
+        value = self.payload[self.offset]
+        self.offset += 1
+        return value
+
+    def varint(self):
+        value = shift = 0
+        while True:
+            byte = self.byte()
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if byte < 0x80:
+                return value
+
+    def zigzag(self):
+        value = self.varint()
+        return (value >> 1) ^ -(value & 1)
+
+
+def nibble(value):
+    return value - 16 if value >= 8 else value
+
+
+def decode(payload):
+    """Decodes the blocks of a payload into (time, battery, temperature, humidity) samples"""
+    reader = Reader(payload)
+    samples = []
+    while reader.offset < len(payload):
+        header = reader.byte()
+        if header >> 6 != FORMAT:
+            raise ValueError('unknown block format %d' % (header >> 6))
+        count = (header & 0x1F) + 1
+        irregular = (header & IRREGULAR) != 0
+        time = reader.varint()
+        interval = reader.varint() if (count > 1 and not irregular) else 0
+        battery = reader.byte()
+        temperature = reader.zigzag()
+        humidity = reader.varint()
+        samples.append((time, battery, temperature, humidity))
+        for _ in range(count - 1):
+            time += reader.varint() if irregular else interval
+            code = reader.byte()
+            if code == ESCAPE:
+                battery += reader.zigzag()
+                temperature += reader.zigzag()
+                humidity += reader.zigzag()
+            else:
+                temperature += nibble(code >> 4)
+                humidity += nibble(code & 0x0F)
+            samples.append((time, battery, temperature, humidity))
+    return samples
+
+
+def trace(interval_s, hours, seed):
+    """Indoor-like samples: daily temperature and humidity swings with noise, slowly discharging battery"""
+    rng = random.Random(seed)
+    samples = []
+    battery = 36
+    for i in range(int(hours * 3600 / interval_s)):
+        time = i * interval_s
+        phase = 2 * math.pi * time / 86400
+        temperature = round(215 + 30 * math.sin(phase) + rng.gauss(0, 1))
+        humidity = round(450 - 60 * math.sin(phase) + rng.gauss(0, 2))
+        if rng.random() < interval_s / (7 * 86400):
+            battery -= 1
+        samples.append((time, battery, temperature, humidity))
+    return samples
+
+
+def aggregate(samples, max_size):
+    """Splits the samples in blocks as app/sensors_lorawan/lora_app.c does"""
+    blocks = []
+    block = []
+    for sample in samples:
+        if block and (len(block) >= MAX_SAMPLES or len(encode(block + [sample])) > max_size):
+            blocks.append(encode(block))
+            block = []
+        block.append(sample)
+        if len(block) >= SENSORS_AGGREGATE_SAMPLES or sample[0] - block[0][0] >= SENSORS_AGGREGATE_DEADLINE_S:
+            blocks.append(encode(block))
+            block = []
+    if block:
+        blocks.append(encode(block))
+    return blocks
+
+
+def split(samples, max_size):
+    """Splits the samples in blocks of at most max_size bytes and MAX_SAMPLES samples, as sensor_payload_sim.c does,
+    returns the blocks and the samples which do not fit an empty block"""
+    blocks = []
+    block = []
+    skipped = []
+    for sample in samples:
+        if block and (len(block) >= MAX_SAMPLES or len(encode(block + [sample])) > max_size):
+            blocks.append(encode(block))
+            block = []
+        if len(encode(block + [sample])) > max_size:
+            skipped.append(sample[0])
+            continue
+        block.append(sample)
+    if block:
+        blocks.append(encode(block))
+    return blocks, skipped
+
+
+def random_trace(rng):
+    """Samples with regular or irregular times, small and large changes, battery drops and escaped nibbles"""
+    count = rng.randint(1, 100)
+    interval = rng.choice([1, 60, 300, 900, 3600, 100000])
+    time = rng.choice([0, rng.randrange(1 << 20), rng.randrange((1 << 32) - 1)])
+    battery = rng.randrange(256)
+    temperature = rng.randint(-32768, 32767)
+    humidity = rng.randrange(65536)
+    irregular = rng.random() < 0.3
+    samples = []
+    for _ in range(count):
+        samples.append((time, battery, temperature, humidity))
+        time += interval + (rng.randint(0, interval) if irregular and rng.random() < 0.5 else 0)
+        if rng.random() < 0.05:
+            battery = (battery + rng.choice([-1, 1, rng.randint(-255, 255)])) % 256
+        if rng.random() < 0.1:
+            temperature, humidity = rng.randint(-32768, 32767), rng.randrange(65536)
+        elif rng.random() < 0.1:
+            temperature, humidity = temperature - 8, humidity - 8
+        else:
+            temperature += rng.randint(-9, 9)
+            humidity += rng.randint(-9, 9)
+        temperature = min(max(temperature, -32768), 32767)
+        humidity = min(max(humidity, 0), 65535)
+        if time >= 1 << 32:
+            break
+    return samples
+
+
+def build_sim():
+    """Builds the encoder run once per version of its sources, returns the executable"""
+    compiler = os.environ.get('CC', 'cc')
+    digest = hashlib.sha1(compiler.encode() + ''.join(SIM_FLAGS).encode())
+    for path in sorted(SIM_SOURCES + glob.glob(os.path.join(SOFTWARE_DIR, 'lib', 'SENSOR_PAYLOAD', '*.h'))):
+        with open(path, 'rb') as f:
+            digest.update(f.read())
+    binary = os.path.join(tempfile.gettempdir(), 'sensor_payload_sim-%s' % digest.hexdigest()[:12])
+    if not os.path.exists(binary):
+        command = [compiler, '-O2', '-std=gnu11', '-w'] + SIM_FLAGS + SIM_SOURCES + ['-o', binary + '.tmp']
+        if subprocess.call(command) != 0:
+            sys.exit('Failed to build %s' % SIM_SOURCES[0])
+        os.replace(binary + '.tmp', binary)
+    return binary
+
+
+def run_sim(samples, max_size):
+    """Encodes the samples with SENSOR_PAYLOAD.c, returns the same values as split()"""
+    lines = ''.join('%d %d %d %d\n' % sample for sample in samples)
+    output = subprocess.run([build_sim(), str(max_size)], input=lines, stdout=subprocess.PIPE,
+                            universal_newlines=True, check=True).stdout
+    blocks = [bytes.fromhex(line.split()[1]) for line in output.splitlines() if line.startswith('BLOCK')]
+    skipped = [int(line.split()[1]) for line in output.splitlines() if line.startswith('SKIP')]
+    return blocks, skipped
+
+
+def check(args):
+    rng = random.Random(args.seed)
+    blocks = samples = 0
+    for index in range(args.traces):
+        trace_samples = random_trace(rng)
+        max_size = rng.choice([rng.randint(11, 51), 51, 115, 242])
+        expected = split(trace_samples, max_size)
+        result = run_sim(trace_samples, max_size)
+        if result != expected:
+            sys.exit('Trace %d, %d bytes: SENSOR_PAYLOAD.c %s differs from %s' % (index, max_size, result, expected))
+        kept = [sample for sample in trace_samples if sample[0] not in expected[1]]
+        if decode(b''.join(result[0])) != kept:
+            sys.exit('Trace %d, %d bytes: decoded samples do not match' % (index, max_size))
+        blocks += len(result[0])
+        samples += len(kept)
+    print('%d traces, %d blocks of %d samples: SENSOR_PAYLOAD.c gives the same bytes' % (args.traces, blocks, samples))
+
+
+def uplink_energy(dr, size, args):
+    """Energy in mJ of an uplink followed by two empty RX windows"""
+    rx1 = RX_WINDOW_SYMBOLS * (1 << EU868_SF[dr]) / EU868_BW[dr]
+    rx2 = RX_WINDOW_SYMBOLS * (1 << EU868_SF[RX2_DATARATE]) / EU868_BW[RX2_DATARATE]
+    return args.voltage * (args.tx_ma * time_on_air(dr, size) + args.rx_ma * (rx1 + rx2)) / 1000
+
+
+def simulate(args):
+    print('%d hours of samples, aggregating %d samples or %d s, TX %.1f mA, RX %.1f mA at %.1f V' %
+          (args.hours, SENSORS_AGGREGATE_SAMPLES, SENSORS_AGGREGATE_DEADLINE_S, args.tx_ma, args.rx_ma, args.voltage))
+    print('%8s %4s | %12s %12s | %8s %12s %12s | %9s %9s' %
+          ('interval', 'DR', 'raw ms/smp', 'raw mJ/smp', 'B/smp', 'aggr ms/smp', 'aggr mJ/smp', 'air-time', 'energy'))
+    for interval in args.interval:
+        samples = trace(interval, args.hours, args.seed)
+        for dr in args.datarate or range(len(EU868_SF)):
+            max_size = min(EU868_MAX_PAYLOAD[dr], UPLINK_SCHED_PAYLOAD_SIZE)
+            blocks = aggregate(samples, max_size)
+            decoded = decode(b''.join(blocks))
+            if decoded != samples:
+                raise ValueError('decoded samples do not match')
+            raw_toa = time_on_air(dr, RAW_SAMPLE_SIZE)
+            raw_energy = uplink_energy(dr, RAW_SAMPLE_SIZE, args)
+            toa = sum(time_on_air(dr, len(block)) for block in blocks) / len(samples)
+            energy = sum(uplink_energy(dr, len(block), args) for block in blocks) / len(samples)
+            size = sum(len(block) for block in blocks) / len(samples)
+            print('%7ds DR%-2d | %12.1f %12.2f | %8.2f %12.1f %12.2f | %8.1f%% %8.1f%%' %
+                  (interval, dr, raw_toa, raw_energy, size, toa, energy,
+                   100 * (1 - toa / raw_toa), 100 * (1 - energy / raw_energy)))
+
+
+if __name__ == '__main__':
+    import argparse
+
+    parser = argparse.ArgumentParser(description='Decode aggregated sensor payloads and estimate their air-time and energy.')
+    subparsers = parser.add_subparsers(dest='command', required=True)
+
+    p_decode = subparsers.add_parser('decode', help='decode a payload')
+    p_decode.add_argument('payload', help='payload in hexadecimal')
+
+    p_simulate = subparsers.add_parser('simulate', help='compare aggregated samples with one sample per uplink')
+    p_simulate.add_argument('-i', '--interval', type=int, action='append',
+                            help='sampling interval in seconds, repeat for several (default: 60, 300 and 900)')
+    p_simulate.add_argument('-d', '--datarate', type=int, choices=range(len(EU868_SF)), action='append',
+                            help='EU868 datarate, repeat for several (default: all)')
+    p_simulate.add_argument('--hours', type=int, default=48,
+                            help='duration of the sample trace (default: %(default)s)')
+    p_simulate.add_argument('--seed', type=int, default=1,
+                            help='seed of the sample trace (default: %(default)s)')
+    p_simulate.add_argument('--tx-ma', type=float, default=24.0,
+                            help='radio current while transmitting in mA (default: %(default)s, +14 dBm)')
+    p_simulate.add_argument('--rx-ma', type=float, default=5.0,
+                            help='radio current while receiving in mA (default: %(default)s)')
+    p_simulate.add_argument('--voltage', type=float, default=3.3,
+                            help='supply voltage in V (default: %(default)s)')
+
+    p_check = subparsers.add_parser('check', help='compare this encoder with SENSOR_PAYLOAD.c on random traces')
+    p_check.add_argument('--traces', type=int, default=300,
+                         help='number of random sample traces (default: %(default)s)')
+    p_check.add_argument('--seed', type=int, default=1,
+                         help='seed of the sample traces (default: %(default)s)')
+
+    args = parser.parse_args()
+
+    if args.command == 'check':
+        check(args)
+    elif args.command == 'decode':
+        try:
+            for time, battery, temperature, humidity in decode(bytes.fromhex(args.payload)):
+                print('%10d s  %4.1f V  %6.1f C  %5.1f %%RH' % (time, battery / 10, temperature / 10, humidity / 10))
+        except ValueError as error:
+            sys.exit('Invalid payload: %s' % error)
+    else:
+        args.interval = args.interval or [60, 300, 900]
+        simulate(args)
@@ -0,0 +1,107 @@
+"""
+Copyright 2021 The Things Industries B.V.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+# Checks that the LoRaMac, region, crypto and timer sources do not need the soft-float helpers of the compiler
+# (__aeabi_fmul, __aeabi_f2d, ...) nor the libm rounding functions. The STM32WL55 Cortex-M4 has no FPU, every float
+# operation in the MAC pulls the emulation routines into the image and costs hundreds of cycles. The sources are built
+# for the Cortex-M4 with all the regions and Class B enabled, and linked with --gc-sections into the MAC-only image of
+# soft_float_check/soft_float_image.c, which calls every LoRaMac API. The symbols of the linked image are checked: a
+# helper counts when the code the linker keeps uses it, and the sources referencing it are listed. Exits with an error
+# when a floating point helper is found. Without a C library for the target, e.g. on the host, the image is linked
+# without libraries and the helpers it needs stay undefined, they are found the same way.
+#
+#   $ python3 tools/soft_float_check.py
+#   $ cmake --build <build dir> --target soft_float_check
+#   $ CC=cc NM=nm python3 tools/soft_float_check.py --flags "-m32 -msoft-float -mno-80387" \
+#         --ldflags "-nostdlib -nostartfiles -Wl,-e,main -Wl,--unresolved-symbols=ignore-all"
+
+import glob
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+from fleet_sim import LORAWAN_DIR, NODE_DEFINES, NODE_INCLUDES, NODE_SOURCES, SOFTWARE_DIR, TOOLS_DIR
+
+# lorawan_conf.h with Class B enabled
+CONF_DIR = os.path.join(TOOLS_DIR, 'rx_bench')
+SOURCES = NODE_SOURCES
+TIMER_SOURCES = ['stm32_timer.c', 'stm32_systime.c']
+# The MAC-only image has no HAL nor interrupts, its CRCs and event trace are the ones of the fleet_sim nodes
+UTILITY_SOURCES = ['stm32_crc.c']
+IMAGE_SOURCE = os.path.join(TOOLS_DIR, 'soft_float_check', 'soft_float_image.c')
+REGIONS = ['AS923', 'AU915', 'CN470', 'CN779', 'EU433', 'EU868', 'KR920', 'IN865', 'US915', 'RU864']
+TARGET_FLAGS = '-mcpu=cortex-m4 -mthumb -mabi=aapcs -mfloat-abi=soft'
+IMAGE_FLAGS = '--specs=nano.specs --specs=nosys.specs'
+
+# ARM run-time ABI and libgcc floating point helpers, libm rounding functions
+SOFT_FLOAT = re.compile(r'^(__aeabi_([fd]|[ui]2[fd]|u?l2[fd])\w*|__\w*(sf|df)\w*|(floor|ceil|round|trunc|pow)f?)$')
+
+
+def undefined_symbols(nm, obj):
+    output = subprocess.check_output([nm, '-u', obj], universal_newlines=True)
+    return [line.split()[-1] for line in output.splitlines() if line.strip()]
+
+
+def image_symbols(nm, image):
+    """Returns the defined and undefined symbols of a linked image"""
+    output = subprocess.check_output([nm, image], universal_newlines=True)
+    return set(line.split()[-1] for line in output.splitlines() if line.strip())
+
+
+if __name__ == '__main__':
+    import argparse
+
+    parser = argparse.ArgumentParser(description='Check that the LoRaMac sources do not use soft-float helpers.')
+    parser.add_argument('--flags', default=TARGET_FLAGS, help='target flags (default: %(default)s)')
+    parser.add_argument('--ldflags', default=IMAGE_FLAGS, help='image link flags (default: %(default)s)')
+    parser.add_argument('-O', dest='optimization', default='s', help='optimization level (default: %(default)s)')
+    args = parser.parse_args()
+
+    compiler = os.environ.get('CC', 'arm-none-eabi-gcc')
+    nm = os.environ.get('NM', 'arm-none-eabi-nm')
+    sources = sorted(sum((glob.glob(os.path.join(LORAWAN_DIR, pattern)) for pattern in SOURCES), []))
+    sources += [os.path.join(SOFTWARE_DIR, 'lib', 'Utilities', 'baremetal', source) for source in TIMER_SOURCES]
+    sources += [os.path.join(SOFTWARE_DIR, 'lib', 'Utilities', source) for source in UTILITY_SOURCES]
+    includes = [CONF_DIR] + NODE_INCLUDES
+    flags = args.flags.split() + ['-O' + args.optimization, '-std=gnu11', '-w', '-ffunction-sections',
+                                  '-fdata-sections'] + ['-DREGION_' + region for region in REGIONS] + NODE_DEFINES
+
+    referenced = {}
+    with tempfile.TemporaryDirectory() as build_dir:
+        objs = []
+        for source in sources + [IMAGE_SOURCE]:
+            obj = os.path.join(build_dir, os.path.basename(source) + '.o')
+            if subprocess.call([compiler, '-c'] + flags + ['-I' + d for d in includes] + [source, '-o', obj]) != 0:
+                sys.exit('Failed to build %s' % source)
+            objs.append(obj)
+            for symbol in undefined_symbols(nm, obj):
+                if SOFT_FLOAT.match(symbol):
+                    referenced.setdefault(symbol, []).append(os.path.relpath(source, SOFTWARE_DIR))
+        image = os.path.join(build_dir, 'soft_float_image.elf')
+        if subprocess.call([compiler] + flags + objs + ['-Wl,--gc-sections'] + args.ldflags.split() +
+                           ['-o', image]) != 0:
+            sys.exit('Failed to link %s' % os.path.relpath(IMAGE_SOURCE, SOFTWARE_DIR))
+        found = dict((symbol, referenced.get(symbol, ['libraries'])) for symbol in image_symbols(nm, image)
+                     if SOFT_FLOAT.match(symbol))
+
+    for symbol, users in sorted(found.items()):
+        print('%s: %s' % (symbol, ', '.join(users)))
+    # References from the code the linker removed cost nothing
+    for symbol, users in sorted(referenced.items()):
+        if symbol not in found:
+            print('%s: %s, removed by the linker' % (symbol, ', '.join(users)))
+    if found:
+        sys.exit('%d floating point helpers in the image of %d sources' % (len(found), len(sources)))
+    print('No floating point helpers in the image of %d sources' % len(sources))
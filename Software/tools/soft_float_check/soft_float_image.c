@@ -0,0 +1,117 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file soft_float_image.c
+ *
+ * @brief MAC-only image of soft_float_check.py: calls every LoRaMac API of the applications so that the linker, with
+ *        --gc-sections, keeps the MAC, region, crypto and timer code an application pulls into its image
+ *
+ * The image is linked, never run. The request types and parameters are volatile so that the compiler keeps every
+ * case of the requests, the radio, timer and system time drivers are empty: their callers stay in the image, and the
+ * floating point helpers of the drivers of an application are not the ones of the MAC.
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include "LoRaMac.h"
+#include "LoRaMacTest.h"
+#include "Region.h"
+#include "radio.h"
+#include "stm32_timer.h"
+#include "stm32_systime.h"
+
+/* Inputs the compiler cannot know */
+static volatile uint32_t Input;
+static volatile uint16_t Temperature;
+
+const UTIL_TIMER_Driver_s UTIL_TimerDriver;
+const UTIL_SYSTIM_Driver_s UTIL_SYSTIMDriver;
+const struct Radio_s Radio;
+
+static void McpsConfirm(McpsConfirm_t *mcpsConfirm)
+{
+}
+
+static void McpsIndication(McpsIndication_t *mcpsIndication)
+{
+}
+
+static void MlmeConfirm(MlmeConfirm_t *mlmeConfirm)
+{
+}
+
+static void MlmeIndication(MlmeIndication_t *mlmeIndication)
+{
+}
+
+/* Class B compensates its timers with the temperature of the device */
+static uint16_t GetTemperatureLevel(void)
+{
+  return Temperature;
+}
+
+static LoRaMacPrimitives_t Primitives =
+{
+  .MacMcpsConfirm = McpsConfirm,
+  .MacMcpsIndication = McpsIndication,
+  .MacMlmeConfirm = MlmeConfirm,
+  .MacMlmeIndication = MlmeIndication,
+};
+
+static LoRaMacCallback_t Callbacks =
+{
+  .GetTemperatureLevel = GetTemperatureLevel,
+};
+
+int main(void)
+{
+  MibRequestConfirm_t mibReq = { .Type = (Mib_t)Input };
+  MlmeReq_t mlmeReq = { .Type = (Mlme_t)Input };
+  McpsReq_t mcpsReq = { .Type = (Mcps_t)Input };
+  McChannelParams_t mcChannel = { .GroupID = (AddressIdentifier_t)Input };
+  McRxParams_t mcRxParams = { .ClassB.Frequency = Input };
+  ChannelParams_t channel = { .Frequency = Input };
+  LoRaMacTxInfo_t txInfo;
+  uint8_t *buffer;
+  uint8_t size;
+  uint8_t status;
+
+  LoRaMacInitialization(&Primitives, &Callbacks, (LoRaMacRegion_t)Input);
+  LoRaMacStart();
+  LoRaMacMibSetRequestConfirm(&mibReq);
+  LoRaMacMibGetRequestConfirm(&mibReq);
+  LoRaMacMlmeRequest(&mlmeReq);
+  LoRaMacMcpsRequest(&mcpsReq, Input != 0U);
+  LoRaMacQueryTxPossible((uint8_t)Input, &txInfo);
+  LoRaMacGetTxPayloadBuffer(&buffer, &size);
+  LoRaMacChannelAdd((uint8_t)Input, channel);
+  LoRaMacChannelRemove((uint8_t)Input);
+  LoRaMacMcChannelSetup(&mcChannel);
+  LoRaMacMcChannelSetupRxParams((AddressIdentifier_t)Input, &mcRxParams, &status);
+  LoRaMacMcChannelGetGroupId(Input);
+  LoRaMacMcChannelDelete((AddressIdentifier_t)Input);
+  LoRaMacTestSetDutyCycleOn(Input != 0U);
+
+  while (LoRaMacIsBusy() == true)
+  {
+    UTIL_TIMER_IRQ_Handler();
+    LoRaMacProcess();
+  }
+  LoRaMacStop();
+  LoRaMacDeInitialization();
+  return 0;
+}
@@ -0,0 +1,218 @@
+"""
+Copyright 2021 The Things Industries B.V.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+# Simulates periodic sensor uplinks over the EU868 duty-cycle bands with a virtual clock, comparing:
+# - period: LmHandlerSend() on every sample, the sample is lost when the MAC is busy or duty-cycle restricted
+# - sched: the samples are queued in lib/UPLINK_SCHED and merged while they wait for the duty-cycle
+# The sched results are the ones of UPLINK_SCHED.c built for the host with uplink_sched_sim/uplink_sched_sim.c. The
+# script checks them against its own model of the scheduler and fails if they differ.
+
+import glob
+import hashlib
+import heapq
+import math
+import os
+import subprocess
+import sys
+import tempfile
+
+TOOLS_DIR = os.path.dirname(os.path.abspath(__file__))
+SOFTWARE_DIR = os.path.dirname(TOOLS_DIR)
+SIM_SOURCES = [os.path.join(TOOLS_DIR, 'uplink_sched_sim', 'uplink_sched_sim.c'),
+               os.path.join(SOFTWARE_DIR, 'lib', 'UPLINK_SCHED', 'UPLINK_SCHED.c')]
+SIM_FLAGS = ['-I' + os.path.join(SOFTWARE_DIR, 'lib', 'UPLINK_SCHED')]
+
+# EU868 default channels 868.1, 868.3 and 868.5 MHz share the 1% band, see RegionEU868.h
+BAND_DCYCLE = 100
+# Credits of a joined device, see RegionCommon.c
+DUTY_CYCLE_TIME_PERIOD = 3600000
+
+# EU868 datarates: spreading factor and maximum application payload without repeater, see RegionEU868.h
+EU868_SF = [12, 11, 10, 9, 8, 7, 7]
+EU868_BW = [125, 125, 125, 125, 125, 125, 250]
+EU868_MAX_PAYLOAD = [51, 51, 51, 115, 242, 242, 242]
+
+# MHDR, DevAddr, FCtrl, FCnt, FPort and MIC
+LORAWAN_OVERHEAD = 13
+# The MAC is busy until the end of RX2, 2 s after the end of the uplink
+RX2_END_MS = 2200
+
+# Must match lib/UPLINK_SCHED/UPLINK_SCHED.h and app/sensors_lorawan/conf/app_conf.h
+UPLINK_SCHED_QUEUE_SIZE = 8
+# Fixed size samples, see sensor_payload_tool.py for the aggregated samples of app/sensors_lorawan
+SENSORS_SAMPLE_SIZE = 5
+SENSORS_SAMPLE_LIFETIME_S = 900
+
+
+def time_on_air(dr, size):
+    """LoRa time-on-air in ms of an uplink, as RadioTimeOnAir() with CR 4/5, 8 preamble symbols and CRC"""
+    sf = EU868_SF[dr]
+    bw = EU868_BW[dr]
+    ldro = 1 if (sf >= 11 and bw == 125) else 0
+    pl = LORAWAN_OVERHEAD + size
+    symbols = 8 + max(math.ceil((8 * pl - 4 * sf + 28 + 16) / (4 * (sf - 2 * ldro))) * 5, 0)
+    return math.ceil((8 + 4.25 + symbols) * (1 << sf) / bw)
+
+
+class Band:
+    """Time credits of the band, as RegionCommonUpdateBandTimeOff() and RegionCommonSetBandTxDone()"""
+
+    def __init__(self):
+        self.credits = DUTY_CYCLE_TIME_PERIOD
+        self.last = 0
+
+    def update(self, now):
+        self.credits = min(self.credits + now - self.last, DUTY_CYCLE_TIME_PERIOD)
+        self.last = now
+
+    def wait(self, now, toa):
+        """Returns 0 if an uplink of toa ms can be sent now, otherwise the time-off left"""
+        self.update(now)
+        cost = toa * BAND_DCYCLE
+        if self.credits > cost:
+            return 0
+        return cost - self.credits
+
+    def tx_done(self, toa):
+        self.credits = max(self.credits - toa * BAND_DCYCLE, 0)
+
+
+class Mac:
+    def __init__(self, dr):
+        self.dr = dr
+        self.band = Band()
+        self.busy_until = 0
+        self.frames = 0
+        self.air_time = 0
+
+    def send(self, now, size):
+        """Returns ('busy', 0), ('restricted', next_tx_in) or ('success', end of the MAC busy time)"""
+        if now < self.busy_until:
+            return 'busy', 0
+        toa = time_on_air(self.dr, size)
+        wait = self.band.wait(now, toa)
+        if wait > 0:
+            return 'restricted', wait
+        self.band.tx_done(toa)
+        self.busy_until = now + toa + RX2_END_MS
+        self.frames += 1
+        self.air_time += toa
+        return 'success', self.busy_until
+
+
+def simulate_period(dr, period_s, hours):
+    mac = Mac(dr)
+    sampled = delivered = 0
+    for now in range(0, hours * 3600000, period_s * 1000):
+        sampled += 1
+        status, _ = mac.send(now, SENSORS_SAMPLE_SIZE)
+        if status == 'success':
+            delivered += 1
+    return sampled, delivered, mac.frames, mac.air_time
+
+
+def simulate_sched(dr, period_s, hours):
+    """Event driven model of UPLINK_SCHED_Process(), the queue holds the deadline of each sample"""
+    mac = Mac(dr)
+    end = hours * 3600000
+    queue = []
+    events = [(t, 'sample') for t in range(0, end, period_s * 1000)]
+    heapq.heapify(events)
+    next_tx = 0
+    tx_busy = False
+    sampled = delivered = dropped = 0
+
+    while events:
+        now, event = heapq.heappop(events)
+        if now >= end:
+            break
+        if event == 'sample':
+            sampled += 1
+            if len(queue) < UPLINK_SCHED_QUEUE_SIZE:
+                queue.append(now + SENSORS_SAMPLE_LIFETIME_S * 1000)
+            else:
+                dropped += 1
+        elif event == 'tx_done':
+            tx_busy = False
+
+        # UPLINK_SCHED_Process()
+        dropped += len([d for d in queue if d < now])
+        queue = [d for d in queue if d >= now]
+        if not queue or tx_busy:
+            continue
+        if now < next_tx:
+            heapq.heappush(events, (next_tx, 'timer'))
+            continue
+        count = min(len(queue), EU868_MAX_PAYLOAD[dr] // SENSORS_SAMPLE_SIZE)
+        status, value = mac.send(now, count * SENSORS_SAMPLE_SIZE)
+        if status == 'success':
+            queue = queue[count:]
+            delivered += count
+            tx_busy = True
+            heapq.heappush(events, (value, 'tx_done'))
+        elif status == 'restricted':
+            next_tx = now + value + 1
+            heapq.heappush(events, (next_tx, 'timer'))
+
+    return sampled, delivered, mac.frames, mac.air_time
+
+
+def build_sim():
+    """Builds the scheduler run once per version of its sources, returns the executable"""
+    compiler = os.environ.get('CC', 'cc')
+    digest = hashlib.sha1(compiler.encode() + ''.join(SIM_FLAGS).encode())
+    for path in sorted(SIM_SOURCES + glob.glob(os.path.join(SOFTWARE_DIR, 'lib', 'UPLINK_SCHED', '*.h'))):
+        with open(path, 'rb') as f:
+            digest.update(f.read())
+    binary = os.path.join(tempfile.gettempdir(), 'uplink_sched_sim-%s' % digest.hexdigest()[:12])
+    if not os.path.exists(binary):
+        command = [compiler, '-O2', '-std=gnu11', '-w'] + SIM_FLAGS + SIM_SOURCES + ['-o', binary + '.tmp']
+        if subprocess.call(command) != 0:
+            sys.exit('Failed to build %s' % SIM_SOURCES[0])
+        os.replace(binary + '.tmp', binary)
+    return binary
+
+
+def run_sim(dr, period_s, hours):
+    """Runs UPLINK_SCHED.c over the scenario, returns the same values as simulate_sched()"""
+    output = subprocess.check_output([build_sim(), str(dr), str(period_s), str(hours)], universal_newlines=True)
+    sampled, delivered, frames, air_time = map(int, output.split()[1:5])
+    return sampled, delivered, frames, air_time
+
+
+if __name__ == '__main__':
+    import argparse
+
+    parser = argparse.ArgumentParser(description='Compare the uplink scheduler with fixed period uplinks over the EU868 bands.')
+    parser.add_argument('-p', '--period', type=int, default=60,
+                        help='sampling period in seconds (default: %(default)s)')
+    parser.add_argument('-d', '--datarate', type=int, choices=range(len(EU868_SF)), action='append',
+                        help='EU868 datarate, repeat for several (default: all)')
+    parser.add_argument('--hours', type=int, default=24,
+                        help='simulated time in hours, starting with full band credits (default: %(default)s)')
+    args = parser.parse_args()
+
+    print('%d s sampling period, %d hours, %d byte samples, delivered samples per hour:' %
+          (args.period, args.hours, SENSORS_SAMPLE_SIZE))
+    print('%-4s %8s | %8s %8s %10s | %8s %8s %10s | %6s' %
+          ('DR', 'sampled', 'period', 'frames', 'airtime s', 'sched', 'frames', 'airtime s', 'gain'))
+    for dr in args.datarate or range(len(EU868_SF)):
+        sampled, period, period_frames, period_air = simulate_period(dr, args.period, args.hours)
+        result = run_sim(dr, args.period, args.hours)
+        if result != simulate_sched(dr, args.period, args.hours):
+            sys.exit('DR%d: UPLINK_SCHED.c %s differs from the model %s' %
+                     (dr, result, simulate_sched(dr, args.period, args.hours)))
+        _, sched, sched_frames, sched_air = result
+        print('DR%-2d %8.1f | %8.1f %8d %10.1f | %8.1f %8d %10.1f | %5.2fx' %
+              (dr, sampled / args.hours, period / args.hours, period_frames, period_air / 1000,
+               sched / args.hours, sched_frames, sched_air / 1000, sched / max(period, 1)))
@@ -0,0 +1,194 @@
+/** Copyright © 2021 The Things Industries B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file uplink_sched_sim.c
+ *
+ * @brief Scheduler run of uplink_sched_sim.py: periodic samples queued in UPLINK_SCHED built for the host, with a
+ *        virtual clock and the EU868 1% band and MAC model of the script
+ *
+ * Usage: uplink_sched_sim DR PERIOD_S HOURS
+ *
+ * The events are handled in the order of the script: samples, then the scheduler timer, then the end of the MAC
+ * busy time at the same instant, each one followed by UPLINK_SCHED_Process(). Result on stdout:
+ *  - RESULT sampled delivered frames air_time_ms dropped restricted
+ *
+ * @copyright Copyright (c) 2021 The Things Industries B.V.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "UPLINK_SCHED.h"
+
+/* Same values as uplink_sched_sim.py */
+#define SIM_BAND_DCYCLE 100U
+#define SIM_DUTY_CYCLE_TIME_PERIOD 3600000U
+#define SIM_LORAWAN_OVERHEAD 13U
+#define SIM_RX2_END_MS 2200U
+#define SIM_SAMPLE_SIZE 5U
+#define SIM_SAMPLE_LIFETIME_S 900U
+#define SIM_NO_EVENT UINT64_MAX
+
+static const uint8_t Eu868Sf[] = { 12, 11, 10, 9, 8, 7, 7 };
+static const uint32_t Eu868Bw[] = { 125, 125, 125, 125, 125, 125, 250 };
+static const uint8_t Eu868MaxPayload[] = { 51, 51, 51, 115, 242, 242, 242 };
+
+static uint32_t Dr = 0;
+static uint32_t Now = 0;
+static uint64_t TimerTime = SIM_NO_EVENT;
+static uint64_t TxDoneTime = SIM_NO_EVENT;
+static uint32_t TxDoneTimeOnAir = 0;
+
+/* Band and MAC of the script */
+static uint32_t BandCredits = SIM_DUTY_CYCLE_TIME_PERIOD;
+static uint32_t BandLast = 0;
+static uint32_t BusyUntil = 0;
+
+/* LoRa time-on-air in ms, CR 4/5, 8 preamble symbols and CRC */
+static uint32_t TimeOnAir(uint8_t size)
+{
+  int32_t sf = Eu868Sf[Dr];
+  int32_t ldro = ((sf >= 11) && (Eu868Bw[Dr] == 125U)) ? 1 : 0;
+  int32_t bits = (8 * (int32_t)(SIM_LORAWAN_OVERHEAD + size)) - (4 * sf) + 28 + 16;
+  int32_t block = 4 * (sf - (2 * ldro));
+  int32_t symbols = 8 + ((bits > 0) ? (((bits + block - 1) / block) * 5) : 0);
+  /* (8 + 4.25 + symbols) * 2^sf / bw, in quarter symbols */
+  uint64_t numerator = (uint64_t)(49 + (4 * symbols)) << sf;
+  uint64_t denominator = 4U * (uint64_t)Eu868Bw[Dr];
+
+  return (uint32_t)((numerator + denominator - 1U) / denominator);
+}
+
+static uint32_t SimGetTime(void)
+{
+  return Now;
+}
+
+static UPLINK_SCHED_op_result_t SimSend(uint8_t port, const uint8_t *buffer, uint8_t size, bool confirmed,
+                                        uint32_t *next_tx_in)
+{
+  uint32_t toa;
+  uint32_t cost;
+
+  if (Now < BusyUntil)
+  {
+    return UPLINK_SCHED_OP_BUSY;
+  }
+  toa = TimeOnAir(size);
+  cost = toa * SIM_BAND_DCYCLE;
+  BandCredits += Now - BandLast;
+  if (BandCredits > SIM_DUTY_CYCLE_TIME_PERIOD)
+  {
+    BandCredits = SIM_DUTY_CYCLE_TIME_PERIOD;
+  }
+  BandLast = Now;
+  if (BandCredits <= cost)
+  {
+    *next_tx_in = cost - BandCredits;
+    return UPLINK_SCHED_OP_RESTRICTED;
+  }
+  BandCredits -= cost;
+  BusyUntil = Now + toa + SIM_RX2_END_MS;
+  TxDoneTime = BusyUntil;
+  TxDoneTimeOnAir = toa;
+  return UPLINK_SCHED_OP_SUCCESS;
+}
+
+static uint8_t SimMaxPayload(void)
+{
+  return Eu868MaxPayload[Dr];
+}
+
+static void SimStartTimer(uint32_t delay)
+{
+  TimerTime = (uint64_t)Now + delay;
+}
+
+const UPLINK_SCHED_Driver_t UPLINK_SCHED_Driver =
+{
+  SimGetTime,
+  SimSend,
+  SimMaxPayload,
+  SimStartTimer,
+};
+
+int main(int argc, char **argv)
+{
+  const UPLINK_SCHED_Request_t request =
+  {
+    .Port = 2,
+    .Priority = 0,
+    .Confirmed = false,
+    .Mergeable = true,
+    .Lifetime = SIM_SAMPLE_LIFETIME_S * 1000U,
+  };
+  uint8_t sample[SIM_SAMPLE_SIZE] = { 0 };
+  UPLINK_SCHED_Stats_t stats;
+  uint64_t period;
+  uint64_t end;
+  uint64_t nextSample = 0;
+  uint32_t sampled = 0;
+
+  if ((argc != 4) || ((Dr = (uint32_t)atoi(argv[1])) >= sizeof(Eu868Sf)))
+  {
+    fprintf(stderr, "Usage: %s DR PERIOD_S HOURS\n", argv[0]);
+    return 2;
+  }
+  period = (uint64_t)atoi(argv[2]) * 1000U;
+  end = (uint64_t)atoi(argv[3]) * 3600000U;
+
+  UPLINK_SCHED_Init(NULL);
+  for (;;)
+  {
+    uint64_t next = nextSample;
+
+    if (TimerTime < next)
+    {
+      next = TimerTime;
+    }
+    if (TxDoneTime < next)
+    {
+      next = TxDoneTime;
+    }
+    if (next >= end)
+    {
+      break;
+    }
+    Now = (uint32_t)next;
+    if (nextSample == next)
+    {
+      sampled++;
+      nextSample += period;
+      (void)UPLINK_SCHED_Enqueue(&request, sample, sizeof(sample));
+    }
+    else if (TimerTime == next)
+    {
+      TimerTime = SIM_NO_EVENT;
+      UPLINK_SCHED_OnTimer();
+    }
+    else
+    {
+      TxDoneTime = SIM_NO_EVENT;
+      UPLINK_SCHED_OnTxDone(TxDoneTimeOnAir);
+    }
+    UPLINK_SCHED_Process();
+  }
+
+  UPLINK_SCHED_GetStats(&stats);
+  printf("RESULT %u %u %u %u %u %u\n", sampled, stats.Sent, stats.Frames, stats.AirTime, stats.Dropped,
+         stats.Restricted);
+  return 0;
+}